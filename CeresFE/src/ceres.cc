@@ -32,11 +32,13 @@ One per plasticity step:
 #include <deal.II/base/logstream.h>
 #include <deal.II/base/function.h>
 #include <deal.II/base/utilities.h>
+#include <deal.II/base/work_stream.h>
 
 #include <deal.II/lac/block_vector.h>
 #include <deal.II/lac/full_matrix.h>
 #include <deal.II/lac/block_sparse_matrix.h>
 #include <deal.II/lac/solver_cg.h>
+#include <deal.II/lac/solver_gmres.h>
 #include <deal.II/lac/precondition.h>
 #include <deal.II/lac/affine_constraints.h>
 
@@ -67,6 +69,9 @@ One per plasticity step:
 
 #include <deal.II/lac/sparse_direct.h>
 #include <deal.II/lac/sparse_ilu.h>
+#ifdef DEAL_II_WITH_TRILINOS
+#include <deal.II/lac/trilinos_precondition.h>
+#endif
 
 #include <iostream>
 #include <fstream>
@@ -141,6 +146,35 @@ namespace Step22
     double first_eta;
     double new_eta;
     double G;
+    Tensor<1, dim> gravity; // cached self-gravity, see assemble_system()
+  };
+
+// Scratch object for the threaded update of the quadrature point history
+
+  template<int dim>
+  struct StressUpdateScratchData
+  {
+    StressUpdateScratchData(const FiniteElement<dim> &fe,
+                            const Quadrature<dim> &quadrature)
+      :
+      fe_values(fe, quadrature,
+                update_values | update_gradients | update_quadrature_points),
+      velocity_grads(quadrature.size(), std::vector<Tensor<1, dim> >(dim + 1)),
+      velocities(quadrature.size(), Vector<double>(dim + 1))
+    {}
+
+    StressUpdateScratchData(const StressUpdateScratchData &scratch)
+      :
+      fe_values(scratch.fe_values.get_fe(),
+                scratch.fe_values.get_quadrature(),
+                scratch.fe_values.get_update_flags()),
+      velocity_grads(scratch.velocity_grads),
+      velocities(scratch.velocities)
+    {}
+
+    FEValues<dim> fe_values;
+    std::vector<std::vector<Tensor<1, dim> > > velocity_grads;
+    std::vector<Vector<double> > velocities;
   };
 
 // Primary class of this problem
@@ -173,6 +207,8 @@ namespace Step22
     void write_mesh();
     void setup_quadrature_point_history();
     void update_quadrature_point_history();
+    void update_quadrature_point_gravity(const A_Grav_namespace::AnalyticGravity<dim> &aGrav);
+    void solve_block_preconditioned();
 
     const unsigned int degree;
 
@@ -184,6 +220,11 @@ namespace Step22
     unsigned int plastic_iteration = 0;
     unsigned int last_max_plasticity = 0;
 
+    // Body parameters for which the gravity stored in the quadrature point
+    // history was computed, and whether the mesh has moved since then
+    std::vector<double> gravity_parameters;
+    bool gravity_is_current = false;
+
     QGauss<dim> quadrature_formula;
     std::vector< std::vector <Vector<double> > > quad_viscosities; // Indices for this object are [cell][q][q coords, eta]
     std::vector<double> cell_viscosities; // This vector is only used for output, not FE computations
@@ -194,10 +235,19 @@ namespace Step22
     BlockSparsityPattern sparsity_pattern;
     BlockSparseMatrix<double> system_matrix;
 
+    // Viscosity-weighted pressure mass matrix approximating the Schur
+    // complement, only used with use_amg_preconditioner
+    BlockSparsityPattern preconditioner_sparsity_pattern;
+    BlockSparseMatrix<double> preconditioner_matrix;
+
     BlockVector<double> solution;
     BlockVector<double> system_rhs;
 
     std::shared_ptr<typename InnerPreconditioner<dim>::type> A_preconditioner;
+#ifdef DEAL_II_WITH_TRILINOS
+    std::shared_ptr<TrilinosWrappers::PreconditionAMG> A_amg_preconditioner;
+#endif
+    std::shared_ptr<SparseILU<double> > Mp_preconditioner;
 
     ellipsoid_fit<dim>   ellipsoid;
   };
@@ -239,74 +289,6 @@ namespace Step22
       values(c) = BoundaryValuesP<dim>::value(p, c);
   }
 
-  template<int dim>
-  class RightHandSide: public Function<dim>
-  {
-  public:
-    RightHandSide () : Function<dim>(dim+1) {}
-
-    using Function<dim>::value;
-    using Function<dim>::vector_value;
-    using Function<dim>::vector_value_list;
-
-    virtual double value(const Point<dim> &p, const unsigned int component,
-                         A_Grav_namespace::AnalyticGravity<dim> *aGrav) const;
-
-    virtual void vector_value(const Point<dim> &p, Vector<double> &value,
-                              A_Grav_namespace::AnalyticGravity<dim> *aGrav) const;
-
-    virtual void vector_value_list(const std::vector<Point<dim> > &points,
-                                   std::vector<Vector<double> > &values,
-                                   A_Grav_namespace::AnalyticGravity<dim> *aGrav) const;
-
-  };
-
-  template<int dim>
-  double RightHandSide<dim>::value(const Point<dim> &p,
-                                   const unsigned int component,
-                                   A_Grav_namespace::AnalyticGravity<dim> *aGrav) const
-  {
-
-    std::vector<double> temp_vector(2);
-    aGrav->get_gravity(p, temp_vector);
-
-    if (component == 0)
-      {
-        return temp_vector[0] + system_parameters::omegasquared * p[0]; // * 1.2805;
-      }
-    else
-      {
-        if (component == 1)
-          return temp_vector[1];
-        else
-          return 0;
-      }
-  }
-
-  template<int dim>
-  void RightHandSide<dim>::vector_value(const Point<dim> &p,
-                                        Vector<double> &values,
-                                        A_Grav_namespace::AnalyticGravity<dim> *aGrav) const
-  {
-    for (unsigned int c = 0; c < this->n_components; ++c)
-      values(c) = RightHandSide<dim>::value(p, c, aGrav);
-  }
-
-  template<int dim>
-  void RightHandSide<dim>::vector_value_list(
-    const std::vector<Point<dim> > &points,
-    std::vector<Vector<double> > &values,
-    A_Grav_namespace::AnalyticGravity<dim> *aGrav) const
-  {
-    // check whether component is in
-    // the valid range is up to the
-    // derived class
-    Assert(values.size() == points.size(),
-           ExcDimensionMismatch(values.size(), points.size()));
-
-    for (unsigned int i = 0; i < points.size(); ++i)
-      this->vector_value(points[i], values[i], aGrav);
-  }
 
 // Class for linear solvers and preconditioners
 
@@ -380,6 +362,55 @@ namespace Step22
     system_matrix->block(1, 0).vmult(dst, tmp2);
   }
 
+// Class for the block triangular preconditioner
+//
+// Approximates the inverse of [A B^T; B 0] by that of [A B^T; 0 -S], where
+// preconditioner_A is a single AMG cycle for A and preconditioner_Mp a single
+// ILU application for the viscosity-weighted pressure mass matrix, which is
+// spectrally equivalent to S.
+
+  template<class PreconditionerA, class PreconditionerMp>
+  class BlockSchurPreconditioner: public Subscriptor
+  {
+  public:
+    BlockSchurPreconditioner(const BlockSparseMatrix<double> &system_matrix,
+                             const PreconditionerA &preconditioner_A,
+                             const PreconditionerMp &preconditioner_Mp);
+
+    void vmult(BlockVector<double> &dst, const BlockVector<double> &src) const;
+
+  private:
+    const SmartPointer<const BlockSparseMatrix<double> > system_matrix;
+    const PreconditionerA &preconditioner_A;
+    const PreconditionerMp &preconditioner_Mp;
+
+    mutable Vector<double> utmp;
+  };
+
+  template<class PreconditionerA, class PreconditionerMp>
+  BlockSchurPreconditioner<PreconditionerA, PreconditionerMp>::BlockSchurPreconditioner(
+    const BlockSparseMatrix<double> &system_matrix,
+    const PreconditionerA &preconditioner_A,
+    const PreconditionerMp &preconditioner_Mp) :
+    system_matrix(&system_matrix), preconditioner_A(preconditioner_A),
+    preconditioner_Mp(preconditioner_Mp), utmp(system_matrix.block(0, 0).m())
+  {
+  }
+
+  template<class PreconditionerA, class PreconditionerMp>
+  void BlockSchurPreconditioner<PreconditionerA, PreconditionerMp>::vmult(
+    BlockVector<double> &dst, const BlockVector<double> &src) const
+  {
+    preconditioner_Mp.vmult(dst.block(1), src.block(1));
+    dst.block(1) *= -1.0;
+
+    system_matrix->block(0, 1).vmult(utmp, dst.block(1));
+    utmp *= -1.0;
+    utmp += src.block(0);
+
+    preconditioner_A.vmult(dst.block(0), utmp);
+  }
+
 // StokesProblem::StokesProblem
 
   template<int dim>
@@ -399,7 +430,12 @@ namespace Step22
   void StokesProblem<dim>::setup_dofs()
   {
     A_preconditioner.reset();
+#ifdef DEAL_II_WITH_TRILINOS
+    A_amg_preconditioner.reset();
+#endif
+    Mp_preconditioner.reset();
     system_matrix.clear();
+    preconditioner_matrix.clear();
 
     dof_handler.distribute_dofs(fe);
     DoFRenumbering::Cuthill_McKee(dof_handler);
@@ -453,6 +489,27 @@ namespace Step22
 
     system_matrix.reinit(sparsity_pattern);
 
+    if (system_parameters::use_amg_preconditioner)
+      {
+        BlockDynamicSparsityPattern csp(2, 2);
+
+        csp.block(0, 0).reinit(n_u, n_u);
+        csp.block(1, 0).reinit(n_p, n_u);
+        csp.block(0, 1).reinit(n_u, n_p);
+        csp.block(1, 1).reinit(n_p, n_p);
+
+        csp.collect_sizes();
+
+        Table<2, DoFTools::Coupling> coupling(dim + 1, dim + 1);
+        for (unsigned int c = 0; c < dim + 1; ++c)
+          for (unsigned int d = 0; d < dim + 1; ++d)
+            coupling[c][d] = ((c == dim && d == dim) ? DoFTools::always : DoFTools::none);
+
+        DoFTools::make_sparsity_pattern(dof_handler, coupling, csp, constraints, false);
+        preconditioner_sparsity_pattern.copy_from(csp);
+        preconditioner_matrix.reinit(preconditioner_sparsity_pattern);
+      }
+
     solution.reinit(2);
     solution.block(0).reinit(n_u);
     solution.block(1).reinit(n_p);
@@ -680,8 +737,6 @@ namespace Step22
     std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
 
     // runs the gravity script function
-    const RightHandSide<dim> right_hand_side;
-
     A_Grav_namespace::AnalyticGravity<dim> *aGrav =
       new A_Grav_namespace::AnalyticGravity<dim>;
     std::vector<double> grav_parameters;
@@ -699,12 +754,29 @@ namespace Step22
 
     aGrav->setup_vars(grav_parameters);
 
+    // The gravity field only depends on the ellipsoid fit and the position of
+    // the quadrature points, so it is recomputed only if either changed, e.g.
+    // not between the plasticity iterations of a flow step
+    if (!gravity_is_current || grav_parameters != gravity_parameters)
+      {
+        update_quadrature_point_gravity(*aGrav);
+        gravity_parameters = grav_parameters;
+        gravity_is_current = true;
+      }
+
     std::vector<Vector<double> > rhs_values(n_q_points,
                                             Vector<double>(dim + 1));
 
     const FEValuesExtractors::Vector velocities(0);
     const FEValuesExtractors::Scalar pressure(dim);
 
+    // With the block preconditioned solver the whole system matrix is applied,
+    // so its pressure-pressure block must not contain the mass matrix used
+    // to precondition the Schur complement solve of solve(). The weighted mass
+    // matrix goes into preconditioner_matrix instead.
+    const double pressure_mass_factor = (system_parameters::use_amg_preconditioner ? 0.0 : 1.0);
+    FullMatrix<double> local_preconditioner_matrix(dofs_per_cell, dofs_per_cell);
+
     std::vector<SymmetricTensor<2, dim> > phi_grads_u(dofs_per_cell);
     std::vector<double> div_phi_u(dofs_per_cell);
     std::vector<Tensor<1, dim> > phi_u(dofs_per_cell);
@@ -738,8 +810,12 @@ namespace Step22
 
         //initializes the rhs vector to the correct g values
         fe_values.reinit(cell);
-        right_hand_side.vector_value_list(fe_values.get_quadrature_points(),
-                                          rhs_values, aGrav);
+        for (unsigned int q = 0; q < n_q_points; ++q)
+          {
+            rhs_values[q](0) = local_quadrature_points_history[q].gravity[0]
+                               + system_parameters::omegasquared * fe_values.quadrature_point(q)[0];
+            rhs_values[q](1) = local_quadrature_points_history[q].gravity[1];
+          }
 
         std::vector<Vector<double> > new_viscosities(quadrature_formula.size(), Vector<double>(dim + 1));
 
@@ -752,6 +828,7 @@ namespace Step22
         if (is_singular == false || system_parameters::cylindrical == false)
           {
             local_matrix = 0;
+            local_preconditioner_matrix = 0;
             local_rhs = 0;
 
             // ===== outputs the local gravity
@@ -833,7 +910,7 @@ namespace Step22
                                                    * system_parameters::pressure_scale
                                                    - phi_p[i] * div_phi_u[j]
                                                    * system_parameters::pressure_scale
-                                                   + phi_p[i] * phi_p[j] * r_value
+                                                   + pressure_mass_factor * phi_p[i] * phi_p[j] * r_value
                                                    * system_parameters::pressure_scale)
                                                   * fe_values.JxW(q);
                           }
@@ -845,8 +922,14 @@ namespace Step22
                                                    * system_parameters::pressure_scale
                                                    - phi_p[i] * div_phi_u[j]
                                                    * system_parameters::pressure_scale
-                                                   + phi_p[i] * phi_p[j]) * fe_values.JxW(q);
+                                                   + pressure_mass_factor * phi_p[i] * phi_p[j]) * fe_values.JxW(q);
                           }
+                        if (system_parameters::use_amg_preconditioner)
+                          local_preconditioner_matrix(i, j) += phi_p[i] * phi_p[j]
+                                                               * (system_parameters::cylindrical ? r_value : 1.0)
+                                                               * system_parameters::pressure_scale
+                                                               * system_parameters::pressure_scale
+                                                               / local_eta_ve * fe_values.JxW(q);
                       }
                     if (system_parameters::cylindrical == true)
                       {
@@ -875,6 +958,7 @@ namespace Step22
         else
           {
             local_matrix = 0;
+            local_preconditioner_matrix = 0;
             local_rhs = 0;
 
             // ===== outputs the local gravity
@@ -940,7 +1024,7 @@ namespace Step22
                                                    * system_parameters::pressure_scale
                                                    - phi_p[i] * div_phi_u[j]
                                                    * system_parameters::pressure_scale
-                                                   + phi_p[i] * phi_p[j] * r_value
+                                                   + pressure_mass_factor * phi_p[i] * phi_p[j] * r_value
                                                    * system_parameters::pressure_scale)
                                                   * fe_values.JxW(q);
                           }
@@ -952,8 +1036,14 @@ namespace Step22
                                                    * system_parameters::pressure_scale
                                                    - phi_p[i] * div_phi_u[j]
                                                    * system_parameters::pressure_scale
-                                                   + phi_p[i] * phi_p[j]) * fe_values.JxW(q);
+                                                   + pressure_mass_factor * phi_p[i] * phi_p[j]) * fe_values.JxW(q);
                           }
+                        if (system_parameters::use_amg_preconditioner)
+                          local_preconditioner_matrix(i, j) += phi_p[i] * phi_p[j]
+                                                               * (system_parameters::cylindrical ? r_value : 1.0)
+                                                               * system_parameters::pressure_scale
+                                                               * system_parameters::pressure_scale
+                                                               / local_eta_ve * fe_values.JxW(q);
                       }
                     if (system_parameters::cylindrical == true)
                       {
@@ -982,20 +1072,56 @@ namespace Step22
 
         for (unsigned int i = 0; i < dofs_per_cell; ++i)
           for (unsigned int j = i + 1; j < dofs_per_cell; ++j)
-            local_matrix(i, j) = local_matrix(j, i);
+            {
+              local_matrix(i, j) = local_matrix(j, i);
+              local_preconditioner_matrix(i, j) = local_preconditioner_matrix(j, i);
+            }
 
         cell->get_dof_indices(local_dof_indices);
         constraints.distribute_local_to_global(local_matrix, local_rhs,
                                                local_dof_indices, system_matrix, system_rhs);
+        if (system_parameters::use_amg_preconditioner)
+          constraints.distribute_local_to_global(local_preconditioner_matrix,
+                                                 local_dof_indices, preconditioner_matrix);
       }
 
     std::cout << "   Computing preconditioner..." << std::endl << std::flush;
 
-    A_preconditioner = std::shared_ptr<
-                       typename InnerPreconditioner<dim>::type>(
-                         new typename InnerPreconditioner<dim>::type());
-    A_preconditioner->initialize(system_matrix.block(0, 0),
-                                 typename InnerPreconditioner<dim>::type::AdditionalData());
+    if (system_parameters::use_amg_preconditioner)
+      {
+#ifdef DEAL_II_WITH_TRILINOS
+        // One AMG V-cycle for the velocity block, see step-31 for the
+        // choice of parameters
+        std::vector<std::vector<bool> > constant_modes;
+        const FEValuesExtractors::Vector velocity_components(0);
+        DoFTools::extract_constant_modes(dof_handler,
+                                         fe.component_mask(velocity_components),
+                                         constant_modes);
+        TrilinosWrappers::PreconditionAMG::AdditionalData amg_data;
+        amg_data.constant_modes = constant_modes;
+        amg_data.elliptic = true;
+        amg_data.higher_order_elements = true;
+        amg_data.smoother_sweeps = 2;
+        amg_data.aggregation_threshold = 0.02;
+
+        A_amg_preconditioner = std::make_shared<TrilinosWrappers::PreconditionAMG>();
+        A_amg_preconditioner->initialize(system_matrix.block(0, 0), amg_data);
+#else
+        AssertThrow(false,
+                    ExcMessage("use_amg_preconditioner requires deal.II to be configured with Trilinos."));
+#endif
+        Mp_preconditioner = std::make_shared<SparseILU<double> >();
+        Mp_preconditioner->initialize(preconditioner_matrix.block(1, 1),
+                                      SparseILU<double>::AdditionalData());
+      }
+    else
+      {
+        A_preconditioner = std::shared_ptr<
+                           typename InnerPreconditioner<dim>::type>(
+                             new typename InnerPreconditioner<dim>::type());
+        A_preconditioner->initialize(system_matrix.block(0, 0),
+                                     typename InnerPreconditioner<dim>::type::AdditionalData());
+      }
 
     delete aGrav;
   }
@@ -1005,6 +1131,12 @@ namespace Step22
   template<int dim>
   void StokesProblem<dim>::solve()
   {
+    if (system_parameters::use_amg_preconditioner)
+      {
+        solve_block_preconditioned();
+        return;
+      }
+
     const InverseMatrix<SparseMatrix<double>,
           typename InnerPreconditioner<dim>::type> A_inverse(
             system_matrix.block(0, 0), *A_preconditioner);
@@ -1058,6 +1190,45 @@ namespace Step22
     }
   }
 
+// Solves the whole saddle point system with FGMRES, preconditioned by the
+// block triangular preconditioner. Unlike solve(), there are no inner solves
+// and no factorization, so the cost per iteration grows linearly with the
+// size of the mesh.
+
+  template<int dim>
+  void StokesProblem<dim>::solve_block_preconditioned()
+  {
+#ifdef DEAL_II_WITH_TRILINOS
+    const BlockSchurPreconditioner<TrilinosWrappers::PreconditionAMG,
+          SparseILU<double> > preconditioner(system_matrix,
+                                             *A_amg_preconditioner,
+                                             *Mp_preconditioner);
+
+    const int n_iterations = system_parameters::iteration_coefficient
+                             * solution.block(1).size();
+    const double tolerance_goal = system_parameters::tolerance_coefficient
+                                  * system_rhs.l2_norm();
+
+    SolverControl solver_control(n_iterations, tolerance_goal);
+    SolverFGMRES<BlockVector<double> > solver(solver_control);
+
+    std::cout << "\nMax iterations and tolerance are:  " << n_iterations
+              << " and " << tolerance_goal << std::endl;
+
+    constraints.set_zero(solution);
+    solver.solve(system_matrix, solution, system_rhs, preconditioner);
+    constraints.distribute(solution);
+
+    std::cout << "  " << solver_control.last_step()
+              << " block preconditioned FGMRES iterations" << std::endl;
+
+    solution.block(1) *= (system_parameters::pressure_scale);
+#else
+    AssertThrow(false,
+                ExcMessage("use_amg_preconditioner requires deal.II to be configured with Trilinos."));
+#endif
+  }
+
 //====================== OUTPUT RESULTS ======================
   template<int dim>
   void StokesProblem<dim>::output_results() const
@@ -1571,80 +1742,88 @@ namespace Step22
   {
     std::cout << "   Updating stress field...";
 
-    FEValues<dim> fe_values(fe, quadrature_formula,
-                            update_values | update_gradients | update_quadrature_points);
-
-    // Make the object that will hold the velocity gradients
-    std::vector < std::vector<Tensor<1, dim> >> velocity_grads(quadrature_formula.size(),
-                                                               std::vector < Tensor<1, dim> > (dim + 1));
-    std::vector<Vector<double> > velocities(quadrature_formula.size(),
-                                            Vector<double>(dim + 1));
-
-    for (typename DoFHandler<dim>::active_cell_iterator cell =
-           dof_handler.begin_active(); cell != dof_handler.end(); ++cell)
-      {
-        PointHistory<dim> *local_quadrature_points_history =
-          reinterpret_cast<PointHistory<dim> *>(cell->user_pointer());
-        Assert(
-          local_quadrature_points_history >= &quadrature_point_history.front(),
-          ExcInternalError());
-        Assert(
-          local_quadrature_points_history < &quadrature_point_history.back(),
-          ExcInternalError());
-
-        fe_values.reinit(cell);
-        fe_values.get_function_gradients(solution, velocity_grads);
-        fe_values.get_function_values(solution, velocities);
+    // Each cell only touches its own entries of the quadrature point history,
+    // so the cells are processed concurrently and there is nothing to copy
+    // into a global object.
+    struct CopyData
+    {};
 
-        for (unsigned int q = 0; q < quadrature_formula.size(); ++q)
-          {
-            // Define the local viscoelastic constants
-            double local_eta_ve = 2
-                                  / ((1 / local_quadrature_points_history[q].new_eta)
-                                     + (1 / local_quadrature_points_history[q].G
-                                        / system_parameters::current_time_interval));
-            double local_chi_ve =
-              1
-              / (1
-                 + (local_quadrature_points_history[q].G
-                    * system_parameters::current_time_interval
-                    / local_quadrature_points_history[q].new_eta));
-
-            // Compute new stress at each quadrature point
-            SymmetricTensor<2, dim> new_stress;
-            for (unsigned int i = 0; i < dim; ++i)
-              new_stress[i][i] =
-                local_eta_ve * velocity_grads[q][i][i]
+    auto worker = [&](const typename DoFHandler<dim>::active_cell_iterator &cell,
+                      StressUpdateScratchData<dim> &scratch,
+                      CopyData &)
+    {
+      FEValues<dim> &fe_values = scratch.fe_values;
+      std::vector<std::vector<Tensor<1, dim> > > &velocity_grads = scratch.velocity_grads;
+      std::vector<Vector<double> > &velocities = scratch.velocities;
+
+      PointHistory<dim> *local_quadrature_points_history =
+        reinterpret_cast<PointHistory<dim> *>(cell->user_pointer());
+      Assert(
+        local_quadrature_points_history >= &quadrature_point_history.front(),
+        ExcInternalError());
+      Assert(
+        local_quadrature_points_history < &quadrature_point_history.back(),
+        ExcInternalError());
+
+      fe_values.reinit(cell);
+      fe_values.get_function_gradients(solution, velocity_grads);
+      fe_values.get_function_values(solution, velocities);
+
+      for (unsigned int q = 0; q < quadrature_formula.size(); ++q)
+        {
+          // Define the local viscoelastic constants
+          double local_eta_ve = 2
+                                / ((1 / local_quadrature_points_history[q].new_eta)
+                                   + (1 / local_quadrature_points_history[q].G
+                                      / system_parameters::current_time_interval));
+          double local_chi_ve =
+            1
+            / (1
+               + (local_quadrature_points_history[q].G
+                  * system_parameters::current_time_interval
+                  / local_quadrature_points_history[q].new_eta));
+
+          // Compute new stress at each quadrature point
+          SymmetricTensor<2, dim> new_stress;
+          for (unsigned int i = 0; i < dim; ++i)
+            new_stress[i][i] =
+              local_eta_ve * velocity_grads[q][i][i]
+              + local_chi_ve
+              * local_quadrature_points_history[q].old_stress[i][i];
+
+          for (unsigned int i = 0; i < dim; ++i)
+            for (unsigned int j = i + 1; j < dim; ++j)
+              new_stress[i][j] =
+                local_eta_ve
+                * (velocity_grads[q][i][j]
+                   + velocity_grads[q][j][i]) / 2
                 + local_chi_ve
-                * local_quadrature_points_history[q].old_stress[i][i];
-
-            for (unsigned int i = 0; i < dim; ++i)
-              for (unsigned int j = i + 1; j < dim; ++j)
-                new_stress[i][j] =
-                  local_eta_ve
-                  * (velocity_grads[q][i][j]
-                     + velocity_grads[q][j][i]) / 2
-                  + local_chi_ve
-                  * local_quadrature_points_history[q].old_stress[i][j];
-
-            // Rotate new stress
-            AuxFunctions<dim> rotation_object;
-            const Tensor<2, dim> rotation = rotation_object.get_rotation_matrix(
-                                              velocity_grads[q]);
-            const SymmetricTensor<2, dim> rotated_new_stress = symmetrize(
-                                                                 transpose(rotation)
-                                                                 * static_cast<Tensor<2, dim> >(new_stress)
-                                                                 * rotation);
-            local_quadrature_points_history[q].old_stress = rotated_new_stress;
-
-            // For axisymmetric case, make the phi-phi element of stress tensor
-            local_quadrature_points_history[q].old_phiphi_stress =
-              (2 * local_eta_ve * velocities[q](0)
-               / fe_values.quadrature_point(q)[0]
-               + local_chi_ve
-               * local_quadrature_points_history[q].old_phiphi_stress);
-          }
-      }
+                * local_quadrature_points_history[q].old_stress[i][j];
+
+          // Rotate new stress
+          AuxFunctions<dim> rotation_object;
+          const Tensor<2, dim> rotation = rotation_object.get_rotation_matrix(
+                                            velocity_grads[q]);
+          const SymmetricTensor<2, dim> rotated_new_stress = symmetrize(
+                                                               transpose(rotation)
+                                                               * static_cast<Tensor<2, dim> >(new_stress)
+                                                               * rotation);
+          local_quadrature_points_history[q].old_stress = rotated_new_stress;
+
+          // For axisymmetric case, make the phi-phi element of stress tensor
+          local_quadrature_points_history[q].old_phiphi_stress =
+            (2 * local_eta_ve * velocities[q](0)
+             / fe_values.quadrature_point(q)[0]
+             + local_chi_ve
+             * local_quadrature_points_history[q].old_phiphi_stress);
+        }
+    };
+
+    WorkStream::run(dof_handler.begin_active(), dof_handler.end(),
+                    worker,
+                    [](const CopyData &) {},
+                    StressUpdateScratchData<dim>(fe, quadrature_formula),
+                    CopyData());
   }
 
 //====================== REDEFINE THE TIME INTERVAL FOR THE VISCOUS STEPS ======================
@@ -1730,6 +1909,7 @@ namespace Step22
             cell->vertex(v) += vertex_displacement
                                * system_parameters::current_time_interval;
           }
+    gravity_is_current = false;
   }
 
 //====================== WRITE MESH TO FILE ======================
@@ -2010,6 +2190,7 @@ namespace Step22
     GridRefinement::refine_and_coarsen_fixed_number(triangulation,
                                                     estimated_error_per_cell, 0.3, 0.0);
     triangulation.execute_coarsening_and_refinement();
+    gravity_is_current = false;
   }
 
 //====================== SET UP THE DATA STRUCTURES TO REMEMBER STRESS FIELD ======================
@@ -2034,6 +2215,46 @@ namespace Step22
       }
 
     Assert(history_index == quadrature_point_history.size(), ExcInternalError());
+    gravity_is_current = false;
+  }
+
+//====================== COMPUTE THE GRAVITY AT ALL QUADRATURE POINTS ======================
+  template<int dim>
+  void StokesProblem<dim>::update_quadrature_point_gravity(
+    const A_Grav_namespace::AnalyticGravity<dim> &aGrav)
+  {
+    FEValues<dim> fe_values(fe, quadrature_formula, update_quadrature_points);
+    const unsigned int n_q_points = quadrature_formula.size();
+
+    // Gather the quadrature points of all cells to evaluate the gravity in a
+    // single batch
+    std::vector<Point<dim> > points;
+    points.reserve(triangulation.n_active_cells() * n_q_points);
+    for (typename DoFHandler<dim>::active_cell_iterator cell =
+           dof_handler.begin_active(); cell != dof_handler.end(); ++cell)
+      {
+        fe_values.reinit(cell);
+        points.insert(points.end(),
+                      fe_values.get_quadrature_points().begin(),
+                      fe_values.get_quadrature_points().end());
+      }
+
+    std::vector<double> g_r, g_z;
+    aGrav.get_gravity(points, g_r, g_z);
+
+    unsigned int index = 0;
+    for (typename DoFHandler<dim>::active_cell_iterator cell =
+           dof_handler.begin_active(); cell != dof_handler.end(); ++cell)
+      {
+        PointHistory<dim> *local_quadrature_points_history =
+          reinterpret_cast<PointHistory<dim> *>(cell->user_pointer());
+        for (unsigned int q = 0; q < n_q_points; ++q, ++index)
+          {
+            local_quadrature_points_history[q].gravity[0] = g_r[index];
+            local_quadrature_points_history[q].gravity[1] = g_z[index];
+          }
+      }
+    Assert(index == points.size(), ExcInternalError());
   }
 
 //====================== DOES ELASTIC STEPS ======================
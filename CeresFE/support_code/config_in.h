@@ -82,6 +82,7 @@ namespace Step22
 //solver variables
     int iteration_coefficient;
     double tolerance_coefficient;
+    bool use_amg_preconditioner;
 
 //time step variables
     double present_time;
@@ -173,6 +174,7 @@ namespace Step22
     // Solver parameters
     fout_config << "iteration_coefficient = " << system_parameters::iteration_coefficient << endl;
     fout_config << "tolerance_coefficient = " << system_parameters::tolerance_coefficient << endl;
+    fout_config << "use_amg_preconditioner = " << system_parameters::use_amg_preconditioner << endl;
 
     // Time step parameters
     fout_config << "present_time = " << system_parameters::present_time << endl;
@@ -410,6 +412,7 @@ namespace Step22
         const Setting &solve_parameters = root["solve_parameters"];
         solve_parameters.lookupValue("iteration_coefficient", system_parameters::iteration_coefficient);
         solve_parameters.lookupValue("tolerance_coefficient", system_parameters::tolerance_coefficient);
+        solve_parameters.lookupValue("use_amg_preconditioner", system_parameters::use_amg_preconditioner);
 
 
       }
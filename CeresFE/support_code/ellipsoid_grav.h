@@ -7,8 +7,10 @@
  */
 #include <math.h>
 #include <deal.II/base/point.h>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 namespace A_Grav_namespace
 {
@@ -30,8 +32,17 @@ namespace A_Grav_namespace
   public:
     void setup_vars (std::vector<double> v);
     void get_gravity (const dealii::Point<dim> &p, std::vector<double> &g);
+    // Batched version: g_r[i] and g_z[i] receive the two components of the
+    // gravity at points[i]. The loop body is free of data-dependent branches,
+    // so it is suitable for vectorization by the compiler.
+    void get_gravity (const std::vector<dealii::Point<dim> > &points,
+                      std::vector<double> &g_r,
+                      std::vector<double> &g_z) const;
 
   private:
+    void compute_gravity (const double x, const double y,
+                          double &g_r, double &g_z) const;
+
     double ecc;
     double eV;
     double ke;
@@ -46,65 +57,83 @@ namespace A_Grav_namespace
     double r11_c;
     double g_coeff;
     double g_coeff_c;
+
+    // Derived constants computed once in setup_vars
+    double sqrt_1_ecc2;
+    double sqrt_1_ecc2_c;
+    bool spherical_core;
   };
 
   template <int dim>
   void AnalyticGravity<dim>::get_gravity (const dealii::Point<dim> &p, std::vector<double> &g)
   {
-    double rsph = std::sqrt(p[0] * p[0] + p[1] * p[1]);
-    double thetasph = std::atan2(p[0], p[1]);
-    double costhetasph = std::cos(thetasph);
+    compute_gravity(p[0], p[1], g[0], g[1]);
+  }
+
+  template <int dim>
+  void AnalyticGravity<dim>::get_gravity (const std::vector<dealii::Point<dim> > &points,
+                                          std::vector<double> &g_r,
+                                          std::vector<double> &g_z) const
+  {
+    const unsigned int n_points = points.size();
+    g_r.resize(n_points);
+    g_z.resize(n_points);
+    for (unsigned int i = 0; i < n_points; ++i)
+      compute_gravity(points[i][0], points[i][1], g_r[i], g_z[i]);
+  }
+
+  // With theta = atan2(x, y), we have r cos(theta) = y, and with the
+  // eccentric anomaly e = acos(y / s) also cos(e) = y / s and
+  // sin(e) = sqrt(1 - cos(e)^2) >= 0. This avoids all trigonometric
+  // function calls but the atan2 of the non-spherical core exterior.
+  // Both the core interior and exterior contributions are computed and the
+  // relevant one is selected afterwards, rather than branching on the
+  // position.
+  template <int dim>
+  inline
+  void AnalyticGravity<dim>::compute_gravity (const double x, const double y,
+                                              double &g_r, double &g_z) const
+  {
+    const double rsph2 = x * x + y * y;
 
     //convert to elliptical coordinates for silicates
-    double stemp = std::sqrt((rsph * rsph - eV * eV + std::sqrt((rsph * rsph - eV * eV) * (rsph * rsph - eV * eV)
-                                                                + 4 * eV * eV * rsph * rsph * costhetasph *costhetasph)) / 2);
-    double vout = stemp / system_parameters::r_eq / std::sqrt(1 - ecc * ecc);
-    double eout = std::acos(rsph * costhetasph / stemp);
+    const double a = rsph2 - eV * eV;
+    const double stemp = std::sqrt((a + std::sqrt(a * a + 4 * eV * eV * y * y)) / 2);
+    const double vout = stemp / system_parameters::r_eq / sqrt_1_ecc2;
+    const double cos_eout = std::min(1.0, std::max(-1.0, y / stemp));
+    const double sin_eout = std::sqrt(1 - cos_eout * cos_eout);
 
     //convert to elliptical coordinates for core correction
-    double stemp_c = std::sqrt((rsph * rsph - eV_c * eV_c + std::sqrt((rsph * rsph - eV_c * eV_c) * (rsph * rsph - eV_c * eV_c)
-                                + 4 * eV_c * eV_c * rsph * rsph * costhetasph *costhetasph)) / 2);
-    double vout_c = stemp_c / system_parameters::r_core_eq / std::sqrt(1 - ecc_c * ecc_c);
-    double eout_c = std::acos(rsph * costhetasph / stemp_c);
+    const double a_c = rsph2 - eV_c * eV_c;
+    const double stemp_c = std::sqrt((a_c + std::sqrt(a_c * a_c + 4 * eV_c * eV_c * y * y)) / 2);
+    const double vout_c = stemp_c / system_parameters::r_core_eq / sqrt_1_ecc2_c;
+    const double cos_eout_c = std::min(1.0, std::max(-1.0, y / stemp_c));
+    const double sin_eout_c = std::sqrt(1 - cos_eout_c * cos_eout_c);
 
     //shell contribution
-    g[0] = g_coeff * r11 * std::sqrt((1 - ecc * ecc) * vout * vout + ecc * ecc) * std::sin(eout);
-    g[1] = g_coeff * r01 * vout * std::cos(eout) / std::sqrt(1 - ecc * ecc);
-
-    //core contribution
-    double expected_y = system_parameters::r_core_polar * std::sqrt(1 -
-                        (p[0] * p[0] / system_parameters::r_core_eq / system_parameters::r_core_eq));
-
-
-    if (p[1] <= expected_y)
-      {
-        g[0] += g_coeff_c * r11_c * std::sqrt((1 - ecc_c * ecc_c) * vout_c * vout_c + ecc_c * ecc_c) * std::sin(eout_c);
-        g[1] += g_coeff_c * r01_c * vout_c * std::cos(eout_c) / std::sqrt(1 - ecc_c * ecc_c);
-      }
-    else
-      {
-        double g_coeff_co = - 2.795007963255562e-10 * system_parameters::excess_rho * system_parameters::r_core_eq
-                            / vout_c / vout_c;
-        double r00_co = 0;
-        double r01_co = 0;
-        double r11_co = 0;
-
-        if (system_parameters::r_core_polar == system_parameters::r_core_eq)
-          {
-            r00_co = 1;
-            r01_co = 1;
-            r11_co = 1;
-          }
-        else
-          {
-            r00_co = ke_c * vout_c * std::atan2(1, ke_c * vout_c);
-            double ke_co2 = ke_c * ke_c * vout_c * vout_c;
-            r01_co = 3 * ke_co2 * (1 - r00_co);
-            r11_co = 3 * ((ke_co2 + 1) * r00_co - ke_co2) / 2;
-          }
-        g[0] += g_coeff_co * vout_c * r11_co / std::sqrt((1 - ecc_c* ecc_c) * vout_c * vout_c + ecc_c * ecc_c) * std::sin(eout_c);
-        g[1] += g_coeff_co * r01_co * std::cos(eout_c) / std::sqrt(1 - ecc_c * ecc_c);
-      }
+    const double g_r_shell = g_coeff * r11 * std::sqrt((1 - ecc * ecc) * vout * vout + ecc * ecc) * sin_eout;
+    const double g_z_shell = g_coeff * r01 * vout * cos_eout / sqrt_1_ecc2;
+
+    //core contribution, for points inside the core
+    const double root_c = std::sqrt((1 - ecc_c * ecc_c) * vout_c * vout_c + ecc_c * ecc_c);
+    const double g_r_inside = g_coeff_c * r11_c * root_c * sin_eout_c;
+    const double g_z_inside = g_coeff_c * r01_c * vout_c * cos_eout_c / sqrt_1_ecc2_c;
+
+    //core contribution, for points outside the core
+    const double g_coeff_co = g_coeff_c / vout_c / vout_c;
+    const double kv = ke_c * vout_c;
+    const double r00_co = (spherical_core ? 1. : kv * std::atan2(1, kv));
+    const double r01_co = (spherical_core ? 1. : 3 * kv * kv * (1 - r00_co));
+    const double r11_co = (spherical_core ? 1. : 3 * ((kv * kv + 1) * r00_co - kv * kv) / 2);
+    const double g_r_outside = g_coeff_co * vout_c * r11_co / root_c * sin_eout_c;
+    const double g_z_outside = g_coeff_co * r01_co * cos_eout_c / sqrt_1_ecc2_c;
+
+    const double expected_y = system_parameters::r_core_polar * std::sqrt(1 -
+                              (x * x / system_parameters::r_core_eq / system_parameters::r_core_eq));
+    const bool inside_core = (y <= expected_y);
+
+    g_r = g_r_shell + (inside_core ? g_r_inside : g_r_outside);
+    g_z = g_z_shell + (inside_core ? g_z_inside : g_z_outside);
   }
 
   template <int dim>
@@ -138,6 +167,7 @@ namespace A_Grav_namespace
     r01 = 3 * ke2 * (1 - r00);
     r11 = 3 * ((ke2 + 1) * r00 - ke2) / 2;
     g_coeff = - 2.795007963255562e-10 * system_parameters::mantle_rho * system_parameters::r_eq;
+    sqrt_1_ecc2 = std::sqrt(1 - ecc * ecc);
 
     // Core
     if (system_parameters::r_core_polar > system_parameters::r_core_eq)
@@ -150,7 +180,9 @@ namespace A_Grav_namespace
         ecc_c = std::sqrt(1 - (system_parameters::r_core_polar * system_parameters::r_core_polar / system_parameters::r_core_eq / system_parameters::r_core_eq));
       }
     eV_c = ecc_c * system_parameters::r_core_eq;
-    if (system_parameters::r_core_polar == system_parameters::r_core_eq)
+    sqrt_1_ecc2_c = std::sqrt(1 - ecc_c * ecc_c);
+    spherical_core = (system_parameters::r_core_polar == system_parameters::r_core_eq);
+    if (spherical_core)
       {
         ke_c = 1;
         r00_c = 1;
@@ -52,6 +52,25 @@
 #include <deal.II/lac/trilinos_sparse_matrix.h>
 #include <deal.II/lac/trilinos_vector.h>
 #include <deal.II/lac/trilinos_solver.h>
+#include <deal.II/lac/trilinos_precondition.h>
+
+// For the iterative solver we also need GMRES and the sparsity pattern
+// class used to extract blocks of the system matrix.
+#include <deal.II/lac/solver_gmres.h>
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+
+// These are the files for the matrix-free implementation of the
+// LDG operator.
+#include <deal.II/base/vectorization.h>
+#include <deal.II/lac/la_parallel_vector.h>
+#include <deal.II/fe/mapping_q1.h>
+#include <deal.II/matrix_free/matrix_free.h>
+#include <deal.II/matrix_free/fe_evaluation.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
 
 
 // The functions class contains all the defintions of the functions we
@@ -62,6 +81,452 @@
 using namespace dealii;
 
 
+// @sect3{The block triangular preconditioner}
+// Since the dofs are numbered component wise, the system matrix has
+// the block structure
+//
+// $ \left[\begin{matrix} M & B \\ C & D \end{matrix}\right] $
+//
+// where $M$ is the mass matrix of the vector field, which only couples
+// dofs of the same cell. Its inverse is therefore cheap to compute, and
+// so is the Schur complement $S = D - C M^{-1} B$ for the scalar
+// unknown.  The class below applies the inverse of the upper block
+// triangular matrix
+//
+// $ P = \left[\begin{matrix} M & B \\ 0 & S \end{matrix}\right] $
+//
+// where the inverse of $S$ is replaced by one V-cycle
+// of algebraic multigrid. With the exact inverse of $S$, GMRES would
+// converge in two iterations; with the AMG approximation the number of
+// iterations stays almost constant under mesh refinement.
+//
+// The vector field dofs of all processors come before the scalar dofs,
+// so on each processor the locally owned vector field entries of a
+// vector are stored before the locally owned scalar entries. This is
+// what lets us split and merge the vectors below by copying the local
+// parts.
+class BlockTriangularPreconditioner
+{
+public:
+  BlockTriangularPreconditioner(
+    const TrilinosWrappers::SparseMatrix    &field_potential_matrix,
+    const TrilinosWrappers::SparseMatrix    &inverse_field_mass_matrix,
+    const TrilinosWrappers::PreconditionAMG &schur_complement_preconditioner,
+    const IndexSet                          &owned_field_dofs,
+    const IndexSet                          &owned_potential_dofs);
+
+  void vmult(TrilinosWrappers::MPI::Vector       &dst,
+             const TrilinosWrappers::MPI::Vector &src) const;
+
+private:
+  const TrilinosWrappers::SparseMatrix    &field_potential_matrix;
+  const TrilinosWrappers::SparseMatrix    &inverse_field_mass_matrix;
+  const TrilinosWrappers::PreconditionAMG &schur_complement_preconditioner;
+
+  mutable TrilinosWrappers::MPI::Vector   src_field;
+  mutable TrilinosWrappers::MPI::Vector   src_potential;
+  mutable TrilinosWrappers::MPI::Vector   dst_field;
+  mutable TrilinosWrappers::MPI::Vector   dst_potential;
+};
+
+
+BlockTriangularPreconditioner::
+BlockTriangularPreconditioner(
+  const TrilinosWrappers::SparseMatrix    &field_potential_matrix,
+  const TrilinosWrappers::SparseMatrix    &inverse_field_mass_matrix,
+  const TrilinosWrappers::PreconditionAMG &schur_complement_preconditioner,
+  const IndexSet                          &owned_field_dofs,
+  const IndexSet                          &owned_potential_dofs)
+  :
+  field_potential_matrix(field_potential_matrix),
+  inverse_field_mass_matrix(inverse_field_mass_matrix),
+  schur_complement_preconditioner(schur_complement_preconditioner),
+  src_field(owned_field_dofs, MPI_COMM_WORLD),
+  src_potential(owned_potential_dofs, MPI_COMM_WORLD),
+  dst_field(owned_field_dofs, MPI_COMM_WORLD),
+  dst_potential(owned_potential_dofs, MPI_COMM_WORLD)
+{}
+
+
+void
+BlockTriangularPreconditioner::
+vmult(TrilinosWrappers::MPI::Vector       &dst,
+      const TrilinosWrappers::MPI::Vector &src) const
+{
+  const unsigned int n_owned_field = src_field.locally_owned_size();
+  Assert(src.locally_owned_size() ==
+         n_owned_field + src_potential.locally_owned_size(),
+         ExcInternalError());
+
+  // All vectors here use the component-wise numbering of the system, in
+  // which the locally owned flux dofs of this processor precede its
+  // locally owned scalar dofs, and the block vectors are indexed by views
+  // of these two ranges. Since the locally owned entries are stored in the
+  // order of their global indices, the two blocks are consecutive pieces
+  // of the locally owned part of the full vector.
+  std::copy(src.begin(), src.begin() + n_owned_field, src_field.begin());
+  std::copy(src.begin() + n_owned_field, src.end(), src_potential.begin());
+
+  // First the scalar unknown, $y_u = S^{-1} r_u$,
+  schur_complement_preconditioner.vmult(dst_potential, src_potential);
+
+  // and then the vector field, $y_q = M^{-1} (r_q - B y_u)$.
+  field_potential_matrix.vmult(dst_field, dst_potential);
+  src_field.add(-1.0, dst_field);
+  inverse_field_mass_matrix.vmult(dst_field, src_field);
+
+  std::copy(dst_field.begin(), dst_field.end(), dst.begin());
+  std::copy(dst_potential.begin(), dst_potential.end(),
+            dst.begin() + n_owned_field);
+}
+
+
+// @sect3{The matrix-free LDG operator}
+// The sparse matrix of the LDG method couples every cell to all of
+// its face neighbors with dense blocks of size <code>dofs_per_cell</code>
+// in both variables, so its memory grows quickly with the polynomial
+// degree. The class below applies the same operator without storing
+// a matrix, in the way of step-59 and step-67: the cell and face
+// integrals are evaluated with sum factorization by FEEvaluation and
+// FEFaceEvaluation, for several cells or faces at once in the lanes of
+// a VectorizedArray. Only the geometry and one penalty factor per face
+// are stored, which is proportional to the number of dofs.
+//
+// The integrals are exactly those of <code>assemble_cell_terms</code>,
+// <code>assemble_flux_terms</code> and the boundary terms, but
+// written in terms of fluxes. On an interior face with unit normal
+// $\textbf{n}^{-}$ pointing out of the cell on the "minus" side, the
+// test functions on that side see
+//
+// $\textbf{w}^{-} \cdot \left( \frac{1}{2} \textbf{n}^{-} (u^{-} + u^{+})
+//   + \boldsymbol \beta (u^{-} - u^{+}) \right)
+//   + w^{-} \left( \frac{1}{2} \textbf{n}^{-} \cdot (\textbf{q}^{-} + \textbf{q}^{+})
+//   - \boldsymbol \beta \cdot (\textbf{q}^{-} - \textbf{q}^{+})
+//   + \sigma (u^{-} - u^{+}) \right)$
+//
+// and the test functions on the "plus" side see the same fluxes with
+// the opposite sign. The terms with $\boldsymbol \beta$ change their
+// sign with the choice of the "minus" side, though. In
+// <code>assemble_system</code> the "minus" side is the coarser of
+// the two cells, or the one with the lower CellId if both are on the
+// same level, while the MatrixFree framework makes its own choice. We
+// therefore store $\pm \boldsymbol \beta$ for every face, so that
+// both implementations give the same operator.
+template <int dim>
+class LDGOperator
+{
+public:
+  using VectorType = LinearAlgebra::distributed::Vector<double>;
+
+  void reinit(const DoFHandler<dim>           &dof_handler,
+              const AffineConstraints<double> &constraints,
+              const double                     penalty,
+              const types::boundary_id         Dirichlet_id,
+              const types::boundary_id         Neumann_id);
+
+  void initialize_dof_vector(VectorType &vector) const;
+
+  void vmult(VectorType &dst, const VectorType &src) const;
+
+  std::size_t memory_consumption() const;
+
+private:
+  void local_apply_cell(
+    const MatrixFree<dim, double>               &data,
+    VectorType                                  &dst,
+    const VectorType                            &src,
+    const std::pair<unsigned int, unsigned int> &cell_range) const;
+
+  void local_apply_face(
+    const MatrixFree<dim, double>               &data,
+    VectorType                                  &dst,
+    const VectorType                            &src,
+    const std::pair<unsigned int, unsigned int> &face_range) const;
+
+  void local_apply_boundary(
+    const MatrixFree<dim, double>               &data,
+    VectorType                                  &dst,
+    const VectorType                            &src,
+    const std::pair<unsigned int, unsigned int> &face_range) const;
+
+  MatrixFree<dim, double> matrix_free;
+
+  types::boundary_id Dirichlet_id;
+  types::boundary_id Neumann_id;
+
+  // The penalty $\sigma = \tilde{\sigma}/h$ of each inner and boundary
+  // face batch, where $h$ is the smallest diameter of the cells
+  // adjacent to the face, as in <code>assemble_system</code>.
+  AlignedVector<VectorizedArray<double>> face_penalty;
+
+  // The vector $\boldsymbol \beta$ of the alternating fluxes of each
+  // inner face batch, oriented as in <code>assemble_system</code>.
+  AlignedVector<Tensor<1, dim, VectorizedArray<double>>> face_beta;
+};
+
+
+template <int dim>
+void
+LDGOperator<dim>::
+reinit(const DoFHandler<dim>           &dof_handler,
+       const AffineConstraints<double> &constraints,
+       const double                     penalty,
+       const types::boundary_id         Dirichlet_id,
+       const types::boundary_id         Neumann_id)
+{
+  this->Dirichlet_id = Dirichlet_id;
+  this->Neumann_id   = Neumann_id;
+
+  typename MatrixFree<dim, double>::AdditionalData additional_data;
+  additional_data.tasks_parallel_scheme =
+    MatrixFree<dim, double>::AdditionalData::none;
+  additional_data.mapping_update_flags = update_gradients
+                                         | update_JxW_values;
+  additional_data.mapping_update_flags_inner_faces = update_values
+                                                     | update_normal_vectors
+                                                     | update_JxW_values;
+  additional_data.mapping_update_flags_boundary_faces = update_values
+                                                        | update_normal_vectors
+                                                        | update_JxW_values;
+
+  // The same quadrature rule as the one used for assembling the matrix
+  matrix_free.reinit(MappingQ1<dim>(),
+                     dof_handler,
+                     constraints,
+                     QGauss<1>(dof_handler.get_fe().degree+1),
+                     additional_data);
+
+  const unsigned int n_face_batches = matrix_free.n_inner_face_batches() +
+                                      matrix_free.n_boundary_face_batches();
+  face_penalty.resize(n_face_batches);
+  face_beta.resize(matrix_free.n_inner_face_batches());
+  for (unsigned int face=0; face<n_face_batches; ++face)
+    {
+      face_penalty[face] = 1.0;
+      for (unsigned int v=0;
+           v<matrix_free.n_active_entries_per_face_batch(face);
+           ++v)
+        {
+          const auto cell_minus =
+            matrix_free.get_face_iterator(face, v, true).first;
+          if (face < matrix_free.n_inner_face_batches())
+            {
+              const auto cell_plus =
+                matrix_free.get_face_iterator(face, v, false).first;
+              face_penalty[face][v] = penalty / std::min(cell_minus->diameter(),
+                                                         cell_plus->diameter());
+
+              const bool same_orientation =
+                (cell_minus->level() < cell_plus->level()) ||
+                (cell_minus->level() == cell_plus->level() &&
+                 cell_minus->id() < cell_plus->id());
+              for (unsigned int d=0; d<dim; ++d)
+                face_beta[face][d][v] = (same_orientation ? 1.0 : -1.0) /
+                                        std::sqrt(static_cast<double>(dim));
+            }
+          else
+            face_penalty[face][v] = penalty / cell_minus->diameter();
+        }
+    }
+}
+
+
+template <int dim>
+void
+LDGOperator<dim>::
+initialize_dof_vector(VectorType &vector) const
+{
+  matrix_free.initialize_dof_vector(vector);
+}
+
+
+template <int dim>
+std::size_t
+LDGOperator<dim>::
+memory_consumption() const
+{
+  return matrix_free.memory_consumption() +
+         MemoryConsumption::memory_consumption(face_penalty) +
+         MemoryConsumption::memory_consumption(face_beta);
+}
+
+
+// The cell integrals are
+//
+// $\int_{\Omega_{e}} \left(\textbf{w} \cdot \textbf{q}
+//              - \nabla \cdot \textbf{w} u
+//              - \nabla w \cdot \textbf{q}
+//              \right) dx $
+//
+// The divergence of the vector test function is tested by submitting
+// $-u$ on the diagonal of the gradient of the vector field components.
+template <int dim>
+void
+LDGOperator<dim>::
+local_apply_cell(
+  const MatrixFree<dim, double>               &data,
+  VectorType                                  &dst,
+  const VectorType                            &src,
+  const std::pair<unsigned int, unsigned int> &cell_range) const
+{
+  FEEvaluation<dim, -1, 0, dim+1, double> phi(data);
+
+  for (unsigned int cell=cell_range.first; cell<cell_range.second; ++cell)
+    {
+      phi.reinit(cell);
+      phi.gather_evaluate(src,
+                          EvaluationFlags::values);
+
+      for (unsigned int q=0; q<phi.n_q_points; ++q)
+        {
+          const auto value = phi.get_value(q);
+
+          Tensor<1, dim+1, VectorizedArray<double>>                 value_flux;
+          Tensor<1, dim+1, Tensor<1, dim, VectorizedArray<double>>> gradient_flux;
+          for (unsigned int d=0; d<dim; ++d)
+            {
+              value_flux[d]       = value[d];
+              gradient_flux[d][d] = -value[dim];
+              gradient_flux[dim][d] = -value[d];
+            }
+
+          phi.submit_value(value_flux, q);
+          phi.submit_gradient(gradient_flux, q);
+        }
+
+      phi.integrate_scatter(EvaluationFlags::values |
+                            EvaluationFlags::gradients,
+                            dst);
+    }
+}
+
+
+// The interior face integrals of <code>assemble_flux_terms</code>, with
+// the fluxes written out in the introduction to this class.
+template <int dim>
+void
+LDGOperator<dim>::
+local_apply_face(
+  const MatrixFree<dim, double>               &data,
+  VectorType                                  &dst,
+  const VectorType                            &src,
+  const std::pair<unsigned int, unsigned int> &face_range) const
+{
+  FEFaceEvaluation<dim, -1, 0, dim+1, double> phi_minus(data, true);
+  FEFaceEvaluation<dim, -1, 0, dim+1, double> phi_plus(data, false);
+
+  for (unsigned int face=face_range.first; face<face_range.second; ++face)
+    {
+      phi_minus.reinit(face);
+      phi_minus.gather_evaluate(src, EvaluationFlags::values);
+      phi_plus.reinit(face);
+      phi_plus.gather_evaluate(src, EvaluationFlags::values);
+
+      const VectorizedArray<double>                sigma = face_penalty[face];
+      const Tensor<1, dim, VectorizedArray<double>> beta  = face_beta[face];
+
+      for (unsigned int q=0; q<phi_minus.n_q_points; ++q)
+        {
+          const auto normal      = phi_minus.get_normal_vector(q);
+          const auto value_minus = phi_minus.get_value(q);
+          const auto value_plus  = phi_plus.get_value(q);
+
+          const VectorizedArray<double> u_average = 0.5 * (value_minus[dim] +
+                                                           value_plus[dim]);
+          const VectorizedArray<double> u_jump    = value_minus[dim] -
+                                                    value_plus[dim];
+
+          Tensor<1, dim+1, VectorizedArray<double>> flux;
+          flux[dim] = sigma * u_jump;
+          for (unsigned int d=0; d<dim; ++d)
+            {
+              flux[d]    = normal[d] * u_average + beta[d] * u_jump;
+              flux[dim] += 0.5 * normal[d] * (value_minus[d] + value_plus[d])
+                           - beta[d] * (value_minus[d] - value_plus[d]);
+            }
+
+          phi_minus.submit_value(flux, q);
+          phi_plus.submit_value(-flux, q);
+        }
+
+      phi_minus.integrate_scatter(EvaluationFlags::values, dst);
+      phi_plus.integrate_scatter(EvaluationFlags::values, dst);
+    }
+}
+
+
+// And the homogeneous part of the boundary terms: on the Dirichlet
+// boundary
+// $\int_{\text{face}} w \, ( \textbf{n} \cdot \textbf{q} + \sigma u)  ds $
+// and on the Neumann boundary
+// $\int_{\text{face}} \textbf{w}  \cdot \textbf{n} \, u \, ds $.
+// The boundary data only enters the right hand side, which is still
+// assembled by <code>assemble_system</code>.
+template <int dim>
+void
+LDGOperator<dim>::
+local_apply_boundary(
+  const MatrixFree<dim, double>               &data,
+  VectorType                                  &dst,
+  const VectorType                            &src,
+  const std::pair<unsigned int, unsigned int> &face_range) const
+{
+  FEFaceEvaluation<dim, -1, 0, dim+1, double> phi(data, true);
+
+  for (unsigned int face=face_range.first; face<face_range.second; ++face)
+    {
+      phi.reinit(face);
+      phi.gather_evaluate(src, EvaluationFlags::values);
+
+      const types::boundary_id      boundary_id = data.get_boundary_id(face);
+      const VectorizedArray<double> sigma       = face_penalty[face];
+
+      Assert(boundary_id == Dirichlet_id || boundary_id == Neumann_id,
+             ExcNotImplemented());
+
+      for (unsigned int q=0; q<phi.n_q_points; ++q)
+        {
+          const auto normal = phi.get_normal_vector(q);
+          const auto value  = phi.get_value(q);
+
+          Tensor<1, dim+1, VectorizedArray<double>> flux;
+          if (boundary_id == Dirichlet_id)
+            {
+              flux[dim] = sigma * value[dim];
+              for (unsigned int d=0; d<dim; ++d)
+                flux[dim] += normal[d] * value[d];
+            }
+          else
+            {
+              for (unsigned int d=0; d<dim; ++d)
+                flux[d] = normal[d] * value[dim];
+            }
+
+          phi.submit_value(flux, q);
+        }
+
+      phi.integrate_scatter(EvaluationFlags::values, dst);
+    }
+}
+
+
+template <int dim>
+void
+LDGOperator<dim>::
+vmult(VectorType &dst, const VectorType &src) const
+{
+  matrix_free.loop(&LDGOperator::local_apply_cell,
+                   &LDGOperator::local_apply_face,
+                   &LDGOperator::local_apply_boundary,
+                   this,
+                   dst,
+                   src,
+                   true,
+                   MatrixFree<dim, double>::DataAccessOnFaces::values,
+                   MatrixFree<dim, double>::DataAccessOnFaces::values);
+}
+
+
 // Here is the main class for the Local Discontinuous Galerkin method
 // applied to Poisson's equation, we won't explain much of the
 // the class and method declarations, but dive deeper into describing the
@@ -73,8 +538,19 @@ class LDGPoissonProblem
 {
 
 public:
+  // The linear system can either be solved with the direct solver
+  // of Trilinos, or with GMRES and the block triangular preconditioner
+  // defined above.
+  enum SolverType
+  {
+    direct,
+    block_preconditioned_gmres
+  };
+
   LDGPoissonProblem(const unsigned int degree,
-                    const unsigned int n_refine);
+                    const unsigned int n_refine,
+                    const SolverType   solver_type = direct,
+                    const bool         compare_matrix_free = false);
 
   ~LDGPoissonProblem();
 
@@ -117,12 +593,24 @@ private:
     const std::vector<types::global_dof_index> &local_dof_indices,
     const std::vector<types::global_dof_index> &local_neighbor_dof_indices);
 
+  void extract_block(const IndexSet                 &row_dofs,
+                     const IndexSet                 &column_dofs,
+                     TrilinosWrappers::SparseMatrix &block) const;
+
+  void setup_block_preconditioner();
+
+  void compare_operator_application();
+
   void solve();
 
   void output_results() const;
 
+  void write_benchmark_data() const;
+
   const unsigned int degree;
   const unsigned int n_refine;
+  const SolverType   solver_type;
+  const bool         compare_matrix_free;
   double penalty;
   double h_max;
   double h_min;
@@ -137,6 +625,13 @@ private:
   FESystem<dim>                                   fe;
   DoFHandler<dim>                                 dof_handler;
 
+  IndexSet                                        locally_owned_dofs;
+  IndexSet                                        locally_relevant_dofs;
+  IndexSet                                        field_dofs;
+  IndexSet                                        potential_dofs;
+  IndexSet                                        owned_field_dofs;
+  IndexSet                                        owned_potential_dofs;
+
   AffineConstraints<double>                       constraints;
 
   SparsityPattern                                 sparsity_pattern;
@@ -150,6 +645,12 @@ private:
 
   SolverControl                                   solver_control;
   TrilinosWrappers::SolverDirect                  solver;
+  unsigned int                                    n_solver_iterations;
+
+  // The blocks needed to apply the block triangular preconditioner
+  TrilinosWrappers::SparseMatrix                  field_potential_matrix;
+  TrilinosWrappers::SparseMatrix                  inverse_field_mass_matrix;
+  TrilinosWrappers::PreconditionAMG               schur_complement_preconditioner;
 
   const RightHandSide<dim>              rhs_function;
   const DirichletBoundaryValues<dim>    Dirichlet_bc_function;
@@ -169,14 +670,16 @@ private:
 // of the form,
 //
 // <code>
-// fe( FESystem<dim>(FE_DGQ<dim>(degree), dim),        1,
-//       FE_DGQ<dim>(degree),                          1)
+// fe( FE_DGQ<dim>(degree), dim+1)
 // </code>
 //
 // which tells us that the basis functions contain discontinous polynomials
 // of order <code>degree</code> in each of the <code>dim</code> dimensions
-// for the vector field.  For the scalar unknown we
-// use a discontinuous polynomial of the order <code>degree</code>.
+// for the vector field, which are the first <code>dim</code> components.
+// For the scalar unknown, the last component, we
+// use a discontinuous polynomial of the order <code>degree</code>. Since
+// all components use the same element, this is also the form of an
+// FESystem that the matrix-free operator below works with.
 // The LDG method for Poisson equations solves for both the primary variable
 // as well as its gradient, just like the mixed finite element method.
 // However, unlike the mixed method, the LDG method uses discontinuous
@@ -186,16 +689,19 @@ private:
 template <int dim>
 LDGPoissonProblem<dim>::
 LDGPoissonProblem(const unsigned int degree,
-                  const unsigned int n_refine)
+                  const unsigned int n_refine,
+                  const SolverType   solver_type,
+                  const bool         compare_matrix_free)
   :
   degree(degree),
   n_refine(n_refine),
+  solver_type(solver_type),
+  compare_matrix_free(compare_matrix_free),
   triangulation(MPI_COMM_WORLD,
                 typename Triangulation<dim>::MeshSmoothing
                 (Triangulation<dim>::smoothing_on_refinement |
                  Triangulation<dim>::smoothing_on_coarsening)),
-  fe( FESystem<dim>(FE_DGQ<dim>(degree), dim),        1,
-      FE_DGQ<dim>(degree),                             1),
+  fe( FE_DGQ<dim>(degree), dim+1),
   dof_handler(triangulation),
   pcout(std::cout,
         Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0),
@@ -205,6 +711,7 @@ LDGPoissonProblem(const unsigned int degree,
                   TimerOutput::wall_times),
   solver_control(1),
   solver(solver_control),
+  n_solver_iterations(0),
   rhs_function(),
   Dirichlet_bc_function()
 {
@@ -320,13 +827,12 @@ make_dofs()
   // Now we get the locally owned dofs, that is the dofs that our local
   // to this processor. These dofs corresponding entries in the
   // matrix and vectors that we will write to.
-  IndexSet locally_owned_dofs = dof_handler.locally_owned_dofs();
+  locally_owned_dofs = dof_handler.locally_owned_dofs();
 
   // In additon to the locally owned dofs, we also need the the locally
   // relevant dofs.  These are the dofs that have read access to and we
   // need in order to do computations on our processor, but, that
   // we do not have the ability to write to.
-  IndexSet locally_relevant_dofs;
   DoFTools::extract_locally_relevant_dofs(dof_handler,
                                           locally_relevant_dofs);
 
@@ -402,6 +908,28 @@ make_dofs()
   const unsigned int n_vector_field = dim * dofs_per_component[0];
   const unsigned int n_potential = dofs_per_component[dim];
 
+  // The component wise numbering puts the dofs of the vector field on
+  // all processors before the dofs of the scalar unknown, so that the
+  // two blocks of the system are contiguous ranges of dofs.
+  field_dofs.clear();
+  field_dofs.set_size(dof_handler.n_dofs());
+  field_dofs.add_range(0, n_vector_field);
+  potential_dofs.clear();
+  potential_dofs.set_size(dof_handler.n_dofs());
+  potential_dofs.add_range(n_vector_field, dof_handler.n_dofs());
+
+  // The blocks themselves are numbered from zero, since Trilinos needs
+  // contiguous maps starting at zero for the matrices and vectors of the
+  // preconditioner. The locally owned dofs of each block are therefore
+  // views of the corresponding ranges.
+  owned_field_dofs     = locally_owned_dofs.get_view(0, n_vector_field);
+  owned_potential_dofs = locally_owned_dofs.get_view(n_vector_field,
+                                                     dof_handler.n_dofs());
+
+  pcout << "Number of MPI processes: "
+        << Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD)
+        << std::endl;
+
   pcout << "Number of active cells : "
         << triangulation.n_global_active_cells()
         << std::endl
@@ -1315,6 +1843,173 @@ distribute_local_flux_to_global(
 
 
 
+// @sect4{extract_block}
+// The block triangular preconditioner needs the blocks of the system
+// matrix as matrices of their own. This function copies the entries of
+// the locally owned rows in <code>row_dofs</code> and the columns in
+// <code>column_dofs</code> into <code>block</code>. Both sets are
+// contiguous ranges of dofs, and the rows and columns of the block are
+// numbered from zero within them.
+template<int dim>
+void
+LDGPoissonProblem<dim>::
+extract_block(const IndexSet                 &row_dofs,
+              const IndexSet                 &column_dofs,
+              TrilinosWrappers::SparseMatrix &block) const
+{
+  Assert(row_dofs.is_contiguous() && column_dofs.is_contiguous(),
+         ExcInternalError());
+  const types::global_dof_index row_offset    = row_dofs.nth_index_in_set(0);
+  const types::global_dof_index column_offset = column_dofs.nth_index_in_set(0);
+
+  const IndexSet owned_rows = locally_owned_dofs & row_dofs;
+  const IndexSet owned_block_rows =
+    locally_owned_dofs.get_view(row_offset,
+                                row_offset + row_dofs.n_elements());
+  const IndexSet owned_block_columns =
+    locally_owned_dofs.get_view(column_offset,
+                                column_offset + column_dofs.n_elements());
+
+  DynamicSparsityPattern dsp(row_dofs.n_elements(),
+                             column_dofs.n_elements(),
+                             owned_block_rows);
+  for (const auto row : owned_rows)
+    for (auto entry = system_matrix.begin(row);
+         entry != system_matrix.end(row);
+         ++entry)
+      if (column_dofs.is_element(entry->column()))
+        dsp.add(row - row_offset, entry->column() - column_offset);
+
+  block.reinit(owned_block_rows,
+               owned_block_columns,
+               dsp,
+               MPI_COMM_WORLD);
+
+  for (const auto row : owned_rows)
+    for (auto entry = system_matrix.begin(row);
+         entry != system_matrix.end(row);
+         ++entry)
+      if (column_dofs.is_element(entry->column()))
+        block.set(row - row_offset,
+                  entry->column() - column_offset,
+                  entry->value());
+
+  block.compress(VectorOperation::insert);
+}
+
+
+// @sect4{setup_block_preconditioner}
+// Here we build the pieces of the block triangular preconditioner.
+// The inverse of the mass matrix of the vector field is computed cell
+// by cell, since the LDG method only has solid integrals in this block.
+// With it, the Schur complement $S = D - C M^{-1} B$ can be formed
+// with two sparse matrix-matrix products; its sparsity pattern is the
+// one of the scalar unknown coupled to its neighbors and their neighbors.
+// The Schur complement is a discretization of the Laplace
+// operator for the scalar unknown, which is what algebraic multigrid is
+// designed for.
+template<int dim>
+void
+LDGPoissonProblem<dim>::
+setup_block_preconditioner()
+{
+  TimerOutput::Scope t(computing_timer, "preconditioner setup");
+
+  const unsigned int dofs_per_cell = fe.dofs_per_cell;
+
+  std::vector<unsigned int> field_cell_dofs;
+  for (unsigned int i=0; i<dofs_per_cell; ++i)
+    if (fe.system_to_component_index(i).first < dim)
+      field_cell_dofs.push_back(i);
+  const unsigned int n_field_cell_dofs = field_cell_dofs.size();
+
+  std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+  std::vector<types::global_dof_index> local_field_dof_indices(n_field_cell_dofs);
+
+  // The vector field dofs are the first block, so their global indices
+  // are also their indices in the block.
+  {
+    DynamicSparsityPattern dsp(field_dofs.n_elements(),
+                               field_dofs.n_elements(),
+                               owned_field_dofs);
+    for (const auto &cell : dof_handler.active_cell_iterators())
+      if (cell->is_locally_owned())
+        {
+          cell->get_dof_indices(local_dof_indices);
+          for (unsigned int i=0; i<n_field_cell_dofs; ++i)
+            local_field_dof_indices[i] = local_dof_indices[field_cell_dofs[i]];
+          for (const auto row : local_field_dof_indices)
+            for (const auto column : local_field_dof_indices)
+              dsp.add(row, column);
+        }
+
+    inverse_field_mass_matrix.reinit(owned_field_dofs,
+                                      owned_field_dofs,
+                                      dsp,
+                                      MPI_COMM_WORLD);
+  }
+
+  const QGauss<dim>                quadrature_formula(fe.degree+1);
+  FEValues<dim>                    fe_values(fe, quadrature_formula,
+                                             update_values | update_JxW_values);
+  const FEValuesExtractors::Vector VectorField(0);
+  FullMatrix<double>               cell_mass_matrix(n_field_cell_dofs,
+                                                    n_field_cell_dofs);
+
+  for (const auto &cell : dof_handler.active_cell_iterators())
+    if (cell->is_locally_owned())
+      {
+        fe_values.reinit(cell);
+        cell_mass_matrix = 0;
+        for (unsigned int q=0; q<quadrature_formula.size(); ++q)
+          for (unsigned int i=0; i<n_field_cell_dofs; ++i)
+            for (unsigned int j=0; j<n_field_cell_dofs; ++j)
+              cell_mass_matrix(i,j) += fe_values[VectorField].value(field_cell_dofs[i],q) *
+                                       fe_values[VectorField].value(field_cell_dofs[j],q) *
+                                       fe_values.JxW(q);
+        cell_mass_matrix.gauss_jordan();
+
+        cell->get_dof_indices(local_dof_indices);
+        for (unsigned int i=0; i<n_field_cell_dofs; ++i)
+          local_field_dof_indices[i] = local_dof_indices[field_cell_dofs[i]];
+        inverse_field_mass_matrix.add(local_field_dof_indices,
+                                      cell_mass_matrix);
+      }
+  inverse_field_mass_matrix.compress(VectorOperation::add);
+
+  // Now the other three blocks,
+  TrilinosWrappers::SparseMatrix potential_field_matrix;
+  TrilinosWrappers::SparseMatrix potential_potential_matrix;
+  extract_block(field_dofs, potential_dofs,
+                field_potential_matrix);
+  extract_block(potential_dofs, field_dofs,
+                potential_field_matrix);
+  extract_block(potential_dofs, potential_dofs,
+                potential_potential_matrix);
+
+  // and the Schur complement. The pattern of $C M^{-1} B$ contains
+  // the one of $D$, so the entries of $D$ can simply be added to it.
+  TrilinosWrappers::SparseMatrix tmp_matrix;
+  TrilinosWrappers::SparseMatrix schur_complement;
+  potential_field_matrix.mmult(tmp_matrix, inverse_field_mass_matrix);
+  tmp_matrix.mmult(schur_complement, field_potential_matrix);
+  schur_complement *= -1.0;
+
+  for (const auto row : owned_potential_dofs)
+    for (auto entry = potential_potential_matrix.begin(row);
+         entry != potential_potential_matrix.end(row);
+         ++entry)
+      schur_complement.add(row, entry->column(), entry->value());
+  schur_complement.compress(VectorOperation::add);
+
+  TrilinosWrappers::PreconditionAMG::AdditionalData amg_data;
+  amg_data.elliptic              = true;
+  amg_data.higher_order_elements = (degree > 1);
+  amg_data.smoother_sweeps       = 2;
+  schur_complement_preconditioner.initialize(schur_complement, amg_data);
+}
+
+
 // @sect4{solve}
 // As mentioned earlier I used a direct solver to solve
 // the linear system of equations resulting from the LDG
@@ -1333,6 +2028,15 @@ distribute_local_flux_to_global(
 // Trilinos one can accomplish fully distributed computations
 // and not much about the following function calls will
 // change.
+//
+// For larger problems, the system can instead be solved with GMRES and
+// the block triangular preconditioner from above, in which all
+// operations are distributed. The system is not symmetric, since
+// the two off-diagonal blocks of the LDG method satisfy
+// $C = -B^T$, so MINRES is not an option here. The time spent in
+// the setup of the preconditioner and in the iterations is recorded in
+// separate sections of the <code>computing_timer</code>, which is what
+// one looks at for weak and strong scaling studies.
 template<int dim>
 void
 LDGPoissonProblem<dim>::
@@ -1350,12 +2054,45 @@ solve()
   TrilinosWrappers::MPI::Vector
   completely_distributed_solution(system_rhs);
 
-  // Now we can preform the solve on the completeley distributed
-  // right hand side vector, system matrix and the completely
-  // distributed solution.
-  solver.solve(system_matrix,
-               completely_distributed_solution,
-               system_rhs);
+  if (solver_type == direct)
+    {
+      // Now we can preform the solve on the completeley distributed
+      // right hand side vector, system matrix and the completely
+      // distributed solution.
+      solver.solve(system_matrix,
+                   completely_distributed_solution,
+                   system_rhs);
+    }
+  else
+    {
+      setup_block_preconditioner();
+
+      TimerOutput::Scope timer_section(computing_timer, "GMRES iterations");
+
+      const BlockTriangularPreconditioner
+      preconditioner(field_potential_matrix,
+                     inverse_field_mass_matrix,
+                     schur_complement_preconditioner,
+                     owned_field_dofs,
+                     owned_potential_dofs);
+
+      SolverControl gmres_control(system_matrix.m(),
+                                  1e-10 * system_rhs.l2_norm());
+      SolverGMRES<TrilinosWrappers::MPI::Vector>
+      gmres(gmres_control,
+            SolverGMRES<TrilinosWrappers::MPI::Vector>::AdditionalData(50, true));
+
+      completely_distributed_solution = 0;
+      gmres.solve(system_matrix,
+                  completely_distributed_solution,
+                  system_rhs,
+                  preconditioner);
+
+      n_solver_iterations = gmres_control.last_step();
+      pcout << "Number of GMRES iterations: "
+            << n_solver_iterations
+            << std::endl;
+    }
 
   // We now distribute the constraints of our system onto the
   // completely solution vector, but in our case with the LDG
@@ -1372,6 +2109,115 @@ solve()
   locally_relevant_solution = completely_distributed_solution;
 }
 
+// @sect4{compare_operator_application}
+// If requested on the command line, we apply before solving both the assembled <code>system_matrix</code>
+// and the matrix-free <code>LDGOperator</code> to the right hand side
+// vector and compare the results, which verifies that the two
+// implementations agree. We also report the time of a few operator
+// applications and the memory used by each of them, which is what
+// decides between the two for higher polynomial degrees.
+//
+// The MatrixFree class requires the locally owned dofs of each processor
+// to form one contiguous range, which is not the case after the
+// component-wise renumbering of <code>dof_handler</code> with more than
+// one processor: each processor then owns one range of the vector field
+// and one of the scalar unknown. The matrix-free operator is therefore
+// set up on a second DoFHandler with the default numbering, and vectors
+// are transferred between the two numberings cell by cell through the
+// global indices of the dofs. Since all dofs of the DG element belong to
+// its cell, the dofs of locally owned cells are exactly the locally owned
+// dofs in both numberings.
+template<int dim>
+void
+LDGPoissonProblem<dim>::
+compare_operator_application()
+{
+  const unsigned int n_applications = 20;
+
+  DoFHandler<dim>           matrix_free_dof_handler(triangulation);
+  AffineConstraints<double> matrix_free_constraints;
+  LDGOperator<dim>          ldg_operator;
+  {
+    TimerOutput::Scope t(computing_timer, "matrix-free setup");
+    matrix_free_dof_handler.distribute_dofs(fe);
+    matrix_free_constraints.close();
+    ldg_operator.reinit(matrix_free_dof_handler,
+                        matrix_free_constraints,
+                        penalty,
+                        Dirichlet,
+                        Neumann);
+  }
+
+  // Pairs of the index of each locally owned dof in the numbering of
+  // <code>dof_handler</code> and in that of the matrix-free operator:
+  std::vector<std::pair<types::global_dof_index, types::global_dof_index>>
+    dof_index_pairs;
+  dof_index_pairs.reserve(locally_owned_dofs.n_elements());
+  {
+    std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+    std::vector<types::global_dof_index> matrix_free_dof_indices(fe.dofs_per_cell);
+    for (const auto &cell : dof_handler.active_cell_iterators())
+      if (cell->is_locally_owned())
+        {
+          const typename DoFHandler<dim>::active_cell_iterator
+          matrix_free_cell(&triangulation,
+                           cell->level(),
+                           cell->index(),
+                           &matrix_free_dof_handler);
+          cell->get_dof_indices(dof_indices);
+          matrix_free_cell->get_dof_indices(matrix_free_dof_indices);
+          for (unsigned int i=0; i<fe.dofs_per_cell; ++i)
+            dof_index_pairs.emplace_back(dof_indices[i],
+                                         matrix_free_dof_indices[i]);
+        }
+  }
+  AssertDimension(dof_index_pairs.size(), locally_owned_dofs.n_elements());
+
+  TrilinosWrappers::MPI::Vector matrix_based_result(locally_owned_dofs,
+                                                    MPI_COMM_WORLD);
+  {
+    TimerOutput::Scope t(computing_timer, "matrix-based vmult");
+    for (unsigned int i=0; i<n_applications; ++i)
+      system_matrix.vmult(matrix_based_result, system_rhs);
+  }
+
+  LinearAlgebra::distributed::Vector<double> src;
+  LinearAlgebra::distributed::Vector<double> dst;
+  ldg_operator.initialize_dof_vector(src);
+  ldg_operator.initialize_dof_vector(dst);
+  for (const auto &indices : dof_index_pairs)
+    src(indices.second) = system_rhs(indices.first);
+  {
+    TimerOutput::Scope t(computing_timer, "matrix-free vmult");
+    for (unsigned int i=0; i<n_applications; ++i)
+      ldg_operator.vmult(dst, src);
+  }
+
+  TrilinosWrappers::MPI::Vector matrix_free_result(locally_owned_dofs,
+                                                   MPI_COMM_WORLD);
+  for (const auto &indices : dof_index_pairs)
+    matrix_free_result(indices.first) = dst(indices.second);
+  matrix_free_result.compress(VectorOperation::insert);
+
+  const double matrix_based_norm = matrix_based_result.l2_norm();
+  matrix_free_result -= matrix_based_result;
+
+  pcout << "Relative difference of the matrix-free operator: "
+        << matrix_free_result.l2_norm() / matrix_based_norm
+        << std::endl;
+  pcout << "Memory of the system matrix:        "
+        << Utilities::MPI::sum(static_cast<double>(
+                                 system_matrix.memory_consumption()),
+                               MPI_COMM_WORLD) / 1e6
+        << " MB" << std::endl;
+  pcout << "Memory of the matrix-free operator: "
+        << Utilities::MPI::sum(static_cast<double>(
+                                 ldg_operator.memory_consumption()),
+                               MPI_COMM_WORLD) / 1e6
+        << " MB" << std::endl;
+}
+
+
 // @sect4{output_results}
 // This function deals with the writing of the reuslts in parallel
 // to disk.  It is almost exactly the same as
@@ -1451,10 +2297,75 @@ output_results()    const
 }
 
 
+// @sect4{write_benchmark_data}
+// To compare runs with different mesh sizes and numbers of processors,
+// for example in strong and weak scaling studies, we write the
+// time spent in each section of the <code>computing_timer</code>, the
+// number of degrees of freedom and solver iterations, and the peak
+// resident memory to the file <code>benchmark.csv</code>, with one
+// quantity per line. Times are the maximum over all processors, and the
+// memory is that of the processor using the most.
+template<int dim>
+void
+LDGPoissonProblem<dim>::
+write_benchmark_data() const
+{
+  const std::map<std::string, double> wall_times =
+    computing_timer.get_summary_data(TimerOutput::total_wall_time);
+  const std::map<std::string, double> n_calls =
+    computing_timer.get_summary_data(TimerOutput::n_calls);
+
+  Utilities::System::MemoryStats stats;
+  Utilities::System::get_memory_stats(stats);
+  const double peak_memory =
+    Utilities::MPI::max(static_cast<double>(stats.VmHWM), MPI_COMM_WORLD);
+
+  // All sections of the <code>computing_timer</code> are entered by all
+  // processors together (the matrix-free comparison as well, since all of
+  // them see the same command line), so each of them reduces over the same
+  // sections in the same order.
+  Assert(Utilities::MPI::min(static_cast<unsigned int>(wall_times.size()),
+                             MPI_COMM_WORLD) ==
+         Utilities::MPI::max(static_cast<unsigned int>(wall_times.size()),
+                             MPI_COMM_WORLD),
+         ExcMessage("All processors need to have entered the same timer "
+                    "sections."));
+  std::map<std::string, double> max_wall_times;
+  std::map<std::string, double> max_n_calls;
+  for (const auto &section : wall_times)
+    {
+      max_wall_times[section.first] =
+        Utilities::MPI::max(section.second, MPI_COMM_WORLD);
+      max_n_calls[section.first] =
+        Utilities::MPI::max(n_calls.at(section.first), MPI_COMM_WORLD);
+    }
+
+  if (Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0)
+    {
+      std::ofstream output("benchmark.csv");
+      output << "step,quantity,value" << std::endl
+             << "0,n_mpi_processes,"
+             << Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD) << std::endl
+             << "0,n_refine," << n_refine << std::endl
+             << "0,n_dofs," << dof_handler.n_dofs() << std::endl
+             << "0,n_solver_iterations," << n_solver_iterations << std::endl
+             << "0,peak_resident_memory_kB," << peak_memory << std::endl;
+      for (const auto &section : max_wall_times)
+        output << "0,wall_time:" << section.first << ','
+               << section.second << std::endl
+               << "0,n_calls:" << section.first << ','
+               << max_n_calls.at(section.first) << std::endl;
+    }
+}
+
+
 // @sect4{run}
 // The only public function of this class is pretty much exactly
 // the same as all the other deal.ii examples except I setting
 // the constant in the DG penalty ($\tilde{\sigma}$) to be 1.
+// The comparison with the matrix-free operator is only done if it
+// was asked for, so that it does not show up in the timings of
+// ordinary and benchmark runs.
 template<int dim>
 void
 LDGPoissonProblem<dim>::
@@ -1464,8 +2375,11 @@ run()
   make_grid();
   make_dofs();
   assemble_system();
+  if (compare_matrix_free)
+    compare_operator_application();
   solve();
   output_results();
+  write_benchmark_data();
 }
 
 
@@ -1485,9 +2399,45 @@ int main(int argc, char *argv[])
       Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv,
                                                           numbers::invalid_unsigned_int);
 
+      // The option <code>--compare-matrix-free</code> can be given
+      // anywhere on the command line and is removed from the list of
+      // arguments before the remaining ones are interpreted by their
+      // position.
+      bool compare_matrix_free = false;
+      std::vector<std::string> arguments;
+      for (int i = 1; i < argc; ++i)
+        if (std::string(argv[i]) == "--compare-matrix-free")
+          compare_matrix_free = true;
+        else
+          arguments.emplace_back(argv[i]);
+
+      // The solver is chosen with the first command line argument,
+      // which is either <code>direct</code> (the default) or
+      // <code>gmres</code>.
+      LDGPoissonProblem<2>::SolverType solver_type =
+        LDGPoissonProblem<2>::direct;
+      if (arguments.size() > 0)
+        {
+          const std::string &solver_name = arguments[0];
+          if (solver_name == "gmres")
+            solver_type = LDGPoissonProblem<2>::block_preconditioned_gmres;
+          else
+            AssertThrow(solver_name == "direct",
+                        ExcMessage("Unknown solver <" + solver_name +
+                                   ">, use either <direct> or <gmres>."));
+        }
+
+      // The number of global refinements can be given as an optional
+      // second argument, which allows to run a ladder of problem sizes
+      // for scaling studies.
       unsigned int degree = 1;
       unsigned int n_refine = 6;
-      LDGPoissonProblem<2>    Poisson(degree, n_refine);
+      if (arguments.size() > 1)
+        n_refine = Utilities::string_to_int(arguments[1]);
+      LDGPoissonProblem<2>    Poisson(degree,
+                                      n_refine,
+                                      solver_type,
+                                      compare_matrix_free);
       Poisson.run();
 
     }
@@ -132,6 +132,10 @@ namespace nsp
                         "Number identifying the domain in which we solve the problem");
       prm.declare_entry("No of initial refinements", "4",Patterns::Integer(0),
                         "Number of global mesh refinement steps applied to initial coarse grid");
+      prm.declare_entry("No of coarse levels for continuation", "0",Patterns::Integer(0),
+                        "Number of the initial refinements postponed during the increasing p "
+                        "stages: the first stages are solved on a coarser mesh and their "
+                        "solution is prolongated to a globally refined one");
       prm.declare_entry("No of adaptive refinements", "8",Patterns::Integer(0),
                         "Number of global adaptive mesh refinements");
       prm.declare_entry("top_fraction_of_cells", "0.25",Patterns::Double(0),
@@ -327,8 +331,9 @@ namespace nsp
     void assemble_system ();
     bool solve (const int inner_it);
     void init_mesh ();
-    void refine_mesh ();
+    void refine_mesh (const bool global_refinement);
     void set_boundary_values ();
+    void prepare_line_search ();
     double phi (const double alpha) const;
     bool checkWolfe(double &alpha, double &phi_alpha) const;
     bool determine_step_length (const int inner_it);
@@ -351,6 +356,9 @@ namespace nsp
     AffineConstraints<double> hanging_node_constraints;
     SparsityPattern sparsity_pattern;
     SparseMatrix<double> system_matrix;
+    // SSOR only precomputes data depending on the sparsity pattern, so it is
+    // initialized once per mesh and reused by all inner iterations
+    PreconditionSSOR<> preconditioner;
     ConvergenceTable convergence_table;
     ConvergenceTable dual_convergence_table;
     Vector<double> present_solution;
@@ -359,6 +367,15 @@ namespace nsp
     Vector<double> grad_norm;
     Vector<double> lambda;
 
+    // Quadrature data for the line search along u_h + alpha w: the gradients
+    // of the current iterate and of the search direction, the JxW values and
+    // the integrals of f u_h and f w, so that phi(alpha) needs no FEValues.
+    std::vector<Tensor<1, dim> > ls_grad_u;
+    std::vector<Tensor<1, dim> > ls_grad_w;
+    std::vector<double> ls_JxW;
+    double ls_f_u;
+    double ls_f_w;
+
 
     double step_length,phi_zero,phi_alpha,phip,phip_zero;
     double old_step,old_phi_zero,old_phip;
@@ -629,6 +646,7 @@ namespace nsp
     hanging_node_constraints.condense (c_sparsity);
     sparsity_pattern.copy_from(c_sparsity);
     system_matrix.reinit (sparsity_pattern);
+    preconditioner.initialize(system_matrix,0.25);
   }
 
   /***************************************************************************************/
@@ -702,32 +720,25 @@ namespace nsp
             long double a=old_solution_gradients[q_point] * old_solution_gradients[q_point];
             long double exponent=(p-2.0)/2*std::log(a);
             coeff= std::exp( exponent);
+            // the coefficients only depend on the quadrature point
+            const double JxW=fe_values.JxW(q_point);
+            const double matrix_coeff=(dir_id==1 ? G(a)+(p-1.0)*coeff : Wp(a)+coeff)*JxW;
+            const double rhs_coeff=(Wp(a)+coeff)*JxW;
+            const double f_JxW=right_hand_side.value(fe_values.quadrature_point(q_point))*JxW;
             for (unsigned int i=0; i<dofs_per_cell; ++i)
               {
-                for (unsigned int j=0; j<dofs_per_cell; ++j)
-                  {
-                    if (dir_id==1)
-                      {
-                        cell_matrix(i, j) +=  fe_values.shape_grad(i, q_point) *  fe_values.shape_grad(j, q_point)
-                                              * (G(a)+(p-1.0)*coeff)    * fe_values.JxW(q_point);
-                      }
-                    else
-                      {
-                        cell_matrix(i, j) +=  fe_values.shape_grad(i, q_point) *  fe_values.shape_grad(j, q_point)
-                                              * (Wp(a)+coeff)
-                                              * fe_values.JxW(q_point);
-                      }
-                  }
-
-                cell_rhs(i) -= (  fe_values.shape_grad(i, q_point)
-                                  * old_solution_gradients[q_point]
-                                  * (Wp(a)+coeff)
-                                  -right_hand_side.value(fe_values.quadrature_point(q_point))
-                                  *fe_values.shape_value(i, q_point)
-                               )
-                               * fe_values.JxW(q_point);
+                const Tensor<1,dim> grad_phi_i=fe_values.shape_grad(i, q_point);
+                // the matrix is symmetric, compute the lower triangle only
+                for (unsigned int j=0; j<=i; ++j)
+                  cell_matrix(i, j) += grad_phi_i * fe_values.shape_grad(j, q_point) * matrix_coeff;
+
+                cell_rhs(i) -= grad_phi_i * old_solution_gradients[q_point] * rhs_coeff
+                               - f_JxW * fe_values.shape_value(i, q_point);
               }
           }
+        for (unsigned int i=0; i<dofs_per_cell; ++i)
+          for (unsigned int j=i+1; j<dofs_per_cell; ++j)
+            cell_matrix(i, j) = cell_matrix(j, i);
 
         cell->get_dof_indices (local_dof_indices);
         for (unsigned int i=0; i<dofs_per_cell; ++i)
@@ -761,25 +772,33 @@ namespace nsp
   /**********************************      Refine Mesh      ****************************************/
 // unchanged from step-15
 
+// If global_refinement is set, all cells are refined and the solution is just
+// prolongated to the finer mesh, which is used during the p-continuation.
+
   template <int dim>
-  void ElastoplasticTorsion<dim>::refine_mesh ()
+  void ElastoplasticTorsion<dim>::refine_mesh (const bool global_refinement)
   {
-    using FunctionMap = std::map<types::boundary_id, const Function<dim> *>;
-
-    Vector<float> estimated_error_per_cell (triangulation.n_active_cells());
-    KellyErrorEstimator<dim>::estimate (dof_handler,
-                                        QGauss<dim-1>(3),
-                                        FunctionMap(),
-                                        present_solution,
-                                        estimated_error_per_cell);
-
-    prm.enter_subsection ("Mesh & Refinement Parameters");
-    const double top_fraction=prm.get_double("top_fraction_of_cells");
-    const double bottom_fraction=prm.get_double("bottom_fraction_of_cells");
-    prm.leave_subsection ();
-    GridRefinement::refine_and_coarsen_fixed_number (triangulation,
-                                                     estimated_error_per_cell,
-                                                     top_fraction, bottom_fraction);
+    if (global_refinement)
+      triangulation.set_all_refine_flags ();
+    else
+      {
+        using FunctionMap = std::map<types::boundary_id, const Function<dim> *>;
+
+        Vector<float> estimated_error_per_cell (triangulation.n_active_cells());
+        KellyErrorEstimator<dim>::estimate (dof_handler,
+                                            QGauss<dim-1>(3),
+                                            FunctionMap(),
+                                            present_solution,
+                                            estimated_error_per_cell);
+
+        prm.enter_subsection ("Mesh & Refinement Parameters");
+        const double top_fraction=prm.get_double("top_fraction_of_cells");
+        const double bottom_fraction=prm.get_double("bottom_fraction_of_cells");
+        prm.leave_subsection ();
+        GridRefinement::refine_and_coarsen_fixed_number (triangulation,
+                                                         estimated_error_per_cell,
+                                                         top_fraction, bottom_fraction);
+      }
 
     triangulation.prepare_coarsening_and_refinement ();
     SolutionTransfer<dim> solution_transfer(dof_handler);
@@ -839,16 +858,12 @@ namespace nsp
 
 
   /****************************************************************************************/
-//  COMPUTE $\phi(\alpha)=J_p(u_h+\alpha w)$
+//  Gather the quadrature point data of u_h and w needed by phi. This is the only
+//  loop over the cells per line search.
   template <int dim>
-  double ElastoplasticTorsion<dim>::phi (const double alpha) const
+  void ElastoplasticTorsion<dim>::prepare_line_search ()
   {
-    double obj = 0.0;
     const RightHandSide<dim> right_hand_side;
-    Vector<double> evaluation_point (dof_handler.n_dofs());
-    evaluation_point = present_solution;  // copy of u_h
-    evaluation_point.add (alpha, newton_update); // u_{n+1}=u_n+alpha w_n
-
     const QGauss<dim>  quadrature_formula(3);
     FEValues<dim> fe_values (fe, quadrature_formula,
                              update_gradients         |
@@ -856,42 +871,69 @@ namespace nsp
                              update_quadrature_points |
                              update_JxW_values);
 
-    const unsigned int           dofs_per_cell = fe.dofs_per_cell;
     const unsigned int           n_q_points    = quadrature_formula.size();
+    const unsigned int           n_total_q_points = triangulation.n_active_cells()*n_q_points;
 
-    Vector<double>               cell_residual (dofs_per_cell);
-    std::vector<Tensor<1, dim> > gradients(n_q_points);
-    std::vector<double> values(n_q_points);
+    ls_grad_u.resize (n_total_q_points);
+    ls_grad_w.resize (n_total_q_points);
+    ls_JxW.resize (n_total_q_points);
+    ls_f_u=0.0;
+    ls_f_w=0.0;
 
+    std::vector<Tensor<1, dim> > gradients_u(n_q_points);
+    std::vector<Tensor<1, dim> > gradients_w(n_q_points);
+    std::vector<double> values_u(n_q_points);
+    std::vector<double> values_w(n_q_points);
 
-    std::vector<types::global_dof_index>    local_dof_indices (dofs_per_cell);
-
+    unsigned int index=0;
     typename DoFHandler<dim>::active_cell_iterator
     cell = dof_handler.begin_active(),
     endc = dof_handler.end();
     for (; cell!=endc; ++cell)
       {
-        cell_residual = 0;
         fe_values.reinit (cell);
-        fe_values.get_function_gradients (evaluation_point, gradients);
-        fe_values.get_function_values (evaluation_point, values);
-
+        fe_values.get_function_gradients (present_solution, gradients_u);
+        fe_values.get_function_gradients (newton_update, gradients_w);
+        fe_values.get_function_values (present_solution, values_u);
+        fe_values.get_function_values (newton_update, values_w);
 
-        for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
+        for (unsigned int q_point=0; q_point<n_q_points; ++q_point, ++index)
           {
-            double Du2=gradients[q_point] *  gradients[q_point]; // Du2=|Du|^2
-            double penalty;
-            if (Du2<1.0e-10)
-              penalty=0.0;
-            else
-              penalty=std::pow(Du2,p/2.0); // penalty=|Du|^p
-
-            // obj+= 1/2 W(|Du|^2)+1/p |Du|^p -fu (see (1))
-            obj+=(
-                   (0.5*W(Du2)+penalty/p)- right_hand_side.value(fe_values.quadrature_point(q_point))*values[q_point]
-                 ) * fe_values.JxW(q_point);
+            const double f_JxW=right_hand_side.value(fe_values.quadrature_point(q_point))
+                               *fe_values.JxW(q_point);
+            ls_grad_u[index]=gradients_u[q_point];
+            ls_grad_w[index]=gradients_w[q_point];
+            ls_JxW[index]=fe_values.JxW(q_point);
+            ls_f_u+=f_JxW*values_u[q_point];
+            ls_f_w+=f_JxW*values_w[q_point];
           }
+      }
+  }
+
+
+  /****************************************************************************************/
+//  COMPUTE $\phi(\alpha)=J_p(u_h+\alpha w)$
+//  from the data gathered by prepare_line_search(): the gradient of u_h + alpha w
+//  at each quadrature point is a linear combination of the stored gradients, and
+//  the linear term is linear in alpha.
+  template <int dim>
+  double ElastoplasticTorsion<dim>::phi (const double alpha) const
+  {
+    // obj = -∫ f (u_h + alpha w)
+    double obj = -(ls_f_u+alpha*ls_f_w);
 
+    for (unsigned int q=0; q<ls_JxW.size(); ++q)
+      {
+        const Tensor<1,dim> gradient=ls_grad_u[q]+alpha*ls_grad_w[q];
+        double Du2=gradient *  gradient; // Du2=|Du|^2
+        double penalty;
+        if (Du2<1.0e-10)
+          penalty=0.0;
+        else
+          penalty=std::pow(Du2,p/2.0); // penalty=|Du|^p
+
+        // obj+= 1/2 W(|Du|^2)+1/p |Du|^p (see (1))
+        obj+=(0.5*W(Du2)+penalty/p) * ls_JxW[q];
       }
 
     return obj;
@@ -1084,7 +1126,11 @@ namespace nsp
     prm.enter_subsection ("Mesh & Refinement Parameters");
     const int domain_id=prm.get_integer("Code for the domain");
     const int init_ref=prm.get_integer("No of initial refinements");
+    const int coarse_levels=prm.get_integer("No of coarse levels for continuation");
     prm.leave_subsection ();
+    AssertThrow (coarse_levels<=init_ref,
+                 ExcMessage("The number of coarse levels for the continuation must not "
+                            "exceed the number of initial refinements."));
 
 
     if (domain_id==0)
@@ -1128,8 +1174,9 @@ namespace nsp
         GridGenerator::merge_triangulations (tria6, tria4, tria6);
         GridGenerator::merge_triangulations (tria6, tria5, triangulation);
       }
-    // perform initial refinements
-    triangulation.refine_global(init_ref);
+    // perform initial refinements, except for those postponed until the
+    // low p stages of the continuation are solved
+    triangulation.refine_global(init_ref-coarse_levels);
   }
 
   /**************************************************************************************************/
@@ -1147,14 +1194,12 @@ namespace nsp
     SolverControl solver_control (max_CG_it,CG_tol);
     SolverCG<>    solver (solver_control);
 
-    PreconditionSSOR<> preconditioner;
-    preconditioner.initialize(system_matrix,0.25);
-
     solver.solve (system_matrix, newton_update, system_rhs,
                   preconditioner);
     hanging_node_constraints.distribute (newton_update);
     /******  save current quantities for line-search  **** */
     // Recall that phi(alpha)=J(u+alpha w)
+    prepare_line_search ();
     old_step=step_length;
     old_phi_zero=phi_zero;
     phi_zero=phi(0); // phi(0)=J(u)
@@ -1194,6 +1239,7 @@ namespace nsp
     // get parameters
     prm.enter_subsection ("Mesh & Refinement Parameters");
     const int adapt_ref=prm.get_integer("No of adaptive refinements");
+    int coarse_levels=prm.get_integer("No of coarse levels for continuation");
     prm.leave_subsection ();
     prm.enter_subsection ("Algorithm Parameters");
     const int max_inner=prm.get_integer("Max_inner");
@@ -1258,12 +1304,22 @@ namespace nsp
             process_multiplier(cycle,global_it,ptime);
             //dual_convergence_table.write_tex(dual_error_table_file);
           }
-        refine_mesh();
+        // while levels of the initial refinement are pending, the next
+        // (larger) p is solved on the globally refined mesh instead of an
+        // adaptively refined one
+        refine_mesh(coarse_levels>0);
+        if (coarse_levels>0)
+          --coarse_levels;
         cycle++;
         p+=delta_p;
       }
     /***************************    first loop finished        ********************/
 
+    // if the continuation was shorter than the number of postponed levels,
+    // prolongate to the mesh of the initial refinement now
+    for (; coarse_levels>0; --coarse_levels)
+      refine_mesh(true);
+
 
     // prepare for second loop
     p=actual_p;
@@ -1309,7 +1365,7 @@ namespace nsp
         ++cycle;
         // refine mesh
         std::cout << "******** Refined mesh " << cycle    << " ********"  << std::endl;
-        refine_mesh();
+        refine_mesh(false);
       }// second loop
 
     // write convergence tables to file
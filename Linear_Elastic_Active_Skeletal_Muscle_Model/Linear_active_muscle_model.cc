@@ -29,12 +29,16 @@
 #include <deal.II/base/function.h>
 #include <deal.II/base/logstream.h>
 #include <deal.II/base/parameter_handler.h>
+#include <deal.II/base/parallel.h>
+#include <deal.II/base/vectorization.h>
+#include <deal.II/base/work_stream.h>
 #include <deal.II/lac/affine_constraints.h>
 #include <deal.II/lac/vector.h>
 #include <deal.II/lac/full_matrix.h>
 #include <deal.II/lac/sparse_matrix.h>
 #include <deal.II/lac/solver_cg.h>
 #include <deal.II/lac/precondition.h>
+#include <deal.II/lac/sparse_direct.h>
 #include <deal.II/grid/grid_out.h>
 #include <deal.II/grid/manifold_lib.h>
 #include <deal.II/grid/tria.h>
@@ -55,6 +59,7 @@
 #include <deal.II/numerics/error_estimator.h>
 #include <deal.II/physics/transformations.h>
 
+#include <array>
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -349,6 +354,49 @@ namespace LMM
       prm.leave_subsection();
     }
 
+// @sect4{Linear solver}
+
+// Choose the preconditioner for the CG solver. When a factorization is
+// used, it is computed once and then reused for subsequent timesteps until
+// the solver no longer converges within a prescribed number of iterations.
+    struct LinearSolver
+    {
+      std::string  preconditioner_type;
+      unsigned int max_iterations_cached_factorization;
+
+      static void
+      declare_parameters(ParameterHandler &prm);
+
+      void
+      parse_parameters(ParameterHandler &prm);
+    };
+
+    void LinearSolver::declare_parameters(ParameterHandler &prm)
+    {
+      prm.enter_subsection("Linear solver");
+      {
+        prm.declare_entry("Preconditioner type", "ssor",
+                          Patterns::Selection("ssor|factorization"),
+                          "Type of preconditioner");
+
+        prm.declare_entry("Max iterations with cached factorization", "10",
+                          Patterns::Integer(1),
+                          "Number of CG iterations after which a cached "
+                          "factorization is recomputed");
+      }
+      prm.leave_subsection();
+    }
+
+    void LinearSolver::parse_parameters(ParameterHandler &prm)
+    {
+      prm.enter_subsection("Linear solver");
+      {
+        preconditioner_type = prm.get("Preconditioner type");
+        max_iterations_cached_factorization = prm.get_integer("Max iterations with cached factorization");
+      }
+      prm.leave_subsection();
+    }
+
 // @sect4{All parameters}
 
 // Finally we consolidate all of the above structures into a single container
@@ -358,7 +406,8 @@ namespace LMM
       public IsotonicContraction,
       public BicepsBrachii,
       public NeurologicalSignal,
-      public Time
+      public Time,
+      public LinearSolver
     {
       AllParameters(const std::string &input_file);
 
@@ -385,6 +434,7 @@ namespace LMM
       BicepsBrachii::declare_parameters(prm);
       NeurologicalSignal::declare_parameters(prm);
       Time::declare_parameters(prm);
+      LinearSolver::declare_parameters(prm);
     }
 
     void AllParameters::parse_parameters(ParameterHandler &prm)
@@ -395,6 +445,7 @@ namespace LMM
       BicepsBrachii::parse_parameters(prm);
       NeurologicalSignal::parse_parameters(prm);
       Time::parse_parameters(prm);
+      LinearSolver::parse_parameters(prm);
 
       // Override time setting for test defined
       // in the literature
@@ -584,95 +635,205 @@ namespace LMM
 #define convert_gf_per_cm2_to_N_per_m2 convert_gf_to_N*1e2*1e2
 #define T0 6280.0*convert_gf_per_cm2_to_N_per_m2
 
-  // A struct that governs the functioning of a single muscle fibre
+  // The state of all of the muscle fibres, i.e. that of the fibres located at
+  // each quadrature point in the domain. The data is stored as a structure
+  // of arrays, with each quantity held in a contiguous array that is padded
+  // to a multiple of the SIMD vector length. This allows the activation and
+  // state of all fibres to be updated with vectorized kernels that are
+  // executed in parallel over subranges of the fibres.
   template <int dim>
-  struct MuscleFibre
+  class MuscleFibreData
   {
-    MuscleFibre (void)
-      : alpha (0.0),
-        alpha_t1 (0.0),
-        epsilon_f (0.0),
-        epsilon_c (0.0),
-        epsilon_c_t1 (0.0),
-        epsilon_c_dot (0.0)
+  public:
+    MuscleFibreData (void)
+      : n_q_points_cell (0),
+        n_fibres (0)
     {
 
     }
 
-    MuscleFibre(const Tensor<1,dim> &direction)
-      : M (direction),
-        alpha (0.0),
-        alpha_t1 (0.0),
-        epsilon_f (0.0),
-        epsilon_c (0.0),
-        epsilon_c_t1 (0.0),
-        epsilon_c_dot (0.0)
-    {
-      Assert(M.norm() == 1.0,
-             ExcMessage("Fibre direction is not a unit vector"));
-    }
+    void reinit (const unsigned int n_cells,
+                 const unsigned int n_q_points_cell);
+
+    void set_direction (const unsigned int   cell,
+                        const unsigned int   q_point_cell,
+                        const Tensor<1,dim> &direction);
+
+    // Record the fibre strain that is to be committed to the fibre state in
+    // the next call to update_state().
+    void set_fibre_strain (const unsigned int            cell,
+                           const unsigned int            q_point_cell,
+                           const SymmetricTensor<2,dim> &strain_tensor);
 
     void update_alpha (const double u,
                        const double dt);
 
-    void update_state(const SymmetricTensor<2,dim> &strain_tensor,
-                      const double dt);
-
-    const Tensor<1,dim> &get_M () const
-    {
-      return M;
-    }
-    double get_m_p () const;
-    double get_m_s () const;
-    double get_beta (const double dt) const;
-    double get_gamma (const double dt) const;
+    void update_state (const double dt);
+
+    Tensor<1,dim> get_M (const unsigned int cell,
+                         const unsigned int q_point_cell) const;
+    double get_m_p (const unsigned int cell,
+                    const unsigned int q_point_cell) const;
+    double get_m_s (const unsigned int cell,
+                    const unsigned int q_point_cell) const;
+    double get_beta (const unsigned int cell,
+                     const unsigned int q_point_cell,
+                     const double       dt) const;
+    double get_gamma (const unsigned int cell,
+                      const unsigned int q_point_cell,
+                      const double       dt) const;
 
     // Postprocessing
-    const double &get_alpha() const
+    const double &get_alpha (const unsigned int cell,
+                             const unsigned int q_point_cell) const
     {
-      return alpha;
+      return alpha[index(cell,q_point_cell)];
     }
-    const double &get_epsilon_f() const
+    const double &get_epsilon_f (const unsigned int cell,
+                                 const unsigned int q_point_cell) const
     {
-      return epsilon_f;
+      return epsilon_f[index(cell,q_point_cell)];
     }
-    const double &get_epsilon_c() const
+    const double &get_epsilon_c (const unsigned int cell,
+                                 const unsigned int q_point_cell) const
     {
-      return epsilon_c;
+      return epsilon_c[index(cell,q_point_cell)];
     }
-    const double &get_epsilon_c_dot() const
+    const double &get_epsilon_c_dot (const unsigned int cell,
+                                     const unsigned int q_point_cell) const
     {
-      return epsilon_c_dot;
+      return epsilon_c_dot[index(cell,q_point_cell)];
     }
 
   private:
-    Tensor<1,dim> M; // Direction
+    unsigned int n_q_points_cell;
+    unsigned int n_fibres;
+
+    std::array<std::vector<double>,dim> M; // Direction
+
+    std::vector<double> alpha;    // Activation level at current timestep
+    std::vector<double> alpha_t1; // Activation level at previous timestep
 
-    double alpha;    // Activation level at current timestep
-    double alpha_t1; // Activation level at previous timestep
+    std::vector<double> epsilon_f;     // Fibre strain at current timestep
+    std::vector<double> epsilon_f_new; // Fibre strain to be committed
+    std::vector<double> epsilon_c;     // Contractile strain at current timestep
+    std::vector<double> epsilon_c_t1;  // Contractile strain at previous timestep
+    std::vector<double> epsilon_c_dot; // Contractile velocity at previous timestep
 
-    double epsilon_f;     // Fibre strain at current timestep
-    double epsilon_c;     // Contractile strain at current timestep
-    double epsilon_c_t1;  // Contractile strain at previous timestep
-    double epsilon_c_dot; // Contractile velocity at previous timestep
+    unsigned int index (const unsigned int cell,
+                        const unsigned int q_point_cell) const
+    {
+      Assert(q_point_cell<n_q_points_cell, ExcMessage("Trying to access fibre data not stored for this cell and qp index"));
+      Assert(cell*n_q_points_cell + q_point_cell<n_fibres, ExcMessage("Trying to access fibre data not stored for this cell index"));
+      return cell*n_q_points_cell + q_point_cell;
+    }
 
-    double get_f_c_L () const;
-    double get_m_c_V () const;
-    double get_c_c_V () const;
+    // The constitutive functions of the fibres. These are written such that
+    // they can be evaluated both for a single fibre and for a batch of
+    // fibres at once.
+    template <typename Number>
+    static Number compute_m_p (const Number &epsilon_f);
+    template <typename Number>
+    static Number compute_m_s (const Number &epsilon_f,
+                               const Number &epsilon_c);
+    template <typename Number>
+    static Number compute_f_c_L (const Number &epsilon_c);
+    template <typename Number>
+    static Number compute_m_c_V (const Number &epsilon_c_dot);
+    template <typename Number>
+    static Number compute_c_c_V (const Number &epsilon_c_dot);
+    template <typename Number>
+    static Number compute_beta (const Number &alpha,
+                                const Number &epsilon_f,
+                                const Number &epsilon_c,
+                                const Number &epsilon_c_dot,
+                                const double  dt);
+    template <typename Number>
+    static Number compute_gamma (const Number &alpha,
+                                 const Number &epsilon_c,
+                                 const Number &epsilon_c_t1,
+                                 const Number &epsilon_c_dot,
+                                 const double  dt);
   };
 
   template <int dim>
-  void MuscleFibre<dim>::update_alpha (const double u,
-                                       const double dt)
+  void MuscleFibreData<dim>::reinit (const unsigned int n_cells,
+                                     const unsigned int n_q_points_cell)
+  {
+    static const unsigned int n_lanes = VectorizedArray<double>::size();
+
+    this->n_q_points_cell = n_q_points_cell;
+    n_fibres = n_cells*n_q_points_cell;
+    const unsigned int n_entries = ((n_fibres + n_lanes - 1)/n_lanes)*n_lanes;
+
+    // The padding entries are given a valid (inactive) state so that they
+    // may be processed along with all other fibres.
+    for (unsigned int d=0; d<dim; ++d)
+      M[d].assign(n_entries, (d == 0 ? 1.0 : 0.0));
+    alpha.assign(n_entries, 0.0);
+    alpha_t1.assign(n_entries, 0.0);
+    epsilon_f.assign(n_entries, 0.0);
+    epsilon_f_new.assign(n_entries, 0.0);
+    epsilon_c.assign(n_entries, 0.0);
+    epsilon_c_t1.assign(n_entries, 0.0);
+    epsilon_c_dot.assign(n_entries, 0.0);
+  }
+
+  template <int dim>
+  void MuscleFibreData<dim>::set_direction (const unsigned int   cell,
+                                            const unsigned int   q_point_cell,
+                                            const Tensor<1,dim> &direction)
+  {
+    Assert(direction.norm() == 1.0,
+           ExcMessage("Fibre direction is not a unit vector"));
+    const unsigned int fibre = index(cell,q_point_cell);
+    for (unsigned int d=0; d<dim; ++d)
+      M[d][fibre] = direction[d];
+  }
+
+  template <int dim>
+  void MuscleFibreData<dim>::set_fibre_strain (const unsigned int            cell,
+                                               const unsigned int            q_point_cell,
+                                               const SymmetricTensor<2,dim> &strain_tensor)
+  {
+    const unsigned int fibre = index(cell,q_point_cell);
+    const Tensor<1,dim> M = get_M(cell,q_point_cell);
+    epsilon_f_new[fibre] = M*static_cast< Tensor<2,dim> >(strain_tensor)*M;
+  }
+
+  template <int dim>
+  Tensor<1,dim> MuscleFibreData<dim>::get_M (const unsigned int cell,
+                                             const unsigned int q_point_cell) const
+  {
+    const unsigned int fibre = index(cell,q_point_cell);
+    Tensor<1,dim> direction;
+    for (unsigned int d=0; d<dim; ++d)
+      direction[d] = M[d][fibre];
+    return direction;
+  }
+
+  // As the neural signal is the same for all fibres, the update of the
+  // activation level takes the form $\alpha = c_0 \alpha_{t1} + c_1$ with
+  // coefficients that are common to all fibres.
+  template <int dim>
+  void MuscleFibreData<dim>::update_alpha (const double u,
+                                           const double dt)
   {
     static const double tau_r = 0.15; // s
     static const double tau_f = 0.15; // s
     static const double alpha_min = 0;
 
+    double c_0, c_1;
     if (u == 1.0)
-      alpha = (alpha_t1*tau_r*tau_f + dt*tau_f) / (tau_r*tau_f + dt*tau_f);
+      {
+        c_0 = (tau_r*tau_f) / (tau_r*tau_f + dt*tau_f);
+        c_1 = (dt*tau_f) / (tau_r*tau_f + dt*tau_f);
+      }
     else if (u == 0)
-      alpha = (alpha_t1*tau_r*tau_f + dt*alpha_min*tau_r) / (tau_r*tau_f + dt*tau_r);
+      {
+        c_0 = (tau_r*tau_f) / (tau_r*tau_f + dt*tau_r);
+        c_1 = (dt*alpha_min*tau_r) / (tau_r*tau_f + dt*tau_r);
+      }
     else
       {
         const double b = 1.0/tau_r - 1.0/tau_f;
@@ -682,97 +843,180 @@ namespace LMM
         const double p = b*u + c;
         const double q = f1*u + d;
 
-        alpha = (q*dt + alpha_t1)/(1.0 + p*dt);
+        c_0 = 1.0/(1.0 + p*dt);
+        c_1 = q*dt/(1.0 + p*dt);
       }
-  }
 
+    static const unsigned int n_lanes = VectorizedArray<double>::size();
+    parallel::apply_to_subranges
+    (0u, static_cast<unsigned int>(alpha.size()/n_lanes),
+     [&](const unsigned int begin, const unsigned int end)
+    {
+      for (unsigned int batch=begin; batch<end; ++batch)
+        {
+          const unsigned int i = batch*n_lanes;
+          VectorizedArray<double> alpha_t1_v;
+          alpha_t1_v.load(&alpha_t1[i]);
+          const VectorizedArray<double> alpha_v = c_0*alpha_t1_v + c_1;
+          alpha_v.store(&alpha[i]);
+        }
+    },
+    1024);
+  }
 
   template <int dim>
-  double MuscleFibre<dim>::get_m_p () const
+  template <typename Number>
+  Number MuscleFibreData<dim>::compute_m_p (const Number &epsilon_f)
   {
     static const double A = 8.568e-4*convert_gf_per_cm2_to_N_per_m2;
     static const double a = 12.43;
-    if (epsilon_f >= 0.0)
-      {
-        // 100 times more compliant than Martins2006
-        static const double m_p = 2.0*A*a/1e2;
-        return m_p;
-      }
-    else
-      return 0.0;
+    // 100 times more compliant than Martins2006
+    static const double m_p = 2.0*A*a/1e2;
+    return compare_and_apply_mask<SIMDComparison::greater_than_or_equal>
+           (epsilon_f, Number(0.0), Number(m_p), Number(0.0));
   }
 
   template <int dim>
-  double MuscleFibre<dim>::get_m_s (void) const
+  template <typename Number>
+  Number MuscleFibreData<dim>::compute_m_s (const Number &epsilon_f,
+                                            const Number &epsilon_c)
   {
-    const double epsilon_s = epsilon_f - epsilon_c; // Small strain assumption
-    if (epsilon_s >= -1e-6) // Tolerant check
-      return 10.0;
-    else
-      return 0.0;
+    const Number epsilon_s = epsilon_f - epsilon_c; // Small strain assumption
+    return compare_and_apply_mask<SIMDComparison::greater_than_or_equal> // Tolerant check
+           (epsilon_s, Number(-1e-6), Number(10.0), Number(0.0));
   }
 
   template <int dim>
-  double MuscleFibre<dim>::get_f_c_L (void) const
+  template <typename Number>
+  Number MuscleFibreData<dim>::compute_f_c_L (const Number &epsilon_c)
   {
-    if (epsilon_c <= 0.5 && epsilon_c >= -0.5)
-      return 1.0;
-    else
-      return 0.0;
+    return compare_and_apply_mask<SIMDComparison::less_than_or_equal>
+           (epsilon_c, Number(0.5),
+            compare_and_apply_mask<SIMDComparison::greater_than_or_equal>
+            (epsilon_c, Number(-0.5), Number(1.0), Number(0.0)),
+            Number(0.0));
   }
 
   template <int dim>
-  double MuscleFibre<dim>::get_m_c_V (void) const
+  template <typename Number>
+  Number MuscleFibreData<dim>::compute_m_c_V (const Number &epsilon_c_dot)
   {
-    if (epsilon_c_dot < -5.0)
-      return 0.0;
-    else if (epsilon_c_dot <= 3.0)
-      return 1.0/5.0;
-    else
-      return 0.0;
+    return compare_and_apply_mask<SIMDComparison::less_than>
+           (epsilon_c_dot, Number(-5.0), Number(0.0),
+            compare_and_apply_mask<SIMDComparison::less_than_or_equal>
+            (epsilon_c_dot, Number(3.0), Number(1.0/5.0), Number(0.0)));
   }
 
   template <int dim>
-  double MuscleFibre<dim>::get_c_c_V (void) const
+  template <typename Number>
+  Number MuscleFibreData<dim>::compute_c_c_V (const Number &epsilon_c_dot)
   {
-    if (epsilon_c_dot < -5.0)
-      return 0.0;
-    else if (epsilon_c_dot <= 3.0)
-      return 1.0;
-    else
-      return 1.6;
+    return compare_and_apply_mask<SIMDComparison::less_than>
+           (epsilon_c_dot, Number(-5.0), Number(0.0),
+            compare_and_apply_mask<SIMDComparison::less_than_or_equal>
+            (epsilon_c_dot, Number(3.0), Number(1.0), Number(1.6)));
+  }
+
+  template <int dim>
+  template <typename Number>
+  Number MuscleFibreData<dim>::compute_beta (const Number &alpha,
+                                             const Number &epsilon_f,
+                                             const Number &epsilon_c,
+                                             const Number &epsilon_c_dot,
+                                             const double  dt)
+  {
+    return compute_f_c_L(epsilon_c)*compute_m_c_V(epsilon_c_dot)*alpha/dt
+           + compute_m_s(epsilon_f,epsilon_c);
+  }
+
+  template <int dim>
+  template <typename Number>
+  Number MuscleFibreData<dim>::compute_gamma (const Number &alpha,
+                                              const Number &epsilon_c,
+                                              const Number &epsilon_c_t1,
+                                              const Number &epsilon_c_dot,
+                                              const double  dt)
+  {
+    return compute_f_c_L(epsilon_c)*alpha*(compute_m_c_V(epsilon_c_dot)*epsilon_c_t1/dt
+                                           - compute_c_c_V(epsilon_c_dot));
+  }
+
+  template <int dim>
+  double MuscleFibreData<dim>::get_m_p (const unsigned int cell,
+                                        const unsigned int q_point_cell) const
+  {
+    const unsigned int fibre = index(cell,q_point_cell);
+    return compute_m_p(epsilon_f[fibre]);
   }
 
   template <int dim>
-  double MuscleFibre<dim>::get_beta(const double dt) const
+  double MuscleFibreData<dim>::get_m_s (const unsigned int cell,
+                                        const unsigned int q_point_cell) const
   {
-    return get_f_c_L()*get_m_c_V()*alpha/dt + get_m_s();
+    const unsigned int fibre = index(cell,q_point_cell);
+    return compute_m_s(epsilon_f[fibre], epsilon_c[fibre]);
   }
 
   template <int dim>
-  double MuscleFibre<dim>::get_gamma(const double dt) const
+  double MuscleFibreData<dim>::get_beta (const unsigned int cell,
+                                         const unsigned int q_point_cell,
+                                         const double       dt) const
   {
-    return get_f_c_L()*alpha*(get_m_c_V()*epsilon_c_t1/dt - get_c_c_V());
+    const unsigned int fibre = index(cell,q_point_cell);
+    return compute_beta(alpha[fibre], epsilon_f[fibre], epsilon_c[fibre],
+                        epsilon_c_dot[fibre], dt);
   }
 
   template <int dim>
-  void MuscleFibre<dim>::update_state(const SymmetricTensor<2,dim> &strain_tensor,
-                                      const double dt)
+  double MuscleFibreData<dim>::get_gamma (const unsigned int cell,
+                                          const unsigned int q_point_cell,
+                                          const double       dt) const
   {
-    // Values from previous state
-    // These were the values that were used in the assembly,
-    // so we must use them in the update step to be consistant.
-    // Need to compute these before we overwrite epsilon_c_t1
-    const double m_s = get_m_s();
-    const double beta = get_beta(dt);
-    const double gamma = get_gamma(dt);
-
-    // Update current state
-    alpha_t1 = alpha;
-    epsilon_f = M*static_cast< Tensor<2,dim> >(strain_tensor)*M;
-    epsilon_c_t1 = epsilon_c;
-    epsilon_c = (m_s*epsilon_f + gamma)/beta;
-    epsilon_c_dot = (epsilon_c - epsilon_c_t1)/dt;
+    const unsigned int fibre = index(cell,q_point_cell);
+    return compute_gamma(alpha[fibre], epsilon_c[fibre], epsilon_c_t1[fibre],
+                         epsilon_c_dot[fibre], dt);
+  }
+
+  template <int dim>
+  void MuscleFibreData<dim>::update_state(const double dt)
+  {
+    static const unsigned int n_lanes = VectorizedArray<double>::size();
+    parallel::apply_to_subranges
+    (0u, static_cast<unsigned int>(alpha.size()/n_lanes),
+     [&](const unsigned int begin, const unsigned int end)
+    {
+      for (unsigned int batch=begin; batch<end; ++batch)
+        {
+          const unsigned int i = batch*n_lanes;
+          VectorizedArray<double> alpha_v, epsilon_f_v, epsilon_f_new_v,
+                                  epsilon_c_v, epsilon_c_t1_v, epsilon_c_dot_v;
+          alpha_v.load(&alpha[i]);
+          epsilon_f_v.load(&epsilon_f[i]);
+          epsilon_f_new_v.load(&epsilon_f_new[i]);
+          epsilon_c_v.load(&epsilon_c[i]);
+          epsilon_c_t1_v.load(&epsilon_c_t1[i]);
+          epsilon_c_dot_v.load(&epsilon_c_dot[i]);
+
+          // Values from previous state
+          // These were the values that were used in the assembly,
+          // so we must use them in the update step to be consistant.
+          // Need to compute these before we overwrite epsilon_c_t1
+          const VectorizedArray<double> m_s = compute_m_s(epsilon_f_v, epsilon_c_v);
+          const VectorizedArray<double> beta = compute_beta(alpha_v, epsilon_f_v, epsilon_c_v,
+                                                            epsilon_c_dot_v, dt);
+          const VectorizedArray<double> gamma = compute_gamma(alpha_v, epsilon_c_v, epsilon_c_t1_v,
+                                                              epsilon_c_dot_v, dt);
+
+          // Update current state
+          const VectorizedArray<double> epsilon_c_new_v = (m_s*epsilon_f_new_v + gamma)/beta;
+          alpha_v.store(&alpha_t1[i]);
+          epsilon_f_new_v.store(&epsilon_f[i]);
+          epsilon_c_v.store(&epsilon_c_t1[i]);
+          epsilon_c_new_v.store(&epsilon_c[i]);
+          ((epsilon_c_new_v - epsilon_c_v)/dt).store(&epsilon_c_dot[i]);
+        }
+    },
+    1024);
   }
 
 
@@ -793,6 +1037,7 @@ namespace LMM
     void update_fibre_activation (const double time);
     void update_fibre_state ();
     void setup_system ();
+    void assemble_passive_stiffness ();
     void assemble_system (const double time);
     void apply_boundary_conditions ();
     void solve ();
@@ -813,6 +1058,13 @@ namespace LMM
     SparsityPattern      sparsity_pattern;
     SparseMatrix<double> system_matrix;
 
+    // The stiffness of the muscle matrix does not change with time, so it is
+    // assembled only once. If requested, a factorization of the system
+    // matrix is retained as a preconditioner over several timesteps.
+    SparseMatrix<double> passive_stiffness_matrix;
+    SparseDirectUMFPACK  cached_factorization;
+    bool                 have_cached_factorization;
+
     Vector<double>       solution;
     Vector<double>       system_rhs;
 
@@ -826,11 +1078,12 @@ namespace LMM
     const Traction<dim>  traction;
 
     // Local data
-    std::vector< std::vector<MuscleFibre<dim> > > fibre_data;
+    MuscleFibreData<dim> fibre_data;
 
     // Constitutive functions for assembly
-    SymmetricTensor<4,dim> get_stiffness_tensor (const unsigned int cell,
-                                                 const unsigned int q_point_cell) const;
+    SymmetricTensor<4,dim> get_passive_stiffness_tensor () const;
+    double get_fibre_stiffness (const unsigned int cell,
+                                const unsigned int q_point_cell) const;
     SymmetricTensor<2,dim> get_rhs_tensor (const unsigned int cell,
                                            const unsigned int q_point_cell) const;
   };
@@ -845,6 +1098,7 @@ namespace LMM
     fe (FE_Q<dim>(parameters.poly_degree), dim),
     qf_cell (parameters.quad_order),
     qf_face (parameters.quad_order),
+    have_cached_factorization (false),
     t_end (parameters.end_time),
     dt (parameters.delta_t),
     t_ramp_end(parameters.end_ramp_time),
@@ -1084,21 +1338,19 @@ namespace LMM
   template <int dim>
   void LinearMuscleModelProblem<dim>::setup_muscle_fibres ()
   {
-    fibre_data.clear();
     const unsigned int n_cells = triangulation.n_active_cells();
-    fibre_data.resize(n_cells);
     const unsigned int n_q_points_cell = qf_cell.size();
+    fibre_data.reinit(n_cells, n_q_points_cell);
 
     if (parameters.problem == "IsotonicContraction")
       {
-        MuscleFibre<dim> fibre_template (Tensor<1,dim>({1,0,0}));
+        const Tensor<1,dim> direction ({1,0,0});
 
         for (unsigned int cell_no=0; cell_no<triangulation.n_active_cells(); ++cell_no)
           {
-            fibre_data[cell_no].resize(n_q_points_cell);
             for (unsigned int q_point_cell=0; q_point_cell<n_q_points_cell; ++q_point_cell)
               {
-                fibre_data[cell_no][q_point_cell] = fibre_template;
+                fibre_data.set_direction(cell_no, q_point_cell, direction);
               }
           }
       }
@@ -1115,14 +1367,13 @@ namespace LMM
              cell != triangulation.end();
              ++cell, ++cell_no)
           {
-            Assert(cell_no<fibre_data.size(), ExcMessage("Trying to access fibre data not stored for this cell index"));
             fe_values.reinit(cell);
 
-            fibre_data[cell_no].resize(n_q_points_cell);
             for (unsigned int q_point_cell=0; q_point_cell<n_q_points_cell; ++q_point_cell)
               {
                 const Point<dim> pt = fe_values.get_quadrature_points()[q_point_cell];
-                fibre_data[cell_no][q_point_cell] = MuscleFibre<dim>(bicep_geom.direction(pt,parameters.scale));
+                fibre_data.set_direction(cell_no, q_point_cell,
+                                         bicep_geom.direction(pt,parameters.scale));
               }
           }
       }
@@ -1146,47 +1397,61 @@ namespace LMM
   void LinearMuscleModelProblem<dim>::update_fibre_activation (const double time)
   {
     const double u = get_neural_signal(time);
-
-    const unsigned int n_q_points_cell = qf_cell.size();
-    for (unsigned int cell=0; cell<triangulation.n_active_cells(); ++cell)
-      {
-        for (unsigned int q_point_cell=0; q_point_cell<n_q_points_cell; ++q_point_cell)
-          {
-            MuscleFibre<dim> &fibre = fibre_data[cell][q_point_cell];
-            fibre.update_alpha(u,dt);
-          }
-      }
+    fibre_data.update_alpha(u,dt);
   }
 
+  // The fibre strains are evaluated cell-wise in parallel. As each cell
+  // only writes to the data of its own fibres, no data needs to be copied
+  // into a global object. Once all strains are known, the state of all fibres
+  // is updated at once.
   template <int dim>
   void LinearMuscleModelProblem<dim>::update_fibre_state ()
   {
-    const unsigned int n_q_points_cell = qf_cell.size();
+    struct ScratchData
+    {
+      ScratchData (const FiniteElement<dim> &fe,
+                   const Quadrature<dim>    &qf_cell)
+        : fe_values (fe, qf_cell, update_gradients),
+          u_grads (qf_cell.size(), std::vector<Tensor<1,dim> >(dim))
+      {}
 
-    FEValues<dim> fe_values (fe, qf_cell, update_gradients);
+      ScratchData (const ScratchData &rhs)
+        : fe_values (rhs.fe_values.get_fe(),
+                     rhs.fe_values.get_quadrature(),
+                     rhs.fe_values.get_update_flags()),
+          u_grads (rhs.u_grads)
+      {}
 
-    // Displacement gradient
-    std::vector< std::vector< Tensor<1,dim> > > u_grads (n_q_points_cell,
-                                                         std::vector<Tensor<1,dim> >(dim));
+      FEValues<dim> fe_values;
 
-    unsigned int cell_no = 0;
-    for (typename DoFHandler<dim>::active_cell_iterator
-         cell = dof_handler.begin_active();
-         cell!=dof_handler.end(); ++cell, ++cell_no)
-      {
-        Assert(cell_no<fibre_data.size(), ExcMessage("Trying to access fibre data not stored for this cell index"));
-        fe_values.reinit(cell);
-        fe_values.get_function_gradients (solution, u_grads);
+      // Displacement gradient
+      std::vector< std::vector< Tensor<1,dim> > > u_grads;
+    };
+    struct CopyData
+    {};
+
+    WorkStream::run(dof_handler.begin_active(),
+                    dof_handler.end(),
+                    [this](const typename DoFHandler<dim>::active_cell_iterator &cell,
+                           ScratchData &scratch,
+                           CopyData &)
+    {
+      const unsigned int n_q_points_cell = scratch.fe_values.n_quadrature_points;
+      const unsigned int cell_no = cell->active_cell_index();
+      scratch.fe_values.reinit(cell);
+      scratch.fe_values.get_function_gradients (solution, scratch.u_grads);
 
-        for (unsigned int q_point_cell=0; q_point_cell<n_q_points_cell; ++q_point_cell)
-          {
-            Assert(q_point_cell<fibre_data[cell_no].size(), ExcMessage("Trying to access fibre data not stored for this cell and qp index"));
+      for (unsigned int q_point_cell=0; q_point_cell<n_q_points_cell; ++q_point_cell)
+        {
+          const SymmetricTensor<2,dim> strain_tensor = get_small_strain (scratch.u_grads[q_point_cell]);
+          fibre_data.set_fibre_strain(cell_no, q_point_cell, strain_tensor);
+        }
+    },
+    [](const CopyData &) {},
+    ScratchData(fe, qf_cell),
+    CopyData());
 
-            const SymmetricTensor<2,dim> strain_tensor = get_small_strain (u_grads[q_point_cell]);
-            MuscleFibre<dim> &fibre = fibre_data[cell_no][q_point_cell];
-            fibre.update_state(strain_tensor, dt);
-          }
-      }
+    fibre_data.update_state(dt);
   }
 
   // @sect4{LinearMuscleModelProblem::setup_system}
@@ -1209,6 +1474,8 @@ namespace LMM
     sparsity_pattern.compress();
 
     system_matrix.reinit (sparsity_pattern);
+    passive_stiffness_matrix.reinit (sparsity_pattern);
+    have_cached_factorization = false;
 
     solution.reinit (dof_handler.n_dofs());
     system_rhs.reinit (dof_handler.n_dofs());
@@ -1226,25 +1493,13 @@ namespace LMM
 
   template <int dim>
   SymmetricTensor<4,dim>
-  LinearMuscleModelProblem<dim>::get_stiffness_tensor (const unsigned int cell,
-                                                       const unsigned int q_point_cell) const
+  LinearMuscleModelProblem<dim>::get_passive_stiffness_tensor () const
   {
     static const SymmetricTensor<2,dim> I = unit_symmetric_tensor<dim>();
 
-    Assert(cell<fibre_data.size(), ExcMessage("Trying to access fibre data not stored for this cell index"));
-    Assert(q_point_cell<fibre_data[cell].size(), ExcMessage("Trying to access fibre data not stored for this cell and qp index"));
-    const MuscleFibre<dim> &fibre = fibre_data[cell][q_point_cell];
-
     // Matrix
     const double lambda = MuscleMatrix::lambda;
     const double mu = MuscleMatrix::mu;
-    // Fibre
-    const double m_p = fibre.get_m_p();
-    const double m_s = fibre.get_m_s();
-    const double beta = fibre.get_beta(dt);
-    AssertThrow(beta != 0.0, ExcInternalError());
-    const double Cf = T0*(m_p + m_s*(1.0 - m_s/beta));
-    const Tensor<1,dim> &M = fibre.get_M();
 
     SymmetricTensor<4,dim> C;
     for (unsigned int i=0; i < dim; ++i)
@@ -1255,29 +1510,40 @@ namespace LMM
               // Matrix contribution
               C[i][j][k][l] = lambda * I[i][j]*I[k][l]
                               + mu * (I[i][k]*I[j][l] + I[i][l]*I[j][k]);
-
-              // Fibre contribution (Passive + active branches)
-              C[i][j][k][l] += Cf * M[i]*M[j]*M[k]*M[l];
             }
 
     return C;
   }
 
+  // The fibre contribution to the stiffness tensor is
+  // $C_f \, \mathbf{M} \otimes \mathbf{M} \otimes \mathbf{M} \otimes \mathbf{M}$,
+  // so it is fully described by the scalar $C_f$ and the fibre direction.
+  template <int dim>
+  double
+  LinearMuscleModelProblem<dim>::get_fibre_stiffness (const unsigned int cell,
+                                                      const unsigned int q_point_cell) const
+  {
+    // Fibre
+    const double m_p = fibre_data.get_m_p(cell,q_point_cell);
+    const double m_s = fibre_data.get_m_s(cell,q_point_cell);
+    const double beta = fibre_data.get_beta(cell,q_point_cell,dt);
+    AssertThrow(beta != 0.0, ExcInternalError());
+
+    // Fibre contribution (Passive + active branches)
+    return T0*(m_p + m_s*(1.0 - m_s/beta));
+  }
+
   template <int dim>
   SymmetricTensor<2,dim>
   LinearMuscleModelProblem<dim>::get_rhs_tensor (const unsigned int cell,
                                                  const unsigned int q_point_cell) const
   {
-    Assert(cell<fibre_data.size(), ExcMessage("Trying to access fibre data not stored for this cell index"));
-    Assert(q_point_cell<fibre_data[cell].size(), ExcMessage("Trying to access fibre data not stored for this cell and qp index"));
-    const MuscleFibre<dim> &fibre = fibre_data[cell][q_point_cell];
-
-    const double m_s = fibre.get_m_s();
-    const double beta = fibre.get_beta(dt);
-    const double gamma = fibre.get_gamma(dt);
+    const double m_s = fibre_data.get_m_s(cell,q_point_cell);
+    const double beta = fibre_data.get_beta(cell,q_point_cell,dt);
+    const double gamma = fibre_data.get_gamma(cell,q_point_cell,dt);
     AssertThrow(beta != 0.0, ExcInternalError());
     const double Sf = T0*(m_s*gamma/beta);
-    const Tensor<1,dim> &M = fibre.get_M();
+    const Tensor<1,dim> M = fibre_data.get_M(cell,q_point_cell);
 
     SymmetricTensor<2,dim> S;
     for (unsigned int i=0; i < dim; ++i)
@@ -1290,13 +1556,73 @@ namespace LMM
     return S;
   }
 
+  // @sect4{LinearMuscleModelProblem::assemble_passive_stiffness}
+
+  // The contribution of the muscle matrix to the stiffness is independent of
+  // the fibre state, and is therefore assembled only once.
+  template <int dim>
+  void LinearMuscleModelProblem<dim>::assemble_passive_stiffness ()
+  {
+    passive_stiffness_matrix = 0;
+
+    FEValues<dim> fe_values (fe, qf_cell,
+                             update_gradients | update_JxW_values);
+
+    const unsigned int   dofs_per_cell   = fe.dofs_per_cell;
+    const unsigned int   n_q_points_cell = qf_cell.size();
+
+    FullMatrix<double>   cell_matrix (dofs_per_cell, dofs_per_cell);
+    std::vector<types::global_dof_index> local_dof_indices (dofs_per_cell);
+
+    const SymmetricTensor<4,dim> C = get_passive_stiffness_tensor ();
+
+    for (typename DoFHandler<dim>::active_cell_iterator
+         cell = dof_handler.begin_active();
+         cell!=dof_handler.end(); ++cell)
+      {
+        cell_matrix = 0;
+        fe_values.reinit (cell);
+
+        for (unsigned int q_point_cell=0; q_point_cell<n_q_points_cell; ++q_point_cell)
+          for (unsigned int I=0; I<dofs_per_cell; ++I)
+            {
+              const unsigned int
+              component_I = fe.system_to_component_index(I).first;
+
+              for (unsigned int J=0; J<dofs_per_cell; ++J)
+                {
+                  const unsigned int
+                  component_J = fe.system_to_component_index(J).first;
+
+                  for (unsigned int k=0; k < dim; ++k)
+                    for (unsigned int l=0; l < dim; ++l)
+                      cell_matrix(I,J)
+                      += (fe_values.shape_grad(I,q_point_cell)[k] *
+                          C[component_I][k][component_J][l] *
+                          fe_values.shape_grad(J,q_point_cell)[l]) *
+                         fe_values.JxW(q_point_cell);
+                }
+            }
+
+        cell->get_dof_indices (local_dof_indices);
+        for (unsigned int i=0; i<dofs_per_cell; ++i)
+          for (unsigned int j=0; j<dofs_per_cell; ++j)
+            passive_stiffness_matrix.add (local_dof_indices[i],
+                                          local_dof_indices[j],
+                                          cell_matrix(i,j));
+      }
+  }
+
   // @sect4{LinearMuscleModelProblem::assemble_system}
 
+  // At each timestep the system matrix is reinitialised with the passive
+  // stiffness, to which only the fibre contribution is added.
   template <int dim>
   void LinearMuscleModelProblem<dim>::assemble_system (const double time)
   {
     // Reset system
     system_matrix = 0;
+    system_matrix.add (1.0, passive_stiffness_matrix);
     system_rhs = 0;
 
     FEValues<dim> fe_values (fe, qf_cell,
@@ -1315,6 +1641,10 @@ namespace LMM
 
     std::vector<types::global_dof_index> local_dof_indices (dofs_per_cell);
 
+    // Fibre contribution to the shape function gradients, i.e.
+    // $M_{c(I)} \, \nabla N_I \cdot \mathbf{M}$
+    std::vector<double>  fibre_grads (dofs_per_cell);
+
     // Loading
     std::vector<Vector<double> > body_force_values (n_q_points_cell,
                                                     Vector<double>(dim));
@@ -1335,29 +1665,25 @@ namespace LMM
 
         for (unsigned int q_point_cell=0; q_point_cell<n_q_points_cell; ++q_point_cell)
           {
-            const SymmetricTensor<4,dim> C = get_stiffness_tensor (cell_no, q_point_cell);
+            const double Cf = get_fibre_stiffness (cell_no, q_point_cell);
+            const Tensor<1,dim> M = fibre_data.get_M(cell_no, q_point_cell);
             const SymmetricTensor<2,dim> R = get_rhs_tensor(cell_no, q_point_cell);
 
+            // As the fibre stiffness tensor has rank one, its contribution
+            // to the cell matrix is the outer product of the fibre gradients.
             for (unsigned int I=0; I<dofs_per_cell; ++I)
               {
                 const unsigned int
                 component_I = fe.system_to_component_index(I).first;
-
-                for (unsigned int J=0; J<dofs_per_cell; ++J)
-                  {
-                    const unsigned int
-                    component_J = fe.system_to_component_index(J).first;
-
-                    for (unsigned int k=0; k < dim; ++k)
-                      for (unsigned int l=0; l < dim; ++l)
-                        cell_matrix(I,J)
-                        += (fe_values.shape_grad(I,q_point_cell)[k] *
-                            C[component_I][k][component_J][l] *
-                            fe_values.shape_grad(J,q_point_cell)[l]) *
-                           fe_values.JxW(q_point_cell);
-                  }
+                fibre_grads[I] = M[component_I] * (fe_values.shape_grad(I,q_point_cell) * M);
               }
 
+            for (unsigned int I=0; I<dofs_per_cell; ++I)
+              for (unsigned int J=0; J<dofs_per_cell; ++J)
+                cell_matrix(I,J)
+                += fibre_grads[I] * Cf * fibre_grads[J] *
+                   fe_values.JxW(q_point_cell);
+
             for (unsigned int I=0; I<dofs_per_cell; ++I)
               {
                 const unsigned int
@@ -1638,11 +1964,48 @@ namespace LMM
     SolverControl solver_control (system_matrix.m(), 1e-12);
     SolverCG<>    cg (solver_control);
 
-    PreconditionSSOR<> preconditioner;
-    preconditioner.initialize(system_matrix, 1.2);
+    if (parameters.preconditioner_type == "ssor")
+      {
+        PreconditionSSOR<> preconditioner;
+        preconditioner.initialize(system_matrix, 1.2);
+
+        cg.solve (system_matrix, solution, system_rhs,
+                  preconditioner);
+      }
+    else if (parameters.preconditioner_type == "factorization")
+      {
+        // The change in the system matrix between timesteps stems only from
+        // the fibre contribution, so the factorization of the matrix from an
+        // earlier timestep remains an effective preconditioner. Only when
+        // it no longer provides quick convergence do we refactorize the
+        // current system matrix and solve again.
+        bool solved = false;
+        if (have_cached_factorization == true)
+          {
+            SolverControl solver_control_cached (parameters.max_iterations_cached_factorization,
+                                                 1e-12);
+            SolverCG<>    cg_cached (solver_control_cached);
+            try
+              {
+                cg_cached.solve (system_matrix, solution, system_rhs,
+                                 cached_factorization);
+                solved = true;
+              }
+            catch (const SolverControl::NoConvergence &)
+              {}
+          }
+
+        if (solved == false)
+          {
+            cached_factorization.initialize(system_matrix);
+            have_cached_factorization = true;
 
-    cg.solve (system_matrix, solution, system_rhs,
-              preconditioner);
+            cg.solve (system_matrix, solution, system_rhs,
+                      cached_factorization);
+          }
+      }
+    else
+      AssertThrow(false, ExcNotImplemented());
 
     hanging_node_constraints.distribute (solution);
   }
@@ -1730,19 +2093,18 @@ namespace LMM
 
           for (unsigned int q_point_cell=0; q_point_cell<n_q_points_cell; ++q_point_cell, ++fibre_no)
             {
-              const MuscleFibre<dim> &fibre = fibre_data[cell_no][q_point_cell];
               output_points[fibre_no] = fe_values.get_quadrature_points()[q_point_cell]; // Position
               for (unsigned int d=0; d<dim; ++d)
                 output_displacements[fibre_no][d] = u_values[q_point_cell][d]; // Displacement
               // Direction (spatial configuration)
-              output_directions[fibre_no] = get_deformation_gradient(u_grads[q_point_cell])*fibre.get_M();
+              output_directions[fibre_no] = get_deformation_gradient(u_grads[q_point_cell])*fibre_data.get_M(cell_no,q_point_cell);
               output_directions[fibre_no] /= output_directions[fibre_no].norm();
 
               // Fibre values
-              output_values[0][fibre_no] = fibre.get_alpha();
-              output_values[1][fibre_no] = fibre.get_epsilon_f();
-              output_values[2][fibre_no] = fibre.get_epsilon_c();
-              output_values[3][fibre_no] = fibre.get_epsilon_c_dot();
+              output_values[0][fibre_no] = fibre_data.get_alpha(cell_no,q_point_cell);
+              output_values[1][fibre_no] = fibre_data.get_epsilon_f(cell_no,q_point_cell);
+              output_values[2][fibre_no] = fibre_data.get_epsilon_c(cell_no,q_point_cell);
+              output_values[3][fibre_no] = fibre_data.get_epsilon_c_dot(cell_no,q_point_cell);
             }
         }
 
@@ -1883,6 +2245,7 @@ namespace LMM
   {
     make_grid();
     setup_system ();
+    assemble_passive_stiffness ();
     setup_muscle_fibres ();
 
 //    const bool do_grid_refinement = false;
@@ -19,17 +19,21 @@
 
 
 
+#include <deal.II/base/aligned_vector.h>
 #include <deal.II/base/timer.h>
 #include <deal.II/base/multithread_info.h>
+#include <deal.II/base/vectorization.h>
 #include <deal.II/grid/tria.h>
 #include <deal.II/dofs/dof_handler.h>
 #include <deal.II/grid/grid_generator.h>
+#include <deal.II/grid/grid_tools.h>
 #include <deal.II/grid/tria_accessor.h>
 #include <deal.II/grid/tria_iterator.h>
 #include <deal.II/dofs/dof_accessor.h>
 #include <deal.II/fe/fe_q.h>
 #include <deal.II/dofs/dof_tools.h>
 #include <deal.II/fe/fe_values.h>
+#include <deal.II/fe/mapping_q.h>
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/base/function.h>
 #include <deal.II/numerics/vector_tools.h>
@@ -44,9 +48,20 @@
 
 #include <deal.II/numerics/data_out.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <sstream>
+#include <thread>
 
 #include <deal.II/base/logstream.h>
 
@@ -74,26 +89,78 @@ namespace ForwardSimulator
   public:
     virtual Vector<double> evaluate(const Vector<double> &coefficients) = 0;
 
+    // Evaluate the forward model for several coefficient vectors at once.
+    // The default implementation simply calls `evaluate()` for each of
+    // them, but derived classes may be able to do this more efficiently.
+    virtual std::vector<Vector<double>>
+    evaluate_batch(const std::vector<Vector<double>> &coefficients);
+
     virtual ~Interface() = default;
   };
 
 
 
+  std::vector<Vector<double>>
+  Interface::evaluate_batch(const std::vector<Vector<double>> &coefficients)
+  {
+    std::vector<Vector<double>> measurements;
+    measurements.reserve(coefficients.size());
+    for (const auto &c : coefficients)
+      measurements.emplace_back(evaluate(c));
+    return measurements;
+  }
+
+
+
+  // The `PoissonSolver` class can solve its linear systems in one of two
+  // ways. By default, every solve starts from a zero initial guess and uses
+  // a freshly computed ILU preconditioner, so that the result of
+  // `evaluate()` does not depend on which coefficients were evaluated
+  // before. But when used inside a Markov chain, consecutive coefficient
+  // vectors are only small perturbations of each other, and so the
+  // solution of the previous linear system is a good starting guess for
+  // the next one, and the ILU of an earlier matrix is a good
+  // preconditioner. In the "chain-aware" mode, we therefore keep both
+  // around and only recompute the preconditioner if the number of CG
+  // iterations grows by more than a given factor over the number of
+  // iterations of the first solve after the last recomputation (or if the
+  // solver fails to converge with the old preconditioner). A fixed
+  // threshold would have to be calibrated for every mesh and polynomial
+  // degree, whereas this ratio only measures how much the preconditioner
+  // has deteriorated.
+  enum class SolverMode
+  {
+    independent_solves,
+    chain_aware
+  };
+
+
+
   template <int dim>
   class PoissonSolver : public Interface
   {
   public:
     PoissonSolver(const unsigned int global_refinements,
                   const unsigned int fe_degree,
-                  const std::string &dataset_name);
+                  const std::string &dataset_name,
+                  const SolverMode   solver_mode = SolverMode::independent_solves,
+                  const double       refactorization_iteration_ratio = 1.5);
     virtual Vector<double>
     evaluate(const Vector<double> &coefficients) override;
 
+    virtual std::vector<Vector<double>>
+    evaluate_batch(const std::vector<Vector<double>> &coefficients) override;
+
+    void print_solver_statistics(std::ostream &out) const;
+
   private:
     void make_grid(const unsigned int global_refinements);
     void setup_system();
     void assemble_system(const Vector<double> &coefficients);
     void solve();
+    void solve_batch(
+      const std::vector<const Vector<double> *> &coefficients,
+      AlignedVector<VectorizedArray<double>> &     batch_solution) const;
     void output_results(const Vector<double> &coefficients) const;
 
     Triangulation<dim>        triangulation;
@@ -103,6 +170,23 @@ namespace ForwardSimulator
     FullMatrix<double>        cell_matrix;
     Vector<double>            cell_rhs;
     std::map<types::global_dof_index,double> boundary_values;
+    std::vector<types::global_dof_index>     boundary_dofs;
+
+    // The system matrix as a linear function of the coefficients, see
+    // setup_system(): the value of the $e$th nonzero entry is
+    // $\sum_r w_{e,r} a_r$ where the sum runs over the pairs $(r,w_{e,r})$
+    // stored at positions `entry_contribution_start[e]` to
+    // `entry_contribution_start[e+1]` of the following two arrays.
+    std::vector<unsigned int> entry_contribution_start;
+    std::vector<unsigned int> entry_contribution_region;
+    std::vector<double>       entry_contribution_weight;
+
+    // A copy of the row structure of the sparsity pattern in compressed
+    // row format, for use in evaluate_batch(). Because the first entry of
+    // each row of a square `SparsityPattern` is the diagonal entry,
+    // `row_start[i]` is also the index of the diagonal entry of row $i$.
+    std::vector<unsigned int> row_start;
+    std::vector<unsigned int> column_index;
 
     SparsityPattern           sparsity_pattern;
     SparseMatrix<double>      system_matrix;
@@ -115,6 +199,16 @@ namespace ForwardSimulator
     SparsityPattern           measurement_sparsity;
     SparseMatrix<double>      measurement_matrix;
 
+    const SolverMode   solver_mode;
+    const double       refactorization_iteration_ratio;
+
+    SparseILU<double> preconditioner;
+    bool              preconditioner_is_current;
+    unsigned int      iterations_after_refactorization;
+
+    unsigned long long int n_cg_iterations;
+    unsigned int           n_refactorizations;
+
     TimerOutput  timer;
     unsigned int nth_evaluation;
 
@@ -126,13 +220,26 @@ namespace ForwardSimulator
   template <int dim>
   PoissonSolver<dim>::PoissonSolver(const unsigned int global_refinements,
                                     const unsigned int fe_degree,
-                                    const std::string &dataset_name)
+                                    const std::string &dataset_name,
+                                    const SolverMode   solver_mode,
+                                    const double       refactorization_iteration_ratio)
     : fe(fe_degree)
     , dof_handler(triangulation)
+    , solver_mode(solver_mode)
+    , refactorization_iteration_ratio(refactorization_iteration_ratio)
+    , preconditioner_is_current(false)
+    , iterations_after_refactorization(0)
+    , n_cg_iterations(0)
+    , n_refactorizations(0)
     , timer(std::cout, TimerOutput::summary, TimerOutput::cpu_times)
     , nth_evaluation(0)
     , dataset_name(dataset_name)
   {
+    Assert(refactorization_iteration_ratio >= 1,
+           ExcMessage("The ratio of iteration counts that triggers a "
+                      "recomputation of the preconditioner must be at "
+                      "least one."));
+
     make_grid(global_refinements);
     setup_system();
   }
@@ -186,28 +293,55 @@ namespace ForwardSimulator
         for (unsigned int y = 1; y <= n_points_per_direction; ++y)
           measurement_points.emplace_back(x * dx, y * dx);
 
-      // First build a full matrix of the evaluation process. We do this
-      // even though the matrix is really sparse -- but we don't know
-      // which entries are nonzero. Later, the `copy_from()` function
-      // calls build a sparsity pattern and a sparse matrix from
-      // the dense matrix.
-      Vector<double>     weights(dof_handler.n_dofs());
-      FullMatrix<double> full_measurement_matrix(n_points_per_direction *
-                                                   n_points_per_direction,
-                                                 dof_handler.n_dofs());
+      // Point evaluation is a linear operation on the solution vector that
+      // only involves the degrees of freedom of the cell in which the
+      // point lies. We therefore find this cell, evaluate the shape
+      // functions at the point's location in the reference cell, and put
+      // these values into the row of the measurement matrix that
+      // corresponds to this point. (This is what
+      // `VectorTools::create_point_source_vector()` does as well, except
+      // that it creates a vector of size `n_dofs` for each point.) To this
+      // end, we first build the sparsity pattern, and then fill the matrix
+      // in a second pass. For points that lie on the boundary between
+      // cells, the cell found is one of the adjacent ones, but because the
+      // finite element is continuous, the result of the point evaluation
+      // does not depend on which one.
+      const MappingQ<dim> mapping(1);
 
+      const unsigned int dofs_per_cell = fe.dofs_per_cell;
+      std::vector<std::vector<types::global_dof_index>> point_dof_indices(
+        measurement_points.size(),
+        std::vector<types::global_dof_index>(dofs_per_cell));
+      std::vector<Vector<double>> point_weights(measurement_points.size(),
+                                                Vector<double>(dofs_per_cell));
+
+      DynamicSparsityPattern dsp(measurement_points.size(),
+                                 dof_handler.n_dofs());
       for (unsigned int index = 0; index < measurement_points.size(); ++index)
         {
-          VectorTools::create_point_source_vector(dof_handler,
-                                                  measurement_points[index],
-                                                  weights);
-          for (unsigned int i = 0; i < dof_handler.n_dofs(); ++i)
-            full_measurement_matrix(index, i) = weights(i);
+          const auto cell_and_reference_point =
+            GridTools::find_active_cell_around_point(mapping,
+                                                     dof_handler,
+                                                     measurement_points[index]);
+
+          cell_and_reference_point.first->get_dof_indices(
+            point_dof_indices[index]);
+          for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            point_weights[index](i) =
+              fe.shape_value(i, cell_and_reference_point.second);
+
+          dsp.add_entries(index,
+                          point_dof_indices[index].begin(),
+                          point_dof_indices[index].end());
         }
 
-      measurement_sparsity.copy_from(full_measurement_matrix);
+      measurement_sparsity.copy_from(dsp);
       measurement_matrix.reinit(measurement_sparsity);
-      measurement_matrix.copy_from(full_measurement_matrix);
+      for (unsigned int index = 0; index < measurement_points.size(); ++index)
+        for (unsigned int i = 0; i < dofs_per_cell; ++i)
+          measurement_matrix.set(index,
+                                 point_dof_indices[index][i],
+                                 point_weights[index](i));
     }
 
     // Next build the mapping from cell to the index in the 64-element
@@ -258,58 +392,203 @@ namespace ForwardSimulator
                                                0,
                                                Functions::ZeroFunction<dim>(),
                                                boundary_values);
+      for (const auto &boundary_value : boundary_values)
+        boundary_dofs.push_back(boundary_value.first);
+    }
+
+    // The only thing that changes from one sample to the next are the 64
+    // coefficients, and the system matrix depends linearly on them: It can
+    // be written as $A(\mathbf a) = \sum_r a_r A_r$ where $A_r$ is the
+    // matrix assembled with a unit coefficient on the cells of region $r$
+    // and zero everywhere else. Rather than storing 64 matrices $A_r$,
+    // most of whose entries are zero, we store for each nonzero entry of
+    // the matrix the (at most four, for the $Q_1$ element) regions in
+    // whose matrices $A_r$ this entry is nonzero, along with the values of
+    // these entries. Assembling the matrix for a given coefficient vector
+    // is then a single pass over the matrix entries in the order in which
+    // they are stored.
+    //
+    // We can also already take care of boundary values here: Since the
+    // boundary values are zero, `MatrixTools::apply_boundary_values()`
+    // would zero out the off-diagonal entries of rows and columns that
+    // correspond to boundary degrees of freedom, keep the diagonal entry,
+    // and set the corresponding entries of the right hand side vector to
+    // the diagonal entry times the boundary value -- i.e., to zero. We
+    // simply omit the off-diagonal contributions to these rows and columns
+    // from the start. Because the right hand side does not depend on the
+    // coefficient, it can then be assembled once and for all, too.
+    {
+      const unsigned int dofs_per_cell = fe.dofs_per_cell;
+
+      std::vector<bool> is_boundary_dof(dof_handler.n_dofs(), false);
+      for (const auto dof : boundary_dofs)
+        is_boundary_dof[dof] = true;
+
+      std::vector<std::map<unsigned int, double>> entry_contributions(
+        sparsity_pattern.n_nonzero_elements());
+
+      std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+
+      system_rhs = 0;
+      for (const auto &cell : dof_handler.active_cell_iterators())
+        {
+          cell->get_dof_indices(local_dof_indices);
+          for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            {
+              for (unsigned int j = 0; j < dofs_per_cell; ++j)
+                if ((local_dof_indices[i] == local_dof_indices[j]) ||
+                    (!is_boundary_dof[local_dof_indices[i]] &&
+                     !is_boundary_dof[local_dof_indices[j]]))
+                  entry_contributions[sparsity_pattern(local_dof_indices[i],
+                                                       local_dof_indices[j])]
+                                     [cell->user_index()] += cell_matrix(i, j);
+
+              if (!is_boundary_dof[local_dof_indices[i]])
+                system_rhs(local_dof_indices[i]) += cell_rhs(i);
+            }
+        }
+
+      entry_contribution_start.resize(entry_contributions.size() + 1);
+      entry_contribution_start[0] = 0;
+      for (unsigned int e = 0; e < entry_contributions.size(); ++e)
+        {
+          for (const auto &contribution : entry_contributions[e])
+            {
+              entry_contribution_region.push_back(contribution.first);
+              entry_contribution_weight.push_back(contribution.second);
+            }
+          entry_contribution_start[e + 1] = entry_contribution_region.size();
+        }
+
+      row_start.resize(sparsity_pattern.n_rows() + 1);
+      row_start[0] = 0;
+      for (unsigned int row = 0; row < sparsity_pattern.n_rows(); ++row)
+        {
+          for (auto p = sparsity_pattern.begin(row);
+               p != sparsity_pattern.end(row);
+               ++p)
+            column_index.push_back(p->column());
+          row_start[row + 1] = column_index.size();
+        }
+      Assert(column_index.size() == entry_contribution_start.size() - 1,
+             ExcInternalError());
     }
   }
 
 
 
-  // Given that we have pre-built the matrix and right hand side contributions
-  // for a (representative) cell, the function that assembles the matrix is
-  // pretty short and straightforward:
+  // Given that we have pre-built the matrix as a linear function of the
+  // coefficients, and the right hand side (which does not depend on the
+  // coefficients at all), the function that assembles the linear system
+  // only needs to evaluate this linear function. The entries of a
+  // `SparseMatrix` are traversed by its iterators in the same order in
+  // which `SparsityPattern::operator()` numbers them, so we can walk
+  // through matrix entries and precomputed contributions in lockstep.
+  //
+  // The last step resets the boundary entries of the solution vector to
+  // their (zero) boundary values, which is what
+  // `MatrixTools::apply_boundary_values()` used to do.
   template <int dim>
   void PoissonSolver<dim>::assemble_system(const Vector<double> &coefficients)
   {
     Assert(coefficients.size() == 64, ExcInternalError());
 
-    system_matrix = 0;
-    system_rhs    = 0;
+    const unsigned int *region = entry_contribution_region.data();
+    const double       *weight = entry_contribution_weight.data();
+
+    unsigned int e = 0;
+    for (auto entry = system_matrix.begin(); entry != system_matrix.end();
+         ++entry, ++e)
+      {
+        double value = 0;
+        for (unsigned int c = entry_contribution_start[e];
+             c < entry_contribution_start[e + 1];
+             ++c)
+          value += weight[c] * coefficients[region[c]];
+        entry->value() = value;
+      }
+    Assert(e == entry_contribution_start.size() - 1, ExcInternalError());
+
+    for (const auto dof : boundary_dofs)
+      solution(dof) = 0;
+  }
 
-    const unsigned int dofs_per_cell = fe.dofs_per_cell;
 
-    std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+  // The same is true for the function that solves the linear system, at
+  // least in the default mode where every solve is independent of the
+  // previous ones.
+  //
+  // In chain-aware mode, the solution vector is not reset and so the
+  // solution of the previous linear system serves as starting guess, and
+  // we reuse the preconditioner until the number of iterations indicates
+  // that the matrix it was computed from has become too different from
+  // the current one: We remember the number of iterations of the solve
+  // right after the preconditioner was computed, and compute a new one
+  // once a solve takes more than `refactorization_iteration_ratio` times
+  // as many iterations. If the solver does not converge at all with the
+  // old preconditioner, we recompute the preconditioner and try again.
+  template <int dim>
+  void PoissonSolver<dim>::solve()
+  {
+    SolverControl control(100, 1e-10*system_rhs.l2_norm());
+    SolverCG<> solver(control);
 
-    for (const auto &cell : dof_handler.active_cell_iterators())
+    if (solver_mode == SolverMode::independent_solves)
       {
-        const double coefficient = coefficients(cell->user_index());
+        SparseILU<double> ilu;
+        ilu.initialize(system_matrix);
+        ++n_refactorizations;
 
-        cell->get_dof_indices(local_dof_indices);
-        for (unsigned int i = 0; i < dofs_per_cell; ++i)
+        solution = 0;
+        solver.solve(system_matrix, solution, system_rhs, ilu);
+      }
+    else
+      {
+        bool is_first_solve_after_refactorization = false;
+        if (preconditioner_is_current == false)
           {
-            for (unsigned int j = 0; j < dofs_per_cell; ++j)
-              system_matrix.add(local_dof_indices[i],
-                                local_dof_indices[j],
-                                coefficient * cell_matrix(i, j));
+            preconditioner.initialize(system_matrix);
+            preconditioner_is_current = true;
+            ++n_refactorizations;
+            is_first_solve_after_refactorization = true;
+          }
+
+        try
+          {
+            solver.solve(system_matrix, solution, system_rhs, preconditioner);
+          }
+        catch (const SolverControl::NoConvergence &)
+          {
+            n_cg_iterations += control.last_step();
+
+            preconditioner.initialize(system_matrix);
+            ++n_refactorizations;
+            is_first_solve_after_refactorization = true;
 
-            system_rhs(local_dof_indices[i]) += cell_rhs(i);
+            solver.solve(system_matrix, solution, system_rhs, preconditioner);
           }
+
+        if (is_first_solve_after_refactorization)
+          iterations_after_refactorization = control.last_step();
+        else if (control.last_step() >
+                 refactorization_iteration_ratio *
+                   std::max(iterations_after_refactorization, 1U))
+          preconditioner_is_current = false;
       }
 
-    MatrixTools::apply_boundary_values(boundary_values,
-                                       system_matrix,
-                                       solution,
-                                       system_rhs);
+    n_cg_iterations += control.last_step();
   }
 
 
-  // The same is true for the function that solves the linear system:
+
   template <int dim>
-  void PoissonSolver<dim>::solve()
+  void PoissonSolver<dim>::print_solver_statistics(std::ostream &out) const
   {
-    SparseILU<double> ilu;
-    ilu.initialize(system_matrix);
-    SolverControl control(100, 1e-10*system_rhs.l2_norm());
-    SolverCG<> solver(control);
-    solver.solve(system_matrix, solution, system_rhs, ilu);
+    out << "   Linear solves: " << nth_evaluation
+        << ", CG iterations: " << n_cg_iterations << " ("
+        << (nth_evaluation > 0 ? 1. * n_cg_iterations / nth_evaluation : 0.)
+        << " per solve), preconditioner computations: "
+        << n_refactorizations << std::endl;
   }
 
 
@@ -386,7 +665,214 @@ namespace ForwardSimulator
 
     ++nth_evaluation;
     if (nth_evaluation % 10000 == 0)
-      timer.print_summary();
+      {
+        timer.print_summary();
+        print_solver_statistics(std::cout);
+      }
+
+    return measurements;
+  }
+
+
+
+  // When we need to evaluate the forward model for several coefficient
+  // vectors at once (for example, for several proposals in a
+  // multiple-try Metropolis method), we can exploit that the linear systems
+  // for all of them share the same sparsity pattern and the same right hand
+  // side and differ only in the values of the matrix entries. We therefore
+  // store the matrices for as many coefficient vectors as fit into the lanes
+  // of a `VectorizedArray<double>` (e.g., eight with AVX-512) interleaved,
+  // i.e., as one array of `VectorizedArray` objects whose $v$th lane holds
+  // the matrix for the $v$th coefficient vector, and run a conjugate
+  // gradient method on all of these systems at the same time: All
+  // operations are then applied to all lanes at once, and only the scalar
+  // step lengths differ between lanes.
+  //
+  // An ILU decomposition does not vectorize well in this way, so we use a
+  // symmetric successive over-relaxation (SSOR) preconditioner instead,
+  // which only needs the matrix entries themselves. The iteration stops
+  // once the residuals of all systems satisfy the same criterion as in
+  // solve(); systems that have converged earlier are kept unchanged by
+  // setting their step lengths to zero.
+  template <int dim>
+  void PoissonSolver<dim>::solve_batch(
+    const std::vector<const Vector<double> *> &coefficients,
+    AlignedVector<VectorizedArray<double>> &     x) const
+  {
+    constexpr unsigned int n_lanes = VectorizedArray<double>::size();
+    Assert(coefficients.size() == n_lanes, ExcInternalError());
+
+    const unsigned int n       = row_start.size() - 1;
+    const unsigned int n_nonzero = column_index.size();
+
+    // First form the interleaved matrix entries, in the same way as
+    // assemble_system() does for a single coefficient vector:
+    AlignedVector<VectorizedArray<double>> A(n_nonzero);
+    for (unsigned int e = 0; e < n_nonzero; ++e)
+      {
+        VectorizedArray<double> value = 0.;
+        for (unsigned int c = entry_contribution_start[e];
+             c < entry_contribution_start[e + 1];
+             ++c)
+          {
+            VectorizedArray<double> coefficient;
+            for (unsigned int v = 0; v < n_lanes; ++v)
+              coefficient[v] =
+                (*coefficients[v])[entry_contribution_region[c]];
+            value += entry_contribution_weight[c] * coefficient;
+          }
+        A[e] = value;
+      }
+
+    const auto vmult = [&](AlignedVector<VectorizedArray<double>> &      dst,
+                           const AlignedVector<VectorizedArray<double>> &src) {
+      for (unsigned int i = 0; i < n; ++i)
+        {
+          VectorizedArray<double> sum = 0.;
+          for (unsigned int e = row_start[i]; e < row_start[i + 1]; ++e)
+            sum += A[e] * src[column_index[e]];
+          dst[i] = sum;
+        }
+    };
+
+    const double omega = 1.2;
+    const auto   precondition =
+      [&](AlignedVector<VectorizedArray<double>> &      dst,
+          const AlignedVector<VectorizedArray<double>> &src) {
+        // Forward sweep, solving $(D/\omega + L) y = r$:
+        for (unsigned int i = 0; i < n; ++i)
+          {
+            VectorizedArray<double> sum = src[i];
+            for (unsigned int e = row_start[i] + 1; e < row_start[i + 1]; ++e)
+              if (column_index[e] < i)
+                sum -= A[e] * dst[column_index[e]];
+            dst[i] = omega * sum / A[row_start[i]];
+          }
+        // Scaling by $\frac{2-\omega}{\omega} D$:
+        for (unsigned int i = 0; i < n; ++i)
+          dst[i] *= (2. - omega) / omega * A[row_start[i]];
+        // Backward sweep, solving $(D/\omega + U) z = t$:
+        for (unsigned int i = n; i-- > 0;)
+          {
+            VectorizedArray<double> sum = dst[i];
+            for (unsigned int e = row_start[i] + 1; e < row_start[i + 1]; ++e)
+              if (column_index[e] > i)
+                sum -= A[e] * dst[column_index[e]];
+            dst[i] = omega * sum / A[row_start[i]];
+          }
+      };
+
+    const auto dot = [n](const AlignedVector<VectorizedArray<double>> &a,
+                         const AlignedVector<VectorizedArray<double>> &b) {
+      VectorizedArray<double> sum = 0.;
+      for (unsigned int i = 0; i < n; ++i)
+        sum += a[i] * b[i];
+      return sum;
+    };
+
+    // Then the conjugate gradient method, starting from a zero initial
+    // guess (so that the initial residual is simply the right hand side):
+    AlignedVector<VectorizedArray<double>> r(n), z(n), p(n), Ap(n);
+    x.resize(n);
+    x.fill(VectorizedArray<double>(0.));
+    for (unsigned int i = 0; i < n; ++i)
+      r[i] = system_rhs(i);
+
+    const double tolerance = 1e-10 * system_rhs.l2_norm();
+
+    precondition(z, r);
+    p                          = z;
+    VectorizedArray<double> rz = dot(r, z);
+
+    for (unsigned int iteration = 0;; ++iteration)
+      {
+        const VectorizedArray<double> r_norm_sqr = dot(r, r);
+        bool                          all_converged = true;
+        for (unsigned int v = 0; v < n_lanes; ++v)
+          if (r_norm_sqr[v] > tolerance * tolerance)
+            all_converged = false;
+        if (all_converged)
+          break;
+
+        AssertThrow(iteration < 1000,
+                    ExcMessage("The batched CG solver did not converge."));
+
+        vmult(Ap, p);
+        const VectorizedArray<double> pAp = dot(p, Ap);
+
+        VectorizedArray<double> alpha;
+        for (unsigned int v = 0; v < n_lanes; ++v)
+          alpha[v] = (r_norm_sqr[v] > tolerance * tolerance ? rz[v] / pAp[v] :
+                                                              0.);
+
+        for (unsigned int i = 0; i < n; ++i)
+          {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+          }
+
+        precondition(z, r);
+        const VectorizedArray<double> rz_new = dot(r, z);
+
+        VectorizedArray<double> beta;
+        for (unsigned int v = 0; v < n_lanes; ++v)
+          beta[v] = (alpha[v] != 0. ? rz_new[v] / rz[v] : 0.);
+        rz = rz_new;
+
+        for (unsigned int i = 0; i < n; ++i)
+          p[i] = z[i] + beta * p[i];
+      }
+  }
+
+
+
+  // The function that drives the batched evaluation then only needs to
+  // split the given coefficient vectors into groups of as many vectors as
+  // there are lanes in a `VectorizedArray` (padding the last group by
+  // repeating its last element), solve, and apply the measurement matrix
+  // to the solution in each lane.
+  template <int dim>
+  std::vector<Vector<double>> PoissonSolver<dim>::evaluate_batch(
+    const std::vector<Vector<double>> &coefficients)
+  {
+    constexpr unsigned int n_lanes = VectorizedArray<double>::size();
+
+    std::vector<Vector<double>> measurements(
+      coefficients.size(), Vector<double>(measurement_matrix.m()));
+
+    AlignedVector<VectorizedArray<double>> batch_solution;
+    Vector<double>                       lane_solution(dof_handler.n_dofs());
+
+    for (unsigned int first = 0; first < coefficients.size(); first += n_lanes)
+      {
+        const unsigned int n_filled =
+          std::min<unsigned int>(n_lanes, coefficients.size() - first);
+
+        std::vector<const Vector<double> *> lane_coefficients(n_lanes);
+        for (unsigned int v = 0; v < n_lanes; ++v)
+          {
+            lane_coefficients[v] =
+              &coefficients[first + std::min(v, n_filled - 1)];
+            Assert(lane_coefficients[v]->size() == 64, ExcInternalError());
+          }
+
+        {
+          TimerOutput::Scope section(timer, "Solving batched linear systems");
+          solve_batch(lane_coefficients, batch_solution);
+        }
+
+        {
+          TimerOutput::Scope section(timer, "Postprocessing");
+          for (unsigned int v = 0; v < n_filled; ++v)
+            {
+              for (unsigned int i = 0; i < lane_solution.size(); ++i)
+                lane_solution(i) = batch_solution[i][v];
+              measurement_matrix.vmult(measurements[first + v], lane_solution);
+            }
+        }
+      }
+
+    nth_evaluation += coefficients.size();
 
     return measurements;
   }
@@ -601,8 +1087,41 @@ namespace ProposalGenerator
 // probability distribution we are sampling here to at least six
 // digits of accuracy, and do not want to be limited by the precision
 // of the output.
+//
+// For very long runs, formatting the output as text and flushing it to
+// disk after every sample can take more time than the forward solves. The
+// sampler can therefore alternatively write samples in binary format:
+// Each record then consists of the log posterior as a `double`, the number
+// of accepted samples as a 64-bit unsigned integer, and the 64 entries of
+// the sample as `double`s -- i.e., 528 bytes per sample, in the byte order of
+// the machine. In either format, the file is only flushed every
+// `flush_interval` samples; for binary output, records are collected
+// in a buffer until then.
+//
+// Finally, the sampler can make use of the batched evaluation of the
+// forward model via `ForwardSimulator::Interface::evaluate_batch()`. As
+// long as proposals are rejected, the current sample does not change, and
+// so the next `batch_size` proposals are all perturbations of the same
+// sample and can be drawn ahead of time. We evaluate them in one batch
+// and then go through them one by one with the usual accept/reject test.
+// Once a proposal is accepted, the remaining ones in the batch were drawn
+// from the wrong distribution and are discarded, and the next batch is
+// drawn around the new sample. Since every proposal that is tested is
+// still drawn independently from the proposal distribution around the
+// current sample, this produces exactly the same Markov chain as the
+// unbatched algorithm (for a different sequence of random numbers); with
+// an acceptance rate of around 0.24, about four of eight proposals of a
+// batch are used on average.
 namespace Sampler
 {
+  enum class OutputFormat
+  {
+    text,
+    binary
+  };
+
+
+
   class MetropolisHastings
   {
   public:
@@ -611,12 +1130,22 @@ namespace Sampler
                        const LogPrior::Interface &         prior,
                        const ProposalGenerator::Interface &proposal_generator,
                        const unsigned int                  random_seed,
-                       const std::string &                 dataset_name);
-
-    void sample(const Vector<double> &starting_guess,
-                const unsigned int    n_samples);
-
-  private:
+                       const std::string &                 dataset_name,
+                       const OutputFormat output_format  = OutputFormat::text,
+                       const unsigned int flush_interval = 1,
+                       const unsigned int batch_size     = 1);
+
+    virtual ~MetropolisHastings();
+
+    // Run the chain for `n_samples` samples. If a `sample_callback` is
+    // given, it is called with every sample written to the output file; if
+    // it returns `false`, the chain stops early.
+    virtual void sample(const Vector<double> &starting_guess,
+                        const unsigned int    n_samples,
+                        const std::function<bool(const Vector<double> &)>
+                          &sample_callback = {});
+
+  protected:
     ForwardSimulator::Interface &       simulator;
     const LogLikelihood::Interface &    likelihood;
     const LogPrior::Interface &         prior;
@@ -627,10 +1156,18 @@ namespace Sampler
     unsigned int sample_number;
     unsigned int accepted_sample_number;
 
-    std::ofstream output_file;
-
     void write_sample(const Vector<double> &current_sample,
                       const double          current_log_likelihood);
+
+  private:
+    const OutputFormat output_format;
+    const unsigned int flush_interval;
+    const unsigned int batch_size;
+
+    std::ofstream     output_file;
+    std::vector<char> output_buffer;
+
+    void flush_output();
   };
 
 
@@ -640,23 +1177,47 @@ namespace Sampler
     const LogPrior::Interface &         prior,
     const ProposalGenerator::Interface &proposal_generator,
     const unsigned int                  random_seed,
-    const std::string &                 dataset_name)
+    const std::string &                 dataset_name,
+    const OutputFormat                  output_format,
+    const unsigned int                  flush_interval,
+    const unsigned int                  batch_size)
     : simulator(simulator)
     , likelihood(likelihood)
     , prior(prior)
     , proposal_generator(proposal_generator)
     , sample_number(0)
     , accepted_sample_number(0)
+    , output_format(output_format)
+    , flush_interval(flush_interval)
+    , batch_size(batch_size)
   {
-    output_file.open("samples-" + dataset_name + ".txt");
-    output_file.precision(7);
+    Assert(flush_interval >= 1, ExcMessage("The flush interval must be >= 1."));
+    Assert(batch_size >= 1, ExcMessage("The batch size must be >= 1."));
+
+    if (output_format == OutputFormat::text)
+      {
+        output_file.open("samples-" + dataset_name + ".txt");
+        output_file.precision(7);
+      }
+    else
+      output_file.open("samples-" + dataset_name + ".bin",
+                       std::ios::out | std::ios::binary);
 
     random_number_generator.seed(random_seed);
   }
 
 
-  void MetropolisHastings::sample(const Vector<double> &starting_guess,
-                                  const unsigned int    n_samples)
+
+  MetropolisHastings::~MetropolisHastings()
+  {
+    flush_output();
+  }
+
+
+  void MetropolisHastings::sample(
+    const Vector<double> &                             starting_guess,
+    const unsigned int                                 n_samples,
+    const std::function<bool(const Vector<double> &)> &sample_callback)
   {
     std::uniform_real_distribution<> uniform_distribution(0, 1);
 
@@ -669,16 +1230,51 @@ namespace Sampler
     ++accepted_sample_number;
     write_sample(current_sample, current_log_posterior);
 
+    if (sample_callback && (sample_callback(current_sample) == false))
+      return;
+
+    // The proposals drawn around the current sample, their proposal
+    // probability ratios and posteriors, and the index of the next one
+    // to be tested:
+    std::vector<Vector<double>> trial_samples;
+    std::vector<double>         perturbation_probability_ratios;
+    std::vector<double>         trial_log_posteriors;
+    unsigned int                next_trial = 0;
+
     for (unsigned int k = 1; k < n_samples; ++k, ++sample_number)
       {
-        std::pair<Vector<double>,double>
-          perturbation = proposal_generator.perturb(current_sample);
-        const Vector<double> trial_sample                   = std::move (perturbation.first);
-        const double         perturbation_probability_ratio = perturbation.second;
+        if (next_trial == trial_samples.size())
+          {
+            trial_samples.clear();
+            perturbation_probability_ratios.clear();
+            for (unsigned int b = 0; b < batch_size; ++b)
+              {
+                std::pair<Vector<double>, double> perturbation =
+                  proposal_generator.perturb(current_sample);
+                trial_samples.emplace_back(std::move(perturbation.first));
+                perturbation_probability_ratios.push_back(perturbation.second);
+              }
+
+            const std::vector<Vector<double>> measurements =
+              (batch_size == 1 ?
+                 std::vector<Vector<double>>{simulator.evaluate(
+                   trial_samples[0])} :
+                 simulator.evaluate_batch(trial_samples));
+
+            trial_log_posteriors.resize(batch_size);
+            for (unsigned int b = 0; b < batch_size; ++b)
+              trial_log_posteriors[b] =
+                (likelihood.log_likelihood(measurements[b]) +
+                 prior.log_prior(trial_samples[b]));
+
+            next_trial = 0;
+          }
 
-        const double trial_log_posterior =
-          (likelihood.log_likelihood(simulator.evaluate(trial_sample)) +
-           prior.log_prior(trial_sample));
+        const Vector<double> &trial_sample = trial_samples[next_trial];
+        const double          perturbation_probability_ratio =
+          perturbation_probability_ratios[next_trial];
+        const double trial_log_posterior = trial_log_posteriors[next_trial];
+        ++next_trial;
 
         if (std::exp(trial_log_posterior - current_log_posterior) * perturbation_probability_ratio
             >=
@@ -688,9 +1284,16 @@ namespace Sampler
             current_log_posterior = trial_log_posterior;
 
             ++accepted_sample_number;
+
+            // The remaining proposals of the batch are perturbations of
+            // the previous sample and must not be used any more:
+            next_trial = trial_samples.size();
           }
 
         write_sample(current_sample, current_log_posterior);
+
+        if (sample_callback && (sample_callback(current_sample) == false))
+          break;
       }
   }
 
@@ -699,14 +1302,574 @@ namespace Sampler
   void MetropolisHastings::write_sample(const Vector<double> &current_sample,
                                         const double current_log_posterior)
   {
-    output_file << current_log_posterior << '\t';
-    output_file << accepted_sample_number << '\t';
-    for (const auto &x : current_sample)
-      output_file << x << ' ';
-    output_file << '\n';
+    if (output_format == OutputFormat::text)
+      {
+        output_file << current_log_posterior << '\t';
+        output_file << accepted_sample_number << '\t';
+        for (const auto &x : current_sample)
+          output_file << x << ' ';
+        output_file << '\n';
+      }
+    else
+      {
+        const std::uint64_t n_accepted = accepted_sample_number;
+
+        const std::size_t old_size = output_buffer.size();
+        output_buffer.resize(old_size + sizeof(double) + sizeof(n_accepted) +
+                             current_sample.size() * sizeof(double));
+
+        char *p = output_buffer.data() + old_size;
+        std::memcpy(p, &current_log_posterior, sizeof(double));
+        p += sizeof(double);
+        std::memcpy(p, &n_accepted, sizeof(n_accepted));
+        p += sizeof(n_accepted);
+        std::memcpy(p,
+                    current_sample.begin(),
+                    current_sample.size() * sizeof(double));
+      }
+
+    if (sample_number % flush_interval == 0)
+      flush_output();
+  }
+
+
 
+  void MetropolisHastings::flush_output()
+  {
+    if (output_buffer.size() > 0)
+      {
+        output_file.write(output_buffer.data(), output_buffer.size());
+        output_buffer.clear();
+      }
     output_file.flush();
   }
+
+
+
+  // The forward solves are by far the most expensive part of the sampler,
+  // and most of them are for proposals that are then rejected. The
+  // following class implements a two-level "delayed acceptance" variant of
+  // the Metropolis-Hastings algorithm (see J. A. Christen and C. Fox:
+  // "Markov chain Monte Carlo using an approximation", Journal of
+  // Computational and Graphical Statistics, 2005) that uses a cheap
+  // approximation of the forward model -- for example, a `PoissonSolver`
+  // on a coarser mesh -- to screen proposals before evaluating the
+  // accurate forward model for them:
+  //
+  // In a first stage, a proposal $y$ for the current sample $x$ is
+  // accepted or rejected with the usual Metropolis-Hastings criterion,
+  // but using the approximate posterior $\pi^\ast$ computed with the coarse
+  // forward model. Only if the proposal passes this stage is the accurate
+  // posterior $\pi$ computed, and the proposal is then accepted with
+  // probability
+  // @f[
+  //   \min\left\{1, \frac{\pi(y)\,\pi^\ast(x)}{\pi(x)\,\pi^\ast(y)}\right\}.
+  // @f]
+  // The factors from the proposal distribution cancel in this second
+  // stage. This correction makes the chain sample exactly from $\pi$,
+  // regardless of how good or bad the coarse approximation is; a poor
+  // approximation only leads to a lower acceptance rate in the second
+  // stage.
+  //
+  // The output has exactly the same format as that of the base class.
+  class DelayedAcceptanceMetropolisHastings : public MetropolisHastings
+  {
+  public:
+    DelayedAcceptanceMetropolisHastings(
+      ForwardSimulator::Interface &       fine_simulator,
+      ForwardSimulator::Interface &       coarse_simulator,
+      const LogLikelihood::Interface &    likelihood,
+      const LogPrior::Interface &         prior,
+      const ProposalGenerator::Interface &proposal_generator,
+      const unsigned int                  random_seed,
+      const std::string &                 dataset_name,
+      const OutputFormat                  output_format  = OutputFormat::text,
+      const unsigned int                  flush_interval = 1);
+
+    virtual void sample(const Vector<double> &starting_guess,
+                        const unsigned int    n_samples,
+                        const std::function<bool(const Vector<double> &)>
+                          &sample_callback = {}) override;
+
+    void print_statistics(std::ostream &out) const;
+
+  private:
+    ForwardSimulator::Interface &coarse_simulator;
+
+    unsigned int n_coarse_evaluations;
+    unsigned int n_fine_evaluations;
+  };
+
+
+
+  DelayedAcceptanceMetropolisHastings::DelayedAcceptanceMetropolisHastings(
+    ForwardSimulator::Interface &       fine_simulator,
+    ForwardSimulator::Interface &       coarse_simulator,
+    const LogLikelihood::Interface &    likelihood,
+    const LogPrior::Interface &         prior,
+    const ProposalGenerator::Interface &proposal_generator,
+    const unsigned int                  random_seed,
+    const std::string &                 dataset_name,
+    const OutputFormat                  output_format,
+    const unsigned int                  flush_interval)
+    : MetropolisHastings(fine_simulator,
+                         likelihood,
+                         prior,
+                         proposal_generator,
+                         random_seed,
+                         dataset_name,
+                         output_format,
+                         flush_interval)
+    , coarse_simulator(coarse_simulator)
+    , n_coarse_evaluations(0)
+    , n_fine_evaluations(0)
+  {}
+
+
+
+  void DelayedAcceptanceMetropolisHastings::sample(
+    const Vector<double> &                             starting_guess,
+    const unsigned int                                 n_samples,
+    const std::function<bool(const Vector<double> &)> &sample_callback)
+  {
+    std::uniform_real_distribution<> uniform_distribution(0, 1);
+
+    Vector<double> current_sample = starting_guess;
+    double         current_log_prior = prior.log_prior(current_sample);
+    double         current_log_posterior =
+      (likelihood.log_likelihood(simulator.evaluate(current_sample)) +
+       current_log_prior);
+    double current_coarse_log_posterior =
+      (likelihood.log_likelihood(coarse_simulator.evaluate(current_sample)) +
+       current_log_prior);
+    ++n_fine_evaluations;
+    ++n_coarse_evaluations;
+
+    ++sample_number;
+    ++accepted_sample_number;
+    write_sample(current_sample, current_log_posterior);
+
+    if (sample_callback && (sample_callback(current_sample) == false))
+      return;
+
+    for (unsigned int k = 1; k < n_samples; ++k, ++sample_number)
+      {
+        std::pair<Vector<double>,double>
+          perturbation = proposal_generator.perturb(current_sample);
+        const Vector<double> trial_sample                   = std::move (perturbation.first);
+        const double         perturbation_probability_ratio = perturbation.second;
+
+        // First stage: Screen the proposal with the coarse model.
+        const double trial_log_prior = prior.log_prior(trial_sample);
+        const double trial_coarse_log_posterior =
+          (likelihood.log_likelihood(coarse_simulator.evaluate(trial_sample)) +
+           trial_log_prior);
+        ++n_coarse_evaluations;
+
+        if (std::exp(trial_coarse_log_posterior - current_coarse_log_posterior) *
+              perturbation_probability_ratio
+            >=
+            uniform_distribution(random_number_generator))
+          {
+            // Second stage: Correct with the fine model.
+            const double trial_log_posterior =
+              (likelihood.log_likelihood(simulator.evaluate(trial_sample)) +
+               trial_log_prior);
+            ++n_fine_evaluations;
+
+            if (std::exp((trial_log_posterior - current_log_posterior) -
+                         (trial_coarse_log_posterior -
+                          current_coarse_log_posterior))
+                >=
+                uniform_distribution(random_number_generator))
+              {
+                current_sample               = trial_sample;
+                current_log_posterior        = trial_log_posterior;
+                current_coarse_log_posterior = trial_coarse_log_posterior;
+
+                ++accepted_sample_number;
+              }
+          }
+
+        write_sample(current_sample, current_log_posterior);
+
+        if (sample_callback && (sample_callback(current_sample) == false))
+          break;
+      }
+  }
+
+
+
+  void
+  DelayedAcceptanceMetropolisHastings::print_statistics(std::ostream &out) const
+  {
+    out << "   Samples: " << sample_number
+        << ", coarse model evaluations: " << n_coarse_evaluations
+        << ", fine model evaluations: " << n_fine_evaluations
+        << ", accepted samples: " << accepted_sample_number << std::endl;
+  }
+} // namespace Sampler
+
+
+// A single chain only keeps one core busy, but on a machine with many
+// cores we can run many independent chains at the same time. Each of them
+// needs its own forward simulator (the `PoissonSolver` class stores the
+// linear system it solves as member variables, so it can not be shared
+// between threads), its own proposal generator (which stores a random
+// number generator), and its own output file. The likelihood and prior,
+// on the other hand, are stateless and can be shared.
+//
+// Running several chains also allows us to monitor convergence of the
+// sampling process using the Gelman-Rubin statistic $\hat R$: For $m$
+// chains with $n$ samples each, let $W$ be the mean of the within-chain
+// variances of a component of the samples, and $B/n$ the variance of the
+// means of the individual chains. Then
+// @f[
+//   \hat R = \sqrt{\frac{\frac{n-1}{n} W + \frac{B}{n}}{W}},
+// @f]
+// which tends to one from above as the chains all sample the same
+// distribution. We compute this quantity for each of the 64 components of
+// the samples and consider the chains converged once the largest of
+// these values falls below a given tolerance. The statistics of each
+// chain are updated on the fly using Welford's algorithm, so that we do
+// not need to store the samples.
+namespace Sampler
+{
+  class GelmanRubinMonitor
+  {
+  public:
+    GelmanRubinMonitor(const unsigned int n_chains,
+                       const unsigned int n_parameters,
+                       const unsigned int n_burn_in_samples,
+                       const unsigned int check_interval,
+                       const double       r_hat_tolerance);
+
+    // Record a sample of the given chain. Returns whether the chains
+    // should continue sampling, i.e., `false` once convergence has been
+    // detected.
+    bool add_sample(const unsigned int chain, const Vector<double> &sample);
+
+    double r_hat() const;
+
+    bool has_converged() const;
+
+  private:
+    struct ChainStatistics
+    {
+      unsigned int   n_samples_seen = 0;
+      unsigned int   n_samples_used = 0;
+      Vector<double> mean;
+      Vector<double> sum_of_squared_deviations;
+    };
+
+    double compute_r_hat() const;
+
+    const unsigned int n_burn_in_samples;
+    const unsigned int check_interval;
+    const double       r_hat_tolerance;
+
+    std::vector<ChainStatistics> chain_statistics;
+    unsigned int                 n_samples_since_last_check;
+    double                       last_r_hat;
+
+    mutable std::mutex mutex;
+    std::atomic<bool>  converged;
+  };
+
+
+
+  GelmanRubinMonitor::GelmanRubinMonitor(const unsigned int n_chains,
+                                         const unsigned int n_parameters,
+                                         const unsigned int n_burn_in_samples,
+                                         const unsigned int check_interval,
+                                         const double       r_hat_tolerance)
+    : n_burn_in_samples(n_burn_in_samples)
+    , check_interval(check_interval)
+    , r_hat_tolerance(r_hat_tolerance)
+    , chain_statistics(n_chains)
+    , n_samples_since_last_check(0)
+    , last_r_hat(std::numeric_limits<double>::infinity())
+    , converged(false)
+  {
+    Assert(n_chains >= 2,
+           ExcMessage("The Gelman-Rubin statistic requires at least two "
+                      "chains."));
+    for (auto &statistics : chain_statistics)
+      {
+        statistics.mean.reinit(n_parameters);
+        statistics.sum_of_squared_deviations.reinit(n_parameters);
+      }
+  }
+
+
+
+  bool GelmanRubinMonitor::add_sample(const unsigned int    chain,
+                                      const Vector<double> &sample)
+  {
+    AssertIndexRange(chain, chain_statistics.size());
+
+    if (converged)
+      return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ChainStatistics &statistics = chain_statistics[chain];
+    ++statistics.n_samples_seen;
+    if (statistics.n_samples_seen <= n_burn_in_samples)
+      return true;
+
+    ++statistics.n_samples_used;
+    for (unsigned int i = 0; i < sample.size(); ++i)
+      {
+        const double delta = sample[i] - statistics.mean[i];
+        statistics.mean[i] += delta / statistics.n_samples_used;
+        statistics.sum_of_squared_deviations[i] +=
+          delta * (sample[i] - statistics.mean[i]);
+      }
+
+    ++n_samples_since_last_check;
+    if (n_samples_since_last_check >= check_interval)
+      {
+        n_samples_since_last_check = 0;
+        last_r_hat                 = compute_r_hat();
+
+        std::cout << "   Gelman-Rubin R-hat after ";
+        for (const auto &s : chain_statistics)
+          std::cout << s.n_samples_seen << ' ';
+        std::cout << "samples per chain: " << last_r_hat << std::endl;
+
+        if (last_r_hat < r_hat_tolerance)
+          converged = true;
+      }
+
+    return !converged;
+  }
+
+
+
+  // Compute the largest of the per-component $\hat R$ values. Because
+  // chains run at (slightly) different speeds, we use the same number of
+  // samples $n$ for all chains in the between-chain part, namely the
+  // smallest number of samples any of the chains has seen so far, and
+  // the actual number of samples for each chain for the within-chain
+  // variance. This function must be called with the mutex held.
+  double GelmanRubinMonitor::compute_r_hat() const
+  {
+    unsigned int n = std::numeric_limits<unsigned int>::max();
+    for (const auto &statistics : chain_statistics)
+      n = std::min(n, statistics.n_samples_used);
+    if (n < 2)
+      return std::numeric_limits<double>::infinity();
+
+    const unsigned int m            = chain_statistics.size();
+    const unsigned int n_parameters = chain_statistics[0].mean.size();
+
+    double max_r_hat = 0;
+    for (unsigned int i = 0; i < n_parameters; ++i)
+      {
+        double mean_of_means = 0;
+        double W             = 0;
+        for (const auto &statistics : chain_statistics)
+          {
+            mean_of_means += statistics.mean[i] / m;
+            W += statistics.sum_of_squared_deviations[i] /
+                 (statistics.n_samples_used - 1) / m;
+          }
+
+        double B_over_n = 0;
+        for (const auto &statistics : chain_statistics)
+          B_over_n += (statistics.mean[i] - mean_of_means) *
+                      (statistics.mean[i] - mean_of_means) / (m - 1);
+
+        const double var_hat = (n - 1.) / n * W + B_over_n;
+        max_r_hat            = std::max(max_r_hat, std::sqrt(var_hat / W));
+      }
+
+    return max_r_hat;
+  }
+
+
+
+  double GelmanRubinMonitor::r_hat() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return last_r_hat;
+  }
+
+
+
+  bool GelmanRubinMonitor::has_converged() const
+  {
+    return converged;
+  }
+
+
+
+  // The driver for several chains then creates one forward simulator and
+  // one proposal generator per chain via user-provided factory functions,
+  // and runs each chain on its own thread. We do not use deal.II's task
+  // scheduler here: `main()` limits the number of threads deal.II may use
+  // to one, so that the forward solvers themselves do not spawn threads,
+  // and with this limit tasks would be run one after the other.
+  //
+  // Each chain gets its own random seed, derived from the given seed, and
+  // writes to a file `samples-<dataset_name>-<chain>.txt`. If a factory for
+  // coarse forward simulators is given, each chain additionally gets its
+  // own coarse simulator and uses the delayed acceptance sampler above.
+  // Otherwise, each chain evaluates its proposals in batches of
+  // `batch_size`.
+  class MultiChainMetropolisHastings
+  {
+  public:
+    using SimulatorFactory =
+      std::function<std::unique_ptr<ForwardSimulator::Interface>(
+        const std::string &dataset_name)>;
+    using ProposalGeneratorFactory =
+      std::function<std::unique_ptr<ProposalGenerator::Interface>(
+        const unsigned int random_seed)>;
+
+    MultiChainMetropolisHastings(const unsigned int              n_chains,
+                                 const SimulatorFactory &        simulator_factory,
+                                 const LogLikelihood::Interface &likelihood,
+                                 const LogPrior::Interface &     prior,
+                                 const ProposalGeneratorFactory &proposal_factory,
+                                 const unsigned int              random_seed,
+                                 const std::string &             dataset_name,
+                                 const OutputFormat output_format = OutputFormat::text,
+                                 const unsigned int flush_interval = 1,
+                                 const SimulatorFactory &coarse_simulator_factory = {},
+                                 const unsigned int batch_size = 1);
+
+    // Run all chains until either each has produced `max_samples_per_chain`
+    // samples, or the given monitor reports convergence.
+    void sample(const Vector<double> &starting_guess,
+                const unsigned int    max_samples_per_chain,
+                GelmanRubinMonitor &  monitor);
+
+  private:
+    const LogLikelihood::Interface &likelihood;
+    const LogPrior::Interface &     prior;
+
+    const OutputFormat output_format;
+    const unsigned int flush_interval;
+    const unsigned int batch_size;
+
+    std::vector<std::string>                                  dataset_names;
+    std::vector<std::string>                                  coarse_dataset_names;
+    std::vector<unsigned int>                                 random_seeds;
+    std::vector<std::unique_ptr<ForwardSimulator::Interface>> simulators;
+    std::vector<std::unique_ptr<ForwardSimulator::Interface>> coarse_simulators;
+    std::vector<std::unique_ptr<ProposalGenerator::Interface>>
+      proposal_generators;
+  };
+
+
+
+  MultiChainMetropolisHastings::MultiChainMetropolisHastings(
+    const unsigned int              n_chains,
+    const SimulatorFactory &        simulator_factory,
+    const LogLikelihood::Interface &likelihood,
+    const LogPrior::Interface &     prior,
+    const ProposalGeneratorFactory &proposal_factory,
+    const unsigned int              random_seed,
+    const std::string &             dataset_name,
+    const OutputFormat              output_format,
+    const unsigned int              flush_interval,
+    const SimulatorFactory &        coarse_simulator_factory,
+    const unsigned int              batch_size)
+    : likelihood(likelihood)
+    , prior(prior)
+    , output_format(output_format)
+    , flush_interval(flush_interval)
+    , batch_size(batch_size)
+  {
+    std::seed_seq seeds({random_seed, n_chains});
+    random_seeds.resize(n_chains);
+    seeds.generate(random_seeds.begin(), random_seeds.end());
+
+    // The `PoissonSolver` class only stores a reference to the dataset
+    // name, so the names need to be stored before creating the
+    // simulators, and must not be moved afterwards:
+    for (unsigned int chain = 0; chain < n_chains; ++chain)
+      dataset_names.emplace_back(dataset_name + "-" +
+                                 Utilities::int_to_string(chain, 2));
+    if (coarse_simulator_factory)
+      for (unsigned int chain = 0; chain < n_chains; ++chain)
+        coarse_dataset_names.emplace_back(dataset_names[chain] + "-coarse");
+
+    for (unsigned int chain = 0; chain < n_chains; ++chain)
+      {
+        simulators.emplace_back(simulator_factory(dataset_names[chain]));
+        if (coarse_simulator_factory)
+          coarse_simulators.emplace_back(
+            coarse_simulator_factory(coarse_dataset_names[chain]));
+        proposal_generators.emplace_back(
+          proposal_factory(random_seeds[chain]));
+      }
+  }
+
+
+
+  void
+  MultiChainMetropolisHastings::sample(const Vector<double> &starting_guess,
+                                       const unsigned int max_samples_per_chain,
+                                       GelmanRubinMonitor &monitor)
+  {
+    // The delayed acceptance samplers' statistics are collected per chain
+    // and only printed once all chains are done, so that the output of the
+    // different threads is not interleaved:
+    std::vector<std::ostringstream> statistics(simulators.size());
+
+    std::vector<std::thread> threads;
+    for (unsigned int chain = 0; chain < simulators.size(); ++chain)
+      threads.emplace_back([&, chain]() {
+        const auto sample_callback =
+          [&monitor, chain](const Vector<double> &sample) {
+            return monitor.add_sample(chain, sample);
+          };
+
+        if (coarse_simulators.size() > 0)
+          {
+            DelayedAcceptanceMetropolisHastings sampler(
+              *simulators[chain],
+              *coarse_simulators[chain],
+              likelihood,
+              prior,
+              *proposal_generators[chain],
+              random_seeds[chain],
+              dataset_names[chain],
+              output_format,
+              flush_interval);
+            sampler.sample(starting_guess,
+                           max_samples_per_chain,
+                           sample_callback);
+            sampler.print_statistics(statistics[chain]);
+          }
+        else
+          {
+            MetropolisHastings sampler(*simulators[chain],
+                                       likelihood,
+                                       prior,
+                                       *proposal_generators[chain],
+                                       random_seeds[chain],
+                                       dataset_names[chain],
+                                       output_format,
+                                       flush_interval,
+                                       batch_size);
+            sampler.sample(starting_guess,
+                           max_samples_per_chain,
+                           sample_callback);
+          }
+      });
+
+    for (auto &thread : threads)
+      thread.join();
+
+    for (unsigned int chain = 0; chain < statistics.size(); ++chain)
+      if (statistics[chain].tellp() > 0)
+        std::cout << "Chain " << chain << ':' << std::endl
+                  << statistics[chain].str();
+  }
 } // namespace Sampler
 
 
@@ -737,10 +1900,40 @@ namespace Sampler
 //                                       /* prefix = */ "exact")
 //      .evaluate(exact_coefficients);
 // @endcode
-int main()
+//
+// Instead of the plain Metropolis-Hastings sampler, one can also use the
+// two-level delayed acceptance sampler, which uses a forward solver on a
+// mesh with only 8x8 cells to screen proposals, by calling the program as
+// `./mcmc-laplace --delayed-acceptance`. This works with a single chain as
+// well as with several chains. Alternatively, the option
+// `--batched-proposals` lets the plain sampler evaluate as many proposals
+// at once as there are lanes in a `VectorizedArray<double>`.
+int main(int argc, char **argv)
 {
   const bool testing = true;
 
+  bool use_delayed_acceptance = false;
+  bool use_batched_proposals  = false;
+  for (int i = 1; i < argc; ++i)
+    {
+      const std::string argument(argv[i]);
+      if (argument == "--delayed-acceptance")
+        use_delayed_acceptance = true;
+      else if (argument == "--batched-proposals")
+        use_batched_proposals = true;
+      else
+        AssertThrow(false,
+                    ExcMessage("Unknown command line argument <" + argument +
+                               ">. The supported options are "
+                               "--delayed-acceptance and "
+                               "--batched-proposals."));
+    }
+  AssertThrow(!(use_delayed_acceptance && use_batched_proposals),
+              ExcMessage("The delayed acceptance sampler does not support "
+                         "batched proposals."));
+  const unsigned int batch_size =
+    (use_batched_proposals ? VectorizedArray<double>::size() : 1);
+
   // Run with one thread, so as to not step on other processes
   // doing the same at the same time. It turns out that the problem
   // is also so small that running with more than one thread
@@ -837,28 +2030,120 @@ int main()
         0.2096362321365551,  0.1806705953553887,
         0.1067965550010013                         });
 
-  // Now run the forward simulator for samples:
-  ForwardSimulator::PoissonSolver<2> laplace_problem(
-    /* global_refinements = */ 5,
-    /* fe_degree = */ 1,
-    dataset_name);
-  LogLikelihood::Gaussian        log_likelihood(exact_solution, 0.05);
-  LogPrior::LogGaussian          log_prior(0, 2);
-  ProposalGenerator::LogGaussian proposal_generator(
-    random_seed, 0.09); /* so that the acceptance ratio is ~0.24 */
-  Sampler::MetropolisHastings sampler(laplace_problem,
-                                      log_likelihood,
-                                      log_prior,
-                                      proposal_generator,
-                                      random_seed,
-                                      dataset_name);
+  // Now run the forward simulator for samples. In testing mode, we run a
+  // single chain so that the output can be compared against known
+  // results. Otherwise, we run one chain per core and stop once the
+  // Gelman-Rubin statistic indicates that the chains have converged (or
+  // once the maximal number of samples is reached):
+  LogLikelihood::Gaussian log_likelihood(exact_solution, 0.05);
+  LogPrior::LogGaussian   log_prior(0, 2);
 
   Vector<double> starting_coefficients(64);
   for (auto &el : starting_coefficients)
     el = 1.;
-  sampler.sample(starting_coefficients,
-                 (testing ? 250 * 40 /* takes 10 seconds */
-                            :
-                            100000000 /* takes 1.5 days */
-                  ));
+
+  const unsigned int n_chains = (testing ? 1 : MultithreadInfo::n_cores());
+
+  if ((n_chains == 1) && use_delayed_acceptance)
+    {
+      ForwardSimulator::PoissonSolver<2> laplace_problem(
+        /* global_refinements = */ 5,
+        /* fe_degree = */ 1,
+        dataset_name);
+      const std::string                  coarse_dataset_name =
+        dataset_name + "-coarse";
+      ForwardSimulator::PoissonSolver<2> coarse_laplace_problem(
+        /* global_refinements = */ 3,
+        /* fe_degree = */ 1,
+        coarse_dataset_name);
+      ProposalGenerator::LogGaussian proposal_generator(
+        random_seed, 0.09); /* so that the acceptance ratio is ~0.24 */
+      Sampler::DelayedAcceptanceMetropolisHastings sampler(
+        laplace_problem,
+        coarse_laplace_problem,
+        log_likelihood,
+        log_prior,
+        proposal_generator,
+        random_seed,
+        dataset_name);
+
+      sampler.sample(starting_coefficients,
+                     (testing ? 250 * 40 /* takes 10 seconds */
+                                :
+                                100000000 /* takes 1.5 days */
+                      ));
+      sampler.print_statistics(std::cout);
+    }
+  else if (n_chains == 1)
+    {
+      ForwardSimulator::PoissonSolver<2> laplace_problem(
+        /* global_refinements = */ 5,
+        /* fe_degree = */ 1,
+        dataset_name);
+      ProposalGenerator::LogGaussian proposal_generator(
+        random_seed, 0.09); /* so that the acceptance ratio is ~0.24 */
+      Sampler::MetropolisHastings sampler(laplace_problem,
+                                          log_likelihood,
+                                          log_prior,
+                                          proposal_generator,
+                                          random_seed,
+                                          dataset_name,
+                                          Sampler::OutputFormat::text,
+                                          /* flush_interval = */ 1,
+                                          batch_size);
+
+      sampler.sample(starting_coefficients,
+                     (testing ? 250 * 40 /* takes 10 seconds */
+                                :
+                                100000000 /* takes 1.5 days */
+                      ));
+    }
+  else
+    {
+      Sampler::MultiChainMetropolisHastings sampler(
+        n_chains,
+        [](const std::string &chain_name) {
+          return std::make_unique<ForwardSimulator::PoissonSolver<2>>(
+            /* global_refinements = */ 5,
+            /* fe_degree = */ 1,
+            chain_name,
+            ForwardSimulator::SolverMode::chain_aware);
+        },
+        log_likelihood,
+        log_prior,
+        [](const unsigned int chain_seed) {
+          return std::make_unique<ProposalGenerator::LogGaussian>(
+            chain_seed, 0.09); /* so that the acceptance ratio is ~0.24 */
+        },
+        random_seed,
+        dataset_name,
+        Sampler::OutputFormat::binary,
+        /* flush_interval = */ 10000,
+        (use_delayed_acceptance ?
+           Sampler::MultiChainMetropolisHastings::SimulatorFactory(
+             [](const std::string &chain_name) {
+               return std::make_unique<ForwardSimulator::PoissonSolver<2>>(
+                 /* global_refinements = */ 3,
+                 /* fe_degree = */ 1,
+                 chain_name,
+                 ForwardSimulator::SolverMode::chain_aware);
+             }) :
+           Sampler::MultiChainMetropolisHastings::SimulatorFactory()),
+        batch_size);
+
+      Sampler::GelmanRubinMonitor monitor(n_chains,
+                                          /* n_parameters = */ 64,
+                                          /* n_burn_in_samples = */ 10000,
+                                          /* check_interval = */ 100000,
+                                          /* r_hat_tolerance = */ 1.01);
+
+      sampler.sample(starting_coefficients,
+                     100000000 / n_chains,
+                     monitor);
+
+      std::cout << "Final Gelman-Rubin R-hat: " << monitor.r_hat()
+                << (monitor.has_converged() ? " (converged)" :
+                                              " (not converged)")
+                << std::endl;
+    }
 }
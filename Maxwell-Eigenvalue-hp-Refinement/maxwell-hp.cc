@@ -24,6 +24,7 @@
 #include <deal.II/base/index_set.h>
 #include <deal.II/base/parameter_handler.h>
 #include <deal.II/base/quadrature_lib.h>
+#include <deal.II/base/timer.h>
 #include <deal.II/base/utilities.h>
 
 #include <deal.II/dofs/dof_handler.h>
@@ -33,6 +34,7 @@
 #include <deal.II/fe/fe_series.h>
 #include <deal.II/fe/fe_values.h>
 
+#include <deal.II/grid/filtered_iterator.h>
 #include <deal.II/grid/tria.h>
 #include <deal.II/grid/tria_iterator.h>
 
@@ -44,6 +46,7 @@
 #include <deal.II/lac/slepc_solver.h>
 
 #include <deal.II/numerics/data_out.h>
+#include <deal.II/numerics/solution_transfer.h>
 #include <deal.II/numerics/vector_tools.h>
 
 // For parallelization (using WorkStream and Intel TBB)
@@ -60,8 +63,11 @@
 // For refinement
 #include <deal.II/grid/grid_refinement.h>
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <memory>
 
 namespace Operations
@@ -238,6 +244,26 @@ namespace Maxwell
                               "1",
                               Patterns::Integer(0, 1500),
                               "The number of cycles in refinement");
+
+    parameters->declare_entry(
+      "Shift-and-invert linear solver",
+      "direct",
+      Patterns::Selection("direct|iterative"),
+      "The solver for the shifted systems of the spectral transformation "
+      "(direct - LU factorization with MUMPS, iterative - GMRES with an "
+      "ILU preconditioner)");
+    parameters->declare_entry("Inner solver tolerance",
+                              "1e-10",
+                              Patterns::Double(0.0),
+                              "The relative tolerance of the iterative "
+                              "shift-and-invert solver");
+    parameters->declare_entry(
+      "Reuse previous eigenfunction",
+      "true",
+      Patterns::Bool(),
+      "Whether the eigenfunction of the previous refinement cycle, "
+      "interpolated onto the new space, is the initial space of the "
+      "eigensolver (and the primal eigenpair that of the dual problem)");
     parameters->parse_input(prm_file);
 
     eigenpair_selection_scheme =
@@ -297,6 +323,12 @@ namespace Maxwell
     virtual void
     assemble_system();
 
+    unsigned int
+    solve_eigenproblem();
+
+    void
+    prepare_for_coarsening_and_refinement();
+
   protected:
     const std::unique_ptr<hp::FECollection<dim>> fe_collection;
     std::unique_ptr<hp::QCollection<dim>>        quadrature_collection;
@@ -317,9 +349,42 @@ namespace Maxwell
     void
     convert_solution();
 
+    // The pieces of assemble_system, which are also used by the combined
+    // primal and dual assembly of the DualWeightedResidual
+    void
+    initialize_system_matrices();
+
+    static void
+    compute_cell_matrices(const FEValues<dim> &      fe_values,
+                          const std::vector<double> &JxW,
+                          FullMatrix<double> &       cell_stiffness_matrix,
+                          FullMatrix<double> &       cell_mass_matrix);
+
+    void
+    distribute_local_to_global(
+      const FullMatrix<double> &                  cell_stiffness_matrix,
+      const FullMatrix<double> &                  cell_mass_matrix,
+      const std::vector<types::global_dof_index> &local_dof_indices);
+
+    void
+    finalize_system_matrices();
+
+    AffineConstraints<double> constraints;
+
+    // The shift of the spectral transformation, which is the target
+    // eigenvalue of the parameter file unless set otherwise
+    double target_eigenvalue;
+
+    // The initial space of the eigensolver (if it has the size of the current
+    // finite element space)
+    Vector<double> initial_space;
+
   private:
-    AffineConstraints<double>   constraints;
     PETScWrappers::SparseMatrix stiffness_matrix, mass_matrix;
+
+    // The eigenfunction of the previous cycle, interpolated onto the current
+    // finite element space
+    std::unique_ptr<SolutionTransfer<dim, Vector<double>>> solution_transfer;
   };
 
   /**
@@ -342,6 +407,7 @@ namespace Maxwell
     , eigenfunctions(
         std::make_unique<std::vector<PETScWrappers::MPI::Vector>>())
     , eigenvalues(std::make_unique<std::vector<double>>())
+    , target_eigenvalue(this->target)
   {
     for (unsigned int degree = min_degree; degree <= max_degree; ++degree)
       {
@@ -429,20 +495,43 @@ namespace Maxwell
     eigensolver.set_problem_type(EPS_GHEP);
     // apply a Shift-Invert spectrum transformation
 
-    double shift_scalar = this->parameters->get_double("Target eigenvalue");
+    // The linear solver of the spectral transformation is only created by
+    // SLEPc during the solve, so it is configured through the options
+    // database (with the "st_" prefix of the transformation), which is read
+    // by the eigensolver right before solving. PETSc's default LU
+    // factorization is slow for the large systems of the higher cycles, so
+    // we use either MUMPS or GMRES.
+    if (this->parameters->get("Shift-and-invert linear solver") == "direct")
+      {
+        PetscOptionsSetValue(nullptr, "-st_ksp_type", "preonly");
+        PetscOptionsSetValue(nullptr, "-st_pc_type", "lu");
+        PetscOptionsSetValue(nullptr,
+                             "-st_pc_factor_mat_solver_type",
+                             "mumps");
+      }
+    else
+      {
+        PetscOptionsSetValue(nullptr, "-st_ksp_type", "gmres");
+        PetscOptionsSetValue(nullptr, "-st_pc_type", "bjacobi");
+        PetscOptionsSetValue(nullptr, "-st_sub_pc_type", "ilu");
+        PetscOptionsSetValue(
+          nullptr,
+          "-st_ksp_rtol",
+          this->parameters->get("Inner solver tolerance").c_str());
+      }
+
     //		//For the shift-and-invert transformation
     SLEPcWrappers::TransformationShiftInvert::AdditionalData additional_data(
-      shift_scalar);
+      target_eigenvalue);
     SLEPcWrappers::TransformationShiftInvert spectral_transformation(
       this->mpi_communicator, additional_data);
 
     eigensolver.set_transformation(spectral_transformation);
-    eigensolver.set_target_eigenvalue(this->target);
+    eigensolver.set_target_eigenvalue(target_eigenvalue);
   }
 
   /**
-  Solves the eigenvalue problem and applies the constraints to the
-  eigenfunctions
+  Sets up and assembles the system and solves the eigenvalue problem
   */
   template <int dim>
   unsigned int
@@ -450,7 +539,17 @@ namespace Maxwell
   {
     setup_system();
     assemble_system();
+    return solve_eigenproblem();
+  }
 
+  /**
+  Solves the eigenvalue problem for the assembled matrices and applies the
+  constraints to the eigenfunctions
+  */
+  template <int dim>
+  unsigned int
+  EigenSolver<dim>::solve_eigenproblem()
+  {
     SolverControl                    solver_control(dof_handler.n_dofs() * 10,
                                  5.0e-8,
                                  false,
@@ -460,12 +559,29 @@ namespace Maxwell
 
     initialize_eigensolver(eigensolver);
 
+    // Start from the eigenfunction of the previous cycle, which is already
+    // close to the wanted one, instead of from a random vector
+    if (initial_space.size() == dof_handler.n_dofs())
+      {
+        std::vector<PETScWrappers::MPI::Vector> initial_vectors(1);
+        initial_vectors[0].reinit(dof_handler.locally_owned_dofs(),
+                                  MPI_COMM_WORLD);
+        for (unsigned int i = 0; i < initial_space.size(); ++i)
+          initial_vectors[0][i] = initial_space[i];
+        initial_vectors[0].compress(VectorOperation::insert);
+        eigensolver.set_initial_space(initial_vectors);
+      }
+
     // solve the problem
+    Timer timer;
     eigensolver.solve(stiffness_matrix,
                       mass_matrix,
                       *eigenvalues,
                       *eigenfunctions,
                       eigenfunctions->size());
+    timer.stop();
+    std::cout << "Eigensolver: " << solver_control.last_step()
+              << " iterations in " << timer.wall_time() << " s" << std::endl;
     for (auto &entry : *eigenfunctions)
       {
         constraints.distribute(entry);
@@ -482,6 +598,23 @@ namespace Maxwell
     return dof_handler.n_dofs();
   }
 
+  /**
+  Stores the current eigenfunction for the transfer to the next refinement
+  cycle. This has to be called after the refinement flags and the future
+  finite element indices are set, but before the triangulation is refined.
+  */
+  template <int dim>
+  void
+  EigenSolver<dim>::prepare_for_coarsening_and_refinement()
+  {
+    if (!this->parameters->get_bool("Reuse previous eigenfunction"))
+      return;
+
+    solution_transfer =
+      std::make_unique<SolutionTransfer<dim, Vector<double>>>(dof_handler);
+    solution_transfer->prepare_for_coarsening_and_refinement(solution);
+  }
+
   /**
   Distributes the degrees of freedom and makes the necessary hanging_node
   constraints, which includes the constraints for non-uniform $p$, and for the
@@ -497,6 +630,14 @@ namespace Maxwell
     DoFTools::make_zero_boundary_constraints(dof_handler, constraints);
     constraints.close();
 
+    if (solution_transfer)
+      {
+        initial_space.reinit(dof_handler.n_dofs());
+        solution_transfer->interpolate(solution, initial_space);
+        constraints.distribute(initial_space);
+        solution_transfer.reset();
+      }
+
     eigenfunctions->resize(this->n_eigenpairs);
     eigenvalues->resize(this->n_eigenpairs);
 
@@ -520,62 +661,111 @@ namespace Maxwell
                                    update_values | update_gradients |
                                      update_quadrature_points |
                                      update_JxW_values);
-    // Prep the system matrices for the solution
-    stiffness_matrix.reinit(dof_handler.n_dofs(),
-                            dof_handler.n_dofs(),
-                            dof_handler.max_couplings_between_dofs());
-    mass_matrix.reinit(dof_handler.n_dofs(),
-                       dof_handler.n_dofs(),
-                       dof_handler.max_couplings_between_dofs());
+    initialize_system_matrices();
 
     FullMatrix<double> cell_stiffness_matrix, cell_mass_matrix;
     std::vector<types::global_dof_index> local_dof_indices;
 
     for (const auto &cell : dof_handler.active_cell_iterators())
       {
-        const unsigned int dofs_per_cell = cell->get_fe().dofs_per_cell;
+        hp_fe_values.reinit(cell);
 
-        cell_stiffness_matrix.reinit(dofs_per_cell, dofs_per_cell);
-        cell_stiffness_matrix = 0;
+        const FEValues<dim> &fe_values = hp_fe_values.get_present_fe_values();
 
-        cell_mass_matrix.reinit(dofs_per_cell, dofs_per_cell);
-        cell_mass_matrix = 0;
+        compute_cell_matrices(fe_values,
+                              fe_values.get_JxW_values(),
+                              cell_stiffness_matrix,
+                              cell_mass_matrix);
 
-        hp_fe_values.reinit(cell);
+        local_dof_indices.resize(cell->get_fe().dofs_per_cell);
+        cell->get_dof_indices(local_dof_indices);
+        distribute_local_to_global(cell_stiffness_matrix,
+                                   cell_mass_matrix,
+                                   local_dof_indices);
+      }
 
-        const FEValues<dim> &fe_values = hp_fe_values.get_present_fe_values();
+    finalize_system_matrices();
+  }
 
-        for (unsigned int q_point = 0; q_point < fe_values.n_quadrature_points;
-             ++q_point)
+  /**
+  Prepares the system matrices for the assembly
+  */
+  template <int dim>
+  void
+  EigenSolver<dim>::initialize_system_matrices()
+  {
+    stiffness_matrix.reinit(dof_handler.n_dofs(),
+                            dof_handler.n_dofs(),
+                            dof_handler.max_couplings_between_dofs());
+    mass_matrix.reinit(dof_handler.n_dofs(),
+                       dof_handler.n_dofs(),
+                       dof_handler.max_couplings_between_dofs());
+  }
+
+  /**
+  Computes the cell stiffness and mass matrices. The quadrature weights are
+  passed separately, so that they can be shared between FEValues objects on
+  the same cell and quadrature rule.
+  */
+  template <int dim>
+  void
+  EigenSolver<dim>::compute_cell_matrices(
+    const FEValues<dim> &      fe_values,
+    const std::vector<double> &JxW,
+    FullMatrix<double> &       cell_stiffness_matrix,
+    FullMatrix<double> &       cell_mass_matrix)
+  {
+    const unsigned int dofs_per_cell = fe_values.dofs_per_cell;
+
+    cell_stiffness_matrix.reinit(dofs_per_cell, dofs_per_cell);
+    cell_mass_matrix.reinit(dofs_per_cell, dofs_per_cell);
+
+    for (unsigned int q_point = 0; q_point < fe_values.n_quadrature_points;
+         ++q_point)
+      {
+        for (unsigned int i = 0; i < dofs_per_cell; ++i)
           {
-            for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            for (unsigned int j = 0; j < dofs_per_cell; ++j)
               {
-                for (unsigned int j = 0; j < dofs_per_cell; ++j)
-                  {
-                    // Note that (in general) the Nedelec element is not
-                    // primitive, namely that the shape functions are vectorial
-                    // with components in more than one direction
+                // Note that (in general) the Nedelec element is not
+                // primitive, namely that the shape functions are vectorial
+                // with components in more than one direction
 
-                    cell_stiffness_matrix(i, j) +=
-                      Operations::curlcurl(fe_values, i, j, q_point) *
-                      fe_values.JxW(q_point);
+                cell_stiffness_matrix(i, j) +=
+                  Operations::curlcurl(fe_values, i, j, q_point) *
+                  JxW[q_point];
 
-                    cell_mass_matrix(i, j) +=
-                      (Operations::dot_term(fe_values, i, j, q_point)) *
-                      fe_values.JxW(q_point);
-                  }
+                cell_mass_matrix(i, j) +=
+                  (Operations::dot_term(fe_values, i, j, q_point)) *
+                  JxW[q_point];
               }
-            local_dof_indices.resize(dofs_per_cell);
-            cell->get_dof_indices(local_dof_indices);
           }
-
-        constraints.distribute_local_to_global(cell_stiffness_matrix,
-                                               local_dof_indices,
-                                               stiffness_matrix);
-        constraints.distribute_local_to_global(cell_mass_matrix,
-                                               local_dof_indices,
-                                               mass_matrix);
       }
+  }
+
+  template <int dim>
+  void
+  EigenSolver<dim>::distribute_local_to_global(
+    const FullMatrix<double> &                  cell_stiffness_matrix,
+    const FullMatrix<double> &                  cell_mass_matrix,
+    const std::vector<types::global_dof_index> &local_dof_indices)
+  {
+    constraints.distribute_local_to_global(cell_stiffness_matrix,
+                                           local_dof_indices,
+                                           stiffness_matrix);
+    constraints.distribute_local_to_global(cell_mass_matrix,
+                                           local_dof_indices,
+                                           mass_matrix);
+  }
+
+  /**
+  Compresses the system matrices and sets the diagonal entries of the
+  constrained rows
+  */
+  template <int dim>
+  void
+  EigenSolver<dim>::finalize_system_matrices()
+  {
     stiffness_matrix.compress(VectorOperation::add);
     mass_matrix.compress(VectorOperation::add);
 
@@ -773,6 +963,9 @@ namespace ErrorIndicators
     void
     synchronize_discretization();
 
+    void
+    prepare_for_coarsening_and_refinement();
+
     unsigned int
     get_max_degree()
     {
@@ -799,18 +992,41 @@ namespace ErrorIndicators
 
     /*The following FEValues objects are unique_ptrs to 1) avoid default
     constructors for these objects, and 2) automate memory management*/
-    std::unique_ptr<hp::FEValues<dim>>        cell_hp_fe_values;
-    std::unique_ptr<hp::FEFaceValues<dim>>    face_hp_fe_values;
-    std::unique_ptr<hp::FEFaceValues<dim>>    face_hp_fe_values_neighbor;
-    std::unique_ptr<hp::FESubfaceValues<dim>> subface_hp_fe_values;
+    std::unique_ptr<hp::FEValues<dim>> cell_hp_fe_values;
 
     std::unique_ptr<hp::FEValues<dim>>     cell_hp_fe_values_forward;
     std::unique_ptr<hp::FEFaceValues<dim>> face_hp_fe_values_forward;
     std::unique_ptr<hp::FEFaceValues<dim>> face_hp_fe_values_neighbor_forward;
     std::unique_ptr<hp::FESubfaceValues<dim>> subface_hp_fe_values_forward;
+    /*The FEValues objects for the cell and edge residuals of one cell. The
+    estimation runs in parallel over the cells, so every thread works on its
+    own copy.*/
+    struct EstimationScratchData
+    {
+      EstimationScratchData(
+        const hp::FECollection<dim> &    fe_collection,
+        const hp::QCollection<dim> &     quadrature_collection,
+        const hp::QCollection<dim - 1> &face_quadrature_collection);
+
+      EstimationScratchData(const EstimationScratchData &scratch_data);
+
+      hp::FEValues<dim>        cell_hp_fe_values;
+      hp::FEFaceValues<dim>    face_hp_fe_values;
+      hp::FEFaceValues<dim>    face_hp_fe_values_neighbor;
+      hp::FESubfaceValues<dim> subface_hp_fe_values;
+    };
+
+    /*Every cell writes its indicator and the integrals over the faces it owns
+    directly, so there is nothing to copy*/
+    struct EstimationCopyData
+    {};
+
     using FaceIntegrals =
       typename std::map<typename DoFHandler<dim>::face_iterator, double>;
 
+    void
+    assemble_primal_and_dual_systems();
+
     unsigned int
     solve_primal_problem();
 
@@ -831,6 +1047,7 @@ namespace ErrorIndicators
     void
     estimate_on_one_cell(
       const typename DoFHandler<dim>::active_cell_iterator &cell,
+      EstimationScratchData &                               scratch_data,
       const Vector<double> &                                primal_solution,
       const Vector<double> &                                dual_weights,
       const double &                                        lambda_h,
@@ -840,6 +1057,7 @@ namespace ErrorIndicators
     void
     integrate_over_cell(
       const typename DoFHandler<dim>::active_cell_iterator &cell,
+      EstimationScratchData &                               scratch_data,
       const Vector<double> &                                primal_solution,
       const Vector<double> &                                dual_weights,
       const double &                                        lambda_h,
@@ -848,6 +1066,7 @@ namespace ErrorIndicators
     void
     integrate_over_regular_face(
       const typename DoFHandler<dim>::active_cell_iterator &cell,
+      EstimationScratchData &                               scratch_data,
       const unsigned int &                                  face_no,
       const Vector<double> &                                primal_solution,
       const Vector<double> &                                dual_weights,
@@ -856,6 +1075,7 @@ namespace ErrorIndicators
     void
     integrate_over_irregular_face(
       const typename DoFHandler<dim>::active_cell_iterator &cell,
+      EstimationScratchData &                               scratch_data,
       const unsigned int &                                  face_no,
       const Vector<double> &                                primal_solution,
       const Vector<double> &                                dual_weights,
@@ -978,20 +1198,112 @@ namespace ErrorIndicators
     PrimalSolver<dim>::output_solution();
   }
 
+  /**
+  Assembles the primal and the dual matrices in one loop over the cells. Both
+  spaces live on the same triangulation with the same active FE indices, so
+  the cells of the two DoFHandlers are traversed in lockstep. The primal
+  space is evaluated at the quadrature points of the dual space, which also
+  integrate the (lower order) primal integrands exactly, so that the
+  quadrature weights of the dual FEValues can be used for both.
+  */
+  template <int dim, bool report_dual>
+  void
+  DualWeightedResidual<dim, report_dual>::assemble_primal_and_dual_systems()
+  {
+    hp::FEValues<dim> primal_hp_fe_values(*PrimalSolver<dim>::fe_collection,
+                                          *DualSolver<dim>::quadrature_collection,
+                                          update_values | update_gradients);
+    hp::FEValues<dim> dual_hp_fe_values(*DualSolver<dim>::fe_collection,
+                                        *DualSolver<dim>::quadrature_collection,
+                                        update_values | update_gradients |
+                                          update_JxW_values);
+
+    PrimalSolver<dim>::initialize_system_matrices();
+    DualSolver<dim>::initialize_system_matrices();
+
+    FullMatrix<double> cell_stiffness_matrix, cell_mass_matrix;
+    std::vector<types::global_dof_index> local_dof_indices;
+
+    typename DoFHandler<dim>::active_cell_iterator
+      primal_cell = PrimalSolver<dim>::dof_handler.begin_active();
+    for (const auto &dual_cell :
+         DualSolver<dim>::dof_handler.active_cell_iterators())
+      {
+        Assert(primal_cell->active_fe_index() == dual_cell->active_fe_index(),
+               ExcInternalError());
+
+        dual_hp_fe_values.reinit(dual_cell);
+        primal_hp_fe_values.reinit(primal_cell);
+
+        const FEValues<dim> &dual_fe_values =
+          dual_hp_fe_values.get_present_fe_values();
+        const FEValues<dim> &primal_fe_values =
+          primal_hp_fe_values.get_present_fe_values();
+        const std::vector<double> &JxW = dual_fe_values.get_JxW_values();
+
+        PrimalSolver<dim>::compute_cell_matrices(primal_fe_values,
+                                                 JxW,
+                                                 cell_stiffness_matrix,
+                                                 cell_mass_matrix);
+        local_dof_indices.resize(primal_cell->get_fe().dofs_per_cell);
+        primal_cell->get_dof_indices(local_dof_indices);
+        PrimalSolver<dim>::distribute_local_to_global(cell_stiffness_matrix,
+                                                      cell_mass_matrix,
+                                                      local_dof_indices);
+
+        PrimalSolver<dim>::compute_cell_matrices(dual_fe_values,
+                                                 JxW,
+                                                 cell_stiffness_matrix,
+                                                 cell_mass_matrix);
+        local_dof_indices.resize(dual_cell->get_fe().dofs_per_cell);
+        dual_cell->get_dof_indices(local_dof_indices);
+        DualSolver<dim>::distribute_local_to_global(cell_stiffness_matrix,
+                                                    cell_mass_matrix,
+                                                    local_dof_indices);
+
+        ++primal_cell;
+      }
+
+    PrimalSolver<dim>::finalize_system_matrices();
+    DualSolver<dim>::finalize_system_matrices();
+  }
+
   // Solves the primal problem
   template <int dim, bool report_dual>
   unsigned int
   DualWeightedResidual<dim, report_dual>::solve_primal_problem()
   {
-    return PrimalSolver<dim>::solve_problem();
+    return PrimalSolver<dim>::solve_eigenproblem();
   }
 
-  // Solves the dual problem
+  /**
+  Solves the dual problem. The eigenpair of the enriched space is close to the
+  primal one, so the primal eigenfunction (embedded into the dual space) is
+  the initial space of the eigensolver and the primal eigenvalue is the shift
+  of the spectral transformation.
+  */
   template <int dim, bool report_dual>
   unsigned int
   DualWeightedResidual<dim, report_dual>::solve_dual_problem()
   {
-    return DualSolver<dim>::solve_problem();
+    Vector<double> &initial_space = DualSolver<dim>::initial_space;
+    if (this->parameters->get_bool("Reuse previous eigenfunction"))
+      {
+        initial_space.reinit(DualSolver<dim>::dof_handler.n_dofs());
+        embed(PrimalSolver<dim>::dof_handler,
+              DualSolver<dim>::dof_handler,
+              DualSolver<dim>::constraints,
+              *(PrimalSolver<dim>::get_solution()),
+              initial_space);
+        DualSolver<dim>::constraints.distribute(initial_space);
+
+        DualSolver<dim>::target_eigenvalue =
+          *(PrimalSolver<dim>::get_lambda_h());
+      }
+    else
+      initial_space.reinit(0);
+
+    return DualSolver<dim>::solve_eigenproblem();
   }
 
   /**
@@ -1002,6 +1314,10 @@ namespace ErrorIndicators
   unsigned int
   DualWeightedResidual<dim, report_dual>::solve_problem()
   {
+    PrimalSolver<dim>::setup_system();
+    DualSolver<dim>::setup_system();
+    assemble_primal_and_dual_systems();
+
     DualWeightedResidual<dim, report_dual>::solve_primal_problem();
     return DualWeightedResidual<dim, report_dual>::solve_dual_problem();
   }
@@ -1050,6 +1366,18 @@ namespace ErrorIndicators
       }
   }
 
+  /**
+  Only the primal eigenfunction is transferred to the next cycle: the dual
+  problem starts from the primal solution of the same cycle (see
+  solve_dual_problem()).
+  */
+  template <int dim, bool report_dual>
+  void
+  DualWeightedResidual<dim, report_dual>::prepare_for_coarsening_and_refinement()
+  {
+    PrimalSolver<dim>::prepare_for_coarsening_and_refinement();
+  }
+
   /**
   Initializes the unique pointers which contain the necessary fe_values objects
   for computing the cell and edge residuals
@@ -1064,22 +1392,40 @@ namespace ErrorIndicators
       *DualSolver<dim>::quadrature_collection,
       update_values | update_hessians | update_quadrature_points |
         update_JxW_values);
-    face_hp_fe_values = std::make_unique<hp::FEFaceValues<dim>>(
-      *DualSolver<dim>::fe_collection,
-      *DualSolver<dim>::face_quadrature_collection,
-      update_values | update_gradients | update_JxW_values |
-        update_normal_vectors);
-    face_hp_fe_values_neighbor = std::make_unique<hp::FEFaceValues<dim>>(
-      *DualSolver<dim>::fe_collection,
-      *DualSolver<dim>::face_quadrature_collection,
-      update_values | update_gradients | update_JxW_values |
-        update_normal_vectors);
-    subface_hp_fe_values = std::make_unique<hp::FESubfaceValues<dim>>(
-      *DualSolver<dim>::fe_collection,
-      *DualSolver<dim>::face_quadrature_collection,
-      update_gradients);
   }
 
+  template <int dim, bool report_dual>
+  DualWeightedResidual<dim, report_dual>::EstimationScratchData::
+    EstimationScratchData(
+      const hp::FECollection<dim> &    fe_collection,
+      const hp::QCollection<dim> &     quadrature_collection,
+      const hp::QCollection<dim - 1> &face_quadrature_collection)
+    : cell_hp_fe_values(fe_collection,
+                        quadrature_collection,
+                        update_values | update_hessians |
+                          update_quadrature_points | update_JxW_values)
+    , face_hp_fe_values(fe_collection,
+                        face_quadrature_collection,
+                        update_values | update_gradients | update_JxW_values |
+                          update_normal_vectors)
+    , face_hp_fe_values_neighbor(fe_collection,
+                                 face_quadrature_collection,
+                                 update_values | update_gradients |
+                                   update_JxW_values | update_normal_vectors)
+    , subface_hp_fe_values(fe_collection,
+                           face_quadrature_collection,
+                           update_gradients)
+  {}
+
+  template <int dim, bool report_dual>
+  DualWeightedResidual<dim, report_dual>::EstimationScratchData::
+    EstimationScratchData(const EstimationScratchData &scratch_data)
+    : EstimationScratchData(
+        scratch_data.cell_hp_fe_values.get_fe_collection(),
+        scratch_data.cell_hp_fe_values.get_quadrature_collection(),
+        scratch_data.face_hp_fe_values.get_quadrature_collection())
+  {}
+
   /**
   Since any scalar multiple of an eigenvector is also an eigenvector, we must
   choose some normalization strategy. For convenience in the QoI expression, the
@@ -1188,16 +1534,30 @@ namespace ErrorIndicators
         face_integrals[face] = -1e20;
 
 
-    for (const auto &cell :
-         DualSolver<dim>::dof_handler.active_cell_iterators())
-      {
+    // The cells are estimated in parallel. This is safe since every face
+    // integral is computed by exactly one cell (see estimate_on_one_cell) and
+    // all entries of the map exist already, and every cell only writes its
+    // own error indicator.
+    const double lambda_h = *(PrimalSolver<dim>::get_lambda_h());
+    WorkStream::run(
+      DualSolver<dim>::dof_handler.begin_active(),
+      DualSolver<dim>::dof_handler.end(),
+      [&](const typename DoFHandler<dim>::active_cell_iterator &cell,
+          EstimationScratchData &                               scratch_data,
+          EstimationCopyData &) {
         estimate_on_one_cell(cell,
+                             scratch_data,
                              primal_solution,
                              dual_weights,
-                             *(PrimalSolver<dim>::get_lambda_h()),
+                             lambda_h,
                              error_indicators,
                              face_integrals);
-      }
+      },
+      [](const EstimationCopyData &) {},
+      EstimationScratchData(*DualSolver<dim>::fe_collection,
+                            *DualSolver<dim>::quadrature_collection,
+                            *DualSolver<dim>::face_quadrature_collection),
+      EstimationCopyData());
     unsigned int present_cell = 0;
     for (const auto &cell :
          DualSolver<dim>::dof_handler.active_cell_iterators())
@@ -1228,14 +1588,19 @@ namespace ErrorIndicators
   void
   DualWeightedResidual<dim, report_dual>::estimate_on_one_cell(
     const typename DoFHandler<dim>::active_cell_iterator &cell,
+    EstimationScratchData &                               scratch_data,
     const Vector<double> &                                primal_solution,
     const Vector<double> &                                dual_weights,
     const double &                                        lambda_h,
     Vector<double> &                                      error_indicators,
     FaceIntegrals &                                       face_integrals)
   {
-    integrate_over_cell(
-      cell, primal_solution, dual_weights, lambda_h, error_indicators);
+    integrate_over_cell(cell,
+                        scratch_data,
+                        primal_solution,
+                        dual_weights,
+                        lambda_h,
+                        error_indicators);
     for (unsigned int face_no : GeometryInfo<dim>::face_indices())
       {
         if (cell->face(face_no)->at_boundary())
@@ -1251,11 +1616,19 @@ namespace ErrorIndicators
           if (cell->neighbor(face_no)->level() < cell->level())
             continue;
         if (cell->face(face_no)->has_children() == false)
-          integrate_over_regular_face(
-            cell, face_no, primal_solution, dual_weights, face_integrals);
+          integrate_over_regular_face(cell,
+                                      scratch_data,
+                                      face_no,
+                                      primal_solution,
+                                      dual_weights,
+                                      face_integrals);
         else
-          integrate_over_irregular_face(
-            cell, face_no, primal_solution, dual_weights, face_integrals);
+          integrate_over_irregular_face(cell,
+                                        scratch_data,
+                                        face_no,
+                                        primal_solution,
+                                        dual_weights,
+                                        face_integrals);
       }
   }
 
@@ -1266,14 +1639,16 @@ namespace ErrorIndicators
   void
   DualWeightedResidual<dim, report_dual>::integrate_over_cell(
     const typename DoFHandler<dim>::active_cell_iterator &cell,
+    EstimationScratchData &                               scratch_data,
     const Vector<double> &                                primal_solution,
     const Vector<double> &                                dual_weights,
     const double &                                        lambda_h,
     Vector<double> &                                      error_indicators)
   {
-    cell_hp_fe_values->reinit(cell);
+    scratch_data.cell_hp_fe_values.reinit(cell);
     // Grab the fe_values object
-    const FEValues<dim> &fe_values = cell_hp_fe_values->get_present_fe_values();
+    const FEValues<dim> &fe_values =
+      scratch_data.cell_hp_fe_values.get_present_fe_values();
     std::vector<std::vector<Tensor<2, dim, double>>> cell_hessians(
       fe_values.n_quadrature_points, std::vector<Tensor<2, dim, double>>(dim));
     std::vector<Vector<double>> cell_primal_values(
@@ -1310,6 +1685,7 @@ namespace ErrorIndicators
   void
   DualWeightedResidual<dim, report_dual>::integrate_over_regular_face(
     const typename DoFHandler<dim>::active_cell_iterator &cell,
+    EstimationScratchData &                               scratch_data,
     const unsigned int &                                  face_no,
     const Vector<double> &                                primal_solution,
     const Vector<double> &                                dual_weights,
@@ -1322,9 +1698,9 @@ namespace ErrorIndicators
 
     const unsigned int quadrature_index =
       std::max(cell->active_fe_index(), neighbor->active_fe_index());
-    face_hp_fe_values->reinit(cell, face_no, quadrature_index);
+    scratch_data.face_hp_fe_values.reinit(cell, face_no, quadrature_index);
     const FEFaceValues<dim> &fe_face_values_cell =
-      face_hp_fe_values->get_present_fe_values();
+      scratch_data.face_hp_fe_values.get_present_fe_values();
     std::vector<std::vector<Tensor<1, dim, double>>> cell_primal_grads(
       fe_face_values_cell.n_quadrature_points,
       std::vector<Tensor<1, dim, double>>(dim)),
@@ -1333,11 +1709,11 @@ namespace ErrorIndicators
     fe_face_values_cell.get_function_gradients(primal_solution,
                                                cell_primal_grads);
 
-    face_hp_fe_values_neighbor->reinit(neighbor,
-                                       neighbor_neighbor,
-                                       quadrature_index);
+    scratch_data.face_hp_fe_values_neighbor.reinit(neighbor,
+                                                   neighbor_neighbor,
+                                                   quadrature_index);
     const FEFaceValues<dim> &fe_face_values_cell_neighbor =
-      face_hp_fe_values_neighbor->get_present_fe_values();
+      scratch_data.face_hp_fe_values_neighbor.get_present_fe_values();
     fe_face_values_cell_neighbor.get_function_gradients(primal_solution,
                                                         neighbor_primal_grads);
     const unsigned int n_q_points    = fe_face_values_cell.n_quadrature_points;
@@ -1369,6 +1745,7 @@ namespace ErrorIndicators
   void
   DualWeightedResidual<dim, report_dual>::integrate_over_irregular_face(
     const typename DoFHandler<dim>::active_cell_iterator &cell,
+    EstimationScratchData &                               scratch_data,
     const unsigned int &                                  face_no,
     const Vector<double> &                                primal_solution,
     const Vector<double> &                                dual_weights,
@@ -1393,12 +1770,12 @@ namespace ErrorIndicators
         const unsigned int quadrature_index =
           std::max(cell->active_fe_index(), neighbor_child->active_fe_index());
         // initialize fe_subface values_cell
-        subface_hp_fe_values->reinit(cell,
-                                     face_no,
-                                     subface_no,
-                                     quadrature_index);
+        scratch_data.subface_hp_fe_values.reinit(cell,
+                                                 face_no,
+                                                 subface_no,
+                                                 quadrature_index);
         const FESubfaceValues<dim> &subface_fe_values_cell =
-          subface_hp_fe_values->get_present_fe_values();
+          scratch_data.subface_hp_fe_values.get_present_fe_values();
         std::vector<std::vector<Tensor<1, dim, double>>> cell_primal_grads(
           subface_fe_values_cell.n_quadrature_points,
           std::vector<Tensor<1, dim, double>>(dim)),
@@ -1407,11 +1784,11 @@ namespace ErrorIndicators
         subface_fe_values_cell.get_function_gradients(primal_solution,
                                                       cell_primal_grads);
         // initialize fe_face_values_neighbor
-        face_hp_fe_values_neighbor->reinit(neighbor_child,
-                                           neighbor_neighbor,
-                                           quadrature_index);
+        scratch_data.face_hp_fe_values_neighbor.reinit(neighbor_child,
+                                                       neighbor_neighbor,
+                                                       quadrature_index);
         const FEFaceValues<dim> &face_fe_values_neighbor =
-          face_hp_fe_values_neighbor->get_present_fe_values();
+          scratch_data.face_hp_fe_values_neighbor.get_present_fe_values();
         face_fe_values_neighbor.get_function_gradients(primal_solution,
                                                        neighbor_primal_grads);
         const unsigned int n_q_points =
@@ -1879,30 +2256,116 @@ namespace RegularityIndicators
       legendre_v->precalculate_all_transformation_matrices();
     }
 
+    /*
+    Computes the decay rates of the Legendre coefficients of both components
+    of the eigenfunction and takes the smaller one. This is the same as
+    calling SmoothnessEstimator::Legendre::coefficient_decay once per component
+    and merging the results, but the local DoF values of every cell are read
+    only once, and the cells are processed in parallel. Only the cells flagged
+    for refinement or coarsening are considered, as the $hp$-decision is not
+    made anywhere else; the other indicators are left untouched.
+    */
     template <class VectorType>
     void
     compute_coefficient_decay(const VectorType &   eigenfunction,
                               std::vector<double> &smoothness_indicators)
     {
-      // Compute the coefficients for the u and v components of the solution
-      // separately,
-      Vector<float> smoothness_u(smoothness_indicators.size()),
-        smoothness_v(smoothness_indicators.size());
-
-      SmoothnessEstimator::Legendre::coefficient_decay(*legendre_u,
-                                                       *dof_handler,
-                                                       eigenfunction,
-                                                       smoothness_u);
-
-      SmoothnessEstimator::Legendre::coefficient_decay(*legendre_v,
-                                                       *dof_handler,
-                                                       eigenfunction,
-                                                       smoothness_v);
-
-      for (unsigned int i = 0; i < smoothness_indicators.size(); ++i)
-        {
-          smoothness_indicators[i] = std::min(smoothness_u[i], smoothness_v[i]);
-        }
+      assert(smoothness_indicators.size() ==
+               dof_handler->get_triangulation().n_active_cells() &&
+             "Incorrect size of the smoothness indicators!");
+
+      // FESeries::Legendre stores intermediate results, so every thread
+      // needs its own copies (which also copy the precalculated matrices)
+      struct ScratchData
+      {
+        FESeries::Legendre<2> legendre_u, legendre_v;
+        Vector<double>        local_dof_values;
+        Table<2, double>      coefficients;
+      };
+      struct CopyData
+      {};
+
+      // Read the (possibly PETSc) vector only from this thread
+      const Vector<double> solution(eigenfunction);
+
+      using FlaggedCellIterator =
+        FilteredIterator<DoFHandler<2>::active_cell_iterator>;
+      const auto is_flagged = [](const DoFHandler<2>::active_cell_iterator &cell) {
+        return cell->refine_flag_set() || cell->coarsen_flag_set();
+      };
+      const DoFHandler<2>::active_cell_iterator begin =
+                                                  dof_handler->begin_active(),
+                                                end = dof_handler->end();
+
+      WorkStream::run(
+        FlaggedCellIterator(is_flagged, begin),
+        FlaggedCellIterator(is_flagged, end),
+        [&solution, &smoothness_indicators](
+          const FlaggedCellIterator &cell,
+          ScratchData &              scratch_data,
+          CopyData &) {
+          scratch_data.local_dof_values.reinit(cell->get_fe().dofs_per_cell);
+          cell->get_dof_values(solution, scratch_data.local_dof_values);
+
+          smoothness_indicators[cell->active_cell_index()] =
+            std::min(decay_rate(scratch_data.legendre_u,
+                                scratch_data.local_dof_values,
+                                cell->active_fe_index(),
+                                cell->get_fe().degree,
+                                scratch_data.coefficients),
+                     decay_rate(scratch_data.legendre_v,
+                                scratch_data.local_dof_values,
+                                cell->active_fe_index(),
+                                cell->get_fe().degree,
+                                scratch_data.coefficients));
+        },
+        [](const CopyData &) {},
+        ScratchData{*legendre_u, *legendre_v, {}, {}},
+        CopyData());
+    }
+
+  private:
+    /*
+    The decay rate of the Legendre coefficients of one component on one cell,
+    computed in the same way as in SmoothnessEstimator::Legendre:
+    the coefficients are grouped by the sum $k$ of their indices, only the
+    groups with $k < p + 1$ for the degree $p$ of the cell are used, and the
+    largest coefficient of each group (above a threshold) is fitted by
+    $\exp(-\sigma k + c)$ and $\sigma$ is returned
+    */
+    static double
+    decay_rate(FESeries::Legendre<2> &legendre,
+               const Vector<double> & local_dof_values,
+               const unsigned int     active_fe_index,
+               const unsigned int     degree,
+               Table<2, double> &     coefficients)
+    {
+      const unsigned int n_coefficients =
+        legendre.get_n_coefficients_per_direction(active_fe_index);
+      coefficients.reinit(TableIndices<2>(n_coefficients, n_coefficients));
+
+      legendre.calculate(local_dof_values, active_fe_index, coefficients);
+
+      const std::pair<std::vector<unsigned int>, std::vector<double>>
+        processed_coefficients = FESeries::process_coefficients<2>(
+          coefficients,
+          [degree](const TableIndices<2> &indices) {
+            const unsigned int s = indices[0] + indices[1];
+            return std::make_pair(s < degree + 1, s);
+          },
+          VectorTools::Linfty_norm,
+          1e-10);
+
+      if (processed_coefficients.first.size() < 2)
+        return std::numeric_limits<double>::max();
+
+      std::vector<double> degrees(processed_coefficients.first.begin(),
+                                  processed_coefficients.first.end());
+      std::vector<double> log_coefficients(processed_coefficients.second);
+      for (double &coefficient : log_coefficients)
+        coefficient = std::log(coefficient);
+
+      return -FESeries::linear_regression(degrees, log_coefficients).first;
     }
   };
 
@@ -2191,6 +2654,7 @@ namespace Refinement
         std::cout << "Min diameter: " << min_diameter << std::endl;
 
         ErrorIndicator::synchronize_discretization();
+        ErrorIndicator::prepare_for_coarsening_and_refinement();
 
         (this->triangulation)->execute_coarsening_and_refinement();
       }
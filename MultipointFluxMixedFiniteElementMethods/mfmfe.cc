@@ -13,19 +13,29 @@
 // As usual, the list of necessary header files. There is not
 // much new here, the files are included in order
 // base-lac-grid-dofs-numerics followed by the C++ headers.
+#include <deal.II/base/conditional_ostream.h>
 #include <deal.II/base/convergence_table.h>
+#include <deal.II/base/index_set.h>
+#include <deal.II/base/mpi.h>
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/base/logstream.h>
 #include <deal.II/base/timer.h>
 #include <deal.II/base/utilities.h>
+#include <deal.II/base/vectorization.h>
 #include <deal.II/base/work_stream.h>
 
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
 #include <deal.II/lac/full_matrix.h>
 #include <deal.II/lac/solver_cg.h>
-#include <deal.II/lac/block_sparse_matrix.h>
-#include <deal.II/lac/block_vector.h>
-#include <deal.II/lac/precondition.h>
+#include <deal.II/lac/sparsity_tools.h>
+#include <deal.II/lac/trilinos_precondition.h>
+#include <deal.II/lac/trilinos_sparse_matrix.h>
+#include <deal.II/lac/trilinos_vector.h>
+#include <deal.II/lac/vector.h>
 
+#include <deal.II/distributed/tria.h>
+
+#include <deal.II/grid/filtered_iterator.h>
 #include <deal.II/grid/grid_generator.h>
 #include <deal.II/grid/grid_tools.h>
 #include <deal.II/grid/grid_in.h>
@@ -39,8 +49,10 @@
 #include <deal.II/numerics/matrix_tools.h>
 #include <deal.II/numerics/data_out.h>
 
+#include <algorithm>
+#include <array>
 #include <fstream>
-#include <unordered_map>
+#include <vector>
 
 // This is a header needed for the purposes of the
 // multipoint flux mixed method, as it declares the
@@ -70,72 +82,156 @@ namespace MFMFE
   {
     // This will be achieved by assembling cell-wise, but instead of placing
     // the terms into a global system matrix, they will populate node-associated
-    // full matrices. For this, a data structure with fast lookup is crucial, hence
-    // the hash table, with the keys as Point<dim>
-    template <int dim>
-    struct hash_points
+    // full matrices. The nodes are the Gauss-Lobatto quadrature points, i.e.,
+    // the vertices of the mesh, points on its lines and faces and points in
+    // the interior of its cells. They are numbered once per mesh by the
+    // topological entity they belong to, see
+    // <code>MultipointMixedDarcyProblem::number_nodes()</code>, so that the
+    // nodal data can be stored in flat arrays indexed by these numbers.
+    //
+    // For each node, the velocity and pressure DoFs coupled at the node are
+    // stored, sorted, between the respective offsets of
+    // <code>velocity_indices</code> and <code>pressure_indices</code>, in the
+    // same way as the column indices of a sparse matrix in CSR format. The
+    // velocity DoFs are global DoF indices, the pressure DoFs are the
+    // indices of the pressure system, i.e., shifted by the number of
+    // velocity DoFs. The
+    // node-local matrices $A_i$ and $B_i$ are stored row by row, and the
+    // right hand sides use the same offsets as the DoF indices. All sizes are
+    // known before the assembly starts, so each of the arrays is allocated
+    // once per mesh. Every node owns a separate part of the arrays, hence
+    // different nodes can be worked on concurrently.
+    struct NodeStorage
     {
-      size_t operator()(const Point<dim> &p) const
+      void clear ();
+
+      unsigned int n_velocity_dofs (const unsigned int node) const
       {
-        size_t h1,h2,h3;
-        h1 = std::hash<double>()(p[0]);
+        return velocity_offsets[node+1] - velocity_offsets[node];
+      }
 
-        switch (dim)
-          {
-          case 1:
-            return h1;
-          case 2:
-            h2 = std::hash<double>()(p[1]);
-            return (h1 ^ h2);
-          case 3:
-            h2 = std::hash<double>()(p[1]);
-            h3 = std::hash<double>()(p[2]);
-            return (h1 ^ (h2 << 1)) ^ h3;
-          default:
-            Assert(false, ExcNotImplemented());
-          }
+      unsigned int n_pressure_dofs (const unsigned int node) const
+      {
+        return pressure_offsets[node+1] - pressure_offsets[node];
+      }
+
+      // The position of a DoF in the list of the node, or
+      // <code>numbers::invalid_unsigned_int</code> if the DoF is not
+      // coupled at that node
+      unsigned int velocity_position (const unsigned int            node,
+                                      const types::global_dof_index dof) const;
+      unsigned int pressure_position (const unsigned int            node,
+                                      const types::global_dof_index dof) const;
+
+      double *velocity_matrix (const unsigned int node)
+      {
+        return velocity_matrix_values.data() + velocity_matrix_offsets[node];
+      }
+
+      double *pressure_matrix (const unsigned int node)
+      {
+        return pressure_matrix_values.data() + pressure_matrix_offsets[node];
+      }
+
+      double *velocity_rhs (const unsigned int node)
+      {
+        return velocity_rhs_values.data() + velocity_offsets[node];
       }
+
+      double *pressure_rhs (const unsigned int node)
+      {
+        return pressure_rhs_values.data() + pressure_offsets[node];
+      }
+
+      // The node of each quadrature point of each active cell, stored for
+      // cell <code>c</code> at <code>c*n_q_points</code> and following
+      std::vector<unsigned int> cell_nodes;
+
+      // All nodes with velocity DoFs, i.e., the ones that take part in the
+      // elimination
+      std::vector<unsigned int> nodes;
+
+      std::vector<unsigned int>            velocity_offsets;
+      std::vector<unsigned int>            pressure_offsets;
+      std::vector<types::global_dof_index> velocity_indices;
+      std::vector<types::global_dof_index> pressure_indices;
+
+      std::vector<std::size_t> velocity_matrix_offsets;
+      std::vector<std::size_t> pressure_matrix_offsets;
+
+      // $A_i$, which is replaced by $A_i^{-1}$ during the elimination, and
+      // $B_i$ of all nodes
+      std::vector<double> velocity_matrix_values;
+      std::vector<double> pressure_matrix_values;
+      std::vector<double> velocity_rhs_values;
+      std::vector<double> pressure_rhs_values;
     };
 
-    // Here, the actual hash-tables are defined. We use the C++ STL <code>unordered_map</code>,
-    // with the hash function specified above. For convenience these are aliased as follows
-    template <int dim>
-    using PointToMatrixMap = std::unordered_map<Point<dim>, std::map<std::pair<types::global_dof_index,types::global_dof_index>, double>, hash_points<dim>>;
+    void NodeStorage::clear ()
+    {
+      cell_nodes.clear();
+      nodes.clear();
+      velocity_offsets.clear();
+      pressure_offsets.clear();
+      velocity_indices.clear();
+      pressure_indices.clear();
+      velocity_matrix_offsets.clear();
+      pressure_matrix_offsets.clear();
+      velocity_matrix_values.clear();
+      pressure_matrix_values.clear();
+      velocity_rhs_values.clear();
+      pressure_rhs_values.clear();
+    }
 
-    template <int dim>
-    using PointToVectorMap = std::unordered_map<Point<dim>, std::map<types::global_dof_index, double>, hash_points<dim>>;
+    unsigned int
+    NodeStorage::velocity_position (const unsigned int            node,
+                                    const types::global_dof_index dof) const
+    {
+      const auto begin = velocity_indices.begin() + velocity_offsets[node];
+      const auto end   = velocity_indices.begin() + velocity_offsets[node+1];
+      const auto it    = std::lower_bound(begin, end, dof);
+      return (it != end && *it == dof) ? it - begin : numbers::invalid_unsigned_int;
+    }
 
-    template <int dim>
-    using PointToIndexMap = std::unordered_map<Point<dim>, std::set<types::global_dof_index>, hash_points<dim>>;
+    unsigned int
+    NodeStorage::pressure_position (const unsigned int            node,
+                                    const types::global_dof_index dof) const
+    {
+      const auto begin = pressure_indices.begin() + pressure_offsets[node];
+      const auto end   = pressure_indices.begin() + pressure_offsets[node+1];
+      const auto it    = std::lower_bound(begin, end, dof);
+      return (it != end && *it == dof) ? it - begin : numbers::invalid_unsigned_int;
+    }
 
     // Next, since this particular program allows for the use of
     // multiple threads, the helper CopyData structures
     // are defined. There are two kinds of these, one is used
     // for the copying cell-wise contributions to the corresponging
-    // node-associated data structures...
-    template <int dim>
+    // node-associated data structures. For every quadrature point of the
+    // cell, they hold the contributions of the cell to the node at that
+    // point, together with the positions of the cell's DoFs in the lists
+    // of the node. The vectors keep their size from one cell to the next.
     struct NodeAssemblyCopyData
     {
-      PointToMatrixMap<dim> cell_mat;
-      PointToVectorMap<dim> cell_vec;
-      PointToIndexMap<dim> local_pres_indices;
-      PointToIndexMap<dim> local_vel_indices;
-      std::vector<types::global_dof_index> local_dof_indices;
+      unsigned int                           cell_index;
+      std::vector<types::global_dof_index>   local_dof_indices;
+      std::vector<std::vector<double>>       cell_mat;
+      std::vector<std::vector<double>>       cell_div;
+      std::vector<std::vector<double>>       cell_vel_rhs;
+      std::vector<std::vector<double>>       cell_pres_rhs;
+      std::vector<std::vector<unsigned int>> vel_positions;
+      std::vector<std::vector<unsigned int>> pres_positions;
     };
 
     // ... and the other one for the actual process of
     // local velocity elimination and assembling the global
     // pressure system:
-    template <int dim>
     struct NodeEliminationCopyData
     {
       FullMatrix<double> node_pres_matrix;
       Vector<double>     node_pres_rhs;
-      FullMatrix<double> Ainverse;
-      FullMatrix<double> pressure_matrix;
-      Vector<double>     velocity_rhs;
       Vector<double>     vertex_vel_solution;
-      Point<dim>         p;
+      unsigned int       node;
     };
 
     // Similarly, two ScratchData classes are defined.
@@ -165,6 +261,8 @@ namespace MFMFE
       std::vector<Tensor<1,dim> > phi_u;
       std::vector<double>         div_phi_u;
       std::vector<double>         phi_p;
+      std::vector<double>         pres_bc;
+      FullMatrix<double>          div_matrix;
     };
 
     template <int dim>
@@ -188,7 +286,9 @@ namespace MFMFE
       pres_bc_values(f_quad.size()),
       phi_u(fe.dofs_per_cell),
       div_phi_u(fe.dofs_per_cell),
-      phi_p(fe.dofs_per_cell)
+      phi_p(fe.dofs_per_cell),
+      pres_bc(fe.dofs_per_cell),
+      div_matrix(fe.dofs_per_cell, fe.dofs_per_cell)
     {
       n_faces_at_vertex.resize(tria.n_vertices(), 0);
       typename Triangulation<dim>::active_face_iterator face = tria.begin_active_face(), endf = tria.end_face();
@@ -217,7 +317,9 @@ namespace MFMFE
       pres_bc_values(scratch_data.pres_bc_values),
       phi_u(scratch_data.phi_u),
       div_phi_u(scratch_data.div_phi_u),
-      phi_p(scratch_data.phi_p)
+      phi_p(scratch_data.phi_p),
+      pres_bc(scratch_data.pres_bc),
+      div_matrix(scratch_data.div_matrix)
     {}
 
     // ...and the other, simpler one, for the velocity elimination and recovery
@@ -227,6 +329,9 @@ namespace MFMFE
       VertexEliminationScratchData (const VertexEliminationScratchData &scratch_data);
 
       FullMatrix<double> velocity_matrix;
+      FullMatrix<double> velocity_matrix_inverse;
+      FullMatrix<double> pressure_matrix;
+      Vector<double> velocity_rhs;
       Vector<double> pressure_rhs;
 
       Vector<double> local_pressure_solution;
@@ -239,14 +344,73 @@ namespace MFMFE
     VertexEliminationScratchData (const VertexEliminationScratchData &scratch_data)
       :
       velocity_matrix(scratch_data.velocity_matrix),
+      velocity_matrix_inverse(scratch_data.velocity_matrix_inverse),
+      pressure_matrix(scratch_data.pressure_matrix),
+      velocity_rhs(scratch_data.velocity_rhs),
       pressure_rhs(scratch_data.pressure_rhs),
       local_pressure_solution(scratch_data.local_pressure_solution),
       tmp_rhs1(scratch_data.tmp_rhs1),
       tmp_rhs2(scratch_data.tmp_rhs2),
       tmp_rhs3(scratch_data.tmp_rhs3)
     {}
-  }
 
+    // Most nodes of a mesh have one of a few block sizes, e.g., in 2d
+    // $4\times 4$ at interior vertices, $3\times 3$ at interior edge points
+    // and $2\times 2$ at interior points of cells. For these, the elimination
+    // is done for as many nodes at once as there are lanes in a
+    // <code>VectorizedArray</code>, one node per lane. A batch consists of
+    // nodes with the same numbers of velocity and pressure DoFs. Unused lanes
+    // of the last batch of a size repeat its last node, but are not copied
+    // back.
+    struct NodeBatch
+    {
+      std::array<unsigned int, VectorizedArray<double>::size()> nodes;
+      unsigned int                                              n_filled;
+    };
+
+    // The batched counterpart of <code>NodeEliminationCopyData</code>, with
+    // the lane-wise node pressure matrices and right hand sides stored after
+    // each other
+    struct NodeBatchEliminationCopyData
+    {
+      NodeBatch           batch;
+      std::vector<double> node_pres_matrices;
+      std::vector<double> node_pres_rhs;
+    };
+
+    struct NodeBatchEliminationScratchData
+    {
+      AlignedVector<VectorizedArray<double>> pressure_matrix;
+      AlignedVector<VectorizedArray<double>> inverse_times_pressure_matrix;
+      AlignedVector<VectorizedArray<double>> pressure_rhs;
+    };
+
+    // The small dense kernel: in-place Gauss-Jordan inversion of an
+    // $n\times n$ matrix, stored row by row, in all lanes at once. The
+    // velocity mass matrices are symmetric positive definite, so no pivoting
+    // is needed. As the size is a template argument, the matrix lives on the
+    // stack and all loops have fixed bounds.
+    template <unsigned int n>
+    void invert_in_place (std::array<VectorizedArray<double>, n*n> &matrix)
+    {
+      for (unsigned int k=0; k<n; ++k)
+        {
+          const VectorizedArray<double> inverse_pivot = 1.0 / matrix[k*n + k];
+          matrix[k*n + k] = 1.0;
+          for (unsigned int j=0; j<n; ++j)
+            matrix[k*n + j] *= inverse_pivot;
+
+          for (unsigned int i=0; i<n; ++i)
+            if (i != k)
+              {
+                const VectorizedArray<double> factor = matrix[i*n + k];
+                matrix[i*n + k] = 0.0;
+                for (unsigned int j=0; j<n; ++j)
+                  matrix[i*n + j] -= factor * matrix[k*n + j];
+              }
+        }
+    }
+  }
 
 
   // @sect3{The <code>MultipointMixedDarcyProblem</code> class template}
@@ -264,54 +428,81 @@ namespace MFMFE
     ~MultipointMixedDarcyProblem ();
     void run (const unsigned int refine);
   private:
+    void number_nodes (const Quadrature<dim> &quad);
     void assemble_system_cell (const typename DoFHandler<dim>::active_cell_iterator &cell,
                                DataStructures::NodeAssemblyScratchData<dim>       &scratch_data,
-                               DataStructures::NodeAssemblyCopyData<dim>          &copy_data);
-    void copy_cell_to_node(const DataStructures::NodeAssemblyCopyData<dim> &copy_data);
+                               DataStructures::NodeAssemblyCopyData               &copy_data);
+    void copy_cell_to_node(const DataStructures::NodeAssemblyCopyData &copy_data);
     void node_assembly();
     void make_cell_centered_sp ();
-    void nodal_elimination(const typename DataStructures::PointToMatrixMap<dim>::iterator &n_it,
+    void nodal_elimination(const std::vector<unsigned int>::const_iterator &n_it,
                            DataStructures::VertexEliminationScratchData &scratch_data,
-                           DataStructures::NodeEliminationCopyData<dim> &copy_data);
-    void copy_node_to_system(const DataStructures::NodeEliminationCopyData<dim> &copy_data);
+                           DataStructures::NodeEliminationCopyData      &copy_data);
+    void copy_node_to_system(const DataStructures::NodeEliminationCopyData &copy_data);
+    template <unsigned int n_edges>
+    void eliminate_node_batch(const DataStructures::NodeBatch                  &batch,
+                              DataStructures::NodeBatchEliminationScratchData &scratch_data,
+                              DataStructures::NodeBatchEliminationCopyData    &copy_data);
+    void nodal_batch_elimination(const std::vector<DataStructures::NodeBatch>::const_iterator &b_it,
+                                 DataStructures::NodeBatchEliminationScratchData              &scratch_data,
+                                 DataStructures::NodeBatchEliminationCopyData                 &copy_data);
+    void copy_node_batch_to_system(const DataStructures::NodeBatchEliminationCopyData &copy_data);
     void pressure_assembly ();
     void solve_pressure ();
-    void velocity_assembly (const typename DataStructures::PointToMatrixMap<dim>::iterator &n_it,
-                            DataStructures::VertexEliminationScratchData                 &scratch_data,
-                            DataStructures::NodeEliminationCopyData<dim>               &copy_data);
-    void copy_node_velocity_to_global(const DataStructures::NodeEliminationCopyData<dim> &copy_data);
+    void velocity_assembly (const std::vector<unsigned int>::const_iterator &n_it,
+                            DataStructures::VertexEliminationScratchData    &scratch_data,
+                            DataStructures::NodeEliminationCopyData         &copy_data);
+    void copy_node_velocity_to_global(const DataStructures::NodeEliminationCopyData &copy_data);
     void velocity_recovery ();
     void reset_data_structures ();
     void compute_errors (const unsigned int cycle);
     void output_results (const unsigned int cycle,  const unsigned int refine);
 
-    const unsigned int  degree;
-    Triangulation<dim>  triangulation;
-    FESystem<dim>       fe;
-    DoFHandler<dim>     dof_handler;
-    BlockVector<double> solution;
-
-    SparsityPattern cell_centered_sp;
-    SparseMatrix<double> pres_system_matrix;
-    Vector<double> pres_rhs;
-
-    std::unordered_map<Point<dim>, FullMatrix<double>, DataStructures::hash_points<dim>> pressure_matrix;
-    std::unordered_map<Point<dim>, FullMatrix<double>, DataStructures::hash_points<dim>> A_inverse;
-    std::unordered_map<Point<dim>, Vector<double>, DataStructures::hash_points<dim>> velocity_rhs;
-
-    DataStructures::PointToMatrixMap<dim> node_matrix;
-    DataStructures::PointToVectorMap<dim> node_rhs;
-
-    DataStructures::PointToIndexMap<dim> pressure_indices;
-    DataStructures::PointToIndexMap<dim> velocity_indices;
+    MPI_Comm mpi_communicator;
+
+    const unsigned int                        degree;
+    parallel::distributed::Triangulation<dim> triangulation;
+    FESystem<dim>                             fe;
+    DoFHandler<dim>                           dof_handler;
+
+    // The locally owned and relevant DoFs, and their subsets belonging to
+    // the pressure. The relevant pressure DoFs are the ones on locally
+    // owned and ghost cells, i.e., all pressure DoFs the nodes of this
+    // process are coupled to.
+    IndexSet locally_owned_dofs;
+    IndexSet locally_relevant_dofs;
+    IndexSet locally_owned_pressure_dofs;
+    IndexSet locally_relevant_pressure_dofs;
+
+    // The pressure system is indexed by the pressure DoFs alone, numbered
+    // from zero, its rows are the locally owned pressure DoFs.
+    TrilinosWrappers::SparseMatrix pres_system_matrix;
+    TrilinosWrappers::MPI::Vector  pres_rhs;
+
+    // For each quadrature point of the reference cell, the local velocity
+    // DoFs located at it and the local pressure DoFs they are coupled to.
+    // These lists are the same on every cell.
+    std::vector<std::vector<unsigned int>> q_velocity_dofs;
+    std::vector<std::vector<unsigned int>> q_pressure_dofs;
+
+    DataStructures::NodeStorage node_storage;
+
+    // The nodes eliminated in batches, and the remaining ones, which are
+    // eliminated one at a time
+    static constexpr unsigned int max_batched_block_size = 12;
+    std::vector<DataStructures::NodeBatch> node_batches;
+    std::vector<unsigned int>              unbatched_nodes;
 
     unsigned long n_v, n_p;
 
-    Vector<double> pres_solution;
-    Vector<double> vel_solution;
+    TrilinosWrappers::MPI::Vector pres_solution;
+    TrilinosWrappers::MPI::Vector locally_relevant_pres_solution;
+    TrilinosWrappers::MPI::Vector distributed_solution;
+    TrilinosWrappers::MPI::Vector solution;
 
-    ConvergenceTable convergence_table;
-    TimerOutput      computing_timer;
+    ConditionalOStream pcout;
+    ConvergenceTable   convergence_table;
+    TimerOutput        computing_timer;
   };
 
   // @sect4{Constructor and destructor, <code>reset_data_structures</code>}
@@ -322,14 +513,20 @@ namespace MFMFE
   // and then construct the vector valued element belonging to the space $V_h^k$ described
   // in the introduction. The constructor also takes care of initializing the
   // computing timer, as it is of interest for us how well our method performs.
+  // The mesh is distributed among all MPI processes, and only the first one
+  // writes to the screen.
   template <int dim>
   MultipointMixedDarcyProblem<dim>::MultipointMixedDarcyProblem (const unsigned int degree)
     :
+    mpi_communicator(MPI_COMM_WORLD),
     degree(degree),
+    triangulation(mpi_communicator),
     fe(FE_RT_Bubbles<dim>(degree), 1,
        FE_DGQ<dim>(degree-1), 1),
     dof_handler(triangulation),
-    computing_timer(std::cout, TimerOutput::summary,
+    pcout(std::cout,
+          Utilities::MPI::this_mpi_process(mpi_communicator) == 0),
+    computing_timer(mpi_communicator, pcout, TimerOutput::summary,
                     TimerOutput::wall_times)
   {}
 
@@ -349,13 +546,275 @@ namespace MFMFE
   template <int dim>
   void MultipointMixedDarcyProblem<dim>::reset_data_structures ()
   {
-    pressure_indices.clear();
-    velocity_indices.clear();
-    velocity_rhs.clear();
-    A_inverse.clear();
-    pressure_matrix.clear();
-    node_matrix.clear();
-    node_rhs.clear();
+    node_storage.clear();
+    node_batches.clear();
+    unbatched_nodes.clear();
+  }
+
+
+  // @sect4{Numbering of the nodes}
+
+  // Before anything is assembled, we need to know which node each
+  // quadrature point of each cell belongs to, and which DoFs are coupled
+  // at each node. A Gauss-Lobatto point with tensor indices $t_d \in
+  // \{0,\dots,k\}$ lies at a vertex of the cell if all $t_d$ are $0$ or $k$,
+  // in the interior of the cell if none of them is, and otherwise in the
+  // interior of a face or (in 3d) of a line. Such a point is therefore
+  // identified by the index of the vertex, line, face or cell it lies in,
+  // together with its position within that entity. The position is
+  // measured starting from the first vertex of the entity, so that all
+  // cells sharing the entity agree on it. The nodes are numbered vertices
+  // first, then lines, faces and cells. Numbers of entities that are not
+  // used in the current mesh are simply left empty.
+  //
+  // All of this is done on the part of the mesh this process knows, i.e.,
+  // on its locally owned and ghost cells, with the process-local indices of
+  // the mesh entities. Since the ghost layer contains every cell that shares
+  // a vertex with a locally owned cell, the patch of each node of a locally
+  // owned cell is complete here.
+  template <int dim>
+  void MultipointMixedDarcyProblem<dim>::number_nodes (const Quadrature<dim> &quad)
+  {
+    Assert(dim > 1, ExcNotImplemented());
+
+    const unsigned int n_q_points      = quad.size();
+    const unsigned int dofs_per_cell   = fe.dofs_per_cell;
+    const unsigned int n_interior      = degree - 1;
+    const unsigned int n_face_interior = Utilities::pow(n_interior, dim-1);
+    const unsigned int n_cell_interior = Utilities::pow(n_interior, dim);
+
+    // First, the tensor indices of the quadrature points
+    const QGaussLobatto<1> quad_1d(degree+1);
+    std::vector<std::array<unsigned int, dim>> tensor_indices(n_q_points);
+    for (unsigned int q=0; q<n_q_points; ++q)
+      for (unsigned int d=0; d<dim; ++d)
+        {
+          unsigned int i = 0;
+          while (std::abs(quad_1d.point(i)[0] - quad.point(q)[d]) > 1.e-12)
+            ++i;
+          tensor_indices[q][d] = i;
+        }
+
+    // Next, the velocity DoFs located at each quadrature point of the
+    // reference cell, and the pressure DoFs they are coupled to through the
+    // divergence term. Velocity DoFs belong to the first base element of the
+    // FESystem and pressure DoFs to the second one. In the mapped cells, both the non-zero pattern of the
+    // velocity shape functions and the integrals of their divergence against
+    // the pressure shape functions are the same as on the reference cell,
+    // due to the properties of the Piola transformation.
+    q_velocity_dofs.assign(n_q_points, std::vector<unsigned int>());
+    q_pressure_dofs.assign(n_q_points, std::vector<unsigned int>());
+
+    FullMatrix<double> div_matrix(dofs_per_cell, dofs_per_cell);
+    for (unsigned int q=0; q<n_q_points; ++q)
+      for (unsigned int i=0; i<dofs_per_cell; ++i)
+        if (fe.system_to_base_index(i).first.first == 0)
+          {
+            double value_norm = 0, divergence = 0;
+            for (unsigned int c=0; c<dim; ++c)
+              {
+                value_norm += std::pow(fe.shape_value_component(i, quad.point(q), c), 2);
+                divergence += fe.shape_grad_component(i, quad.point(q), c)[c];
+              }
+
+            if (std::sqrt(value_norm) > 1.e-12)
+              q_velocity_dofs[q].push_back(i);
+
+            for (unsigned int j=0; j<dofs_per_cell; ++j)
+              if (fe.system_to_base_index(j).first.first == 1)
+                div_matrix(i, j) += divergence *
+                                    fe.shape_value_component(j, quad.point(q), dim) *
+                                    quad.weight(q);
+          }
+
+    for (unsigned int q=0; q<n_q_points; ++q)
+      for (unsigned int j=0; j<dofs_per_cell; ++j)
+        if (fe.system_to_base_index(j).first.first == 1)
+          for (const auto i : q_velocity_dofs[q])
+            if (std::abs(div_matrix(i, j)) > 1.e-12)
+              {
+                q_pressure_dofs[q].push_back(j);
+                break;
+              }
+
+    // Now, the actual numbering. The position of a point within a line or
+    // face is found from the cell-local vertices that coincide with the
+    // first, second and (for faces in 3d) third vertex of the entity: the
+    // first one is the origin, the other ones give the two directions.
+    const unsigned int line_offset = triangulation.n_vertices();
+    const unsigned int face_offset = line_offset +
+                                     (dim == 3 ? triangulation.n_raw_lines() * n_interior : 0);
+    const unsigned int cell_offset = face_offset +
+                                     triangulation.n_raw_faces() * n_face_interior;
+    const unsigned int n_nodes     = cell_offset +
+                                     triangulation.n_active_cells() * n_cell_interior;
+
+    const auto relevant_cells =
+      filter_iterators(dof_handler.active_cell_iterators(),
+                       [](const typename DoFHandler<dim>::active_cell_iterator &cell)
+    {
+      return !cell->is_artificial();
+    });
+
+    const auto corner = [&](const unsigned int v, const unsigned int d)
+    {
+      return ((v >> d) & 1) * degree;
+    };
+
+    const auto cell_vertex = [&](const typename DoFHandler<dim>::active_cell_iterator &cell,
+                                 const unsigned int vertex_index)
+    {
+      for (const unsigned int v : GeometryInfo<dim>::vertex_indices())
+        if (cell->vertex_index(v) == vertex_index)
+          return v;
+      Assert(false, ExcInternalError());
+      return numbers::invalid_unsigned_int;
+    };
+
+    const auto position_in_entity = [&](const typename DoFHandler<dim>::active_cell_iterator &cell,
+                                        const std::array<unsigned int, dim> &t,
+                                        const auto &entity)
+    {
+      const unsigned int origin = cell_vertex(cell, entity->vertex_index(0));
+      unsigned int position = 0, stride = 1;
+      for (unsigned int e=0; e<entity->n_vertices()/2; ++e)
+        {
+          const unsigned int other = cell_vertex(cell, entity->vertex_index(e == 0 ? 1 : 2));
+          unsigned int d = 0;
+          while (corner(origin, d) == corner(other, d))
+            ++d;
+          const unsigned int u = (corner(origin, d) == 0) ? t[d] : degree - t[d];
+          position += (u - 1) * stride;
+          stride *= n_interior;
+        }
+      return position;
+    };
+
+    node_storage.cell_nodes.resize(triangulation.n_active_cells() * n_q_points);
+    for (const auto &cell : relevant_cells)
+      for (unsigned int q=0; q<n_q_points; ++q)
+        {
+          const auto &t = tensor_indices[q];
+
+          unsigned int vertex = 0, n_interior_directions = 0, interior_direction = 0;
+          for (unsigned int d=0; d<dim; ++d)
+            if (t[d] == degree)
+              vertex |= (1 << d);
+            else if (t[d] != 0)
+              {
+                ++n_interior_directions;
+                interior_direction = d;
+              }
+
+          unsigned int node;
+          if (n_interior_directions == 0)
+            node = cell->vertex_index(vertex);
+          else if (n_interior_directions == dim)
+            {
+              unsigned int position = 0;
+              for (unsigned int d=dim; d-- > 0;)
+                position = position*n_interior + t[d] - 1;
+              node = cell_offset + cell->active_cell_index() * n_cell_interior + position;
+            }
+          else if (n_interior_directions == dim-1)
+            {
+              unsigned int face_no = 0;
+              for (unsigned int d=0; d<dim; ++d)
+                if (t[d] == 0 || t[d] == degree)
+                  face_no = 2*d + (t[d] == degree ? 1 : 0);
+              node = face_offset + cell->face(face_no)->index() * n_face_interior +
+                     position_in_entity(cell, t, cell->face(face_no));
+            }
+          else
+            {
+              // A point in the interior of a line in 3d. The line is the one
+              // connecting the two cell vertices obtained by moving the point
+              // along the interior direction.
+              const unsigned int v0 = cell->vertex_index(vertex);
+              const unsigned int v1 = cell->vertex_index(vertex | (1 << interior_direction));
+              unsigned int line_no = 0;
+              while (!((cell->line(line_no)->vertex_index(0) == v0 &&
+                        cell->line(line_no)->vertex_index(1) == v1) ||
+                       (cell->line(line_no)->vertex_index(0) == v1 &&
+                        cell->line(line_no)->vertex_index(1) == v0)))
+                ++line_no;
+              node = line_offset + cell->line(line_no)->index() * n_interior +
+                     position_in_entity(cell, t, cell->line(line_no));
+            }
+
+          AssertIndexRange(node, n_nodes);
+          node_storage.cell_nodes[cell->active_cell_index() * n_q_points + q] = node;
+        }
+
+    // With the node of every quadrature point, we collect the DoF indices
+    // of each node, first with duplicates, and then sort them and remove
+    // the duplicates in place.
+    const auto build_lists = [&](const std::vector<std::vector<unsigned int>> &q_dofs,
+                                 const types::global_dof_index                 first_index,
+                                 std::vector<unsigned int>                    &offsets,
+                                 std::vector<types::global_dof_index>         &indices)
+    {
+      std::vector<unsigned int> counts(n_nodes+1, 0);
+      for (const auto &cell : relevant_cells)
+        for (unsigned int q=0; q<n_q_points; ++q)
+          counts[node_storage.cell_nodes[cell->active_cell_index() * n_q_points + q] + 1] +=
+            q_dofs[q].size();
+      for (unsigned int n=0; n<n_nodes; ++n)
+        counts[n+1] += counts[n];
+
+      std::vector<types::global_dof_index> all_indices(counts[n_nodes]);
+      std::vector<unsigned int> fill(counts.begin(), counts.end()-1);
+      std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+      for (const auto &cell : relevant_cells)
+        {
+          cell->get_dof_indices(local_dof_indices);
+          for (unsigned int q=0; q<n_q_points; ++q)
+            {
+              const unsigned int node = node_storage.cell_nodes[cell->active_cell_index() * n_q_points + q];
+              for (const auto i : q_dofs[q])
+                all_indices[fill[node]++] = local_dof_indices[i] - first_index;
+            }
+        }
+
+      offsets.assign(n_nodes+1, 0);
+      indices.clear();
+      indices.reserve(all_indices.size());
+      for (unsigned int n=0; n<n_nodes; ++n)
+        {
+          std::sort(all_indices.begin() + counts[n], all_indices.begin() + counts[n+1]);
+          const auto end = std::unique(all_indices.begin() + counts[n], all_indices.begin() + counts[n+1]);
+          indices.insert(indices.end(), all_indices.begin() + counts[n], end);
+          offsets[n+1] = indices.size();
+        }
+    };
+
+    build_lists(q_velocity_dofs, 0, node_storage.velocity_offsets, node_storage.velocity_indices);
+    build_lists(q_pressure_dofs, n_v, node_storage.pressure_offsets, node_storage.pressure_indices);
+
+    // Finally, the sizes of the node-local matrices are known, and all
+    // value arrays are allocated. A node on the boundary between the
+    // subdomains of several processes is known to all of them, but must be
+    // eliminated by only one. This is the process that owns the first of
+    // its velocity DoFs: it owns a cell adjacent to that DoF, which
+    // contains the node, and therefore sees the whole patch.
+    node_storage.velocity_matrix_offsets.assign(n_nodes+1, 0);
+    node_storage.pressure_matrix_offsets.assign(n_nodes+1, 0);
+    node_storage.nodes.clear();
+    for (unsigned int n=0; n<n_nodes; ++n)
+      {
+        const std::size_t n_edges = node_storage.n_velocity_dofs(n);
+        const std::size_t n_cells = node_storage.n_pressure_dofs(n);
+        node_storage.velocity_matrix_offsets[n+1] = node_storage.velocity_matrix_offsets[n] + n_edges*n_edges;
+        node_storage.pressure_matrix_offsets[n+1] = node_storage.pressure_matrix_offsets[n] + n_edges*n_cells;
+        if (n_edges > 0 &&
+            locally_owned_dofs.is_element(node_storage.velocity_indices[node_storage.velocity_offsets[n]]))
+          node_storage.nodes.push_back(n);
+      }
+
+    node_storage.velocity_matrix_values.assign(node_storage.velocity_matrix_offsets[n_nodes], 0.0);
+    node_storage.pressure_matrix_values.assign(node_storage.pressure_matrix_offsets[n_nodes], 0.0);
+    node_storage.velocity_rhs_values.assign(node_storage.velocity_indices.size(), 0.0);
+    node_storage.pressure_rhs_values.assign(node_storage.pressure_indices.size(), 0.0);
   }
 
 
@@ -365,21 +824,41 @@ namespace MFMFE
   // matrices and vectors is defined. It places the values obtained from local cell integration
   // into the correct place in a matrix/vector corresponging to a specific node.
   template <int dim>
-  void MultipointMixedDarcyProblem<dim>::copy_cell_to_node(const DataStructures::NodeAssemblyCopyData<dim> &copy_data)
+  void MultipointMixedDarcyProblem<dim>::copy_cell_to_node(const DataStructures::NodeAssemblyCopyData &copy_data)
   {
-    for (auto m : copy_data.cell_mat)
+    const unsigned int n_q_points = q_velocity_dofs.size();
+
+    for (unsigned int q=0; q<n_q_points; ++q)
       {
-        for (auto p : m.second)
-          node_matrix[m.first][p.first] += p.second;
+        const unsigned int node    = node_storage.cell_nodes[copy_data.cell_index * n_q_points + q];
+        const unsigned int n_edges = node_storage.n_velocity_dofs(node);
+        const unsigned int n_cells = node_storage.n_pressure_dofs(node);
+
+        double *velocity_matrix = node_storage.velocity_matrix(node);
+        double *pressure_matrix = node_storage.pressure_matrix(node);
+        double *velocity_rhs    = node_storage.velocity_rhs(node);
+        double *pressure_rhs    = node_storage.pressure_rhs(node);
 
-        for (auto p : copy_data.cell_vec.at(m.first))
-          node_rhs[m.first][p.first] += p.second;
+        const auto &vel_positions  = copy_data.vel_positions[q];
+        const auto &pres_positions = copy_data.pres_positions[q];
+        const unsigned int n_vel_q  = vel_positions.size();
+        const unsigned int n_pres_q = pres_positions.size();
 
-        for (auto p : copy_data.local_pres_indices.at(m.first))
-          pressure_indices[m.first].insert(p);
+        for (unsigned int a=0; a<n_vel_q; ++a)
+          {
+            for (unsigned int b=0; b<n_vel_q; ++b)
+              velocity_matrix[vel_positions[a]*n_edges + vel_positions[b]] +=
+                copy_data.cell_mat[q][a*n_vel_q + b];
+
+            for (unsigned int c=0; c<n_pres_q; ++c)
+              pressure_matrix[vel_positions[a]*n_cells + pres_positions[c]] +=
+                copy_data.cell_div[q][a*n_pres_q + c];
+
+            velocity_rhs[vel_positions[a]] += copy_data.cell_vel_rhs[q][a];
+          }
 
-        for (auto p : copy_data.local_vel_indices.at(m.first))
-          velocity_indices[m.first].insert(p);
+        for (unsigned int c=0; c<n_pres_q; ++c)
+          pressure_rhs[pres_positions[c]] += copy_data.cell_pres_rhs[q][c];
       }
   }
 
@@ -392,20 +871,23 @@ namespace MFMFE
   void MultipointMixedDarcyProblem<dim>::
   assemble_system_cell (const typename DoFHandler<dim>::active_cell_iterator &cell,
                         DataStructures::NodeAssemblyScratchData<dim> &scratch_data,
-                        DataStructures::NodeAssemblyCopyData<dim>    &copy_data)
+                        DataStructures::NodeAssemblyCopyData         &copy_data)
   {
-    copy_data.cell_mat.clear();
-    copy_data.cell_vec.clear();
-    copy_data.local_vel_indices.clear();
-    copy_data.local_pres_indices.clear();
-
     const unsigned int dofs_per_cell   = fe.dofs_per_cell;
     const unsigned int n_q_points      = scratch_data.fe_values.get_quadrature().size();
     const unsigned int n_face_q_points = scratch_data.fe_face_values.get_quadrature().size();
 
+    copy_data.cell_index = cell->active_cell_index();
     copy_data.local_dof_indices.resize(dofs_per_cell);
     cell->get_dof_indices (copy_data.local_dof_indices);
 
+    copy_data.cell_mat.resize(n_q_points);
+    copy_data.cell_div.resize(n_q_points);
+    copy_data.cell_vel_rhs.resize(n_q_points);
+    copy_data.cell_pres_rhs.resize(n_q_points);
+    copy_data.vel_positions.resize(n_q_points);
+    copy_data.pres_positions.resize(n_q_points);
+
     scratch_data.fe_values.reinit (cell);
 
     const KInverse<dim> k_inverse;
@@ -419,16 +901,15 @@ namespace MFMFE
     const FEValuesExtractors::Scalar pressure (dim);
 
     const unsigned int n_vel = dim*Utilities::pow(degree+1,dim);
-    std::unordered_map<unsigned int, std::unordered_map<unsigned int, double>> div_map;
 
     // One, we need to be able to assemble the communication between velocity and
     // pressure variables and put it on the right place in our final, local version
     // of the B matrix. This is a little messy, as such communication is not in fact
-    // local, so we do it in two steps. First, we compute all relevant LHS and RHS
+    // local, so we do it in two steps. First, we compute all divergence terms on
+    // the cell, together with the mass matrix and RHS terms at each node.
+    scratch_data.div_matrix = 0;
     for (unsigned int q=0; q<n_q_points; ++q)
       {
-        const Point<dim> p = scratch_data.fe_values.quadrature_point(q);
-
         for (unsigned int k=0; k<dofs_per_cell; ++k)
           {
             scratch_data.phi_u[k] = scratch_data.fe_values[velocity].value(k, q);
@@ -437,69 +918,32 @@ namespace MFMFE
           }
 
         for (unsigned int i=0; i<dofs_per_cell; ++i)
-          {
-            for (unsigned int j=n_vel; j<dofs_per_cell; ++j)
-              {
-                double div_term = (- scratch_data.div_phi_u[i] * scratch_data.phi_p[j]
-                                   - scratch_data.phi_p[i] * scratch_data.div_phi_u[j]) * scratch_data.fe_values.JxW(q);
-
-                if (std::abs(div_term) > 1.e-12)
-                  div_map[i][j] += div_term;
-              }
-
-            double source_term = -scratch_data.phi_p[i] * scratch_data.rhs_values[q] * scratch_data.fe_values.JxW(q);
-
-            if (std::abs(scratch_data.phi_p[i]) > 1.e-12 || std::abs(source_term) > 1.e-12)
-              copy_data.cell_vec[p][copy_data.local_dof_indices[i]] += source_term;
-          }
-      }
-
-    // Then, by making another pass, we compute the mass matrix terms and incorporate the
-    // divergence form and RHS accordingly. This second pass, allows us to know where
-    // the total contribution will be put in the nodal data structures, as with this
-    // choice of quadrature rule and finite element only the basis functions corresponding
-    // to the same quadrature points yield non-zero contribution.
-    for (unsigned int q=0; q<n_q_points; ++q)
-      {
-        std::set<types::global_dof_index> vel_indices;
-        const Point<dim> p = scratch_data.fe_values.quadrature_point(q);
-
-        for (unsigned int k=0; k<dofs_per_cell; ++k)
-          {
-            scratch_data.phi_u[k] = scratch_data.fe_values[velocity].value(k, q);
-            scratch_data.div_phi_u[k]     = scratch_data.fe_values[velocity].divergence (k, q);
-            scratch_data.phi_p[k]         = scratch_data.fe_values[pressure].value (k, q);
-          }
-
-        for (unsigned int i=0; i<dofs_per_cell; ++i)
-          for (unsigned int j=i; j<dofs_per_cell; ++j)
-            {
-              double mass_term = scratch_data.phi_u[i]
-                                 * scratch_data.k_inverse_values[q]
-                                 * scratch_data.phi_u[j]
-                                 * scratch_data.fe_values.JxW(q);
-
-              if (std::abs(mass_term) > 1.e-12)
-                {
-                  copy_data.cell_mat[p][std::make_pair(copy_data.local_dof_indices[i], copy_data.local_dof_indices[j])] +=
-                    mass_term;
-                  vel_indices.insert(i);
-                  copy_data.local_vel_indices[p].insert(copy_data.local_dof_indices[j]);
-                }
-            }
-
-        for (auto i : vel_indices)
-          for (auto el : div_map[i])
-            if (std::abs(el.second) > 1.e-12)
-              {
-                copy_data.cell_mat[p][std::make_pair(copy_data.local_dof_indices[i],
-                                                     copy_data.local_dof_indices[el.first])] += el.second;
-                copy_data.local_pres_indices[p].insert(copy_data.local_dof_indices[el.first]);
-              }
+          for (unsigned int j=n_vel; j<dofs_per_cell; ++j)
+            scratch_data.div_matrix(i, j) += (- scratch_data.div_phi_u[i] * scratch_data.phi_p[j]
+                                              - scratch_data.phi_p[i] * scratch_data.div_phi_u[j]) * scratch_data.fe_values.JxW(q);
+
+        // With this choice of quadrature rule and finite element only the
+        // basis functions corresponding to the same quadrature points yield
+        // non-zero mass matrix contributions, and we know in advance which
+        // ones these are.
+        const auto &vel_dofs  = q_velocity_dofs[q];
+        const auto &pres_dofs = q_pressure_dofs[q];
+
+        copy_data.cell_mat[q].resize(vel_dofs.size()*vel_dofs.size());
+        for (unsigned int a=0; a<vel_dofs.size(); ++a)
+          for (unsigned int b=0; b<vel_dofs.size(); ++b)
+            copy_data.cell_mat[q][a*vel_dofs.size() + b] = scratch_data.phi_u[vel_dofs[a]]
+                                                           * scratch_data.k_inverse_values[q]
+                                                           * scratch_data.phi_u[vel_dofs[b]]
+                                                           * scratch_data.fe_values.JxW(q);
+
+        copy_data.cell_pres_rhs[q].resize(pres_dofs.size());
+        for (unsigned int c=0; c<pres_dofs.size(); ++c)
+          copy_data.cell_pres_rhs[q][c] = -scratch_data.phi_p[pres_dofs[c]] * scratch_data.rhs_values[q] * scratch_data.fe_values.JxW(q);
       }
 
     // The pressure boundary conditions are computed as in step-20,
-    std::map<types::global_dof_index,double> pres_bc;
+    std::fill(scratch_data.pres_bc.begin(), scratch_data.pres_bc.end(), 0.0);
     for (unsigned int face_no=0;
          face_no<GeometryInfo<dim>::faces_per_cell;
          ++face_no)
@@ -510,22 +954,43 @@ namespace MFMFE
 
           for (unsigned int q=0; q<n_face_q_points; ++q)
             for (unsigned int i = 0; i < dofs_per_cell; ++i)
-              {
-                double tmp = -(scratch_data.fe_face_values[velocity].value(i, q) *
-                               scratch_data.fe_face_values.normal_vector(q) *
-                               scratch_data.pres_bc_values[q] *
-                               scratch_data.fe_face_values.JxW(q));
-
-                if (std::abs(tmp) > 1.e-12)
-                  pres_bc[copy_data.local_dof_indices[i]] += tmp;
-              }
+              scratch_data.pres_bc[i] -= (scratch_data.fe_face_values[velocity].value(i, q) *
+                                          scratch_data.fe_face_values.normal_vector(q) *
+                                          scratch_data.pres_bc_values[q] *
+                                          scratch_data.fe_face_values.JxW(q));
         }
 
-    // ...but we distribute them to the corresponding nodal data structures
-    for (auto m : copy_data.cell_vec)
-      for (unsigned int i=0; i<dofs_per_cell; ++i)
-        if (std::abs(pres_bc[copy_data.local_dof_indices[i]]) > 1.e-12)
-          copy_data.cell_vec[m.first][copy_data.local_dof_indices[i]] += pres_bc[copy_data.local_dof_indices[i]];
+    // ...and then, in a second pass, we distribute the divergence terms and
+    // the boundary conditions to the nodes of the velocity DoFs. Since the
+    // DoF lists of the nodes are not changed during the assembly, the
+    // positions of the DoFs in them can also be found here, in parallel.
+    for (unsigned int q=0; q<n_q_points; ++q)
+      {
+        const auto &vel_dofs  = q_velocity_dofs[q];
+        const auto &pres_dofs = q_pressure_dofs[q];
+        const unsigned int node = node_storage.cell_nodes[copy_data.cell_index * n_q_points + q];
+
+        copy_data.cell_div[q].resize(vel_dofs.size()*pres_dofs.size());
+        copy_data.cell_vel_rhs[q].resize(vel_dofs.size());
+        copy_data.vel_positions[q].resize(vel_dofs.size());
+        copy_data.pres_positions[q].resize(pres_dofs.size());
+
+        for (unsigned int a=0; a<vel_dofs.size(); ++a)
+          {
+            for (unsigned int c=0; c<pres_dofs.size(); ++c)
+              copy_data.cell_div[q][a*pres_dofs.size() + c] = scratch_data.div_matrix(vel_dofs[a], pres_dofs[c]);
+
+            copy_data.cell_vel_rhs[q][a] = scratch_data.pres_bc[vel_dofs[a]];
+            copy_data.vel_positions[q][a] = node_storage.velocity_position(node, copy_data.local_dof_indices[vel_dofs[a]]);
+            Assert(copy_data.vel_positions[q][a] != numbers::invalid_unsigned_int, ExcInternalError());
+          }
+
+        for (unsigned int c=0; c<pres_dofs.size(); ++c)
+          {
+            copy_data.pres_positions[q][c] = node_storage.pressure_position(node, copy_data.local_dof_indices[pres_dofs[c]] - n_v);
+            Assert(copy_data.pres_positions[q][c] != numbers::invalid_unsigned_int, ExcInternalError());
+          }
+      }
   }
 
 
@@ -551,15 +1016,47 @@ namespace MFMFE
     n_v = dofs_per_component[0];
     n_p = dofs_per_component[dim];
 
-    pres_rhs.reinit(n_p);
+    // After the component-wise renumbering, the pressure DoFs of all
+    // processes follow the velocity DoFs of all processes. The pressure
+    // system is indexed by the range $[n_v, n_v+n_p)$ of global DoF
+    // indices shifted to start at zero, which gives Trilinos the contiguous
+    // index space it needs for its maps. The pressure DoFs of this process
+    // and its ghost cells are identified by the base element they belong to.
+    AssertDimension(n_v + n_p, dof_handler.n_dofs());
+    locally_owned_dofs = dof_handler.locally_owned_dofs();
+    DoFTools::extract_locally_relevant_dofs(dof_handler, locally_relevant_dofs);
+
+    const auto relevant_cells =
+      filter_iterators(dof_handler.active_cell_iterators(),
+                       [](const typename DoFHandler<dim>::active_cell_iterator &cell)
+    {
+      return !cell->is_artificial();
+    });
 
-    WorkStream::run(dof_handler.begin_active(),
-                    dof_handler.end(),
+    IndexSet relevant_pressure_dofs(dof_handler.n_dofs());
+    std::vector<types::global_dof_index> local_dof_indices(fe.dofs_per_cell);
+    for (const auto &cell : relevant_cells)
+      {
+        cell->get_dof_indices(local_dof_indices);
+        for (unsigned int i=0; i<fe.dofs_per_cell; ++i)
+          if (fe.system_to_base_index(i).first.first == 1)
+            relevant_pressure_dofs.add_index(local_dof_indices[i]);
+      }
+    relevant_pressure_dofs.compress();
+    locally_relevant_pressure_dofs = relevant_pressure_dofs.get_view(n_v, n_v + n_p);
+    locally_owned_pressure_dofs    = locally_owned_dofs.get_view(n_v, n_v + n_p);
+
+    number_nodes(quad);
+
+    // Ghost cells are assembled as well, since they contribute to the
+    // nodes on the boundary of the subdomain.
+    WorkStream::run(relevant_cells.begin(),
+                    relevant_cells.end(),
                     *this,
                     &MultipointMixedDarcyProblem::assemble_system_cell,
                     &MultipointMixedDarcyProblem::copy_cell_to_node,
                     DataStructures::NodeAssemblyScratchData<dim>(fe, triangulation,quad,face_quad),
-                    DataStructures::NodeAssemblyCopyData<dim>());
+                    DataStructures::NodeAssemblyCopyData());
   }
 
   // @sect4{Making the sparsity pattern}
@@ -567,28 +1064,28 @@ namespace MFMFE
   // Having computed all the local contributions, we actually have
   // all the information needed to make a cell-centered sparsity
   // pattern manually. We do this here, because @ref SparseMatrixEZ
-  // leads to a slower solution.
+  // leads to a slower solution. Each process adds the couplings of the
+  // nodes it eliminates, which may include rows owned by other processes;
+  // these are sent to their owners before the matrix is created.
   template <int dim>
   void MultipointMixedDarcyProblem<dim>::make_cell_centered_sp()
   {
     TimerOutput::Scope t(computing_timer, "Make sparsity pattern");
-    DynamicSparsityPattern dsp(n_p, n_p);
-
-    std::set<types::global_dof_index>::iterator pi_it, pj_it;
-    unsigned int i, j;
-    for (auto el : node_matrix)
-      for (pi_it = pressure_indices[el.first].begin(), i = 0;
-           pi_it != pressure_indices[el.first].end();
-           ++pi_it, ++i)
-        for (pj_it = pi_it, j = 0;
-             pj_it != pressure_indices[el.first].end();
-             ++pj_it, ++j)
-          dsp.add(*pi_it - n_v, *pj_it - n_v);
-
-
-    dsp.symmetrize();
-    cell_centered_sp.copy_from(dsp);
-    pres_system_matrix.reinit (cell_centered_sp);
+    DynamicSparsityPattern dsp(n_p, n_p, locally_relevant_pressure_dofs);
+
+    for (const auto node : node_storage.nodes)
+      for (unsigned int i=node_storage.pressure_offsets[node]; i<node_storage.pressure_offsets[node+1]; ++i)
+        for (unsigned int j=node_storage.pressure_offsets[node]; j<node_storage.pressure_offsets[node+1]; ++j)
+          dsp.add(node_storage.pressure_indices[i], node_storage.pressure_indices[j]);
+
+    SparsityTools::distribute_sparsity_pattern(dsp,
+                                               locally_owned_pressure_dofs,
+                                               mpi_communicator,
+                                               locally_relevant_pressure_dofs);
+    pres_system_matrix.reinit (locally_owned_pressure_dofs,
+                               locally_owned_pressure_dofs,
+                               dsp,
+                               mpi_communicator);
   }
 
 
@@ -599,126 +1096,285 @@ namespace MFMFE
   // Schur complement (as mentioned in the introduction) but we do
   // so locally. Namely, local velocity DOFs are expressed in terms
   // of corresponding pressure values, and then used for the local
-  // pressure systems.
+  // pressure systems. The inverse of $A_i$ is needed again for the
+  // velocity recovery, so it replaces $A_i$ in the node storage. Since each
+  // node has its own part of the storage, this can be done right here.
   template <int dim>
   void MultipointMixedDarcyProblem<dim>::
-  nodal_elimination(const typename DataStructures::PointToMatrixMap<dim>::iterator &n_it,
+  nodal_elimination(const std::vector<unsigned int>::const_iterator &n_it,
                     DataStructures::VertexEliminationScratchData &scratch_data,
-                    DataStructures::NodeEliminationCopyData<dim> &copy_data)
+                    DataStructures::NodeEliminationCopyData      &copy_data)
   {
-    unsigned int n_edges = velocity_indices.at((*n_it).first).size();
-    unsigned int n_cells = pressure_indices.at((*n_it).first).size();
+    const unsigned int node    = *n_it;
+    const unsigned int n_edges = node_storage.n_velocity_dofs(node);
+    const unsigned int n_cells = node_storage.n_pressure_dofs(node);
 
-    scratch_data.velocity_matrix.reinit(n_edges,n_edges);
-    copy_data.pressure_matrix.reinit(n_edges,n_cells);
+    double *const       velocity_matrix = node_storage.velocity_matrix(node);
+    const double *const pressure_matrix = node_storage.pressure_matrix(node);
+    const double *const velocity_rhs    = node_storage.velocity_rhs(node);
+    const double *const pressure_rhs    = node_storage.pressure_rhs(node);
 
-    copy_data.velocity_rhs.reinit(n_edges);
+    scratch_data.velocity_matrix.reinit(n_edges,n_edges);
+    scratch_data.pressure_matrix.reinit(n_edges,n_cells);
+    scratch_data.velocity_rhs.reinit(n_edges);
     scratch_data.pressure_rhs.reinit(n_cells);
 
-    {
-      std::set<types::global_dof_index>::iterator vi_it, vj_it, p_it;
-      unsigned int i;
-      for (vi_it = velocity_indices.at((*n_it).first).begin(), i = 0;
-           vi_it != velocity_indices.at((*n_it).first).end();
-           ++vi_it, ++i)
-        {
-          unsigned int j;
-          for (vj_it = velocity_indices.at((*n_it).first).begin(), j = 0;
-               vj_it != velocity_indices.at((*n_it).first).end();
-               ++vj_it, ++j)
-            {
-              scratch_data.velocity_matrix.add(i, j, node_matrix[(*n_it).first][std::make_pair(*vi_it, *vj_it)]);
-              if (j != i)
-                scratch_data.velocity_matrix.add(j, i, node_matrix[(*n_it).first][std::make_pair(*vi_it, *vj_it)]);
-            }
-
-          for (p_it = pressure_indices.at((*n_it).first).begin(), j = 0;
-               p_it != pressure_indices.at((*n_it).first).end();
-               ++p_it, ++j)
-            copy_data.pressure_matrix.add(i, j, node_matrix[(*n_it).first][std::make_pair(*vi_it, *p_it)]);
-
-          copy_data.velocity_rhs(i) += node_rhs.at((*n_it).first)[*vi_it];
-        }
-
-      for (p_it = pressure_indices.at((*n_it).first).begin(), i = 0;
-           p_it != pressure_indices.at((*n_it).first).end();
-           ++p_it, ++i)
-        scratch_data.pressure_rhs(i) += node_rhs.at((*n_it).first)[*p_it];
-    }
+    scratch_data.velocity_matrix.fill(velocity_matrix);
+    scratch_data.pressure_matrix.fill(pressure_matrix);
+    std::copy(velocity_rhs, velocity_rhs + n_edges, scratch_data.velocity_rhs.begin());
+    std::copy(pressure_rhs, pressure_rhs + n_cells, scratch_data.pressure_rhs.begin());
 
-    copy_data.Ainverse.reinit(n_edges,n_edges);
+    scratch_data.velocity_matrix_inverse.reinit(n_edges,n_edges);
 
     scratch_data.tmp_rhs1.reinit(n_edges);
     scratch_data.tmp_rhs2.reinit(n_edges);
     scratch_data.tmp_rhs3.reinit(n_cells);
 
-    copy_data.Ainverse.invert(scratch_data.velocity_matrix);
+    scratch_data.velocity_matrix_inverse.invert(scratch_data.velocity_matrix);
     copy_data.node_pres_matrix.reinit(n_cells, n_cells);
     copy_data.node_pres_rhs = scratch_data.pressure_rhs;
 
     copy_data.node_pres_matrix = 0;
-    copy_data.node_pres_matrix.triple_product(copy_data.Ainverse,
-                                              copy_data.pressure_matrix,
-                                              copy_data.pressure_matrix, true, false);
+    copy_data.node_pres_matrix.triple_product(scratch_data.velocity_matrix_inverse,
+                                              scratch_data.pressure_matrix,
+                                              scratch_data.pressure_matrix, true, false);
 
-    copy_data.Ainverse.vmult(scratch_data.tmp_rhs1, copy_data.velocity_rhs, false);
-    copy_data.pressure_matrix.Tvmult(scratch_data.tmp_rhs3, scratch_data.tmp_rhs1, false);
+    scratch_data.velocity_matrix_inverse.vmult(scratch_data.tmp_rhs1, scratch_data.velocity_rhs, false);
+    scratch_data.pressure_matrix.Tvmult(scratch_data.tmp_rhs3, scratch_data.tmp_rhs1, false);
     copy_data.node_pres_rhs *= -1.0;
     copy_data.node_pres_rhs += scratch_data.tmp_rhs3;
 
-    copy_data.p = (*n_it).first;
+    for (unsigned int i=0; i<n_edges; ++i)
+      for (unsigned int j=0; j<n_edges; ++j)
+        velocity_matrix[i*n_edges + j] = scratch_data.velocity_matrix_inverse(i, j);
+
+    copy_data.node = node;
   }
 
 
   // Each node's pressure system is then distributed to a global pressure
-  // system, using the indices we computed in the previous stages.
+  // system, using the indices we computed in the previous stages. The
+  // indices of each node are sorted, and rows owned by other processes are
+  // sent to them when the matrix and vector are compressed.
   template <int dim>
   void MultipointMixedDarcyProblem<dim>::
-  copy_node_to_system(const DataStructures::NodeEliminationCopyData<dim> &copy_data)
+  copy_node_to_system(const DataStructures::NodeEliminationCopyData &copy_data)
   {
-    A_inverse[copy_data.p] = copy_data.Ainverse;
-    pressure_matrix[copy_data.p] = copy_data.pressure_matrix;
-    velocity_rhs[copy_data.p] = copy_data.velocity_rhs;
+    const types::global_dof_index *pressure_indices =
+      node_storage.pressure_indices.data() + node_storage.pressure_offsets[copy_data.node];
+    const unsigned int n_cells = node_storage.n_pressure_dofs(copy_data.node);
 
-    {
-      std::set<types::global_dof_index>::iterator pi_it, pj_it;
-      unsigned int i;
-      for (pi_it = pressure_indices[copy_data.p].begin(), i = 0;
-           pi_it != pressure_indices[copy_data.p].end();
-           ++pi_it, ++i)
-        {
-          unsigned int j;
-          for (pj_it = pressure_indices[copy_data.p].begin(), j = 0;
-               pj_it != pressure_indices[copy_data.p].end();
-               ++pj_it, ++j)
-            pres_system_matrix.add(*pi_it - n_v, *pj_it - n_v, copy_data.node_pres_matrix(i, j));
+    for (unsigned int i=0; i<n_cells; ++i)
+      pres_system_matrix.add(pressure_indices[i], n_cells, pressure_indices,
+                             &copy_data.node_pres_matrix(i, 0), false, true);
+
+    pres_rhs.add(n_cells, pressure_indices, copy_data.node_pres_rhs.begin());
+  }
 
-          pres_rhs(*pi_it - n_v) += copy_data.node_pres_rhs(i);
+
+  // The same elimination for a batch of nodes with <code>n_edges</code>
+  // velocity DoFs each. The node matrices are gathered into the lanes of
+  // vectorized arrays, $A_i$ is inverted, and $B_i^TA_i^{-1}B_i$ as well as
+  // $B_i^TA_i^{-1}f_i - g_i$ are computed for all lanes together. Finally,
+  // $A_i^{-1}$ is scattered back into the node storage, as in the
+  // one-node-at-a-time version above.
+  template <int dim>
+  template <unsigned int n_edges>
+  void MultipointMixedDarcyProblem<dim>::
+  eliminate_node_batch(const DataStructures::NodeBatch                  &batch,
+                       DataStructures::NodeBatchEliminationScratchData &scratch_data,
+                       DataStructures::NodeBatchEliminationCopyData    &copy_data)
+  {
+    constexpr unsigned int n_lanes = VectorizedArray<double>::size();
+    const unsigned int n_cells = node_storage.n_pressure_dofs(batch.nodes[0]);
+
+    std::array<VectorizedArray<double>, n_edges*n_edges> velocity_matrix;
+    std::array<VectorizedArray<double>, n_edges>         velocity_rhs;
+    scratch_data.pressure_matrix.resize(n_edges*n_cells);
+    scratch_data.inverse_times_pressure_matrix.resize(n_edges*n_cells);
+    scratch_data.pressure_rhs.resize(n_cells);
+
+    for (unsigned int v=0; v<n_lanes; ++v)
+      {
+        const unsigned int node = batch.nodes[v];
+        AssertDimension(node_storage.n_velocity_dofs(node), n_edges);
+        AssertDimension(node_storage.n_pressure_dofs(node), n_cells);
+
+        const double *const A = node_storage.velocity_matrix(node);
+        const double *const B = node_storage.pressure_matrix(node);
+        const double *const f = node_storage.velocity_rhs(node);
+        const double *const g = node_storage.pressure_rhs(node);
+        for (unsigned int i=0; i<n_edges*n_edges; ++i)
+          velocity_matrix[i][v] = A[i];
+        for (unsigned int i=0; i<n_edges*n_cells; ++i)
+          scratch_data.pressure_matrix[i][v] = B[i];
+        for (unsigned int i=0; i<n_edges; ++i)
+          velocity_rhs[i][v] = f[i];
+        for (unsigned int i=0; i<n_cells; ++i)
+          scratch_data.pressure_rhs[i][v] = g[i];
+      }
+
+    DataStructures::invert_in_place<n_edges>(velocity_matrix);
+
+    for (unsigned int i=0; i<n_edges; ++i)
+      for (unsigned int c=0; c<n_cells; ++c)
+        {
+          VectorizedArray<double> sum = 0.0;
+          for (unsigned int j=0; j<n_edges; ++j)
+            sum += velocity_matrix[i*n_edges + j] * scratch_data.pressure_matrix[j*n_cells + c];
+          scratch_data.inverse_times_pressure_matrix[i*n_cells + c] = sum;
         }
-    }
+
+    copy_data.batch = batch;
+    copy_data.node_pres_matrices.resize(n_lanes*n_cells*n_cells);
+    copy_data.node_pres_rhs.resize(n_lanes*n_cells);
+    for (unsigned int c=0; c<n_cells; ++c)
+      {
+        for (unsigned int d=0; d<n_cells; ++d)
+          {
+            VectorizedArray<double> sum = 0.0;
+            for (unsigned int i=0; i<n_edges; ++i)
+              sum += scratch_data.pressure_matrix[i*n_cells + c] *
+                     scratch_data.inverse_times_pressure_matrix[i*n_cells + d];
+            for (unsigned int v=0; v<n_lanes; ++v)
+              copy_data.node_pres_matrices[(v*n_cells + c)*n_cells + d] = sum[v];
+          }
+
+        // Since $A_i^{-1}$ is symmetric, $B_i^TA_i^{-1}f_i = (A_i^{-1}B_i)^Tf_i$.
+        VectorizedArray<double> sum = -scratch_data.pressure_rhs[c];
+        for (unsigned int i=0; i<n_edges; ++i)
+          sum += scratch_data.inverse_times_pressure_matrix[i*n_cells + c] * velocity_rhs[i];
+        for (unsigned int v=0; v<n_lanes; ++v)
+          copy_data.node_pres_rhs[v*n_cells + c] = sum[v];
+      }
+
+    for (unsigned int v=0; v<batch.n_filled; ++v)
+      {
+        double *const A = node_storage.velocity_matrix(batch.nodes[v]);
+        for (unsigned int i=0; i<n_edges*n_edges; ++i)
+          A[i] = velocity_matrix[i][v];
+      }
+  }
+
+
+  // The block size is a template argument of the kernel above, so the
+  // sizes that can occur are dispatched to their instantiations here.
+  template <int dim>
+  void MultipointMixedDarcyProblem<dim>::
+  nodal_batch_elimination(const std::vector<DataStructures::NodeBatch>::const_iterator &b_it,
+                          DataStructures::NodeBatchEliminationScratchData              &scratch_data,
+                          DataStructures::NodeBatchEliminationCopyData                 &copy_data)
+  {
+    static_assert(max_batched_block_size == 12,
+                  "The cases below need to match max_batched_block_size.");
+
+    switch (node_storage.n_velocity_dofs(b_it->nodes[0]))
+      {
+      case 1:  eliminate_node_batch<1>(*b_it, scratch_data, copy_data);  break;
+      case 2:  eliminate_node_batch<2>(*b_it, scratch_data, copy_data);  break;
+      case 3:  eliminate_node_batch<3>(*b_it, scratch_data, copy_data);  break;
+      case 4:  eliminate_node_batch<4>(*b_it, scratch_data, copy_data);  break;
+      case 5:  eliminate_node_batch<5>(*b_it, scratch_data, copy_data);  break;
+      case 6:  eliminate_node_batch<6>(*b_it, scratch_data, copy_data);  break;
+      case 7:  eliminate_node_batch<7>(*b_it, scratch_data, copy_data);  break;
+      case 8:  eliminate_node_batch<8>(*b_it, scratch_data, copy_data);  break;
+      case 9:  eliminate_node_batch<9>(*b_it, scratch_data, copy_data);  break;
+      case 10: eliminate_node_batch<10>(*b_it, scratch_data, copy_data); break;
+      case 11: eliminate_node_batch<11>(*b_it, scratch_data, copy_data); break;
+      case 12: eliminate_node_batch<12>(*b_it, scratch_data, copy_data); break;
+      default:
+        Assert(false, ExcNotImplemented());
+      }
+  }
+
+
+  template <int dim>
+  void MultipointMixedDarcyProblem<dim>::
+  copy_node_batch_to_system(const DataStructures::NodeBatchEliminationCopyData &copy_data)
+  {
+    for (unsigned int v=0; v<copy_data.batch.n_filled; ++v)
+      {
+        const unsigned int node = copy_data.batch.nodes[v];
+        const types::global_dof_index *pressure_indices =
+          node_storage.pressure_indices.data() + node_storage.pressure_offsets[node];
+        const unsigned int n_cells = node_storage.n_pressure_dofs(node);
+        const double *node_pres_matrix = copy_data.node_pres_matrices.data() + v*n_cells*n_cells;
+        const double *node_pres_rhs    = copy_data.node_pres_rhs.data() + v*n_cells;
+
+        for (unsigned int i=0; i<n_cells; ++i)
+          pres_system_matrix.add(pressure_indices[i], n_cells, pressure_indices,
+                                 node_pres_matrix + i*n_cells, false, true);
+
+        pres_rhs.add(n_cells, pressure_indices, node_pres_rhs);
+      }
   }
 
 
   // The @ref WorkStream mechanism is again used for the assembly
   // of the global system for the pressure variable, where the
   // previous functions are used to perform local computations.
+  // First, the nodes are sorted by their block sizes and grouped into
+  // batches. Nodes with blocks larger than the largest size of the batched
+  // kernel, which may occur at vertices with many neighbors in unstructured
+  // meshes, are eliminated one at a time.
   template <int dim>
   void MultipointMixedDarcyProblem<dim>::pressure_assembly()
   {
     TimerOutput::Scope t(computing_timer, "Pressure matrix assembly");
 
-    QGaussLobatto<dim> quad(degree+1);
-    QGauss<dim-1> face_quad(degree);
+    pres_rhs.reinit(locally_owned_pressure_dofs, mpi_communicator);
+
+    constexpr unsigned int n_lanes = VectorizedArray<double>::size();
+
+    std::vector<unsigned int> sorted_nodes(node_storage.nodes);
+    std::stable_sort(sorted_nodes.begin(), sorted_nodes.end(),
+                     [&](const unsigned int a, const unsigned int b)
+    {
+      return std::make_pair(node_storage.n_velocity_dofs(a), node_storage.n_pressure_dofs(a)) <
+             std::make_pair(node_storage.n_velocity_dofs(b), node_storage.n_pressure_dofs(b));
+    });
+
+    node_batches.clear();
+    unbatched_nodes.clear();
+    for (unsigned int i=0; i<sorted_nodes.size();)
+      {
+        const unsigned int node = sorted_nodes[i];
+        if (node_storage.n_velocity_dofs(node) > max_batched_block_size)
+          {
+            unbatched_nodes.push_back(node);
+            ++i;
+            continue;
+          }
+
+        DataStructures::NodeBatch batch;
+        batch.n_filled = 0;
+        while (batch.n_filled < n_lanes && i < sorted_nodes.size() &&
+               node_storage.n_velocity_dofs(sorted_nodes[i]) == node_storage.n_velocity_dofs(node) &&
+               node_storage.n_pressure_dofs(sorted_nodes[i]) == node_storage.n_pressure_dofs(node))
+          batch.nodes[batch.n_filled++] = sorted_nodes[i++];
+        for (unsigned int v=batch.n_filled; v<n_lanes; ++v)
+          batch.nodes[v] = batch.nodes[batch.n_filled-1];
+        node_batches.push_back(batch);
+      }
 
-    pres_rhs.reinit(n_p);
+    WorkStream::run(node_batches.cbegin(),
+                    node_batches.cend(),
+                    *this,
+                    &MultipointMixedDarcyProblem::nodal_batch_elimination,
+                    &MultipointMixedDarcyProblem::copy_node_batch_to_system,
+                    DataStructures::NodeBatchEliminationScratchData(),
+                    DataStructures::NodeBatchEliminationCopyData());
 
-    WorkStream::run(node_matrix.begin(),
-                    node_matrix.end(),
+    WorkStream::run(unbatched_nodes.cbegin(),
+                    unbatched_nodes.cend(),
                     *this,
                     &MultipointMixedDarcyProblem::nodal_elimination,
                     &MultipointMixedDarcyProblem::copy_node_to_system,
                     DataStructures::VertexEliminationScratchData(),
-                    DataStructures::NodeEliminationCopyData<dim>());
+                    DataStructures::NodeEliminationCopyData());
+
+    pres_system_matrix.compress(VectorOperation::add);
+    pres_rhs.compress(VectorOperation::add);
   }
 
 
@@ -734,50 +1390,57 @@ namespace MFMFE
   // so the following is a relatively straightforward implementation.
   template <int dim>
   void MultipointMixedDarcyProblem<dim>::
-  velocity_assembly (const typename DataStructures::PointToMatrixMap<dim>::iterator &n_it,
-                     DataStructures::VertexEliminationScratchData                   &scratch_data,
-                     DataStructures::NodeEliminationCopyData<dim>                   &copy_data)
+  velocity_assembly (const std::vector<unsigned int>::const_iterator &n_it,
+                     DataStructures::VertexEliminationScratchData    &scratch_data,
+                     DataStructures::NodeEliminationCopyData         &copy_data)
   {
-    unsigned int n_edges = velocity_indices.at((*n_it).first).size();
-    unsigned int n_cells = pressure_indices.at((*n_it).first).size();
+    const unsigned int node    = *n_it;
+    const unsigned int n_edges = node_storage.n_velocity_dofs(node);
+    const unsigned int n_cells = node_storage.n_pressure_dofs(node);
+
+    const double *const velocity_matrix_inverse = node_storage.velocity_matrix(node);
+    const double *const pressure_matrix         = node_storage.pressure_matrix(node);
+    const double *const velocity_rhs            = node_storage.velocity_rhs(node);
+    const types::global_dof_index *pressure_indices =
+      node_storage.pressure_indices.data() + node_storage.pressure_offsets[node];
 
-    scratch_data.tmp_rhs1.reinit(n_edges);
     scratch_data.tmp_rhs2.reinit(n_edges);
-    scratch_data.tmp_rhs3.reinit(n_cells);
     scratch_data.local_pressure_solution.reinit(n_cells);
 
     copy_data.vertex_vel_solution.reinit(n_edges);
 
-    std::set<types::global_dof_index>::iterator p_it;
-    unsigned int i;
+    for (unsigned int i=0; i<n_cells; ++i)
+      scratch_data.local_pressure_solution(i) = locally_relevant_pres_solution(pressure_indices[i]);
 
-    for (p_it = pressure_indices[(*n_it).first].begin(), i = 0;
-         p_it != pressure_indices[(*n_it).first].end();
-         ++p_it, ++i)
-      scratch_data.local_pressure_solution(i) = pres_solution(*p_it - n_v);
+    for (unsigned int i=0; i<n_edges; ++i)
+      {
+        scratch_data.tmp_rhs2(i) = velocity_rhs[i];
+        for (unsigned int j=0; j<n_cells; ++j)
+          scratch_data.tmp_rhs2(i) -= pressure_matrix[i*n_cells + j] * scratch_data.local_pressure_solution(j);
+      }
 
-    pressure_matrix[(*n_it).first].vmult(scratch_data.tmp_rhs2, scratch_data.local_pressure_solution, false);
-    scratch_data.tmp_rhs2 *= -1.0;
-    scratch_data.tmp_rhs2+=velocity_rhs[(*n_it).first];
-    A_inverse[(*n_it).first].vmult(copy_data.vertex_vel_solution, scratch_data.tmp_rhs2, false);
+    for (unsigned int i=0; i<n_edges; ++i)
+      for (unsigned int j=0; j<n_edges; ++j)
+        copy_data.vertex_vel_solution(i) += velocity_matrix_inverse[i*n_edges + j] * scratch_data.tmp_rhs2(j);
 
-    copy_data.p = (*n_it).first;
+    copy_data.node = node;
   }
 
 
   // Copy nodal velocities to a global solution vector by using
-  // local computations and indices from early stages.
+  // local computations and indices from early stages. Every velocity DoF
+  // is located at exactly one node, and that node is eliminated by one
+  // process, which need not be the owner of the DoF.
   template <int dim>
   void MultipointMixedDarcyProblem<dim>::
-  copy_node_velocity_to_global(const DataStructures::NodeEliminationCopyData<dim> &copy_data)
+  copy_node_velocity_to_global(const DataStructures::NodeEliminationCopyData &copy_data)
   {
-    std::set<types::global_dof_index>::iterator vi_it;
-    unsigned int i;
+    const types::global_dof_index *velocity_indices =
+      node_storage.velocity_indices.data() + node_storage.velocity_offsets[copy_data.node];
 
-    for (vi_it = velocity_indices[copy_data.p].begin(), i = 0;
-         vi_it != velocity_indices[copy_data.p].end();
-         ++vi_it, ++i)
-      vel_solution(*vi_it) += copy_data.vertex_vel_solution(i);
+    distributed_solution.add(node_storage.n_velocity_dofs(copy_data.node),
+                             velocity_indices,
+                             copy_data.vertex_vel_solution.begin());
   }
 
 
@@ -787,43 +1450,63 @@ namespace MFMFE
   {
     TimerOutput::Scope t(computing_timer, "Velocity solution recovery");
 
-    QGaussLobatto<dim> quad(degree+1);
-    QGauss<dim-1> face_quad(degree);
-
-    vel_solution.reinit(n_v);
+    distributed_solution.reinit(locally_owned_dofs, mpi_communicator);
 
-    WorkStream::run(node_matrix.begin(),
-                    node_matrix.end(),
+    WorkStream::run(node_storage.nodes.cbegin(),
+                    node_storage.nodes.cend(),
                     *this,
                     &MultipointMixedDarcyProblem::velocity_assembly,
                     &MultipointMixedDarcyProblem::copy_node_velocity_to_global,
                     DataStructures::VertexEliminationScratchData(),
-                    DataStructures::NodeEliminationCopyData<dim>());
+                    DataStructures::NodeEliminationCopyData());
+    distributed_solution.compress(VectorOperation::add);
 
-    solution.reinit(2);
-    solution.block(0) = vel_solution;
-    solution.block(1) = pres_solution;
-    solution.collect_sizes();
+    for (const auto i : locally_owned_pressure_dofs)
+      distributed_solution(n_v + i) = pres_solution(i);
+    distributed_solution.compress(VectorOperation::insert);
+
+    solution.reinit(locally_owned_dofs, locally_relevant_dofs, mpi_communicator);
+    solution = distributed_solution;
   }
 
 
 
   // @sect4{Pressure system solver}
 
-  // The solver part is trivial. We use the CG solver with no
-  // preconditioner for simplicity.
+  // The pressure matrix is symmetric and positive definite, and it
+  // resembles a cell-centered finite volume discretization of the Laplace
+  // operator. We therefore use the CG solver with an algebraic multigrid
+  // preconditioner, which keeps the number of iterations bounded as the
+  // mesh is refined. Velocity recovery needs the pressure values of the
+  // ghost cells, hence the solution is also copied to a ghosted vector.
   template <int dim>
   void MultipointMixedDarcyProblem<dim>::solve_pressure()
   {
     TimerOutput::Scope t(computing_timer, "Pressure CG solve");
 
-    pres_solution.reinit(n_p);
+    pres_solution.reinit(locally_owned_pressure_dofs, mpi_communicator);
 
     SolverControl solver_control (static_cast<int>(2.0*n_p), 1e-10);
-    SolverCG<> solver (solver_control);
+    SolverCG<TrilinosWrappers::MPI::Vector> solver (solver_control);
+
+    TrilinosWrappers::PreconditionAMG::AdditionalData amg_data;
+    amg_data.elliptic = true;
+    amg_data.higher_order_elements = false;
+    amg_data.smoother_sweeps = 2;
+    amg_data.aggregation_threshold = 0.02;
 
-    PreconditionIdentity identity;
-    solver.solve(pres_system_matrix, pres_solution, pres_rhs, identity);
+    TrilinosWrappers::PreconditionAMG preconditioner;
+    preconditioner.initialize(pres_system_matrix, amg_data);
+
+    solver.solve(pres_system_matrix, pres_solution, pres_rhs, preconditioner);
+
+    pcout << "   " << solver_control.last_step()
+          << " CG iterations for the pressure system" << std::endl;
+
+    locally_relevant_pres_solution.reinit(locally_owned_pressure_dofs,
+                                          locally_relevant_pressure_dofs,
+                                          mpi_communicator);
+    locally_relevant_pres_solution = pres_solution;
   }
 
 
@@ -832,7 +1515,7 @@ namespace MFMFE
 
   // We have two postprocessing steps here, first one computes the
   // errors in order to populate the convergence tables. The other
-  // one takes care of the output of the solutions in <code>.vtk</code>
+  // one takes care of the output of the solutions in <code>.vtu</code>
   // format.
 
   // @sect4{Compute errors}
@@ -845,7 +1528,8 @@ namespace MFMFE
   // class implementation to avoid exceptions. The only noteworthy thing here
   // is that we again use lower order quadrature rule instead of projecting the
   // solution to an appropriate space in order to show superconvergence, which is
-  // mathematically justified.
+  // mathematically justified. Each process computes the errors on its own cells,
+  // and these are summed up over all processes.
   template <int dim>
   void MultipointMixedDarcyProblem<dim>::compute_errors(const unsigned cycle)
   {
@@ -857,6 +1541,10 @@ namespace MFMFE
     ExactSolution<dim> exact_solution;
 
     Vector<double> cellwise_errors (triangulation.n_active_cells());
+    const auto global_error = [&](const VectorTools::NormType norm)
+    {
+      return VectorTools::compute_global_error(triangulation, cellwise_errors, norm);
+    };
 
     QTrapezoid<1> q_trapez;
     QIterated<dim> quadrature(q_trapez,degree+2);
@@ -866,28 +1554,28 @@ namespace MFMFE
                                        cellwise_errors, quadrature,
                                        VectorTools::L2_norm,
                                        &pressure_mask);
-    const double p_l2_error = cellwise_errors.l2_norm();
+    const double p_l2_error = global_error(VectorTools::L2_norm);
 
     VectorTools::integrate_difference (dof_handler, solution, exact_solution,
                                        cellwise_errors, quadrature_super,
                                        VectorTools::L2_norm,
                                        &pressure_mask);
-    const double p_l2_mid_error = cellwise_errors.l2_norm();
+    const double p_l2_mid_error = global_error(VectorTools::L2_norm);
 
     VectorTools::integrate_difference (dof_handler, solution, exact_solution,
                                        cellwise_errors, quadrature,
                                        VectorTools::L2_norm,
                                        &velocity_mask);
-    const double u_l2_error = cellwise_errors.l2_norm();
+    const double u_l2_error = global_error(VectorTools::L2_norm);
 
     VectorTools::integrate_difference (dof_handler, solution, exact_solution,
                                        cellwise_errors, quadrature,
                                        VectorTools::Hdiv_seminorm,
                                        &velocity_mask);
-    const double u_hd_error = cellwise_errors.l2_norm();
+    const double u_hd_error = global_error(VectorTools::Hdiv_seminorm);
 
-    const unsigned int n_active_cells=triangulation.n_active_cells();
-    const unsigned int n_dofs=dof_handler.n_dofs();
+    const types::global_cell_index n_active_cells=triangulation.n_global_active_cells();
+    const types::global_dof_index  n_dofs=dof_handler.n_dofs();
 
     convergence_table.add_value("cycle", cycle);
     convergence_table.add_value("cells", n_active_cells);
@@ -903,8 +1591,9 @@ namespace MFMFE
   // @sect4{Output results}
 
   // This function also follows the same idea as in step-20 tutorial
-  // program. The only modification to it is the part involving
-  // a convergence table.
+  // program. The only modifications to it are the part involving
+  // a convergence table and, as in step-40, one <code>.vtu</code> file
+  // per process together with a <code>.pvtu</code> record.
   template <int dim>
   void MultipointMixedDarcyProblem<dim>::output_results(const unsigned int cycle, const unsigned int refine)
   {
@@ -916,12 +1605,17 @@ namespace MFMFE
     interpretation (dim, DataComponentInterpretation::component_is_part_of_vector);
     interpretation.push_back (DataComponentInterpretation::component_is_scalar);
 
+    Vector<float> subdomain (triangulation.n_active_cells());
+    for (unsigned int i=0; i<subdomain.size(); ++i)
+      subdomain(i) = triangulation.locally_owned_subdomain();
+
     DataOut<dim> data_out;
     data_out.add_data_vector (dof_handler, solution, solution_names, interpretation);
+    data_out.add_data_vector (subdomain, "subdomain");
     data_out.build_patches ();
 
-    std::ofstream output ("solution" + std::to_string(dim) + "d-" + std::to_string(cycle) + ".vtk");
-    data_out.write_vtk (output);
+    data_out.write_vtu_with_pvtu_record ("./", "solution" + std::to_string(dim) + "d",
+                                         cycle, mpi_communicator, 2);
 
     convergence_table.set_precision("Velocity,L2", 3);
     convergence_table.set_precision("Velocity,Hdiv", 3);
@@ -945,10 +1639,11 @@ namespace MFMFE
     convergence_table.evaluate_convergence_rates("Pressure,L2", ConvergenceTable::reduction_rate_log2);
     convergence_table.evaluate_convergence_rates("Pressure,L2-nodal", ConvergenceTable::reduction_rate_log2);
 
-    std::ofstream error_table_file("error" + std::to_string(dim) + "d.tex");
-
-    if (cycle == refine-1)
+    if (cycle == refine-1 &&
+        Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
       {
+        std::ofstream error_table_file("error" + std::to_string(dim) + "d.tex");
+
         convergence_table.write_text(std::cout);
         convergence_table.write_tex(error_table_file);
       }
@@ -976,13 +1671,18 @@ namespace MFMFE
       {
         if (cycle == 0)
           {
-            // We first generate the hyper cube and refine it twice
-            // so that we could distort the grid slightly and
-            // demonstrate the method's ability to work in such a
-            // case.
-            GridGenerator::hyper_cube (triangulation, 0, 1);
-            triangulation.refine_global(2);
-            GridTools::distort_random (0.3, triangulation, true);
+            // We first generate the hyper cube subdivided four times
+            // in each direction so that we could distort the grid
+            // slightly and demonstrate the method's ability to work in
+            // such a case. A distributed triangulation recreates the
+            // cells moved to another process from its coarse mesh, so
+            // the distortion is applied to the coarse mesh, which is
+            // built in the same way on every process, before it is
+            // handed over.
+            Triangulation<dim> coarse_triangulation;
+            GridGenerator::subdivided_hyper_cube (coarse_triangulation, 4, 0, 1);
+            GridTools::distort_random (0.3, coarse_triangulation, true);
+            triangulation.copy_triangulation (coarse_triangulation);
           }
         else
           triangulation.refine_global(1);
@@ -1008,14 +1708,15 @@ namespace MFMFE
 // In the main functione we pass the order of the Finite Element as an argument
 // to the constructor of the Multipoint Flux Mixed Darcy problem, and the number
 // of refinement cycles as an argument for the run method.
-int main ()
+int main (int argc, char *argv[])
 {
   try
     {
       using namespace dealii;
       using namespace MFMFE;
 
-      MultithreadInfo::set_thread_limit();
+      Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv,
+                                                          numbers::invalid_unsigned_int);
 
       MultipointMixedDarcyProblem<2> mfmfe_problem(2);
       mfmfe_problem.run(6);
@@ -0,0 +1,87 @@
+##
+#  CMake snippet that provides a 'benchmark' target. The same file is used
+#  unchanged by all examples of the code gallery that have such a target;
+#  everything specific to one program is passed as arguments of
+#  ADD_BENCHMARK_TARGET() in its CMakeLists.txt.
+#
+#  ADD_BENCHMARK_TARGET(
+#    [ARGUMENTS <arguments>...]
+#    CSV_FILE <file>
+#    STRONG_SCALING_SIZE <size>
+#    STRONG_SCALING_PROCESSES <n_processes>...
+#    WEAK_SCALING_SIZES <size>...
+#    WEAK_SCALING_PROCESSES <n_processes>...
+#    )
+#
+#  runs the program ${TARGET} through DEAL_II_MPIEXEC as
+#    <program> <arguments>... <size>
+#  for fixed ladders of problem sizes and numbers of MPI processes, and keeps
+#  the file CSV_FILE (relative to the build directory) that each run writes:
+#  - strong scaling: the same problem on an increasing number of processes,
+#    written to benchmark-strong-<n_processes>.csv
+#  - weak scaling: a problem size that grows with the number of processes,
+#    written to benchmark-weak-<n_processes>.csv
+#  The given ladders are the defaults of the cache variables
+#  BENCHMARK_STRONG_SCALING_SIZE, BENCHMARK_STRONG_SCALING_PROCESSES,
+#  BENCHMARK_WEAK_SCALING_SIZES and BENCHMARK_WEAK_SCALING_PROCESSES, which
+#  can be changed on the cmake command line.
+##
+
+INCLUDE(CMakeParseArguments)
+
+FUNCTION(ADD_BENCHMARK_TARGET)
+  CMAKE_PARSE_ARGUMENTS(_benchmark
+    ""
+    "CSV_FILE;STRONG_SCALING_SIZE"
+    "ARGUMENTS;STRONG_SCALING_PROCESSES;WEAK_SCALING_SIZES;WEAK_SCALING_PROCESSES"
+    ${ARGN}
+    )
+
+  SET(BENCHMARK_STRONG_SCALING_SIZE "${_benchmark_STRONG_SCALING_SIZE}"
+    CACHE STRING "Problem size of the strong scaling runs")
+  SET(BENCHMARK_STRONG_SCALING_PROCESSES "${_benchmark_STRONG_SCALING_PROCESSES}"
+    CACHE STRING "Numbers of MPI processes of the strong scaling runs")
+  SET(BENCHMARK_WEAK_SCALING_SIZES "${_benchmark_WEAK_SCALING_SIZES}"
+    CACHE STRING "Problem sizes of the weak scaling runs")
+  SET(BENCHMARK_WEAK_SCALING_PROCESSES "${_benchmark_WEAK_SCALING_PROCESSES}"
+    CACHE STRING
+    "Numbers of MPI processes of the weak scaling runs, one for each size")
+
+  LIST(LENGTH BENCHMARK_WEAK_SCALING_SIZES _n_weak_runs)
+  LIST(LENGTH BENCHMARK_WEAK_SCALING_PROCESSES _n_weak_processes)
+  IF(NOT _n_weak_runs EQUAL _n_weak_processes)
+    MESSAGE(FATAL_ERROR
+      "BENCHMARK_WEAK_SCALING_SIZES and BENCHMARK_WEAK_SCALING_PROCESSES "
+      "need to have the same number of entries.")
+  ENDIF()
+
+  SET(_commands)
+  FOREACH(_n_processes ${BENCHMARK_STRONG_SCALING_PROCESSES})
+    LIST(APPEND _commands
+      COMMAND ${DEAL_II_MPIEXEC} ${DEAL_II_MPIEXEC_NUMPROC_FLAG} ${_n_processes}
+        $<TARGET_FILE:${TARGET}> ${_benchmark_ARGUMENTS}
+        ${BENCHMARK_STRONG_SCALING_SIZE}
+      COMMAND ${CMAKE_COMMAND} -E rename ${_benchmark_CSV_FILE}
+        benchmark-strong-${_n_processes}.csv
+      )
+  ENDFOREACH()
+  IF(_n_weak_runs GREATER 0)
+    MATH(EXPR _last_weak_run "${_n_weak_runs} - 1")
+    FOREACH(_run RANGE ${_last_weak_run})
+      LIST(GET BENCHMARK_WEAK_SCALING_SIZES ${_run} _size)
+      LIST(GET BENCHMARK_WEAK_SCALING_PROCESSES ${_run} _n_processes)
+      LIST(APPEND _commands
+        COMMAND ${DEAL_II_MPIEXEC} ${DEAL_II_MPIEXEC_NUMPROC_FLAG} ${_n_processes}
+          $<TARGET_FILE:${TARGET}> ${_benchmark_ARGUMENTS} ${_size}
+        COMMAND ${CMAKE_COMMAND} -E rename ${_benchmark_CSV_FILE}
+          benchmark-weak-${_n_processes}.csv
+        )
+    ENDFOREACH()
+  ENDIF()
+
+  ADD_CUSTOM_TARGET(benchmark ${_commands}
+    WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+    COMMENT "Run the strong and weak scaling benchmarks"
+    )
+  ADD_DEPENDENCIES(benchmark ${TARGET})
+ENDFUNCTION()
@@ -13,6 +13,7 @@
 
 #include <deal.II/lac/vector.h>
 #include <deal.II/lac/solver_cg.h>
+#include <deal.II/lac/solver_control.h>
 #include <deal.II/lac/precondition.h>
 #include <deal.II/lac/solver_gmres.h>
 #include <deal.II/lac/affine_constraints.h>
@@ -41,6 +42,9 @@
 
 #include <fstream>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
 #include <iostream>
 
 #include <deal.II/matrix_free/matrix_free.h>
@@ -240,6 +244,8 @@ namespace NS_TRBDF2 {
 
     void set_dt(const double time_step);
 
+    void set_Reynolds(const double Reynolds);
+
     void set_TR_BDF2_stage(const unsigned int stage);
 
     void set_NS_stage(const unsigned int stage);
@@ -248,6 +254,8 @@ namespace NS_TRBDF2 {
 
     void vmult_rhs_velocity(Vec& dst, const std::vector<Vec>& src) const;
 
+    void vmult_rhs_velocity_extrapolate(Vec& dst, const std::vector<Vec>& src, Vec& u_extr_dst, Vec& u_star_dst);
+
     void vmult_rhs_pressure(Vec& dst, const std::vector<Vec>& src) const;
 
     void vmult_grad_p_projection(Vec& dst, const Vec& src) const;
@@ -284,6 +292,11 @@ namespace NS_TRBDF2 {
 
     Vec                          u_extr; /*--- Auxiliary variable to update the extrapolated velocity ---*/
 
+    bool                         extrapolate_in_kernels; /*--- If true, the rhs kernels of the velocity build the extrapolated
+                                                               velocity at the quadrature points from the old ones ---*/
+    double                       extr_coeff_new;
+    double                       extr_coeff_old;
+
     EquationData::Velocity<dim>  vel_boundary_inflow; /*--- Auxiliary variable to impose velocity boundary conditions ---*/
 
     /*--- The following functions basically assemble the linear and bilinear forms. Their syntax is due to
@@ -384,7 +397,8 @@ namespace NS_TRBDF2 {
   NavierStokesProjectionOperator<dim, fe_degree_p, fe_degree_v, n_q_points_1d_p, n_q_points_1d_v, Vec>::
   NavierStokesProjectionOperator():
     MatrixFreeOperators::Base<dim, Vec>(), Re(), dt(), gamma(2.0 - std::sqrt(2.0)), a31((1.0 - gamma)/(2.0*(2.0 - gamma))),
-                                           a32(a31), a33(1.0/(2.0 - gamma)), TR_BDF2_stage(1), NS_stage(1), u_extr() {}
+                                           a32(a31), a33(1.0/(2.0 - gamma)), TR_BDF2_stage(1), NS_stage(1), u_extr(),
+                                           extrapolate_in_kernels(false), extr_coeff_new(0.0), extr_coeff_old(0.0) {}
 
 
   // We focus now on the constructor with runtime parameters storage
@@ -395,6 +409,7 @@ namespace NS_TRBDF2 {
     MatrixFreeOperators::Base<dim, Vec>(), Re(data.Reynolds), dt(data.dt),
                                            gamma(2.0 - std::sqrt(2.0)), a31((1.0 - gamma)/(2.0*(2.0 - gamma))),
                                            a32(a31), a33(1.0/(2.0 - gamma)), TR_BDF2_stage(1), NS_stage(1), u_extr(),
+                                           extrapolate_in_kernels(false), extr_coeff_new(0.0), extr_coeff_old(0.0),
                                            vel_boundary_inflow(data.initial_time) {}
 
 
@@ -407,6 +422,15 @@ namespace NS_TRBDF2 {
   }
 
 
+  // Setter of Reynolds number (called by Multigrid, since the default constructor does not know it)
+  //
+  template<int dim, int fe_degree_p, int fe_degree_v, int n_q_points_1d_p, int n_q_points_1d_v, typename Vec>
+  void NavierStokesProjectionOperator<dim, fe_degree_p, fe_degree_v, n_q_points_1d_p, n_q_points_1d_v, Vec>::
+  set_Reynolds(const double Reynolds) {
+    Re = Reynolds;
+  }
+
+
   // Setter of TR-BDF2 stage (this can be known only during the effective execution
   // and so it has to be demanded to the class that really solves the problem)
   //
@@ -483,7 +507,9 @@ namespace NS_TRBDF2 {
         for(unsigned int q = 0; q < phi.n_q_points; ++q) {
           const auto& u_n                = phi_old.get_value(q);
           const auto& grad_u_n           = phi_old.get_gradient(q);
-          const auto& u_n_gamma_ov_2     = phi_old_extr.get_value(q);
+          const auto& u_n_gamma_ov_2     = extrapolate_in_kernels ?
+                                           extr_coeff_new*u_n - extr_coeff_old*phi_old_extr.get_value(q) :
+                                           phi_old_extr.get_value(q);
           const auto& tensor_product_u_n = outer_product(u_n, u_n_gamma_ov_2);
           const auto& p_n                = phi_old_press.get_value(q);
           auto p_n_times_identity        = tensor_product_u_n;
@@ -586,9 +612,18 @@ namespace NS_TRBDF2 {
                                                                                  for both phi_p and phi_m. If the face is interior,
                                                                                  it correspond to the outer normal ---*/
 
+          const auto& u_old_p                = phi_old_p.get_value(q);
+          const auto& u_old_m                = phi_old_m.get_value(q);
+          const auto& u_old_extr_p           = extrapolate_in_kernels ?
+                                               extr_coeff_new*u_old_p - extr_coeff_old*phi_old_extr_p.get_value(q) :
+                                               phi_old_extr_p.get_value(q);
+          const auto& u_old_extr_m           = extrapolate_in_kernels ?
+                                               extr_coeff_new*u_old_m - extr_coeff_old*phi_old_extr_m.get_value(q) :
+                                               phi_old_extr_m.get_value(q);
+
           const auto& avg_grad_u_old         = 0.5*(phi_old_p.get_gradient(q) + phi_old_m.get_gradient(q));
-          const auto& avg_tensor_product_u_n = 0.5*(outer_product(phi_old_p.get_value(q), phi_old_extr_p.get_value(q)) +
-                                                    outer_product(phi_old_m.get_value(q), phi_old_extr_m.get_value(q)));
+          const auto& avg_tensor_product_u_n = 0.5*(outer_product(u_old_p, u_old_extr_p) +
+                                                    outer_product(u_old_m, u_old_extr_m));
           const auto& avg_p_old              = 0.5*(phi_old_press_p.get_value(q) + phi_old_press_m.get_value(q));
 
           phi_p.submit_value((a21/Re*avg_grad_u_old - a21*avg_tensor_product_u_n)*n_plus - avg_p_old*n_plus, q);
@@ -684,8 +719,13 @@ namespace NS_TRBDF2 {
         for(unsigned int q = 0; q < phi.n_q_points; ++q) {
           const auto& n_plus             = phi.get_normal_vector(q);
 
+          const auto& u_old              = phi_old.get_value(q);
+          const auto& u_old_extr         = extrapolate_in_kernels ?
+                                           extr_coeff_new*u_old - extr_coeff_old*phi_old_extr.get_value(q) :
+                                           phi_old_extr.get_value(q);
+
           const auto& grad_u_old         = phi_old.get_gradient(q);
-          const auto& tensor_product_u_n = outer_product(phi_old.get_value(q), phi_old_extr.get_value(q));
+          const auto& tensor_product_u_n = outer_product(u_old, u_old_extr);
           const auto& p_old              = phi_old_press.get_value(q);
           const auto& point_vectorized   = phi.quadrature_point(q);
           auto u_int_m                   = Tensor<1, dim, VectorizedArray<Number>>();
@@ -700,8 +740,8 @@ namespace NS_TRBDF2 {
                 u_int_m[d][v] = vel_boundary_inflow.value(point, d);
             }
           }
-          const auto tensor_product_u_int_m = outer_product(u_int_m, phi_old_extr.get_value(q));
-          const auto lambda                 = (boundary_id == 1) ? 0.0 : std::abs(scalar_product(phi_old_extr.get_value(q), n_plus));
+          const auto tensor_product_u_int_m = outer_product(u_int_m, u_old_extr);
+          const auto lambda                 = (boundary_id == 1) ? 0.0 : std::abs(scalar_product(u_old_extr, n_plus));
 
           phi.submit_value((a21/Re*grad_u_old - a21*tensor_product_u_n)*n_plus - p_old*n_plus +
                            a22/Re*2.0*coef_jump*u_int_m -
@@ -728,8 +768,10 @@ namespace NS_TRBDF2 {
         phi_int.gather_evaluate(src[1], EvaluationFlags::values | EvaluationFlags::gradients);
         phi_old_press.reinit(face);
         phi_old_press.gather_evaluate(src[2], EvaluationFlags::values);
-        phi_int_extr.reinit(face);
-        phi_int_extr.gather_evaluate(src[3], EvaluationFlags::values);
+        if(!extrapolate_in_kernels) {
+          phi_int_extr.reinit(face);
+          phi_int_extr.gather_evaluate(src[3], EvaluationFlags::values);
+        }
         phi.reinit(face);
 
         const auto boundary_id = data.get_boundary_id(face);
@@ -744,6 +786,9 @@ namespace NS_TRBDF2 {
           const auto& grad_u_int               = phi_int.get_gradient(q);
           const auto& tensor_product_u_n       = outer_product(phi_old.get_value(q), phi_old.get_value(q));
           const auto& tensor_product_u_n_gamma = outer_product(phi_int.get_value(q), phi_int.get_value(q));
+          const auto& u_int_extr               = extrapolate_in_kernels ?
+                                                 extr_coeff_new*phi_int.get_value(q) - extr_coeff_old*phi_old.get_value(q) :
+                                                 phi_int_extr.get_value(q);
           const auto& p_old                    = phi_old_press.get_value(q);
           const auto& point_vectorized         = phi.quadrature_point(q);
           auto u_m                             = Tensor<1, dim, VectorizedArray<Number>>();
@@ -756,8 +801,8 @@ namespace NS_TRBDF2 {
                 u_m[d][v] = vel_boundary_inflow.value(point, d);
             }
           }
-          const auto tensor_product_u_m = outer_product(u_m, phi_int_extr.get_value(q));
-          const auto lambda             = (boundary_id == 1) ? 0.0 : std::abs(scalar_product(phi_int_extr.get_value(q), n_plus));
+          const auto tensor_product_u_m = outer_product(u_m, u_int_extr);
+          const auto lambda             = (boundary_id == 1) ? 0.0 : std::abs(scalar_product(u_int_extr, n_plus));
 
           phi.submit_value((a31/Re*grad_u_old + a32/Re*grad_u_int -
                            a31*tensor_product_u_n - a32*tensor_product_u_n_gamma)*n_plus - p_old*n_plus +
@@ -788,6 +833,55 @@ namespace NS_TRBDF2 {
   }
 
 
+  // Fused variant of the previous function. The extrapolated velocity is not read from a vector, but it is built
+  // at the quadrature points from the two old velocities, which are anyway needed (src = {u_n, u_n_minus_1, p_n} for the
+  // first stage, src = {u_n, u_n_gamma, p_n_gamma} for the second one). The vector of the extrapolated velocity,
+  // which is still needed by the bilinear form and as initial guess, is written in the operation before the loop,
+  // namely while the corresponding entries of the old velocities are in cache because the cells are about to read them.
+  // In this way the extrapolation, the copy into the initial guess and the 'set_u_extr' do not need additional sweeps.
+  //
+  template<int dim, int fe_degree_p, int fe_degree_v, int n_q_points_1d_p, int n_q_points_1d_v, typename Vec>
+  void NavierStokesProjectionOperator<dim, fe_degree_p, fe_degree_v, n_q_points_1d_p, n_q_points_1d_v, Vec>::
+  vmult_rhs_velocity_extrapolate(Vec& dst, const std::vector<Vec>& src, Vec& u_extr_dst, Vec& u_star_dst) {
+    Assert(src.size() == 3, ExcDimensionMismatch(src.size(), 3));
+
+    for(auto& vec : src)
+      vec.update_ghost_values();
+
+    const double ratio = (TR_BDF2_stage == 1) ? gamma/(2.0*(1.0 - gamma)) : (1.0 - gamma)/gamma;
+    extr_coeff_new     = 1.0 + ratio;
+    extr_coeff_old     = ratio;
+    const Vec& u_new   = (TR_BDF2_stage == 1) ? src[0] : src[1];
+    const Vec& u_old   = (TR_BDF2_stage == 1) ? src[1] : src[0];
+
+    u_extr.reinit(u_extr_dst, true);
+    u_extr_dst.zero_out_ghost_values();
+    u_star_dst.zero_out_ghost_values();
+
+    extrapolate_in_kernels = true;
+    this->data->loop(&NavierStokesProjectionOperator::assemble_rhs_cell_term_velocity,
+                     &NavierStokesProjectionOperator::assemble_rhs_face_term_velocity,
+                     &NavierStokesProjectionOperator::assemble_rhs_boundary_term_velocity,
+                     this, dst, src,
+                     [&](const unsigned int start_range, const unsigned int end_range) {
+                       for(unsigned int i = start_range; i < end_range; ++i) {
+                         const Number u_extr_i = extr_coeff_new*u_new.local_element(i) - extr_coeff_old*u_old.local_element(i);
+                         u_extr.local_element(i)     = u_extr_i;
+                         u_extr_dst.local_element(i) = u_extr_i;
+                         u_star_dst.local_element(i) = u_extr_i;
+                         dst.local_element(i)        = 0.0;
+                       }
+                     },
+                     [](const unsigned int, const unsigned int) {},
+                     0,
+                     MatrixFree<dim, Number>::DataAccessOnFaces::unspecified,
+                     MatrixFree<dim, Number>::DataAccessOnFaces::unspecified);
+    extrapolate_in_kernels = false;
+
+    u_extr.update_ghost_values();
+  }
+
+
   // Now we focus on computing the rhs for the projection step for the pressure with the same ratio.
   // The following function assembles rhs cell term for the pressure
   //
@@ -2119,8 +2213,6 @@ namespace NS_TRBDF2 {
 
     void initialize();
 
-    void interpolate_velocity();
-
     void diffusion_step();
 
     void projection_step();
@@ -2139,9 +2231,26 @@ namespace NS_TRBDF2 {
 
     void save_max_res();
 
+    void save_native_res();
+
+    void save_checkpoint(const double time, const unsigned int n);
+
+    void load_checkpoint();
+
+    void write_benchmark_data(const unsigned int n) const;
+
   private:
     void compute_lift_and_drag();
 
+    void setup_probes();
+
+    void record_probes(const double time);
+
+    void solve_mixed_precision(LinearAlgebra::distributed::Vector<double>&       dst,
+                               const LinearAlgebra::distributed::Vector<double>& src,
+                               const double                                      tolerance,
+                               const bool                                        symmetric);
+
     /*--- Technical member to handle the various steps ---*/
     std::shared_ptr<MatrixFree<dim, double>> matrix_free_storage;
 
@@ -2150,11 +2259,25 @@ namespace NS_TRBDF2 {
                                    EquationData::degree_p + 1, EquationData::degree_p + 2,
                                    LinearAlgebra::distributed::Vector<double>> navier_stokes_matrix;
 
+    /*--- Single precision copies of the two previous members, employed only in mixed precision mode. With
+          'VectorizedArray<float>' the operator works on twice as many cells per instruction and moves half of the bytes ---*/
+    std::shared_ptr<MatrixFree<dim, float>> matrix_free_storage_float;
+
+    NavierStokesProjectionOperator<dim, EquationData::degree_p, EquationData::degree_p + 1,
+                                   EquationData::degree_p + 1, EquationData::degree_p + 2,
+                                   LinearAlgebra::distributed::Vector<float>> navier_stokes_matrix_float;
+
     /*--- This is an instance for geometric multigrid preconditioner ---*/
     MGLevelObject<NavierStokesProjectionOperator<dim, EquationData::degree_p, EquationData::degree_p + 1,
                                                  EquationData::degree_p + 1, EquationData::degree_p + 2,
                                                  LinearAlgebra::distributed::Vector<float>>> mg_matrices;
 
+    /*--- The same for the momentum predictor, if a multigrid preconditioner is employed also for the velocity.
+          The level operators share the 'MatrixFree' level storage with the pressure ones. ---*/
+    MGLevelObject<NavierStokesProjectionOperator<dim, EquationData::degree_p, EquationData::degree_p + 1,
+                                                 EquationData::degree_p + 1, EquationData::degree_p + 2,
+                                                 LinearAlgebra::distributed::Vector<float>>> mg_matrices_velocity;
+
     /*--- Here we define two 'AffineConstraints' instance, one for each finite element space.
           This is just a technical issue, due to MatrixFree requirements. In general
           this class is used to impose boundary conditions (or any kind of constraints), but in this case, since
@@ -2166,13 +2289,23 @@ namespace NS_TRBDF2 {
     /*--- Now a bunch of variables handled by 'ParamHandler' introduced at the beginning of the code ---*/
     unsigned int max_its;
     double       eps;
+    bool         mg_velocity;
+    bool         mixed_precision;
 
     unsigned int max_loc_refinements;
     unsigned int min_loc_refinements;
     unsigned int refinement_iterations;
 
+    unsigned int checkpoint_interval;
+    bool         restart;
+    double       time_restart; /*--- Time and step number read from the checkpoint in case of restart ---*/
+    unsigned int n_restart;
+
     std::string saving_dir;
 
+    bool         native_final_output;
+    unsigned int output_n_groups;
+
     /*--- Finally, some output related streams ---*/
     ConditionalOStream pcout;
 
@@ -2180,11 +2313,33 @@ namespace NS_TRBDF2 {
     ConditionalOStream ptime_out;
     TimerOutput        time_table;
 
+    /*--- Total number of iterations of the velocity and pressure solvers (the velocity ones are not counted
+          with mixed precision, where the iterative refinement has its own solver controls) ---*/
+    unsigned int n_iterations_velocity;
+    unsigned int n_iterations_pressure;
+
     std::ofstream output_n_dofs_velocity;
     std::ofstream output_n_dofs_pressure;
 
     std::ofstream output_lift;
     std::ofstream output_drag;
+
+    /*--- Face batches of 'matrix_free_storage' on the cylinder (boundary id 4), rebuilt in 'setup_dofs' ---*/
+    std::vector<unsigned int> cylinder_face_batches;
+
+    /*--- Probes: for each point found in a locally owned cell we cache the dof indices of that cell and
+          the values of the shape functions at the point, so that each sample is just a dot product ---*/
+    struct ProbeCache {
+      unsigned int                         index;
+      std::vector<types::global_dof_index> dof_indices_velocity;
+      std::vector<types::global_dof_index> dof_indices_pressure;
+      std::vector<double>                  shape_values_velocity;
+      std::vector<double>                  shape_values_pressure;
+    };
+
+    std::vector<Point<dim>> probe_points;
+    std::vector<ProbeCache> probe_cache;
+    std::ofstream           output_probes;
   };
 
 
@@ -2212,21 +2367,32 @@ namespace NS_TRBDF2 {
     quadrature_pressure(EquationData::degree_p + 1),
     quadrature_velocity(EquationData::degree_p + 2),
     navier_stokes_matrix(data),
+    navier_stokes_matrix_float(data),
     max_its(data.max_iterations),
     eps(data.eps),
+    mg_velocity(data.mg_velocity),
+    mixed_precision(data.mixed_precision),
     max_loc_refinements(data.max_loc_refinements),
     min_loc_refinements(data.min_loc_refinements),
     refinement_iterations(data.refinement_iterations),
+    checkpoint_interval(data.checkpoint_interval),
+    restart(data.restart),
+    time_restart(data.initial_time),
+    n_restart(1),
     saving_dir(data.dir),
+    native_final_output(data.native_final_output),
+    output_n_groups(data.output_n_groups),
     pcout(std::cout, Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0),
     time_out("./" + data.dir + "/time_analysis_" +
              Utilities::int_to_string(Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD)) + "proc.dat"),
     ptime_out(time_out, Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0),
     time_table(ptime_out, TimerOutput::summary, TimerOutput::cpu_and_wall_times),
-    output_n_dofs_velocity("./" + data.dir + "/n_dofs_velocity.dat", std::ofstream::out),
-    output_n_dofs_pressure("./" + data.dir + "/n_dofs_pressure.dat", std::ofstream::out),
-    output_lift("./" + data.dir + "/lift.dat", std::ofstream::out),
-    output_drag("./" + data.dir + "/drag.dat", std::ofstream::out) {
+    n_iterations_velocity(0),
+    n_iterations_pressure(0),
+    output_n_dofs_velocity("./" + data.dir + "/n_dofs_velocity.dat", data.restart ? std::ofstream::app : std::ofstream::out),
+    output_n_dofs_pressure("./" + data.dir + "/n_dofs_pressure.dat", data.restart ? std::ofstream::app : std::ofstream::out),
+    output_lift("./" + data.dir + "/lift.dat", data.restart ? std::ofstream::app : std::ofstream::out),
+    output_drag("./" + data.dir + "/drag.dat", data.restart ? std::ofstream::app : std::ofstream::out) {
       if(EquationData::degree_p < 1) {
         pcout
         << " WARNING: The chosen pair of finite element spaces is not stable."
@@ -2237,10 +2403,40 @@ namespace NS_TRBDF2 {
       AssertThrow(!((dt <= 0.0) || (dt > 0.5*T)), ExcInvalidTimeStep(dt, 0.5*T));
 
       matrix_free_storage = std::make_shared<MatrixFree<dim, double>>();
+      if(mixed_precision)
+        matrix_free_storage_float = std::make_shared<MatrixFree<dim, float>>();
+
+      /*--- The time series of the probes is streamed to a single binary file: a header with the number of
+            points, the number of components (velocity and pressure) and the coordinates, followed by a record
+            with time and values for each time step. ---*/
+      for(const auto& coordinates : data.probe_points) {
+        AssertThrow(coordinates.size() == dim, ExcDimensionMismatch(coordinates.size(), dim));
+        Point<dim> point;
+        for(unsigned int d = 0; d < dim; ++d)
+          point[d] = coordinates[d];
+        probe_points.push_back(point);
+      }
+      if(!probe_points.empty() && Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0) {
+        output_probes.open("./" + data.dir + "/probes.bin",
+                           std::ofstream::binary | (restart ? std::ofstream::app : std::ofstream::trunc));
+        if(!restart) {
+          const std::uint64_t n_probes     = probe_points.size();
+          const std::uint64_t n_components = dim + 1;
+          output_probes.write(reinterpret_cast<const char*>(&n_probes), sizeof(n_probes));
+          output_probes.write(reinterpret_cast<const char*>(&n_components), sizeof(n_components));
+          for(const auto& point : probe_points)
+            for(unsigned int d = 0; d < dim; ++d)
+              output_probes.write(reinterpret_cast<const char*>(&point[d]), sizeof(double));
+        }
+      }
 
       create_triangulation(data.n_refines);
-      setup_dofs();
-      initialize();
+      if(restart)
+        load_checkpoint();
+      else {
+        setup_dofs();
+        initialize();
+      }
   }
 
 
@@ -2254,6 +2450,10 @@ namespace NS_TRBDF2 {
     GridGenerator::plate_with_a_hole(triangulation, 0.5, 1.0, 1.0, 1.1, 1.0, 19.0, Point<2>(2.0, 2.0), 0, 1, 1.0, 2, true);
     /*--- We strongly advice to check the documentation to verify the meaning of all input parameters. ---*/
 
+    /*--- In case of restart the refinement history is stored in the checkpoint and 'load' wants the coarse mesh ---*/
+    if(restart)
+      return;
+
     pcout << "Number of refines = " << n_refines << std::endl;
     triangulation.refine_global(n_refines);
   }
@@ -2330,22 +2530,47 @@ namespace NS_TRBDF2 {
     matrix_free_storage->initialize_dof_vector(pres_n, 1);
     matrix_free_storage->initialize_dof_vector(rhs_p, 1);
 
+    /*--- The single precision 'MatrixFree' has exactly the same structure of the double one; only the
+          pressure terms on the right-hand side are never evaluated with it ---*/
+    if(mixed_precision) {
+      typename MatrixFree<dim, float>::AdditionalData additional_data_float;
+      additional_data_float.mapping_update_flags                = additional_data.mapping_update_flags;
+      additional_data_float.mapping_update_flags_inner_faces    = additional_data.mapping_update_flags_inner_faces;
+      additional_data_float.mapping_update_flags_boundary_faces = additional_data.mapping_update_flags_boundary_faces;
+      additional_data_float.tasks_parallel_scheme               = MatrixFree<dim, float>::AdditionalData::none;
+
+      AffineConstraints<float> constraints_velocity_float,
+                               constraints_pressure_float;
+      constraints_velocity_float.close();
+      constraints_pressure_float.close();
+      std::vector<const AffineConstraints<float>*> constraints_float;
+      constraints_float.push_back(&constraints_velocity_float);
+      constraints_float.push_back(&constraints_pressure_float);
+
+      matrix_free_storage_float->reinit(MappingQ1<dim>(), dof_handlers, constraints_float, quadratures, additional_data_float);
+    }
+
     /*--- Initialize the multigrid structure. We dedicate ad hoc 'dof_handlers_mg' and 'constraints_mg' because
           we use float as type. Moreover we can initialize already with the index of the finite element of the pressure;
           anyway we need by requirement to declare also structures for the velocity for coherence (basically because
           the index of finite element space has to be the same, so the pressure has to be the second).---*/
     mg_matrices.clear_elements();
+    mg_matrices_velocity.clear_elements();
     dof_handler_velocity.distribute_mg_dofs();
     dof_handler_pressure.distribute_mg_dofs();
 
     const unsigned int nlevels = triangulation.n_global_levels();
     mg_matrices.resize(0, nlevels - 1);
+    if(mg_velocity)
+      mg_matrices_velocity.resize(0, nlevels - 1);
     for(unsigned int level = 0; level < nlevels; ++level) {
       typename MatrixFree<dim, float>::AdditionalData additional_data_mg;
       additional_data_mg.tasks_parallel_scheme               = MatrixFree<dim, float>::AdditionalData::none;
       additional_data_mg.mapping_update_flags                = (update_gradients | update_JxW_values);
       additional_data_mg.mapping_update_flags_inner_faces    = (update_gradients | update_JxW_values);
       additional_data_mg.mapping_update_flags_boundary_faces = (update_gradients | update_JxW_values);
+      if(mg_velocity) /*--- The boundary term for the velocity needs the quadrature points ---*/
+        additional_data_mg.mapping_update_flags_boundary_faces |= update_quadrature_points;
       additional_data_mg.mg_level = level;
 
       std::vector<const DoFHandler<dim>*> dof_handlers_mg;
@@ -2367,9 +2592,108 @@ namespace NS_TRBDF2 {
       mg_matrices[level].initialize(mg_mf_storage_level, tmp, tmp);
       mg_matrices[level].set_dt(dt);
       mg_matrices[level].set_NS_stage(2);
+
+      if(mg_velocity) {
+        const std::vector<unsigned int> tmp_velocity = {0};
+        mg_matrices_velocity[level].initialize(mg_mf_storage_level, tmp_velocity, tmp_velocity);
+        mg_matrices_velocity[level].set_dt(dt);
+        mg_matrices_velocity[level].set_Reynolds(Re);
+        mg_matrices_velocity[level].set_TR_BDF2_stage(TR_BDF2_stage);
+        mg_matrices_velocity[level].set_NS_stage(1);
+      }
     }
 
     Linfty_error_per_cell_vel.reinit(triangulation.n_active_cells());
+
+    /*--- The boundary faces are grouped in batches with the same boundary id, so we can select
+          once and for all those on the cylinder (needed for lift and drag) ---*/
+    cylinder_face_batches.clear();
+    for(unsigned int face = matrix_free_storage->n_inner_face_batches();
+        face < matrix_free_storage->n_inner_face_batches() + matrix_free_storage->n_boundary_face_batches(); ++face) {
+      if(matrix_free_storage->get_boundary_id(face) == 4)
+        cylinder_face_batches.push_back(face);
+    }
+
+    setup_probes();
+  }
+
+
+  // This function locates the probes in the current mesh. It is called after each change of the mesh and it is the
+  // only place where we search for cells, so that the recording at each time step does not need any search.
+  //
+  template<int dim>
+  void NavierStokesProjection<dim>::setup_probes() {
+    probe_cache.clear();
+
+    for(unsigned int i = 0; i < probe_points.size(); ++i) {
+      std::pair<typename DoFHandler<dim>::active_cell_iterator, Point<dim>> cell_and_point;
+      try {
+        cell_and_point = GridTools::find_active_cell_around_point(MappingQ1<dim>(), dof_handler_velocity, probe_points[i]);
+      }
+      catch(const GridTools::ExcPointNotFound<dim>&) {
+        continue;
+      }
+      const auto& cell = cell_and_point.first;
+      if(cell.state() != IteratorState::valid || !cell->is_locally_owned())
+        continue;
+
+      ProbeCache probe;
+      probe.index = i;
+
+      probe.dof_indices_velocity.resize(fe_velocity.n_dofs_per_cell());
+      cell->get_dof_indices(probe.dof_indices_velocity);
+      probe.shape_values_velocity.resize(fe_velocity.n_dofs_per_cell());
+      for(unsigned int j = 0; j < fe_velocity.n_dofs_per_cell(); ++j)
+        probe.shape_values_velocity[j] = fe_velocity.shape_value_component(j, cell_and_point.second,
+                                                                           fe_velocity.system_to_component_index(j).first);
+
+      /*--- The cell of the pressure is the same geometric cell, seen through the other dof handler ---*/
+      const typename DoFHandler<dim>::active_cell_iterator cell_pressure(&triangulation, cell->level(), cell->index(),
+                                                                          &dof_handler_pressure);
+      probe.dof_indices_pressure.resize(fe_pressure.n_dofs_per_cell());
+      cell_pressure->get_dof_indices(probe.dof_indices_pressure);
+      probe.shape_values_pressure.resize(fe_pressure.n_dofs_per_cell());
+      for(unsigned int j = 0; j < fe_pressure.n_dofs_per_cell(); ++j)
+        probe.shape_values_pressure[j] = fe_pressure.shape_value(j, cell_and_point.second);
+
+      probe_cache.push_back(probe);
+    }
+  }
+
+
+  // This function evaluates velocity and pressure at the probes and appends a record to the binary file.
+  // A point on the interface between two processors may be found by both of them and in that case
+  // we take the average of the two values. Points outside the domain are recorded as NaN.
+  //
+  template<int dim>
+  void NavierStokesProjection<dim>::record_probes(const double time) {
+    if(probe_points.empty())
+      return;
+
+    TimerOutput::Scope t(time_table, "Record probes");
+
+    std::vector<double> values(probe_points.size()*(dim + 1), 0.0);
+    std::vector<double> n_found(probe_points.size(), 0.0);
+    for(const auto& probe : probe_cache) {
+      for(unsigned int j = 0; j < probe.dof_indices_velocity.size(); ++j)
+        values[probe.index*(dim + 1) + fe_velocity.system_to_component_index(j).first] +=
+        u_n(probe.dof_indices_velocity[j])*probe.shape_values_velocity[j];
+      for(unsigned int j = 0; j < probe.dof_indices_pressure.size(); ++j)
+        values[probe.index*(dim + 1) + dim] += pres_n(probe.dof_indices_pressure[j])*probe.shape_values_pressure[j];
+      n_found[probe.index] += 1.0;
+    }
+    Utilities::MPI::sum(values, MPI_COMM_WORLD, values);
+    Utilities::MPI::sum(n_found, MPI_COMM_WORLD, n_found);
+
+    if(Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0) {
+      for(unsigned int i = 0; i < probe_points.size(); ++i) {
+        for(unsigned int c = 0; c < dim + 1; ++c)
+          values[i*(dim + 1) + c] = (n_found[i] > 0.0) ? values[i*(dim + 1) + c]/n_found[i] :
+                                                         std::numeric_limits<double>::quiet_NaN();
+      }
+      output_probes.write(reinterpret_cast<const char*>(&time), sizeof(time));
+      output_probes.write(reinterpret_cast<const char*>(values.data()), values.size()*sizeof(double));
+    }
   }
 
 
@@ -2387,27 +2711,6 @@ namespace NS_TRBDF2 {
   }
 
 
-  // This function computes the extrapolated velocity to be used in the momentum predictor
-  //
-  template<int dim>
-  void NavierStokesProjection<dim>::interpolate_velocity() {
-    TimerOutput::Scope t(time_table, "Interpolate velocity");
-
-    //--- TR-BDF2 first step
-    if(TR_BDF2_stage == 1) {
-      u_extr.equ(1.0 + gamma/(2.0*(1.0 - gamma)), u_n);
-      u_tmp.equ(gamma/(2.0*(1.0 - gamma)), u_n_minus_1);
-      u_extr -= u_tmp;
-    }
-    //--- TR-BDF2 second step
-    else {
-      u_extr.equ(1.0 + (1.0 - gamma)/gamma, u_n_gamma);
-      u_tmp.equ((1.0 - gamma)/gamma, u_n);
-      u_extr -= u_tmp;
-    }
-  }
-
-
   // We are finally ready to solve the diffusion step.
   //
   template<int dim>
@@ -2422,35 +2725,113 @@ namespace NS_TRBDF2 {
     /*--- Next, we specify at we are at stage 1, namely the diffusion step ---*/
     navier_stokes_matrix.set_NS_stage(1);
 
-    /*--- Now, we compute the right-hand side and we set the convective velocity. The necessity of 'set_u_extr' is
-          that this quantity is required in the bilinear forms and we can't use a vector of src like on the right-hand side,
-          so it has to be available ---*/
-    if(TR_BDF2_stage == 1) {
-      navier_stokes_matrix.vmult_rhs_velocity(rhs_u, {u_n, u_extr, pres_n});
-      navier_stokes_matrix.set_u_extr(u_extr);
-      u_star = u_extr;
-    }
-    else {
-      navier_stokes_matrix.vmult_rhs_velocity(rhs_u, {u_n, u_n_gamma, pres_int, u_extr});
-      navier_stokes_matrix.set_u_extr(u_extr);
-      u_star = u_extr;
-    }
+    /*--- Now, we compute the right-hand side and, in the same loop, the extrapolated velocity. This is stored both in
+          'u_extr' and inside the operator, since it is required in the bilinear forms and we can't use a vector of src
+          like on the right-hand side, and it is employed also as initial guess ---*/
+    if(TR_BDF2_stage == 1)
+      navier_stokes_matrix.vmult_rhs_velocity_extrapolate(rhs_u, {u_n, u_n_minus_1, pres_n}, u_extr, u_star);
+    else
+      navier_stokes_matrix.vmult_rhs_velocity_extrapolate(rhs_u, {u_n, u_n_gamma, pres_int}, u_extr, u_star);
 
     /*--- Build the linear solver; in this case we specifiy the maximum number of iterations and residual ---*/
     SolverControl solver_control(max_its, eps*rhs_u.l2_norm());
-    SolverGMRES<LinearAlgebra::distributed::Vector<double>> gmres(solver_control);
 
-    /*--- Build a Jacobi preconditioner and solve ---*/
-    PreconditionJacobi<NavierStokesProjectionOperator<dim,
-                                                      EquationData::degree_p,
-                                                      EquationData::degree_p + 1,
-                                                      EquationData::degree_p + 1,
-                                                      EquationData::degree_p + 2,
-                                                      LinearAlgebra::distributed::Vector<double>>> preconditioner;
-    navier_stokes_matrix.compute_diagonal();
-    preconditioner.initialize(navier_stokes_matrix);
+    if(mixed_precision && !mg_velocity) {
+      const std::vector<unsigned int> tmp_float = {0};
+      navier_stokes_matrix_float.initialize(matrix_free_storage_float, tmp_float, tmp_float);
+      navier_stokes_matrix_float.set_NS_stage(1);
 
-    gmres.solve(navier_stokes_matrix, u_star, rhs_u, preconditioner);
+      LinearAlgebra::distributed::Vector<float> u_extr_float;
+      matrix_free_storage_float->initialize_dof_vector(u_extr_float, 0);
+      u_extr_float = u_extr;
+      navier_stokes_matrix_float.set_u_extr(u_extr_float);
+
+      solve_mixed_precision(u_star, rhs_u, solver_control.tolerance(), false);
+    }
+    else if(!mg_velocity) {
+      SolverGMRES<LinearAlgebra::distributed::Vector<double>> gmres(solver_control);
+
+      /*--- Build a Jacobi preconditioner and solve ---*/
+      PreconditionJacobi<NavierStokesProjectionOperator<dim,
+                                                        EquationData::degree_p,
+                                                        EquationData::degree_p + 1,
+                                                        EquationData::degree_p + 1,
+                                                        EquationData::degree_p + 2,
+                                                        LinearAlgebra::distributed::Vector<double>>> preconditioner;
+      navier_stokes_matrix.compute_diagonal();
+      preconditioner.initialize(navier_stokes_matrix);
+
+      gmres.solve(navier_stokes_matrix, u_star, rhs_u, preconditioner);
+      n_iterations_velocity += solver_control.last_step();
+    }
+    else {
+      /*--- Build the geometric multigrid preconditioner in the same way as for the pressure. The main difference is that
+            the velocity operator depends on the extrapolated velocity, which we need therefore to transfer to all the levels.
+            Since the coarse grid solver is an iterative one, the preconditioner is not a fixed linear operator and
+            we use the flexible variant of GMRES as outer solver. ---*/
+      MGTransferMatrixFree<dim, float> mg_transfer;
+      mg_transfer.build(dof_handler_velocity);
+
+      MGLevelObject<LinearAlgebra::distributed::Vector<float>> level_u_extr(0, triangulation.n_global_levels() - 1);
+      for(unsigned int level = 0; level < triangulation.n_global_levels(); ++level)
+        mg_matrices_velocity[level].initialize_dof_vector(level_u_extr[level]);
+      mg_transfer.interpolate_to_mg(dof_handler_velocity, level_u_extr, u_extr);
+
+      using SmootherType = PreconditionChebyshev<NavierStokesProjectionOperator<dim,
+                                                                                EquationData::degree_p,
+                                                                                EquationData::degree_p + 1,
+                                                                                EquationData::degree_p + 1,
+                                                                                EquationData::degree_p + 2,
+                                                                                LinearAlgebra::distributed::Vector<float>>,
+                                                 LinearAlgebra::distributed::Vector<float>>;
+      mg::SmootherRelaxation<SmootherType, LinearAlgebra::distributed::Vector<float>> mg_smoother;
+      MGLevelObject<typename SmootherType::AdditionalData> smoother_data;
+      smoother_data.resize(0, triangulation.n_global_levels() - 1);
+      for(unsigned int level = 0; level < triangulation.n_global_levels(); ++level) {
+        mg_matrices_velocity[level].set_u_extr(level_u_extr[level]);
+        if(level > 0) {
+          smoother_data[level].smoothing_range     = 15.0;
+          smoother_data[level].degree              = 3;
+          smoother_data[level].eig_cg_n_iterations = 10;
+        }
+        else {
+          smoother_data[0].smoothing_range     = 2e-2;
+          smoother_data[0].degree              = numbers::invalid_unsigned_int;
+          smoother_data[0].eig_cg_n_iterations = mg_matrices_velocity[0].m();
+        }
+        mg_matrices_velocity[level].compute_diagonal();
+        smoother_data[level].preconditioner = mg_matrices_velocity[level].get_matrix_diagonal_inverse();
+      }
+      mg_smoother.initialize(mg_matrices_velocity, smoother_data);
+
+      /*--- The coarse problem only needs to be solved approximately inside the V-cycle, and in single precision a tolerance
+            relative to the fine level right-hand side can not even be reached. We therefore reduce the coarse residual
+            by two orders of magnitude, with a small cap on the number of iterations. ---*/
+      PreconditionIdentity                                  identity;
+      ReductionControl                                      solver_control_coarse(100, 1e-20, 1e-2, false, false);
+      SolverGMRES<LinearAlgebra::distributed::Vector<float>> gmres_mg(solver_control_coarse);
+      MGCoarseGridIterativeSolver<LinearAlgebra::distributed::Vector<float>,
+                                  SolverGMRES<LinearAlgebra::distributed::Vector<float>>,
+                                  NavierStokesProjectionOperator<dim,
+                                                                 EquationData::degree_p,
+                                                                 EquationData::degree_p + 1,
+                                                                 EquationData::degree_p + 1,
+                                                                 EquationData::degree_p + 2,
+                                                                 LinearAlgebra::distributed::Vector<float>>,
+                                  PreconditionIdentity> mg_coarse(gmres_mg, mg_matrices_velocity[0], identity);
+
+      mg::Matrix<LinearAlgebra::distributed::Vector<float>> mg_matrix(mg_matrices_velocity);
+
+      Multigrid<LinearAlgebra::distributed::Vector<float>> mg(mg_matrix, mg_coarse, mg_transfer, mg_smoother, mg_smoother);
+
+      PreconditionMG<dim,
+                     LinearAlgebra::distributed::Vector<float>,
+                     MGTransferMatrixFree<dim, float>> preconditioner(dof_handler_velocity, mg, mg_transfer);
+
+      SolverFGMRES<LinearAlgebra::distributed::Vector<double>> fgmres(solver_control);
+      fgmres.solve(navier_stokes_matrix, u_star, rhs_u, preconditioner);
+      n_iterations_velocity += solver_control.last_step();
+    }
   }
 
 
@@ -2535,6 +2916,7 @@ namespace NS_TRBDF2 {
       pres_n = pres_int;
       cg.solve(navier_stokes_matrix, pres_n, rhs_p, preconditioner);
     }
+    n_iterations_pressure += solver_control.last_step();
   }
 
 
@@ -2562,8 +2944,76 @@ namespace NS_TRBDF2 {
 
     /*--- Solve the system ---*/
     SolverControl solver_control(max_its, 1e-12*rhs_u.l2_norm());
-    SolverCG<LinearAlgebra::distributed::Vector<double>> cg(solver_control);
-    cg.solve(navier_stokes_matrix, u_tmp, rhs_u, PreconditionIdentity());
+    if(mixed_precision) {
+      navier_stokes_matrix_float.initialize(matrix_free_storage_float, tmp, tmp);
+      navier_stokes_matrix_float.set_NS_stage(3);
+
+      solve_mixed_precision(u_tmp, rhs_u, solver_control.tolerance(), true);
+    }
+    else {
+      SolverCG<LinearAlgebra::distributed::Vector<double>> cg(solver_control);
+      cg.solve(navier_stokes_matrix, u_tmp, rhs_u, PreconditionIdentity());
+    }
+  }
+
+
+  // Mixed precision solve by iterative refinement: residual and update are computed in double precision with
+  // 'navier_stokes_matrix', whereas the correction equation is solved with the float operator, which has to be
+  // already in the same stage. Since each inner solve is only asked to reduce the residual by a few orders of
+  // magnitude, its (single precision) accuracy is sufficient and the outer loop recovers the full tolerance.
+  //
+  template<int dim>
+  void NavierStokesProjection<dim>::solve_mixed_precision(LinearAlgebra::distributed::Vector<double>&       dst,
+                                                          const LinearAlgebra::distributed::Vector<double>& src,
+                                                          const double                                      tolerance,
+                                                          const bool                                        symmetric) {
+    LinearAlgebra::distributed::Vector<double> residual, correction;
+    matrix_free_storage->initialize_dof_vector(residual, 0);
+    matrix_free_storage->initialize_dof_vector(correction, 0);
+    LinearAlgebra::distributed::Vector<float> residual_float, correction_float;
+    matrix_free_storage_float->initialize_dof_vector(residual_float, 0);
+    matrix_free_storage_float->initialize_dof_vector(correction_float, 0);
+
+    /*--- The Jacobi preconditioner of the momentum predictor does not change during the refinement ---*/
+    PreconditionJacobi<NavierStokesProjectionOperator<dim,
+                                                      EquationData::degree_p,
+                                                      EquationData::degree_p + 1,
+                                                      EquationData::degree_p + 1,
+                                                      EquationData::degree_p + 2,
+                                                      LinearAlgebra::distributed::Vector<float>>> preconditioner;
+    if(!symmetric) {
+      navier_stokes_matrix_float.compute_diagonal();
+      preconditioner.initialize(navier_stokes_matrix_float);
+    }
+
+    navier_stokes_matrix.vmult(residual, dst);
+    residual.sadd(-1.0, 1.0, src);
+    double residual_norm = residual.l2_norm();
+
+    unsigned int n_refinements = 0;
+    while(residual_norm > tolerance) {
+      AssertThrow(n_refinements < max_its, SolverControl::NoConvergence(n_refinements, residual_norm));
+      ++n_refinements;
+
+      residual_float   = residual;
+      correction_float = 0.0f;
+      ReductionControl solver_control_float(max_its, 0.5*tolerance, 1e-3, false, false);
+      if(symmetric) {
+        SolverCG<LinearAlgebra::distributed::Vector<float>> cg(solver_control_float);
+        cg.solve(navier_stokes_matrix_float, correction_float, residual_float, PreconditionIdentity());
+      }
+      else {
+        SolverGMRES<LinearAlgebra::distributed::Vector<float>> gmres(solver_control_float);
+        gmres.solve(navier_stokes_matrix_float, correction_float, residual_float, preconditioner);
+      }
+
+      correction = correction_float;
+      dst += correction;
+
+      navier_stokes_matrix.vmult(residual, dst);
+      residual.sadd(-1.0, 1.0, src);
+      residual_norm = residual.l2_norm();
+    }
   }
 
 
@@ -2630,61 +3080,37 @@ namespace NS_TRBDF2 {
   //
   template<int dim>
   void NavierStokesProjection<dim>::compute_lift_and_drag() {
-    QGauss<dim - 1> face_quadrature_formula(EquationData::degree_p + 2);
-    const int n_q_points = face_quadrature_formula.size();
-
-    std::vector<double>                      pressure_values(n_q_points);
-    std::vector<std::vector<Tensor<1, dim>>> velocity_gradients(n_q_points, std::vector<Tensor<1, dim>>(dim));
-
-    Tensor<1, dim> normal_vector;
-    Tensor<2, dim> fluid_stress;
-    Tensor<2, dim> fluid_pressure;
-    Tensor<1, dim> forces;
-
-    /*--- We need to compute the integral over the cylinder boundary, so we need to use 'FEFaceValues' instances.
-          For the velocity we need the gradients, for the pressure the values. ---*/
-    FEFaceValues<dim> fe_face_values_velocity(fe_velocity, face_quadrature_formula,
-                                              update_quadrature_points | update_gradients |
-                                              update_JxW_values | update_normal_vectors);
-    FEFaceValues<dim> fe_face_values_pressure(fe_pressure, face_quadrature_formula, update_values);
+    /*--- We need to compute the integral over the cylinder boundary. We reuse the 'MatrixFree' structure and visit only
+          the face batches on the cylinder selected in 'setup_dofs'. For the velocity we need the gradients,
+          for the pressure the values. ---*/
+    FEFaceEvaluation<dim, EquationData::degree_p + 1, EquationData::degree_p + 2, dim, double> phi_v(*matrix_free_storage, true, 0);
+    FEFaceEvaluation<dim, EquationData::degree_p, EquationData::degree_p + 2, 1, double>       phi_p(*matrix_free_storage, true, 1);
 
     double local_drag = 0.0;
     double local_lift = 0.0;
 
-    /*--- We need to perform a unique loop because the whole stress tensor takes into account contributions of
-          velocity and pressure obviously. However, the two dof_handlers are different, so we neede to create an ad-hoc
-          iterator for the pressure that we update manually. It is guaranteed that the cells are visited in the same order
-          (see the documentation) ---*/
-    auto tmp_cell = dof_handler_pressure.begin_active();
-    for(const auto& cell : dof_handler_velocity.active_cell_iterators()) {
-      if(cell->is_locally_owned()) {
-        for(unsigned int face = 0; face < GeometryInfo<dim>::faces_per_cell; ++face) {
-          if(cell->face(face)->at_boundary() && cell->face(face)->boundary_id() == 4) {
-            fe_face_values_velocity.reinit(cell, face);
-            fe_face_values_pressure.reinit(tmp_cell, face);
-
-            fe_face_values_velocity.get_function_gradients(u_n, velocity_gradients); /*--- velocity gradients ---*/
-            fe_face_values_pressure.get_function_values(pres_n, pressure_values); /*--- pressure values ---*/
-
-            for(int q = 0; q < n_q_points; q++) {
-              normal_vector = -fe_face_values_velocity.normal_vector(q);
-
-              for(unsigned int d = 0; d < dim; ++ d) {
-                fluid_pressure[d][d] = pressure_values[q];
-                for(unsigned int k = 0; k < dim; ++k)
-                  fluid_stress[d][k] = 1.0/Re*velocity_gradients[q][d][k];
-              }
-              fluid_stress = fluid_stress - fluid_pressure;
+    for(const auto face : cylinder_face_batches) {
+      phi_v.reinit(face);
+      phi_v.gather_evaluate(u_n, EvaluationFlags::gradients);
+      phi_p.reinit(face);
+      phi_p.gather_evaluate(pres_n, EvaluationFlags::values);
 
-              forces = fluid_stress*normal_vector*fe_face_values_velocity.JxW(q);
+      Tensor<1, dim, VectorizedArray<double>> forces;
+      for(unsigned int q = 0; q < phi_v.n_q_points; ++q) {
+        auto fluid_stress    = 1.0/Re*phi_v.get_gradient(q);
+        const auto& pressure = phi_p.get_value(q);
+        for(unsigned int d = 0; d < dim; ++d)
+          fluid_stress[d][d] -= pressure;
 
-              local_drag += forces[0];
-              local_lift += forces[1];
-            }
-          }
-        }
+        /*--- The normal is the outer one of the fluid domain, so we change sign to get the force on the cylinder ---*/
+        forces -= fluid_stress*phi_v.get_normal_vector(q)*phi_v.JxW(q);
+      }
+
+      /*--- Only the filled lanes of the last batch carry actual faces ---*/
+      for(unsigned int v = 0; v < matrix_free_storage->n_active_entries_per_face_batch(face); ++v) {
+        local_drag += forces[0][v];
+        local_lift += forces[1][v];
       }
-      ++tmp_cell;
     }
 
     /*--- At the end, each processor has computed the contribution to the boundary cells it owns and, therefore,
@@ -2905,8 +3331,168 @@ namespace NS_TRBDF2 {
   }
 
 
+  // Save the final solution directly on the adaptive mesh. Instead of refining globally up to the finest level, each cell
+  // is written as a single high-order Lagrange cell, with as many subdivisions as the polynomial degree of the velocity,
+  // so that the cost scales with the number of active dofs. The processes are gathered in 'output_n_groups' compressed
+  // files, linked together by a pvtu record.
+  //
+  template<int dim>
+  void NavierStokesProjection<dim>::save_native_res() {
+    TimerOutput::Scope t(time_table, "Output results");
+
+    DataOut<dim> data_out;
+
+    std::vector<std::string> velocity_names(dim, "v");
+    std::vector<DataComponentInterpretation::DataComponentInterpretation>
+    component_interpretation_velocity(dim, DataComponentInterpretation::component_is_part_of_vector);
+    u_n.update_ghost_values();
+    data_out.add_data_vector(dof_handler_velocity, u_n, velocity_names, component_interpretation_velocity);
+    pres_n.update_ghost_values();
+    data_out.add_data_vector(dof_handler_pressure, pres_n, "p", {DataComponentInterpretation::component_is_scalar});
+    PostprocessorVorticity<dim> postprocessor;
+    data_out.add_data_vector(dof_handler_velocity, u_n, postprocessor);
+
+    DataOutBase::VtkFlags flags;
+    flags.write_higher_order_cells = true;
+    flags.compression_level        = DataOutBase::VtkFlags::best_speed;
+    data_out.set_flags(flags);
+
+    data_out.build_patches(MappingQ1<dim>(), EquationData::degree_p + 1, DataOut<dim>::curved_inner_cells);
+    data_out.write_vtu_with_pvtu_record("./" + saving_dir + "/", "solution_native_res_end", 0, MPI_COMM_WORLD, 1, output_n_groups);
+  }
+
+
+  // @sect{ <code>NavierStokesProjection::save_checkpoint</code> and <code>NavierStokesProjection::load_checkpoint</code>}
+
+  // The checkpoint contains the adaptive triangulation, with the velocities and the pressure attached as in
+  // <code>refine_mesh</code>, together with a small metadata file with time, step number, time step and TR-BDF2 stage.
+  // The data are written by p4est through MPI-IO in a format that does not depend on the partitioning, so that the
+  // simulation can be resumed with a different number of processes. To avoid that a crash during the writing destroys
+  // the previous checkpoint, we first save under a temporary name and then rename the files.
+  //
+  template<int dim>
+  void NavierStokesProjection<dim>::save_checkpoint(const double time, const unsigned int n) {
+    TimerOutput::Scope t(time_table, "Save checkpoint");
+
+    const std::string filename     = "./" + saving_dir + "/checkpoint";
+    const std::string filename_tmp = filename + "_tmp";
+
+    std::vector<const LinearAlgebra::distributed::Vector<double>*> velocities;
+    velocities.push_back(&u_n);
+    velocities.push_back(&u_n_minus_1);
+    parallel::distributed::SolutionTransfer<dim, LinearAlgebra::distributed::Vector<double>>
+    solution_transfer_velocity(dof_handler_velocity);
+    solution_transfer_velocity.prepare_for_serialization(velocities);
+    parallel::distributed::SolutionTransfer<dim, LinearAlgebra::distributed::Vector<double>>
+    solution_transfer_pressure(dof_handler_pressure);
+    solution_transfer_pressure.prepare_for_serialization(pres_n);
+
+    triangulation.save(filename_tmp);
+
+    if(Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0) {
+      std::ofstream metadata(filename_tmp + ".metadata");
+      metadata.precision(16);
+      metadata << time << " " << n << " " << dt << " " << TR_BDF2_stage << std::endl;
+      metadata.close();
+
+      for(const std::string& suffix : {"", ".info", "_fixed.data", "_variable.data", ".metadata"}) {
+        std::ifstream exists(filename_tmp + suffix);
+        if(exists) {
+          exists.close();
+          std::rename((filename_tmp + suffix).c_str(), (filename + suffix).c_str());
+        }
+      }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+  }
+
+
+  // The restart reads the metadata, loads the triangulation on the coarse mesh built by <code>create_triangulation</code>,
+  // sets up the finite element spaces and finally deserializes the vectors in the same order they were attached.
+  //
+  template<int dim>
+  void NavierStokesProjection<dim>::load_checkpoint() {
+    TimerOutput::Scope t(time_table, "Load checkpoint");
+
+    const std::string filename = "./" + saving_dir + "/checkpoint";
+
+    std::ifstream metadata(filename + ".metadata");
+    AssertThrow(metadata, ExcFileNotOpen(filename + ".metadata"));
+    metadata >> time_restart >> n_restart >> dt >> TR_BDF2_stage;
+    AssertThrow(metadata, ExcMessage("The checkpoint metadata in " + filename + ".metadata are corrupted"));
+
+    pcout << "Restarting from time " << time_restart << " (step " << n_restart << ")" << std::endl;
+
+    triangulation.load(filename);
+    setup_dofs();
+
+    navier_stokes_matrix.set_dt(dt);
+    navier_stokes_matrix.set_TR_BDF2_stage(TR_BDF2_stage);
+    if(mixed_precision) {
+      navier_stokes_matrix_float.set_dt(dt);
+      navier_stokes_matrix_float.set_TR_BDF2_stage(TR_BDF2_stage);
+    }
+
+    std::vector<LinearAlgebra::distributed::Vector<double>*> velocities;
+    velocities.push_back(&u_n);
+    velocities.push_back(&u_n_minus_1);
+    parallel::distributed::SolutionTransfer<dim, LinearAlgebra::distributed::Vector<double>>
+    solution_transfer_velocity(dof_handler_velocity);
+    solution_transfer_velocity.deserialize(velocities);
+    parallel::distributed::SolutionTransfer<dim, LinearAlgebra::distributed::Vector<double>>
+    solution_transfer_pressure(dof_handler_pressure);
+    solution_transfer_pressure.deserialize(pres_n);
+
+    u_n.update_ghost_values();
+    u_n_minus_1.update_ghost_values();
+    pres_n.update_ghost_values();
+  }
+
+
   // @sect{ <code>NavierStokesProjection::run</code> }
 
+  // For regression tests and scaling studies we also write the data of the time table in a machine-readable
+  // form, together with the problem size, the solver iterations and the peak resident memory, to the file
+  // <code>benchmark.csv</code> in the output directory, with one <code>step,quantity,value</code> entry per line.
+  //
+  template<int dim>
+  void NavierStokesProjection<dim>::write_benchmark_data(const unsigned int n) const {
+    const auto wall_times = time_table.get_summary_data(TimerOutput::total_wall_time);
+    const auto n_calls    = time_table.get_summary_data(TimerOutput::n_calls);
+
+    /*--- Times are the maximum over all processes and the memory is the one of the largest process ---*/
+    /*--- All sections of the time table are entered by all processes together. The probes in particular are
+          recorded by all of them, since their values are averaged over the processes that find them. Each
+          process therefore reduces over the same sections in the same order. ---*/
+    Assert(Utilities::MPI::min(static_cast<unsigned int>(wall_times.size()), MPI_COMM_WORLD) ==
+           Utilities::MPI::max(static_cast<unsigned int>(wall_times.size()), MPI_COMM_WORLD),
+           ExcMessage("All processes need to have entered the same timer sections."));
+    std::map<std::string, double> max_wall_times, max_n_calls;
+    for(const auto& section : wall_times) {
+      max_wall_times[section.first] = Utilities::MPI::max(section.second, MPI_COMM_WORLD);
+      max_n_calls[section.first]    = Utilities::MPI::max(n_calls.at(section.first), MPI_COMM_WORLD);
+    }
+
+    Utilities::System::MemoryStats stats;
+    Utilities::System::get_memory_stats(stats);
+    const double peak_memory = Utilities::MPI::max(static_cast<double>(stats.VmHWM), MPI_COMM_WORLD);
+
+    if(Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0) {
+      std::ofstream output("./" + saving_dir + "/benchmark.csv");
+      output << "step,quantity,value" << std::endl
+             << n << ",n_mpi_processes," << Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD) << std::endl
+             << n << ",n_dofs_velocity," << dof_handler_velocity.n_dofs() << std::endl
+             << n << ",n_dofs_pressure," << dof_handler_pressure.n_dofs() << std::endl
+             << n << ",n_iterations_velocity," << n_iterations_velocity << std::endl
+             << n << ",n_iterations_pressure," << n_iterations_pressure << std::endl
+             << n << ",peak_resident_memory_kB," << peak_memory << std::endl;
+      for(const auto& section : max_wall_times)
+        output << n << ",wall_time:" << section.first << ',' << section.second << std::endl
+               << n << ",n_calls:" << section.first << ',' << max_n_calls.at(section.first) << std::endl;
+    }
+  }
+
+
   // This is the time marching function, which starting at <code>t_0</code>
   // advances in time using the projection method with time step <code>dt</code>
   // until <code>T</code>.
@@ -2919,9 +3505,14 @@ namespace NS_TRBDF2 {
   void NavierStokesProjection<dim>::run(const bool verbose, const unsigned int output_interval) {
     ConditionalOStream verbose_cout(std::cout, verbose && Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0);
 
-    output_results(1);
     double time = t_0 + dt;
     unsigned int n = 1;
+    if(restart) {
+      time = time_restart;
+      n    = n_restart;
+    }
+    else
+      output_results(1);
     while(std::abs(T - time) > 1e-10) {
       time += dt;
       n++;
@@ -2930,51 +3521,51 @@ namespace NS_TRBDF2 {
       /*--- First stage of TR-BDF2 and we start by setting the proper flag ---*/
       TR_BDF2_stage = 1;
       navier_stokes_matrix.set_TR_BDF2_stage(TR_BDF2_stage);
-      for(unsigned int level = 0; level < triangulation.n_global_levels(); ++level)
+      if(mixed_precision)
+        navier_stokes_matrix_float.set_TR_BDF2_stage(TR_BDF2_stage);
+      for(unsigned int level = 0; level < triangulation.n_global_levels(); ++level) {
         mg_matrices[level].set_TR_BDF2_stage(TR_BDF2_stage);
-
-      verbose_cout << "  Interpolating the velocity stage 1" << std::endl;
-      interpolate_velocity();
+        if(mg_velocity)
+          mg_matrices_velocity[level].set_TR_BDF2_stage(TR_BDF2_stage);
+      }
 
       verbose_cout << "  Diffusion Step stage 1 " << std::endl;
       diffusion_step();
 
       verbose_cout << "  Projection Step stage 1" << std::endl;
       project_grad(1);
-      u_tmp.equ(gamma*dt, u_tmp);
-      u_star += u_tmp; /*--- In the rhs of the projection step we need u_star + gamma*dt*grad(pres_n) and we save it into u_star ---*/
+      u_star.add(gamma*dt, u_tmp); /*--- In the rhs of the projection step we need u_star + gamma*dt*grad(pres_n) and we save it into u_star ---*/
       projection_step();
 
       verbose_cout << "  Updating the Velocity stage 1" << std::endl;
-      u_n_gamma.equ(1.0, u_star);
       project_grad(2);
-      grad_pres_int.equ(1.0, u_tmp); /*--- We save grad(pres_int), because we will need it soon ---*/
-      u_tmp.equ(-gamma*dt, u_tmp);
-      u_n_gamma += u_tmp; /*--- u_n_gamma = u_star - gamma*dt*grad(pres_int) ---*/
+      grad_pres_int.swap(u_tmp); /*--- We save grad(pres_int), because we will need it soon (u_tmp is overwritten anyway) ---*/
+      u_n_gamma = u_star;
+      u_n_gamma.add(-gamma*dt, grad_pres_int); /*--- u_n_gamma = u_star - gamma*dt*grad(pres_int) ---*/
       u_n_minus_1 = u_n;
 
       /*--- Second stage of TR-BDF2 ---*/
       TR_BDF2_stage = 2;
-      for(unsigned int level = 0; level < triangulation.n_global_levels(); ++level)
+      for(unsigned int level = 0; level < triangulation.n_global_levels(); ++level) {
         mg_matrices[level].set_TR_BDF2_stage(TR_BDF2_stage);
+        if(mg_velocity)
+          mg_matrices_velocity[level].set_TR_BDF2_stage(TR_BDF2_stage);
+      }
       navier_stokes_matrix.set_TR_BDF2_stage(TR_BDF2_stage);
-
-      verbose_cout << "  Interpolating the velocity stage 2" << std::endl;
-      interpolate_velocity();
+      if(mixed_precision)
+        navier_stokes_matrix_float.set_TR_BDF2_stage(TR_BDF2_stage);
 
       verbose_cout << "  Diffusion Step stage 2 " << std::endl;
       diffusion_step();
 
       verbose_cout << "  Projection Step stage 2" << std::endl;
-      u_tmp.equ((1.0 - gamma)*dt, grad_pres_int);
-      u_star += u_tmp;  /*--- In the rhs of the projection step we need u_star + (1 - gamma)*dt*grad(pres_int) ---*/
+      u_star.add((1.0 - gamma)*dt, grad_pres_int);  /*--- In the rhs of the projection step we need u_star + (1 - gamma)*dt*grad(pres_int) ---*/
       projection_step();
 
       verbose_cout << "  Updating the Velocity stage 2" << std::endl;
-      u_n.equ(1.0, u_star);
       project_grad(1);
-      u_tmp.equ((gamma - 1.0)*dt, u_tmp);
-      u_n += u_tmp;  /*--- u_n = u_star - (1 - gamma)*dt*grad(pres_n) ---*/
+      u_n = u_star;
+      u_n.add((gamma - 1.0)*dt, u_tmp);  /*--- u_n = u_star - (1 - gamma)*dt*grad(pres_n) ---*/
 
       const double max_vel = get_maximal_velocity();
       pcout<< "Maximal velocity = " << max_vel << std::endl;
@@ -2982,6 +3573,7 @@ namespace NS_TRBDF2 {
       pcout << "CFL = " << dt*max_vel*(EquationData::degree_p + 1)*
                            std::sqrt(dim)/GridTools::minimal_cell_diameter(triangulation) << std::endl;
       compute_lift_and_drag();
+      record_probes(time);
       if(n % output_interval == 0) {
         verbose_cout << "Plotting Solution final" << std::endl;
         output_results(n);
@@ -2990,24 +3582,39 @@ namespace NS_TRBDF2 {
       if(T - time < dt && T - time > 1e-10) {
         dt = T - time;
         navier_stokes_matrix.set_dt(dt);
-        for(unsigned int level = 0; level < triangulation.n_global_levels(); ++level)
+        if(mixed_precision)
+          navier_stokes_matrix_float.set_dt(dt);
+        for(unsigned int level = 0; level < triangulation.n_global_levels(); ++level) {
           mg_matrices[level].set_dt(dt);
+          if(mg_velocity)
+            mg_matrices_velocity[level].set_dt(dt);
+        }
       }
       /*--- Perform the refinement if desired ---*/
       if(refinement_iterations > 0 && n % refinement_iterations == 0) {
         verbose_cout << "Refining mesh" << std::endl;
         refine_mesh();
       }
+      /*--- Save the state if desired ---*/
+      if(checkpoint_interval > 0 && n % checkpoint_interval == 0) {
+        verbose_cout << "Saving checkpoint" << std::endl;
+        save_checkpoint(time, n);
+      }
     }
     if(n % output_interval != 0) {
       verbose_cout << "Plotting Solution final" << std::endl;
       output_results(n);
     }
     if(refinement_iterations > 0) {
-      for(unsigned int lev = 0; lev < triangulation.n_global_levels() - 1; ++ lev)
-        interpolate_max_res(lev);
-      save_max_res();
+      if(native_final_output)
+        save_native_res();
+      else {
+        for(unsigned int lev = 0; lev < triangulation.n_global_levels() - 1; ++ lev)
+          interpolate_max_res(lev);
+        save_max_res();
+      }
     }
+    write_benchmark_data(n);
   }
 
 } // namespace NS_TRBDF2
@@ -3025,6 +3632,9 @@ int main(int argc, char *argv[]) {
 
     RunTimeParameters::Data_Storage data;
     data.read_data("parameter-file.prm");
+    /*--- An optional argument replaces the number of refinements, e.g. for the problem sizes of scaling studies ---*/
+    if(argc > 1)
+      data.n_refines = Utilities::string_to_int(argv[1]);
 
     Utilities::MPI::MPI_InitFinalize mpi_init(argc, argv, -1);
 
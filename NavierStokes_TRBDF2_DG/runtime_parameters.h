@@ -1,6 +1,7 @@
 // We start by including all the necessary deal.II header files
 //
 #include <deal.II/base/parameter_handler.h>
+#include <deal.II/base/utilities.h>
 
 // @sect{Run time parameters}
 //
@@ -30,6 +31,8 @@ namespace RunTimeParameters {
     /*--- Parameters related to the linear solver ---*/
     unsigned int max_iterations;
     double       eps;
+    bool         mg_velocity; /*--- Use geometric multigrid instead of Jacobi for the momentum predictor ---*/
+    bool         mixed_precision; /*--- Apply the fine level operators in single precision inside a double refinement loop ---*/
 
     bool         verbose;
     unsigned int output_interval;
@@ -38,6 +41,14 @@ namespace RunTimeParameters {
 
     unsigned int refinement_iterations; /*--- Auxiliary variable about how many steps perform remeshing ---*/
 
+    unsigned int checkpoint_interval; /*--- How many steps between two checkpoints (0 means no checkpoint) ---*/
+    bool         restart;             /*--- Resume the simulation from the checkpoint in the saving directory ---*/
+
+    std::vector<std::vector<double>> probe_points; /*--- Coordinates of the points where velocity and pressure are recorded ---*/
+
+    bool         native_final_output; /*--- Write the final solution on the adaptive mesh instead of the maximal resolution one ---*/
+    unsigned int output_n_groups;     /*--- Number of files for the final output on the adaptive mesh (0 = one per process) ---*/
+
   protected:
     ParameterHandler prm;
   };
@@ -53,9 +64,15 @@ namespace RunTimeParameters {
                                 min_loc_refinements(0),
                                 max_iterations(1000),
                                 eps(1e-12),
+                                mg_velocity(false),
+                                mixed_precision(false),
                                 verbose(true),
                                 output_interval(15),
-                                refinement_iterations(0) {
+                                refinement_iterations(0),
+                                checkpoint_interval(0),
+                                restart(false),
+                                native_final_output(false),
+                                output_n_groups(1) {
     prm.enter_subsection("Physical data");
     {
       prm.declare_entry("initial_time",
@@ -109,6 +126,15 @@ namespace RunTimeParameters {
                         "1e-12",
                         Patterns::Double(0.0),
                         " The stopping criterion. ");
+      prm.declare_entry("velocity_preconditioner",
+                        "Jacobi",
+                        Patterns::Selection("Jacobi|Multigrid"),
+                        " The preconditioner for the momentum predictor. ");
+      prm.declare_entry("mixed_precision",
+                        "false",
+                        Patterns::Bool(),
+                        " Solve the momentum predictor and the gradient projection with a float operator "
+                        " inside an iterative refinement loop in double precision. ");
     }
     prm.leave_subsection();
 
@@ -120,6 +146,37 @@ namespace RunTimeParameters {
 
     prm.declare_entry("saving directory", "SimTest");
 
+    prm.declare_entry("checkpoint_interval",
+                      "0",
+                      Patterns::Integer(0),
+                      " This number indicates how often we save a checkpoint "
+                      "of the simulation (0 disables checkpointing). ");
+
+    prm.declare_entry("restart",
+                      "false",
+                      Patterns::Bool(),
+                      " This indicates whether the simulation has to be resumed "
+                      "from the checkpoint in the saving directory. ");
+
+    prm.declare_entry("probe_points",
+                      "",
+                      Patterns::Anything(),
+                      " A list of points where velocity and pressure are recorded at each time step, "
+                      "with coordinates separated by commas and points separated by semicolons. ");
+
+    prm.declare_entry("final_output",
+                      "max_res",
+                      Patterns::Selection("max_res|native"),
+                      " The final solution with local refinement can be written by refining globally "
+                      "to the maximal resolution (max_res) or directly on the adaptive mesh with "
+                      "high-order cells (native). ");
+
+    prm.declare_entry("output_n_groups",
+                      "1",
+                      Patterns::Integer(0),
+                      " Number of files in which the processes collect the final native output "
+                      "(0 means one file per process). ");
+
     prm.declare_entry("verbose",
                       "true",
                       Patterns::Bool(),
@@ -167,6 +224,8 @@ namespace RunTimeParameters {
     {
       max_iterations = prm.get_integer("max_iterations");
       eps            = prm.get_double("eps");
+      mg_velocity    = (prm.get("velocity_preconditioner") == "Multigrid");
+      mixed_precision = prm.get_bool("mixed_precision");
     }
     prm.leave_subsection();
 
@@ -174,6 +233,16 @@ namespace RunTimeParameters {
 
     refinement_iterations = prm.get_integer("refinement_iterations");
 
+    checkpoint_interval = prm.get_integer("checkpoint_interval");
+    restart             = prm.get_bool("restart");
+
+    native_final_output = (prm.get("final_output") == "native");
+    output_n_groups     = prm.get_integer("output_n_groups");
+
+    probe_points.clear();
+    for(const auto& point : Utilities::split_string_list(prm.get("probe_points"), ';'))
+      probe_points.push_back(Utilities::string_to_double(Utilities::split_string_list(point, ',')));
+
     verbose = prm.get_bool("verbose");
 
     output_interval = prm.get_integer("output_interval");
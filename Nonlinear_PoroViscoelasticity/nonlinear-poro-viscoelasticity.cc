@@ -56,6 +56,7 @@
 #include <deal.II/fe/fe_system.h>
 #include <deal.II/fe/fe_tools.h>
 #include <deal.II/fe/fe_values.h>
+#include <deal.II/fe/mapping_q1.h>
 
 #include <deal.II/lac/block_sparsity_pattern.h>
 #include <deal.II/lac/affine_constraints.h>
@@ -63,6 +64,8 @@
 #include <deal.II/lac/full_matrix.h>
 #include <deal.II/lac/linear_operator.h>
 #include <deal.II/lac/packaged_operation.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/solver_gmres.h>
 
 #include <deal.II/lac/trilinos_block_sparse_matrix.h>
 #include <deal.II/lac/trilinos_linear_operator.h>
@@ -90,6 +93,7 @@
 #include <fstream>
 #include <numeric>
 #include <iomanip>
+#include <set>
 
 
 // We create a namespace for everything that relates to
@@ -471,12 +475,20 @@ namespace NonLinearPoroViscoElasticity
 
 // We now define the tolerances and the maximum number of iterations for the
 // Newton-Raphson scheme used to solve the nonlinear system of governing equations.
+// We also choose how the tangent is computed: either from the element residual,
+// with every element DoF as an independent variable of the automatic
+// differentiation, or from the constitutive response at each quadrature point,
+// in which case only the deformation gradient, the pore pressure and its
+// gradient are independent variables and the contraction with the shape
+// functions is done with plain doubles. Both give the same tangent, the
+// second one at a fraction of the cost; the first one is kept for verification.
       struct NonlinearSolver
       {
         unsigned int max_iterations_NR;
         double       tol_f;
         double       tol_u;
         double       tol_p_fluid;
+        std::string  ad_level;
 
         static void
         declare_parameters(ParameterHandler &prm);
@@ -504,6 +516,12 @@ namespace NonLinearPoroViscoElasticity
           prm.declare_entry("Tolerance pore pressure", "1.0e-6",
                             Patterns::Double(0.0),
                             "Pore pressure error tolerance");
+
+          prm.declare_entry("Automatic differentiation level", "quadrature point",
+                            Patterns::Selection("element|quadrature point"),
+                            "Linearise the residual with respect to all the element DoFs, "
+                            "or only the constitutive response with respect to the deformation "
+                            "gradient and the pore pressure at each quadrature point.");
         }
         prm.leave_subsection();
       }
@@ -516,6 +534,60 @@ namespace NonLinearPoroViscoElasticity
           tol_f = prm.get_double("Tolerance force");
           tol_u = prm.get_double("Tolerance displacement");
           tol_p_fluid =  prm.get_double("Tolerance pore pressure");
+          ad_level = prm.get("Automatic differentiation level");
+        }
+        prm.leave_subsection();
+      }
+
+// @sect4{Linear solver}
+
+// Next, we choose how the linearised system is solved at each Newton-Raphson
+// iteration. The direct solver factorises a non-block copy of the tangent
+// matrix, which is robust but whose memory requirements grow quickly in 3d.
+// The iterative solver works directly on the block system and uses FGMRES
+// with a block upper-triangular preconditioner: an AMG cycle for the
+// displacement block and an AMG cycle for an approximation of the pore
+// pressure Schur complement, which is built from the Darcy flow matrix and a
+// pressure mass matrix scaled by the drained stiffness of the solid.
+      struct LinearSolver
+      {
+        std::string type_lin;
+        double      tol_lin;
+        double      max_iterations_lin;
+
+        static void
+        declare_parameters(ParameterHandler &prm);
+
+        void
+        parse_parameters(ParameterHandler &prm);
+      };
+
+      void LinearSolver::declare_parameters(ParameterHandler &prm)
+      {
+        prm.enter_subsection("Linear solver");
+        {
+          prm.declare_entry("Solver type", "Direct",
+                            Patterns::Selection("Direct|Iterative"),
+                            "Type of solver used to solve the linear system");
+
+          prm.declare_entry("Residual", "1e-6",
+                            Patterns::Double(0.0),
+                            "Linear solver residual (scaled by residual norm)");
+
+          prm.declare_entry("Max iteration multiplier", "1",
+                            Patterns::Double(0.0),
+                            "Linear solver iterations (multiples of the system matrix size)");
+        }
+        prm.leave_subsection();
+      }
+
+      void LinearSolver::parse_parameters(ParameterHandler &prm)
+      {
+        prm.enter_subsection("Linear solver");
+        {
+          type_lin = prm.get("Solver type");
+          tol_lin = prm.get_double("Residual");
+          max_iterations_lin = prm.get_double("Max iteration multiplier");
         }
         prm.leave_subsection();
       }
@@ -611,6 +683,7 @@ namespace NonLinearPoroViscoElasticity
                              public Geometry,
                              public Materials,
                              public NonlinearSolver,
+                             public LinearSolver,
                              public Time,
                              public OutputParam
       {
@@ -637,6 +710,7 @@ namespace NonLinearPoroViscoElasticity
         Geometry::declare_parameters(prm);
         Materials::declare_parameters(prm);
         NonlinearSolver::declare_parameters(prm);
+        LinearSolver::declare_parameters(prm);
         Time::declare_parameters(prm);
         OutputParam::declare_parameters(prm);
       }
@@ -647,6 +721,7 @@ namespace NonLinearPoroViscoElasticity
         Geometry::parse_parameters(prm);
         Materials::parse_parameters(prm);
         NonlinearSolver::parse_parameters(prm);
+        LinearSolver::parse_parameters(prm);
         Time::parse_parameters(prm);
         OutputParam::parse_parameters(prm);
       }
@@ -1429,6 +1504,47 @@ namespace NonLinearPoroViscoElasticity
             std::shared_ptr< Material_Darcy_Fluid<dim, NumberType> > fluid_material;
     };
 
+// @sect3{Block preconditioner for the linearised system}
+// The linearised system has the block structure
+// $\begin{bmatrix} K_{uu} & K_{up} \\ K_{pu} & K_{pp} \end{bmatrix}$,
+// where $K_{pp}$ stems from the Darcy flow. We precondition it from the right
+// with the inverse of the block upper-triangular matrix
+// $\begin{bmatrix} K_{uu} & K_{up} \\ 0 & \tilde S \end{bmatrix}$, where
+// $\tilde S$ approximates the Schur complement
+// $K_{pp} - K_{pu} K_{uu}^{-1} K_{up}$ and both inverses are replaced by one
+// AMG cycle each. Applying the preconditioner only needs the off-diagonal
+// block $K_{up}$ of the tangent matrix itself, so no copies of the block
+// system are made.
+    class BlockTriangularPreconditioner : public Subscriptor
+    {
+        public:
+          BlockTriangularPreconditioner
+              (const TrilinosWrappers::SparseMatrix     &K_up,
+               const TrilinosWrappers::PreconditionAMG &preconditioner_K_uu,
+               const TrilinosWrappers::PreconditionAMG &preconditioner_S)
+           :
+           K_up(K_up),
+           preconditioner_K_uu(preconditioner_K_uu),
+           preconditioner_S(preconditioner_S)
+          {}
+
+          void vmult (TrilinosWrappers::MPI::BlockVector       &dst,
+                      const TrilinosWrappers::MPI::BlockVector &src) const
+          {
+              preconditioner_S.vmult(dst.block(1), src.block(1));
+
+              TrilinosWrappers::MPI::Vector tmp (src.block(0));
+              K_up.vmult(tmp, dst.block(1));
+              tmp.sadd(-1.0, src.block(0));
+              preconditioner_K_uu.vmult(dst.block(0), tmp);
+          }
+
+        private:
+          const TrilinosWrappers::SparseMatrix     &K_up;
+          const TrilinosWrappers::PreconditionAMG &preconditioner_K_uu;
+          const TrilinosWrappers::PreconditionAMG &preconditioner_S;
+    };
+
 // @sect3{Nonlinear poro-viscoelastic solid}
 // The Solid class is the central class as it represents the problem at hand:
 // the nonlinear poro-viscoelastic solid
@@ -1455,6 +1571,9 @@ namespace NonLinearPoroViscoElasticity
             //Define points for post-processing
             virtual void define_tracked_vertices(std::vector<Point<dim> > &tracked_vertices) = 0;
 
+            //Locate the tracked points and the output boundaries on the current mesh
+            void setup_output_locations(const std::vector<Point<dim> > &tracked_vertices);
+
             //Set up the finite element system to be solved:
             void system_setup(TrilinosWrappers::MPI::BlockVector &solution_delta_OUT);
 
@@ -1468,6 +1587,13 @@ namespace NonLinearPoroViscoElasticity
                   (const typename DoFHandler<dim>::active_cell_iterator &cell,
                    ScratchData_ASM<ADNumberType> &scratch,
                    PerTaskData_ASM &data) const;
+            void assemble_system_one_cell_qp_ad
+                  (const typename DoFHandler<dim>::active_cell_iterator &cell,
+                   ScratchData_ASM<ADNumberType> &scratch,
+                   PerTaskData_ASM &data) const;
+            void assemble_schur_complement_one_cell
+                  (const FEValues<dim> &fe_values,
+                   PerTaskData_ASM &data) const;
             void copy_local_to_global_system(const PerTaskData_ASM &data);
 
             // Define boundary conditions
@@ -1494,9 +1620,12 @@ namespace NonLinearPoroViscoElasticity
             //Solve non-linear system using a Newton-Raphson scheme
             void solve_nonlinear_timestep(TrilinosWrappers::MPI::BlockVector &solution_delta_OUT);
 
-            //Solve the linearized equations using a direct solver
+            //Solve the linearized equations using a direct or an iterative solver
             void solve_linear_system ( TrilinosWrappers::MPI::BlockVector &newton_update_OUT);
 
+            // Write timer sections, problem size, solver iterations and memory use in machine-readable form
+            void write_benchmark_data() const;
+
             //Retrieve the  solution
             TrilinosWrappers::MPI::BlockVector
             get_total_solution(const TrilinosWrappers::MPI::BlockVector &solution_delta_IN) const;
@@ -1514,6 +1643,24 @@ namespace NonLinearPoroViscoElasticity
                                         std::vector<Point<dim> > &tracked_vertices,
                                         std::ofstream &pointfile) const;
 
+            // Data needed to evaluate the solution at a tracked point: the cell
+            // containing the point, and the values of all shape functions at the
+            // point, arranged per vector component. Only the process owning the
+            // cell evaluates the solution there.
+            struct TrackedPoint
+            {
+              typename DoFHandler<dim>::active_cell_iterator cell;
+              bool                                          is_locally_owned;
+              std::vector<types::global_dof_index>          local_dof_indices;
+              FullMatrix<double>                            shape_values;
+            };
+            std::vector<TrackedPoint> tracked_points;
+
+            // Locally owned cell faces on the boundaries used for the reaction
+            // force and the total fluid flow outputs
+            std::vector<std::pair<typename DoFHandler<dim>::active_cell_iterator, unsigned int> >
+            reaction_faces, drained_faces;
+
             // Headers and footer for the output files
             void print_console_file_header( std::ofstream &outfile) const;
             void print_plot_file_header(std::vector<Point<dim> > &tracked_vertices,
@@ -1538,6 +1685,9 @@ namespace NonLinearPoroViscoElasticity
             TimerOutput   timerconsole;
             TimerOutput   timerfile;
 
+            // Total number of iterations of the iterative linear solver
+            unsigned int  n_iterations_lin;
+
             // A storage object for quadrature point information.
             CellDataStorage<typename Triangulation<dim>::cell_iterator, PointHistory<dim,ADNumberType> > quadrature_point_history;
 
@@ -1610,6 +1760,7 @@ namespace NonLinearPoroViscoElasticity
             //Declare an instance of dealii classes necessary for FE system set-up and assembly
             //Store elements of tangent matrix (indicated by SparsityPattern class) as sparse matrix (more efficient)
             TrilinosWrappers::BlockSparseMatrix tangent_matrix;
+            //Approximation of the pore pressure Schur complement, stored in the pressure block (iterative solver only)
             TrilinosWrappers::BlockSparseMatrix tangent_matrix_preconditioner;
             //Right hand side vector of forces
             TrilinosWrappers::MPI::BlockVector  system_rhs;
@@ -1651,6 +1802,9 @@ namespace NonLinearPoroViscoElasticity
             Errors error_residual, error_residual_0, error_residual_norm, error_update,
                    error_update_0, error_update_norm;
 
+            // Stiffness of the drained solid skeleton, used to scale the pressure mass matrix in the Schur complement approximation
+            double get_drained_stiffness() const;
+
             // Methods to calculate error measures
             void get_error_residual(Errors &error_residual_OUT);
             void get_error_update
@@ -1686,6 +1840,7 @@ namespace NonLinearPoroViscoElasticity
                    outfile,
                    TimerOutput::summary,
                    TimerOutput::wall_times),
+        n_iterations_lin(0),
         degree_displ(parameters.poly_degree_displ),
         degree_pore(parameters.poly_degree_pore),
         fe( FE_Q<dim>(parameters.poly_degree_displ), dim,
@@ -1739,6 +1894,7 @@ namespace NonLinearPoroViscoElasticity
           //Define points for post-processing
           std::vector<Point<dim> > tracked_vertices (2);
           define_tracked_vertices(tracked_vertices);
+          setup_output_locations(tracked_vertices);
           std::vector<Point<dim>> reaction_force;
 
           if (this_mpi_process == 0)
@@ -1821,6 +1977,61 @@ namespace NonLinearPoroViscoElasticity
               //NOTE: ideally, we should close the outfile here [ >> outfile.close (); ]
               //But if we do, then the timer output will not be printed. That is why we leave it open.
           }
+
+          write_benchmark_data();
+    }
+
+//Write the data collected by the timer, together with the number of DoFs, the total number of linear
+//solver iterations and the peak resident memory, to "benchmark.csv" with one "step,quantity,value"
+//entry per line. The number of calls of the "Linear solver" section is the total number of Newton
+//iterations. Times are the maximum over all processes, and so is the memory.
+    template <int dim>
+    void Solid<dim>::write_benchmark_data() const
+    {
+          const std::map<std::string, double> wall_times
+            = timerconsole.get_summary_data(TimerOutput::total_wall_time);
+          const std::map<std::string, double> n_calls
+            = timerconsole.get_summary_data(TimerOutput::n_calls);
+
+          // The setup, assembly and linear solver sections of the timer are
+          // entered by all processes together, so each of them reduces over the
+          // same sections in the same order.
+          Assert(Utilities::MPI::min(static_cast<unsigned int>(wall_times.size()),
+                                     mpi_communicator) ==
+                 Utilities::MPI::max(static_cast<unsigned int>(wall_times.size()),
+                                     mpi_communicator),
+                 ExcMessage("All processors need to have entered the same timer "
+                            "sections."));
+          std::map<std::string, double> max_wall_times;
+          std::map<std::string, double> max_n_calls;
+          for (const auto &section : wall_times)
+            {
+              max_wall_times[section.first] =
+                Utilities::MPI::max(section.second, mpi_communicator);
+              max_n_calls[section.first] =
+                Utilities::MPI::max(n_calls.at(section.first), mpi_communicator);
+            }
+
+          Utilities::System::MemoryStats stats;
+          Utilities::System::get_memory_stats(stats);
+          const double peak_memory
+            = Utilities::MPI::max(static_cast<double>(stats.VmHWM), mpi_communicator);
+
+          if (this_mpi_process == 0)
+          {
+              const unsigned int step = time.get_timestep();
+              std::ofstream benchmark_file("benchmark.csv");
+              benchmark_file << "step,quantity,value" << std::endl
+                             << step << ",n_mpi_processes," << n_mpi_processes << std::endl
+                             << step << ",n_dofs," << dof_handler_ref.n_dofs() << std::endl
+                             << step << ",n_iterations_lin," << n_iterations_lin << std::endl
+                             << step << ",peak_resident_memory_kB," << peak_memory << std::endl;
+              for (const auto &section : max_wall_times)
+                benchmark_file << step << ",wall_time:" << section.first << ','
+                               << section.second << std::endl
+                               << step << ",n_calls:" << section.first << ','
+                               << max_n_calls.at(section.first) << std::endl;
+          }
     }
 
 // @sect4{Private interface}
@@ -1834,17 +2045,25 @@ namespace NonLinearPoroViscoElasticity
         Vector<double>            cell_rhs;
         std::vector<types::global_dof_index> local_dof_indices;
 
-        PerTaskData_ASM(const unsigned int dofs_per_cell)
+        //Pressure-pressure contribution to the Schur complement approximation
+        FullMatrix<double>        cell_matrix_schur;
+        std::vector<types::global_dof_index> local_dof_indices_p_fluid;
+
+        PerTaskData_ASM(const unsigned int dofs_per_cell,
+                        const unsigned int dofs_per_cell_p_fluid)
           :
           cell_matrix(dofs_per_cell, dofs_per_cell),
           cell_rhs(dofs_per_cell),
-          local_dof_indices(dofs_per_cell)
+          local_dof_indices(dofs_per_cell),
+          cell_matrix_schur(dofs_per_cell_p_fluid, dofs_per_cell_p_fluid),
+          local_dof_indices_p_fluid(dofs_per_cell_p_fluid)
         {}
 
         void reset()
         {
           cell_matrix = 0.0;
           cell_rhs = 0.0;
+          cell_matrix_schur = 0.0;
         }
     };
 
@@ -2114,19 +2333,43 @@ namespace NonLinearPoroViscoElasticity
         //Reinitialize the (sparse) tangent matrix with the given sparsity pattern.
         tangent_matrix.reinit (bsp);
 
+        //The Schur complement approximation only couples pressure DoFs,
+        //so we allocate entries for the pressure-pressure block only.
+        if (parameters.type_lin == "Iterative")
+        {
+          Table<2, DoFTools::Coupling> coupling_preconditioner(n_components, n_components);
+          for (unsigned int ii = 0; ii < n_components; ++ii)
+            for (unsigned int jj = 0; jj < n_components; ++jj)
+              if ((ii == p_fluid_component) && (jj == p_fluid_component))
+                coupling_preconditioner[ii][jj] = DoFTools::always;
+              else
+                coupling_preconditioner[ii][jj] = DoFTools::none;
+
+          TrilinosWrappers::BlockSparsityPattern bsp_preconditioner (locally_owned_partitioning,
+                                                                     mpi_communicator);
+          DoFTools::make_sparsity_pattern (dof_handler_ref, coupling_preconditioner,
+                                           bsp_preconditioner, constraints,
+                                           false, this_mpi_process);
+          bsp_preconditioner.compress();
+          tangent_matrix_preconditioner.reinit (bsp_preconditioner);
+        }
+
         //Initialize the right hand side and solution vectors with number of DoFs
         system_rhs.reinit(locally_owned_partitioning, mpi_communicator);
         solution_n.reinit(locally_owned_partitioning, mpi_communicator);
         solution_delta_OUT.reinit(locally_owned_partitioning, mpi_communicator);
 
-        // Non-block system
-        TrilinosWrappers::SparsityPattern sp (locally_owned_dofs,
-                                              mpi_communicator);
-        DoFTools::make_sparsity_pattern (dof_handler_ref, sp, constraints,
-                                         false, this_mpi_process);
-        sp.compress();
-        tangent_matrix_nb.reinit (sp);
-        system_rhs_nb.reinit(locally_owned_dofs, mpi_communicator);
+        // Non-block system, only required by the direct solver
+        if (parameters.type_lin == "Direct")
+        {
+          TrilinosWrappers::SparsityPattern sp (locally_owned_dofs,
+                                                mpi_communicator);
+          DoFTools::make_sparsity_pattern (dof_handler_ref, sp, constraints,
+                                           false, this_mpi_process);
+          sp.compress();
+          tangent_matrix_nb.reinit (sp);
+          system_rhs_nb.reinit(locally_owned_dofs, mpi_communicator);
+        }
 
         //Set up the quadrature point history
         setup_qph();
@@ -2236,8 +2479,13 @@ namespace NonLinearPoroViscoElasticity
             tangent_matrix = 0.0;
             system_rhs = 0.0;
 
-            tangent_matrix_nb = 0.0;
-            system_rhs_nb = 0.0;
+            if (parameters.type_lin == "Direct")
+            {
+              tangent_matrix_nb = 0.0;
+              system_rhs_nb = 0.0;
+            }
+            else
+              tangent_matrix_preconditioner = 0.0;
 
             //Apply boundary conditions
             make_constraints(newton_iteration);
@@ -2473,7 +2721,7 @@ namespace NonLinearPoroViscoElasticity
 
         //Setup a copy of the data structures required for the process and pass them, along with the
         //memory addresses of the assembly functions to the WorkStream object for processing
-        PerTaskData_ASM per_task_data(dofs_per_cell);
+        PerTaskData_ASM per_task_data(dofs_per_cell, element_indices_p_fluid.size());
         ScratchData_ASM<ADNumberType> scratch_data(fe, qf_cell, uf_cell,
                                                    qf_face, uf_face,
                                                    solution_total);
@@ -2488,21 +2736,30 @@ namespace NonLinearPoroViscoElasticity
             Assert(cell->is_locally_owned(), ExcInternalError());
             Assert(cell->subdomain_id() == this_mpi_process, ExcInternalError());
 
-            assemble_system_one_cell(cell, scratch_data, per_task_data);
+            if (parameters.ad_level == "element")
+              assemble_system_one_cell(cell, scratch_data, per_task_data);
+            else
+              assemble_system_one_cell_qp_ad(cell, scratch_data, per_task_data);
             copy_local_to_global_system(per_task_data);
           }
         tangent_matrix.compress(VectorOperation::add);
         system_rhs.compress(VectorOperation::add);
 
-        tangent_matrix_nb.compress(VectorOperation::add);
-        system_rhs_nb.compress(VectorOperation::add);
+        if (parameters.type_lin == "Direct")
+        {
+          tangent_matrix_nb.compress(VectorOperation::add);
+          system_rhs_nb.compress(VectorOperation::add);
+        }
+        else
+          tangent_matrix_preconditioner.compress(VectorOperation::add);
 
         timerconsole.leave_subsection();
         timerfile.leave_subsection();
     }
 
     //Add the local elemental contribution to the global stiffness tensor
-    // We do it twice, for the block and the non-block systems
+    // We do it twice, for the block system and either the non-block system
+    // (direct solver) or the Schur complement approximation (iterative solver)
     template <int dim>
     void Solid<dim>::copy_local_to_global_system (const PerTaskData_ASM &data)
     {
@@ -2512,11 +2769,16 @@ namespace NonLinearPoroViscoElasticity
             tangent_matrix,
             system_rhs);
 
-        constraints.distribute_local_to_global(data.cell_matrix,
-            data.cell_rhs,
-            data.local_dof_indices,
-            tangent_matrix_nb,
-            system_rhs_nb);
+        if (parameters.type_lin == "Direct")
+          constraints.distribute_local_to_global(data.cell_matrix,
+              data.cell_rhs,
+              data.local_dof_indices,
+              tangent_matrix_nb,
+              system_rhs_nb);
+        else
+          constraints.distribute_local_to_global(data.cell_matrix_schur,
+              data.local_dof_indices_p_fluid,
+              tangent_matrix_preconditioner);
     }
 
     //Compute stiffness matrix and corresponding rhs for one element
@@ -2740,6 +3002,298 @@ namespace NonLinearPoroViscoElasticity
             for (unsigned int j=0; j<dofs_per_cell; ++j)
               data.cell_matrix(i,j) += R_i.fastAccessDx(j);
           }
+
+        if (parameters.type_lin == "Iterative")
+          assemble_schur_complement_one_cell(scratch.fe_values_ref, data);
+    }
+
+    //Compute stiffness matrix and corresponding rhs for one element, using
+    //automatic differentiation only at the level of the constitutive laws.
+    //At each quadrature point the independent variables are the components
+    //of the deformation gradient $\mathbf{F}$, the pore pressure $p$ and its
+    //referential gradient $\nabla_0 p$. The residual depends on these only
+    //through the first Piola-Kirchhoff stress $\mathbf{P}$, the body force,
+    //the Jacobian $J$ and the pull-back $\mathbf{F}^{-1}\mathbf{w}$ of the
+    //seepage velocity. With the (double-valued) matrices $W$ holding the test
+    //function coefficients of each of these responses and $V$ holding the
+    //variation of the independent variables for each DoF, the local tangent
+    //is $W \, (\partial \text{response} / \partial \text{variables}) \, V$.
+    template <int dim>
+    void Solid<dim>::assemble_system_one_cell_qp_ad
+             (const typename DoFHandler<dim>::active_cell_iterator &cell,
+              ScratchData_ASM<ADNumberType>                        &scratch,
+              PerTaskData_ASM                                      &data) const
+    {
+        Assert(cell->is_locally_owned(), ExcInternalError());
+
+        data.reset();
+        scratch.fe_values_ref.reinit(cell);
+        cell->get_dof_indices(data.local_dof_indices);
+
+        // Update the quadrature point solution
+        std::vector<Tensor<2, dim> > solution_grads_u_total (n_q_points);
+        std::vector<double>          solution_values_p_fluid_total (n_q_points);
+        std::vector<Tensor<1, dim> > solution_grads_p_fluid_total (n_q_points);
+        scratch.fe_values_ref[u_fe].get_function_gradients
+            (scratch.solution_total, solution_grads_u_total);
+        scratch.fe_values_ref[p_fluid_fe].get_function_values
+            (scratch.solution_total, solution_values_p_fluid_total);
+        scratch.fe_values_ref[p_fluid_fe].get_function_gradients
+            (scratch.solution_total, solution_grads_p_fluid_total);
+
+        // Ordering of the independent variables and of the responses
+        const unsigned int F_index = 0;
+        const unsigned int p_index = dim*dim;
+        const unsigned int grad_p_index = p_index + 1;
+        const unsigned int n_independent_variables = grad_p_index + dim;
+
+        const unsigned int P_index = 0;
+        const unsigned int body_force_index = dim*dim;
+        const unsigned int det_F_index = body_force_index + dim;
+        const unsigned int seepage_index = det_F_index + 1;
+        const unsigned int n_responses = seepage_index + dim;
+
+        FullMatrix<double> W (dofs_per_cell, n_responses);
+        FullMatrix<double> V (n_independent_variables, dofs_per_cell);
+        FullMatrix<double> D (n_responses, n_independent_variables);
+        FullMatrix<double> DV (n_responses, dofs_per_cell);
+        Vector<double>     response_values (n_responses);
+        Vector<double>     residual (dofs_per_cell);
+
+        //Set up pointer "lgph" to the PointHistory object of this element
+        const std::vector<std::shared_ptr<const PointHistory<dim, ADNumberType> > >
+            lqph = quadrature_point_history.get_data(cell);
+        Assert(lqph.size() == n_q_points, ExcInternalError());
+
+        static const SymmetricTensor< 2, dim, double>
+            I (Physics::Elasticity::StandardTensors<dim>::I);
+
+        for (unsigned int q_point = 0; q_point < n_q_points; ++q_point)
+          {
+            // Setup automatic differentiation at the quadrature point
+            Tensor<2, dim, ADNumberType> F_AD;
+            for (unsigned int a = 0; a < dim; ++a)
+              for (unsigned int b = 0; b < dim; ++b)
+                {
+                  F_AD[a][b] = I[a][b] + solution_grads_u_total[q_point][a][b];
+                  F_AD[a][b].diff(F_index + a*dim + b, n_independent_variables);
+                }
+            ADNumberType p_fluid = solution_values_p_fluid_total[q_point];
+            p_fluid.diff(p_index, n_independent_variables);
+            Tensor<1, dim, ADNumberType> Grad_p;
+            for (unsigned int a = 0; a < dim; ++a)
+              {
+                Grad_p[a] = solution_grads_p_fluid_total[q_point][a];
+                Grad_p[a].diff(grad_p_index + a, n_independent_variables);
+              }
+
+            const ADNumberType det_F_AD = determinant(F_AD);
+            Assert(det_F_AD > 0, ExcMessage("Invalid deformation map"));
+            const Tensor<2, dim, ADNumberType> F_inv_AD = invert(F_AD);
+
+            {
+              PointHistory<dim, ADNumberType> *lqph_q_point_nc =
+                 const_cast<PointHistory<dim, ADNumberType>*>(lqph[q_point].get());
+              lqph_q_point_nc->update_internal_equilibrium(F_AD);
+            }
+
+            //Get some info from constitutive model of solid
+            const SymmetricTensor<2, dim, ADNumberType>
+                tau_E = lqph[q_point]->get_tau_E(F_AD);
+            SymmetricTensor<2, dim, ADNumberType> tau_fluid_vol (I);
+            tau_fluid_vol *= -1.0 * p_fluid * det_F_AD;
+            const Tensor<2, dim, ADNumberType> P_AD
+                = Tensor<2, dim, ADNumberType>(tau_E + tau_fluid_vol) * transpose(F_inv_AD);
+            const Tensor<1, dim, ADNumberType> overall_body_force
+                = lqph[q_point]->get_overall_body_force(F_AD, parameters);
+
+            //Get some info from constitutive model of fluid
+            const double det_F_converged = lqph[q_point]->get_converged_det_F();
+            const Tensor<1, dim, ADNumberType> grad_p = Grad_p * F_inv_AD;
+            const Tensor<1, dim, ADNumberType> seepage_vel_current
+                = lqph[q_point]->get_seepage_velocity_current(F_AD, grad_p);
+            const Tensor<1, dim, ADNumberType> seepage_vel_ref
+                = F_inv_AD * seepage_vel_current;
+
+            // Extract the values and the derivatives of the responses. Responses
+            // that do not depend on the independent variables (e.g. a vanishing
+            // body force) carry no derivatives, hence we use dx() rather than
+            // fastAccessDx().
+            std::vector<const ADNumberType *> responses (n_responses);
+            for (unsigned int a = 0; a < dim; ++a)
+              {
+                for (unsigned int b = 0; b < dim; ++b)
+                  responses[P_index + a*dim + b] = &P_AD[a][b];
+                responses[body_force_index + a] = &overall_body_force[a];
+                responses[seepage_index + a] = &seepage_vel_ref[a];
+              }
+            responses[det_F_index] = &det_F_AD;
+
+            for (unsigned int r = 0; r < n_responses; ++r)
+              {
+                response_values(r) = responses[r]->val();
+                for (unsigned int k = 0; k < n_independent_variables; ++k)
+                  D(r,k) = responses[r]->dx(k);
+              }
+
+            // Fill the test function coefficients and the variations of the
+            // independent variables for each DoF
+            const double JxW = scratch.fe_values_ref.JxW(q_point);
+            W = 0.0;
+            V = 0.0;
+            for (unsigned int i = 0; i < dofs_per_cell; ++i)
+              {
+                const unsigned int i_group = fe.system_to_base_index(i).first.first;
+
+                if (i_group == u_block)
+                  {
+                    const Tensor<1, dim> Nu
+                        = scratch.fe_values_ref[u_fe].value(i, q_point);
+                    const Tensor<2, dim> Grad_Nu
+                        = scratch.fe_values_ref[u_fe].gradient(i, q_point);
+                    for (unsigned int a = 0; a < dim; ++a)
+                      {
+                        for (unsigned int b = 0; b < dim; ++b)
+                          {
+                            W(i, P_index + a*dim + b) = Grad_Nu[a][b] * JxW;
+                            V(F_index + a*dim + b, i) = Grad_Nu[a][b];
+                          }
+                        W(i, body_force_index + a) = -Nu[a] * JxW;
+                      }
+                  }
+                else if (i_group == p_fluid_block)
+                  {
+                    const double Np
+                        = scratch.fe_values_ref[p_fluid_fe].value(i, q_point);
+                    const Tensor<1, dim> Grad_Np
+                        = scratch.fe_values_ref[p_fluid_fe].gradient(i, q_point);
+                    W(i, det_F_index) = Np * JxW;
+                    V(p_index, i) = Np;
+                    for (unsigned int a = 0; a < dim; ++a)
+                      {
+                        W(i, seepage_index + a) = -time.get_delta_t() * Grad_Np[a] * JxW;
+                        V(grad_p_index + a, i) = Grad_Np[a];
+                      }
+
+                    residual(i) -= Np * det_F_converged * JxW;
+                  }
+                else
+                  Assert(i_group <= p_fluid_block, ExcInternalError());
+              }
+
+            // Assemble the residual and the tangent
+            W.vmult(residual, response_values, true);
+            D.mmult(DV, V);
+            W.mmult(data.cell_matrix, DV, true);
+          }
+
+        // Assemble the Neumann contribution (external force contribution).
+        // The tractions and fluid flows are prescribed in the reference
+        // configuration, so they do not contribute to the tangent.
+        for (unsigned int face = 0; face < GeometryInfo<dim>::faces_per_cell; ++face)
+          {
+            if (cell->face(face)->at_boundary() == true)
+              {
+                scratch.fe_face_values_ref.reinit(cell, face);
+
+                for (unsigned int f_q_point = 0; f_q_point < n_q_points_f; ++f_q_point)
+                  {
+                    const Tensor<1, dim> &N
+                        = scratch.fe_face_values_ref.normal_vector(f_q_point);
+                    const Point<dim>     &pt
+                        = scratch.fe_face_values_ref.quadrature_point(f_q_point);
+                    const Tensor<1, dim> traction
+                        = get_neumann_traction(cell->face(face)->boundary_id(), pt, N);
+                    const double flow
+                        = get_prescribed_fluid_flow(cell->face(face)->boundary_id(), pt);
+
+                    if ( (traction.norm() < 1e-12) && (std::abs(flow) < 1e-12) ) continue;
+
+                    const double JxW_f = scratch.fe_face_values_ref.JxW(f_q_point);
+
+                    for (unsigned int i = 0; i < dofs_per_cell; ++i)
+                      {
+                        const unsigned int i_group = fe.system_to_base_index(i).first.first;
+
+                        if ((i_group == u_block) && (traction.norm() > 1e-12))
+                        {
+                            const unsigned int component_i
+                              = fe.system_to_component_index(i).first;
+                            const double Nu_f
+                              = scratch.fe_face_values_ref.shape_value(i, f_q_point);
+                            residual(i) -= (Nu_f * traction[component_i]) * JxW_f;
+                        }
+                        if ((i_group == p_fluid_block) && (std::abs(flow) > 1e-12))
+                        {
+                            const double Nu_p
+                              = scratch.fe_face_values_ref.shape_value(i, f_q_point);
+                            residual(i) -= (Nu_p * flow) * JxW_f;
+                        }
+                      }
+                  }
+              }
+          }
+
+        for (unsigned int i = 0; i < dofs_per_cell; ++i)
+          data.cell_rhs(i) -= residual(i);
+
+        if (parameters.type_lin == "Iterative")
+          assemble_schur_complement_one_cell(scratch.fe_values_ref, data);
+    }
+
+    // Assemble the Schur complement approximation for the iterative solver:
+    // the pressure-pressure block of the tangent (Darcy flow term) plus
+    // the pressure mass matrix scaled by the drained stiffness of the solid,
+    // which approximates the contribution of the displacement block.
+    template <int dim>
+    void Solid<dim>::assemble_schur_complement_one_cell
+             (const FEValues<dim> &fe_values,
+              PerTaskData_ASM     &data) const
+    {
+        const double inv_drained_stiffness = 1.0/get_drained_stiffness();
+        const unsigned int n_dofs_p_fluid = element_indices_p_fluid.size();
+
+        for (unsigned int I = 0; I < n_dofs_p_fluid; ++I)
+          {
+            const unsigned int i = element_indices_p_fluid[I];
+            data.local_dof_indices_p_fluid[I] = data.local_dof_indices[i];
+            for (unsigned int J = 0; J < n_dofs_p_fluid; ++J)
+              {
+                const unsigned int j = element_indices_p_fluid[J];
+                data.cell_matrix_schur(I,J) = data.cell_matrix(i,j);
+                for (unsigned int q_point = 0; q_point < n_q_points; ++q_point)
+                  data.cell_matrix_schur(I,J)
+                    += inv_drained_stiffness
+                       * fe_values[p_fluid_fe].value(i, q_point)
+                       * fe_values[p_fluid_fe].value(j, q_point)
+                       * fe_values.JxW(q_point);
+              }
+          }
+    }
+
+    //Estimate the stiffness of the drained solid skeleton in the reference configuration
+    //from the (linearised) material parameters
+    template <int dim>
+    double Solid<dim>::get_drained_stiffness() const
+    {
+        double shear_modulus = 0.0;
+        if (parameters.mat_type == "Neo-Hooke")
+          shear_modulus = parameters.mu;
+        else
+          {
+            shear_modulus = 0.5 * ( parameters.mu1_infty * parameters.alpha1_infty
+                                  + parameters.mu2_infty * parameters.alpha2_infty
+                                  + parameters.mu3_infty * parameters.alpha3_infty );
+            if (parameters.mat_type == "visco-Ogden")
+              shear_modulus += 0.5 * ( parameters.mu1_mode_1 * parameters.alpha1_mode_1
+                                     + parameters.mu2_mode_1 * parameters.alpha2_mode_1
+                                     + parameters.mu3_mode_1 * parameters.alpha3_mode_1 );
+          }
+
+        const double drained_stiffness = parameters.lambda + 2.0 * shear_modulus;
+        AssertThrow(drained_stiffness > 0.0,
+                    ExcMessage("The drained stiffness of the solid must be positive."));
+        return drained_stiffness;
     }
 
     //Store the converged values of the internal variables
@@ -2775,22 +3329,68 @@ namespace NonLinearPoroViscoElasticity
            pcout     << " SLV " << std::flush;
            outfile   << " SLV " << std::flush;
 
-           TrilinosWrappers::MPI::Vector newton_update_nb;
-           newton_update_nb.reinit(locally_owned_dofs, mpi_communicator);
+           if (parameters.type_lin == "Direct")
+           {
+             TrilinosWrappers::MPI::Vector newton_update_nb;
+             newton_update_nb.reinit(locally_owned_dofs, mpi_communicator);
 
-           SolverControl solver_control (tangent_matrix_nb.m(),
-                                         1.0e-6 * system_rhs_nb.l2_norm());
-           TrilinosWrappers::SolverDirect solver (solver_control);
-           solver.solve(tangent_matrix_nb, newton_update_nb, system_rhs_nb);
+             SolverControl solver_control (tangent_matrix_nb.m(),
+                                           1.0e-6 * system_rhs_nb.l2_norm());
+             TrilinosWrappers::SolverDirect solver (solver_control);
+             solver.solve(tangent_matrix_nb, newton_update_nb, system_rhs_nb);
 
-           // Copy the non-block solution back to block system
-           for (unsigned int i=0; i<locally_owned_dofs.n_elements(); ++i)
-             {
-               const types::global_dof_index idx_i
-                              = locally_owned_dofs.nth_index_in_set(i);
-               newton_update_OUT(idx_i) = newton_update_nb(idx_i);
-             }
-           newton_update_OUT.compress(VectorOperation::insert);
+             // Copy the non-block solution back to block system
+             for (unsigned int i=0; i<locally_owned_dofs.n_elements(); ++i)
+               {
+                 const types::global_dof_index idx_i
+                                = locally_owned_dofs.nth_index_in_set(i);
+                 newton_update_OUT(idx_i) = newton_update_nb(idx_i);
+               }
+             newton_update_OUT.compress(VectorOperation::insert);
+           }
+           else if (parameters.type_lin == "Iterative")
+           {
+             // AMG for the displacement block, using the rigid translations
+             // as near null space
+             std::vector<std::vector<bool> > constant_modes;
+             DoFTools::extract_constant_modes (dof_handler_ref,
+                                               fe.component_mask(u_fe),
+                                               constant_modes);
+
+             TrilinosWrappers::PreconditionAMG preconditioner_K_uu;
+             TrilinosWrappers::PreconditionAMG::AdditionalData data_K_uu;
+             data_K_uu.constant_modes = constant_modes;
+             data_K_uu.elliptic = true;
+             data_K_uu.higher_order_elements = (degree_displ > 1);
+             data_K_uu.smoother_sweeps = 2;
+             data_K_uu.aggregation_threshold = 0.02;
+             preconditioner_K_uu.initialize (tangent_matrix.block(u_block, u_block),
+                                             data_K_uu);
+
+             // AMG for the Schur complement approximation
+             TrilinosWrappers::PreconditionAMG preconditioner_S;
+             TrilinosWrappers::PreconditionAMG::AdditionalData data_S;
+             data_S.elliptic = true;
+             data_S.higher_order_elements = (degree_pore > 1);
+             data_S.smoother_sweeps = 2;
+             preconditioner_S.initialize (tangent_matrix_preconditioner.block(p_fluid_block, p_fluid_block),
+                                          data_S);
+
+             const BlockTriangularPreconditioner
+             preconditioner (tangent_matrix.block(u_block, p_fluid_block),
+                             preconditioner_K_uu,
+                             preconditioner_S);
+
+             // The tangent matrix is not symmetric, so we use a (flexible) GMRES solver
+             SolverControl solver_control (static_cast<unsigned int>(tangent_matrix.m()
+                                                                     * parameters.max_iterations_lin),
+                                           parameters.tol_lin * system_rhs.l2_norm());
+             SolverFGMRES<TrilinosWrappers::MPI::BlockVector> solver (solver_control);
+             solver.solve (tangent_matrix, newton_update_OUT, system_rhs, preconditioner);
+             n_iterations_lin += solver_control.last_step();
+           }
+           else
+             AssertThrow(false, ExcMessage("Linear solver type not implemented"));
 
            timerconsole.leave_subsection();
            timerfile.leave_subsection();
@@ -3395,6 +3995,68 @@ namespace NonLinearPoroViscoElasticity
       }
 
 
+      //Find the cells containing the tracked vertices and the boundary faces needed
+      //for the output to the plotting file. As the mesh does not change during the
+      //simulation, this is done only once, so that the output at each time step
+      //does not involve any search through the mesh.
+      template <int dim>
+      void Solid<dim>::setup_output_locations(const std::vector<Point<dim> > &tracked_vertices)
+      {
+        tracked_points.clear();
+        tracked_points.resize(tracked_vertices.size());
+
+        for (unsigned int p=0; p<tracked_vertices.size(); ++p)
+        {
+            // The triangulation is shared, so every process finds the same cell
+            // and exactly one of them owns it
+            const std::pair<typename DoFHandler<dim>::active_cell_iterator, Point<dim> >
+            cell_and_point = GridTools::find_active_cell_around_point(StaticMappingQ1<dim>::mapping,
+                                                                      dof_handler_ref,
+                                                                      tracked_vertices[p]);
+
+            TrackedPoint &tracked_point = tracked_points[p];
+            tracked_point.cell = cell_and_point.first;
+            tracked_point.is_locally_owned = tracked_point.cell->is_locally_owned();
+            if (tracked_point.is_locally_owned == false)
+              continue;
+
+            const Quadrature<dim>
+            quadrature_point(GeometryInfo<dim>::project_to_unit_cell(cell_and_point.second));
+            FEValues<dim> fe_values_point(fe, quadrature_point, update_values);
+            fe_values_point.reinit(tracked_point.cell);
+
+            tracked_point.local_dof_indices.resize(dofs_per_cell);
+            tracked_point.cell->get_dof_indices(tracked_point.local_dof_indices);
+
+            tracked_point.shape_values.reinit(dofs_per_cell, n_components);
+            for (unsigned int i=0; i<dofs_per_cell; ++i)
+            {
+                const unsigned int component_i = fe.system_to_component_index(i).first;
+                tracked_point.shape_values(i, component_i) = fe_values_point.shape_value(i, 0);
+            }
+        }
+
+        reaction_faces.clear();
+        drained_faces.clear();
+
+        FilteredIterator<typename DoFHandler<dim>::active_cell_iterator>
+          cell(IteratorFilters::LocallyOwnedCell(),
+               dof_handler_ref.begin_active()),
+          endc(IteratorFilters::LocallyOwnedCell(),
+               dof_handler_ref.end());
+        for (; cell!=endc; ++cell)
+          for (unsigned int face=0; face<GeometryInfo<dim>::faces_per_cell; ++face)
+            if (cell->face(face)->at_boundary() == true)
+            {
+                const types::boundary_id boundary_id = cell->face(face)->boundary_id();
+                if (boundary_id == get_reaction_boundary_id_for_output())
+                  reaction_faces.emplace_back(cell, face);
+                if (boundary_id == get_drained_boundary_id_for_output().first ||
+                    boundary_id == get_drained_boundary_id_for_output().second)
+                  drained_faces.emplace_back(cell, face);
+            }
+      }
+
       //Print results to plotting file
       template <int dim>
       void Solid<dim>::output_results_to_plot(
@@ -3438,22 +4100,16 @@ namespace NonLinearPoroViscoElasticity
         double sum_vol_current_mpi = 0.0;
         double sum_vol_reference_mpi = 0.0;
 
-        //Declare an instance of the material class object
-        if (parameters.mat_type == "Neo-Hooke")
-            NeoHooke<dim,ADNumberType> material(parameters,time);
-        else if (parameters.mat_type == "Ogden")
-            Ogden<dim,ADNumberType> material(parameters, time);
-        else if (parameters.mat_type == "visco-Ogden")
-            visco_Ogden <dim,ADNumberType>material(parameters,time);
-        else
-        Assert (false, ExcMessage("Material type not implemented"));
-
         //Define a local instance of FEValues to compute updated values required
         //to calculate stresses
         const UpdateFlags uf_cell(update_values | update_gradients |
                                   update_JxW_values);
         FEValues<dim> fe_values_ref (fe, qf_cell, uf_cell);
 
+        std::vector<Tensor<2,dim>> solution_grads_u(n_q_points);
+        std::vector<double> solution_values_p_fluid_total(n_q_points);
+        std::vector<Tensor<1,dim >> solution_grads_p_fluid_AD(n_q_points);
+
         //Iterate through elements (cells) and Gauss Points
         FilteredIterator<typename DoFHandler<dim>::active_cell_iterator>
           cell(IteratorFilters::LocallyOwnedCell(),
@@ -3468,18 +4124,17 @@ namespace NonLinearPoroViscoElasticity
 
             fe_values_ref.reinit(cell);
 
-            std::vector<Tensor<2,dim>> solution_grads_u(n_q_points);
             fe_values_ref[u_fe].get_function_gradients(solution_total,
                                                        solution_grads_u);
-
-            std::vector<double> solution_values_p_fluid_total(n_q_points);
             fe_values_ref[p_fluid_fe].get_function_values(solution_total,
                                                           solution_values_p_fluid_total);
-
-            std::vector<Tensor<1,dim >> solution_grads_p_fluid_AD(n_q_points);
             fe_values_ref[p_fluid_fe].get_function_gradients(solution_total,
                                                              solution_grads_p_fluid_AD);
 
+            const std::vector<std::shared_ptr<const PointHistory<dim,ADNumberType>>>
+                lqph = quadrature_point_history.get_data(cell);
+            Assert(lqph.size() == n_q_points, ExcInternalError());
+
             //start gauss point loop
             for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
             {
@@ -3488,10 +4143,6 @@ namespace NonLinearPoroViscoElasticity
                 ADNumberType det_F_AD = determinant(F_AD);
                 const double det_F = Tensor<0,dim,double>(det_F_AD);
 
-                const std::vector<std::shared_ptr<const PointHistory<dim,ADNumberType>>>
-                    lqph = quadrature_point_history.get_data(cell);
-                Assert(lqph.size() == n_q_points, ExcInternalError());
-
                 double JxW = fe_values_ref.JxW(q_point);
 
                 //Volumes
@@ -3503,8 +4154,6 @@ namespace NonLinearPoroViscoElasticity
                 const Tensor<2,dim,ADNumberType> F_inv = invert(F_AD);
                 const Tensor<1,dim,ADNumberType>
                   grad_p_fluid_AD =  solution_grads_p_fluid_AD[q_point]*F_inv;
-                const Tensor<1,dim,ADNumberType> seepage_vel_AD
-                = lqph[q_point]->get_seepage_velocity_current(F_AD, grad_p_fluid_AD);
 
                 //Dissipations
                 const double porous_dissipation =
@@ -3516,129 +4165,122 @@ namespace NonLinearPoroViscoElasticity
 
               //---------------------------------------------------------------
             } //end gauss point loop
+        }//end cell loop
 
-            // Compute reaction force on load boundary & total fluid flow across
-            // drained boundary.
-            // Define a local instance of FEFaceValues to compute values required
-            // to calculate reaction force
-            const UpdateFlags uf_face( update_values | update_gradients |
-                                       update_normal_vectors | update_JxW_values );
-            FEFaceValues<dim> fe_face_values_ref(fe, qf_face, uf_face);
+        // Compute reaction force on load boundary & total fluid flow across
+        // drained boundary, looping only over the faces found in
+        // setup_output_locations().
+        // Define a local instance of FEFaceValues to compute values required
+        // to calculate reaction force
+        const UpdateFlags uf_face( update_values | update_gradients |
+                                   update_normal_vectors | update_JxW_values );
+        FEFaceValues<dim> fe_face_values_ref(fe, qf_face, uf_face);
+        std::vector<Tensor<2,dim> > solution_grads_u_f(n_q_points_f);
+        std::vector<Tensor<1,dim> > solution_grads_p_f(n_q_points_f);
+
+        //Reaction force
+        for (const auto &cell_and_face : reaction_faces)
+        {
+            const typename DoFHandler<dim>::active_cell_iterator &cell_f = cell_and_face.first;
+            fe_face_values_ref.reinit(cell_f, cell_and_face.second);
+
+            //Get displacement gradients for current face
+            fe_face_values_ref[u_fe].get_function_gradients
+                                                 (solution_total,
+                                                  solution_grads_u_f);
+
+            //Get pressure for current element
+            fe_values_ref.reinit(cell_f);
+            fe_values_ref[p_fluid_fe].get_function_values
+                                       (solution_total,
+                                        solution_values_p_fluid_total);
+
+            const std::vector<std::shared_ptr<const PointHistory<dim,ADNumberType>>>
+                lqph = quadrature_point_history.get_data(cell_f);
+            Assert(lqph.size() == n_q_points, ExcInternalError());
 
-            //start face loop
-            for (unsigned int face=0; face<GeometryInfo<dim>::faces_per_cell; ++face)
+            //start gauss points on faces loop
+            for (unsigned int f_q_point=0; f_q_point<n_q_points_f; ++f_q_point)
             {
-                //Reaction force
-                if (cell->face(face)->at_boundary() == true &&
-                    cell->face(face)->boundary_id() == get_reaction_boundary_id_for_output() )
-                {
-                    fe_face_values_ref.reinit(cell, face);
-
-                    //Get displacement gradients for current face
-                    std::vector<Tensor<2,dim> > solution_grads_u_f(n_q_points_f);
-                    fe_face_values_ref[u_fe].get_function_gradients
-                                                         (solution_total,
-                                                          solution_grads_u_f);
-
-                    //Get pressure for current element
-                    std::vector< double > solution_values_p_fluid_total_f(n_q_points_f);
-                    fe_face_values_ref[p_fluid_fe].get_function_values
-                                               (solution_total,
-                                                solution_values_p_fluid_total_f);
-
-                    //start gauss points on faces loop
-                    for (unsigned int f_q_point=0; f_q_point<n_q_points_f; ++f_q_point)
-                    {
-                        const Tensor<1,dim> &N = fe_face_values_ref.normal_vector(f_q_point);
-                        const double JxW_f = fe_face_values_ref.JxW(f_q_point);
-
-                        //Compute deformation gradient from displacements gradient
-                        //(present configuration)
-                        const Tensor<2,dim,ADNumberType> F_AD =
-                          Physics::Elasticity::Kinematics::F(solution_grads_u_f[f_q_point]);
-
-                        const std::vector<std::shared_ptr<const PointHistory<dim,ADNumberType>>>
-                            lqph = quadrature_point_history.get_data(cell);
-                        Assert(lqph.size() == n_q_points, ExcInternalError());
-
-                        const double p_fluid = solution_values_p_fluid_total[f_q_point];
-
-                        //Cauchy stress
-                        static const SymmetricTensor<2,dim,double>
-                          I (Physics::Elasticity::StandardTensors<dim>::I);
-                        SymmetricTensor<2,dim> sigma_E;
-                        const SymmetricTensor<2,dim,ADNumberType> sigma_E_AD =
-                          lqph[f_q_point]->get_Cauchy_E(F_AD);
-
-                        for (unsigned int i=0; i<dim; ++i)
-                            for (unsigned int j=0; j<dim; ++j)
-                               sigma_E[i][j] = Tensor<0,dim,double>(sigma_E_AD[i][j]);
-
-                        SymmetricTensor<2,dim> sigma_fluid_vol(I);
-                        sigma_fluid_vol *= -1.0*p_fluid;
-                        const SymmetricTensor<2,dim> sigma = sigma_E+sigma_fluid_vol;
-                        sum_reaction_mpi += sigma * N * JxW_f;
-                        sum_reaction_pressure_mpi += sigma_fluid_vol * N * JxW_f;
-                        sum_reaction_extra_mpi += sigma_E * N * JxW_f;
-                    }//end gauss points on faces loop
-                }
+                const Tensor<1,dim> &N = fe_face_values_ref.normal_vector(f_q_point);
+                const double JxW_f = fe_face_values_ref.JxW(f_q_point);
 
-                //Fluid flow
-                if (cell->face(face)->at_boundary() == true &&
-                   (cell->face(face)->boundary_id() ==
-                      get_drained_boundary_id_for_output().first ||
-                    cell->face(face)->boundary_id() ==
-                      get_drained_boundary_id_for_output().second ) )
-                {
-                    fe_face_values_ref.reinit(cell, face);
-
-                    //Get displacement gradients for current face
-                    std::vector<Tensor<2,dim>> solution_grads_u_f(n_q_points_f);
-                    fe_face_values_ref[u_fe].get_function_gradients
-                                                            (solution_total,
-                                                             solution_grads_u_f);
-
-                    //Get pressure gradients for current face
-                    std::vector<Tensor<1,dim>> solution_grads_p_f(n_q_points_f);
-                    fe_face_values_ref[p_fluid_fe].get_function_gradients
-                                                             (solution_total,
-                                                              solution_grads_p_f);
-
-                    //start gauss points on faces loop
-                    for (unsigned int f_q_point=0; f_q_point<n_q_points_f; ++f_q_point)
-                    {
-                        const Tensor<1,dim> &N =
-                                  fe_face_values_ref.normal_vector(f_q_point);
-                        const double JxW_f = fe_face_values_ref.JxW(f_q_point);
-
-                        //Deformation gradient and inverse from displacements gradient
-                        //(present configuration)
-                        const Tensor<2,dim,ADNumberType> F_AD
-                            = Physics::Elasticity::Kinematics::F(solution_grads_u_f[f_q_point]);
-
-                        const Tensor<2,dim,ADNumberType> F_inv_AD = invert(F_AD);
-                        ADNumberType det_F_AD = determinant(F_AD);
-
-                        const std::vector<std::shared_ptr<const PointHistory<dim,ADNumberType>>>
-                            lqph = quadrature_point_history.get_data(cell);
-                        Assert(lqph.size() == n_q_points, ExcInternalError());
-
-                        //Seepage velocity
-                        Tensor<1,dim> seepage;
-                        double det_F = Tensor<0,dim,double>(det_F_AD);
-                        const Tensor<1,dim,ADNumberType> grad_p
-                                          = solution_grads_p_f[f_q_point]*F_inv_AD;
-                        const Tensor<1,dim,ADNumberType> seepage_AD
-                          = lqph[f_q_point]->get_seepage_velocity_current(F_AD, grad_p);
-
-                        for (unsigned int i=0; i<dim; ++i)
-                            seepage[i] = Tensor<0,dim,double>(seepage_AD[i]);
-
-                        sum_total_flow_mpi += (seepage/det_F) * N * JxW_f;
-                    }//end gauss points on faces loop
-                }
-            }//end face loop
-        }//end cell loop
+                //Compute deformation gradient from displacements gradient
+                //(present configuration)
+                const Tensor<2,dim,ADNumberType> F_AD =
+                  Physics::Elasticity::Kinematics::F(solution_grads_u_f[f_q_point]);
+
+                const double p_fluid = solution_values_p_fluid_total[f_q_point];
+
+                //Cauchy stress
+                static const SymmetricTensor<2,dim,double>
+                  I (Physics::Elasticity::StandardTensors<dim>::I);
+                SymmetricTensor<2,dim> sigma_E;
+                const SymmetricTensor<2,dim,ADNumberType> sigma_E_AD =
+                  lqph[f_q_point]->get_Cauchy_E(F_AD);
+
+                for (unsigned int i=0; i<dim; ++i)
+                    for (unsigned int j=0; j<dim; ++j)
+                       sigma_E[i][j] = Tensor<0,dim,double>(sigma_E_AD[i][j]);
+
+                SymmetricTensor<2,dim> sigma_fluid_vol(I);
+                sigma_fluid_vol *= -1.0*p_fluid;
+                const SymmetricTensor<2,dim> sigma = sigma_E+sigma_fluid_vol;
+                sum_reaction_mpi += sigma * N * JxW_f;
+                sum_reaction_pressure_mpi += sigma_fluid_vol * N * JxW_f;
+                sum_reaction_extra_mpi += sigma_E * N * JxW_f;
+            }//end gauss points on faces loop
+        }
+
+        //Fluid flow
+        for (const auto &cell_and_face : drained_faces)
+        {
+            const typename DoFHandler<dim>::active_cell_iterator &cell_f = cell_and_face.first;
+            fe_face_values_ref.reinit(cell_f, cell_and_face.second);
+
+            //Get displacement gradients for current face
+            fe_face_values_ref[u_fe].get_function_gradients
+                                                    (solution_total,
+                                                     solution_grads_u_f);
+
+            //Get pressure gradients for current face
+            fe_face_values_ref[p_fluid_fe].get_function_gradients
+                                                     (solution_total,
+                                                      solution_grads_p_f);
+
+            const std::vector<std::shared_ptr<const PointHistory<dim,ADNumberType>>>
+                lqph = quadrature_point_history.get_data(cell_f);
+            Assert(lqph.size() == n_q_points, ExcInternalError());
+
+            //start gauss points on faces loop
+            for (unsigned int f_q_point=0; f_q_point<n_q_points_f; ++f_q_point)
+            {
+                const Tensor<1,dim> &N =
+                          fe_face_values_ref.normal_vector(f_q_point);
+                const double JxW_f = fe_face_values_ref.JxW(f_q_point);
+
+                //Deformation gradient and inverse from displacements gradient
+                //(present configuration)
+                const Tensor<2,dim,ADNumberType> F_AD
+                    = Physics::Elasticity::Kinematics::F(solution_grads_u_f[f_q_point]);
+
+                const Tensor<2,dim,ADNumberType> F_inv_AD = invert(F_AD);
+                ADNumberType det_F_AD = determinant(F_AD);
+
+                //Seepage velocity
+                Tensor<1,dim> seepage;
+                double det_F = Tensor<0,dim,double>(det_F_AD);
+                const Tensor<1,dim,ADNumberType> grad_p
+                                  = solution_grads_p_f[f_q_point]*F_inv_AD;
+                const Tensor<1,dim,ADNumberType> seepage_AD
+                  = lqph[f_q_point]->get_seepage_velocity_current(F_AD, grad_p);
+
+                for (unsigned int i=0; i<dim; ++i)
+                    seepage[i] = Tensor<0,dim,double>(seepage_AD[i]);
+
+                sum_total_flow_mpi += (seepage/det_F) * N * JxW_f;
+            }//end gauss points on faces loop
+        }
 
         //Sum the results from different MPI process and then add to the reaction_force vector
         //In theory, the solution on each surface (each cell) only exists in one MPI process
@@ -3667,49 +4309,34 @@ namespace NonLinearPoroViscoElasticity
         total_vol_reference = Utilities::MPI::sum(sum_vol_reference_mpi,
                                                   mpi_communicator);
 
-      //  Extract solution for tracked vectors
-      // Copying an MPI::BlockVector into MPI::Vector is not possible,
-      // so we copy each block of MPI::BlockVector into an MPI::Vector
-      // And then we copy the MPI::Vector into "normal" Vectors
-        TrilinosWrappers::MPI::Vector solution_vector_u_MPI(solution_total.block(u_block));
-        TrilinosWrappers::MPI::Vector solution_vector_p_MPI(solution_total.block(p_fluid_block));
-        Vector<double> solution_u_vector(solution_vector_u_MPI);
-        Vector<double> solution_p_vector(solution_vector_p_MPI);
+        //  Extract solution for tracked vectors
+        // Each tracked point is evaluated by the process owning the cell around it,
+        // using the shape function values precomputed in setup_output_locations().
+        // The other processes contribute zeros to the sum.
+        std::vector<double> tracked_values(tracked_points.size()*(dim+1), 0.0);
+        for (unsigned int p=0; p<tracked_points.size(); ++p)
+          if (tracked_points[p].is_locally_owned)
+            for (unsigned int i=0; i<dofs_per_cell; ++i)
+            {
+                const double dof_value
+                  = solution_total(tracked_points[p].local_dof_indices[i]);
+                for (unsigned int d=0; d<(dim+1); ++d)
+                    tracked_values[p*(dim+1)+d]
+                      += dof_value * tracked_points[p].shape_values(i, d);
+            }
+        Utilities::MPI::sum(tracked_values, mpi_communicator, tracked_values);
 
         if (this_mpi_process == 0)
         {
-            //Append the pressure solution vector to the displacement solution vector,
-            //creating a single solution vector equivalent to the original BlockVector
-            //so FEFieldFunction will work with the dof_handler_ref.
-            Vector<double> solution_vector(solution_p_vector.size()
-                                           +solution_u_vector.size());
-
-            for (unsigned int d=0; d<(solution_u_vector.size()); ++d)
-                solution_vector[d] = solution_u_vector[d];
-
-            for (unsigned int d=0; d<(solution_p_vector.size()); ++d)
-                solution_vector[solution_u_vector.size()+d] = solution_p_vector[d];
-
-            Functions::FEFieldFunction<dim,Vector<double>>
-            find_solution(dof_handler_ref, solution_vector);
-
             for (unsigned int p=0; p<tracked_vertices_IN.size(); ++p)
             {
-                Vector<double> update(dim+1);
-                Point<dim> pt_ref;
-
-                pt_ref[0]= tracked_vertices_IN[p][0];
-                pt_ref[1]= tracked_vertices_IN[p][1];
-                pt_ref[2]= tracked_vertices_IN[p][2];
-
-               find_solution.vector_value(pt_ref, update);
-
                for (unsigned int d=0; d<(dim+1); ++d)
                {
+                   double update = tracked_values[p*(dim+1)+d];
                    //For values close to zero, set to 0.0
-                   if (abs(update[d])<1.5*parameters.tol_u)
-                       update[d] = 0.0;
-                   solution_vertices[p][d] = update[d];
+                   if (abs(update)<1.5*parameters.tol_u)
+                       update = 0.0;
+                   solution_vertices[p][d] = update;
                }
             }
       // Write the results to the plotting file.
@@ -4960,6 +5587,10 @@ int main (int argc, char *argv[])
   try
     {
       Parameters::AllParameters parameters ("parameters.prm");
+      // An optional argument replaces the global refinement level, e.g. for the
+      // problem sizes of scaling studies
+      if (argc > 1)
+        parameters.global_refinement = Utilities::string_to_int(argv[1]);
       if (parameters.geom_type == "Ehlers_tube_step_load")
       {
         VerificationEhlers1999StepLoad<3> solid_3d(parameters);
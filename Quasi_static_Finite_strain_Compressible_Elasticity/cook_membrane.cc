@@ -52,20 +52,41 @@
 #include <deal.II/lac/affine_constraints.h>
 #include <deal.II/lac/block_sparse_matrix.h>
 #include <deal.II/lac/block_vector.h>
+#include <deal.II/lac/diagonal_matrix.h>
 #include <deal.II/lac/dynamic_sparsity_pattern.h>
 #include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/la_parallel_vector.h>
+#include <deal.II/lac/precondition.h>
 #include <deal.II/lac/precondition_selector.h>
 #include <deal.II/lac/solver_cg.h>
 #include <deal.II/lac/sparse_direct.h>
 
+#include <deal.II/matrix_free/fe_evaluation.h>
+#include <deal.II/matrix_free/matrix_free.h>
+#include <deal.II/matrix_free/operators.h>
+#include <deal.II/matrix_free/tools.h>
+
+#include <deal.II/multigrid/mg_coarse.h>
+#include <deal.II/multigrid/mg_constrained_dofs.h>
+#include <deal.II/multigrid/mg_matrix.h>
+#include <deal.II/multigrid/mg_smoother.h>
+#include <deal.II/multigrid/mg_tools.h>
+#include <deal.II/multigrid/mg_transfer_matrix_free.h>
+#include <deal.II/multigrid/multigrid.h>
+
 #include <deal.II/numerics/data_out.h>
 #include <deal.II/numerics/vector_tools.h>
 
 #include <deal.II/base/config.h>
-#if DEAL_II_VERSION_MAJOR >= 9 && defined(DEAL_II_WITH_TRILINOS)
+#if DEAL_II_VERSION_MAJOR >= 9 && (defined(DEAL_II_WITH_TRILINOS) || defined(DEAL_II_WITH_ADOLC))
 #include <deal.II/differentiation/ad.h>
+#endif
+#if DEAL_II_VERSION_MAJOR >= 9 && defined(DEAL_II_WITH_TRILINOS)
 #define ENABLE_SACADO_FORMULATION
 #endif
+#if DEAL_II_VERSION_MAJOR >= 9 && defined(DEAL_II_WITH_ADOLC)
+#define ENABLE_ADOLC_TAPED_FORMULATION
+#endif
 
 // These must be included below the AD headers so that
 // their math functions are available for use in the
@@ -74,8 +95,11 @@
 #include <deal.II/physics/elasticity/standard_tensors.h>
 
 #include <iostream>
+#include <iomanip>
 #include <fstream>
+#include <sstream>
 #include <memory>
+#include <algorithm>
 
 
 // We then stick everything that relates to this tutorial program into a
@@ -95,10 +119,17 @@ namespace Cook_Membrane
 
 // Here we specify whether automatic differentiation is to be used to assemble
 // the linear system, and if so then what order of differentiation is to be
-// employed.
+// employed. Alternatively, the tangent need not be assembled at all: it can
+// instead be applied cell-by-cell using the matrix-free framework, in which
+// case the linear system is solved using CG preconditioned by geometric
+// multigrid. For the second order, the strain energy function can also be
+// differentiated with taped AD, where the recorded operations are replayed
+// rather than evaluated anew at each quadrature point.
     struct AssemblyMethod
     {
       unsigned int automatic_differentiation_order;
+      bool         taped_automatic_differentiation;
+      std::string  tangent_operator;
 
       static void
       declare_parameters(ParameterHandler &prm);
@@ -118,6 +149,21 @@ namespace Cook_Membrane
                           "# Order = 0: Both the residual and linearisation are computed manually.\n"
                           "# Order = 1: The residual is computed manually but the linearisation is performed using AD.\n"
                           "# Order = 2: Both the residual and linearisation are computed using AD.");
+
+        prm.declare_entry("Taped automatic differentiation", "false",
+                          Patterns::Bool(),
+                          "Use taped AD (ADOL-C) for an automatic differentiation order of 2. "
+                          "The strain energy function is recorded once per material and the "
+                          "tape is replayed at each quadrature point.");
+
+        prm.declare_entry("Tangent operator", "matrix-based",
+                          Patterns::Selection("matrix-based|matrix-free"),
+                          "The representation of the linearisation of the residual.\n"
+                          "# matrix-based: The tangent matrix is assembled and stored.\n"
+                          "# matrix-free: The tangent is applied on the fly using cached "
+                          "quadrature point data and the linear system is solved with "
+                          "a geometric multigrid preconditioned CG solver. "
+                          "This requires an automatic differentiation order of 0.");
       }
       prm.leave_subsection();
     }
@@ -127,6 +173,20 @@ namespace Cook_Membrane
       prm.enter_subsection("Assembly method");
       {
         automatic_differentiation_order = prm.get_integer("Automatic differentiation order");
+        taped_automatic_differentiation = prm.get_bool("Taped automatic differentiation");
+        tangent_operator = prm.get("Tangent operator");
+
+        AssertThrow(taped_automatic_differentiation == false ||
+                    automatic_differentiation_order == 2,
+                    ExcMessage("Taped automatic differentiation is only "
+                               "implemented for an automatic differentiation "
+                               "order of 2."));
+
+        AssertThrow(tangent_operator == "matrix-based" ||
+                    automatic_differentiation_order == 0,
+                    ExcMessage("The matrix-free tangent operator is only "
+                               "implemented for the manual linearisation "
+                               "(automatic differentiation order 0)."));
       }
       prm.leave_subsection();
     }
@@ -402,6 +462,57 @@ namespace Cook_Membrane
       prm.leave_subsection();
     }
 
+// @sect4{Benchmark}
+
+// Instead of solving the problem, the assembly of the linear system can be
+// timed for all of the available assembly methods and a list of polynomial
+// degrees.
+    struct Benchmark
+    {
+      bool                      benchmark_assembly;
+      std::vector<unsigned int> benchmark_poly_degrees;
+      unsigned int              benchmark_repetitions;
+
+      static void
+      declare_parameters(ParameterHandler &prm);
+
+      void
+      parse_parameters(ParameterHandler &prm);
+    };
+
+    void Benchmark::declare_parameters(ParameterHandler &prm)
+    {
+      prm.enter_subsection("Benchmark");
+      {
+        prm.declare_entry("Assembly benchmark", "false",
+                          Patterns::Bool(),
+                          "Time the assembly for each assembly method and "
+                          "polynomial degree instead of solving the problem");
+
+        prm.declare_entry("Polynomial degrees", "1,2",
+                          Patterns::List(Patterns::Integer(1)),
+                          "Displacement polynomial orders to be timed");
+
+        prm.declare_entry("Repetitions", "5",
+                          Patterns::Integer(1),
+                          "Number of timed assemblies for each configuration");
+      }
+      prm.leave_subsection();
+    }
+
+    void Benchmark::parse_parameters(ParameterHandler &prm)
+    {
+      prm.enter_subsection("Benchmark");
+      {
+        benchmark_assembly = prm.get_bool("Assembly benchmark");
+        const std::vector<int> degrees =
+          Utilities::string_to_int(Utilities::split_string_list(prm.get("Polynomial degrees")));
+        benchmark_poly_degrees.assign(degrees.begin(), degrees.end());
+        benchmark_repetitions = prm.get_integer("Repetitions");
+      }
+      prm.leave_subsection();
+    }
+
 // @sect4{All parameters}
 
 // Finally we consolidate all of the above structures into a single container
@@ -413,7 +524,8 @@ namespace Cook_Membrane
       public Materials,
       public LinearSolver,
       public NonlinearSolver,
-      public Time
+      public Time,
+      public Benchmark
 
     {
       AllParameters(const std::string &input_file);
@@ -442,6 +554,7 @@ namespace Cook_Membrane
       LinearSolver::declare_parameters(prm);
       NonlinearSolver::declare_parameters(prm);
       Time::declare_parameters(prm);
+      Benchmark::declare_parameters(prm);
     }
 
     void AllParameters::parse_parameters(ParameterHandler &prm)
@@ -453,6 +566,7 @@ namespace Cook_Membrane
       LinearSolver::parse_parameters(prm);
       NonlinearSolver::parse_parameters(prm);
       Time::parse_parameters(prm);
+      Benchmark::parse_parameters(prm);
     }
   }
 
@@ -759,6 +873,244 @@ namespace Cook_Membrane
   };
 
 
+// @sect3{Matrix-free tangent operator}
+
+// For large problems, storing the tangent matrix becomes the limiting factor
+// in terms of both memory and the cost of each matrix-vector product. The
+// following class provides an alternative that applies the linearisation of
+// the residual cell-by-cell using the matrix-free framework (see step-37).
+// The only data that is retained between Krylov iterations is the state at
+// each quadrature point, namely the inverse of the deformation gradient, the
+// Kirchhoff stress $\boldsymbol{\tau}$ and the spatial tangent
+// $J\mathfrak{c}$. These are recomputed by the <code>cache()</code> function
+// whenever the linearisation point changes, that is, once per Newton
+// iteration.
+//
+// The action of the tangent on an increment $d\mathbf{u}$, tested with
+// $\delta\mathbf{u}$, is the same as that evaluated in the assembly of the
+// tangent matrix:
+// $\int_{\Omega_0} \textrm{grad}^{s}\delta\mathbf{u} : J\mathfrak{c} :
+// \textrm{grad}^{s} d\mathbf{u} + \textrm{grad}\delta\mathbf{u} :
+// [\textrm{grad}\, d\mathbf{u}\;\boldsymbol{\tau}] \; dV$,
+// where the spatial gradients are attained through $\textrm{grad}(\cdot) =
+// \textrm{Grad}(\cdot) \mathbf{F}^{-1}$.
+//
+// The same class is used for the operators on each level of the multigrid
+// hierarchy, where the linearisation point is given by the displacement
+// interpolated to that level.
+  template <int dim,typename Number>
+  class NeoHookOperator
+    : public MatrixFreeOperators::Base<dim, LinearAlgebra::distributed::Vector<Number> >
+  {
+  public:
+    typedef LinearAlgebra::distributed::Vector<Number>       VectorType;
+    typedef VectorizedArray<Number>                          VectorizedArrayType;
+    typedef FEEvaluation<dim, -1, 0, dim, Number>            FECellIntegrator;
+
+    NeoHookOperator()
+      :
+      MatrixFreeOperators::Base<dim,VectorType>()
+    {}
+
+    virtual void
+    clear() override
+    {
+      cached_F_inv.reinit(0, 0);
+      cached_tau.reinit(0, 0);
+      cached_Jc.reinit(0, 0);
+      MatrixFreeOperators::Base<dim,VectorType>::clear();
+    }
+
+    // Create the material description used to evaluate the quadrature point
+    // data.
+    void
+    set_material(const double mu,
+                 const double nu)
+    {
+      material.reset(new Material_Compressible_Neo_Hook_One_Field<dim,double>(mu, nu));
+    }
+
+    // Linearise the operator about the given total displacement field.
+    void
+    cache(const VectorType &solution_total);
+
+    virtual void
+    compute_diagonal() override;
+
+  private:
+    virtual void
+    apply_add(VectorType       &dst,
+              const VectorType &src) const override;
+
+    void
+    local_apply_cell(const MatrixFree<dim,Number>                &data,
+                     VectorType                                  &dst,
+                     const VectorType                            &src,
+                     const std::pair<unsigned int, unsigned int> &cell_range) const;
+
+    // The quadrature point operation that is shared by the operator
+    // application and the computation of its diagonal.
+    void
+    do_cell_integral(FECellIntegrator &phi) const;
+
+    std::shared_ptr< Material_Compressible_Neo_Hook_One_Field<dim,double> > material;
+
+    // Quadrature point data, stored per cell batch and quadrature point.
+    Table<2, Tensor<2,dim,VectorizedArrayType> >          cached_F_inv;
+    Table<2, SymmetricTensor<2,dim,VectorizedArrayType> > cached_tau;
+    Table<2, SymmetricTensor<4,dim,VectorizedArrayType> > cached_Jc;
+  };
+
+
+// As the material class is written for scalar number types, the kinetic
+// quantities are evaluated separately for each lane of a cell batch and
+// then stored in vectorized form. Lanes that are not populated in the last
+// cell batch retain zero data and therefore do not contribute.
+  template <int dim,typename Number>
+  void NeoHookOperator<dim,Number>::cache(const VectorType &solution_total)
+  {
+    Assert(material, ExcNotInitialized());
+
+    const MatrixFree<dim,Number> &data = *this->data;
+    const unsigned int n_cell_batches = data.n_cell_batches();
+    FECellIntegrator phi(data);
+
+    cached_F_inv.reinit(n_cell_batches, phi.n_q_points);
+    cached_tau.reinit(n_cell_batches, phi.n_q_points);
+    cached_Jc.reinit(n_cell_batches, phi.n_q_points);
+
+    const bool update_ghosts = (solution_total.has_ghost_elements() == false);
+    if (update_ghosts)
+      solution_total.update_ghost_values();
+
+    for (unsigned int cell = 0; cell < n_cell_batches; ++cell)
+      {
+        phi.reinit(cell);
+        // The total displacement satisfies the (inhomogeneous) Dirichlet
+        // constraints, so we read its values without resolving them.
+        phi.read_dof_values_plain(solution_total);
+        phi.evaluate(EvaluationFlags::gradients);
+
+        for (unsigned int q_point = 0; q_point < phi.n_q_points; ++q_point)
+          {
+            const Tensor<2,dim,VectorizedArrayType> grad_u_vect = phi.get_gradient(q_point);
+
+            for (unsigned int v = 0; v < data.n_active_entries_per_cell_batch(cell); ++v)
+              {
+                Tensor<2,dim> grad_u;
+                for (unsigned int i = 0; i < dim; ++i)
+                  for (unsigned int j = 0; j < dim; ++j)
+                    grad_u[i][j] = grad_u_vect[i][j][v];
+
+                const Tensor<2,dim> F = Physics::Elasticity::Kinematics::F(grad_u);
+                const double        det_F = determinant(F);
+                const Tensor<2,dim> F_bar = Physics::Elasticity::Kinematics::F_iso(F);
+                const SymmetricTensor<2,dim> b_bar = Physics::Elasticity::Kinematics::b(F_bar);
+                const Tensor<2,dim> F_inv = invert(F);
+                Assert(det_F > 0.0, ExcInternalError());
+
+                const SymmetricTensor<2,dim> tau = material->get_tau(det_F,b_bar);
+                const SymmetricTensor<4,dim> Jc  = material->get_Jc(det_F,b_bar);
+
+                for (unsigned int i = 0; i < dim; ++i)
+                  for (unsigned int j = 0; j < dim; ++j)
+                    cached_F_inv(cell, q_point)[i][j][v] = F_inv[i][j];
+                for (unsigned int i = 0; i < dim; ++i)
+                  for (unsigned int j = i; j < dim; ++j)
+                    {
+                      cached_tau(cell, q_point)[i][j][v] = tau[i][j];
+                      for (unsigned int k = 0; k < dim; ++k)
+                        for (unsigned int l = k; l < dim; ++l)
+                          cached_Jc(cell, q_point)[i][j][k][l][v] = Jc[i][j][k][l];
+                    }
+              }
+          }
+      }
+
+    if (update_ghosts)
+      solution_total.zero_out_ghost_values();
+  }
+
+
+  template <int dim,typename Number>
+  void NeoHookOperator<dim,Number>::do_cell_integral(FECellIntegrator &phi) const
+  {
+    const unsigned int cell = phi.get_current_cell_index();
+
+    phi.evaluate(EvaluationFlags::gradients);
+    for (unsigned int q_point = 0; q_point < phi.n_q_points; ++q_point)
+      {
+        const Tensor<2,dim,VectorizedArrayType> &F_inv = cached_F_inv(cell, q_point);
+        const Tensor<2,dim,VectorizedArrayType> grad_Nx_du = phi.get_gradient(q_point) * F_inv;
+        const SymmetricTensor<2,dim,VectorizedArrayType> symm_grad_Nx_du = symmetrize(grad_Nx_du);
+
+        // The material and geometrical stress contributions, expressed in the
+        // spatial setting...
+        const Tensor<2,dim,VectorizedArrayType> integrand_spatial
+          = Tensor<2,dim,VectorizedArrayType>(cached_Jc(cell, q_point) * symm_grad_Nx_du)
+            + grad_Nx_du * Tensor<2,dim,VectorizedArrayType>(cached_tau(cell, q_point));
+
+        // ...are pulled back so that they can be tested with the referential
+        // gradients of the shape functions.
+        phi.submit_gradient(integrand_spatial * transpose(F_inv), q_point);
+      }
+    phi.integrate(EvaluationFlags::gradients);
+  }
+
+
+  template <int dim,typename Number>
+  void NeoHookOperator<dim,Number>::local_apply_cell(
+    const MatrixFree<dim,Number>                &data,
+    VectorType                                  &dst,
+    const VectorType                            &src,
+    const std::pair<unsigned int, unsigned int> &cell_range) const
+  {
+    FECellIntegrator phi(data);
+
+    for (unsigned int cell = cell_range.first; cell < cell_range.second; ++cell)
+      {
+        phi.reinit(cell);
+        phi.read_dof_values(src);
+        do_cell_integral(phi);
+        phi.distribute_local_to_global(dst);
+      }
+  }
+
+
+  template <int dim,typename Number>
+  void NeoHookOperator<dim,Number>::apply_add(VectorType       &dst,
+                                              const VectorType &src) const
+  {
+    this->data->cell_loop(&NeoHookOperator::local_apply_cell, this, dst, src);
+  }
+
+
+// The inverse of the diagonal is required by the Chebyshev smoother that is
+// used within the multigrid preconditioner.
+  template <int dim,typename Number>
+  void NeoHookOperator<dim,Number>::compute_diagonal()
+  {
+    this->inverse_diagonal_entries.reset(new DiagonalMatrix<VectorType>());
+    VectorType &inverse_diagonal = this->inverse_diagonal_entries->get_vector();
+    this->data->initialize_dof_vector(inverse_diagonal);
+
+    MatrixFreeTools::compute_diagonal(*this->data,
+                                      inverse_diagonal,
+                                      &NeoHookOperator::do_cell_integral,
+                                      this);
+
+    this->set_constrained_entries_to_one(inverse_diagonal);
+
+    for (unsigned int i = 0; i < inverse_diagonal.locally_owned_size(); ++i)
+      {
+        Assert(inverse_diagonal.local_element(i) > 0.0,
+               ExcMessage("No diagonal entry in a positive definite operator "
+                          "should be zero or negative."));
+        inverse_diagonal.local_element(i) = 1.0 / inverse_diagonal.local_element(i);
+      }
+  }
+
+
 // @sect3{Quasi-static compressible finite-strain solid}
 
   // Forward declarations for classes that will
@@ -784,6 +1136,12 @@ namespace Cook_Membrane
     void
     run();
 
+    // Time the assembly of the linear system at the initial configuration
+    // and return the wall time per cell. The first assembly, during which the
+    // tapes of the taped AD formulation are recorded, is not timed.
+    double
+    time_assembly(const unsigned int n_repetitions);
+
   private:
 
     // We start the collection of member functions with one that builds the
@@ -809,10 +1167,25 @@ namespace Cook_Membrane
     friend struct Assembler_Base<dim,NumberType>;
     friend struct Assembler<dim,NumberType>;
 
+    // The assembler is kept for the whole simulation since the taped AD
+    // formulation stores its tapes there.
+    Assembler<dim,NumberType>        assembler;
+
     // Apply Dirichlet boundary conditions on the displacement field
     void
     make_constraints(const int &it_nr);
 
+    void
+    make_dirichlet_constraints(AffineConstraints<double> &dirichlet_constraints) const;
+
+    // Set up the matrix-free tangent operator, the multigrid hierarchy and
+    // the level operators, and linearise them about the current solution:
+    void
+    setup_matrix_free();
+
+    void
+    update_matrix_free_operators(const BlockVector<double> &solution_total);
+
     // Create and update the quadrature points. Here, no data needs to be
     // copied into a global object, so the copy_local_to_global function is
     // empty:
@@ -828,6 +1201,9 @@ namespace Cook_Membrane
     std::pair<unsigned int, double>
     solve_linear_system(BlockVector<double> &newton_update);
 
+    std::pair<unsigned int, double>
+    solve_linear_system_matrix_free(BlockVector<double> &newton_update);
+
     // Solution retrieval as well as post-processing and writing data to file:
     BlockVector<double>
     get_total_solution(const BlockVector<double> &solution_delta) const;
@@ -901,6 +1277,35 @@ namespace Cook_Membrane
     BlockVector<double>              system_rhs;
     BlockVector<double>              solution_n;
 
+    // If the tangent is applied in a matrix-free manner then the matrix and
+    // its sparsity pattern are never built. Instead, we keep the matrix-free
+    // operator (with its own homogeneous constraints) and the components of
+    // the geometric multigrid preconditioner: the level operators, the
+    // linearisation point transferred to each level and the transfer
+    // operator between levels. The multigrid object and the preconditioner
+    // built from it are set up once per mesh; only the smoothers, which
+    // depend on the diagonal and the eigenvalues of the level operators, are
+    // reinitialised whenever the operators are linearised anew.
+    typedef LinearAlgebra::distributed::Vector<double> VectorTypeMF;
+    typedef PreconditionChebyshev<NeoHookOperator<dim,double>, VectorTypeMF> SmootherTypeMF;
+
+    const MappingQ<dim>                        mapping_mf;
+    AffineConstraints<double>                  constraints_mf;
+    NeoHookOperator<dim,double>                tangent_operator_mf;
+    MGConstrainedDoFs                          mg_constrained_dofs;
+    MGLevelObject<NeoHookOperator<dim,double> > mg_tangent_operators;
+    MGLevelObject<VectorTypeMF>                mg_solution_total;
+    MGTransferMatrixFree<dim,double>           mg_transfer;
+    mg::SmootherRelaxation<SmootherTypeMF, VectorTypeMF> mg_smoother;
+    MGCoarseGridApplySmoother<VectorTypeMF>    mg_coarse;
+    mg::Matrix<VectorTypeMF>                   mg_matrix;
+    MGLevelObject<MatrixFreeOperators::MGInterfaceOperator<NeoHookOperator<dim,double> > >
+                                               mg_interface_matrices;
+    mg::Matrix<VectorTypeMF>                   mg_interface;
+    std::unique_ptr<Multigrid<VectorTypeMF> >  mg;
+    std::unique_ptr<PreconditionMG<dim, VectorTypeMF, MGTransferMatrixFree<dim,double> > >
+                                               mg_preconditioner;
+
     // Then define a number of variables to store norms and update norms and
     // normalisation factors.
     struct Errors
@@ -962,7 +1367,11 @@ namespace Cook_Membrane
     vol_current (0.0),
     triangulation(Triangulation<dim>::maximum_smoothing),
     time(parameters.end_time, parameters.delta_t),
+    // The assembly benchmark prints its own timings, so the summary of the
+    // timer is suppressed there.
     timer(std::cout,
+          parameters.benchmark_assembly ?
+          TimerOutput::never :
           TimerOutput::summary,
           TimerOutput::wall_times),
     degree(parameters.poly_degree),
@@ -976,7 +1385,8 @@ namespace Cook_Membrane
     qf_cell(parameters.quad_order),
     qf_face(parameters.quad_order),
     n_q_points (qf_cell.size()),
-    n_q_points_f (qf_face.size())
+    n_q_points_f (qf_face.size()),
+    mapping_mf(1)
   {
 
   }
@@ -1034,6 +1444,29 @@ namespace Cook_Membrane
   }
 
 
+// For the assembly benchmark we only build the problem and repeatedly
+// assemble the linear system for the first load step, with a zero
+// displacement field.
+  template <int dim,typename NumberType>
+  double Solid<dim,NumberType>::time_assembly(const unsigned int n_repetitions)
+  {
+    make_grid();
+    system_setup();
+    time.increment();
+
+    const BlockVector<double> solution_delta(dofs_per_block);
+    assemble_system(solution_delta);
+
+    Timer assembly_timer;
+    for (unsigned int n = 0; n < n_repetitions; ++n)
+      assemble_system(solution_delta);
+    assembly_timer.stop();
+
+    return assembly_timer.wall_time() /
+           (static_cast<double>(n_repetitions) * triangulation.n_active_cells());
+  }
+
+
 // @sect3{Private interface}
 
 // @sect4{Solid::make_grid}
@@ -1074,6 +1507,34 @@ namespace Cook_Membrane
     if (dim == 3)
       repetitions[dim-1] = 1;
 
+    // The geometric multigrid preconditioner used with the matrix-free
+    // tangent operator requires a hierarchy of meshes. We therefore start from
+    // a coarser subdivision and recover the requested number of elements per
+    // edge through global refinement. Since the transfer between the levels
+    // of FE_Q elements is only available for isotropic refinement, this also
+    // refines the mesh through the thickness in 3d, which then has
+    // $2^{n}$ elements through the thickness after $n$ refinements. The
+    // in-plane resolution is the same as in the matrix-based case, and since
+    // the z-displacement is fixed on both the +Z and -Z faces the solution
+    // does not vary through the thickness, so the additional layers only add
+    // degrees of freedom. To limit this overhead, we coarsen by at most two
+    // levels in 3d, which for the default 32 elements per edge still leaves
+    // a coarse mesh of only 8x8x1 cells.
+    unsigned int n_global_refinements = 0;
+    if (parameters.tangent_operator == "matrix-free")
+      {
+        const unsigned int max_global_refinements =
+          (dim == 3 ? 2 : numbers::invalid_unsigned_int);
+        while (repetitions[0] % 2 == 0 && repetitions[1] % 2 == 0 &&
+               repetitions[0] > 2 &&
+               n_global_refinements < max_global_refinements)
+          {
+            repetitions[0] /= 2;
+            repetitions[1] /= 2;
+            ++n_global_refinements;
+          }
+      }
+
     const Point<dim> bottom_left = (dim == 3 ? Point<dim>(0.0, 0.0, -0.5) : Point<dim>(0.0, 0.0));
     const Point<dim> top_right = (dim == 3 ? Point<dim>(48.0, 44.0, 0.5) : Point<dim>(48.0, 44.0));
 
@@ -1110,6 +1571,12 @@ namespace Cook_Membrane
 
     GridTools::scale(parameters.scale, triangulation);
 
+    // As the cells are straight-sided and the transformation above is
+    // bilinear, refining the transformed grid gives the same result as if
+    // the transformation was applied to the finest grid. The boundary IDs are
+    // inherited by the child faces.
+    triangulation.refine_global(n_global_refinements);
+
     vol_reference = GridTools::volume(triangulation);
     vol_current = vol_reference;
     std::cout << "Grid:\n\t Reference volume: " << vol_reference << std::endl;
@@ -1138,10 +1605,15 @@ namespace Cook_Membrane
     std::cout << "Triangulation:"
               << "\n\t Number of active cells: " << triangulation.n_active_cells()
               << "\n\t Number of degrees of freedom: " << dof_handler_ref.n_dofs()
+              << " (" << parameters.tangent_operator << " tangent)"
               << std::endl;
 
-    // Setup the sparsity pattern and tangent matrix
+    // Setup the sparsity pattern and tangent matrix, or the matrix-free data
+    // structures that replace them.
     tangent_matrix.clear();
+    if (parameters.tangent_operator == "matrix-free")
+      setup_matrix_free();
+    else
     {
       const types::global_dof_index n_dofs_u = dofs_per_block[u_dof];
 
@@ -1162,9 +1634,9 @@ namespace Cook_Membrane
                                       constraints,
                                       false);
       sparsity_pattern.copy_from(csp);
-    }
 
-    tangent_matrix.reinit(sparsity_pattern);
+      tangent_matrix.reinit(sparsity_pattern);
+    }
 
     // We then set up storage vectors
     system_rhs.reinit(dofs_per_block);
@@ -1181,6 +1653,176 @@ namespace Cook_Membrane
   }
 
 
+// @sect4{Solid::setup_matrix_free}
+// If the tangent is applied in a matrix-free manner, we set up the operator
+// on the active mesh as well as those on each level of the mesh hierarchy
+// for the geometric multigrid preconditioner (see step-37 for the details).
+// The level operators are constrained with the same Dirichlet conditions as
+// the active one.
+  template <int dim,typename NumberType>
+  void Solid<dim,NumberType>::setup_matrix_free()
+  {
+    dof_handler_ref.distribute_mg_dofs();
+
+    constraints_mf.clear();
+    make_dirichlet_constraints(constraints_mf);
+    constraints_mf.close();
+
+    const QGauss<1> qf_cell_1d(parameters.quad_order);
+
+    {
+      typename MatrixFree<dim,double>::AdditionalData additional_data;
+      additional_data.mapping_update_flags = (update_gradients |
+                                              update_JxW_values);
+      std::shared_ptr<MatrixFree<dim,double> > mf_storage(new MatrixFree<dim,double>());
+      mf_storage->reinit(mapping_mf, dof_handler_ref, constraints_mf,
+                         qf_cell_1d, additional_data);
+
+      tangent_operator_mf.clear();
+      tangent_operator_mf.initialize(mf_storage);
+      tangent_operator_mf.set_material(parameters.mu, parameters.nu);
+    }
+
+    const unsigned int n_levels = triangulation.n_global_levels();
+    std::cout << "\t Number of multigrid levels: " << n_levels
+              << "\n\t Number of degrees of freedom per level:";
+    for (unsigned int level = 0; level < n_levels; ++level)
+      std::cout << " " << dof_handler_ref.n_dofs(level);
+    std::cout << std::endl;
+
+    mg_tangent_operators.clear_elements();
+    mg_tangent_operators.resize(0, n_levels - 1);
+    mg_solution_total.resize(0, n_levels - 1);
+
+    mg_constrained_dofs.clear();
+    mg_constrained_dofs.initialize(dof_handler_ref);
+    mg_constrained_dofs.make_zero_boundary_constraints(dof_handler_ref,
+                                                       std::set<types::boundary_id>{1},
+                                                       fe.component_mask(u_fe));
+    if (dim == 3)
+      {
+        const FEValuesExtractors::Scalar z_displacement(2);
+        mg_constrained_dofs.make_zero_boundary_constraints(dof_handler_ref,
+                                                           std::set<types::boundary_id>{2},
+                                                           fe.component_mask(z_displacement));
+      }
+
+    for (unsigned int level = 0; level < n_levels; ++level)
+      {
+        IndexSet relevant_dofs;
+        DoFTools::extract_locally_relevant_level_dofs(dof_handler_ref,
+                                                      level,
+                                                      relevant_dofs);
+        AffineConstraints<double> level_constraints;
+        level_constraints.reinit(relevant_dofs);
+        level_constraints.add_lines(mg_constrained_dofs.get_boundary_indices(level));
+        level_constraints.close();
+
+        typename MatrixFree<dim,double>::AdditionalData additional_data;
+        additional_data.mapping_update_flags = (update_gradients |
+                                                update_JxW_values);
+        additional_data.mg_level = level;
+        std::shared_ptr<MatrixFree<dim,double> > mf_storage_level(new MatrixFree<dim,double>());
+        mf_storage_level->reinit(mapping_mf, dof_handler_ref, level_constraints,
+                                 qf_cell_1d, additional_data);
+
+        mg_tangent_operators[level].initialize(mf_storage_level,
+                                               mg_constrained_dofs,
+                                               level);
+        mg_tangent_operators[level].set_material(parameters.mu, parameters.nu);
+        mg_tangent_operators[level].initialize_dof_vector(mg_solution_total[level]);
+      }
+
+    mg_transfer.clear();
+    mg_transfer.initialize_constraints(mg_constrained_dofs);
+    mg_transfer.build(dof_handler_ref);
+
+    // The remaining components of the multigrid preconditioner only refer to
+    // the level operators and the transfer, so they can be put together here
+    // once for the whole simulation. The smoother on each level, which also
+    // serves as the coarse grid solver, is initialised with the level
+    // operators in update_matrix_free_operators().
+    mg_coarse.initialize(mg_smoother);
+    mg_matrix.initialize(mg_tangent_operators);
+
+    mg_interface_matrices.resize(0, n_levels - 1);
+    for (unsigned int level = 0; level < n_levels; ++level)
+      mg_interface_matrices[level].initialize(mg_tangent_operators[level]);
+    mg_interface.initialize(mg_interface_matrices);
+
+    mg.reset(new Multigrid<VectorTypeMF>(mg_matrix, mg_coarse, mg_transfer,
+                                         mg_smoother, mg_smoother));
+    mg->set_edge_matrices(mg_interface, mg_interface);
+
+    mg_preconditioner.reset(
+      new PreconditionMG<dim, VectorTypeMF, MGTransferMatrixFree<dim,double> >(
+        dof_handler_ref, *mg, mg_transfer));
+  }
+
+
+// @sect4{Solid::update_matrix_free_operators}
+// At each Newton iteration the matrix-free operators replace the assembly of
+// the tangent matrix by caching the quadrature point data that describes the
+// current linearisation point. The total displacement is interpolated onto
+// each level of the mesh hierarchy so that the level operators are linearised
+// consistently with that on the active mesh.
+//
+// Since the diagonal of the level operators changes with the linearisation,
+// the Chebyshev smoothers are then reinitialised. As in step-37, we use five
+// Chebyshev iterations on each level above the coarsest. On the coarsest
+// level, which is small, the Chebyshev iteration is used as an approximate
+// solver with a fixed degree and the eigenvalue range estimated by a bounded
+// number of CG iterations, so that neither the setup nor the application of
+// the coarse grid solver grows with the size of the problem.
+  template <int dim,typename NumberType>
+  void Solid<dim,NumberType>::update_matrix_free_operators(const BlockVector<double> &solution_total)
+  {
+    VectorTypeMF solution_total_mf;
+    tangent_operator_mf.initialize_dof_vector(solution_total_mf);
+    for (types::global_dof_index i = 0; i < solution_total.size(); ++i)
+      solution_total_mf(i) = solution_total(i);
+
+    tangent_operator_mf.cache(solution_total_mf);
+
+    mg_transfer.interpolate_to_mg(dof_handler_ref,
+                                  mg_solution_total,
+                                  solution_total_mf);
+
+    for (unsigned int level = mg_tangent_operators.min_level();
+         level <= mg_tangent_operators.max_level(); ++level)
+      {
+        mg_tangent_operators[level].cache(mg_solution_total[level]);
+        mg_tangent_operators[level].compute_diagonal();
+      }
+
+    MGLevelObject<typename SmootherTypeMF::AdditionalData> smoother_data;
+    smoother_data.resize(mg_tangent_operators.min_level(),
+                         mg_tangent_operators.max_level());
+    for (unsigned int level = mg_tangent_operators.min_level();
+         level <= mg_tangent_operators.max_level(); ++level)
+      {
+        if (level > 0)
+          {
+            smoother_data[level].smoothing_range = 15.;
+            smoother_data[level].degree = 5;
+            smoother_data[level].eig_cg_n_iterations = 10;
+          }
+        else
+          {
+            // A smoothing range below one uses the estimated smallest
+            // eigenvalue as the lower end of the range:
+            smoother_data[0].smoothing_range = 0.;
+            smoother_data[0].degree = 30;
+            smoother_data[0].eig_cg_n_iterations =
+              std::min<unsigned int>(mg_tangent_operators[0].m(), 60);
+          }
+        smoother_data[level].preconditioner =
+          mg_tangent_operators[level].get_matrix_diagonal_inverse();
+      }
+    mg_smoother.initialize(mg_tangent_operators, smoother_data);
+  }
+
+
 // @sect4{Solid::setup_qph}
 // The method used to store quadrature information is already described in
 // step-18 and step-44. Here we implement a similar setup for a SMP machine.
@@ -1596,10 +2238,18 @@ namespace Cook_Membrane
       BlockSparseMatrix<double> &tangent_matrix = const_cast<Solid<dim,NumberType> *>(data.solid)->tangent_matrix;
       BlockVector<double> &system_rhs =  const_cast<Solid<dim,NumberType> *>(data.solid)->system_rhs;
 
-      constraints.distribute_local_to_global(
-        data.cell_matrix, data.cell_rhs,
-        data.local_dof_indices,
-        tangent_matrix, system_rhs);
+      // When using the matrix-free tangent operator the residual is the only
+      // quantity that is assembled.
+      if (data.solid->parameters.tangent_operator == "matrix-free")
+        constraints.distribute_local_to_global(
+          data.cell_rhs,
+          data.local_dof_indices,
+          system_rhs);
+      else
+        constraints.distribute_local_to_global(
+          data.cell_matrix, data.cell_rhs,
+          data.local_dof_indices,
+          tangent_matrix, system_rhs);
     }
 
   protected:
@@ -1700,6 +2350,9 @@ namespace Cook_Membrane
       const FESystem<dim> &fe = data.solid->fe;
       const unsigned int &u_dof = data.solid->u_dof;
       const FEValuesExtractors::Vector &u_fe = data.solid->u_fe;
+      // The tangent matrix contribution is not needed if the linearisation is
+      // applied in a matrix-free fashion.
+      const bool assemble_tangent = (data.solid->parameters.tangent_operator != "matrix-free");
 
       data.reset();
       scratch.reset();
@@ -1766,6 +2419,9 @@ namespace Cook_Membrane
               else
                 Assert(i_group <= u_dof, ExcInternalError());
 
+              if (assemble_tangent == false)
+                continue;
+
               for (unsigned int j = 0; j <= i; ++j)
                 {
                   const unsigned int component_j = fe.system_to_component_index(j).first;
@@ -2005,6 +2661,132 @@ namespace Cook_Membrane
 #endif
 
 
+#ifdef ENABLE_ADOLC_TAPED_FORMULATION
+
+  // The taped formulation does not record the operations of a whole cell,
+  // since such a tape would be tied to the geometry of that cell. Instead,
+  // the strain energy function is recorded once per material, with the
+  // deformation gradient $\mathbf{F}$ as the independent variable. This tape
+  // is then replayed at every quadrature point, in every cell and Newton
+  // iteration, with the current value of $\mathbf{F}$. Its gradient and
+  // Hessian are the first Piola-Kirchhoff stress $\mathbf{P} = \frac{\partial
+  // \Psi}{\partial \mathbf{F}}$ and the material tangent $\mathcal{A} =
+  // \frac{\partial \mathbf{P}}{\partial \mathbf{F}}$, and the residual and
+  // its linearisation are assembled in the reference configuration as
+  // $\int_{\Omega_0} \textrm{Grad}\,\delta\mathbf{u} : \mathbf{P} \; dV$ and
+  // $\int_{\Omega_0} \textrm{Grad}\,\delta\mathbf{u} : \mathcal{A} :
+  // \textrm{Grad}\,d\mathbf{u} \; dV$.
+  typedef Differentiation::AD::NumberTraits<double,Differentiation::AD::NumberTypes::adolc_taped>::ad_type ADTapedNumberType;
+
+  template <int dim>
+  struct Assembler<dim,ADTapedNumberType> : Assembler_Base<dim,ADTapedNumberType>
+  {
+    typedef ADTapedNumberType ADNumberType;
+    typedef Differentiation::AD::ScalarFunction<dim,Differentiation::AD::NumberTypes::adolc_taped,double> ADHelper;
+    using typename Assembler_Base<dim,ADNumberType>::ScratchData_ASM;
+    using typename Assembler_Base<dim,ADNumberType>::PerTaskData_ASM;
+
+    Assembler()
+      :
+      F_dofs(0),
+      ad_helper(Tensor<2,dim>::n_independent_components)
+    {}
+
+    virtual ~Assembler() {}
+
+    virtual void
+    assemble_system_tangent_residual_one_cell(const typename DoFHandler<dim>::active_cell_iterator &cell,
+                                              ScratchData_ASM &scratch,
+                                              PerTaskData_ASM &data) override
+    {
+      // Aliases for data referenced from the Solid class
+      const unsigned int &n_q_points = data.solid->n_q_points;
+      const unsigned int &dofs_per_cell = data.solid->dofs_per_cell;
+      const FEValuesExtractors::Vector &u_fe = data.solid->u_fe;
+
+      // The AD data in the scratch object is not used, so it need not be
+      // reset.
+      data.reset();
+      scratch.fe_values_ref.reinit(cell);
+      cell->get_dof_indices(data.local_dof_indices);
+
+      const std::vector<std::shared_ptr<const PointHistory<dim,ADNumberType> > > lqph =
+        data.solid->quadrature_point_history.get_data(cell);
+      Assert(lqph.size() == n_q_points, ExcInternalError());
+
+      // Only the material response is evaluated through the tape, so the
+      // displacement gradients are computed with plain doubles.
+      std::vector<Tensor<2,dim> > solution_grads_u(n_q_points);
+      scratch.fe_values_ref[u_fe].get_function_gradients(scratch.solution_total,
+                                                         solution_grads_u);
+
+      // Tape index 0 is reserved, hence the offset.
+      const unsigned int tape_index = cell->material_id() + 1;
+      std::vector<Tensor<2,dim> > Grad_Nx(dofs_per_cell);
+      for (unsigned int q_point = 0; q_point < n_q_points; ++q_point)
+        {
+          const Tensor<2,dim> F = Physics::Elasticity::Kinematics::F(solution_grads_u[q_point]);
+          Assert(determinant(F) > 0.0, ExcInternalError());
+
+          // The strain energy function is recorded only if there is no tape
+          // for this material yet; otherwise the tape is replayed at the
+          // current value of the deformation gradient.
+          const bool is_recording = ad_helper.start_recording_operations(tape_index);
+          if (is_recording == true)
+            {
+              ad_helper.register_independent_variable(F, F_dofs);
+              const Tensor<2,dim,ADNumberType> F_ad = ad_helper.get_sensitive_variables(F_dofs);
+              const ADNumberType               det_F = determinant(F_ad);
+              const Tensor<2,dim,ADNumberType> F_bar = Physics::Elasticity::Kinematics::F_iso(F_ad);
+              const SymmetricTensor<2,dim,ADNumberType> b_bar = Physics::Elasticity::Kinematics::b(F_bar);
+
+              ad_helper.register_dependent_variable(lqph[q_point]->get_Psi(det_F,b_bar));
+              ad_helper.stop_recording_operations(false /*write_tapes_to_file*/);
+            }
+          else
+            {
+              ad_helper.activate_recorded_tape(tape_index);
+              ad_helper.set_independent_variable(F, F_dofs);
+            }
+
+          Vector<double>     Dpsi(ad_helper.n_independent_variables());
+          FullMatrix<double> D2psi(ad_helper.n_independent_variables(),
+                                   ad_helper.n_independent_variables());
+          ad_helper.compute_gradient(Dpsi);
+          ad_helper.compute_hessian(D2psi);
+          const Tensor<2,dim> P = ADHelper::extract_gradient_component(Dpsi, F_dofs);
+          const Tensor<4,dim> A = ADHelper::extract_hessian_component(D2psi, F_dofs, F_dofs);
+
+          for (unsigned int k = 0; k < dofs_per_cell; ++k)
+            Grad_Nx[k] = scratch.fe_values_ref[u_fe].gradient(k, q_point);
+          const double JxW = scratch.fe_values_ref.JxW(q_point);
+
+          // The material tangent has major symmetry, so again only the lower
+          // half of the local matrix is built.
+          for (unsigned int i = 0; i < dofs_per_cell; ++i)
+            {
+              data.cell_rhs(i) -= scalar_product(Grad_Nx[i], P) * JxW; // RHS = - residual
+
+              const Tensor<2,dim> A_Grad_Ni = double_contract<2,0,3,1>(A, Grad_Nx[i]);
+              for (unsigned int j = 0; j <= i; ++j)
+                data.cell_matrix(i, j) += scalar_product(Grad_Nx[j], A_Grad_Ni) * JxW;
+            }
+        }
+
+      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+        for (unsigned int j = i + 1; j < dofs_per_cell; ++j)
+          data.cell_matrix(i, j) = data.cell_matrix(j, i);
+    }
+
+  private:
+    const FEValuesExtractors::Tensor<2> F_dofs;
+    ADHelper                            ad_helper;
+  };
+
+
+#endif
+
+
 // Since we use TBB for assembly, we simply setup a copy of the
 // data structures required for the process and pass them, along
 // with the memory addresses of the assembly functions to the
@@ -2014,9 +2796,11 @@ namespace Cook_Membrane
   void Solid<dim,NumberType>::assemble_system(const BlockVector<double> &solution_delta)
   {
     timer.enter_subsection("Assemble linear system");
-    std::cout << " ASM " << std::flush;
+    if (parameters.benchmark_assembly == false)
+      std::cout << " ASM " << std::flush;
 
-    tangent_matrix = 0.0;
+    if (parameters.tangent_operator != "matrix-free")
+      tangent_matrix = 0.0;
     system_rhs = 0.0;
 
     const UpdateFlags uf_cell(update_gradients |
@@ -2027,7 +2811,6 @@ namespace Cook_Membrane
     const BlockVector<double> solution_total(get_total_solution(solution_delta));
     typename Assembler_Base<dim,NumberType>::PerTaskData_ASM per_task_data(this);
     typename Assembler_Base<dim,NumberType>::ScratchData_ASM scratch_data(fe, qf_cell, uf_cell, qf_face, uf_face, solution_total);
-    Assembler<dim,NumberType> assembler;
 
     WorkStream::run(dof_handler_ref.begin_active(),
                     dof_handler_ref.end(),
@@ -2037,6 +2820,11 @@ namespace Cook_Membrane
                     scratch_data,
                     per_task_data);
 
+    // In place of the tangent matrix, the matrix-free operators are
+    // linearised about the current solution.
+    if (parameters.tangent_operator == "matrix-free")
+      update_matrix_free_operators(solution_total);
+
     timer.leave_subsection();
   }
 
@@ -2081,29 +2869,7 @@ namespace Cook_Membrane
     if (apply_dirichlet_bc)
     {
       constraints.clear();
-
-      // Fixed left hand side of the beam
-      {
-        const int boundary_id = 1;
-        VectorTools::interpolate_boundary_values(dof_handler_ref,
-                                                boundary_id,
-                                                Functions::ZeroFunction<dim>(n_components),
-                                                constraints,
-                                                fe.component_mask(u_fe));
-      }
-
-      // Zero Z-displacement through thickness direction
-      // This corresponds to a plane strain condition being imposed on the beam
-      if (dim == 3)
-      {
-        const int boundary_id = 2;
-        const FEValuesExtractors::Scalar z_displacement(2);
-        VectorTools::interpolate_boundary_values(dof_handler_ref,
-                                                boundary_id,
-                                                Functions::ZeroFunction<dim>(n_components),
-                                                constraints,
-                                                fe.component_mask(z_displacement));
-      }
+      make_dirichlet_constraints(constraints);
     }
     else
     {
@@ -2121,6 +2887,35 @@ namespace Cook_Membrane
     constraints.close();
   }
 
+// The Dirichlet constraints themselves are collected in a separate function,
+// as the matrix-free operator requires its own copy of them.
+  template <int dim,typename NumberType>
+  void Solid<dim,NumberType>::make_dirichlet_constraints(AffineConstraints<double> &dirichlet_constraints) const
+  {
+    // Fixed left hand side of the beam
+    {
+      const int boundary_id = 1;
+      VectorTools::interpolate_boundary_values(dof_handler_ref,
+                                              boundary_id,
+                                              Functions::ZeroFunction<dim>(n_components),
+                                              dirichlet_constraints,
+                                              fe.component_mask(u_fe));
+    }
+
+    // Zero Z-displacement through thickness direction
+    // This corresponds to a plane strain condition being imposed on the beam
+    if (dim == 3)
+    {
+      const int boundary_id = 2;
+      const FEValuesExtractors::Scalar z_displacement(2);
+      VectorTools::interpolate_boundary_values(dof_handler_ref,
+                                              boundary_id,
+                                              Functions::ZeroFunction<dim>(n_components),
+                                              dirichlet_constraints,
+                                              fe.component_mask(z_displacement));
+    }
+  }
+
 // @sect4{Solid::solve_linear_system}
 // As the system is composed of a single block, defining a solution scheme
 // for the linear problem is straight-forward.
@@ -2128,6 +2923,9 @@ namespace Cook_Membrane
   std::pair<unsigned int, double>
   Solid<dim,NumberType>::solve_linear_system(BlockVector<double> &newton_update)
   {
+    if (parameters.tangent_operator == "matrix-free")
+      return solve_linear_system_matrix_free(newton_update);
+
     BlockVector<double> A(dofs_per_block);
     BlockVector<double> B(dofs_per_block);
 
@@ -2194,6 +2992,60 @@ namespace Cook_Membrane
     return std::make_pair(lin_it, lin_res);
   }
 
+// @sect4{Solid::solve_linear_system_matrix_free}
+// When the tangent is not assembled, the linear system is solved with the
+// CG method using the geometric multigrid V-cycle set up in
+// setup_matrix_free() and update_matrix_free_operators() as preconditioner.
+// The right-hand side and solution are copied between the block vectors used
+// elsewhere in this program and the vector type required by the matrix-free
+// framework.
+  template <int dim,typename NumberType>
+  std::pair<unsigned int, double>
+  Solid<dim,NumberType>::solve_linear_system_matrix_free(BlockVector<double> &newton_update)
+  {
+    unsigned int lin_it = 0;
+    double lin_res = 0.0;
+
+    {
+      timer.enter_subsection("Linear solver");
+      std::cout << " SLV " << std::flush;
+
+      VectorTypeMF newton_update_mf;
+      VectorTypeMF system_rhs_mf;
+      tangent_operator_mf.initialize_dof_vector(newton_update_mf);
+      tangent_operator_mf.initialize_dof_vector(system_rhs_mf);
+      for (types::global_dof_index i = 0; i < system_rhs.block(u_dof).size(); ++i)
+        system_rhs_mf(i) = system_rhs.block(u_dof)(i);
+      constraints_mf.set_zero(system_rhs_mf);
+
+      const int solver_its = static_cast<unsigned int>(
+                                tangent_operator_mf.m()
+                                * parameters.max_iterations_lin);
+      const double tol_sol = parameters.tol_lin
+                             * system_rhs_mf.l2_norm();
+
+      SolverControl solver_control(solver_its, tol_sol);
+      SolverCG<VectorTypeMF> solver_CG(solver_control);
+      solver_CG.solve(tangent_operator_mf,
+                      newton_update_mf,
+                      system_rhs_mf,
+                      *mg_preconditioner);
+
+      lin_it = solver_control.last_step();
+      lin_res = solver_control.last_value();
+
+      for (types::global_dof_index i = 0; i < newton_update.block(u_dof).size(); ++i)
+        newton_update.block(u_dof)(i) = newton_update_mf(i);
+
+      timer.leave_subsection();
+    }
+
+    // As before, we distribute the constraints back to the Newton update:
+    constraints.distribute(newton_update);
+
+    return std::make_pair(lin_it, lin_res);
+  }
+
 // @sect4{Solid::output_results}
 // Here we present how the results are written to file to be viewed
 // using ParaView or Visit. The method is similar to that shown in the
@@ -2235,6 +3087,80 @@ namespace Cook_Membrane
     data_out.write_vtk(output);
   }
 
+
+// @sect3{Assembly benchmark}
+
+// The assembly benchmark times the assembly of the linear system with each of
+// the available assembly methods, for each of the given polynomial degrees
+// (with a quadrature order of one more than the degree). The timings are
+// printed once all configurations are done and written to
+// <code>assembly_benchmark.csv</code>.
+  template <int dim,typename NumberType>
+  double time_assembly_per_cell(const Parameters::AllParameters &parameters)
+  {
+    Solid<dim,NumberType> solid(parameters);
+    return solid.time_assembly(parameters.benchmark_repetitions);
+  }
+
+  template <int dim>
+  void run_assembly_benchmark(const Parameters::AllParameters &parameters)
+  {
+    // Each method is described by its name, its automatic differentiation
+    // order and whether the AD is taped.
+    struct Method
+    {
+      std::string  name;
+      unsigned int ad_order;
+      bool         taped;
+    };
+    std::vector<Method> methods = {{"manual", 0, false}};
+#ifdef ENABLE_SACADO_FORMULATION
+    methods.push_back({"AD-linearisation", 1, false});
+    methods.push_back({"AD-residual-linearisation", 2, false});
+#endif
+#ifdef ENABLE_ADOLC_TAPED_FORMULATION
+    methods.push_back({"taped-AD", 2, true});
+#endif
+
+    std::ostringstream summary;
+    std::ofstream csv("assembly_benchmark.csv");
+    csv << "method,degree,time_per_cell" << std::endl;
+    for (const unsigned int degree : parameters.benchmark_poly_degrees)
+      for (const Method &method : methods)
+        {
+          Parameters::AllParameters parameters_method(parameters);
+          parameters_method.poly_degree = degree;
+          parameters_method.quad_order = degree + 1;
+          parameters_method.automatic_differentiation_order = method.ad_order;
+          parameters_method.taped_automatic_differentiation = method.taped;
+          parameters_method.tangent_operator = "matrix-based";
+
+          double time_per_cell = 0.0;
+          if (method.ad_order == 0)
+            time_per_cell = time_assembly_per_cell<dim,double>(parameters_method);
+#ifdef ENABLE_SACADO_FORMULATION
+          else if (method.ad_order == 1)
+            time_per_cell = time_assembly_per_cell<dim,Sacado::Fad::DFad<double> >(parameters_method);
+          else if (method.taped == false)
+            time_per_cell = time_assembly_per_cell<dim,Sacado::Rad::ADvar<Sacado::Fad::DFad<double> > >(parameters_method);
+#endif
+#ifdef ENABLE_ADOLC_TAPED_FORMULATION
+          else
+            time_per_cell = time_assembly_per_cell<dim,ADTapedNumberType>(parameters_method);
+#endif
+
+          summary << std::setw(28) << std::left << method.name
+                  << "Q" << degree << "   " << std::scientific
+                  << std::setprecision(3) << time_per_cell << " s" << std::endl;
+          csv << method.name << "," << degree << "," << time_per_cell << std::endl;
+        }
+
+    std::cout << std::endl
+              << "Assembly time per cell (" << parameters.benchmark_repetitions
+              << " assemblies, one thread):" << std::endl
+              << summary.str() << std::endl;
+  }
+
 }
 
 
@@ -2251,7 +3177,18 @@ int main (int argc, char *argv[])
     {
       deallog.depth_console(0);
       Parameters::AllParameters parameters("parameters.prm");
-      if (parameters.automatic_differentiation_order == 0)
+      if (parameters.benchmark_assembly)
+        {
+          std::cout << "Assembly benchmark: All available assembly methods are timed." << std::endl;
+
+          // The reverse-mode and taped AD formulations are not thread-safe,
+          // so all methods are timed using a single thread.
+          Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv,
+                                                              1);
+
+          run_assembly_benchmark<dim>(parameters);
+        }
+      else if (parameters.automatic_differentiation_order == 0)
         {
           std::cout << "Assembly method: Residual and linearisation are computed manually." << std::endl;
 
@@ -2276,7 +3213,8 @@ int main (int argc, char *argv[])
           Solid<dim,NumberType> solid_3d(parameters);
           solid_3d.run();
         }
-      else if (parameters.automatic_differentiation_order == 2)
+      else if (parameters.automatic_differentiation_order == 2 &&
+               parameters.taped_automatic_differentiation == false)
         {
           std::cout << "Assembly method: Residual and linearisation computed using AD." << std::endl;
 
@@ -2289,13 +3227,29 @@ int main (int argc, char *argv[])
           Solid<dim,NumberType> solid_3d(parameters);
           solid_3d.run();
         }
+#endif
+#ifdef ENABLE_ADOLC_TAPED_FORMULATION
+      else if (parameters.automatic_differentiation_order == 2 &&
+               parameters.taped_automatic_differentiation == true)
+        {
+          std::cout << "Assembly method: Residual and linearisation computed using taped AD." << std::endl;
+
+          // ADOL-C is not thread-safe either.
+          Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv,
+                                                              1);
+
+          typedef ADTapedNumberType NumberType;
+          Solid<dim,NumberType> solid_3d(parameters);
+          solid_3d.run();
+        }
 #endif
       else
         {
           AssertThrow(false,
                       ExcMessage("The selected assembly method is not supported. "
                                  "You need deal.II 9.0 and Trilinos with the Sacado package "
-                                 "to enable assembly using automatic differentiation."));
+                                 "to enable assembly using automatic differentiation, "
+                                 "or ADOL-C for the taped formulation."));
         }
     }
   catch (std::exception &exc)
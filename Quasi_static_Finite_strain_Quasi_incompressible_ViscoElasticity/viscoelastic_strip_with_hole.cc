@@ -52,6 +52,7 @@
 #include <deal.II/lac/trilinos_sparsity_pattern.h>
 #include <deal.II/lac/trilinos_sparse_matrix.h>
 #include <deal.II/lac/trilinos_vector.h>
+#include <deal.II/lac/vector.h>
 #include <deal.II/lac/linear_operator.h>
 #include <deal.II/lac/packaged_operation.h>
 #include <deal.II/lac/trilinos_linear_operator.h>
@@ -283,6 +284,8 @@ namespace ViscoElasStripHole
       std::string type_lin;
       double      tol_lin;
       double      max_iterations_lin;
+      bool        cache_condensation_operators;
+      double      preconditioner_refresh_factor;
       static void
       declare_parameters(ParameterHandler &prm);
       void
@@ -301,6 +304,16 @@ namespace ViscoElasStripHole
         prm.declare_entry("Max iteration multiplier", "1",
                           Patterns::Double(1.0),
                           "Linear solver iterations (multiples of the system matrix size)");
+        prm.declare_entry("Cache condensation operators", "false",
+                          Patterns::Bool(),
+                          "Invert the cell-local dilatation-pressure coupling blocks "
+                          "directly and retain the AMG preconditioner for the condensed "
+                          "displacement system between Newton iterations of a timestep");
+        prm.declare_entry("Preconditioner refresh factor", "1.5",
+                          Patterns::Double(1.0),
+                          "Rebuild a retained preconditioner once the number of linear "
+                          "solver iterations exceeds this multiple of that attained "
+                          "directly after it was last built");
       }
       prm.leave_subsection();
     }
@@ -311,6 +324,8 @@ namespace ViscoElasStripHole
         type_lin = prm.get("Solver type");
         tol_lin = prm.get_double("Residual");
         max_iterations_lin = prm.get_double("Max iteration multiplier");
+        cache_condensation_operators = prm.get_bool("Cache condensation operators");
+        preconditioner_refresh_factor = prm.get_double("Preconditioner refresh factor");
       }
       prm.leave_subsection();
     }
@@ -677,6 +692,13 @@ namespace ViscoElasStripHole
     void
     copy_local_to_global_system(const PerTaskData_ASM &data);
     void
+    copy_local_condensation_data(const PerTaskData_ASM &data,
+                                 const unsigned int     cell_index);
+    void
+    apply_local_K_Jp_inv(LA::MPI::Vector       &dst,
+                         const LA::MPI::Vector &src,
+                         const bool             transpose) const;
+    void
     make_constraints(const int &it_nr);
     void
     setup_qph();
@@ -747,6 +769,21 @@ namespace ViscoElasStripHole
     LA::BlockSparseMatrix     tangent_matrix;
     LA::MPI::BlockVector      system_rhs;
     LA::MPI::BlockVector      solution_n;
+
+    // Static condensation data: As the pressure and dilatation fields are
+    // discontinuous, the K_Jp block is block-diagonal and its inverse can be
+    // computed cell-by-cell. The local inverses of all locally owned cells
+    // are stored contiguously, along with the (block-local) indices of the
+    // pressure and dilatation DoFs they act on. The AMG preconditioner for
+    // the condensed displacement system may be retained between Newton
+    // iterations, in which case we record the number of linear solver
+    // iterations required directly after it was last built.
+    std::vector<double>                  local_K_Jp_inv;
+    std::vector<types::global_dof_index> local_dof_indices_p;
+    std::vector<types::global_dof_index> local_dof_indices_J;
+    LA::PreconditionAMG                  preconditioner_K_con_inv;
+    bool                                 rebuild_preconditioner_K_con_inv;
+    unsigned int                         lin_it_preconditioner_K_con_inv;
     struct Errors
     {
       Errors()
@@ -814,7 +851,9 @@ namespace ViscoElasStripHole
     qf_cell(parameters.quad_order),
     qf_face(parameters.quad_order),
     n_q_points (qf_cell.size()),
-    n_q_points_f (qf_face.size())
+    n_q_points_f (qf_face.size()),
+    rebuild_preconditioner_K_con_inv (true),
+    lin_it_preconditioner_K_con_inv (0)
   {
     Assert(dim==2 || dim==3, ExcMessage("This problem only works in 2 or 3 space dimensions."));
     determine_component_extractors();
@@ -1422,6 +1461,22 @@ namespace ViscoElasStripHole
                       mpi_communicator);
     solution_delta.reinit(locally_owned_partitioning,
                           mpi_communicator);
+
+    if (parameters.cache_condensation_operators)
+      {
+        const unsigned int n_cells_owned
+          = GridTools::count_cells_with_subdomain_association(triangulation,
+                                                              this_mpi_process);
+        Assert(element_indices_p.size() == element_indices_J.size(),
+               ExcInternalError());
+        local_K_Jp_inv.resize(n_cells_owned
+                              * element_indices_p.size()
+                              * element_indices_J.size());
+        local_dof_indices_p.resize(n_cells_owned * element_indices_p.size());
+        local_dof_indices_J.resize(n_cells_owned * element_indices_J.size());
+      }
+    rebuild_preconditioner_K_con_inv = true;
+
     setup_qph();
     timer.leave_subsection();
   }
@@ -1479,6 +1534,8 @@ namespace ViscoElasStripHole
           << time.end() << "s" << std::endl;
     LA::MPI::BlockVector newton_update(locally_owned_partitioning,
                                        mpi_communicator);
+    // Any retained preconditioner is only reused within a timestep
+    rebuild_preconditioner_K_con_inv = true;
     error_residual.reset();
     error_residual_0.reset();
     error_residual_norm.reset();
@@ -1659,11 +1716,13 @@ namespace ViscoElasStripHole
           dof_handler.begin_active()),
                                    endc (IteratorFilters::SubdomainEqualTo(this_mpi_process),
                                          dof_handler.end());
-    for (; cell != endc; ++cell)
+    for (unsigned int cell_index = 0; cell != endc; ++cell, ++cell_index)
       {
         Assert(cell->subdomain_id()==this_mpi_process, ExcInternalError());
         assemble_system_one_cell(cell, scratch_data, per_task_data);
         copy_local_to_global_system(per_task_data);
+        if (parameters.cache_condensation_operators)
+          copy_local_condensation_data(per_task_data, cell_index);
       }
     tangent_matrix.compress(VectorOperation::add);
     system_rhs.compress(VectorOperation::add);
@@ -1677,6 +1736,77 @@ namespace ViscoElasStripHole
                                            tangent_matrix, system_rhs);
   }
   template <int dim>
+  void Solid<dim>::copy_local_condensation_data(const PerTaskData_ASM &data,
+                                                const unsigned int     cell_index)
+  {
+    const unsigned int n_p = element_indices_p.size();
+    const unsigned int n_J = element_indices_J.size();
+    const types::global_dof_index offset_p = dofs_per_block[u_block];
+    const types::global_dof_index offset_J = dofs_per_block[u_block]
+                                             + dofs_per_block[p_block];
+    Assert((cell_index + 1) * n_p * n_J <= local_K_Jp_inv.size(),
+           ExcIndexRange(cell_index, 0, local_K_Jp_inv.size() / (n_p * n_J)));
+
+    FullMatrix<double> k_Jp (n_J, n_p);
+    FullMatrix<double> k_Jp_inv (n_p, n_J);
+    for (unsigned int i = 0; i < n_J; ++i)
+      for (unsigned int j = 0; j < n_p; ++j)
+        k_Jp(i, j) = data.cell_matrix(element_indices_J[i], element_indices_p[j]);
+    k_Jp_inv.invert(k_Jp);
+
+    double *const k_Jp_inv_cell = &local_K_Jp_inv[cell_index * n_p * n_J];
+    for (unsigned int i = 0; i < n_p; ++i)
+      for (unsigned int j = 0; j < n_J; ++j)
+        k_Jp_inv_cell[i * n_J + j] = k_Jp_inv(i, j);
+
+    for (unsigned int k = 0; k < n_p; ++k)
+      local_dof_indices_p[cell_index * n_p + k]
+        = data.local_dof_indices[element_indices_p[k]] - offset_p;
+    for (unsigned int k = 0; k < n_J; ++k)
+      local_dof_indices_J[cell_index * n_J + k]
+        = data.local_dof_indices[element_indices_J[k]] - offset_J;
+  }
+  template <int dim>
+  void Solid<dim>::apply_local_K_Jp_inv(LA::MPI::Vector       &dst,
+                                        const LA::MPI::Vector &src,
+                                        const bool             transpose) const
+  {
+    // Computes dst = K_Jp^{-1} src (mapping the dilatation to the pressure
+    // space) or, if requested, its transpose. Every pressure and dilatation
+    // DoF is associated with exactly one cell, which is also its owner.
+    const unsigned int n_p = element_indices_p.size();
+    const unsigned int n_J = element_indices_J.size();
+    const unsigned int n_cells = (n_p * n_J > 0 ? local_K_Jp_inv.size() / (n_p * n_J) : 0);
+    const std::vector<types::global_dof_index> &src_indices
+      = (transpose ? local_dof_indices_p : local_dof_indices_J);
+    const std::vector<types::global_dof_index> &dst_indices
+      = (transpose ? local_dof_indices_J : local_dof_indices_p);
+    const unsigned int n_src = (transpose ? n_p : n_J);
+    const unsigned int n_dst = (transpose ? n_J : n_p);
+
+    Vector<double> src_cell (n_src);
+    Vector<double> dst_cell (n_dst);
+    dst = 0.0;
+    for (unsigned int cell_index = 0; cell_index < n_cells; ++cell_index)
+      {
+        const double *const k_Jp_inv_cell = &local_K_Jp_inv[cell_index * n_p * n_J];
+        for (unsigned int k = 0; k < n_src; ++k)
+          src_cell(k) = src(src_indices[cell_index * n_src + k]);
+
+        dst_cell = 0.0;
+        for (unsigned int i = 0; i < n_p; ++i)
+          for (unsigned int j = 0; j < n_J; ++j)
+            if (transpose)
+              dst_cell(j) += k_Jp_inv_cell[i * n_J + j] * src_cell(i);
+            else
+              dst_cell(i) += k_Jp_inv_cell[i * n_J + j] * src_cell(j);
+
+        for (unsigned int k = 0; k < n_dst; ++k)
+          dst(dst_indices[cell_index * n_dst + k]) = dst_cell(k);
+      }
+    dst.compress(VectorOperation::insert);
+  }
+  template <int dim>
   void
   Solid<dim>::assemble_system_one_cell(const typename DoFHandler<dim>::active_cell_iterator &cell,
                                        ScratchData_ASM &scratch,
@@ -1972,29 +2102,65 @@ namespace ViscoElasStripHole
     const auto K_JJ = linear_operator<LA::MPI::Vector>(tangent_matrix.block(J_block, J_block));
 
     LA::PreconditionJacobi preconditioner_K_Jp_inv;
-    preconditioner_K_Jp_inv.initialize(
-      tangent_matrix.block(J_block, p_block),
-      LA::PreconditionJacobi::AdditionalData());
     ReductionControl solver_control_K_Jp_inv (
       static_cast<unsigned int>(tangent_matrix.block(J_block, p_block).m() 
                                 * parameters.max_iterations_lin),
       1.0e-30, 1e-6);
     dealii::SolverCG<LA::MPI::Vector> solver_K_Jp_inv (solver_control_K_Jp_inv);
 
-    const auto K_Jp_inv = inverse_operator(K_Jp,
-                                           solver_K_Jp_inv,
-                                           preconditioner_K_Jp_inv);
+    // The operator K_Jp^{-1} is either applied exactly using the stored
+    // cell-local inverses, or approximated by an inner iterative solve.
+    // In the first case we start from the transpose of K_Jp, which has the
+    // correct range and domain spaces, and replace its action.
+    auto K_Jp_inv = transpose_operator(K_Jp);
+    if (parameters.cache_condensation_operators)
+      {
+        K_Jp_inv.vmult = [this](LA::MPI::Vector &dst, const LA::MPI::Vector &src)
+        {
+          apply_local_K_Jp_inv(dst, src, false);
+        };
+        K_Jp_inv.vmult_add = [this](LA::MPI::Vector &dst, const LA::MPI::Vector &src)
+        {
+          LA::MPI::Vector tmp (dst);
+          apply_local_K_Jp_inv(tmp, src, false);
+          dst += tmp;
+        };
+        K_Jp_inv.Tvmult = [this](LA::MPI::Vector &dst, const LA::MPI::Vector &src)
+        {
+          apply_local_K_Jp_inv(dst, src, true);
+        };
+        K_Jp_inv.Tvmult_add = [this](LA::MPI::Vector &dst, const LA::MPI::Vector &src)
+        {
+          LA::MPI::Vector tmp (dst);
+          apply_local_K_Jp_inv(tmp, src, true);
+          dst += tmp;
+        };
+      }
+    else
+      {
+        preconditioner_K_Jp_inv.initialize(
+          tangent_matrix.block(J_block, p_block),
+          LA::PreconditionJacobi::AdditionalData());
+        K_Jp_inv = inverse_operator(K_Jp,
+                                    solver_K_Jp_inv,
+                                    preconditioner_K_Jp_inv);
+      }
     const auto K_pJ_inv     = transpose_operator(K_Jp_inv);
     const auto K_pp_bar     = K_Jp_inv * K_JJ * K_pJ_inv;
     const auto K_uu_bar_bar = K_up * K_pp_bar * K_pu;
     const auto K_uu_con     = K_uu + K_uu_bar_bar;
 
-    LA::PreconditionAMG preconditioner_K_con_inv;
-    preconditioner_K_con_inv.initialize(
-      tangent_matrix.block(u_block, u_block),
-      LA::PreconditionAMG::AdditionalData(
-        true /*elliptic*/,
-        (parameters.poly_degree > 1 /*higher_order_elements*/)) );
+    // The AMG hierarchy is rebuilt if it is not to be retained, at the first
+    // Newton iteration of each timestep, or once the number of iterations
+    // has grown too much (see below).
+    const bool rebuild_preconditioner = (parameters.cache_condensation_operators == false
+                                         || rebuild_preconditioner_K_con_inv);
+    if (rebuild_preconditioner)
+      preconditioner_K_con_inv.initialize(
+        tangent_matrix.block(u_block, u_block),
+        LA::PreconditionAMG::AdditionalData(
+          true /*elliptic*/,
+          (parameters.poly_degree > 1 /*higher_order_elements*/)) );
     ReductionControl solver_control_K_con_inv (
       static_cast<unsigned int>(tangent_matrix.block(u_block, u_block).m() 
                                 * parameters.max_iterations_lin),
@@ -2009,6 +2175,17 @@ namespace ViscoElasStripHole
     d_u     = K_uu_con_inv*(f_u - K_up*(K_Jp_inv*f_J - K_pp_bar*f_p));
     lin_it  = solver_control_K_con_inv.last_step();
     lin_res = solver_control_K_con_inv.last_value();
+    if (parameters.cache_condensation_operators)
+      {
+        if (rebuild_preconditioner)
+          {
+            lin_it_preconditioner_K_con_inv = std::max(lin_it, 1u);
+            rebuild_preconditioner_K_con_inv = false;
+          }
+        else if (lin_it > parameters.preconditioner_refresh_factor
+                 * lin_it_preconditioner_K_con_inv)
+          rebuild_preconditioner_K_con_inv = true;
+      }
     timer.leave_subsection();
 
     timer.enter_subsection("Linear solver postprocessing");
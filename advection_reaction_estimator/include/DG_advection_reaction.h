@@ -6,6 +6,7 @@
 #include <deal.II/base/quadrature_lib.h>
 
 #include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_renumbering.h>
 #include <deal.II/dofs/dof_tools.h>
 
 #include <deal.II/fe/fe_dgq.h>
@@ -51,7 +52,10 @@
 #include <deal.II/meshworker/scratch_data.h>
 
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <queue>
+#include <utility>
 using namespace dealii;
 
 // This is a struct used only for throwing an exception when theta parameter is
@@ -86,6 +90,8 @@ private:
   void
   setup_system();
   void
+  renumber_dofs_downstream();
+  void
   assemble_system();
   void
   solve();
@@ -96,9 +102,7 @@ private:
   void
   compute_error();
   double
-  compute_energy_norm();
-  void
-  compute_local_projection_and_estimate();
+  compute_energy_norm_and_estimate();
 
   Triangulation<dim>   triangulation;
   const MappingQ1<dim> mapping;
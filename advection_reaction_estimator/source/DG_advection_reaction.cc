@@ -214,6 +214,11 @@ AdvectionReaction<dim>::setup_system()
     }
   dof_handler.distribute_dofs(*fe);
 
+  // For the iterative solver, we number the degrees of freedom so that
+  // cells come in the direction of the flow, see below.
+  if (!use_direct_solver)
+    renumber_dofs_downstream();
+
   // To build the sparsity pattern for DG discretizations, we can call the
   // function analogue to DoFTools::make_sparsity_pattern, which is called
   // DoFTools::make_flux_sparsity_pattern:
@@ -230,6 +235,116 @@ AdvectionReaction<dim>::setup_system()
 
 
 
+// @sect3{Downstream ordering}
+// For pure advection-reaction, the upwind flux couples each cell only to
+// its upwind neighbors, so if cells are numbered such that every cell comes
+// after all of its upwind neighbors, the system matrix is block lower
+// triangular and a single block Gauss-Seidel sweep solves the linear
+// system exactly. (The jump penalty with $\theta \neq \frac 12$ also
+// couples to downwind neighbors; then the sweep is no longer exact but
+// still an excellent smoother.) Since $\beta$ may vary in space, we do not
+// use DoFRenumbering::downstream() with a single direction, but compute
+// the order from the graph of upwind/downwind relations between neighboring
+// cells through a topological sort. If the flow field recirculates, this
+// graph has cycles; we break these by releasing the remaining cell with
+// the fewest unprocessed upwind neighbors whenever no cell is ready. All
+// remaining cells are therefore kept in a priority queue keyed by their
+// number of unprocessed upwind neighbors, so that cells that are ready come
+// first and the cell to release from a cycle is found without a search.
+template <int dim>
+void
+AdvectionReaction<dim>::renumber_dofs_downstream()
+{
+  const unsigned int n_cells = triangulation.n_active_cells();
+
+  std::vector<Iterator>                  cells(n_cells);
+  std::vector<std::vector<unsigned int>> downwind_neighbors(n_cells);
+  std::vector<unsigned int>              n_upwind_neighbors(n_cells, 0);
+
+  // A neighbor is downwind of a cell if the flow leaves the cell through
+  // their common face, i.e., if $\beta\cdot\mathbf n > 0$ at the center of
+  // the face, with $\mathbf n$ the outward normal of the cell. Each pair of
+  // neighbors is seen from both sides, but we record the relation only from
+  // the upwind side.
+  const QGauss<dim - 1> face_center(1);
+  const UpdateFlags     face_update_flags =
+    update_quadrature_points | update_normal_vectors;
+  FEFaceValues<dim>    fe_face_values(mapping,
+                                      *fe,
+                                      face_center,
+                                      face_update_flags);
+  FESubfaceValues<dim> fe_subface_values(mapping,
+                                         *fe,
+                                         face_center,
+                                         face_update_flags);
+  const auto add_if_downwind = [&](const Iterator              &cell,
+                                   const Iterator              &neighbor,
+                                   const FEFaceValuesBase<dim> &fe_face) {
+    if (beta(fe_face.quadrature_point(0)) * fe_face.normal_vector(0) > 0)
+      {
+        downwind_neighbors[cell->active_cell_index()].push_back(
+          neighbor->active_cell_index());
+        ++n_upwind_neighbors[neighbor->active_cell_index()];
+      }
+  };
+
+  for (const auto &cell : dof_handler.active_cell_iterators())
+    {
+      cells[cell->active_cell_index()] = cell;
+      for (const unsigned int f : cell->face_indices())
+        if (!cell->at_boundary(f))
+          {
+            if (cell->face(f)->has_children())
+              for (unsigned int sf = 0; sf < cell->face(f)->n_children(); ++sf)
+                {
+                  fe_subface_values.reinit(cell, f, sf);
+                  add_if_downwind(cell,
+                                  cell->neighbor_child_on_subface(f, sf),
+                                  fe_subface_values);
+                }
+            else
+              {
+                fe_face_values.reinit(cell, f);
+                add_if_downwind(cell, cell->neighbor(f), fe_face_values);
+              }
+          }
+    }
+
+  // The queue holds pairs of the number of unprocessed upwind neighbors of
+  // a cell and its index, smallest first. Rather than updating entries, we
+  // push a new one whenever the number of a cell decreases and skip the
+  // outdated ones when they come up.
+  using Entry = std::pair<unsigned int, unsigned int>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>
+    pending_cells;
+  for (unsigned int c = 0; c < n_cells; ++c)
+    pending_cells.emplace(n_upwind_neighbors[c], c);
+
+  std::vector<Iterator> ordered_cells;
+  ordered_cells.reserve(n_cells);
+  std::vector<bool> is_ordered(n_cells, false);
+  while (ordered_cells.size() < n_cells)
+    {
+      const Entry entry = pending_cells.top();
+      pending_cells.pop();
+      const unsigned int c = entry.second;
+      if (is_ordered[c] || entry.first != n_upwind_neighbors[c])
+        continue;
+
+      // If even this cell still has unprocessed upwind neighbors, we are
+      // stuck on a cycle and release it.
+      is_ordered[c] = true;
+      ordered_cells.push_back(cells[c]);
+      for (const unsigned int d : downwind_neighbors[c])
+        if (!is_ordered[d] && n_upwind_neighbors[d] > 0)
+          pending_cells.emplace(--n_upwind_neighbors[d], d);
+    }
+
+  DoFRenumbering::cell_wise(dof_handler, ordered_cells);
+}
+
+
+
 // in the call to  MeshWorker::mesh_loop() we only need to specify what should
 // happen on
 //  each cell, each boundary face, and each interior face. These three tasks
@@ -435,10 +550,15 @@ AdvectionReaction<dim>::solve()
     }
   else
     {
-      // Here we have a classic iterative solver, as done in many tutorials:
-      SolverControl                               solver_control(1000, 1e-15);
-      SolverRichardson<Vector<double>>            solver(solver_control);
-      PreconditionBlockSSOR<SparseMatrix<double>> preconditioner;
+      // Here we have a classic iterative solver, as done in many tutorials.
+      // Since the degrees of freedom have been numbered in downstream
+      // direction (see renumber_dofs_downstream()), a block Gauss-Seidel
+      // sweep over the cells, i.e., block SOR with its default relaxation
+      // parameter one, is (almost) an exact solver, and Richardson iteration
+      // typically converges in one or two steps:
+      SolverControl solver_control(1000, 1e-12 * right_hand_side.l2_norm());
+      SolverRichardson<Vector<double>>           solver(solver_control);
+      PreconditionBlockSOR<SparseMatrix<double>> preconditioner;
       preconditioner.initialize(system_matrix, fe->n_dofs_per_cell());
       solver.solve(system_matrix, solution, right_hand_side, preconditioner);
       std::cout << "  Solver converged in " << solver_control.last_step()
@@ -458,9 +578,9 @@ AdvectionReaction<dim>::refine_grid()
 {
   if (refinement == "residual")
     {
-      // If the `refinement` string is `"residual"`, then we first compute the
-      // local projection
-      compute_local_projection_and_estimate();
+      // If the `refinement` string is `"residual"`, then the error indicators
+      // have already been computed together with the energy norm of the
+      // current solution in compute_energy_norm_and_estimate().
       // We then set the refinement fraction and as usual we execute the
       // refinement.
       const double refinement_fraction = 0.6;
@@ -538,154 +658,12 @@ AdvectionReaction<dim>::compute_error()
 
 
 
-// @sect3{Compute the energy norm}
+// @sect3{Computing the energy norm and the estimator}
 // The energy norm is defined as $ |||\cdot ||| = \Bigl(||\cdot||_{0,\Omega}^2 +
 // \sum_{F \in \mathbb{F}}||c_F^{\frac{1}{2}}[\cdot] ||_{0,F}^2
 // \Bigr)^{\frac{1}{2}}$ Notice that in the current case we have $c_f = \frac{|b
-// \cdot n|}{2}$ Like in the assembly, all the contributions are handled
-// separately by using ScratchData and CopyData objects.
-template <int dim>
-double
-AdvectionReaction<dim>::compute_energy_norm()
-{
-  energy_norm_square_per_cell.reinit(triangulation.n_active_cells());
-
-  using Iterator = typename DoFHandler<dim>::active_cell_iterator;
-
-  // We start off by adding cell contributions
-  const auto cell_worker = [&](const Iterator   &cell,
-                               ScratchData<dim> &scratch_data,
-                               CopyData         &copy_data) {
-    const unsigned int n_dofs =
-      scratch_data.fe_values.get_fe().n_dofs_per_cell();
-    copy_data.reinit(cell, n_dofs);
-    scratch_data.fe_values.reinit(cell);
-
-    copy_data.cell_index = cell->active_cell_index();
-
-    const auto &q_points = scratch_data.fe_values.get_quadrature_points();
-    const FEValues<dim>       &fe_v = scratch_data.fe_values;
-    const std::vector<double> &JxW  = fe_v.get_JxW_values();
-
-    double              error_square_norm{0.0};
-    std::vector<double> sol_u(fe_v.n_quadrature_points);
-    fe_v.get_function_values(solution, sol_u);
-
-    for (unsigned int point = 0; point < fe_v.n_quadrature_points; ++point)
-      {
-        const double diff =
-          (sol_u[point] - exact_solution.value(q_points[point]));
-        error_square_norm += diff * diff * JxW[point];
-      }
-    copy_data.value = error_square_norm;
-  };
-
-  // Here we add contributions coming from the internal faces
-  const auto face_worker = [&](const Iterator     &cell,
-                               const unsigned int &f,
-                               const unsigned int &sf,
-                               const Iterator     &ncell,
-                               const unsigned int &nf,
-                               const unsigned int &nsf,
-                               ScratchData<dim>   &scratch_data,
-                               CopyData           &copy_data) {
-    FEInterfaceValues<dim> &fe_iv = scratch_data.fe_interface_values;
-    fe_iv.reinit(cell, f, sf, ncell, nf, nsf);
-
-    copy_data.face_data.emplace_back();
-    CopyDataFace &copy_data_face   = copy_data.face_data.back();
-    copy_data_face.cell_indices[0] = cell->active_cell_index();
-    copy_data_face.cell_indices[1] = ncell->active_cell_index();
-
-    const auto                &q_points   = fe_iv.get_quadrature_points();
-    const unsigned             n_q_points = q_points.size();
-    const std::vector<double> &JxW        = fe_iv.get_JxW_values();
-    std::vector<double>        g(n_q_points);
-
-    std::vector<double> jump(n_q_points);
-    get_function_jump(fe_iv, solution, jump);
-
-    const std::vector<Tensor<1, dim>> &normals = fe_iv.get_normal_vectors();
-
-    double error_jump_square{0.0};
-    for (unsigned int point = 0; point < n_q_points; ++point)
-      {
-        const double beta_dot_n =
-          theta * std::abs(beta(q_points[point]) * normals[point]);
-        error_jump_square +=
-          beta_dot_n * jump[point] * jump[point] * JxW[point];
-      }
-
-    copy_data.value = error_jump_square;
-  };
-
-  // Finally, we add the boundary contributions
-  const auto boundary_worker = [&](const Iterator     &cell,
-                                   const unsigned int &face_no,
-                                   ScratchData<dim>   &scratch_data,
-                                   CopyData           &copy_data) {
-    scratch_data.fe_interface_values.reinit(cell, face_no);
-    const FEFaceValuesBase<dim> &fe_fv =
-      scratch_data.fe_interface_values.get_fe_face_values(0);
-    const auto                &q_points   = fe_fv.get_quadrature_points();
-    const unsigned             n_q_points = q_points.size();
-    const std::vector<double> &JxW        = fe_fv.get_JxW_values();
-
-    std::vector<double> g(n_q_points);
-
-    std::vector<double> sol_u(n_q_points);
-    fe_fv.get_function_values(solution, sol_u);
-
-    const std::vector<Tensor<1, dim>> &normals = fe_fv.get_normal_vectors();
-
-    double difference_norm_square = 0.;
-    for (unsigned int point = 0; point < q_points.size(); ++point)
-      {
-        const double beta_dot_n =
-          theta * std::abs(beta(q_points[point]) * normals[point]);
-        const double diff =
-          (boundary_conditions.value(q_points[point]) - sol_u[point]);
-        difference_norm_square += beta_dot_n * diff * diff * JxW[point];
-      }
-    copy_data.value = difference_norm_square;
-  };
-
-  const auto copier = [&](const auto &copy_data) {
-    if (copy_data.cell_index != numbers::invalid_unsigned_int)
-      {
-        energy_norm_square_per_cell[copy_data.cell_index] += copy_data.value;
-      }
-    for (auto &cdf : copy_data.face_data)
-      for (unsigned int j = 0; j < 2; ++j)
-        energy_norm_square_per_cell[cdf.cell_indices[j]] += cdf.values[j];
-  };
-
-  ScratchData<dim> scratch_data(mapping,
-                                *fe,
-                                QGauss<dim>{fe->tensor_degree() + 1},
-                                QGauss<dim - 1>{fe->tensor_degree() + 1});
-
-  CopyData copy_data;
-
-  MeshWorker::mesh_loop(dof_handler.begin_active(),
-                        dof_handler.end(),
-                        cell_worker,
-                        copier,
-                        scratch_data,
-                        copy_data,
-                        MeshWorker::assemble_own_cells |
-                          MeshWorker::assemble_own_interior_faces_once |
-                          MeshWorker::assemble_boundary_faces,
-                        boundary_worker,
-                        face_worker);
-
-  const double energy_error = std::sqrt(energy_norm_square_per_cell.l1_norm());
-  return energy_error;
-}
-
-
-
-// @sect3{Computing the estimator}
+// \cdot n|}{2}$.
+//
 // In the estimator, we have to compute the term $||f- c u_h - \Pi(f- c
 // u_h)||_{T}^{2}$ over a generic cell $T$. To achieve this, we first need to
 // compute the projection involving the finite element function $u_h$. Using the
@@ -696,37 +674,71 @@ AdvectionReaction<dim>::compute_energy_norm()
 // in the <code>cell_worker</code> lambda. As done in step-74, the square of the
 // error indicator is computed.
 //
+// Both quantities need the values of $u_h$ on the same cells and faces, so we
+// compute them together in a single call to MeshWorker::mesh_loop(). (The
+// estimator is only needed if we refine based on it.) Interior faces are
+// visited from both adjacent cells, and each visit only adds to the cell it is
+// visited from: half of the jump term of the energy norm, and the jump over
+// the inflow part $\partial_{-}T$ of the cell's boundary for the estimator.
+// This way, almost every work item only contributes to its own cell, and the
+// copier reduces to two additions. The exception are faces with a hanging
+// node: they are visited from the fine cell only, which calls the
+// <code>face_worker</code> a second time with the coarse neighbor as the
+// current cell. The contributions of that call belong to the coarse cell and
+// are stored in the face data of the copy data, which the copier adds to the
+// cell they were computed for.
 template <int dim>
-void
-AdvectionReaction<dim>::compute_local_projection_and_estimate()
+double
+AdvectionReaction<dim>::compute_energy_norm_and_estimate()
 {
-  // Compute the term $||f-c u_h - \Pi(f- cu_h)||_T^2$
   using Iterator = typename DoFHandler<dim>::active_cell_iterator;
+
+  const bool compute_estimator = (refinement == "residual");
+
+  energy_norm_square_per_cell.reinit(triangulation.n_active_cells());
   error_indicator_per_cell.reinit(triangulation.n_active_cells());
 
+  // We start off by adding cell contributions, i.e. the $L^2$ error and
+  // the term $||f-c u_h - \Pi(f- cu_h)||_T^2$
   const auto cell_worker = [&](const Iterator   &cell,
                                ScratchData<dim> &scratch_data,
                                CopyData         &copy_data) {
     const unsigned int n_dofs =
       scratch_data.fe_values.get_fe().n_dofs_per_cell();
-
     copy_data.reinit(cell, n_dofs);
     scratch_data.fe_values.reinit(cell);
+
     copy_data.cell_index = cell->active_cell_index();
+    copy_data.face_data.clear();
 
     const auto    &q_points   = scratch_data.fe_values.get_quadrature_points();
     const unsigned n_q_points = q_points.size();
-
     const FEValues<dim>       &fe_v = scratch_data.fe_values;
     const std::vector<double> &JxW  = fe_v.get_JxW_values();
 
-    std::vector<double> sol_u_at_quadrature_points(fe_v.n_quadrature_points);
-    fe_v.get_function_values(solution, sol_u_at_quadrature_points);
+    std::vector<double> sol_u(n_q_points);
+    fe_v.get_function_values(solution, sol_u);
+
+    double error_square_norm{0.0};
+    for (unsigned int point = 0; point < n_q_points; ++point)
+      {
+        const double diff =
+          (sol_u[point] - exact_solution.value(q_points[point]));
+        error_square_norm += diff * diff * JxW[point];
+      }
+    copy_data.value           = error_square_norm;
+    copy_data.value_estimator = 0.0;
+
+    if (!compute_estimator)
+      return;
 
     // Compute local L^2 projection of  $f- c u_h$ over the local finite element
     // space
+    std::vector<double> f_values(n_q_points);
+    rhs.value_list(q_points, f_values);
     for (unsigned int point = 0; point < n_q_points; ++point)
       {
+        const double c_value = advection_coeff.value(q_points[point]);
         for (unsigned int i = 0; i < n_dofs; ++i)
           {
             for (unsigned int j = 0; j < n_dofs; ++j)
@@ -737,11 +749,10 @@ AdvectionReaction<dim>::compute_local_projection_and_estimate()
                   JxW[point];                  // dx(x_q)
               }
             copy_data.cell_mass_rhs(i) +=
-              (rhs.value(q_points[point]) * // f(x_q)
+              (f_values[point] *            // f(x_q)
                  fe_v.shape_value(i, point) // phi_i(x_q)
-               - advection_coeff.value(q_points[point]) *
-                   fe_v.shape_value(i, point) *         // c*phi_i(x_q)
-                   sol_u_at_quadrature_points[point]) * // u_h(x_q)
+               - c_value * fe_v.shape_value(i, point) * // c*phi_i(x_q)
+                   sol_u[point]) *                      // u_h(x_q)
               JxW[point];                               // dx
           }
       }
@@ -756,14 +767,15 @@ AdvectionReaction<dim>::compute_local_projection_and_estimate()
     double square_norm_over_cell = 0.0;
     for (unsigned int point = 0; point < n_q_points; ++point)
       {
-        const double diff = rhs.value(q_points[point]) -
-                            sol_u_at_quadrature_points[point] - proj[point];
+        const double diff = f_values[point] - sol_u[point] - proj[point];
         square_norm_over_cell += diff * diff * JxW[point];
       }
     copy_data.value_estimator = square_norm_over_cell;
   };
 
-  // Finally we have the boundary term with $||\beta (g-u_h^+)||^2$
+  // Then the boundary terms: the jump to the boundary values for the energy
+  // norm, and $||\beta (g-u_h^+)||^2$ on the inflow boundary for the
+  // estimator
   const auto boundary_worker = [&](const Iterator     &cell,
                                    const unsigned int &face_no,
                                    ScratchData<dim>   &scratch_data,
@@ -775,30 +787,41 @@ AdvectionReaction<dim>::compute_local_projection_and_estimate()
     const unsigned             n_q_points = q_points.size();
     const std::vector<double> &JxW        = fe_fv.get_JxW_values();
 
-    std::vector<double> g(n_q_points);
-    exact_solution.value_list(q_points, g);
-
     std::vector<double> sol_u(n_q_points);
     fe_fv.get_function_values(solution, sol_u);
 
+    std::vector<double> g(n_q_points);
+    if (compute_estimator)
+      exact_solution.value_list(q_points, g);
+
     const std::vector<Tensor<1, dim>> &normals = fe_fv.get_normal_vectors();
 
+    double difference_norm_square      = 0.;
     double square_norm_over_bdary_face = 0.;
-    for (unsigned int point = 0; point < q_points.size(); ++point)
+    for (unsigned int point = 0; point < n_q_points; ++point)
       {
         const double beta_dot_n = beta(q_points[point]) * normals[point];
 
-        if (beta_dot_n < 0) //\partial_{-T} \cap \partial_{- \Omega}
+        const double diff =
+          (boundary_conditions.value(q_points[point]) - sol_u[point]);
+        difference_norm_square +=
+          theta * std::abs(beta_dot_n) * diff * diff * JxW[point];
+
+        if (compute_estimator &&
+            beta_dot_n < 0) //\partial_{-T} \cap \partial_{- \Omega}
           {
-            const double diff =
+            const double diff_g =
               std::abs(beta_dot_n) * (g[point] - sol_u[point]);
-            square_norm_over_bdary_face += diff * diff * JxW[point];
+            square_norm_over_bdary_face += diff_g * diff_g * JxW[point];
           }
       }
+    copy_data.value += difference_norm_square;
     copy_data.value_estimator += square_norm_over_bdary_face;
   };
 
-  // Then compute the interior face terms with $|| \sqrt{b \cdot n}[u_h]||^2$
+  // Finally the interior faces, seen from the current cell, with half of
+  // $||c_F^{\frac{1}{2}}[u_h]||^2$ for the energy norm and
+  // $|| \sqrt{b \cdot n}[u_h]||^2$ on $\partial_{-}T$ for the estimator
   const auto face_worker = [&](const Iterator     &cell,
                                const unsigned int &f,
                                const unsigned int &sf,
@@ -810,16 +833,9 @@ AdvectionReaction<dim>::compute_local_projection_and_estimate()
     FEInterfaceValues<dim> &fe_iv = scratch_data.fe_interface_values;
     fe_iv.reinit(cell, f, sf, ncell, nf, nsf);
 
-    copy_data.face_data.emplace_back();
-    CopyDataFace &copy_data_face   = copy_data.face_data.back();
-    copy_data_face.cell_indices[0] = cell->active_cell_index();
-    copy_data_face.cell_indices[1] = ncell->active_cell_index();
-
-    const auto    &q_points   = fe_iv.get_quadrature_points();
-    const unsigned n_q_points = q_points.size();
-
-    const std::vector<double> &JxW = fe_iv.get_JxW_values();
-    std::vector<double>        g(n_q_points);
+    const auto                &q_points   = fe_iv.get_quadrature_points();
+    const unsigned             n_q_points = q_points.size();
+    const std::vector<double> &JxW        = fe_iv.get_JxW_values();
 
     std::vector<double> jump(n_q_points);
     get_function_jump(fe_iv, solution, jump);
@@ -827,43 +843,53 @@ AdvectionReaction<dim>::compute_local_projection_and_estimate()
     const std::vector<Tensor<1, dim>> &normals = fe_iv.get_normal_vectors();
 
     double error_jump_square{0.0};
+    double estimator_jump_square{0.0};
     for (unsigned int point = 0; point < n_q_points; ++point)
       {
         const double beta_dot_n = beta(q_points[point]) * normals[point];
+        const double jump_square_JxW = jump[point] * jump[point] * JxW[point];
+
+        error_jump_square += theta * std::abs(beta_dot_n) * jump_square_JxW;
         if (beta_dot_n < 0)
-          {
-            error_jump_square +=
-              std::abs(beta_dot_n) * jump[point] * jump[point] * JxW[point];
-          }
+          estimator_jump_square += std::abs(beta_dot_n) * jump_square_JxW;
       }
 
-    copy_data_face.values[0] = error_jump_square;
-    copy_data_face.values[1] = copy_data_face.values[0];
+    // The face is visited once more from the neighbor, which adds the other
+    // half of the energy norm contribution:
+    const double value           = 0.5 * error_jump_square;
+    const double value_estimator = compute_estimator ? estimator_jump_square : 0.;
+    if (cell->active_cell_index() == copy_data.cell_index)
+      {
+        copy_data.value += value;
+        copy_data.value_estimator += value_estimator;
+      }
+    else
+      {
+        copy_data.face_data.emplace_back();
+        CopyDataFace &copy_data_face   = copy_data.face_data.back();
+        copy_data_face.cell_indices[0] = cell->active_cell_index();
+        copy_data_face.values          = {{value, value_estimator}};
+      }
   };
 
-  ScratchData<dim> scratch_data(mapping,
-                                *fe,
-                                QGauss<dim>{fe->tensor_degree() + 1},
-                                QGauss<dim - 1>{fe->tensor_degree() + 1});
+  const auto copier = [&](const CopyData &copy_data) {
+    energy_norm_square_per_cell[copy_data.cell_index] += copy_data.value;
+    error_indicator_per_cell[copy_data.cell_index] += copy_data.value_estimator;
 
-  const auto copier = [&](const auto &copy_data) {
-    if (copy_data.cell_index != numbers::invalid_unsigned_int)
-      {
-        error_indicator_per_cell[copy_data.cell_index] +=
-          copy_data.value_estimator;
-      }
-    for (auto &cdf : copy_data.face_data)
+    for (const auto &cdf : copy_data.face_data)
       {
-        for (unsigned int j = 0; j < 2; ++j)
-          {
-            error_indicator_per_cell[cdf.cell_indices[j]] += cdf.values[j];
-          }
+        energy_norm_square_per_cell[cdf.cell_indices[0]] += cdf.values[0];
+        error_indicator_per_cell[cdf.cell_indices[0]] += cdf.values[1];
       }
   };
 
-  // Here, we finally handle the assembly of the Mass matrix (M)_{ij} = (\phi_j,
-  // \phi_i)_T. We pass in ScratchData and CopyData objects
+  ScratchData<dim> scratch_data(mapping,
+                                *fe,
+                                QGauss<dim>{fe->tensor_degree() + 1},
+                                QGauss<dim - 1>{fe->tensor_degree() + 1});
+
   CopyData copy_data;
+
   MeshWorker::mesh_loop(dof_handler.begin_active(),
                         dof_handler.end(),
                         cell_worker,
@@ -871,10 +897,13 @@ AdvectionReaction<dim>::compute_local_projection_and_estimate()
                         scratch_data,
                         copy_data,
                         MeshWorker::assemble_own_cells |
-                          MeshWorker::assemble_boundary_faces |
-                          MeshWorker::assemble_own_interior_faces_once,
+                          MeshWorker::assemble_own_interior_faces_both |
+                          MeshWorker::assemble_boundary_faces,
                         boundary_worker,
                         face_worker);
+
+  const double energy_error = std::sqrt(energy_norm_square_per_cell.l1_norm());
+  return energy_error;
 }
 
 
@@ -910,7 +939,7 @@ AdvectionReaction<dim>::run()
       compute_error();
       output_results(cycle);
 
-      energy_errors.emplace_back(compute_energy_norm());
+      energy_errors.emplace_back(compute_energy_norm_and_estimate());
       dofs_hist.emplace_back(triangulation.n_active_cells());
     }
   error_table.output_table(std::cout);
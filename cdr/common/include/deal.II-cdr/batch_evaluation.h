@@ -0,0 +1,71 @@
+#ifndef dealii__cdr_batch_evaluation_h
+#define dealii__cdr_batch_evaluation_h
+#include <deal.II/base/point.h>
+#include <deal.II/base/tensor.h>
+#include <deal.II/base/vectorization.h>
+
+#include <algorithm>
+#include <vector>
+
+// The assembly routines can either take the coefficients as
+// <code>std::function</code> objects, which are evaluated one point at a time,
+// or as function objects with a templated call operator. The second kind is
+// called here with points whose coordinates are <code>VectorizedArray</code>s,
+// i.e., on as many quadrature points at once as there are SIMD lanes. Since the
+// type of the function object is known at compile time, the call can be
+// inlined.
+namespace CDR
+{
+  using namespace dealii;
+
+  namespace internal
+  {
+    inline double
+    extract_lane(const VectorizedArray<double> &value, const unsigned int lane)
+    {
+      return value[lane];
+    }
+
+    template <int dim>
+    Tensor<1, dim>
+    extract_lane(const Tensor<1, dim, VectorizedArray<double>> &value,
+                 const unsigned int                             lane)
+    {
+      Tensor<1, dim> result;
+      for (unsigned int d = 0; d < dim; ++d)
+        result[d] = value[d][lane];
+      return result;
+    }
+  } // namespace internal
+
+  // Evaluate <code>function</code> at all <code>points</code>. If the number
+  // of points is not a multiple of the SIMD width then the last point is
+  // repeated in the unused lanes.
+  template <int dim, typename BatchFunction, typename ValueType>
+  void
+  evaluate_in_batches(const BatchFunction &          function,
+                      const std::vector<Point<dim>> &points,
+                      std::vector<ValueType> &       values)
+  {
+    constexpr unsigned int n_lanes = VectorizedArray<double>::size();
+    const unsigned int     n_points = points.size();
+    values.resize(n_points);
+    for (unsigned int first = 0; first < n_points; first += n_lanes)
+      {
+        Point<dim, VectorizedArray<double>> batch;
+        for (unsigned int lane = 0; lane < n_lanes; ++lane)
+          {
+            const unsigned int q = std::min(first + lane, n_points - 1);
+            for (unsigned int d = 0; d < dim; ++d)
+              batch[d][lane] = points[q][d];
+          }
+
+        const auto batch_values = function(batch);
+        for (unsigned int lane = 0;
+             lane < n_lanes && first + lane < n_points;
+             ++lane)
+          values[first + lane] = internal::extract_lane(batch_values, lane);
+      }
+  }
+} // namespace CDR
+#endif
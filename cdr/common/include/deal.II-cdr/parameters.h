@@ -28,13 +28,19 @@ namespace CDR
     unsigned int initial_refinement_level;
     unsigned int max_refinement_level;
     unsigned int fe_order;
+    unsigned int refinement_interval;
+    double       refinement_error_budget;
 
     double       start_time;
     double       stop_time;
     unsigned int n_time_steps;
 
+    bool use_matrix_free;
+
     unsigned int save_interval;
     unsigned int patch_level;
+    unsigned int n_output_groups;
+    bool         asynchronous_output;
 
     void
     read_parameter_file(const std::string &file_name);
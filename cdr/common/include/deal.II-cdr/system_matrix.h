@@ -38,5 +38,34 @@ namespace CDR
     const double                                           time_step,
     const AffineConstraints<double> &                      constraints,
     MatrixType &                                           system_matrix);
+
+  // These overloads take the convection field as a function object whose
+  // call operator is a template on the number type, e.g.,
+  // @code
+  // template <typename Number>
+  // Tensor<1, dim, Number>
+  // operator()(const Point<dim, Number> &p) const;
+  // @endcode
+  // so that it can be evaluated on several quadrature points at once (see
+  // <code>batch_evaluation.h</code>). Unlike the functions above these are
+  // only defined in <code>system_matrix.templates.h</code>.
+  template <int dim, typename MatrixType, typename ConvectionFunction>
+  void
+  create_system_matrix(const DoFHandler<dim> &   dof_handler,
+                       const QGauss<dim> &       quad,
+                       const ConvectionFunction &convection_function,
+                       const CDR::Parameters &   parameters,
+                       const double              time_step,
+                       MatrixType &              system_matrix);
+
+  template <int dim, typename MatrixType, typename ConvectionFunction>
+  void
+  create_system_matrix(const DoFHandler<dim> &          dof_handler,
+                       const QGauss<dim> &              quad,
+                       const ConvectionFunction &       convection_function,
+                       const CDR::Parameters &          parameters,
+                       const double                     time_step,
+                       const AffineConstraints<double> &constraints,
+                       MatrixType &                     system_matrix);
 } // namespace CDR
 #endif
@@ -9,6 +9,7 @@
 
 #include <deal.II/lac/affine_constraints.h>
 
+#include <deal.II-cdr/batch_evaluation.h>
 #include <deal.II-cdr/parameters.h>
 #include <deal.II-cdr/system_matrix.h>
 
@@ -21,16 +22,17 @@ namespace CDR
 
   // This is the actual implementation of the <code>create_system_matrix</code>
   // function described in the header file. It is similar to the system matrix
-  // assembly routine in step-40.
-  template <int dim, typename UpdateFunction>
+  // assembly routine in step-40. The convection field is computed at all
+  // quadrature points of a cell by <code>evaluate_convection</code> before
+  // the loops over the shape functions.
+  template <int dim, typename ConvectionEvaluator, typename UpdateFunction>
   void
-  internal_create_system_matrix(
-    const DoFHandler<dim> &                                dof_handler,
-    const QGauss<dim> &                                    quad,
-    const std::function<Tensor<1, dim>(const Point<dim>)> &convection_function,
-    const CDR::Parameters &                                parameters,
-    const double                                           time_step,
-    UpdateFunction                                         update_system_matrix)
+  internal_create_system_matrix(const DoFHandler<dim> &dof_handler,
+                                const QGauss<dim> &    quad,
+                                ConvectionEvaluator    evaluate_convection,
+                                const CDR::Parameters &parameters,
+                                const double           time_step,
+                                UpdateFunction         update_system_matrix)
   {
     auto &             fe            = dof_handler.get_fe();
     const auto         dofs_per_cell = fe.dofs_per_cell;
@@ -41,6 +43,7 @@ namespace CDR
                               update_quadrature_points | update_JxW_values);
 
     std::vector<types::global_dof_index> local_indices(dofs_per_cell);
+    std::vector<Tensor<1, dim>>          convection_values(quad.size());
 
     for (const auto &cell : dof_handler.active_cell_iterators())
       {
@@ -49,10 +52,11 @@ namespace CDR
             fe_values.reinit(cell);
             cell_matrix = 0.0;
             cell->get_dof_indices(local_indices);
+            evaluate_convection(fe_values.get_quadrature_points(),
+                                convection_values);
             for (unsigned int q = 0; q < quad.size(); ++q)
               {
-                const auto current_convection =
-                  convection_function(fe_values.quadrature_point(q));
+                const auto &current_convection = convection_values[q];
 
                 for (unsigned int i = 0; i < dofs_per_cell; ++i)
                   {
@@ -97,7 +101,11 @@ namespace CDR
     internal_create_system_matrix<dim>(
       dof_handler,
       quad,
-      convection_function,
+      [&convection_function](const std::vector<Point<dim>> &points,
+                             std::vector<Tensor<1, dim>> &  values) {
+        for (unsigned int q = 0; q < points.size(); ++q)
+          values[q] = convection_function(points[q]);
+      },
       parameters,
       time_step,
       [&constraints, &system_matrix](
@@ -122,7 +130,64 @@ namespace CDR
     internal_create_system_matrix<dim>(
       dof_handler,
       quad,
-      convection_function,
+      [&convection_function](const std::vector<Point<dim>> &points,
+                             std::vector<Tensor<1, dim>> &  values) {
+        for (unsigned int q = 0; q < points.size(); ++q)
+          values[q] = convection_function(points[q]);
+      },
+      parameters,
+      time_step,
+      [&system_matrix](
+        const std::vector<types::global_dof_index> &local_indices,
+        const FullMatrix<double> &                  cell_matrix) {
+        system_matrix.add(local_indices, cell_matrix);
+      });
+  }
+
+  template <int dim, typename MatrixType, typename ConvectionFunction>
+  void
+  create_system_matrix(const DoFHandler<dim> &          dof_handler,
+                       const QGauss<dim> &              quad,
+                       const ConvectionFunction &       convection_function,
+                       const CDR::Parameters &          parameters,
+                       const double                     time_step,
+                       const AffineConstraints<double> &constraints,
+                       MatrixType &                     system_matrix)
+  {
+    internal_create_system_matrix<dim>(
+      dof_handler,
+      quad,
+      [&convection_function](const std::vector<Point<dim>> &points,
+                             std::vector<Tensor<1, dim>> &  values) {
+        evaluate_in_batches(convection_function, points, values);
+      },
+      parameters,
+      time_step,
+      [&constraints, &system_matrix](
+        const std::vector<types::global_dof_index> &local_indices,
+        const FullMatrix<double> &                  cell_matrix) {
+        constraints.distribute_local_to_global(cell_matrix,
+                                               local_indices,
+                                               system_matrix);
+      });
+  }
+
+  template <int dim, typename MatrixType, typename ConvectionFunction>
+  void
+  create_system_matrix(const DoFHandler<dim> &   dof_handler,
+                       const QGauss<dim> &       quad,
+                       const ConvectionFunction &convection_function,
+                       const CDR::Parameters &   parameters,
+                       const double              time_step,
+                       MatrixType &              system_matrix)
+  {
+    internal_create_system_matrix<dim>(
+      dof_handler,
+      quad,
+      [&convection_function](const std::vector<Point<dim>> &points,
+                             std::vector<Tensor<1, dim>> &  values) {
+        evaluate_in_batches(convection_function, points, values);
+      },
       parameters,
       time_step,
       [&system_matrix](
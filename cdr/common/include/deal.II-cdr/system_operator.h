@@ -0,0 +1,155 @@
+#ifndef dealii__cdr_system_operator_h
+#define dealii__cdr_system_operator_h
+#include <deal.II/base/mg_level_object.h>
+#include <deal.II/base/point.h>
+#include <deal.II/base/table.h>
+#include <deal.II/base/tensor.h>
+#include <deal.II/base/vectorization.h>
+
+#include <deal.II/dofs/dof_handler.h>
+
+#include <deal.II/fe/mapping_q1.h>
+
+#include <deal.II/lac/affine_constraints.h>
+#include <deal.II/lac/diagonal_matrix.h>
+#include <deal.II/lac/la_parallel_vector.h>
+#include <deal.II/lac/precondition.h>
+#include <deal.II/lac/trilinos_precondition.h>
+#include <deal.II/lac/trilinos_sparse_matrix.h>
+
+#include <deal.II/matrix_free/fe_evaluation.h>
+#include <deal.II/matrix_free/matrix_free.h>
+#include <deal.II/matrix_free/operators.h>
+
+#include <deal.II/multigrid/mg_coarse.h>
+#include <deal.II/multigrid/mg_matrix.h>
+#include <deal.II/multigrid/mg_smoother.h>
+#include <deal.II/multigrid/mg_transfer_global_coarsening.h>
+#include <deal.II/multigrid/multigrid.h>
+
+#include <deal.II-cdr/parameters.h>
+
+#include <functional>
+#include <memory>
+
+// The sparse matrix built by <code>create_system_matrix</code> becomes the
+// largest object in the program for higher order elements. This header
+// declares a matrix-free alternative: <code>SystemOperator</code> applies the
+// same left hand side operator with sum factorization and
+// <code>SystemMultigrid</code> is a matching polynomial multigrid
+// preconditioner.
+namespace CDR
+{
+  using namespace dealii;
+
+  template <int dim, typename Number>
+  class SystemOperator
+    : public MatrixFreeOperators::Base<dim,
+                                       LinearAlgebra::distributed::Vector<Number>>
+  {
+  public:
+    using VectorType = LinearAlgebra::distributed::Vector<Number>;
+    using value_type = Number;
+
+    SystemOperator();
+
+    // Set up the MatrixFree object on the given DoFHandler. The convection
+    // field is evaluated at every quadrature point once here (instead of in
+    // every operator application) and stored alongside the constant
+    // coefficients of the time stepping scheme.
+    void
+    reinit(
+      const Mapping<dim> &                                   mapping,
+      const DoFHandler<dim> &                                dof_handler,
+      const AffineConstraints<double> &                      constraints,
+      const std::function<Tensor<1, dim>(const Point<dim>)> &convection_function,
+      const CDR::Parameters &                                parameters,
+      const double                                           time_step);
+
+    virtual void
+    compute_diagonal() override;
+
+  private:
+    using FECellIntegrator = FEEvaluation<dim, -1, 0, 1, Number>;
+
+    virtual void
+    apply_add(VectorType &dst, const VectorType &src) const override;
+
+    void
+    local_apply(const MatrixFree<dim, Number> &              data,
+                VectorType &                                 dst,
+                const VectorType &                           src,
+                const std::pair<unsigned int, unsigned int> &cell_range) const;
+
+    void
+    do_cell_integral_local(FECellIntegrator &phi) const;
+
+    Number mass_coefficient;
+    Number convection_coefficient;
+    Number diffusion_coefficient;
+
+    Table<2, Tensor<1, dim, VectorizedArray<Number>>> convection;
+  };
+
+  // The levels of this multigrid method are the finite element spaces of
+  // order <code>fe_order</code>, <code>fe_order - 1</code>, ..., 1 on the
+  // active mesh, so it works on adaptively refined meshes without any
+  // interface matrices. The smoother is a Chebyshev iteration around the
+  // diagonal of each level operator and the coarse (linear) level is one
+  // V-cycle of AMG applied to a sparse matrix, which is cheap for linear
+  // elements.
+  template <int dim>
+  class SystemMultigrid
+  {
+  public:
+    using VectorType    = LinearAlgebra::distributed::Vector<double>;
+    using LevelOperator = SystemOperator<dim, double>;
+
+    void
+    initialize(
+      const DoFHandler<dim> &                                dof_handler,
+      const AffineConstraints<double> &                      constraints,
+      const types::boundary_id                               boundary_id,
+      const std::function<Tensor<1, dim>(const Point<dim>)> &convection_function,
+      const CDR::Parameters &                                parameters,
+      const double                                           time_step);
+
+    void
+    vmult(VectorType &dst, const VectorType &src) const;
+
+  private:
+    using SmootherType =
+      PreconditionChebyshev<LevelOperator, VectorType, DiagonalMatrix<VectorType>>;
+
+    void
+    clear();
+
+    MappingQ1<dim> mapping;
+
+    // The finest level uses the DoFHandler and constraints of the solver, so
+    // only the coarser levels are stored here.
+    MGLevelObject<std::unique_ptr<DoFHandler<dim>>>           dof_handlers;
+    MGLevelObject<std::unique_ptr<AffineConstraints<double>>> constraints;
+    MGLevelObject<LevelOperator>                              operators;
+    MGLevelObject<MGTwoLevelTransfer<dim, VectorType>>        transfers;
+
+    std::unique_ptr<MGTransferGlobalCoarsening<dim, VectorType>> transfer;
+
+    TrilinosWrappers::SparseMatrix    coarse_matrix;
+    TrilinosWrappers::PreconditionAMG coarse_amg;
+
+    std::unique_ptr<mg::Matrix<VectorType>> mg_matrix;
+    std::unique_ptr<
+      MGSmootherPrecondition<LevelOperator, SmootherType, VectorType>>
+      mg_smoother;
+    std::unique_ptr<
+      MGCoarseGridApplyPreconditioner<VectorType,
+                                      TrilinosWrappers::PreconditionAMG>>
+                                                       mg_coarse;
+    std::unique_ptr<Multigrid<VectorType>>             mg;
+    std::unique_ptr<
+      PreconditionMG<dim, VectorType, MGTransferGlobalCoarsening<dim, VectorType>>>
+      preconditioner;
+  };
+} // namespace CDR
+#endif
@@ -0,0 +1,334 @@
+#ifndef dealii__cdr_system_operator_templates_h
+#define dealii__cdr_system_operator_templates_h
+#include <deal.II/base/quadrature_lib.h>
+
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_tools.h>
+
+#include <deal.II/fe/fe_q.h>
+
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/sparsity_tools.h>
+
+#include <deal.II/matrix_free/tools.h>
+
+#include <deal.II-cdr/parameters.h>
+#include <deal.II-cdr/system_matrix.h>
+#include <deal.II-cdr/system_operator.h>
+
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace CDR
+{
+  using namespace dealii;
+
+  template <int dim, typename Number>
+  SystemOperator<dim, Number>::SystemOperator()
+    : MatrixFreeOperators::Base<dim, VectorType>()
+    , mass_coefficient{1.0}
+    , convection_coefficient{0.0}
+    , diffusion_coefficient{0.0}
+  {}
+
+
+  template <int dim, typename Number>
+  void
+  SystemOperator<dim, Number>::reinit(
+    const Mapping<dim> &                                   mapping,
+    const DoFHandler<dim> &                                dof_handler,
+    const AffineConstraints<double> &                      constraints,
+    const std::function<Tensor<1, dim>(const Point<dim>)> &convection_function,
+    const CDR::Parameters &                                parameters,
+    const double                                           time_step)
+  {
+    this->clear();
+
+    typename MatrixFree<dim, Number>::AdditionalData additional_data;
+    additional_data.tasks_parallel_scheme =
+      MatrixFree<dim, Number>::AdditionalData::none;
+    additional_data.mapping_update_flags = update_values | update_gradients |
+                                           update_JxW_values |
+                                           update_quadrature_points;
+    auto matrix_free = std::make_shared<MatrixFree<dim, Number>>();
+    // This is the same quadrature rule as the one used by the solver for the
+    // sparse matrix.
+    matrix_free->reinit(mapping,
+                        dof_handler,
+                        constraints,
+                        QGauss<1>(dof_handler.get_fe().degree + 2),
+                        additional_data);
+    this->initialize(matrix_free);
+
+    // These are the same coefficients as in
+    // <code>create_system_matrix</code>.
+    mass_coefficient = 1.0 + time_step / 2.0 * parameters.reaction_coefficient;
+    convection_coefficient = time_step / 2.0;
+    diffusion_coefficient  = time_step / 2.0 * parameters.diffusion_coefficient;
+
+    FECellIntegrator phi(*matrix_free);
+    convection.reinit(matrix_free->n_cell_batches(), phi.n_q_points);
+    for (unsigned int cell = 0; cell < matrix_free->n_cell_batches(); ++cell)
+      {
+        phi.reinit(cell);
+        for (unsigned int q = 0; q < phi.n_q_points; ++q)
+          {
+            const auto batch_point = phi.quadrature_point(q);
+            // The convection function works on one point at a time, so unpack
+            // the SIMD lanes. The unused lanes of the last batch contain
+            // copies of valid points.
+            for (unsigned int v = 0; v < VectorizedArray<Number>::size(); ++v)
+              {
+                Point<dim> point;
+                for (unsigned int d = 0; d < dim; ++d)
+                  point[d] = batch_point[d][v];
+                const auto current_convection = convection_function(point);
+                for (unsigned int d = 0; d < dim; ++d)
+                  convection(cell, q)[d][v] = current_convection[d];
+              }
+          }
+      }
+  }
+
+
+  template <int dim, typename Number>
+  void
+  SystemOperator<dim, Number>::do_cell_integral_local(
+    FECellIntegrator &phi) const
+  {
+    const unsigned int cell = phi.get_current_cell_index();
+
+    phi.evaluate(EvaluationFlags::values | EvaluationFlags::gradients);
+    for (unsigned int q = 0; q < phi.n_q_points; ++q)
+      {
+        const auto value    = phi.get_value(q);
+        const auto gradient = phi.get_gradient(q);
+        // Here are the mass and reaction parts together with the convection
+        // part
+        phi.submit_value(mass_coefficient * value +
+                           convection_coefficient *
+                             (convection(cell, q) * gradient),
+                         q);
+        // and, finally, the diffusion part:
+        phi.submit_gradient(diffusion_coefficient * gradient, q);
+      }
+    phi.integrate(EvaluationFlags::values | EvaluationFlags::gradients);
+  }
+
+
+  template <int dim, typename Number>
+  void
+  SystemOperator<dim, Number>::local_apply(
+    const MatrixFree<dim, Number> &              data,
+    VectorType &                                 dst,
+    const VectorType &                           src,
+    const std::pair<unsigned int, unsigned int> &cell_range) const
+  {
+    FECellIntegrator phi(data);
+    for (unsigned int cell = cell_range.first; cell < cell_range.second;
+         ++cell)
+      {
+        phi.reinit(cell);
+        phi.read_dof_values(src);
+        do_cell_integral_local(phi);
+        phi.distribute_local_to_global(dst);
+      }
+  }
+
+
+  template <int dim, typename Number>
+  void
+  SystemOperator<dim, Number>::apply_add(VectorType &      dst,
+                                         const VectorType &src) const
+  {
+    this->data->cell_loop(&SystemOperator::local_apply, this, dst, src);
+  }
+
+
+  template <int dim, typename Number>
+  void
+  SystemOperator<dim, Number>::compute_diagonal()
+  {
+    this->inverse_diagonal_entries.reset(new DiagonalMatrix<VectorType>());
+    VectorType &inverse_diagonal = this->inverse_diagonal_entries->get_vector();
+    this->data->initialize_dof_vector(inverse_diagonal);
+    MatrixFreeTools::compute_diagonal(*this->data,
+                                      inverse_diagonal,
+                                      &SystemOperator::do_cell_integral_local,
+                                      this);
+    // The constrained entries are zero: as in the sparse matrix, these rows
+    // are the identity.
+    for (auto &entry : inverse_diagonal)
+      entry = (std::abs(entry) > 1e-10) ? Number(1.0) / entry : Number(1.0);
+  }
+
+
+  template <int dim>
+  void
+  SystemMultigrid<dim>::clear()
+  {
+    // Everything below refers to the level objects, so this has to be torn
+    // down in the opposite order of creation.
+    preconditioner.reset();
+    mg.reset();
+    mg_coarse.reset();
+    mg_smoother.reset();
+    mg_matrix.reset();
+    coarse_amg.clear();
+    coarse_matrix.clear();
+    transfer.reset();
+    transfers.resize(0, 0);
+    operators.resize(0, 0);
+    constraints.resize(0, 0);
+    dof_handlers.resize(0, 0);
+  }
+
+
+  template <int dim>
+  void
+  SystemMultigrid<dim>::initialize(
+    const DoFHandler<dim> &                                dof_handler,
+    const AffineConstraints<double> &                      fine_constraints,
+    const types::boundary_id                               boundary_id,
+    const std::function<Tensor<1, dim>(const Point<dim>)> &convection_function,
+    const CDR::Parameters &                                parameters,
+    const double                                           time_step)
+  {
+    clear();
+
+    const auto &       triangulation    = dof_handler.get_triangulation();
+    const MPI_Comm     mpi_communicator = triangulation.get_communicator();
+    const unsigned int max_level = dof_handler.get_fe().degree - 1;
+
+    dof_handlers.resize(0, max_level);
+    constraints.resize(0, max_level);
+    operators.resize(0, max_level);
+    transfers.resize(0, max_level);
+
+    // Level <code>max_level</code> is the space the solver works with and
+    // level $l$ is made of polynomials of order $l + 1$.
+    std::vector<const DoFHandler<dim> *>           level_dof_handlers(max_level +
+                                                            1);
+    std::vector<const AffineConstraints<double> *> level_constraints(max_level +
+                                                                     1);
+    level_dof_handlers[max_level] = &dof_handler;
+    level_constraints[max_level]  = &fine_constraints;
+    for (unsigned int level = 0; level < max_level; ++level)
+      {
+        dof_handlers[level] = std::make_unique<DoFHandler<dim>>(triangulation);
+        dof_handlers[level]->distribute_dofs(FE_Q<dim>(level + 1));
+
+        IndexSet locally_relevant_dofs;
+        DoFTools::extract_locally_relevant_dofs(*dof_handlers[level],
+                                                locally_relevant_dofs);
+        constraints[level] = std::make_unique<AffineConstraints<double>>();
+        constraints[level]->reinit(locally_relevant_dofs);
+        DoFTools::make_hanging_node_constraints(*dof_handlers[level],
+                                                *constraints[level]);
+        DoFTools::make_zero_boundary_constraints(*dof_handlers[level],
+                                                 boundary_id,
+                                                 *constraints[level]);
+        constraints[level]->close();
+
+        level_dof_handlers[level] = dof_handlers[level].get();
+        level_constraints[level]  = constraints[level].get();
+      }
+
+    for (unsigned int level = 0; level <= max_level; ++level)
+      {
+        operators[level].reinit(mapping,
+                                *level_dof_handlers[level],
+                                *level_constraints[level],
+                                convection_function,
+                                parameters,
+                                time_step);
+        operators[level].compute_diagonal();
+      }
+
+    for (unsigned int level = 1; level <= max_level; ++level)
+      {
+        transfers[level].reinit_polynomial_transfer(
+          *level_dof_handlers[level],
+          *level_dof_handlers[level - 1],
+          *level_constraints[level],
+          *level_constraints[level - 1]);
+      }
+    transfer = std::make_unique<MGTransferGlobalCoarsening<dim, VectorType>>(
+      transfers, [this](const unsigned int level, VectorType &vector) {
+        operators[level].initialize_dof_vector(vector);
+      });
+
+    // The coarse level is assembled in the same way as the sparse matrix of
+    // the solver.
+    {
+      const DoFHandler<dim> &coarse_dof_handler = *level_dof_handlers[0];
+      IndexSet               locally_relevant_dofs;
+      DoFTools::extract_locally_relevant_dofs(coarse_dof_handler,
+                                              locally_relevant_dofs);
+      DynamicSparsityPattern dynamic_sparsity_pattern(
+        coarse_dof_handler.n_dofs());
+      DoFTools::make_sparsity_pattern(coarse_dof_handler,
+                                      dynamic_sparsity_pattern,
+                                      *level_constraints[0],
+                                      /*keep_constrained_dofs*/ true);
+      SparsityTools::distribute_sparsity_pattern(
+        dynamic_sparsity_pattern,
+        coarse_dof_handler.locally_owned_dofs(),
+        mpi_communicator,
+        locally_relevant_dofs);
+      coarse_matrix.reinit(coarse_dof_handler.locally_owned_dofs(),
+                           dynamic_sparsity_pattern,
+                           mpi_communicator);
+      CDR::create_system_matrix<dim>(coarse_dof_handler,
+                                     QGauss<dim>(3),
+                                     convection_function,
+                                     parameters,
+                                     time_step,
+                                     *level_constraints[0],
+                                     coarse_matrix);
+      coarse_matrix.compress(VectorOperation::add);
+      coarse_amg.initialize(coarse_matrix);
+    }
+
+    MGLevelObject<typename SmootherType::AdditionalData> smoother_data(
+      0, max_level);
+    for (unsigned int level = 0; level <= max_level; ++level)
+      {
+        smoother_data[level].preconditioner =
+          operators[level].get_matrix_diagonal_inverse();
+        smoother_data[level].smoothing_range     = 15.0;
+        smoother_data[level].degree              = 5;
+        smoother_data[level].eig_cg_n_iterations = 10;
+        // The operator is not symmetric, so the eigenvalue estimate for the
+        // Chebyshev iteration cannot use the Lanczos method.
+        smoother_data[level].eigenvalue_algorithm =
+          SmootherType::AdditionalData::EigenvalueAlgorithm::power_iteration;
+      }
+
+    mg_matrix = std::make_unique<mg::Matrix<VectorType>>(operators);
+    mg_smoother = std::make_unique<
+      MGSmootherPrecondition<LevelOperator, SmootherType, VectorType>>();
+    mg_smoother->initialize(operators, smoother_data);
+    mg_coarse = std::make_unique<
+      MGCoarseGridApplyPreconditioner<VectorType,
+                                      TrilinosWrappers::PreconditionAMG>>(
+      coarse_amg);
+    mg = std::make_unique<Multigrid<VectorType>>(
+      *mg_matrix, *mg_coarse, *transfer, *mg_smoother, *mg_smoother, 0, max_level);
+    preconditioner = std::make_unique<
+      PreconditionMG<dim, VectorType, MGTransferGlobalCoarsening<dim, VectorType>>>(
+      dof_handler, *mg, *transfer);
+  }
+
+
+  template <int dim>
+  void
+  SystemMultigrid<dim>::vmult(VectorType &dst, const VectorType &src) const
+  {
+    Assert(preconditioner, ExcNotInitialized());
+    preconditioner->vmult(dst, src);
+  }
+} // namespace CDR
+#endif
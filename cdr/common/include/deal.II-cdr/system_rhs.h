@@ -30,5 +30,29 @@ namespace CDR
     const AffineConstraints<double> &                      constraints,
     const double                                           current_time,
     VectorType &                                           system_rhs);
+
+  // This overload takes the convection field and the forcing as function
+  // objects with call operators templated on the number type (like the
+  // function objects of <code>create_system_matrix</code>), i.e.,
+  // @code
+  // template <typename Number>
+  // Number
+  // operator()(const double t, const Point<dim, Number> &p) const;
+  // @endcode
+  // for the forcing. It is only defined in <code>system_rhs.templates.h</code>.
+  template <int dim,
+            typename VectorType,
+            typename ConvectionFunction,
+            typename ForcingFunction>
+  void
+  create_system_rhs(const DoFHandler<dim> &          dof_handler,
+                    const QGauss<dim> &              quad,
+                    const ConvectionFunction &       convection_function,
+                    const ForcingFunction &          forcing_function,
+                    const CDR::Parameters &          parameters,
+                    const VectorType &               previous_solution,
+                    const AffineConstraints<double> &constraints,
+                    const double                     current_time,
+                    VectorType &                     system_rhs);
 } // namespace CDR
 #endif
@@ -12,6 +12,7 @@
 #include <deal.II/lac/affine_constraints.h>
 #include <deal.II/lac/vector.h>
 
+#include <deal.II-cdr/batch_evaluation.h>
 #include <deal.II-cdr/parameters.h>
 #include <deal.II-cdr/system_rhs.h>
 
@@ -22,18 +23,25 @@ namespace CDR
 {
   using namespace dealii;
 
-  template <int dim, typename VectorType>
+  // As with the system matrix, the coefficients are computed at all
+  // quadrature points of a cell before the loops over the shape functions:
+  // <code>evaluate_convection</code> and <code>evaluate_forcing</code> take
+  // the quadrature points (and the time, for the forcing) and fill a vector
+  // of values.
+  template <int dim,
+            typename VectorType,
+            typename ConvectionEvaluator,
+            typename ForcingEvaluator>
   void
-  create_system_rhs(
-    const DoFHandler<dim> &                                dof_handler,
-    const QGauss<dim> &                                    quad,
-    const std::function<Tensor<1, dim>(const Point<dim>)> &convection_function,
-    const std::function<double(double, const Point<dim>)> &forcing_function,
-    const CDR::Parameters &                                parameters,
-    const VectorType &                                     previous_solution,
-    const AffineConstraints<double> &                      constraints,
-    const double                                           current_time,
-    VectorType &                                           system_rhs)
+  internal_create_system_rhs(const DoFHandler<dim> &          dof_handler,
+                             const QGauss<dim> &              quad,
+                             ConvectionEvaluator              evaluate_convection,
+                             ForcingEvaluator                 evaluate_forcing,
+                             const CDR::Parameters &          parameters,
+                             const VectorType &               previous_solution,
+                             const AffineConstraints<double> &constraints,
+                             const double                     current_time,
+                             VectorType &                     system_rhs)
   {
     auto &       fe            = dof_handler.get_fe();
     const auto   dofs_per_cell = fe.dofs_per_cell;
@@ -49,6 +57,9 @@ namespace CDR
 
     Vector<double>                       current_fe_coefficients(dofs_per_cell);
     std::vector<types::global_dof_index> local_indices(dofs_per_cell);
+    std::vector<Tensor<1, dim>>          convection_values(quad.size());
+    std::vector<double>                  current_forcing_values(quad.size());
+    std::vector<double>                  previous_forcing_values(quad.size());
 
     const double previous_time{current_time - time_step};
 
@@ -65,16 +76,16 @@ namespace CDR
                   previous_solution[local_indices[i]];
               }
 
+            const auto &points = fe_values.get_quadrature_points();
+            evaluate_convection(points, convection_values);
+            evaluate_forcing(current_time, points, current_forcing_values);
+            evaluate_forcing(previous_time, points, previous_forcing_values);
+
             for (unsigned int q = 0; q < quad.size(); ++q)
               {
-                const auto current_convection =
-                  convection_function(fe_values.quadrature_point(q));
-
-                const double current_forcing =
-                  forcing_function(current_time, fe_values.quadrature_point(q));
-                const double previous_forcing =
-                  forcing_function(previous_time,
-                                   fe_values.quadrature_point(q));
+                const auto & current_convection = convection_values[q];
+                const double current_forcing    = current_forcing_values[q];
+                const double previous_forcing   = previous_forcing_values[q];
                 for (unsigned int i = 0; i < dofs_per_cell; ++i)
                   {
                     for (unsigned int j = 0; j < dofs_per_cell; ++j)
@@ -111,5 +122,78 @@ namespace CDR
           }
       }
   }
+
+  template <int dim, typename VectorType>
+  void
+  create_system_rhs(
+    const DoFHandler<dim> &                                dof_handler,
+    const QGauss<dim> &                                    quad,
+    const std::function<Tensor<1, dim>(const Point<dim>)> &convection_function,
+    const std::function<double(double, const Point<dim>)> &forcing_function,
+    const CDR::Parameters &                                parameters,
+    const VectorType &                                     previous_solution,
+    const AffineConstraints<double> &                      constraints,
+    const double                                           current_time,
+    VectorType &                                           system_rhs)
+  {
+    internal_create_system_rhs<dim>(
+      dof_handler,
+      quad,
+      [&convection_function](const std::vector<Point<dim>> &points,
+                             std::vector<Tensor<1, dim>> &  values) {
+        for (unsigned int q = 0; q < points.size(); ++q)
+          values[q] = convection_function(points[q]);
+      },
+      [&forcing_function](const double                   time,
+                          const std::vector<Point<dim>> &points,
+                          std::vector<double> &          values) {
+        for (unsigned int q = 0; q < points.size(); ++q)
+          values[q] = forcing_function(time, points[q]);
+      },
+      parameters,
+      previous_solution,
+      constraints,
+      current_time,
+      system_rhs);
+  }
+
+  template <int dim,
+            typename VectorType,
+            typename ConvectionFunction,
+            typename ForcingFunction>
+  void
+  create_system_rhs(const DoFHandler<dim> &          dof_handler,
+                    const QGauss<dim> &              quad,
+                    const ConvectionFunction &       convection_function,
+                    const ForcingFunction &          forcing_function,
+                    const CDR::Parameters &          parameters,
+                    const VectorType &               previous_solution,
+                    const AffineConstraints<double> &constraints,
+                    const double                     current_time,
+                    VectorType &                     system_rhs)
+  {
+    internal_create_system_rhs<dim>(
+      dof_handler,
+      quad,
+      [&convection_function](const std::vector<Point<dim>> &points,
+                             std::vector<Tensor<1, dim>> &  values) {
+        evaluate_in_batches(convection_function, points, values);
+      },
+      [&forcing_function](const double                   time,
+                          const std::vector<Point<dim>> &points,
+                          std::vector<double> &          values) {
+        evaluate_in_batches(
+          [&forcing_function, time](const auto &batch) {
+            return forcing_function(time, batch);
+          },
+          points,
+          values);
+      },
+      parameters,
+      previous_solution,
+      constraints,
+      current_time,
+      system_rhs);
+  }
 } // namespace CDR
 #endif
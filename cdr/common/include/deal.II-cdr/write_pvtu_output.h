@@ -1,8 +1,22 @@
 #ifndef dealii__cdr_write_pvtu_output_h
 #define dealii__cdr_write_pvtu_output_h
+#include <deal.II/base/data_out_base.h>
+#include <deal.II/base/mpi.h>
+
 #include <deal.II/dofs/dof_handler.h>
 
-// This is a small class which handles PVTU output.
+#include <string>
+#include <thread>
+#include <vector>
+
+// This is a small class which handles PVTU output. By default every process
+// writes its own file at the time <code>write_output</code> is called. With
+// many processes it is better to write fewer files: if
+// <code>n_output_groups</code> is nonzero then the processes are split into
+// that many groups and the first process of each group writes the patches of
+// the whole group into one file. If <code>asynchronous</code> is true then
+// the files are written by a background thread, so the time loop only waits
+// for building the patches and sending them to the writing processes.
 namespace CDR
 {
   using namespace dealii;
@@ -10,7 +24,11 @@ namespace CDR
   class WritePVTUOutput
   {
   public:
-    WritePVTUOutput(const unsigned int patch_level);
+    WritePVTUOutput(const unsigned int patch_level,
+                    const unsigned int n_output_groups = 0,
+                    const bool         asynchronous    = false);
+
+    ~WritePVTUOutput();
 
     template <int dim, typename VectorType>
     void
@@ -19,9 +37,28 @@ namespace CDR
                  const unsigned int     time_step_n,
                  const double           current_time);
 
+    // Block until the file started by the last call to
+    // <code>write_output</code> is complete.
+    void
+    wait();
+
   private:
+    template <int dim>
+    static void
+    write_group_file(const std::vector<std::string> &group_patches,
+                     const DataOutBase::VtkFlags &   flags,
+                     const std::string &             file_name);
+
     const unsigned int patch_level;
     const unsigned int this_mpi_process;
+    const unsigned int n_mpi_processes;
+    const bool         asynchronous;
+
+    unsigned int group_size;
+    unsigned int n_groups;
+    MPI_Comm     group_communicator;
+
+    std::thread output_thread;
   };
 } // namespace CDR
 #endif
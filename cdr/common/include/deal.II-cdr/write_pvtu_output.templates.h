@@ -1,6 +1,7 @@
 #ifndef dealii__cdr_write_pvtu_output_templates_h
 #define dealii__cdr_write_pvtu_output_templates_h
 #include <deal.II/base/data_out_base.h>
+#include <deal.II/base/mpi.h>
 #include <deal.II/base/utilities.h>
 
 #include <deal.II/dofs/dof_handler.h>
@@ -12,7 +13,10 @@
 #include <deal.II-cdr/write_pvtu_output.h>
 
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 // Here is the implementation of the important function. This is similar to
@@ -21,6 +25,37 @@ namespace CDR
 {
   using namespace dealii;
 
+  // The patches of a group arrive in deal.II's intermediate format, which
+  // DataOutReader can read back and merge into one set of patches.
+  template <int dim>
+  void
+  WritePVTUOutput::write_group_file(
+    const std::vector<std::string> &group_patches,
+    const DataOutBase::VtkFlags &   flags,
+    const std::string &             file_name)
+  {
+    DataOutReader<dim> data_out_reader;
+    for (unsigned int i = 0; i < group_patches.size(); ++i)
+      {
+        std::istringstream patch_stream(group_patches[i]);
+        if (i == 0)
+          {
+            data_out_reader.read(patch_stream);
+          }
+        else
+          {
+            DataOutReader<dim> other_reader;
+            other_reader.read(patch_stream);
+            data_out_reader.merge(other_reader);
+          }
+      }
+    data_out_reader.set_flags(flags);
+
+    std::ofstream output(file_name);
+    data_out_reader.write_vtu(output);
+  }
+
+
   template <int dim, typename VectorType>
   void
   WritePVTUOutput::write_output(const DoFHandler<dim> &dof_handler,
@@ -28,6 +63,10 @@ namespace CDR
                                 const unsigned int     time_step_n,
                                 const double           current_time)
   {
+    // Only one file is written at a time: this bounds the memory used by
+    // the patches waiting to be written.
+    wait();
+
     DataOut<dim> data_out;
     data_out.attach_dof_handler(dof_handler);
     data_out.add_data_vector(solution, "u");
@@ -49,31 +88,65 @@ namespace CDR
       DataOutBase::VtkFlags::ZlibCompressionLevel::best_speed;
     data_out.set_flags(flags);
 
-    unsigned int subdomain_n;
-    if (Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD) == 1)
+    const auto file_name = [time_step_n](const unsigned int file_n) {
+      return "solution-" + Utilities::int_to_string(time_step_n) + "." +
+             Utilities::int_to_string(file_n, 4) + ".vtu";
+    };
+
+    if (group_size == 1 && !asynchronous)
       {
-        subdomain_n = 0;
+        unsigned int subdomain_n;
+        if (n_mpi_processes == 1)
+          {
+            subdomain_n = 0;
+          }
+        else
+          {
+            subdomain_n = triangulation.locally_owned_subdomain();
+          }
+
+        std::ofstream output(file_name(subdomain_n));
+        data_out.write_vtu(output);
       }
     else
       {
-        subdomain_n = triangulation.locally_owned_subdomain();
-      }
-
-    std::ofstream output("solution-" + Utilities::int_to_string(time_step_n) +
-                         "." + Utilities::int_to_string(subdomain_n, 4) +
-                         ".vtu");
+        // The patches are a snapshot of the solution, so the solver may
+        // change (or the mesh refinement may destroy) the solution while they
+        // are written. Only the communication happens here: the background
+        // thread does not call MPI.
+        std::ostringstream patch_stream;
+        data_out.write_deal_II_intermediate(patch_stream);
+        std::vector<std::string> group_patches =
+          Utilities::MPI::gather(group_communicator, patch_stream.str(), 0);
 
-    data_out.write_vtu(output);
+        if (Utilities::MPI::this_mpi_process(group_communicator) == 0)
+          {
+            const std::string group_file_name(
+              file_name(this_mpi_process / group_size));
+            if (asynchronous)
+              {
+                output_thread =
+                  std::thread([group_patches = std::move(group_patches),
+                               flags,
+                               group_file_name]() {
+                    write_group_file<dim>(group_patches,
+                                          flags,
+                                          group_file_name);
+                  });
+              }
+            else
+              {
+                write_group_file<dim>(group_patches, flags, group_file_name);
+              }
+          }
+      }
 
+    // The record is small, so it is always written right away.
     if (this_mpi_process == 0)
       {
         std::vector<std::string> filenames;
-        for (unsigned int i = 0;
-             i < Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD);
-             ++i)
-          filenames.push_back("solution-" +
-                              Utilities::int_to_string(time_step_n) + "." +
-                              Utilities::int_to_string(i, 4) + ".vtu");
+        for (unsigned int i = 0; i < n_groups; ++i)
+          filenames.push_back(file_name(i));
         std::ofstream master_output(
           "solution-" + Utilities::int_to_string(time_step_n) + ".pvtu");
         data_out.write_pvtu_record(master_output, filenames);
@@ -53,6 +53,18 @@ namespace CDR
                                       "1",
                                       Patterns::Integer(1),
                                       "Finite element order.");
+      parameter_handler.declare_entry("refinement_interval",
+                                      "1",
+                                      Patterns::Integer(1),
+                                      "Number of time steps between two "
+                                      "adaptations of the mesh.");
+      parameter_handler.declare_entry("refinement_error_budget",
+                                      "0.0",
+                                      Patterns::Double(0.0),
+                                      "Largest error indicator allowed "
+                                      "between two adaptations of the mesh "
+                                      "before the mesh is adapted early. Zero "
+                                      "disables the check.");
     }
     parameter_handler.leave_subsection();
 
@@ -73,6 +85,18 @@ namespace CDR
     }
     parameter_handler.leave_subsection();
 
+    parameter_handler.enter_subsection("Linear Solver");
+    {
+      parameter_handler.declare_entry("use_matrix_free",
+                                      "false",
+                                      Patterns::Bool(),
+                                      "Whether or not to apply the system "
+                                      "operator without a sparse matrix and "
+                                      "precondition it with polynomial "
+                                      "multigrid instead of AMG.");
+    }
+    parameter_handler.leave_subsection();
+
     parameter_handler.enter_subsection("Output");
     {
       parameter_handler.declare_entry("save_interval",
@@ -83,6 +107,17 @@ namespace CDR
                                       "2",
                                       Patterns::Integer(0),
                                       "Patch level.");
+      parameter_handler.declare_entry("n_output_groups",
+                                      "0",
+                                      Patterns::Integer(0),
+                                      "Number of files the solution is "
+                                      "written into at each save. Zero means "
+                                      "one file per process.");
+      parameter_handler.declare_entry("asynchronous_output",
+                                      "false",
+                                      Patterns::Bool(),
+                                      "Whether or not to write the files on "
+                                      "a background thread.");
     }
     parameter_handler.leave_subsection();
   }
@@ -123,6 +158,10 @@ namespace CDR
       max_refinement_level =
         parameter_handler.get_integer("max_refinement_level");
       fe_order = parameter_handler.get_integer("fe_order");
+      refinement_interval =
+        parameter_handler.get_integer("refinement_interval");
+      refinement_error_budget =
+        parameter_handler.get_double("refinement_error_budget");
     }
     parameter_handler.leave_subsection();
 
@@ -134,10 +173,19 @@ namespace CDR
     }
     parameter_handler.leave_subsection();
 
+    parameter_handler.enter_subsection("Linear Solver");
+    {
+      use_matrix_free = parameter_handler.get_bool("use_matrix_free");
+    }
+    parameter_handler.leave_subsection();
+
     parameter_handler.enter_subsection("Output");
     {
-      save_interval = parameter_handler.get_integer("save_interval");
-      patch_level   = parameter_handler.get_integer("patch_level");
+      save_interval   = parameter_handler.get_integer("save_interval");
+      patch_level     = parameter_handler.get_integer("patch_level");
+      n_output_groups = parameter_handler.get_integer("n_output_groups");
+      asynchronous_output =
+        parameter_handler.get_bool("asynchronous_output");
     }
     parameter_handler.leave_subsection();
   }
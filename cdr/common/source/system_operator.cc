@@ -0,0 +1,14 @@
+#include <deal.II-cdr/system_operator.templates.h>
+
+// Like <code>system_matrix.cc</code>, this file just compiles template
+// specializations.
+namespace CDR
+{
+  using namespace dealii;
+
+  template class SystemOperator<2, double>;
+  template class SystemOperator<3, double>;
+
+  template class SystemMultigrid<2>;
+  template class SystemMultigrid<3>;
+} // namespace CDR
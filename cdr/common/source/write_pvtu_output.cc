@@ -3,16 +3,53 @@
 
 #include <deal.II-cdr/write_pvtu_output.templates.h>
 
+#include <algorithm>
+
 // Again, this file just compiles the constructor and also the templated
 // functions.
 namespace CDR
 {
   using namespace dealii;
 
-  WritePVTUOutput::WritePVTUOutput(const unsigned int patch_level)
+  WritePVTUOutput::WritePVTUOutput(const unsigned int patch_level,
+                                   const unsigned int n_output_groups,
+                                   const bool         asynchronous)
     : patch_level{patch_level}
     , this_mpi_process{Utilities::MPI::this_mpi_process(MPI_COMM_WORLD)}
-  {}
+    , n_mpi_processes{Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD)}
+    , asynchronous{asynchronous}
+  {
+    // Zero groups means one file per process. Groups are made of consecutive
+    // ranks and all but the last one have the same size.
+    const unsigned int n_requested_groups =
+      (n_output_groups == 0) ? n_mpi_processes :
+                               std::min(n_output_groups, n_mpi_processes);
+    group_size = (n_mpi_processes + n_requested_groups - 1) / n_requested_groups;
+    n_groups   = (n_mpi_processes + group_size - 1) / group_size;
+
+    const int ierr = MPI_Comm_split(MPI_COMM_WORLD,
+                                    this_mpi_process / group_size,
+                                    this_mpi_process,
+                                    &group_communicator);
+    AssertThrowMPI(ierr);
+  }
+
+  WritePVTUOutput::~WritePVTUOutput()
+  {
+    wait();
+    const int ierr = MPI_Comm_free(&group_communicator);
+    AssertNothrow(ierr == MPI_SUCCESS, ExcMessage("MPI_Comm_free failed."));
+    (void)ierr;
+  }
+
+  void
+  WritePVTUOutput::wait()
+  {
+    if (output_thread.joinable())
+      {
+        output_thread.join();
+      }
+  }
 
   template void
   WritePVTUOutput::write_output(const DoFHandler<2> & dof_handler,
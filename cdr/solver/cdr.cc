@@ -5,12 +5,15 @@
 #include <deal.II/dofs/dof_tools.h>
 
 #include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/mapping_q1.h>
 
 #include <deal.II/grid/grid_generator.h>
 #include <deal.II/grid/manifold_lib.h>
 
 #include <deal.II/lac/affine_constraints.h>
 #include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/la_parallel_vector.h>
+#include <deal.II/lac/solver_gmres.h>
 
 #include <deal.II/numerics/error_estimator.h>
 
@@ -29,8 +32,12 @@
 #include <deal.II/lac/trilinos_vector.h>
 
 #include <deal.II-cdr/parameters.h>
-#include <deal.II-cdr/system_matrix.h>
-#include <deal.II-cdr/system_rhs.h>
+// The templates are included here (instead of just the declarations) since
+// the convection and forcing below are passed to the assembly routines as
+// function objects, which are not precompiled in the library.
+#include <deal.II-cdr/system_matrix.templates.h>
+#include <deal.II-cdr/system_operator.h>
+#include <deal.II-cdr/system_rhs.templates.h>
 #include <deal.II-cdr/write_pvtu_output.h>
 
 #include <chrono>
@@ -41,6 +48,37 @@ using namespace dealii;
 
 constexpr int manifold_id{0};
 
+// The convection field and the forcing are function objects whose call
+// operators are templated on the number type, so the assembly routines can
+// evaluate them on points with <code>VectorizedArray</code> coordinates,
+// i.e., on several quadrature points at once.
+template <int dim>
+struct ConvectionFunction
+{
+  template <typename Number>
+  Tensor<1, dim, Number>
+  operator()(const Point<dim, Number> &p) const
+  {
+    Tensor<1, dim, Number> v;
+    v[0] = -p[1];
+    v[1] = p[0];
+    return v;
+  }
+};
+
+template <int dim>
+struct ForcingFunction
+{
+  template <typename Number>
+  Number
+  operator()(const double t, const Point<dim, Number> &p) const
+  {
+    return std::exp(-8.0 * t) *
+           std::exp(-40.0 * Utilities::fixed_power<6>(p[0] - 1.5)) *
+           std::exp(-40.0 * Utilities::fixed_power<6>(p[1]));
+  }
+};
+
 // This is the actual solver class which performs time iteration and calls the
 // appropriate library functions to do it.
 template <int dim>
@@ -66,8 +104,8 @@ private:
   parallel::distributed::Triangulation<dim> triangulation;
   DoFHandler<dim>                           dof_handler;
 
-  const std::function<Tensor<1, dim>(const Point<dim>)> convection_function;
-  const std::function<double(double, const Point<dim>)> forcing_function;
+  const ConvectionFunction<dim> convection_function{};
+  const ForcingFunction<dim>    forcing_function{};
 
   IndexSet locally_owned_dofs;
   IndexSet locally_relevant_dofs;
@@ -87,6 +125,15 @@ private:
   TrilinosWrappers::SparseMatrix    system_matrix;
   TrilinosWrappers::PreconditionAMG preconditioner;
 
+  // If the system is solved without a sparse matrix then these objects take
+  // the place of the last two. The right hand side is still assembled into
+  // <code>system_rhs</code> and copied over before each solve.
+  MappingQ1<dim>                             mapping;
+  CDR::SystemOperator<dim, double>           system_operator;
+  CDR::SystemMultigrid<dim>                  multigrid_preconditioner;
+  LinearAlgebra::distributed::Vector<double> matrix_free_solution;
+  LinearAlgebra::distributed::Vector<double> matrix_free_rhs;
+
   ConditionalOStream pcout;
 
   void
@@ -96,7 +143,9 @@ private:
   void
   setup_dofs();
   void
-  refine_mesh();
+  solve();
+  bool
+  refine_mesh(const bool refinement_step);
   void
   time_iterate();
 };
@@ -119,17 +168,6 @@ CDRProblem<dim>::CDRProblem(const CDR::Parameters &parameters)
                     Triangulation<dim>::smoothing_on_refinement |
                     Triangulation<dim>::smoothing_on_coarsening))
   , dof_handler(triangulation)
-  , convection_function{[](const Point<dim> p) -> Tensor<1, dim> {
-    Tensor<1, dim> v;
-    v[0] = -p[1];
-    v[1] = p[0];
-    return v;
-  }}
-  , forcing_function{[](double t, const Point<dim> p) -> double {
-    return std::exp(-8 * t) *
-           std::exp(-40 * Utilities::fixed_power<6>(p[0] - 1.5)) *
-           std::exp(-40 * Utilities::fixed_power<6>(p[1]));
-  }}
   , first_run{true}
   , pcout(std::cout, this_mpi_process == 0)
 {
@@ -185,6 +223,27 @@ template <int dim>
 void
 CDRProblem<dim>::setup_system()
 {
+  system_rhs.reinit(locally_owned_dofs, mpi_communicator);
+
+  if (parameters.use_matrix_free)
+    {
+      system_operator.reinit(mapping,
+                             dof_handler,
+                             constraints,
+                             convection_function,
+                             parameters,
+                             time_step);
+      multigrid_preconditioner.initialize(dof_handler,
+                                          constraints,
+                                          manifold_id,
+                                          convection_function,
+                                          parameters,
+                                          time_step);
+      system_operator.initialize_dof_vector(matrix_free_solution);
+      system_operator.initialize_dof_vector(matrix_free_rhs);
+      return;
+    }
+
   DynamicSparsityPattern dynamic_sparsity_pattern(dof_handler.n_dofs());
   DoFTools::make_sparsity_pattern(dof_handler,
                                   dynamic_sparsity_pattern,
@@ -195,7 +254,6 @@ CDRProblem<dim>::setup_system()
                                              mpi_communicator,
                                              locally_relevant_dofs);
 
-  system_rhs.reinit(locally_owned_dofs, mpi_communicator);
   system_matrix.reinit(locally_owned_dofs,
                        dynamic_sparsity_pattern,
                        mpi_communicator);
@@ -212,12 +270,62 @@ CDRProblem<dim>::setup_system()
 }
 
 
+template <int dim>
+void
+CDRProblem<dim>::solve()
+{
+  SolverControl solver_control(dof_handler.n_dofs(),
+                               1e-6 * system_rhs.l2_norm(),
+                               /*log_history = */ false,
+                               /*log_result = */ false);
+  if (parameters.use_matrix_free)
+    {
+      // Both vectors store the same locally owned entries, just in different
+      // containers.
+      for (const auto index : locally_owned_dofs)
+        {
+          matrix_free_rhs[index]      = system_rhs[index];
+          matrix_free_solution[index] = completely_distributed_solution[index];
+        }
+      // Use right preconditioning so that the stopping criterion measures
+      // the same (unpreconditioned) residual as the sparse matrix solver.
+      SolverGMRES<LinearAlgebra::distributed::Vector<double>> solver(
+        solver_control,
+        SolverGMRES<LinearAlgebra::distributed::Vector<double>>::AdditionalData(
+          /*max_n_tmp_vectors = */ 30,
+          /*right_preconditioning = */ true));
+      solver.solve(system_operator,
+                   matrix_free_solution,
+                   matrix_free_rhs,
+                   multigrid_preconditioner);
+      for (const auto index : locally_owned_dofs)
+        {
+          completely_distributed_solution[index] = matrix_free_solution[index];
+        }
+      completely_distributed_solution.compress(VectorOperation::insert);
+    }
+  else
+    {
+      TrilinosWrappers::SolverGMRES solver(solver_control);
+      solver.solve(system_matrix,
+                   completely_distributed_solution,
+                   system_rhs,
+                   preconditioner);
+    }
+  constraints.distribute(completely_distributed_solution);
+  locally_relevant_solution = completely_distributed_solution;
+}
+
+
 template <int dim>
 void
 CDRProblem<dim>::time_iterate()
 {
   double               current_time = parameters.start_time;
-  CDR::WritePVTUOutput pvtu_output(parameters.patch_level);
+  CDR::WritePVTUOutput pvtu_output(parameters.patch_level,
+                                   parameters.n_output_groups,
+                                   parameters.asynchronous_output);
+  unsigned int         n_mesh_changes = 0;
   for (unsigned int time_step_n = 0; time_step_n < parameters.n_time_steps;
        ++time_step_n)
     {
@@ -235,17 +343,7 @@ CDRProblem<dim>::time_iterate()
                                   system_rhs);
       system_rhs.compress(VectorOperation::add);
 
-      SolverControl                 solver_control(dof_handler.n_dofs(),
-                                   1e-6 * system_rhs.l2_norm(),
-                                   /*log_history = */ false,
-                                   /*log_result = */ false);
-      TrilinosWrappers::SolverGMRES solver(solver_control);
-      solver.solve(system_matrix,
-                   completely_distributed_solution,
-                   system_rhs,
-                   preconditioner);
-      constraints.distribute(completely_distributed_solution);
-      locally_relevant_solution = completely_distributed_solution;
+      solve();
 
       if (time_step_n % parameters.save_interval == 0)
         {
@@ -255,14 +353,31 @@ CDRProblem<dim>::time_iterate()
                                    current_time);
         }
 
-      refine_mesh();
+      // The mesh is adapted every <code>refinement_interval</code> steps. In
+      // between, the error indicators are only checked against the error
+      // budget (if one is set) so that a quickly moving layer is still
+      // resolved. Since the system matrix only depends on the mesh and the
+      // time step, it and its AMG hierarchy are kept as long as the mesh
+      // does not change.
+      const bool refinement_step =
+        (time_step_n + 1) % parameters.refinement_interval == 0;
+      if (refinement_step || parameters.refinement_error_budget > 0.0)
+        {
+          if (refine_mesh(refinement_step))
+            ++n_mesh_changes;
+        }
     }
+
+  pcout << "The mesh changed " << n_mesh_changes << " times in "
+        << parameters.n_time_steps << " time steps." << std::endl;
 }
 
 
+// The return value indicates whether or not the mesh (and hence the system
+// matrix and the preconditioner) changed.
 template <int dim>
-void
-CDRProblem<dim>::refine_mesh()
+bool
+CDRProblem<dim>::refine_mesh(const bool refinement_step)
 {
   using FunctionMap = std::map<types::boundary_id, const Function<dim> *>;
 
@@ -273,6 +388,16 @@ CDRProblem<dim>::refine_mesh()
                                      locally_relevant_solution,
                                      estimated_error_per_cell);
 
+  // Outside of the regular refinement steps the mesh is only adapted if some
+  // error indicator exceeds the error budget.
+  if (!refinement_step &&
+      Utilities::MPI::max(estimated_error_per_cell.linfty_norm(),
+                          mpi_communicator) <=
+        parameters.refinement_error_budget)
+    {
+      return false;
+    }
+
   // This solver uses a crude refinement strategy where cells with relatively
   // high errors are refined and cells with relatively low errors are
   // coarsened. The maximum refinement level is capped to prevent run-away
@@ -305,6 +430,26 @@ CDRProblem<dim>::refine_mesh()
     solution_transfer(dof_handler);
 
   triangulation.prepare_coarsening_and_refinement();
+
+  // The mesh smoothing may remove all of the flags set above (e.g., if only
+  // cells on the finest level were flagged for refinement or if not all
+  // children of a cell were flagged for coarsening). In that case there is
+  // nothing to transfer and the old system matrix and preconditioner are
+  // still valid, so skip the repartitioning and the setup entirely.
+  unsigned int n_flagged_cells = 0;
+  for (const auto &cell : triangulation.active_cell_iterators())
+    {
+      if (cell->is_locally_owned() &&
+          (cell->refine_flag_set() || cell->coarsen_flag_set()))
+        {
+          ++n_flagged_cells;
+        }
+    }
+  if (Utilities::MPI::sum(n_flagged_cells, mpi_communicator) == 0)
+    {
+      return false;
+    }
+
   solution_transfer.prepare_for_coarsening_and_refinement(
     locally_relevant_solution);
   triangulation.execute_coarsening_and_refinement();
@@ -328,6 +473,8 @@ CDRProblem<dim>::refine_mesh()
   constraints.distribute(completely_distributed_solution);
   locally_relevant_solution = completely_distributed_solution;
   setup_system();
+
+  return true;
 }
 
 
@@ -1,9 +1,14 @@
 // The included deal.II header files are the same as in the other example
 // programs:
+#include <deal.II/base/conditional_ostream.h>
 #include <deal.II/base/function.h>
+#include <deal.II/base/index_set.h>
 #include <deal.II/base/logstream.h>
+#include <deal.II/base/mpi.h>
 #include <deal.II/base/quadrature_lib.h>
 
+#include <deal.II/distributed/tria.h>
+
 #include <deal.II/dofs/dof_accessor.h>
 #include <deal.II/dofs/dof_handler.h>
 #include <deal.II/dofs/dof_tools.h>
@@ -16,11 +21,15 @@
 #include <deal.II/grid/tria_accessor.h>
 #include <deal.II/grid/tria_iterator.h>
 
+#include <deal.II/lac/affine_constraints.h>
 #include <deal.II/lac/dynamic_sparsity_pattern.h>
 #include <deal.II/lac/full_matrix.h>
-#include <deal.II/lac/precondition.h>
+#include <deal.II/lac/la_parallel_vector.h>
 #include <deal.II/lac/solver_cg.h>
-#include <deal.II/lac/sparse_matrix.h>
+#include <deal.II/lac/sparsity_tools.h>
+#include <deal.II/lac/trilinos_precondition.h>
+#include <deal.II/lac/trilinos_sparse_matrix.h>
+#include <deal.II/lac/trilinos_vector.h>
 #include <deal.II/lac/vector.h>
 
 #include <deal.II/numerics/data_out.h>
@@ -31,6 +40,7 @@
 #include <precice/SolverInterface.hpp>
 
 #include <fstream>
+#include <functional>
 #include <iostream>
 
 using namespace dealii;
@@ -42,10 +52,16 @@ using namespace dealii;
 // configuration file as well as the name of the simulation participant, the
 // name of the coupling mesh and the name of the exchanged data. The last three
 // names you also find in the preCICE configuration file. For real application
-// cases, these names are better handled by a parameter file.
+// cases, these names are better handled by a parameter file. The configuration
+// file can be replaced on the command line, e.g. by the implicit coupling
+// scheme in `precice-config-implicit.xml`.
 struct CouplingParamters
 {
-  const std::string config_file      = "precice-config.xml";
+  CouplingParamters(const std::string &config_file = "precice-config.xml")
+    : config_file(config_file)
+  {}
+
+  const std::string config_file;
   const std::string participant_name = "laplace-solver";
   const std::string mesh_name        = "dealii-mesh";
   const std::string read_data_name   = "boundary-data";
@@ -57,22 +73,40 @@ struct CouplingParamters
 // The Adapter class handles all functionalities to couple the deal.II solver
 // code to other solvers with preCICE, i.e., data structures are set up and all
 // relevant information is passed to preCICE.
+//
+// The solver may run on several MPI processes. Each process then passes only
+// the vertices of its locally owned coupling DoFs to preCICE, so that the
+// coupling mesh is distributed in the same way as the triangulation. The
+// coupling data is not stored per DoF index, but in a contiguous vector in the
+// order of the coupling DoFs, and written directly into the inhomogeneities of
+// the AffineConstraints object of the solver.
 
 template <int dim, typename ParameterClass>
 class Adapter
 {
 public:
   Adapter(const ParameterClass &   parameters,
-          const types::boundary_id dealii_boundary_interface_id);
+          const types::boundary_id dealii_boundary_interface_id,
+          const MPI_Comm           mpi_communicator);
 
   double
-  initialize(const DoFHandler<dim> &                    dof_handler,
-             std::map<types::global_dof_index, double> &boundary_data,
-             const MappingQGeneric<dim> &               mapping);
+  initialize(const DoFHandler<dim> &    dof_handler,
+             AffineConstraints<double> &constraints,
+             const Mapping<dim> &       mapping);
 
   double
-  advance(std::map<types::global_dof_index, double> &boundary_data,
-          const double                               computed_timestep_length);
+  advance(AffineConstraints<double> &constraints,
+          const double               computed_timestep_length);
+
+  // In an implicit coupling, a time window is computed repeatedly until the
+  // coupling converged. These two functions call the given function of the
+  // solver to store its state at the beginning of a time window and to
+  // restore it, whenever preCICE requires this.
+  void
+  save_current_state_if_required(const std::function<void()> &save_state);
+
+  void
+  reload_old_state_if_required(const std::function<void()> &reload_old_state);
 
   // public precCICE solver interface
   precice::SolverInterface precice;
@@ -98,27 +132,31 @@ private:
   int read_data_id;
   int n_interface_nodes;
 
-  // DoF IndexSet, containing relevant coupling DoF indices at the coupling
-  // boundary
+  // The MPI rank and total number of MPI ranks is required by preCICE when the
+  // SolverInterface is created.
+  const MPI_Comm mpi_communicator;
+
+  // DoF IndexSets, containing the locally owned coupling DoF indices, i.e.,
+  // the ones passed to preCICE, and all coupling DoF indices on faces of
+  // locally owned cells, i.e., the ones used during the assembly on this
+  // process
   IndexSet coupling_dofs;
+  IndexSet relevant_coupling_dofs;
 
   // Data containers which are passed to preCICE in an appropriate preCICE
-  // specific format
+  // specific format. The entries of `read_data` belong to the entries of
+  // `coupling_dofs` in the same order.
   std::vector<int>    interface_nodes_ids;
   std::vector<double> read_data;
 
-  // The MPI rank and total number of MPI ranks is required by preCICE when the
-  // SolverInterface is created. Since this tutorial runs only in serial mode we
-  // define the variables manually in this class instead of using the regular
-  // MPI interface.
-  static constexpr int this_mpi_process = 0;
-  static constexpr int n_mpi_processes  = 1;
-
-  // Function to transform the obtained data from preCICE into an appropriate
-  // map for Dirichlet boundary conditions
+  // The coupling values of DoFs owned by other processes are obtained by a
+  // ghost value update of this vector.
+  LinearAlgebra::distributed::Vector<double> coupling_values;
+
+  // Function to transform the obtained data from preCICE into the
+  // inhomogeneities of the constraints used for Dirichlet boundary conditions
   void
-  format_precice_to_dealii(
-    std::map<types::global_dof_index, double> &boundary_data) const;
+  format_precice_to_dealii(AffineConstraints<double> &constraints);
 };
 
 
@@ -129,18 +167,21 @@ private:
 // been specified in the CouplingParameter class above. Thus, we pass the class
 // directly to the constructor and read out all relevant information. As a
 // second parameter, we need to specify the boundary ID of our triangulation,
-// which is associated with the coupling interface.
+// which is associated with the coupling interface. The last parameter is the
+// MPI communicator of the triangulation.
 template <int dim, typename ParameterClass>
 Adapter<dim, ParameterClass>::Adapter(
   const ParameterClass &   parameters,
-  const types::boundary_id deal_boundary_interface_id)
+  const types::boundary_id deal_boundary_interface_id,
+  const MPI_Comm           mpi_communicator)
   : precice(parameters.participant_name,
             parameters.config_file,
-            this_mpi_process,
-            n_mpi_processes)
+            Utilities::MPI::this_mpi_process(mpi_communicator),
+            Utilities::MPI::n_mpi_processes(mpi_communicator))
   , dealii_boundary_interface_id(deal_boundary_interface_id)
   , mesh_name(parameters.mesh_name)
   , read_data_name(parameters.read_data_name)
+  , mpi_communicator(mpi_communicator)
 {}
 
 
@@ -148,17 +189,19 @@ Adapter<dim, ParameterClass>::Adapter(
 // This function initializes preCICE (e.g. establishes communication channels
 // and allocates memory) and passes all relevant data to preCICE. For surface
 // coupling, relevant data is in particular the location of the data points at
-// the associated interface(s). The `boundary_data` is an empty map, which is
-// filled by preCICE, i.e., information of the other participant. Throughout
-// the system assembly, the map can directly be used in order to apply the
-// Dirichlet boundary conditions in the linear system. preCICE returns the
-// maximum admissible time-step size during the initialization.
+// the associated interface(s). The constraints of the solver already contain a
+// (so far homogeneous) line for every coupling DoF of this process, and the
+// Adapter fills in the data of the other participant as inhomogeneities.
+// Throughout the system assembly, the constraints can directly be used in
+// order to apply the Dirichlet boundary conditions in the linear system.
+// preCICE returns the maximum admissible time-step size during the
+// initialization.
 template <int dim, typename ParameterClass>
 double
 Adapter<dim, ParameterClass>::initialize(
-  const DoFHandler<dim> &                    dof_handler,
-  std::map<types::global_dof_index, double> &boundary_data,
-  const MappingQGeneric<dim> &               mapping)
+  const DoFHandler<dim> &    dof_handler,
+  AffineConstraints<double> &constraints,
+  const Mapping<dim> &       mapping)
 {
   Assert(dim > 1, ExcNotImplemented());
   AssertDimension(dim, precice.getDimensions());
@@ -171,28 +214,30 @@ Adapter<dim, ParameterClass>::initialize(
 
   // Afterwards, we extract the number of interface nodes and the coupling DoFs
   // at the coupling interface from our deal.II solver via
-  // `extract_boundary_dofs()`
-  std::set<types::boundary_id> couplingBoundary;
-  couplingBoundary.insert(dealii_boundary_interface_id);
-
+  // `extract_boundary_dofs()`. On a distributed triangulation, this function
+  // returns the DoFs on boundary faces of locally owned cells.
+  //
   // The `ComponentMask()` might be important in case we deal with vector valued
   // problems, because vector valued problems have a DoF for each component.
-  DoFTools::extract_boundary_dofs(dof_handler,
-                                  ComponentMask(),
-                                  coupling_dofs,
-                                  couplingBoundary);
+  relevant_coupling_dofs =
+    DoFTools::extract_boundary_dofs(dof_handler,
+                                    ComponentMask(),
+                                    {dealii_boundary_interface_id});
 
-  // The coupling DoFs are used to set up the `boundary_data` map. At the end,
-  // we associate here each DoF with a respective boundary value.
-  for (const auto i : coupling_dofs)
-    boundary_data[i] = 0.0;
+  // Every coupling DoF is passed to preCICE only once, namely by the process
+  // which owns it.
+  coupling_dofs = relevant_coupling_dofs & dof_handler.locally_owned_dofs();
 
   // Since we deal with a scalar problem, the number of DoFs at the particular
   // interface corresponds to the number of interface nodes.
   n_interface_nodes = coupling_dofs.n_elements();
 
-  std::cout << "\t Number of coupling nodes:     " << n_interface_nodes
-            << std::endl;
+  ConditionalOStream pcout(std::cout,
+                           Utilities::MPI::this_mpi_process(mpi_communicator) ==
+                             0);
+  pcout << "\t Number of coupling nodes:     "
+        << Utilities::MPI::sum(n_interface_nodes, mpi_communicator)
+        << std::endl;
 
   // Now, we need to tell preCICE the coordinates of the interface nodes. Hence,
   // we set up a std::vector to pass the node positions to preCICE. Each node is
@@ -211,9 +256,10 @@ Adapter<dim, ParameterClass>::initialize(
   std::map<types::global_dof_index, Point<dim>> support_points;
   DoFTools::map_dofs_to_support_points(mapping, dof_handler, support_points);
 
-  // `support_points` contains now the coordinates of all DoFs. In the next
-  // step, the relevant coordinates are extracted using the IndexSet with the
-  // extracted coupling_dofs.
+  // `support_points` contains now the coordinates of all locally relevant DoFs.
+  // In the next step, the relevant coordinates are extracted using the
+  // IndexSet with the extracted coupling_dofs. This map is only used once
+  // during the initialization.
   for (const auto element : coupling_dofs)
     for (int i = 0; i < dim; ++i)
       interface_nodes_positions.push_back(support_points[element][i]);
@@ -225,6 +271,12 @@ Adapter<dim, ParameterClass>::initialize(
                           interface_nodes_positions.data(),
                           interface_nodes_ids.data());
 
+  // The values of the coupling DoFs which are used on this process but owned
+  // by another one are the ghost entries of this vector.
+  coupling_values.reinit(dof_handler.locally_owned_dofs(),
+                         relevant_coupling_dofs,
+                         mpi_communicator);
+
   // Then, we initialize preCICE internally calling the API function
   // `initialize()`
   const double max_delta_t = precice.initialize();
@@ -239,10 +291,10 @@ Adapter<dim, ParameterClass>::initialize(
                                   interface_nodes_ids.data(),
                                   read_data.data());
 
-      // After receiving the coupling data in `read_data`, we convert it to
-      // the std::map `boundary_data` which is later needed in order to apply
-      // Dirichlet boundary conditions
-      format_precice_to_dealii(boundary_data);
+      // After receiving the coupling data in `read_data`, we write it into
+      // the constraints which are later needed in order to apply Dirichlet
+      // boundary conditions
+      format_precice_to_dealii(constraints);
     }
 
   return max_delta_t;
@@ -255,8 +307,8 @@ Adapter<dim, ParameterClass>::initialize(
 template <int dim, typename ParameterClass>
 double
 Adapter<dim, ParameterClass>::advance(
-  std::map<types::global_dof_index, double> &boundary_data,
-  const double                               computed_timestep_length)
+  AffineConstraints<double> &constraints,
+  const double               computed_timestep_length)
 {
   // We specify the computed time-step length and pass it to preCICE. In
   // return, preCICE tells us the maximum admissible time-step size our
@@ -265,40 +317,88 @@ Adapter<dim, ParameterClass>::advance(
   const double max_delta_t = precice.advance(computed_timestep_length);
 
   // As a next step, we obtain data, i.e. the boundary condition, from another
-  // participant. We have already all IDs and just need to convert our obtained
-  // data to the deal.II compatible 'boundary map' , which is done in the
-  // format_deal_to_precice function.
+  // participant. We have already all IDs and just need to write our obtained
+  // data into the deal.II constraints, which is done in the
+  // format_precice_to_dealii function.
   precice.readBlockScalarData(read_data_id,
                               n_interface_nodes,
                               interface_nodes_ids.data(),
                               read_data.data());
 
-  format_precice_to_dealii(boundary_data);
+  format_precice_to_dealii(constraints);
 
   return max_delta_t;
 }
 
 
 
+// preCICE asks for an iteration checkpoint at the beginning of every time
+// window of an implicit coupling scheme. The solver passes a function, which
+// stores all data required to repeat the time window, and we tell preCICE that
+// the action has been carried out.
+template <int dim, typename ParameterClass>
+void
+Adapter<dim, ParameterClass>::save_current_state_if_required(
+  const std::function<void()> &save_state)
+{
+  if (precice.isActionRequired(
+        precice::constants::actionWriteIterationCheckpoint()))
+    {
+      save_state();
+      precice.markActionFulfilled(
+        precice::constants::actionWriteIterationCheckpoint());
+    }
+}
+
+
+
+// If the coupling iteration has not converged after `advance()`, preCICE asks
+// for the checkpoint to be read again and the solver goes back to the
+// beginning of the time window.
+template <int dim, typename ParameterClass>
+void
+Adapter<dim, ParameterClass>::reload_old_state_if_required(
+  const std::function<void()> &reload_old_state)
+{
+  if (precice.isActionRequired(
+        precice::constants::actionReadIterationCheckpoint()))
+    {
+      reload_old_state();
+      precice.markActionFulfilled(
+        precice::constants::actionReadIterationCheckpoint());
+    }
+}
+
+
+
 // This function takes the std::vector obtained by preCICE in `read_data` and
-// inserts the values to the right position in the boundary map used throughout
-// our deal.II solver for Dirichlet boundary conditions. The function is only
-// used internally in the Adapter class and not called in the solver itself. The
-// order, in which preCICE sorts the data in the `read_data` vector is exactly
-// the same as the order of the initially passed vertices coordinates.
+// sets the inhomogeneities of the coupling DoFs in the constraints used
+// throughout our deal.II solver for Dirichlet boundary conditions. The function
+// is only used internally in the Adapter class and not called in the solver
+// itself. The order, in which preCICE sorts the data in the `read_data` vector
+// is exactly the same as the order of the initially passed vertices
+// coordinates, i.e., the order of the `coupling_dofs`.
+//
+// Only the inhomogeneities are changed, so the constraints can stay closed and
+// nothing else needs to be rebuilt. Since the function updates the ghost values
+// of `coupling_values`, it has to be called on all processes.
 template <int dim, typename ParameterClass>
 void
 Adapter<dim, ParameterClass>::format_precice_to_dealii(
-  std::map<types::global_dof_index, double> &boundary_data) const
+  AffineConstraints<double> &constraints)
 {
-  // We already stored the coupling DoF indices in the `boundary_data` map, so
-  // that we can simply iterate over all keys in the map.
-  auto dof_component = boundary_data.begin();
-  for (int i = 0; i < n_interface_nodes; ++i)
+  AssertDimension(read_data.size(), coupling_dofs.n_elements());
+
+  auto value = read_data.begin();
+  for (const auto dof : coupling_dofs)
+    coupling_values(dof) = *value++;
+  coupling_values.update_ghost_values();
+
+  for (const auto dof : relevant_coupling_dofs)
     {
-      AssertIndexRange(i, read_data.size());
-      boundary_data[dof_component->first] = read_data[i];
-      ++dof_component;
+      Assert(constraints.is_constrained(dof),
+             ExcMessage("The constraints have no line for a coupling DoF."));
+      constraints.set_inhomogeneity(dof, coupling_values(dof));
     }
 }
 
@@ -310,7 +410,7 @@ template <int dim>
 class CoupledLaplaceProblem
 {
 public:
-  CoupledLaplaceProblem();
+  CoupledLaplaceProblem(const std::string &config_file);
 
   void
   run();
@@ -327,29 +427,56 @@ private:
   void
   output_results() const;
 
-  Triangulation<dim> triangulation;
-  FE_Q<dim>          fe;
-  DoFHandler<dim>    dof_handler;
-  MappingQ1<dim>     mapping;
-
-  SparsityPattern      sparsity_pattern;
-  SparseMatrix<double> system_matrix;
-
-  Vector<double> solution;
-  Vector<double> old_solution;
-  Vector<double> system_rhs;
-
-  // We allocate all structures required for the preCICE coupling: The map
-  // is used to apply Dirichlet boundary conditions and filled in the Adapter
-  // class with data from the other participant. The CouplingParameters hold the
-  // preCICE configuration as described above. The interface boundary ID is the
-  // ID associated to our coupling interface and needs to be specified, when we
-  // set up the Adapter class object, because we pass it directly to the
-  // Constructor of this class.
-  std::map<types::global_dof_index, double> boundary_data;
-  CouplingParamters                         parameters;
-  const types::boundary_id                  interface_boundary_id;
-  Adapter<dim, CouplingParamters>           adapter;
+  // The state of the solver at the beginning of a time window, which is
+  // restored if preCICE repeats the window in an implicit coupling.
+  void
+  save_state();
+  void
+  reload_old_state();
+
+  // As in step-40, the triangulation is distributed over all MPI processes
+  // and the linear algebra objects are the ones of Trilinos.
+  MPI_Comm mpi_communicator;
+
+  parallel::distributed::Triangulation<dim> triangulation;
+  FE_Q<dim>                                 fe;
+  DoFHandler<dim>                           dof_handler;
+  MappingQ1<dim>                            mapping;
+
+  IndexSet locally_owned_dofs;
+  IndexSet locally_relevant_dofs;
+
+  // The constraints contain both Dirichlet boundary conditions. The values at
+  // the coupling boundary are updated by the Adapter with data from the other
+  // participant.
+  AffineConstraints<double> constraints;
+
+  TrilinosWrappers::SparseMatrix system_matrix;
+
+  // The solution vectors contain ghost entries, since they are evaluated on
+  // the locally owned cells during the assembly and output.
+  TrilinosWrappers::MPI::Vector solution;
+  TrilinosWrappers::MPI::Vector old_solution;
+  TrilinosWrappers::MPI::Vector system_rhs;
+
+  // Copies of the solution vectors, the time and the time-step number at the
+  // beginning of the current time window. The vectors are allocated in
+  // setup_system(), so restoring the state only copies entries.
+  TrilinosWrappers::MPI::Vector solution_checkpoint;
+  TrilinosWrappers::MPI::Vector old_solution_checkpoint;
+  double                        time_checkpoint      = 0;
+  unsigned int                  time_step_checkpoint = 0;
+
+  // We allocate all structures required for the preCICE coupling: The
+  // CouplingParameters hold the preCICE configuration as described above. The
+  // interface boundary ID is the ID associated to our coupling interface and
+  // needs to be specified, when we set up the Adapter class object, because we
+  // pass it directly to the Constructor of this class.
+  const CouplingParamters         parameters;
+  const types::boundary_id        interface_boundary_id;
+  Adapter<dim, CouplingParamters> adapter;
+
+  ConditionalOStream pcout;
 
   // The time-step size delta_t is the acutual time-step size used for all
   // computations. The preCICE time-step size is obtained by preCICE in order to
@@ -360,6 +487,7 @@ private:
   double       delta_t;
   double       precice_delta_t;
   const double solver_delta_t = 0.1;
+  double       time           = 0;
   unsigned int time_step      = 0;
 };
 
@@ -407,11 +535,16 @@ BoundaryValues<dim>::value(const Point<dim> &p,
 
 
 template <int dim>
-CoupledLaplaceProblem<dim>::CoupledLaplaceProblem()
-  : fe(1)
+CoupledLaplaceProblem<dim>::CoupledLaplaceProblem(
+  const std::string &config_file)
+  : mpi_communicator(MPI_COMM_WORLD)
+  , triangulation(mpi_communicator)
+  , fe(1)
   , dof_handler(triangulation)
+  , parameters(config_file)
   , interface_boundary_id(1)
-  , adapter(parameters, interface_boundary_id)
+  , adapter(parameters, interface_boundary_id, mpi_communicator)
+  , pcout(std::cout, Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
 {}
 
 
@@ -420,8 +553,9 @@ void
 CoupledLaplaceProblem<dim>::make_grid()
 {
   GridGenerator::hyper_cube(triangulation, -1, 1);
-  triangulation.refine_global(4);
 
+  // The boundary IDs are set on the coarse mesh, the refined cells inherit
+  // them.
   for (const auto &cell : triangulation.active_cell_iterators())
     for (const auto &face : cell->face_iterators())
       {
@@ -431,10 +565,10 @@ CoupledLaplaceProblem<dim>::make_grid()
           face->set_boundary_id(interface_boundary_id);
       }
 
-  std::cout << "   Number of active cells: " << triangulation.n_active_cells()
-            << std::endl
-            << "   Total number of cells: " << triangulation.n_cells()
-            << std::endl;
+  triangulation.refine_global(4);
+
+  pcout << "   Number of active cells: "
+        << triangulation.n_global_active_cells() << std::endl;
 }
 
 
@@ -444,18 +578,52 @@ CoupledLaplaceProblem<dim>::setup_system()
 {
   dof_handler.distribute_dofs(fe);
 
-  std::cout << "   Number of degrees of freedom: " << dof_handler.n_dofs()
-            << std::endl;
-
-  DynamicSparsityPattern dsp(dof_handler.n_dofs());
-  DoFTools::make_sparsity_pattern(dof_handler, dsp);
-  sparsity_pattern.copy_from(dsp);
-
-  system_matrix.reinit(sparsity_pattern);
-
-  solution.reinit(dof_handler.n_dofs());
-  old_solution.reinit(dof_handler.n_dofs());
-  system_rhs.reinit(dof_handler.n_dofs());
+  pcout << "   Number of degrees of freedom: " << dof_handler.n_dofs()
+        << std::endl;
+
+  locally_owned_dofs = dof_handler.locally_owned_dofs();
+  DoFTools::extract_locally_relevant_dofs(dof_handler, locally_relevant_dofs);
+
+  // Both Dirichlet boundaries are described by the constraints. The coupling
+  // DoFs get a line first, the values are set by the Adapter later on. Then
+  // the fixed boundary condition of step-4 follows, which does not touch DoFs
+  // that are already constrained, so that the coupling data wins at the two
+  // corners shared by both boundaries. Since the set of constrained DoFs never
+  // changes, the constraints are only set up (and closed) once.
+  constraints.clear();
+  constraints.reinit(locally_relevant_dofs);
+  const IndexSet coupling_dofs =
+    DoFTools::extract_boundary_dofs(dof_handler,
+                                    ComponentMask(),
+                                    {interface_boundary_id});
+  for (const auto dof : coupling_dofs)
+    constraints.add_line(dof);
+  VectorTools::interpolate_boundary_values(dof_handler,
+                                           0,
+                                           BoundaryValues<dim>(),
+                                           constraints);
+  constraints.close();
+
+  DynamicSparsityPattern dsp(locally_relevant_dofs);
+  DoFTools::make_sparsity_pattern(dof_handler, dsp, constraints, false);
+  SparsityTools::distribute_sparsity_pattern(dsp,
+                                             locally_owned_dofs,
+                                             mpi_communicator,
+                                             locally_relevant_dofs);
+
+  system_matrix.reinit(locally_owned_dofs,
+                       locally_owned_dofs,
+                       dsp,
+                       mpi_communicator);
+
+  solution.reinit(locally_owned_dofs, locally_relevant_dofs, mpi_communicator);
+  old_solution.reinit(locally_owned_dofs,
+                      locally_relevant_dofs,
+                      mpi_communicator);
+  system_rhs.reinit(locally_owned_dofs, mpi_communicator);
+
+  solution_checkpoint.reinit(solution);
+  old_solution_checkpoint.reinit(old_solution);
 }
 
 
@@ -489,70 +657,49 @@ CoupledLaplaceProblem<dim>::assemble_system()
   std::vector<double> local_values_old_solution(fe_values.n_quadrature_points);
 
   for (const auto &cell : dof_handler.active_cell_iterators())
-    {
-      fe_values.reinit(cell);
-      cell_matrix = 0;
-      cell_rhs    = 0;
-      // Get the local values from the `fe_values' object
-      fe_values.get_function_values(old_solution, local_values_old_solution);
-
-      // The system matrix contains additionally a mass matrix due to the time
-      // discretization. The RHS has contributions from the old solution values.
-      for (const unsigned int q_index : fe_values.quadrature_point_indices())
-        for (const unsigned int i : fe_values.dof_indices())
-          {
-            for (const unsigned int j : fe_values.dof_indices())
-              cell_matrix(i, j) +=
-                ((fe_values.shape_value(i, q_index) *  // phi_i(x_q)
-                  fe_values.shape_value(j, q_index)) + // phi_j(x_q)
-                 (delta_t *                            // delta t
-                  fe_values.shape_grad(i, q_index) *   // grad phi_i(x_q)
-                  fe_values.shape_grad(j, q_index))) * // grad phi_j(x_q)
-                fe_values.JxW(q_index);                // dx
-
-            const auto  x_q         = fe_values.quadrature_point(q_index);
-            const auto &local_value = local_values_old_solution[q_index];
-            cell_rhs(i) += ((delta_t *                           // delta t
-                             fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                             right_hand_side.value(x_q)) +       // f(x_q)
-                            fe_values.shape_value(i, q_index) *
-                              local_value) *       // phi_i(x_q)*val
-                           fe_values.JxW(q_index); // dx
-          }
-
-      // Copy local to global
-      cell->get_dof_indices(local_dof_indices);
-      for (const unsigned int i : fe_values.dof_indices())
-        {
-          for (const unsigned int j : fe_values.dof_indices())
-            system_matrix.add(local_dof_indices[i],
-                              local_dof_indices[j],
-                              cell_matrix(i, j));
-
-          system_rhs(local_dof_indices[i]) += cell_rhs(i);
-        }
-    }
-  {
-    // At first, we apply the Dirichlet boundary condition from step-4, as
-    // usual.
-    std::map<types::global_dof_index, double> boundary_values;
-    VectorTools::interpolate_boundary_values(dof_handler,
-                                             0,
-                                             BoundaryValues<dim>(),
-                                             boundary_values);
-    MatrixTools::apply_boundary_values(boundary_values,
-                                       system_matrix,
-                                       solution,
-                                       system_rhs);
-  }
-  {
-    // Afterwards, we apply the coupling boundary condition. The `boundary_data`
-    // has already been filled by preCICE.
-    MatrixTools::apply_boundary_values(boundary_data,
-                                       system_matrix,
-                                       solution,
-                                       system_rhs);
-  }
+    if (cell->is_locally_owned())
+      {
+        fe_values.reinit(cell);
+        cell_matrix = 0;
+        cell_rhs    = 0;
+        // Get the local values from the `fe_values' object
+        fe_values.get_function_values(old_solution, local_values_old_solution);
+
+        // The system matrix contains additionally a mass matrix due to the
+        // time discretization. The RHS has contributions from the old solution
+        // values.
+        for (const unsigned int q_index : fe_values.quadrature_point_indices())
+          for (const unsigned int i : fe_values.dof_indices())
+            {
+              for (const unsigned int j : fe_values.dof_indices())
+                cell_matrix(i, j) +=
+                  ((fe_values.shape_value(i, q_index) *  // phi_i(x_q)
+                    fe_values.shape_value(j, q_index)) + // phi_j(x_q)
+                   (delta_t *                            // delta t
+                    fe_values.shape_grad(i, q_index) *   // grad phi_i(x_q)
+                    fe_values.shape_grad(j, q_index))) * // grad phi_j(x_q)
+                  fe_values.JxW(q_index);                // dx
+
+              const auto  x_q         = fe_values.quadrature_point(q_index);
+              const auto &local_value = local_values_old_solution[q_index];
+              cell_rhs(i) += ((delta_t *                           // delta t
+                               fe_values.shape_value(i, q_index) * // phi_i(x_q)
+                               right_hand_side.value(x_q)) +       // f(x_q)
+                              fe_values.shape_value(i, q_index) *
+                                local_value) *       // phi_i(x_q)*val
+                             fe_values.JxW(q_index); // dx
+            }
+
+        // Copy local to global. The constraints apply both Dirichlet boundary
+        // conditions, in particular the current coupling data, which has
+        // already been written into the constraints by the Adapter.
+        cell->get_dof_indices(local_dof_indices);
+        constraints.distribute_local_to_global(
+          cell_matrix, cell_rhs, local_dof_indices, system_matrix, system_rhs);
+      }
+
+  system_matrix.compress(VectorOperation::add);
+  system_rhs.compress(VectorOperation::add);
 }
 
 
@@ -561,12 +708,25 @@ template <int dim>
 void
 CoupledLaplaceProblem<dim>::solve()
 {
-  SolverControl            solver_control(1000, 1e-12);
-  SolverCG<Vector<double>> solver(solver_control);
-  solver.solve(system_matrix, solution, system_rhs, PreconditionIdentity());
+  TrilinosWrappers::MPI::Vector completely_distributed_solution(
+    locally_owned_dofs, mpi_communicator);
+
+  SolverControl                           solver_control(1000, 1e-12);
+  SolverCG<TrilinosWrappers::MPI::Vector> solver(solver_control);
+
+  TrilinosWrappers::PreconditionAMG preconditioner;
+  preconditioner.initialize(system_matrix);
+
+  solver.solve(system_matrix,
+               completely_distributed_solution,
+               system_rhs,
+               preconditioner);
 
-  std::cout << "   " << solver_control.last_step()
-            << " CG iterations needed to obtain convergence." << std::endl;
+  pcout << "   " << solver_control.last_step()
+        << " CG iterations needed to obtain convergence." << std::endl;
+
+  constraints.distribute(completely_distributed_solution);
+  solution = completely_distributed_solution;
 }
 
 
@@ -582,8 +742,50 @@ CoupledLaplaceProblem<dim>::output_results() const
 
   data_out.build_patches(mapping);
 
-  std::ofstream output("solution-" + std::to_string(time_step) + ".vtk");
-  data_out.write_vtk(output);
+  // The physical time is stored in the output files, so that a visualization
+  // of an implicit coupling shows the converged state of each time window.
+  DataOutBase::VtkFlags flags;
+  flags.time  = time;
+  flags.cycle = time_step;
+  data_out.set_flags(flags);
+
+  // A serial run writes the same single file as before, a parallel run one
+  // file per process and a record which combines them.
+  if (Utilities::MPI::n_mpi_processes(mpi_communicator) == 1)
+    {
+      std::ofstream output("solution-" + std::to_string(time_step) + ".vtk");
+      data_out.write_vtk(output);
+    }
+  else
+    data_out.write_vtu_with_pvtu_record(
+      "./", "solution", time_step, mpi_communicator, 2);
+}
+
+
+
+// The state of a time window consists of the solution vectors, the time and
+// the time-step number. The matrix and right-hand side are assembled anew in
+// every iteration and need not be stored.
+template <int dim>
+void
+CoupledLaplaceProblem<dim>::save_state()
+{
+  solution_checkpoint     = solution;
+  old_solution_checkpoint = old_solution;
+  time_checkpoint         = time;
+  time_step_checkpoint    = time_step;
+}
+
+
+
+template <int dim>
+void
+CoupledLaplaceProblem<dim>::reload_old_state()
+{
+  solution     = solution_checkpoint;
+  old_solution = old_solution_checkpoint;
+  time         = time_checkpoint;
+  time_step    = time_step_checkpoint;
 }
 
 
@@ -592,8 +794,7 @@ template <int dim>
 void
 CoupledLaplaceProblem<dim>::run()
 {
-  std::cout << "Solving problem in " << dim << " space dimensions."
-            << std::endl;
+  pcout << "Solving problem in " << dim << " space dimensions." << std::endl;
 
   make_grid();
   setup_system();
@@ -601,15 +802,21 @@ CoupledLaplaceProblem<dim>::run()
   // After we set up the system, we initialize preCICE using the functionalities
   // of the Adapter. preCICE returns the maximum admissible time-step size,
   // which needs to be compared to our desired solver time-step size.
-  precice_delta_t = adapter.initialize(dof_handler, boundary_data, mapping);
+  precice_delta_t = adapter.initialize(dof_handler, constraints, mapping);
   delta_t         = std::min(precice_delta_t, solver_delta_t);
 
   // preCICE steers the coupled simulation: `isCouplingOngoing` is
   // used to synchronize the end of the simulation with the coupling partner
   while (adapter.precice.isCouplingOngoing())
     {
+      // In an implicit coupling, we store the state at the beginning of the
+      // time window, so that it can be computed again. For an explicit
+      // coupling, preCICE never asks for a checkpoint.
+      adapter.save_current_state_if_required([this]() { save_state(); });
+
       // The time step number is solely used to generate unique output files
       ++time_step;
+      time += delta_t;
       // In the time loop, we assemble the coupled system and solve it as
       // usual.
       assemble_system();
@@ -621,9 +828,14 @@ CoupledLaplaceProblem<dim>::run()
       // obtain new data from preCICE, so from the other participant. As before,
       // we obtain a maximum time-step size and compare it against the desired
       // solver time-step size.
-      precice_delta_t = adapter.advance(boundary_data, delta_t);
+      precice_delta_t = adapter.advance(constraints, delta_t);
       delta_t         = std::min(precice_delta_t, solver_delta_t);
 
+      // If the coupling has not converged yet, we go back to the beginning of
+      // the time window. The boundary data obtained in `advance()` are kept,
+      // they are the new iterate of the coupling.
+      adapter.reload_old_state_if_required([this]() { reload_old_state(); });
+
       // Write an output file if the time step is completed. In case of an
       // implicit coupling, where individual time steps are computed more than
       // once, the function `isTimeWindowCompleted` prevents unnecessary result
@@ -637,9 +849,14 @@ CoupledLaplaceProblem<dim>::run()
 
 
 int
-main()
+main(int argc, char **argv)
 {
-  CoupledLaplaceProblem<2> laplace_problem;
+  Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv, 1);
+
+  // An optional argument replaces the default preCICE configuration file.
+  const std::string config_file(argc > 1 ? argv[1] : "precice-config.xml");
+
+  CoupledLaplaceProblem<2> laplace_problem(config_file);
   laplace_problem.run();
 
   return 0;
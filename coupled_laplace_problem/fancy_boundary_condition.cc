@@ -33,12 +33,13 @@ define_boundary_values(std::vector<double> &boundary_data,
 
 
 int
-main()
+main(int argc, char **argv)
 {
   std::cout << "Boundary participant: starting... \n";
 
-  // Configuration
-  const std::string configFileName("precice-config.xml");
+  // Configuration. As for the Laplace solver, an optional argument replaces
+  // the preCICE configuration file.
+  const std::string configFileName(argc > 1 ? argv[1] : "precice-config.xml");
   const std::string solverName("boundary-participant");
   const std::string meshName("boundary-mesh");
   const std::string dataWriteName("boundary-data");
@@ -90,10 +91,21 @@ main()
   double dt = precice.initialize();
 
   // Start time loop
-  const double end_time = 1;
-  double       time     = 0;
+  const double end_time        = 1;
+  double       time            = 0;
+  double       time_checkpoint = 0;
   while (precice.isCouplingOngoing())
     {
+      // In an implicit coupling, the time window might be repeated, so we
+      // store the time at its beginning.
+      if (precice.isActionRequired(
+            precice::constants::actionWriteIterationCheckpoint()))
+        {
+          time_checkpoint = time;
+          precice.markActionFulfilled(
+            precice::constants::actionWriteIterationCheckpoint());
+        }
+
       // Generate new boundary data
       define_boundary_values(writeData, time, end_time);
 
@@ -106,9 +118,21 @@ main()
       }
 
       dt = precice.advance(dt);
-      std::cout << "Boundary participant: advancing in time\n";
 
-      time += dt;
+      // If the coupling iteration has not converged, the time window is
+      // computed again from its beginning.
+      if (precice.isActionRequired(
+            precice::constants::actionReadIterationCheckpoint()))
+        {
+          time = time_checkpoint;
+          precice.markActionFulfilled(
+            precice::constants::actionReadIterationCheckpoint());
+        }
+      else
+        {
+          std::cout << "Boundary participant: advancing in time\n";
+          time += dt;
+        }
     }
 
   std::cout << "Boundary participant: closing...\n";
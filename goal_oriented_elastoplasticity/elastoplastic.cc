@@ -33,6 +33,7 @@
 #include <deal.II/base/logstream.h>
 #include <deal.II/base/timer.h>
 #include <deal.II/base/table_handler.h>
+#include <deal.II/base/vectorization.h>
 
 #include <deal.II/lac/vector.h>
 #include <deal.II/lac/full_matrix.h>
@@ -41,6 +42,7 @@
 #include <deal.II/lac/dynamic_sparsity_pattern.h>
 #include <deal.II/lac/block_sparsity_pattern.h>
 #include <deal.II/lac/solver_bicgstab.h>
+#include <deal.II/lac/solver_gmres.h>
 #include <deal.II/lac/precondition.h>
 #include <deal.II/lac/affine_constraints.h>
 #include <deal.II/lac/trilinos_sparse_matrix.h>
@@ -50,6 +52,9 @@
 #include <deal.II/lac/trilinos_solver.h>
 #include <deal.II/lac/sparse_direct.h>
 
+#include <Epetra_MultiVector.h>
+#include <Teuchos_ParameterList.hpp>
+
 #include <deal.II/grid/tria.h>
 #include <deal.II/grid/grid_generator.h>
 #include <deal.II/grid/grid_refinement.h>
@@ -73,6 +78,7 @@
 #include <deal.II/fe/fe_values.h>
 #include <deal.II/fe/fe_dgq.h>
 #include <deal.II/fe/fe_tools.h>
+#include <deal.II/fe/mapping_q1.h>
 
 #include <deal.II/numerics/vector_tools.h>
 #include <deal.II/numerics/matrix_tools.h>
@@ -91,6 +97,7 @@
 // owned by the present process in a %parallel program:
 #include <deal.II/grid/filtered_iterator.h>
 
+#include <array>
 #include <fstream>
 #include <iostream>
 
@@ -316,32 +323,109 @@ namespace ElastoPlastic
 
   }
 
-  // @sect3{The <code>PointHistory</code> class}
+  // @sect3{The <code>QuadraturePointHistory</code> class}
 
-  // As was mentioned in the introduction, we have to store the old stress in
-  // quadrature point so that we can compute the residual forces at this point
-  // during the next time step. This alone would not warrant a structure with
-  // only one member, but in more complicated applications, we would have to
-  // store more information in quadrature points as well, such as the history
-  // variables of plasticity, etc. In essence, we have to store everything
-  // that affects the present state of the material here, which in plasticity
-  // is determined by the deformation history variables.
+  // As was mentioned in the introduction, we have to store the old stress and
+  // strain in each quadrature point so that we can compute the residual
+  // forces at this point during the next time step. In essence, we have to
+  // store everything that affects the present state of the material here,
+  // which in plasticity is determined by the deformation history variables.
   //
-  // We will not give this class any meaningful functionality beyond being
-  // able to store data, i.e. there are no constructors, destructors, or other
-  // member functions. In such cases of `dumb' classes, we usually opt to
-  // declare them as <code>struct</code> rather than <code>class</code>, to
-  // indicate that they are closer to C-style structures than C++-style
-  // classes.
+  // Rather than attaching an array of structures to each cell through its
+  // user pointer, we keep the data of all quadrature points in one object,
+  // laid out as a structure of arrays: every independent component of the
+  // stress and of the strain tensor is a contiguous array with one entry per
+  // quadrature point, and the quadrature points of the active cell with
+  // index <code>c</code> are stored at positions
+  // <code>c*n_q_points_per_cell</code> to
+  // <code>(c+1)*n_q_points_per_cell-1</code>. Loops over the quadrature
+  // points of a cell then walk through memory linearly, and consecutive
+  // quadrature points can be loaded into the lanes of a
+  // <code>VectorizedArray</code> when updating the history variables. The
+  // arrays also contain (unused) entries for cells that are not locally
+  // owned; this wastes some memory but keeps the indexing trivial.
   template <int dim>
-  struct PointHistory
+  class QuadraturePointHistory
   {
-    SymmetricTensor<2,dim> old_stress;
-    SymmetricTensor<2,dim> old_strain;
-    Point<dim> point;
+  public:
+    static constexpr unsigned int n_components
+      = SymmetricTensor<2, dim>::n_independent_components;
+
+    // Resize all arrays and set the stresses and strains to zero.
+    void reinit (const unsigned int n_cells,
+                 const unsigned int n_q_points_per_cell);
+
+    unsigned int index (const unsigned int active_cell_index,
+                        const unsigned int q_point) const;
+
+    SymmetricTensor<2, dim> get_old_stress (const unsigned int index) const;
+    SymmetricTensor<2, dim> get_old_strain (const unsigned int index) const;
+
+    // The raw components of the tensors, in the order given by
+    // SymmetricTensor::access_raw_entry(), and the location of each
+    // quadrature point in the (deformed) mesh:
+    std::array<std::vector<double>, n_components> old_stress;
+    std::array<std::vector<double>, n_components> old_strain;
+    std::vector<Point<dim> >                      point;
+
+  private:
+    unsigned int n_q_points_per_cell;
   };
 
 
+  template <int dim>
+  void
+  QuadraturePointHistory<dim>::reinit (const unsigned int n_cells,
+                                       const unsigned int n_q_points_per_cell)
+  {
+    this->n_q_points_per_cell = n_q_points_per_cell;
+    const unsigned int n_points = n_cells * n_q_points_per_cell;
+    for (unsigned int c=0; c<n_components; ++c)
+      {
+        old_stress[c].assign (n_points, 0.);
+        old_strain[c].assign (n_points, 0.);
+      }
+    point.assign (n_points, Point<dim>());
+  }
+
+
+  template <int dim>
+  inline
+  unsigned int
+  QuadraturePointHistory<dim>::index (const unsigned int active_cell_index,
+                                      const unsigned int q_point) const
+  {
+    AssertIndexRange (q_point, n_q_points_per_cell);
+    AssertIndexRange (active_cell_index * n_q_points_per_cell + q_point,
+                      point.size());
+    return active_cell_index * n_q_points_per_cell + q_point;
+  }
+
+
+  template <int dim>
+  inline
+  SymmetricTensor<2, dim>
+  QuadraturePointHistory<dim>::get_old_stress (const unsigned int index) const
+  {
+    SymmetricTensor<2, dim> stress;
+    for (unsigned int c=0; c<n_components; ++c)
+      stress.access_raw_entry(c) = old_stress[c][index];
+    return stress;
+  }
+
+
+  template <int dim>
+  inline
+  SymmetricTensor<2, dim>
+  QuadraturePointHistory<dim>::get_old_strain (const unsigned int index) const
+  {
+    SymmetricTensor<2, dim> strain;
+    for (unsigned int c=0; c<n_components; ++c)
+      strain.access_raw_entry(c) = old_strain[c][index];
+    return strain;
+  }
+
+
   // @sect3{The <code>ConstitutiveLaw</code> class template}
 
   // This class provides an interface for a constitutive law, i.e., for the
@@ -378,6 +462,10 @@ namespace ElastoPlastic
     get_stress_strain_tensor (const SymmetricTensor<2, dim> &strain_tensor,
                               SymmetricTensor<4, dim> &stress_strain_tensor) const;
 
+    template <typename Number>
+    SymmetricTensor<2, dim, Number>
+    get_stress (const SymmetricTensor<2, dim, Number> &strain_tensor) const;
+
     bool
     get_grad_stress_strain_tensor (const SymmetricTensor<2, dim> &strain_tensor,
                                    const std::vector<Tensor<2, dim> > &point_hessian,
@@ -485,6 +573,61 @@ namespace ElastoPlastic
   }
 
 
+  // @sect4{ConstitutiveLaw::get_stress}
+
+  // This function computes the same stress as applying the tensor returned
+  // by <code>get_stress_strain_tensor</code> to the strain, but without
+  // ever forming the rank-4 tensors: the stress is $\kappa\,\text{tr}
+  // (\varepsilon) I$ plus the deviatoric part $2\mu(\varepsilon -
+  // \frac 13\text{tr}(\varepsilon) I)$, where the latter is scaled back
+  // onto the yield surface if the trial stress is plastic. The function is a
+  // template so that it can be called with <code>Number=double</code> as
+  // well as with <code>Number=VectorizedArray@<double@></code>, in which
+  // case it performs the radial return for several quadrature points at once;
+  // the branch for plastic quadrature points is then replaced by a select
+  // operation on the SIMD lanes.
+  template <int dim>
+  template <typename Number>
+  SymmetricTensor<2, dim, Number>
+  ConstitutiveLaw<dim>::
+  get_stress (const SymmetricTensor<2, dim, Number> &strain_tensor) const
+  {
+    const Number trace_strain = trace(strain_tensor);
+
+    SymmetricTensor<2, dim, Number> deviatoric_stress = strain_tensor;
+    for (unsigned int d=0; d<dim; ++d)
+      deviatoric_stress[d][d] -= trace_strain / 3.;
+    deviatoric_stress *= 2. * mu;
+
+    SymmetricTensor<2, dim, Number> stress_tensor = deviatoric_stress;
+    for (unsigned int d=0; d<dim; ++d)
+      stress_tensor[d][d] += kappa * trace_strain;
+
+    // This is Evaluation::get_von_Mises_stress() written for a general
+    // number type:
+    const SymmetricTensor<2, dim, Number> deviator_stress_tensor = deviator(stress_tensor);
+    const Number von_Mises_stress
+      = std::sqrt(1.5) * std::sqrt(scalar_product(deviator_stress_tensor,
+                                                  deviator_stress_tensor));
+
+    const Number sigma_0_number (sigma_0);
+    const Number plastic_factor
+      = gamma + (1 - gamma) * sigma_0 / std::max(von_Mises_stress, sigma_0_number);
+    const Number factor
+      = compare_and_apply_mask<SIMDComparison::greater_than>(von_Mises_stress,
+                                                             sigma_0_number,
+                                                             plastic_factor,
+                                                             Number(1.));
+
+    deviatoric_stress *= factor;
+    stress_tensor = deviatoric_stress;
+    for (unsigned int d=0; d<dim; ++d)
+      stress_tensor[d][d] += kappa * trace_strain;
+
+    return stress_tensor;
+  }
+
+
   template <int dim>
   bool
   ConstitutiveLaw<dim>::
@@ -1567,6 +1710,107 @@ namespace ElastoPlastic
   }
 
 
+  // @sect3{Algebraic multigrid for the elasticity operator}
+
+  // Both the primal Newton systems and the dual problem are linearized
+  // elasticity problems. The near null space of such operators consists of
+  // the rigid body motions, i.e., the <code>dim</code> translations and the
+  // <code>dim*(dim-1)/2</code> rotations. Smoothed aggregation AMG builds
+  // much better coarse spaces if it knows all of them rather than only the
+  // translations that DoFTools::extract_constant_modes() provides. We
+  // evaluate them at the support points of the locally owned degrees of
+  // freedom and store them column by column, in the order in which the rows
+  // of the matrix are stored on this processor.
+  template <int dim>
+  void
+  compute_rigid_body_modes (const DoFHandler<dim> &dof_handler,
+                            std::vector<double>   &rigid_body_modes)
+  {
+    const unsigned int n_modes = dim * (dim + 1) / 2;
+    const IndexSet &locally_owned_dofs = dof_handler.locally_owned_dofs();
+    const unsigned int n_locally_owned_dofs = locally_owned_dofs.n_elements();
+
+    std::map<types::global_dof_index, Point<dim> > support_points;
+    DoFTools::map_dofs_to_support_points(MappingQ1<dim>(), dof_handler,
+                                         support_points);
+
+    rigid_body_modes.assign(n_modes * n_locally_owned_dofs, 0.);
+    for (unsigned int component = 0; component < dim; ++component)
+      {
+        const IndexSet component_dofs
+          = DoFTools::extract_dofs(dof_handler,
+                                   dof_handler.get_fe().component_mask(FEValuesExtractors::Scalar(component)));
+
+        for (const types::global_dof_index dof : component_dofs)
+          {
+            const unsigned int row = locally_owned_dofs.index_within_set(dof);
+            const Point<dim> &x = support_points[dof];
+
+            // The translation in direction <code>component</code>...
+            rigid_body_modes[component * n_locally_owned_dofs + row] = 1.;
+
+            // ...and the rotations, which are $(-y,x)$ in 2d and
+            // $(-y,x,0)$, $(0,-z,y)$, $(z,0,-x)$ in 3d:
+            double *rotations = &rigid_body_modes[dim * n_locally_owned_dofs + row];
+            if (dim == 2)
+              rotations[0] = (component == 0 ? -x[1] : x[0]);
+            else
+              switch (component)
+                {
+                case 0:
+                  rotations[0] = -x[1];
+                  rotations[2 * n_locally_owned_dofs] = x[2];
+                  break;
+                case 1:
+                  rotations[0] = x[0];
+                  rotations[n_locally_owned_dofs] = -x[2];
+                  break;
+                case 2:
+                  rotations[n_locally_owned_dofs] = x[1];
+                  rotations[2 * n_locally_owned_dofs] = -x[0];
+                  break;
+                }
+          }
+      }
+  }
+
+
+  // Set up an AMG preconditioner for <code>matrix</code>. We let
+  // AdditionalData fill in the usual ML parameters and then replace the near
+  // null space by the rigid body modes computed above. ML only stores a
+  // pointer to <code>rigid_body_modes</code>, so the caller has to keep the
+  // array alive as long as the preconditioner is in use.
+  template <int dim>
+  void
+  initialize_elasticity_amg (const TrilinosWrappers::SparseMatrix &matrix,
+                             const unsigned int                    fe_degree,
+                             std::vector<double>                  &rigid_body_modes,
+                             TrilinosWrappers::PreconditionAMG    &preconditioner)
+  {
+    TrilinosWrappers::PreconditionAMG::AdditionalData additional_data;
+    additional_data.elliptic = true;
+    additional_data.higher_order_elements = (fe_degree > 1);
+    additional_data.n_cycles = 1;
+    additional_data.w_cycle = false;
+    additional_data.output_details = false;
+    additional_data.smoother_sweeps = 2;
+    additional_data.aggregation_threshold = 1e-2;
+
+    Teuchos::ParameterList parameter_list;
+    std::unique_ptr<Epetra_MultiVector> distributed_constant_modes;
+    additional_data.set_parameters(parameter_list,
+                                   distributed_constant_modes,
+                                   matrix.trilinos_matrix());
+
+    parameter_list.set("PDE equations", dim);
+    parameter_list.set("null space: type", "pre-computed");
+    parameter_list.set("null space: dimension", dim * (dim + 1) / 2);
+    parameter_list.set("null space: vectors", rigid_body_modes.data());
+
+    preconditioner.initialize(matrix, parameter_list);
+  }
+
+
   namespace DualFunctional
   {
 
@@ -1576,11 +1820,12 @@ namespace ElastoPlastic
     public:
       virtual
       void
-      assemble_rhs (const DoFHandler<dim>      &dof_handler,
-                    const Vector<double>       &solution,
-                    const ConstitutiveLaw<dim> &constitutive_law,
-                    const DoFHandler<dim>      &dof_handler_dual,
-                    Vector<double>             &rhs_dual) const = 0;
+      assemble_rhs (const DoFHandler<dim>               &dof_handler,
+                    const TrilinosWrappers::MPI::Vector &solution,
+                    const ConstitutiveLaw<dim>          &constitutive_law,
+                    const DoFHandler<dim>               &dof_handler_dual,
+                    const AffineConstraints<double>     &constraints_dual,
+                    TrilinosWrappers::MPI::Vector       &rhs_dual) const = 0;
     };
 
 
@@ -1592,11 +1837,12 @@ namespace ElastoPlastic
 
       virtual
       void
-      assemble_rhs (const DoFHandler<dim>      &dof_handler,
-                    const Vector<double>       &solution,
-                    const ConstitutiveLaw<dim> &constitutive_law,
-                    const DoFHandler<dim>      &dof_handler_dual,
-                    Vector<double>             &rhs_dual) const override;
+      assemble_rhs (const DoFHandler<dim>               &dof_handler,
+                    const TrilinosWrappers::MPI::Vector &solution,
+                    const ConstitutiveLaw<dim>          &constitutive_law,
+                    const DoFHandler<dim>               &dof_handler_dual,
+                    const AffineConstraints<double>     &constraints_dual,
+                    TrilinosWrappers::MPI::Vector       &rhs_dual) const override;
 
       DeclException1 (ExcEvaluationPointNotFound,
                       Point<dim>,
@@ -1619,33 +1865,47 @@ namespace ElastoPlastic
     template <int dim>
     void
     PointValuesEvaluation<dim>::
-    assemble_rhs (const DoFHandler<dim>      &/*dof_handler*/,
-                  const Vector<double>       &/*solution*/,
-                  const ConstitutiveLaw<dim> &/*constitutive_law*/,
-                  const DoFHandler<dim>      &dof_handler_dual,
-                  Vector<double>             &rhs_dual) const
+    assemble_rhs (const DoFHandler<dim>               &/*dof_handler*/,
+                  const TrilinosWrappers::MPI::Vector &/*solution*/,
+                  const ConstitutiveLaw<dim>          &/*constitutive_law*/,
+                  const DoFHandler<dim>               &dof_handler_dual,
+                  const AffineConstraints<double>     &constraints_dual,
+                  TrilinosWrappers::MPI::Vector       &rhs_dual) const
     {
-      rhs_dual.reinit (dof_handler_dual.n_dofs());
+      rhs_dual = 0;
       const unsigned int dofs_per_vertex = dof_handler_dual.get_fe().dofs_per_vertex;
 
-      typename DoFHandler<dim>::active_cell_iterator
-      cell_dual = dof_handler_dual.begin_active(),
-      endc_dual = dof_handler_dual.end();
-      for (; cell_dual!=endc_dual; ++cell_dual)
-        for (unsigned int vertex=0;
-             vertex<GeometryInfo<dim>::vertices_per_cell;
-             ++vertex)
-          if (cell_dual->vertex(vertex).distance(evaluation_point)
-              < cell_dual->diameter()*1e-8)
-            {
-              for (unsigned int id=0; id!=dofs_per_vertex; ++id)
-                {
-                  rhs_dual(cell_dual->vertex_dof_index(vertex,id)) = 1;
-                }
-              return;
-            }
+      // The evaluation point is a vertex that may be shared by cells on
+      // several processors. Only the owner of the first degree of freedom
+      // at this vertex adds the (unit) right hand side, all others still
+      // need to take part in the compress() call below.
+      bool evaluation_point_found = false;
+      for (const auto &cell_dual : dof_handler_dual.active_cell_iterators())
+        if (cell_dual->is_locally_owned() && !evaluation_point_found)
+          for (unsigned int vertex=0;
+               vertex<GeometryInfo<dim>::vertices_per_cell;
+               ++vertex)
+            if (cell_dual->vertex(vertex).distance(evaluation_point)
+                < cell_dual->diameter()*1e-8)
+              {
+                std::vector<types::global_dof_index> vertex_dof_indices (dofs_per_vertex);
+                for (unsigned int id=0; id!=dofs_per_vertex; ++id)
+                  vertex_dof_indices[id] = cell_dual->vertex_dof_index(vertex,id);
+
+                Vector<double> vertex_rhs (dofs_per_vertex);
+                vertex_rhs = 1;
+                if (dof_handler_dual.locally_owned_dofs().is_element(vertex_dof_indices[0]))
+                  constraints_dual.distribute_local_to_global (vertex_rhs,
+                                                               vertex_dof_indices,
+                                                               rhs_dual);
+                evaluation_point_found = true;
+                break;
+              }
+      rhs_dual.compress (VectorOperation::add);
 
-      AssertThrow (false, ExcEvaluationPointNotFound(evaluation_point));
+      AssertThrow (Utilities::MPI::max (static_cast<unsigned int>(evaluation_point_found),
+                                        dof_handler_dual.get_communicator()) == 1,
+                   ExcEvaluationPointNotFound(evaluation_point));
     }
 
 
@@ -1657,11 +1917,12 @@ namespace ElastoPlastic
 
       virtual
       void
-      assemble_rhs (const DoFHandler<dim>      &dof_handler,
-                    const Vector<double>       &solution,
-                    const ConstitutiveLaw<dim> &constitutive_law,
-                    const DoFHandler<dim>      &dof_handler_dual,
-                    Vector<double>             &rhs_dual) const override;
+      assemble_rhs (const DoFHandler<dim>               &dof_handler,
+                    const TrilinosWrappers::MPI::Vector &solution,
+                    const ConstitutiveLaw<dim>          &constitutive_law,
+                    const DoFHandler<dim>               &dof_handler_dual,
+                    const AffineConstraints<double>     &constraints_dual,
+                    TrilinosWrappers::MPI::Vector       &rhs_dual) const override;
 
       DeclException1 (ExcEvaluationPointNotFound,
                       Point<dim>,
@@ -1684,13 +1945,14 @@ namespace ElastoPlastic
     template <int dim>
     void
     PointXDerivativesEvaluation<dim>::
-    assemble_rhs (const DoFHandler<dim>      &/*dof_handler*/,
-                  const Vector<double>       &/*solution*/,
-                  const ConstitutiveLaw<dim> &/*constitutive_law*/,
-                  const DoFHandler<dim>      &dof_handler_dual,
-                  Vector<double>             &rhs_dual) const
+    assemble_rhs (const DoFHandler<dim>               &/*dof_handler*/,
+                  const TrilinosWrappers::MPI::Vector &/*solution*/,
+                  const ConstitutiveLaw<dim>          &/*constitutive_law*/,
+                  const DoFHandler<dim>               &dof_handler_dual,
+                  const AffineConstraints<double>     &constraints_dual,
+                  TrilinosWrappers::MPI::Vector       &rhs_dual) const
     {
-      rhs_dual.reinit (dof_handler_dual.n_dofs());
+      rhs_dual = 0;
 
       QGauss<dim> quadrature(4);
       FEValues<dim>  fe_values (dof_handler_dual.get_fe(), quadrature,
@@ -1710,7 +1972,9 @@ namespace ElastoPlastic
       cell = dof_handler_dual.begin_active(),
       endc = dof_handler_dual.end();
       for (; cell!=endc; ++cell)
-        if (cell->center().distance(evaluation_point) <=
+        if (cell->is_locally_owned()
+            &&
+            cell->center().distance(evaluation_point) <=
             cell->diameter())
           {
             fe_values.reinit (cell);
@@ -1728,12 +1992,14 @@ namespace ElastoPlastic
               }
 
             cell->get_dof_indices (local_dof_indices);
-            for (unsigned int i=0; i<dofs_per_cell; ++i)
-              {
-                rhs_dual(local_dof_indices[i]) += cell_rhs(i);
-              }
+            constraints_dual.distribute_local_to_global (cell_rhs,
+                                                         local_dof_indices,
+                                                         rhs_dual);
           }
+      rhs_dual.compress (VectorOperation::add);
 
+      total_volume = Utilities::MPI::sum (total_volume,
+                                          dof_handler_dual.get_communicator());
       AssertThrow (total_volume > 0,
                    ExcEvaluationPointNotFound(evaluation_point));
 
@@ -1751,11 +2017,12 @@ namespace ElastoPlastic
 
       virtual
       void
-      assemble_rhs (const DoFHandler<dim>      &dof_handler,
-                    const Vector<double>       &solution,
-                    const ConstitutiveLaw<dim> &constitutive_law,
-                    const DoFHandler<dim>      &dof_handler_dual,
-                    Vector<double>             &rhs_dual) const override;
+      assemble_rhs (const DoFHandler<dim>               &dof_handler,
+                    const TrilinosWrappers::MPI::Vector &solution,
+                    const ConstitutiveLaw<dim>          &constitutive_law,
+                    const DoFHandler<dim>               &dof_handler_dual,
+                    const AffineConstraints<double>     &constraints_dual,
+                    TrilinosWrappers::MPI::Vector       &rhs_dual) const override;
 
     protected:
       const unsigned int face_id;
@@ -1779,15 +2046,16 @@ namespace ElastoPlastic
     template <int dim>
     void
     MeanDisplacementFace<dim>::
-    assemble_rhs (const DoFHandler<dim>      &/*dof_handler*/,
-                  const Vector<double>       &/*solution*/,
-                  const ConstitutiveLaw<dim> &/*constitutive_law*/,
-                  const DoFHandler<dim>      &dof_handler_dual,
-                  Vector<double>             &rhs_dual) const
+    assemble_rhs (const DoFHandler<dim>               &/*dof_handler*/,
+                  const TrilinosWrappers::MPI::Vector &/*solution*/,
+                  const ConstitutiveLaw<dim>          &/*constitutive_law*/,
+                  const DoFHandler<dim>               &dof_handler_dual,
+                  const AffineConstraints<double>     &constraints_dual,
+                  TrilinosWrappers::MPI::Vector       &rhs_dual) const
     {
       AssertThrow (dim >= 2, ExcNotImplemented());
 
-      rhs_dual.reinit (dof_handler_dual.n_dofs());
+      rhs_dual = 0;
 
       const QGauss<dim-1> face_quadrature(dof_handler_dual.get_fe().tensor_degree()+1);
       FEFaceValues<dim> fe_face_values (dof_handler_dual.get_fe(), face_quadrature,
@@ -1823,6 +2091,9 @@ namespace ElastoPlastic
       bool evaluation_face_found = false;
       for (; cell!=endc; ++cell)
         {
+          if (!cell->is_locally_owned())
+            continue;
+
           cell_rhs = 0;
           for (unsigned int face=0; face<GeometryInfo<dim>::faces_per_cell; ++face)
             {
@@ -1856,16 +2127,19 @@ namespace ElastoPlastic
             }
 
           cell->get_dof_indices (local_dof_indices);
-          for (unsigned int i=0; i<dofs_per_cell; ++i)
-            {
-              rhs_dual(local_dof_indices[i]) += cell_rhs(i);
-            }
+          constraints_dual.distribute_local_to_global (cell_rhs,
+                                                       local_dof_indices,
+                                                       rhs_dual);
 
         }
+      rhs_dual.compress (VectorOperation::add);
 
-      AssertThrow(evaluation_face_found, ExcInternalError());
+      const MPI_Comm mpi_communicator = dof_handler_dual.get_communicator();
+      AssertThrow(Utilities::MPI::max (static_cast<unsigned int>(evaluation_face_found),
+                                       mpi_communicator) == 1,
+                  ExcInternalError());
 
-      rhs_dual /= bound_size;
+      rhs_dual /= Utilities::MPI::sum (bound_size, mpi_communicator);
     }
 
 
@@ -1879,11 +2153,12 @@ namespace ElastoPlastic
 
       virtual
       void
-      assemble_rhs (const DoFHandler<dim>      &dof_handler,
-                    const Vector<double>       &solution,
-                    const ConstitutiveLaw<dim> &constitutive_law,
-                    const DoFHandler<dim>      &dof_handler_dual,
-                    Vector<double>             &rhs_dual) const override;
+      assemble_rhs (const DoFHandler<dim>               &dof_handler,
+                    const TrilinosWrappers::MPI::Vector &solution,
+                    const ConstitutiveLaw<dim>          &constitutive_law,
+                    const DoFHandler<dim>               &dof_handler_dual,
+                    const AffineConstraints<double>     &constraints_dual,
+                    TrilinosWrappers::MPI::Vector       &rhs_dual) const override;
 
     protected:
       const unsigned int face_id;
@@ -1907,15 +2182,16 @@ namespace ElastoPlastic
     template <int dim>
     void
     MeanStressFace<dim>::
-    assemble_rhs (const DoFHandler<dim>      &dof_handler,
-                  const Vector<double>       &solution,
-                  const ConstitutiveLaw<dim> &constitutive_law,
-                  const DoFHandler<dim>      &dof_handler_dual,
-                  Vector<double>             &rhs_dual) const
+    assemble_rhs (const DoFHandler<dim>               &dof_handler,
+                  const TrilinosWrappers::MPI::Vector &solution,
+                  const ConstitutiveLaw<dim>          &constitutive_law,
+                  const DoFHandler<dim>               &dof_handler_dual,
+                  const AffineConstraints<double>     &constraints_dual,
+                  TrilinosWrappers::MPI::Vector       &rhs_dual) const
     {
       AssertThrow (dim >= 2, ExcNotImplemented());
 
-      rhs_dual.reinit (dof_handler_dual.n_dofs());
+      rhs_dual = 0;
 
       const QGauss<dim-1> face_quadrature(dof_handler_dual.get_fe().tensor_degree()+1);
 
@@ -1949,6 +2225,9 @@ namespace ElastoPlastic
 
       for (; cell_dual!=endc_dual; ++cell_dual, ++cell)
         {
+          if (!cell_dual->is_locally_owned())
+            continue;
+
           cell_rhs = 0;
           for (unsigned int face=0; face<GeometryInfo<dim>::faces_per_cell; ++face)
             {
@@ -2002,16 +2281,19 @@ namespace ElastoPlastic
             }
 
           cell_dual->get_dof_indices (local_dof_indices);
-          for (unsigned int i=0; i<dofs_per_cell_dual; ++i)
-            {
-              rhs_dual(local_dof_indices[i]) += cell_rhs(i);
-            }
+          constraints_dual.distribute_local_to_global (cell_rhs,
+                                                       local_dof_indices,
+                                                       rhs_dual);
 
         }
+      rhs_dual.compress (VectorOperation::add);
 
-      AssertThrow(evaluation_face_found, ExcInternalError());
+      const MPI_Comm mpi_communicator = dof_handler_dual.get_communicator();
+      AssertThrow(Utilities::MPI::max (static_cast<unsigned int>(evaluation_face_found),
+                                       mpi_communicator) == 1,
+                  ExcInternalError());
 
-      rhs_dual /= bound_size;
+      rhs_dual /= Utilities::MPI::sum (bound_size, mpi_communicator);
 
     }
 
@@ -2025,11 +2307,12 @@ namespace ElastoPlastic
 
       virtual
       void
-      assemble_rhs (const DoFHandler<dim>      &dof_handler,
-                    const Vector<double>       &solution,
-                    const ConstitutiveLaw<dim> &constitutive_law,
-                    const DoFHandler<dim>      &dof_handler_dual,
-                    Vector<double>             &rhs_dual) const override;
+      assemble_rhs (const DoFHandler<dim>               &dof_handler,
+                    const TrilinosWrappers::MPI::Vector &solution,
+                    const ConstitutiveLaw<dim>          &constitutive_law,
+                    const DoFHandler<dim>               &dof_handler_dual,
+                    const AffineConstraints<double>     &constraints_dual,
+                    TrilinosWrappers::MPI::Vector       &rhs_dual) const override;
 
     protected:
       const std::string base_mesh;
@@ -2053,11 +2336,12 @@ namespace ElastoPlastic
     template <int dim>
     void
     MeanStressDomain<dim>::
-    assemble_rhs (const DoFHandler<dim>      &dof_handler,
-                  const Vector<double>       &solution,
-                  const ConstitutiveLaw<dim> &constitutive_law,
-                  const DoFHandler<dim>      &dof_handler_dual,
-                  Vector<double>             &rhs_dual) const
+    assemble_rhs (const DoFHandler<dim>               &dof_handler,
+                  const TrilinosWrappers::MPI::Vector &solution,
+                  const ConstitutiveLaw<dim>          &constitutive_law,
+                  const DoFHandler<dim>               &dof_handler_dual,
+                  const AffineConstraints<double>     &constraints_dual,
+                  TrilinosWrappers::MPI::Vector       &rhs_dual) const
     {
       AssertThrow (base_mesh == "Cantiliver_beam_3d", ExcNotImplemented());
       AssertThrow (dim == 3, ExcNotImplemented());
@@ -2073,7 +2357,7 @@ namespace ElastoPlastic
       const double height = 200e-3,
                    thickness_flange = 10e-3;
 
-      rhs_dual.reinit (dof_handler_dual.n_dofs());
+      rhs_dual = 0;
 
       const QGauss<dim> quadrature_formula(dof_handler_dual.get_fe().tensor_degree()+1);
 
@@ -2107,6 +2391,12 @@ namespace ElastoPlastic
 
       for (; cell_dual!=endc_dual; ++cell_dual, ++cell)
         {
+          if (!cell_dual->is_locally_owned())
+            continue;
+
+          // Cells outside of the domain of interest do not contribute:
+          cell_rhs = 0;
+
           const double y = cell->center()[1],
                        z = cell->center()[2];
           // top domain: height/2 - thickness_flange <= y <= height/2
@@ -2117,8 +2407,6 @@ namespace ElastoPlastic
                ( ((y > height/2 - thickness_flange) && (y < height/2)) ||
                  ((y > -height/2) && (y < -height/2 + thickness_flange)) ) )
             {
-              cell_rhs = 0;
-
               if (!evaluation_domain_found)
                 {
                   evaluation_domain_found = true;
@@ -2164,16 +2452,19 @@ namespace ElastoPlastic
             }
 
           cell_dual->get_dof_indices (local_dof_indices);
-          for (unsigned int i=0; i<dofs_per_cell_dual; ++i)
-            {
-              rhs_dual(local_dof_indices[i]) += cell_rhs(i);
-            }
+          constraints_dual.distribute_local_to_global (cell_rhs,
+                                                       local_dof_indices,
+                                                       rhs_dual);
 
         }
+      rhs_dual.compress (VectorOperation::add);
 
-      AssertThrow(evaluation_domain_found, ExcInternalError());
+      const MPI_Comm mpi_communicator = dof_handler_dual.get_communicator();
+      AssertThrow(Utilities::MPI::max (static_cast<unsigned int>(evaluation_domain_found),
+                                       mpi_communicator) == 1,
+                  ExcInternalError());
 
-      rhs_dual /= domain_size;
+      rhs_dual /= Utilities::MPI::sum (domain_size, mpi_communicator);
 
     }
 
@@ -2366,13 +2657,21 @@ namespace ElastoPlastic
 
 
   // DualSolver class
+
+  // The dual problem lives on the same (distributed) triangulation as the
+  // primal one, but uses elements of one degree higher. Like the primal
+  // problem, it is stored in Trilinos objects distributed over all
+  // processors and solved iteratively with an AMG preconditioner built from
+  // the rigid body modes of the dual finite element space; each processor
+  // only assembles the matrix on and estimates the error for its locally
+  // owned cells.
   template <int dim>
   class DualSolver
   {
   public:
     DualSolver (const Triangulation<dim>                        &triangulation,
-                const FESystem<dim>                             &fe,
-                const Vector<double>                            &solution,
+                const DoFHandler<dim>                           &dof_handler,
+                const TrilinosWrappers::MPI::Vector             &solution,
                 const ConstitutiveLaw<dim>                      &constitutive_law,
                 const DualFunctional::DualFunctionalBase<dim>   &dual_functional,
                 const unsigned int                              &timestep_no,
@@ -2393,9 +2692,15 @@ namespace ElastoPlastic
     void solve ();
     void output_results ();
 
-    const FESystem<dim>       &fe;
-    DoFHandler<dim>            dof_handler;
-    const Vector<double>       solution;
+    MPI_Comm                   mpi_communicator;
+    ConditionalOStream         pcout;
+
+    const DoFHandler<dim>     &dof_handler;
+    const FiniteElement<dim>  &fe;
+
+    // The primal solution, with ghost entries on all locally relevant
+    // degrees of freedom:
+    const TrilinosWrappers::MPI::Vector solution;
 
     const unsigned int         fe_degree;
 
@@ -2404,16 +2709,21 @@ namespace ElastoPlastic
     FESystem<dim>              fe_dual;
     DoFHandler<dim>            dof_handler_dual;
 
+    IndexSet                   locally_owned_dofs_dual;
+    IndexSet                   locally_relevant_dofs_dual;
+
     const QGauss<dim>          quadrature_formula;
     const QGauss<dim - 1>      face_quadrature_formula;
 
     AffineConstraints<double>  constraints_hanging_nodes_dual;
     AffineConstraints<double>  constraints_dirichlet_and_hanging_nodes_dual;
 
-    SparsityPattern            sparsity_pattern_dual;
-    SparseMatrix<double>       system_matrix_dual;
-    Vector<double>             system_rhs_dual;
-    Vector<double>             solution_dual;
+    TrilinosWrappers::SparseMatrix    system_matrix_dual;
+    TrilinosWrappers::MPI::Vector     system_rhs_dual;
+    TrilinosWrappers::MPI::Vector     solution_dual;
+
+    TrilinosWrappers::PreconditionAMG preconditioner_dual;
+    std::vector<double>               rigid_body_modes_dual;
 
     const ConstitutiveLaw<dim> constitutive_law;
 
@@ -2431,8 +2741,8 @@ namespace ElastoPlastic
   template<int dim>
   DualSolver<dim>::
   DualSolver (const Triangulation<dim>                        &triangulation,
-              const FESystem<dim>                             &fe,
-              const Vector<double>                            &solution,
+              const DoFHandler<dim>                           &dof_handler,
+              const TrilinosWrappers::MPI::Vector             &solution,
               const ConstitutiveLaw<dim>                      &constitutive_law,
               const DualFunctional::DualFunctionalBase<dim>   &dual_functional,
               const unsigned int                              &timestep_no,
@@ -2441,8 +2751,10 @@ namespace ElastoPlastic
               const double                                    &present_time,
               const double                                    &end_time)
     :
-    fe (fe),
-    dof_handler (triangulation),
+    mpi_communicator (triangulation.get_communicator()),
+    pcout (std::cout, Utilities::MPI::this_mpi_process(mpi_communicator) == 0),
+    dof_handler (dof_handler),
+    fe (dof_handler.get_fe()),
     solution(solution),
     fe_degree(fe.tensor_degree()),
     fe_degree_dual(fe_degree + 1),
@@ -2464,48 +2776,54 @@ namespace ElastoPlastic
   template<int dim>
   DualSolver<dim>::~DualSolver()
   {
+    preconditioner_dual.clear ();
     dof_handler_dual.clear ();
   }
 
 
+  // The setup mirrors ElastoPlasticProblem::setup_system(): the constraints
+  // are stored for the locally relevant degrees of freedom and the sparsity
+  // pattern only contains the rows this processor owns.
   template<int dim>
   void DualSolver<dim>::setup_system()
   {
-    dof_handler.distribute_dofs(fe);
-
     dof_handler_dual.distribute_dofs (fe_dual);
-    std::cout << "    Number of degrees of freedom in dual problem:  "
-              << dof_handler_dual.n_dofs()
-              << std::endl;
+    pcout << "    Number of degrees of freedom in dual problem:  "
+          << dof_handler_dual.n_dofs()
+          << std::endl;
+
+    locally_owned_dofs_dual = dof_handler_dual.locally_owned_dofs();
+    locally_relevant_dofs_dual.clear();
+    DoFTools::extract_locally_relevant_dofs (dof_handler_dual,
+                                             locally_relevant_dofs_dual);
 
     constraints_hanging_nodes_dual.clear ();
+    constraints_hanging_nodes_dual.reinit (locally_relevant_dofs_dual);
     DoFTools::make_hanging_node_constraints (dof_handler_dual,
                                              constraints_hanging_nodes_dual);
     constraints_hanging_nodes_dual.close ();
 
     compute_dirichlet_constraints();
 
-    sparsity_pattern_dual.reinit (dof_handler_dual.n_dofs(),
-                                  dof_handler_dual.n_dofs(),
-                                  dof_handler_dual.max_couplings_between_dofs());
-    DoFTools::make_sparsity_pattern (dof_handler_dual, sparsity_pattern_dual);
-
-//    constraints_hanging_nodes_dual.condense (sparsity_pattern_dual);
-    constraints_dirichlet_and_hanging_nodes_dual.condense (sparsity_pattern_dual);
-
+    TrilinosWrappers::SparsityPattern sparsity_pattern_dual (locally_owned_dofs_dual,
+                                                             mpi_communicator);
+    DoFTools::make_sparsity_pattern (dof_handler_dual, sparsity_pattern_dual,
+                                     constraints_dirichlet_and_hanging_nodes_dual, false,
+                                     Utilities::MPI::this_mpi_process(mpi_communicator));
     sparsity_pattern_dual.compress();
 
     system_matrix_dual.reinit (sparsity_pattern_dual);
 
-    solution_dual.reinit (dof_handler_dual.n_dofs());
-    system_rhs_dual.reinit (dof_handler_dual.n_dofs());
+    solution_dual.reinit (locally_owned_dofs_dual, locally_relevant_dofs_dual,
+                          mpi_communicator);
+    system_rhs_dual.reinit (locally_owned_dofs_dual, mpi_communicator);
 
   }
 
   template<int dim>
   void DualSolver<dim>::compute_dirichlet_constraints()
   {
-    constraints_dirichlet_and_hanging_nodes_dual.clear ();
+    constraints_dirichlet_and_hanging_nodes_dual.reinit (locally_relevant_dofs_dual);
     constraints_dirichlet_and_hanging_nodes_dual.merge(constraints_hanging_nodes_dual);
 
     std::vector<bool> component_mask(dim);
@@ -2652,6 +2970,7 @@ namespace ElastoPlastic
 
         }
 
+    system_matrix_dual.compress(VectorOperation::add);
   }
 
 
@@ -2659,54 +2978,46 @@ namespace ElastoPlastic
   void DualSolver<dim>::assemble_rhs()
   {
     dual_functional->assemble_rhs (dof_handler, solution, constitutive_law,
-                                   dof_handler_dual, system_rhs_dual);
-    constraints_dirichlet_and_hanging_nodes_dual.condense (system_rhs_dual);
+                                   dof_handler_dual,
+                                   constraints_dirichlet_and_hanging_nodes_dual,
+                                   system_rhs_dual);
   }
 
 
+  // The dual matrix is the linearized elastoplastic tangent at the converged
+  // primal solution, discretized with elements of one degree higher. It is
+  // symmetric but, for small hardening parameters, badly conditioned, which
+  // is why CG and BiCGStab with point preconditioners were not able to solve
+  // it. AMG with the rigid body modes of the dual space handles it well, and
+  // we use GMRES as the outer iteration to be on the safe side.
   template<int dim>
   void DualSolver<dim>::solve()
   {
-    // +++  direct solver +++++++++
-    SparseDirectUMFPACK   A_direct;
-    A_direct.initialize(system_matrix_dual);
-
-    // After the decomposition, we can use A_direct like a matrix representing
-    // the inverse of our system matrix, so to compute the solution we just
-    // have to multiply with the right hand side vector:
-    A_direct.vmult(solution_dual, system_rhs_dual);
-
-    // ++++  iterative solver ++ CG ++++ doesn't work
-//    SolverControl solver_control (5000, 1e-12);
-//    SolverCG<> cg (solver_control);
-//
-//    PreconditionSSOR<> preconditioner;
-//    preconditioner.initialize(system_matrix_dual, 1.2);
-//
-//    cg.solve (system_matrix_dual, solution_dual, system_rhs_dual,
-//              preconditioner);
-
-    // ++++  iterative solver ++ BiCGStab ++++++ doesn't work
-//    SolverControl solver_control (5000, 1e-12);
-//    SolverBicgstab<> bicgstab (solver_control);
-//
-//    PreconditionJacobi<> preconditioner;
-//    preconditioner.initialize(system_matrix_dual, 1.0);
-//
-//    bicgstab.solve (system_matrix_dual, solution_dual, system_rhs_dual,
-//                    preconditioner);
-
-    // +++++++++++++++++++++++++++++++++++++++++++++++++
-
-    constraints_dirichlet_and_hanging_nodes_dual.distribute (solution_dual);
+    compute_rigid_body_modes (dof_handler_dual, rigid_body_modes_dual);
+    initialize_elasticity_amg<dim> (system_matrix_dual, fe_degree_dual,
+                                    rigid_body_modes_dual, preconditioner_dual);
+
+    TrilinosWrappers::MPI::Vector distributed_solution_dual (locally_owned_dofs_dual,
+                                                             mpi_communicator);
+
+    SolverControl solver_control (system_matrix_dual.m(),
+                                  1e-10 * system_rhs_dual.l2_norm());
+    SolverGMRES<TrilinosWrappers::MPI::Vector>
+    solver (solver_control,
+            SolverGMRES<TrilinosWrappers::MPI::Vector>::AdditionalData(100));
+    solver.solve (system_matrix_dual, distributed_solution_dual, system_rhs_dual,
+                  preconditioner_dual);
+
+    pcout << "    Dual problem: " << solver_control.last_step()
+          << " GMRES iterations." << std::endl;
+
+    constraints_dirichlet_and_hanging_nodes_dual.distribute (distributed_solution_dual);
+    solution_dual = distributed_solution_dual;
   }
 
   template<int dim>
   void DualSolver<dim>::output_results()
   {
-    std::string filename = (output_dir + "dual-solution-" +
-                            Utilities::int_to_string(timestep_no, 4) + ".vtk");
-    std::ofstream output (filename.c_str());
     DataOut<dim> data_out;
     data_out.attach_dof_handler (dof_handler_dual);
     std::vector<std::string> solution_names;
@@ -2729,14 +3040,15 @@ namespace ElastoPlastic
       }
     data_out.add_data_vector (solution_dual, solution_names);
     data_out.build_patches ();
-    data_out.write_vtk (output);
+    data_out.write_vtu_with_pvtu_record (output_dir, "dual-solution",
+                                         timestep_no, mpi_communicator, 4);
   }
 
   template<int dim>
   void DualSolver<dim>::compute_error_DWR (Vector<float> &estimated_error_per_cell)
   {
-    Assert (estimated_error_per_cell.size() == triangulation->n_global_active_cells(),
-            ExcDimensionMismatch (estimated_error_per_cell.size(), triangulation->n_global_active_cells()));
+    Assert (estimated_error_per_cell.size() == triangulation->n_active_cells(),
+            ExcDimensionMismatch (estimated_error_per_cell.size(), triangulation->n_active_cells()));
 
     // solve the dual problem
     setup_system ();
@@ -2745,25 +3057,44 @@ namespace ElastoPlastic
     solve ();
     output_results ();
 
-    // compuate the dual weights
-    Vector<double> primal_solution (dof_handler_dual.n_dofs());
-    FETools::interpolate (dof_handler,
-                          solution,
-                          dof_handler_dual,
-                          constraints_dirichlet_and_hanging_nodes_dual,
-                          primal_solution);
+    // compuate the dual weights; the residuals below are evaluated on the
+    // locally owned cells and their neighbors, so both vectors need ghost
+    // entries for all locally relevant degrees of freedom
+    TrilinosWrappers::MPI::Vector primal_solution (locally_owned_dofs_dual,
+                                                   locally_relevant_dofs_dual,
+                                                   mpi_communicator);
+    {
+      TrilinosWrappers::MPI::Vector distributed_primal_solution (locally_owned_dofs_dual,
+                                                                 mpi_communicator);
+      FETools::interpolate (dof_handler,
+                            solution,
+                            dof_handler_dual,
+                            constraints_dirichlet_and_hanging_nodes_dual,
+                            distributed_primal_solution);
+      primal_solution = distributed_primal_solution;
+    }
 
+    IndexSet locally_relevant_dofs;
+    DoFTools::extract_locally_relevant_dofs (dof_handler, locally_relevant_dofs);
     AffineConstraints<double> constraints_hanging_nodes;
+    constraints_hanging_nodes.reinit (locally_relevant_dofs);
     DoFTools::make_hanging_node_constraints (dof_handler,
                                              constraints_hanging_nodes);
     constraints_hanging_nodes.close();
-    Vector<double> dual_weights (dof_handler_dual.n_dofs());
-    FETools::interpolation_difference (dof_handler_dual,
-                                       constraints_dirichlet_and_hanging_nodes_dual,
-                                       solution_dual,
-                                       dof_handler,
-                                       constraints_hanging_nodes,
-                                       dual_weights);
+    TrilinosWrappers::MPI::Vector dual_weights (locally_owned_dofs_dual,
+                                                locally_relevant_dofs_dual,
+                                                mpi_communicator);
+    {
+      TrilinosWrappers::MPI::Vector distributed_dual_weights (locally_owned_dofs_dual,
+                                                              mpi_communicator);
+      FETools::interpolation_difference (dof_handler_dual,
+                                         constraints_dirichlet_and_hanging_nodes_dual,
+                                         solution_dual,
+                                         dof_handler,
+                                         constraints_hanging_nodes,
+                                         distributed_dual_weights);
+      dual_weights = distributed_dual_weights;
+    }
 
     // estimate the error
     FEValues<dim> fe_values(fe_dual, quadrature_formula,
@@ -2802,7 +3133,9 @@ namespace ElastoPlastic
                                               update_JxW_values |
                                               update_normal_vectors);
     FESubfaceValues<dim> fe_subface_values_cell (fe_dual, face_quadrature_formula,
-                                                 update_gradients);
+                                                 update_gradients),
+                                                 fe_subface_values_neighbor (fe_dual, face_quadrature_formula,
+                                                     update_gradients);
 
     const unsigned int n_face_q_points = face_quadrature_formula.size();
     std::vector<Vector<double> > jump_residual (n_face_q_points, Vector<double>(dim));
@@ -2823,6 +3156,82 @@ namespace ElastoPlastic
     SymmetricTensor<4, dim> cell_stress_strain_tensor;
     SymmetricTensor<4, dim> neighbor_stress_strain_tensor;
 
+    // The jump of the normal stress over a face, weighted with the dual
+    // weights. <code>fine_face_values</code> belongs to the cell on the finer
+    // (or equally fine) side of the face and provides the normal vector, the
+    // quadrature weights, and the dual weights, while
+    // <code>coarse_face_values</code> is either a face or a subface of the
+    // cell on the other side. The regular and the irregular faces only
+    // differ in which of the two objects is used for which side.
+    const auto integrate_face_jump
+      = [&] (const FEFaceValuesBase<dim> &fine_face_values,
+             const FEFaceValuesBase<dim> &coarse_face_values)
+    {
+      fine_face_values.get_function_gradients (primal_solution,
+                                               cell_grads);
+      coarse_face_values.get_function_gradients (primal_solution,
+                                                 neighbor_grads);
+
+      for (unsigned int q_point=0; q_point<n_face_q_points; ++q_point)
+        {
+          q_cell_strain_tensor = 0.;
+          q_neighbor_strain_tensor = 0.;
+          for (unsigned int i=0; i!=dim; ++i)
+            {
+              for (unsigned int j=0; j!=dim; ++j)
+                {
+                  q_cell_strain_tensor[i][j] = 0.5*(cell_grads[q_point][i][j] +
+                                                    cell_grads[q_point][j][i] );
+                  q_neighbor_strain_tensor[i][j] = 0.5*(neighbor_grads[q_point][i][j] +
+                                                        neighbor_grads[q_point][j][i] );
+                }
+            }
+
+          constitutive_law.get_stress_strain_tensor (q_cell_strain_tensor,
+                                                     cell_stress_strain_tensor);
+          constitutive_law.get_stress_strain_tensor (q_neighbor_strain_tensor,
+                                                     neighbor_stress_strain_tensor);
+
+          jump_residual[q_point] = 0.;
+          for (unsigned int i=0; i!=dim; ++i)
+            {
+              for (unsigned int j=0; j!=dim; ++j)
+                {
+                  for (unsigned int k=0; k!=dim; ++k)
+                    {
+                      for (unsigned int l=0; l!=dim; ++l)
+                        {
+                          jump_residual[q_point](i) += (cell_stress_strain_tensor[i][j][k][l]*
+                                                        q_cell_strain_tensor[k][l]
+                                                        -
+                                                        neighbor_stress_strain_tensor[i][j][k][l]*
+                                                        q_neighbor_strain_tensor[k][l] )*
+                                                       fine_face_values.normal_vector(q_point)[j];
+                        }
+                    }
+                }
+            }
+
+        }
+
+      fine_face_values.get_function_values (dual_weights,
+                                            dual_weights_face_values);
+
+      Vector<double> face_integral_vector(dim);
+      face_integral_vector = 0;
+      for (unsigned int q_point=0; q_point<n_face_q_points; ++q_point)
+        {
+          for (unsigned int i=0; i!=dim; ++i)
+            {
+              face_integral_vector(i) += jump_residual[q_point](i) *
+                                         dual_weights_face_values[q_point](i) *
+                                         fine_face_values.JxW(q_point);
+            }
+        }
+
+      return face_integral_vector;
+    };
+
 
     typename std::map<typename DoFHandler<dim>::face_iterator, Vector<double> >
     face_integrals;
@@ -2901,6 +3310,12 @@ namespace ElastoPlastic
             }
           // -------------------------------------------------------
           // compute face_integrals
+          //
+          // Faces between two locally owned cells are only treated once,
+          // from the side of the finer cell or, for cells of the same
+          // level, from the cell with the smaller index. Faces to ghost
+          // cells are integrated here in any case since the other side
+          // is handled by a different processor.
           for (unsigned int face_no=0;
                face_no<GeometryInfo<dim>::faces_per_cell;
                ++face_no)
@@ -2914,22 +3329,42 @@ namespace ElastoPlastic
                   continue;
                 }
 
+              const bool neighbor_is_locally_owned
+                = (cell->neighbor(face_no)->has_children() == false) &&
+                  cell->neighbor(face_no)->is_locally_owned();
+
               if ((cell->neighbor(face_no)->has_children() == false) &&
                   (cell->neighbor(face_no)->level() == cell->level()) &&
-                  (cell->neighbor(face_no)->index() < cell->index()))
+                  (cell->neighbor(face_no)->index() < cell->index()) &&
+                  neighbor_is_locally_owned)
                 continue;
 
-              if (cell->at_boundary(face_no) == false)
-                if (cell->neighbor(face_no)->level() < cell->level())
+              if (cell->neighbor(face_no)->level() < cell->level())
+                {
+                  if (neighbor_is_locally_owned)
+                    continue;
+
+                  // ------------- integrate_over_face_to_coarse_ghost -----
+                  // The coarser neighbor belongs to another processor, so we
+                  // integrate over our part of its face from this side:
+                  const std::pair<unsigned int, unsigned int> neighbor_face_subface
+                    = cell->neighbor_of_coarser_neighbor (face_no);
+                  fe_face_values_cell.reinit (cell, face_no);
+                  fe_subface_values_neighbor.reinit (cell->neighbor(face_no),
+                                                     neighbor_face_subface.first,
+                                                     neighbor_face_subface.second);
+
+                  face_integrals[cell->face(face_no)]
+                    = integrate_face_jump (fe_face_values_cell,
+                                           fe_subface_values_neighbor);
                   continue;
+                }
 
 
               if (cell->face(face_no)->has_children() == false)
                 {
                   // ------------- integrate_over_regular_face -----------
                   fe_face_values_cell.reinit(cell, face_no);
-                  fe_face_values_cell.get_function_gradients (primal_solution,
-                                                              cell_grads);
 
                   Assert (cell->neighbor(face_no).state() == IteratorState::valid,
                           ExcInternalError());
@@ -2939,65 +3374,10 @@ namespace ElastoPlastic
                   neighbor = cell->neighbor(face_no);
 
                   fe_face_values_neighbor.reinit(neighbor, neighbor_neighbor);
-                  fe_face_values_neighbor.get_function_gradients (primal_solution,
-                                                                  neighbor_grads);
 
-                  for (unsigned int q_point=0; q_point<n_face_q_points; ++q_point)
-                    {
-                      q_cell_strain_tensor = 0.;
-                      q_neighbor_strain_tensor = 0.;
-                      for (unsigned int i=0; i!=dim; ++i)
-                        {
-                          for (unsigned int j=0; j!=dim; ++j)
-                            {
-                              q_cell_strain_tensor[i][j] = 0.5*(cell_grads[q_point][i][j] +
-                                                                cell_grads[q_point][j][i] );
-                              q_neighbor_strain_tensor[i][j] = 0.5*(neighbor_grads[q_point][i][j] +
-                                                                    neighbor_grads[q_point][j][i] );
-                            }
-                        }
-
-                      constitutive_law.get_stress_strain_tensor (q_cell_strain_tensor,
-                                                                 cell_stress_strain_tensor);
-                      constitutive_law.get_stress_strain_tensor (q_neighbor_strain_tensor,
-                                                                 neighbor_stress_strain_tensor);
-
-                      jump_residual[q_point] = 0.;
-                      for (unsigned int i=0; i!=dim; ++i)
-                        {
-                          for (unsigned int j=0; j!=dim; ++j)
-                            {
-                              for (unsigned int k=0; k!=dim; ++k)
-                                {
-                                  for (unsigned int l=0; l!=dim; ++l)
-                                    {
-                                      jump_residual[q_point](i) += (cell_stress_strain_tensor[i][j][k][l]*
-                                                                    q_cell_strain_tensor[k][l]
-                                                                    -
-                                                                    neighbor_stress_strain_tensor[i][j][k][l]*
-                                                                    q_neighbor_strain_tensor[k][l] )*
-                                                                   fe_face_values_cell.normal_vector(q_point)[j];
-                                    }
-                                }
-                            }
-                        }
-
-                    }
-
-                  fe_face_values_cell.get_function_values (dual_weights,
-                                                           dual_weights_face_values);
-
-                  Vector<double> face_integral_vector(dim);
-                  face_integral_vector = 0;
-                  for (unsigned int q_point=0; q_point<n_face_q_points; ++q_point)
-                    {
-                      for (unsigned int i=0; i!=dim; ++i)
-                        {
-                          face_integral_vector(i) += jump_residual[q_point](i) *
-                                                     dual_weights_face_values[q_point](i) *
-                                                     fe_face_values_cell.JxW(q_point);
-                        }
-                    }
+                  const Vector<double> face_integral_vector
+                    = integrate_face_jump (fe_face_values_cell,
+                                           fe_face_values_neighbor);
 
                   Assert (face_integrals.find (cell->face(face_no)) != face_integrals.end(),
                           ExcInternalError());
@@ -3037,75 +3417,12 @@ namespace ElastoPlastic
                               ExcInternalError());
 
                       fe_subface_values_cell.reinit (cell, face_no, subface_no);
-                      fe_subface_values_cell.get_function_gradients (primal_solution,
-                                                                     cell_grads);
                       fe_face_values_neighbor.reinit (neighbor_child,
                                                       neighbor_neighbor);
-                      fe_face_values_neighbor.get_function_gradients (primal_solution,
-                                                                      neighbor_grads);
-
-                      for (unsigned int q_point=0; q_point<n_face_q_points; ++q_point)
-                        {
-                          q_cell_strain_tensor = 0.;
-                          q_neighbor_strain_tensor = 0.;
-                          for (unsigned int i=0; i!=dim; ++i)
-                            {
-                              for (unsigned int j=0; j!=dim; ++j)
-                                {
-                                  q_cell_strain_tensor[i][j] = 0.5*(cell_grads[q_point][i][j] +
-                                                                    cell_grads[q_point][j][i] );
-                                  q_neighbor_strain_tensor[i][j] = 0.5*(neighbor_grads[q_point][i][j] +
-                                                                        neighbor_grads[q_point][j][i] );
-                                }
-                            }
-
-                          constitutive_law.get_stress_strain_tensor (q_cell_strain_tensor,
-                                                                     cell_stress_strain_tensor);
-                          constitutive_law.get_stress_strain_tensor (q_neighbor_strain_tensor,
-                                                                     neighbor_stress_strain_tensor);
-
-                          jump_residual[q_point] = 0.;
-                          for (unsigned int i=0; i!=dim; ++i)
-                            {
-                              for (unsigned int j=0; j!=dim; ++j)
-                                {
-                                  for (unsigned int k=0; k!=dim; ++k)
-                                    {
-                                      for (unsigned int l=0; l!=dim; ++l)
-                                        {
-                                          jump_residual[q_point](i) += (-cell_stress_strain_tensor[i][j][k][l]*
-                                                                        q_cell_strain_tensor[k][l]
-                                                                        +
-                                                                        neighbor_stress_strain_tensor[i][j][k][l]*
-                                                                        q_neighbor_strain_tensor[k][l] )*
-                                                                       fe_face_values_neighbor.normal_vector(q_point)[j];
-                                        }
-                                    }
-                                }
-                            }
-
-                        }
-
-                      fe_face_values_neighbor.get_function_values (dual_weights,
-                                                                   dual_weights_face_values);
-
-                      Vector<double> face_integral_vector(dim);
-                      face_integral_vector = 0;
-                      for (unsigned int q_point=0; q_point<n_face_q_points; ++q_point)
-                        {
-                          for (unsigned int i=0; i!=dim; ++i)
-                            {
-                              face_integral_vector(i) += jump_residual[q_point](i) *
-                                                         dual_weights_face_values[q_point](i) *
-                                                         fe_face_values_neighbor.JxW(q_point);
-                            }
-                        }
-
-                      for (unsigned int i=0; i!=dim; ++i)
-                        {
-                          face_integrals[neighbor_child->face(neighbor_neighbor)](i) = face_integral_vector(i);
-                        }
 
+                      face_integrals[neighbor_child->face(neighbor_neighbor)]
+                        = integrate_face_jump (fe_face_values_neighbor,
+                                               fe_subface_values_cell);
                     }
 
                   Vector<double> sum (dim);
@@ -3209,12 +3526,14 @@ namespace ElastoPlastic
                                  const TrilinosWrappers::MPI::Vector &delta_linearization_point);
     void compute_nonlinear_residual (const TrilinosWrappers::MPI::Vector &linearization_point);
     void solve_newton_system ();
+    void setup_amg_preconditioner ();
     void solve_newton ();
     void compute_error ();
     void compute_error_residual (const TrilinosWrappers::MPI::Vector &tmp_solution);
     void refine_grid ();
     void move_mesh (const TrilinosWrappers::MPI::Vector &displacement) const;
     void output_results (const std::string &filename_base);
+    void write_benchmark_data (std::ofstream &output);
 
     // Next are three functions that handle the history variables stored in each
     // quadrature point. The first one is called before the first timestep to
@@ -3237,6 +3556,7 @@ namespace ElastoPlastic
     const unsigned int this_mpi_process;
     ConditionalOStream pcout;
     TimerOutput        computing_timer;
+    unsigned int       n_solver_iterations;
 
     // The next group describes the mesh and the finite element space.
     // In particular, for this parallel program, the finite element
@@ -3254,8 +3574,9 @@ namespace ElastoPlastic
     // of freedom constrained by the contact, and we use
     // <code>fraction_of_plastic_q_points_per_cell</code> to keep
     // track of the fraction of quadrature points on each cell where
-    // the stress equals the yield stress. The latter is only used to
-    // create graphical output showing the plastic zone, but not for
+    // the stress equals the yield stress. The latter is used to
+    // create graphical output showing the plastic zone and to decide
+    // whether the AMG preconditioner has to be rebuilt, but not for
     // any further computation; the variable is a member variable of
     // this class since the information is computed as a by-product
     // of computing the residual, but is used only much later. (Note
@@ -3289,19 +3610,11 @@ namespace ElastoPlastic
     const QGauss<dim>          quadrature_formula;
     const QGauss<dim - 1>      face_quadrature_formula;
 
-    // ... and then also have a vector of history objects, one per quadrature
-    // point on those cells for which we are responsible (i.e. we don't store
-    // history data for quadrature points on cells that are owned by other
-    // processors).
-    std::vector<PointHistory<dim> > quadrature_point_history;
-
-    // The way this object is accessed is through a <code>user pointer</code>
-    // that each cell, face, or edge holds: it is a <code>void*</code> pointer
-    // that can be used by application programs to associate arbitrary data to
-    // cells, faces, or edges. What the program actually does with this data
-    // is within its own responsibility, the library just allocates some space
-    // for these pointers, and application programs can set and read the
-    // pointers for each of these objects.
+    // ... and then also have the history data of all quadrature points. It
+    // is indexed by the active cell index and the number of the quadrature
+    // point within the cell, see the QuadraturePointHistory class; only the
+    // entries of cells for which we are responsible are ever used.
+    QuadraturePointHistory<dim> quadrature_point_history;
 
 
     // The next block of variables corresponds to the solution
@@ -3316,6 +3629,32 @@ namespace ElastoPlastic
     // accompanying paper.
     TrilinosWrappers::SparseMatrix    newton_matrix;
 
+    // The Newton systems are either preconditioned by SSOR or by an
+    // algebraic multigrid method. Setting up the latter is expensive, so
+    // the AMG hierarchy is kept around and only rebuilt if the mesh has
+    // changed or if the number of plastic quadrature points has changed
+    // by more than <code>amg_rebuild_threshold</code> times the total
+    // number of quadrature points since the last setup. The AMG
+    // aggregation is based on the rigid body modes of the current mesh,
+    // which are stored in <code>rigid_body_modes</code> (one column of
+    // length equal to the number of locally owned degrees of freedom per
+    // mode) since the ML parameter list only stores a pointer to them.
+    struct PreconditionerType
+    {
+      enum value
+      {
+        ssor,
+        amg
+      };
+    };
+    typename PreconditionerType::value preconditioner_type;
+    const double                       amg_rebuild_threshold;
+
+    TrilinosWrappers::PreconditionAMG amg_preconditioner;
+    std::vector<double>               rigid_body_modes;
+    bool                              amg_preconditioner_is_outdated;
+    unsigned int                      n_plastic_q_points_at_amg_setup;
+
     TrilinosWrappers::MPI::Vector     solution;
     TrilinosWrappers::MPI::Vector     incremental_displacement;
     TrilinosWrappers::MPI::Vector     newton_rhs;
@@ -3454,6 +3793,17 @@ namespace ElastoPlastic
     prm.declare_entry("show stresses", "false",
                       Patterns::Bool(),
                       "Whether illustrates the stresses and von Mises stresses or not.");
+    prm.declare_entry("linear solver preconditioner", "ssor",
+                      Patterns::Selection("ssor|amg"),
+                      "Preconditioner for the CG solver of the Newton systems:\n"
+                      " ssor: symmetric successive over-relaxation\n"
+                      " amg: algebraic multigrid based on the rigid body modes.");
+    prm.declare_entry("AMG rebuild threshold", "0.01",
+                      Patterns::Double(0.),
+                      "Change in the number of plastic quadrature points, relative "
+                      "to the total number of quadrature points, after which the "
+                      "AMG preconditioner is set up again. Zero rebuilds it in "
+                      "every Newton iteration.");
 
 
   }
@@ -3476,6 +3826,7 @@ namespace ElastoPlastic
     pcout(std::cout, this_mpi_process == 0),
     computing_timer(MPI_COMM_WORLD, pcout, TimerOutput::never,
                     TimerOutput::wall_times),
+    n_solver_iterations (0),
 
     n_initial_global_refinements (prm.get_integer("number of initial refinements")),
     triangulation(mpi_communicator),
@@ -3484,6 +3835,9 @@ namespace ElastoPlastic
     dof_handler(triangulation),
     quadrature_formula (fe_degree + 1),
     face_quadrature_formula (fe_degree + 1),
+    amg_rebuild_threshold (prm.get_double("AMG rebuild threshold")),
+    amg_preconditioner_is_outdated (true),
+    n_plastic_q_points_at_amg_setup (0),
 
     e_modulus (prm.get_double("elasticity modulus")),
     nu (prm.get_double("Poissons ratio")),
@@ -3521,6 +3875,14 @@ namespace ElastoPlastic
     else
       AssertThrow(false, ExcNotImplemented());
 
+    strat = prm.get("linear solver preconditioner");
+    if (strat == "ssor")
+      preconditioner_type = PreconditionerType::ssor;
+    else if (strat == "amg")
+      preconditioner_type = PreconditionerType::amg;
+    else
+      AssertThrow(false, ExcNotImplemented());
+
     output_dir = prm.get("output directory");
     if (output_dir != "" && *(output_dir.rbegin()) != '/')
       output_dir += "/";
@@ -3530,6 +3892,9 @@ namespace ElastoPlastic
     pcout << "    FE degree " << fe_degree << std::endl;
     pcout << "    transfer solution "
           << (transfer_solution ? "true" : "false") << std::endl;
+    pcout << "    preconditioner "
+          << (preconditioner_type == PreconditionerType::amg ? "AMG" : "SSOR")
+          << std::endl;
   }
 
 
@@ -4117,6 +4482,10 @@ namespace ElastoPlastic
       sp.compress();
       newton_matrix.reinit(sp);
     }
+
+    // The AMG hierarchy and the rigid body modes refer to the old mesh:
+    amg_preconditioner.clear();
+    amg_preconditioner_is_outdated = true;
   }
 
 
@@ -4306,19 +4675,12 @@ namespace ElastoPlastic
 
           // For assembling the local right hand side contributions, we need
           // to access the prior linearized stress value in this quadrature
-          // point. To get it, we use the user pointer of this cell that
-          // points into the global array to the quadrature point data
-          // corresponding to the first quadrature point of the present cell,
-          // and then add an offset corresponding to the index of the
-          // quadrature point we presently consider:
-          const PointHistory<dim> *local_quadrature_points_history
-            = reinterpret_cast<PointHistory<dim>*>(cell->user_pointer());
-          Assert (local_quadrature_points_history >=
-                  &quadrature_point_history.front(),
-                  ExcInternalError());
-          Assert (local_quadrature_points_history <
-                  &quadrature_point_history.back(),
-                  ExcInternalError());
+          // point. To get it, we ask the history storage for the position
+          // of the first quadrature point of the present cell, and then add
+          // an offset corresponding to the index of the quadrature point we
+          // presently consider:
+          const unsigned int history_index
+            = quadrature_point_history.index(cell->active_cell_index(), 0);
 
           // In addition, we need the values of the external body forces at
           // the quadrature points on this cell:
@@ -4328,7 +4690,7 @@ namespace ElastoPlastic
           for (unsigned int q_point = 0; q_point < n_q_points; ++q_point)
             {
               SymmetricTensor<2, dim> tmp_strain_tensor_qpoint;
-              tmp_strain_tensor_qpoint = local_quadrature_points_history[q_point].old_strain
+              tmp_strain_tensor_qpoint = quadrature_point_history.get_old_strain(history_index + q_point)
                                          + incremental_strain_tensor[q_point];
 
               SymmetricTensor<4, dim> stress_strain_tensor_linearized;
@@ -4620,6 +4982,12 @@ namespace ElastoPlastic
   // parameters $\gamma$, the linear system becomes almost semidefinite though
   // still symmetric. BiCGStab appears to have an easier time with such linear
   // systems.
+  //
+  // Depending on the input file, CG is preconditioned either by SSOR or by
+  // an AMG method that is built from the rigid body modes and reused across
+  // Newton iterations, see <code>setup_amg_preconditioner</code> below. With
+  // SSOR the number of iterations grows with the mesh size, which becomes the
+  // limiting factor in 3d.
   template <int dim>
   void
   ElastoPlasticProblem<dim>::solve_newton_system ()
@@ -4632,58 +5000,25 @@ namespace ElastoPlastic
     constraints_hanging_nodes.set_zero(distributed_solution);
     constraints_hanging_nodes.set_zero(newton_rhs);
 
-    // ------- Solver Bicgstab --- Preconditioner AMG -------------------
-//    TrilinosWrappers::PreconditionAMG preconditioner;
-//    {
-//      TimerOutput::Scope t(computing_timer, "Solve: setup preconditioner");
-//
-//      std::vector<std::vector<bool> > constant_modes;
-//      DoFTools::extract_constant_modes(dof_handler, ComponentMask(),
-//                                       constant_modes);
-//
-//      TrilinosWrappers::PreconditionAMG::AdditionalData additional_data;
-//      additional_data.constant_modes = constant_modes;
-//      additional_data.elliptic = true;
-//      additional_data.n_cycles = 1;
-//      additional_data.w_cycle = false;
-//      additional_data.output_details = false;
-//      additional_data.smoother_sweeps = 2;
-//      additional_data.aggregation_threshold = 1e-2;
-//
-//      preconditioner.initialize(newton_matrix, additional_data);
-//    }
-
-//    {
-//      TimerOutput::Scope t(computing_timer, "Solve: iterate");
-//
-//      TrilinosWrappers::MPI::Vector tmp(locally_owned_dofs, mpi_communicator);
-//
-////      const double relative_accuracy = 1e-8;
-//      const double relative_accuracy = 1e-2;
-//      const double solver_tolerance  = relative_accuracy
-//                                       * newton_matrix.residual(tmp, distributed_solution,
-//                                                                newton_rhs);
-//
-//      SolverControl solver_control(newton_matrix.m(),
-//                                   solver_tolerance);
-//      SolverBicgstab<TrilinosWrappers::MPI::Vector> solver(solver_control);
-//      solver.solve(newton_matrix, distributed_solution,
-//                   newton_rhs, preconditioner);
-//
-//      pcout << "         Error: " << solver_control.initial_value()
-//            << " -> " << solver_control.last_value() << " in "
-//            << solver_control.last_step() << " Bicgstab iterations."
-//            << std::endl;
-//    }
-
-    // ------- Solver CG --- Preconditioner SSOR -------------------
-    TrilinosWrappers::PreconditionSSOR preconditioner;
+    // ------- Solver CG --- Preconditioner SSOR or AMG -------------------
+    TrilinosWrappers::PreconditionSSOR ssor_preconditioner;
     {
       TimerOutput::Scope t(computing_timer, "Solve: setup preconditioner");
 
-      TrilinosWrappers::PreconditionSSOR::AdditionalData additional_data;
-      preconditioner.initialize(newton_matrix, additional_data);
+      if (preconditioner_type == PreconditionerType::amg)
+        setup_amg_preconditioner();
+      else
+        {
+          TrilinosWrappers::PreconditionSSOR::AdditionalData additional_data;
+          ssor_preconditioner.initialize(newton_matrix, additional_data);
+        }
     }
+    const TrilinosWrappers::PreconditionBase &preconditioner
+      = (preconditioner_type == PreconditionerType::amg
+         ?
+         static_cast<const TrilinosWrappers::PreconditionBase &>(amg_preconditioner)
+         :
+         static_cast<const TrilinosWrappers::PreconditionBase &>(ssor_preconditioner));
 
     {
       TimerOutput::Scope t(computing_timer, "Solve: iterate");
@@ -4703,6 +5038,7 @@ namespace ElastoPlastic
       SolverCG<TrilinosWrappers::MPI::Vector> solver(solver_control);
       solver.solve(newton_matrix, distributed_solution,
                    newton_rhs, preconditioner);
+      n_solver_iterations += solver_control.last_step();
 
       pcout << "         Error: " << solver_control.initial_value()
             << " -> " << solver_control.last_value() << " in "
@@ -4717,6 +5053,61 @@ namespace ElastoPlastic
   }
 
 
+  // @sect4{ElastoPlasticProblem::setup_amg_preconditioner}
+
+  // During the Newton iteration the tangent matrix only changes where
+  // quadrature points enter or leave the plastic zone. As long as the number
+  // of plastic quadrature points, which <code>compute_nonlinear_residual</code>
+  // records in <code>fraction_of_plastic_q_points_per_cell</code>, stays
+  // close to what it was when the AMG hierarchy was built, the old hierarchy
+  // is still a good preconditioner and we skip the (expensive) setup.
+  template <int dim>
+  void
+  ElastoPlasticProblem<dim>::setup_amg_preconditioner ()
+  {
+    const unsigned int n_q_points = quadrature_formula.size();
+    unsigned int n_plastic_q_points = 0;
+    for (const auto &cell : dof_handler.active_cell_iterators())
+      if (cell->is_locally_owned())
+        n_plastic_q_points += static_cast<unsigned int>
+                              (std::round(fraction_of_plastic_q_points_per_cell(cell->active_cell_index())
+                                          * n_q_points));
+    n_plastic_q_points = Utilities::MPI::sum(n_plastic_q_points, mpi_communicator);
+
+    const double n_total_q_points
+      = static_cast<double>(triangulation.n_global_active_cells()) * n_q_points;
+    const unsigned int change = (n_plastic_q_points > n_plastic_q_points_at_amg_setup
+                                 ?
+                                 n_plastic_q_points - n_plastic_q_points_at_amg_setup
+                                 :
+                                 n_plastic_q_points_at_amg_setup - n_plastic_q_points);
+
+    if (amg_preconditioner_is_outdated == false
+        &&
+        change <= amg_rebuild_threshold * n_total_q_points)
+      {
+        pcout << "         Reusing AMG preconditioner ("
+              << n_plastic_q_points << " plastic quadrature points)"
+              << std::endl;
+        return;
+      }
+
+    if (amg_preconditioner_is_outdated)
+      compute_rigid_body_modes(dof_handler, rigid_body_modes);
+
+    initialize_elasticity_amg<dim>(newton_matrix, fe_degree,
+                                   rigid_body_modes, amg_preconditioner);
+
+    amg_preconditioner_is_outdated = false;
+    n_plastic_q_points_at_amg_setup = n_plastic_q_points;
+
+    pcout << "         Set up AMG preconditioner ("
+          << n_plastic_q_points << " plastic quadrature points)"
+          << std::endl;
+  }
+
+
+
   // @sect4{PlasticityContactProblem::solve_newton}
 
   // This is, finally, the function that implements the damped Newton method
@@ -4915,8 +5306,12 @@ namespace ElastoPlastic
       }
     else if (error_estimation_strategy == ErrorEstimationStrategy::weighted_residual_error)
       {
-        // make a non-parallel copy of tmp_solution
-        Vector<double> copy_solution(tmp_solution);
+        // the dual solver evaluates the primal solution on the locally
+        // owned cells and their neighbors, so it needs the ghost entries
+        TrilinosWrappers::MPI::Vector copy_solution(locally_owned_dofs,
+                                                    locally_relevant_dofs,
+                                                    mpi_communicator);
+        copy_solution = tmp_solution;
 
         // the dual function definition (it should be defined previously, e.g. input file)
         if (base_mesh == "Timoshenko beam")
@@ -4928,7 +5323,7 @@ namespace ElastoPlastic
 
             DualFunctional::PointValuesEvaluation<dim> dual_functional(evaluation_point);
 
-            DualSolver<dim> dual_solver(triangulation, fe,
+            DualSolver<dim> dual_solver(triangulation, dof_handler,
                                         copy_solution,
                                         constitutive_law, dual_functional,
                                         timestep_no, output_dir, base_mesh,
@@ -4952,7 +5347,7 @@ namespace ElastoPlastic
 
             DualFunctional::MeanStressFace<dim> dual_functional(face_id, comp_stress);
 
-            DualSolver<dim> dual_solver(triangulation, fe,
+            DualSolver<dim> dual_solver(triangulation, dof_handler,
                                         copy_solution,
                                         constitutive_law, dual_functional,
                                         timestep_no, output_dir, base_mesh,
@@ -4981,7 +5376,7 @@ namespace ElastoPlastic
 
             // .........................................
 
-            DualSolver<dim> dual_solver(triangulation, fe,
+            DualSolver<dim> dual_solver(triangulation, dof_handler,
                                         copy_solution,
                                         constitutive_law, dual_functional,
                                         timestep_no, output_dir, base_mesh,
@@ -5026,7 +5421,7 @@ namespace ElastoPlastic
 
             // -----------------------------------------------------------
 
-            DualSolver<dim> dual_solver(triangulation, fe,
+            DualSolver<dim> dual_solver(triangulation, dof_handler,
                                         copy_solution,
                                         constitutive_law, dual_functional,
                                         timestep_no, output_dir, base_mesh,
@@ -5048,7 +5443,10 @@ namespace ElastoPlastic
       }
 
 
-    relative_error = estimated_error_per_cell.l2_norm() / tmp_solution.l2_norm();
+    // the error indicators of cells owned by other processors are zero here
+    relative_error = std::sqrt(Utilities::MPI::sum(estimated_error_per_cell.norm_sqr(),
+                                                   mpi_communicator))
+                     / tmp_solution.l2_norm();
 
     pcout << "Estimated relative error = " << relative_error << std::endl;
 
@@ -5454,34 +5852,30 @@ namespace ElastoPlastic
   {
     // ---------------------------------------------------------------
     // Make a field variable for history varibales to be able to
-    // transfer the data to the quadrature points of the new mesh
+    // transfer the data to the quadrature points of the new mesh. There is
+    // one distributed vector for each independent component of the stress
+    // and the strain tensor, all of which are transferred at once below.
+    constexpr unsigned int n_components = QuadraturePointHistory<dim>::n_components;
+    const unsigned int n_q_points = quadrature_formula.size();
+
     FE_DGQ<dim> history_fe (1);
     DoFHandler<dim> history_dof_handler (triangulation);
     history_dof_handler.distribute_dofs (history_fe);
-    std::vector< std::vector< Vector<double> > >
-    history_stress_field (dim, std::vector< Vector<double> >(dim)),
-                         local_history_stress_values_at_qpoints (dim, std::vector< Vector<double> >(dim)),
-                         local_history_stress_fe_values (dim, std::vector< Vector<double> >(dim));
-
 
-    std::vector< std::vector< Vector<double> > >
-    history_strain_field (dim, std::vector< Vector<double> >(dim)),
-                         local_history_strain_values_at_qpoints (dim, std::vector< Vector<double> >(dim)),
-                         local_history_strain_fe_values (dim, std::vector< Vector<double> >(dim));
+    IndexSet history_locally_owned_dofs = history_dof_handler.locally_owned_dofs ();
+    IndexSet history_locally_relevant_dofs;
+    DoFTools::extract_locally_relevant_dofs (history_dof_handler,
+                                             history_locally_relevant_dofs);
 
-    for (unsigned int i=0; i<dim; ++i)
-      for (unsigned int j=0; j<dim; ++j)
-        {
-          history_stress_field[i][j].reinit(history_dof_handler.n_dofs());
-          local_history_stress_values_at_qpoints[i][j].reinit(quadrature_formula.size());
-          local_history_stress_fe_values[i][j].reinit(history_fe.dofs_per_cell);
+    std::vector<TrilinosWrappers::MPI::Vector>
+    history_field (2*n_components,
+                   TrilinosWrappers::MPI::Vector(history_locally_owned_dofs,
+                                                 mpi_communicator));
+    Vector<double> local_history_values_at_qpoints (n_q_points),
+           local_history_fe_values (history_fe.dofs_per_cell);
 
-          history_strain_field[i][j].reinit(history_dof_handler.n_dofs());
-          local_history_strain_values_at_qpoints[i][j].reinit(quadrature_formula.size());
-          local_history_strain_fe_values[i][j].reinit(history_fe.dofs_per_cell);
-        }
     FullMatrix<double> qpoint_to_dof_matrix (history_fe.dofs_per_cell,
-                                             quadrature_formula.size());
+                                             n_q_points);
     FETools::compute_projection_from_quadrature_points_matrix
     (history_fe,
      quadrature_formula, quadrature_formula,
@@ -5493,37 +5887,39 @@ namespace ElastoPlastic
     for (; cell!=endc; ++cell, ++dg_cell)
       if (cell->is_locally_owned())
         {
-          PointHistory<dim> *local_quadrature_points_history
-            = reinterpret_cast<PointHistory<dim> *>(cell->user_pointer());
-          Assert (local_quadrature_points_history >=
-                  &quadrature_point_history.front(),
-                  ExcInternalError());
-          Assert (local_quadrature_points_history <
-                  &quadrature_point_history.back(),
-                  ExcInternalError());
-          for (unsigned int i=0; i<dim; ++i)
-            for (unsigned int j=0; j<dim; ++j)
-              {
-                for (unsigned int q=0; q<quadrature_formula.size(); ++q)
-                  {
-                    local_history_stress_values_at_qpoints[i][j](q)
-                      = local_quadrature_points_history[q].old_stress[i][j];
-
-                    local_history_strain_values_at_qpoints[i][j](q)
-                      = local_quadrature_points_history[q].old_strain[i][j];
-                  }
-                qpoint_to_dof_matrix.vmult (local_history_stress_fe_values[i][j],
-                                            local_history_stress_values_at_qpoints[i][j]);
-                dg_cell->set_dof_values (local_history_stress_fe_values[i][j],
-                                         history_stress_field[i][j]);
-
-                qpoint_to_dof_matrix.vmult (local_history_strain_fe_values[i][j],
-                                            local_history_strain_values_at_qpoints[i][j]);
-                dg_cell->set_dof_values (local_history_strain_fe_values[i][j],
-                                         history_strain_field[i][j]);
-              }
+          const unsigned int history_index
+            = quadrature_point_history.index(cell->active_cell_index(), 0);
+          for (unsigned int c=0; c<2*n_components; ++c)
+            {
+              const std::vector<double> &history_component
+                = (c < n_components
+                   ?
+                   quadrature_point_history.old_stress[c]
+                   :
+                   quadrature_point_history.old_strain[c-n_components]);
+              for (unsigned int q=0; q<n_q_points; ++q)
+                local_history_values_at_qpoints(q) = history_component[history_index + q];
+
+              qpoint_to_dof_matrix.vmult (local_history_fe_values,
+                                          local_history_values_at_qpoints);
+              dg_cell->set_dof_values (local_history_fe_values,
+                                       history_field[c]);
+            }
         }
 
+    std::vector<TrilinosWrappers::MPI::Vector>
+    ghosted_history_field (2*n_components,
+                           TrilinosWrappers::MPI::Vector(history_locally_owned_dofs,
+                                                         history_locally_relevant_dofs,
+                                                         mpi_communicator));
+    std::vector<const TrilinosWrappers::MPI::Vector *> history_field_pointers (2*n_components);
+    for (unsigned int c=0; c<2*n_components; ++c)
+      {
+        history_field[c].compress (VectorOperation::insert);
+        ghosted_history_field[c] = history_field[c];
+        history_field_pointers[c] = &ghosted_history_field[c];
+      }
+
 
     // ---------------------------------------------------------------
     // Refine the mesh
@@ -5560,31 +5956,9 @@ namespace ElastoPlastic
     if (transfer_solution)
       incremental_displacement_transfer.prepare_for_coarsening_and_refinement(incremental_displacement);
 
-    SolutionTransfer<dim, Vector<double> > history_stress_field_transfer0(history_dof_handler),
-                     history_stress_field_transfer1(history_dof_handler),
-                     history_stress_field_transfer2(history_dof_handler);
-    history_stress_field_transfer0.prepare_for_coarsening_and_refinement(history_stress_field[0]);
-    if ( dim > 1)
-      {
-        history_stress_field_transfer1.prepare_for_coarsening_and_refinement(history_stress_field[1]);
-      }
-    if ( dim == 3)
-      {
-        history_stress_field_transfer2.prepare_for_coarsening_and_refinement(history_stress_field[2]);
-      }
-
-    SolutionTransfer<dim, Vector<double> > history_strain_field_transfer0(history_dof_handler),
-                     history_strain_field_transfer1(history_dof_handler),
-                     history_strain_field_transfer2(history_dof_handler);
-    history_strain_field_transfer0.prepare_for_coarsening_and_refinement(history_strain_field[0]);
-    if ( dim > 1)
-      {
-        history_strain_field_transfer1.prepare_for_coarsening_and_refinement(history_strain_field[1]);
-      }
-    if ( dim == 3)
-      {
-        history_strain_field_transfer2.prepare_for_coarsening_and_refinement(history_strain_field[2]);
-      }
+    parallel::distributed::SolutionTransfer<dim,
+             TrilinosWrappers::MPI::Vector> history_field_transfer(history_dof_handler);
+    history_field_transfer.prepare_for_coarsening_and_refinement(history_field_pointers);
 
     triangulation.execute_coarsening_and_refinement();
     pcout << "    Number of active cells:       "
@@ -5611,47 +5985,17 @@ namespace ElastoPlastic
 
     // ---------------------------------------------------
     history_dof_handler.distribute_dofs (history_fe);
-    // stress
-    std::vector< std::vector< Vector<double> > >
-    distributed_history_stress_field (dim, std::vector< Vector<double> >(dim));
-    for (unsigned int i=0; i<dim; ++i)
-      for (unsigned int j=0; j<dim; ++j)
-        {
-          distributed_history_stress_field[i][j].reinit(history_dof_handler.n_dofs());
-        }
+    history_locally_owned_dofs = history_dof_handler.locally_owned_dofs ();
+    DoFTools::extract_locally_relevant_dofs (history_dof_handler,
+                                             history_locally_relevant_dofs);
 
-    history_stress_field_transfer0.interpolate(history_stress_field[0], distributed_history_stress_field[0]);
-    if ( dim > 1)
-      {
-        history_stress_field_transfer1.interpolate(history_stress_field[1], distributed_history_stress_field[1]);
-      }
-    if ( dim == 3)
+    std::vector<TrilinosWrappers::MPI::Vector *> distributed_history_field_pointers (2*n_components);
+    for (unsigned int c=0; c<2*n_components; ++c)
       {
-        history_stress_field_transfer2.interpolate(history_stress_field[2], distributed_history_stress_field[2]);
+        history_field[c].reinit (history_locally_owned_dofs, mpi_communicator);
+        distributed_history_field_pointers[c] = &history_field[c];
       }
-
-    history_stress_field = distributed_history_stress_field;
-
-    // strain
-    std::vector< std::vector< Vector<double> > >
-    distributed_history_strain_field (dim, std::vector< Vector<double> >(dim));
-    for (unsigned int i=0; i<dim; ++i)
-      for (unsigned int j=0; j<dim; ++j)
-        {
-          distributed_history_strain_field[i][j].reinit(history_dof_handler.n_dofs());
-        }
-
-    history_strain_field_transfer0.interpolate(history_strain_field[0], distributed_history_strain_field[0]);
-    if ( dim > 1)
-      {
-        history_strain_field_transfer1.interpolate(history_strain_field[1], distributed_history_strain_field[1]);
-      }
-    if ( dim == 3)
-      {
-        history_strain_field_transfer2.interpolate(history_strain_field[2], distributed_history_strain_field[2]);
-      }
-
-    history_strain_field = distributed_history_strain_field;
+    history_field_transfer.interpolate (distributed_history_field_pointers);
 
     // ---------------------------------------------------------------
     // Transfer the history data to the quadrature points of the new mesh
@@ -5659,7 +6003,7 @@ namespace ElastoPlastic
     // interpolated global field to the quadrature points on the
     // new mesh. The following code will do that:
 
-    FullMatrix<double> dof_to_qpoint_matrix (quadrature_formula.size(),
+    FullMatrix<double> dof_to_qpoint_matrix (n_q_points,
                                              history_fe.dofs_per_cell);
     FETools::compute_interpolation_to_quadrature_points_matrix
     (history_fe,
@@ -5671,37 +6015,24 @@ namespace ElastoPlastic
     for (; cell != endc; ++cell, ++dg_cell)
       if (cell->is_locally_owned())
         {
-          PointHistory<dim> *local_quadrature_points_history
-            = reinterpret_cast<PointHistory<dim> *>(cell->user_pointer());
-          Assert (local_quadrature_points_history >=
-                  &quadrature_point_history.front(),
-                  ExcInternalError());
-          Assert (local_quadrature_points_history <
-                  &quadrature_point_history.back(),
-                  ExcInternalError());
-          for (unsigned int i=0; i<dim; ++i)
-            for (unsigned int j=0; j<dim; ++j)
-              {
-                dg_cell->get_dof_values (history_stress_field[i][j],
-                                         local_history_stress_fe_values[i][j]);
-                dof_to_qpoint_matrix.vmult (local_history_stress_values_at_qpoints[i][j],
-                                            local_history_stress_fe_values[i][j]);
-
-                dg_cell->get_dof_values (history_strain_field[i][j],
-                                         local_history_strain_fe_values[i][j]);
-                dof_to_qpoint_matrix.vmult (local_history_strain_values_at_qpoints[i][j],
-                                            local_history_strain_fe_values[i][j]);
-                for (unsigned int q=0; q<quadrature_formula.size(); ++q)
-                  {
-                    local_quadrature_points_history[q].old_stress[i][j]
-                      = local_history_stress_values_at_qpoints[i][j](q);
-
-                    local_quadrature_points_history[q].old_strain[i][j]
-                      = local_history_strain_values_at_qpoints[i][j](q);
-                  }
-              }
-
-
+          const unsigned int history_index
+            = quadrature_point_history.index(cell->active_cell_index(), 0);
+          for (unsigned int c=0; c<2*n_components; ++c)
+            {
+              dg_cell->get_dof_values (history_field[c],
+                                       local_history_fe_values);
+              dof_to_qpoint_matrix.vmult (local_history_values_at_qpoints,
+                                          local_history_fe_values);
+
+              std::vector<double> &history_component
+                = (c < n_components
+                   ?
+                   quadrature_point_history.old_stress[c]
+                   :
+                   quadrature_point_history.old_strain[c-n_components]);
+              for (unsigned int q=0; q<n_q_points; ++q)
+                history_component[history_index + q] = local_history_values_at_qpoints(q);
+            }
         }
   }
 
@@ -5709,8 +6040,8 @@ namespace ElastoPlastic
 
   // At the beginning of our computations, we needed to set up initial values
   // of the history variables, such as the existing stresses in the material,
-  // that we store in each quadrature point. As mentioned above, we use the
-  // <code>user_pointer</code> for this that is available in each cell.
+  // that we store in each quadrature point. As mentioned above, these are
+  // kept in the arrays of the QuadraturePointHistory object.
   //
   // To put this into larger perspective, we note that if we had previously
   // available stresses in our model (which we assume do not exist for the
@@ -5724,69 +6055,16 @@ namespace ElastoPlastic
   template <int dim>
   void ElastoPlasticProblem<dim>::setup_quadrature_point_history ()
   {
-    // What we need to do here is to first count how many quadrature points
-    // are within the responsibility of this processor. This, of course,
-    // equals the number of cells that belong to this processor times the
-    // number of quadrature points our quadrature formula has on each cell.
-    //
-    // For good measure, we also set all user pointers of all cells, whether
-    // ours of not, to the null pointer. This way, if we ever access the user
-    // pointer of a cell which we should not have accessed, a segmentation
-    // fault will let us know that this should not have happened:
-    unsigned int our_cells = 0;
-    for (typename Triangulation<dim>::active_cell_iterator
-         cell = triangulation.begin_active();
-         cell != triangulation.end(); ++cell)
-      if (cell->is_locally_owned())
-        ++our_cells;
-
-    triangulation.clear_user_data();
-
-    // Next, allocate as many quadrature objects as we need. Since the
-    // <code>resize</code> function does not actually shrink the amount of
-    // allocated memory if the requested new size is smaller than the old
-    // size, we resort to a trick to first free all memory, and then
-    // reallocate it: we declare an empty vector as a temporary variable and
-    // then swap the contents of the old vector and this temporary
-    // variable. This makes sure that the
-    // <code>quadrature_point_history</code> is now really empty, and we can
-    // let the temporary variable that now holds the previous contents of the
-    // vector go out of scope and be destroyed. In the next step. we can then
-    // re-allocate as many elements as we need, with the vector
-    // default-initializing the <code>PointHistory</code> objects, which
-    // includes setting the stress variables to zero.
-    {
-      std::vector<PointHistory<dim> > tmp;
-      tmp.swap (quadrature_point_history);
-    }
-    quadrature_point_history.resize (our_cells *
+    // All we need to do here is to allocate the arrays of the history
+    // storage, one entry per quadrature point of every active cell of the
+    // local mesh, and to set them to zero. The storage is addressed by the
+    // active cell index, so there is no need to count the cells that belong
+    // to this processor or to set up any user pointers. The arrays are
+    // reallocated from scratch, so memory is again returned when the mesh
+    // is coarsened.
+    quadrature_point_history = QuadraturePointHistory<dim>();
+    quadrature_point_history.reinit (triangulation.n_active_cells(),
                                      quadrature_formula.size());
-
-    // Finally loop over all cells again and set the user pointers from the
-    // cells that belong to the present processor to point to the first
-    // quadrature point objects corresponding to this cell in the vector of
-    // such objects:
-    unsigned int history_index = 0;
-    for (typename Triangulation<dim>::active_cell_iterator
-         cell = triangulation.begin_active();
-         cell != triangulation.end(); ++cell)
-      if (cell->is_locally_owned())
-        {
-          cell->set_user_pointer (&quadrature_point_history[history_index]);
-          history_index += quadrature_formula.size();
-        }
-
-    // At the end, for good measure make sure that our count of elements was
-    // correct and that we have both used up all objects we allocated
-    // previously, and not point to any objects beyond the end of the
-    // vector. Such defensive programming strategies are always good checks to
-    // avoid accidental errors and to guard against future changes to this
-    // function that forget to update all uses of a variable at the same
-    // time. Recall that constructs using the <code>Assert</code> macro are
-    // optimized away in optimized mode, so do not affect the run time of
-    // optimized runs:
-    Assert (history_index == quadrature_point_history.size(),
-            ExcInternalError());
   }
 
   // @sect4{ElastoPlasticProblem::update_quadrature_point_history}
@@ -5849,7 +6127,6 @@ namespace ElastoPlastic
     const unsigned int n_q_points = quadrature_formula.size();
 
     std::vector<SymmetricTensor<2, dim> > incremental_strain_tensor(n_q_points);
-    SymmetricTensor<4, dim> stress_strain_tensor;
 
 
     // Then loop over all cells and do the job in the cells that belong to our
@@ -5861,20 +6138,23 @@ namespace ElastoPlastic
 
     const FEValuesExtractors::Vector displacement(0);
 
+    // The history variables are updated for batches of
+    // <code>VectorizedArray::size()</code> consecutive quadrature points at
+    // once. Since every component is stored contiguously, the old strains can
+    // be loaded directly into the SIMD lanes; only the strain increments,
+    // which FEValues returns as an array of tensors, need to be gathered. If
+    // the number of quadrature points per cell is not a multiple of the SIMD
+    // width, the unused lanes of the last batch are zero and not written back.
+    constexpr unsigned int n_lanes = VectorizedArray<double>::size();
+    constexpr unsigned int n_components = QuadraturePointHistory<dim>::n_components;
+
     for (;  cell != endc; ++cell)
       if (cell->is_locally_owned())
         {
-          // Next, get a pointer to the quadrature point history data local to
-          // the present cell, and, as a defensive measure, make sure that
-          // this pointer is within the bounds of the global array:
-          PointHistory<dim> *local_quadrature_points_history
-            = reinterpret_cast<PointHistory<dim> *>(cell->user_pointer());
-          Assert (local_quadrature_points_history >=
-                  &quadrature_point_history.front(),
-                  ExcInternalError());
-          Assert (local_quadrature_points_history <
-                  &quadrature_point_history.back(),
-                  ExcInternalError());
+          // Next, get the position of the first quadrature point of the
+          // present cell in the history storage:
+          const unsigned int history_index
+            = quadrature_point_history.index(cell->active_cell_index(), 0);
 
           // Then initialize the <code>FEValues</code> object on the present
           // cell, and extract the strains of the displacement at the
@@ -5883,22 +6163,53 @@ namespace ElastoPlastic
           fe_values[displacement].get_function_symmetric_gradients(incremental_displacement,
                                                                    incremental_strain_tensor);
 
-          // Then loop over the quadrature points of this cell:
-          for (unsigned int q=0; q<quadrature_formula.size(); ++q)
+          // Then loop over batches of quadrature points of this cell:
+          for (unsigned int q=0; q<n_q_points; q+=n_lanes)
             {
-              local_quadrature_points_history[q].old_strain +=
-                incremental_strain_tensor[q];
+              const unsigned int n_filled_lanes = std::min(n_lanes, n_q_points - q);
 
-              constitutive_law.get_stress_strain_tensor(local_quadrature_points_history[q].old_strain,
-                                                        stress_strain_tensor);
+              SymmetricTensor<2, dim, VectorizedArray<double> > strain;
+              for (unsigned int c=0; c<n_components; ++c)
+                {
+                  double *old_strain = &quadrature_point_history.old_strain[c][history_index + q];
+                  if (n_filled_lanes == n_lanes)
+                    strain.access_raw_entry(c).load(old_strain);
+                  else
+                    {
+                      strain.access_raw_entry(c) = 0.;
+                      for (unsigned int v=0; v<n_filled_lanes; ++v)
+                        strain.access_raw_entry(c)[v] = old_strain[v];
+                    }
+                  for (unsigned int v=0; v<n_filled_lanes; ++v)
+                    strain.access_raw_entry(c)[v]
+                    += incremental_strain_tensor[q + v].access_raw_entry(c);
+                }
+
+              const SymmetricTensor<2, dim, VectorizedArray<double> > stress
+                = constitutive_law.get_stress(strain);
 
               // The result of these operations is then written back into
               // the original place:
-              local_quadrature_points_history[q].old_stress
-                = stress_strain_tensor *  local_quadrature_points_history[q].old_strain;
+              for (unsigned int c=0; c<n_components; ++c)
+                {
+                  double *old_strain = &quadrature_point_history.old_strain[c][history_index + q];
+                  double *old_stress = &quadrature_point_history.old_stress[c][history_index + q];
+                  if (n_filled_lanes == n_lanes)
+                    {
+                      strain.access_raw_entry(c).store(old_strain);
+                      stress.access_raw_entry(c).store(old_stress);
+                    }
+                  else
+                    for (unsigned int v=0; v<n_filled_lanes; ++v)
+                      {
+                        old_strain[v] = strain.access_raw_entry(c)[v];
+                        old_stress[v] = stress.access_raw_entry(c)[v];
+                      }
+                }
 
-              local_quadrature_points_history[q].point
-                = fe_values.get_quadrature_points ()[q];
+              for (unsigned int v=0; v<n_filled_lanes; ++v)
+                quadrature_point_history.point[history_index + q + v]
+                  = fe_values.quadrature_point (q + v);
             }
         }
   }
@@ -6099,19 +6410,13 @@ namespace ElastoPlastic
     for (; cell!=endc; ++cell, ++dg_cell)
       if (cell->is_locally_owned())
         {
-          PointHistory<dim> *local_quadrature_points_history
-            = reinterpret_cast<PointHistory<dim> *>(cell->user_pointer());
-          Assert (local_quadrature_points_history >=
-                  &quadrature_point_history.front(),
-                  ExcInternalError());
-          Assert (local_quadrature_points_history <
-                  &quadrature_point_history.back(),
-                  ExcInternalError());
+          const unsigned int history_index
+            = quadrature_point_history.index(cell->active_cell_index(), 0);
 
           // Then loop over the quadrature points of this cell:
           for (unsigned int q=0; q<quadrature_formula.size(); ++q)
             {
-              stress_at_qpoint = local_quadrature_points_history[q].old_stress;
+              stress_at_qpoint = quadrature_point_history.get_old_stress(history_index + q);
 
               for (unsigned int i=0; i<dim; ++i)
                 for (unsigned int j=i; j<dim; ++j)
@@ -6446,22 +6751,16 @@ namespace ElastoPlastic
         for (; cell!=endc; ++cell, ++dg_cell)
           if (cell->is_locally_owned())
             {
-              PointHistory<dim> *local_quadrature_points_history
-                = reinterpret_cast<PointHistory<dim> *>(cell->user_pointer());
-              Assert (local_quadrature_points_history >=
-                      &quadrature_point_history.front(),
-                      ExcInternalError());
-              Assert (local_quadrature_points_history <
-                      &quadrature_point_history.back(),
-                      ExcInternalError());
+              const unsigned int history_index
+                = quadrature_point_history.index(cell->active_cell_index(), 0);
 
               // Then loop over the quadrature points of this cell:
               for (unsigned int q=0; q<quadrature_formula.size(); ++q)
                 {
-                  stress_at_qpoint = local_quadrature_points_history[q].old_stress;
+                  stress_at_qpoint = quadrature_point_history.get_old_stress(history_index + q);
 
                   // transform the stress from the Cartesian coordinate to the polar coordinate
-                  const Point<dim> point = local_quadrature_points_history[q].point;
+                  const Point<dim> point = quadrature_point_history.point[history_index + q];
                   const double theta = std::atan2(point(1),point(0));
 
                   // rotation matrix
@@ -6941,19 +7240,13 @@ namespace ElastoPlastic
                          std::fabs(cell->vertex(v)[1] - point_A[1])<1e-6 &&
                          std::fabs(cell->vertex(v)[2] - point_A[2])<1e-6)
                       {
-                        PointHistory<dim> *local_quadrature_points_history
-                          = reinterpret_cast<PointHistory<dim> *>(cell->user_pointer());
-                        Assert (local_quadrature_points_history >=
-                                &quadrature_point_history.front(),
-                                ExcInternalError());
-                        Assert (local_quadrature_points_history <
-                                &quadrature_point_history.back(),
-                                ExcInternalError());
+                        const unsigned int history_index
+                          = quadrature_point_history.index(cell->active_cell_index(), 0);
 
                         // Then loop over the quadrature points of this cell:
                         for (unsigned int q=0; q<quadrature_formula.size(); ++q)
                           {
-                            strain_at_qpoint = local_quadrature_points_history[q].old_strain;
+                            strain_at_qpoint = quadrature_point_history.get_old_strain(history_index + q);
 
                             local_strain_yy_values_at_qpoints(q) = strain_at_qpoint[1][1];
                           }
@@ -7038,25 +7331,19 @@ namespace ElastoPlastic
           for (; cell!=endc; ++cell)
             if (cell->is_locally_owned())
               {
-                PointHistory<dim> *local_quadrature_points_history
-                  = reinterpret_cast<PointHistory<dim> *>(cell->user_pointer());
-                Assert (local_quadrature_points_history >=
-                        &quadrature_point_history.front(),
-                        ExcInternalError());
-                Assert (local_quadrature_points_history <
-                        &quadrature_point_history.back(),
-                        ExcInternalError());
+                const unsigned int history_index
+                  = quadrature_point_history.index(cell->active_cell_index(), 0);
 
                 // Then loop over the quadrature points of this cell:
                 for (unsigned int q=0; q<quadrature_formula.size(); ++q)
                   {
-                    stress_at_qpoint = local_quadrature_points_history[q].old_stress;
+                    stress_at_qpoint = quadrature_point_history.get_old_stress(history_index + q);
 
                     const double VM_stress = Evaluation::get_von_Mises_stress(stress_at_qpoint);
                     if (VM_stress > VM_stress_max)
                       {
                         VM_stress_max = VM_stress;
-                        point_max = local_quadrature_points_history[q].point;
+                        point_max = quadrature_point_history.point[history_index + q];
                       }
 
                   }
@@ -7075,6 +7362,67 @@ namespace ElastoPlastic
   }
 
 
+  // @sect4{PlasticityContactProblem::write_benchmark_data}
+
+  // For regression tests and scaling studies, this function appends the
+  // data collected by the <code>computing_timer</code> during the current
+  // time step to <code>benchmark.csv</code> in the output directory, along
+  // with the number of degrees of freedom, the number of CG iterations and
+  // the peak resident memory, one <code>step,quantity,value</code> entry per
+  // line. The number of calls of the "Solve" section is the number of Newton
+  // iterations. Times are the maximum over all processors, and the memory is
+  // that of the largest process. The function has to be called on all
+  // processors, but only the first one writes to the file.
+  template <int dim>
+  void
+  ElastoPlasticProblem<dim>::write_benchmark_data (std::ofstream &output)
+  {
+    const std::map<std::string, double> wall_times
+      = computing_timer.get_summary_data(TimerOutput::total_wall_time);
+    const std::map<std::string, double> n_calls
+      = computing_timer.get_summary_data(TimerOutput::n_calls);
+
+    // The sections of the <code>computing_timer</code> are entered by all
+    // processors together: the line search and the refinement cycles are
+    // controlled by norms of distributed vectors, which are the same on all
+    // processors. Each of them therefore reduces over the same sections in
+    // the same order.
+    Assert(Utilities::MPI::min(static_cast<unsigned int>(wall_times.size()),
+                               mpi_communicator) ==
+           Utilities::MPI::max(static_cast<unsigned int>(wall_times.size()),
+                               mpi_communicator),
+           ExcMessage("All processors need to have entered the same timer "
+                      "sections."));
+    std::map<std::string, double> max_wall_times;
+    std::map<std::string, double> max_n_calls;
+    for (const auto &section : wall_times)
+      {
+        max_wall_times[section.first] =
+          Utilities::MPI::max(section.second, mpi_communicator);
+        max_n_calls[section.first] =
+          Utilities::MPI::max(n_calls.at(section.first), mpi_communicator);
+      }
+
+    Utilities::System::MemoryStats stats;
+    Utilities::System::get_memory_stats(stats);
+    const double peak_memory
+      = Utilities::MPI::max(static_cast<double>(stats.VmHWM), mpi_communicator);
+
+    if (this_mpi_process == 0)
+      {
+        output << timestep_no << ",n_mpi_processes," << n_mpi_processes << std::endl
+               << timestep_no << ",n_dofs," << dof_handler.n_dofs() << std::endl
+               << timestep_no << ",n_solver_iterations," << n_solver_iterations << std::endl
+               << timestep_no << ",peak_resident_memory_kB," << peak_memory << std::endl;
+        for (const auto &section : max_wall_times)
+          output << timestep_no << ",wall_time:" << section.first << ','
+                 << section.second << std::endl
+                 << timestep_no << ",n_calls:" << section.first << ','
+                 << max_n_calls.at(section.first) << std::endl;
+      }
+  }
+
+
   // @sect4{PlasticityContactProblem::run}
 
   // As in all other tutorial programs, the <code>run()</code> function contains
@@ -7123,6 +7471,13 @@ namespace ElastoPlastic
 
     setup_quadrature_point_history ();
 
+    std::ofstream benchmark_output;
+    if (this_mpi_process == 0)
+      {
+        benchmark_output.open((output_dir + "benchmark.csv").c_str());
+        benchmark_output << "step,quantity,value" << std::endl;
+      }
+
     while (present_time < end_time)
       {
         present_time += present_timestep;
@@ -7197,8 +7552,11 @@ namespace ElastoPlastic
         output_results((std::string("solution-") +
                         Utilities::int_to_string(timestep_no, 4)).c_str());
 
+        write_benchmark_data (benchmark_output);
+
         computing_timer.print_summary();
         computing_timer.reset();
+        n_solver_iterations = 0;
 
         Utilities::System::MemoryStats stats;
         Utilities::System::get_memory_stats(stats);
@@ -7251,13 +7609,17 @@ int main (int argc, char *argv[])
       ParameterHandler prm;
       const int dim = 3;
       ElastoPlasticProblem<dim>::declare_parameters(prm);
-      if (argc != 2)
+      if (argc != 2 && argc != 3)
         {
-          std::cerr << "*** Call this program as <./elastoplastic input.prm>" << std::endl;
+          std::cerr << "*** Call this program as <./elastoplastic input.prm [n_initial_refinements]>" << std::endl;
           return 1;
         }
 
       prm.parse_input(argv[1]);
+      // The optional second argument replaces the number of initial
+      // refinements of the parameter file, e.g. for scaling studies.
+      if (argc == 3)
+        prm.set("number of initial refinements", argv[2]);
       Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv);
       {
         ElastoPlasticProblem<dim> problem(prm);
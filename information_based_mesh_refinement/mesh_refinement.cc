@@ -511,15 +511,23 @@ void InformationDensityMeshRefinement<dim>::solve ()
 
 
 // This is really the only interesting function of this program. It
-// computes the functions $h_K = A^{-1} s_K$ for each source function
-// (corresponding to each cell of the mesh). To do so, it first
-// computes the forward matrix $A$ and uses the SparseDirectUMFPACK
-// class to build an LU decomposition for this matrix. Then it loops
-// over all cells $K$ and computes the corresponding $h_K$ by applying
-// the LU decomposition to a right hand side vector for each $s_K$.
+// computes the information content of each cell $K$, which requires the
+// values $h_K(x_n)$ at the detector locations $x_n$ of the functions
+// $h_K = A^{-1} s_K$ for each source function $s_K$ (corresponding to each
+// cell of the mesh). To do so, it first computes the forward matrix $A$
+// (which is part of the system matrix of the inverse problem) and uses the
+// SparseDirectUMFPACK class to build an LU decomposition for this matrix.
 //
-// The actual information content is then computed by evaluating these
-// functions $h_K$ at measurement locations.
+// Computing all of the $h_K$ would require one forward solve per cell of
+// the mesh. But we only need their values at the detector locations,
+// $h_K(x_n) = e_n^T h_K = (A^{-T} e_n)^T s_K$, where $e_n$ is the vector of
+// shape function values at $x_n$. We therefore solve one adjoint problem
+// $A^T g_n = e_n$ per detector instead, using the same LU decomposition,
+// and then obtain every $h_K(x_n)$ as a dot product of $g_n$ with the
+// (cell-local) vector $s_K$. The number of solves is then the number of
+// detectors rather than the number of cells. Constraints are taken into
+// account by condensing before and distributing after the solve, the two
+// operations being transposes of each other.
 template <int dim>
 void InformationDensityMeshRefinement<dim>::compute_information_content ()
 {
@@ -528,145 +536,117 @@ void InformationDensityMeshRefinement<dim>::compute_information_content ()
   
   information_content.reinit (triangulation.n_active_cells());
 
-  const FE_Q<dim> information_fe (fe.base_element(0).degree);
-  DoFHandler<dim> information_dof_handler (triangulation);
-  information_dof_handler.distribute_dofs (information_fe);
-
-  AffineConstraints<double> constraints;
-  DoFTools::make_hanging_node_constraints(information_dof_handler, constraints);
-  constraints.close();
-
-  SparsityPattern sparsity (information_dof_handler.n_dofs(),
-                            information_dof_handler.max_couplings_between_dofs());
-  DoFTools::make_sparsity_pattern (information_dof_handler, sparsity);
-  constraints.condense (sparsity);
-  sparsity.compress ();
-
-  SparseMatrix<double> system_matrix (sparsity);
+  // The forward operator $A$ is the $(c,c)$ block of the system matrix
+  // of the inverse problem, assembled with the same finite element and
+  // quadrature, and already condensed with the hanging node constraints
+  // and with zero boundary values applied. So rather than building a
+  // separate DoFHandler and assembling the same operator a second time,
+  // we factorize that block directly:
+  SparseDirectUMFPACK A_inverse;
+  A_inverse.factorize(system_matrix.block(0,0));
 
   QGauss<dim>  quadrature_formula(3);
 
-  const unsigned int   dofs_per_cell = information_fe.dofs_per_cell;
+  const unsigned int   dofs_per_cell = fe.dofs_per_cell;
   const unsigned int   n_q_points    = quadrature_formula.size();
 
-  // First build the forward operator
-  {
-    FEValues<dim> fe_values (information_fe, quadrature_formula,
-                             update_values   | update_gradients |
-                             update_quadrature_points | update_JxW_values);
+  const FEValuesExtractors::Scalar c(0);
 
-    FullMatrix<double>   cell_matrix (dofs_per_cell, dofs_per_cell);
+  // Now find the quadrature points that coincide with detector locations
+  // and set up the vectors $e_n$ of shape function values there. (There
+  // is typically exactly one such point per detector, at the center of
+  // the cell the detector was moved to.)
+  //
+  // Since the constraints are stored for the degrees of freedom of all
+  // components, we store these vectors as block vectors of which only the
+  // first block is ever nonzero.
+  struct DetectorEvaluation
+  {
+    unsigned int        detector;
+    BlockVector<double> adjoint_solution;
+  };
+  std::vector<DetectorEvaluation> detector_evaluations;
+  {
+    FEValues<dim> fe_values (fe, quadrature_formula,
+                             update_values | update_quadrature_points);
     std::vector<unsigned int> local_dof_indices (dofs_per_cell);
 
-    for (const auto &cell : information_dof_handler.active_cell_iterators())
+    for (const auto &cell : dof_handler.active_cell_iterators())
       {
         fe_values.reinit (cell);
-        cell_matrix = 0;
+        cell->get_dof_indices (local_dof_indices);
 
         for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
-          for (unsigned int i=0; i<dofs_per_cell; ++i)
-            for (unsigned int j=0; j<dofs_per_cell; ++j)
-              cell_matrix(i,j) += (fe_values.shape_grad (i,q_point) *
-                                   fe_values.shape_grad(j,q_point)
-                                   +
-                                   fe_values.shape_value(i,q_point) *
-                                   (velocity * fe_values.shape_grad(j,q_point))) *
-                                  fe_values.JxW(q_point);
-
-        cell->distribute_local_to_global (cell_matrix,
-                                          system_matrix);
+          for (unsigned int n=0; n< detector_locations_on_mesh.size(); ++n)
+            if (fe_values.quadrature_point(q_point).distance (detector_locations_on_mesh[n]) < 1e-12)
+              {
+                DetectorEvaluation evaluation;
+                evaluation.detector = n;
+                evaluation.adjoint_solution.reinit (solution);
+                for (unsigned int i=0; i<dofs_per_cell; ++i)
+                  if (fe.system_to_component_index(i).first == 0)
+                    evaluation.adjoint_solution(local_dof_indices[i])
+                      += fe_values[c].value (i,q_point);
+                detector_evaluations.push_back (std::move(evaluation));
+              }
       }
-
-    constraints.condense (system_matrix);
-
-    std::map<unsigned int, double> boundary_values;
-    VectorTools::interpolate_boundary_values (information_dof_handler,
-                                              0,
-                                              Functions::ZeroFunction<dim>(),
-                                              boundary_values);
-    Vector<double> tmp (information_dof_handler.n_dofs());
-    MatrixTools::apply_boundary_values (boundary_values,
-                                        system_matrix,
-                                        tmp,
-                                        tmp);
   }
 
-  // Then factorize
-  SparseDirectUMFPACK A_inverse;
-  A_inverse.factorize(system_matrix);
-
-  // Now compute the solutions corresponding to the possible
-  // sources. Each source is active on exactly one cell.
-  //
-  // As mentioned in the paper, this is a trivially parallel job, so
-  // we send the computations for each of these cells onto a separate
-  // task and let the OS schedule them onto individual processor
-  // cores.
+  // Solve the adjoint problems. As mentioned in the paper, this is a
+  // trivially parallel job, so we send each of these solves onto a separate
+  // task and let the OS schedule them onto individual processor cores.
   Threads::TaskGroup<void> tasks;
-  for (unsigned int K=0; K<triangulation.n_active_cells(); ++K)
+  for (auto &evaluation : detector_evaluations)
     tasks +=
-      Threads::new_task([&,K]()
+      Threads::new_task([&]()
                         {
-                          Vector<double> rhs (information_dof_handler.n_dofs());
-                          Vector<double> cell_rhs (dofs_per_cell);
-                          std::vector<unsigned int> local_dof_indices (dofs_per_cell);
-
-                          typename DoFHandler<dim>::active_cell_iterator
-                            cell = information_dof_handler.begin_active();
-                          std::advance (cell, K);
-
-                          FEValues<dim> fe_values (information_fe, quadrature_formula,
-                                                   update_values |
-                                                   update_quadrature_points | update_JxW_values);
-
-                          fe_values.reinit (cell);
-                          cell_rhs = 0;
-
-                          for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
-                            for (unsigned int i=0; i<dofs_per_cell; ++i)
-                              cell_rhs(i) += fe_values.shape_value (i,q_point) *
-                                             fe_values.JxW(q_point);
-
-                          cell->distribute_local_to_global (cell_rhs,
-                                                            rhs);
-
-                          constraints.condense (rhs);
-
-                          A_inverse.solve(rhs);
-
-                          constraints.distribute (rhs);
-
-                          // Having computed the forward solutions
-                          // corresponding to this source term, evaluate its
-                          // contribution to the information content on all
-                          // cells of the mesh by taking into account the
-                          // detector locations. We add these into global
-                          // objects, so we have to guard access to the
-                          // global object:
-                          static std::mutex m;
-                          std::lock_guard<std::mutex> g(m);
-                   
-
-                          information_content(K) = regularization_parameter * cell->measure() * cell->measure();
-                          std::vector<double> local_h_K_values (n_q_points);
-                          for (const auto &cell : information_dof_handler.active_cell_iterators())
-                            {
-                              fe_values.reinit (cell);
-                              fe_values.get_function_values (rhs, local_h_K_values);
-
-                              for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
-                                for (unsigned int n=0; n< detector_locations_on_mesh.size(); ++n)
-                                  if (fe_values.quadrature_point(q_point).distance (detector_locations_on_mesh[n]) < 1e-12)
-                                    information_content(K) += local_h_K_values[q_point]
-                                                              * local_h_K_values[q_point]
-                                                              / noise_level[n] / noise_level[n];
-                            }
+                          hanging_node_constraints.condense (evaluation.adjoint_solution);
+                          A_inverse.solve (evaluation.adjoint_solution.block(0),
+                                           /*transpose=*/ true);
+                          hanging_node_constraints.distribute (evaluation.adjoint_solution);
                         }
       );
 
   // And wait:
   tasks.join_all();
 
+  // Finally, evaluate the contributions of the detectors to the information
+  // content of each cell. Each source is active on exactly one cell, so
+  // $g_n^T s_K$ only involves the degrees of freedom of that cell.
+  {
+    FEValues<dim> fe_values (fe, quadrature_formula,
+                             update_values | update_JxW_values);
+    Vector<double> cell_rhs (dofs_per_cell);
+    std::vector<unsigned int> local_dof_indices (dofs_per_cell);
+
+    for (const auto &cell : dof_handler.active_cell_iterators())
+      {
+        fe_values.reinit (cell);
+        cell_rhs = 0;
+
+        for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
+          for (unsigned int i=0; i<dofs_per_cell; ++i)
+            cell_rhs(i) += fe_values[c].value (i,q_point) *
+                           fe_values.JxW(q_point);
+
+        cell->get_dof_indices (local_dof_indices);
+
+        const unsigned int K = cell->active_cell_index();
+        information_content(K) = regularization_parameter * cell->measure() * cell->measure();
+        for (const auto &evaluation : detector_evaluations)
+          {
+            double h_K_value = 0;
+            for (unsigned int i=0; i<dofs_per_cell; ++i)
+              h_K_value += evaluation.adjoint_solution(local_dof_indices[i]) * cell_rhs(i);
+
+            information_content(K) += h_K_value
+                                      * h_K_value
+                                      / noise_level[evaluation.detector]
+                                      / noise_level[evaluation.detector];
+          }
+      }
+  }
+
   std::cout << std::endl;
 }
 
@@ -1,11 +1,31 @@
 #include "BraidFuncs.hh"
 
+#include <cstring>
+
+// Vectors are handed out from the pool of the app whenever possible;
+// only the first few calls actually allocate memory.
+my_Vector *
+allocate_vector(braid_App app)
+{
+  if (app->vector_pool.empty())
+    {
+      my_Vector *u = new(my_Vector);
+      app->eq.reinit_vector(u->data);
+      return u;
+    }
+
+  my_Vector *u = app->vector_pool.back();
+  app->vector_pool.pop_back();
+  return u;
+}
+
 // This advances the solution forward by one time step.
 // First some data is collected from the status struct,
-// namely the start and stop time and the current timestep
-// number. The timestep size $\Delta t$ is calculated,
+// namely the start and stop time, the current timestep
+// number and the level. The timestep size $\Delta t$ is calculated,
 // and the step function from the HeatEquation is used to
-// advance the solution.
+// advance the solution. The HeatEquation reuses the system
+// matrix and its preconditioner for each level and $\Delta t$.
 int my_Step(braid_App        app,
             braid_Vector     ustop,
             braid_Vector     fstop,
@@ -26,11 +46,11 @@ int my_Step(braid_App        app,
 
   deltaT = tstop - tstart;
 
-  dealii::Vector<double>& solution = u->data;
+  HeatEquation<2>::VectorType& solution = u->data;
 
   HeatEquation<2>& heateq = app->eq;
 
-  heateq.step(solution, deltaT, tstart, index);
+  heateq.step(solution, deltaT, tstart, index, level);
 
   return 0;
 }
@@ -39,16 +59,14 @@ int my_Step(braid_App        app,
 // In this function we initialize a vector at an arbitrary time.
 // At this point we don't know anything about what the solution
 // looks like, and we can really initialize to anything, so in
-// this case use reinit to initialize the memory and set the
-// values to zero.
+// this case we take a vector from the pool and the HeatEquation
+// sets its values to zero.
 int
 my_Init(braid_App     app,
         double        t,
         braid_Vector *u_ptr)
 {
-  my_Vector *u = new(my_Vector);
-  int size = app->eq.size();
-  u->data.reinit(size);
+  my_Vector *u = allocate_vector(app);
 
   app->eq.initialize(t, u->data);
 
@@ -58,38 +76,30 @@ my_Init(braid_App     app,
 }
 
 // Here we need to copy the vector u into the vector v. We do this
-// by allocating a new vector, then reinitializing the deal.ii
-// vector to the correct size. The deal.ii reinitialization sets
-// every value to zero, so next we need to iterate over the vector
-// u and copy the values to the new vector v.
+// by taking a vector from the pool and assigning u to it. Both
+// vectors have the same parallel layout, so this only copies the
+// locally owned values.
 int
 my_Clone(braid_App     app,
          braid_Vector  u,
          braid_Vector *v_ptr)
 {
-  UNUSED(app);
-  my_Vector *v = new(my_Vector);
-  int size = u->data.size();
-  v->data.reinit(size);
-  for(size_t i=0, end=v->data.size(); i != end; ++i)
-    {
-      v->data[i] = u->data[i];
-    }
+  my_Vector *v = allocate_vector(app);
+  v->data = u->data;
   *v_ptr = v;
 
   return 0;
 }
 
-// Here we need to free the memory used by vector u. This is
-// pretty simple since the deal.ii vector is stored inside the
-// XBraid vector, so we just delete the XBraid vector u and it
-// puts the deal.ii vector out of scope and releases its memory.
+// Here we need to free the vector u. XBraid frees and allocates
+// vectors all the time, so instead of releasing the memory we put
+// the vector back into the pool of the app. The pool deletes its
+// vectors when the app is deleted.
 int
 my_Free(braid_App    app,
         braid_Vector u)
 {
-  UNUSED(app);
-  delete u;
+  app->vector_pool.push_back(u);
 
   return 0;
 }
@@ -105,7 +115,7 @@ int my_Sum(braid_App app,
            braid_Vector y)
 {
   UNUSED(app);
-  Vector<double>& vec = y->data;
+  HeatEquation<2>::VectorType& vec = y->data;
   vec.sadd(beta, alpha, x->data);
 
   return 0;
@@ -113,7 +123,9 @@ int my_Sum(braid_App app,
 
 // This calculates the spatial norm using the l2 norm. According
 // to XBraid, this could be just about any spatial norm but we'll
-// keep it simple and used deal.ii vector's built in l2_norm method.
+// keep it simple and used deal.ii vector's built in l2_norm method,
+// which includes the parts of the vector owned by the other
+// processes of the spatial group.
 int
 my_SpatialNorm(braid_App     app,
                braid_Vector  u,
@@ -161,7 +173,9 @@ my_Access(braid_App          app,
 // This calculates the size of buffer needed to pack the solution
 // data into a linear buffer for transfer to another processor via
 // MPI. We query the size of the data from the HeatEquation class
-// and return the buffer size.
+// and return the buffer size. Buffers only travel between processes
+// with the same rank in their spatial groups, so only the locally
+// owned part of the vector is sent.
 int
 my_BufSize(braid_App           app,
            int                 *size_ptr,
@@ -169,17 +183,17 @@ my_BufSize(braid_App           app,
 {
   UNUSED(bstatus);
   int size = app->eq.size();
-  *size_ptr = (size+1)*sizeof(double);
+  *size_ptr = size*sizeof(double);
 
   return 0;
 }
 
 // This function packs a linear buffer with data so that the buffer
-// may be sent to another processor via MPI. The buffer is cast to
-// a type we can work with. The first element of the buffer is the
-// size of the buffer. Then we iterate over soltuion vector u and
-// fill the buffer with our solution data. Finally we tell XBraid
-// how much data we wrote.
+// may be sent to another processor via MPI. The locally owned values
+// of a deal.ii vector are stored contiguously, so this is a single
+// memcpy. The size is not written into the buffer since every vector
+// has the same locally owned size, see my_BufSize. Finally we tell
+// XBraid how much data we wrote.
 int
 my_BufPack(braid_App           app,
            braid_Vector        u,
@@ -188,41 +202,26 @@ my_BufPack(braid_App           app,
 {
 
   UNUSED(app);
-  double *dbuffer = (double*)buffer;
-  int size = u->data.size();
-  dbuffer[0] = size;
-  for(int i=0; i != size; ++i)
-    {
-      dbuffer[i+1] = (u->data)[i];
-    }
-  braid_BufferStatusSetSize(bstatus, (size+1)*sizeof(double));
+  const int size = u->data.locally_owned_size();
+  std::memcpy(buffer, u->data.begin(), size*sizeof(double));
+  braid_BufferStatusSetSize(bstatus, size*sizeof(double));
 
   return 0;
 }
 
 // This function unpacks a buffer that was recieved from a different
-// processor via MPI. The size of the buffer is read from the first
-// element, then we iterate over the size of the buffer and fill
-// the values of solution vector u with the data in the buffer.
+// processor via MPI. The buffer is copied in one go into the locally
+// owned values of a vector from the pool.
 int
 my_BufUnpack(braid_App           app,
              void               *buffer,
              braid_Vector       *u_ptr,
              braid_BufferStatus  bstatus)
 {
-  UNUSED(app);
   UNUSED(bstatus);
 
-  my_Vector *u = NULL;
-  double *dbuffer = (double*)buffer;
-  int size = static_cast<int>(dbuffer[0]);
-  u = new(my_Vector);
-  u->data.reinit(size);
-
-  for(int i = 0; i != size; ++i)
-    {
-      (u->data)[i] = dbuffer[i+1];
-    }
+  my_Vector *u = allocate_vector(app);
+  std::memcpy(u->data.begin(), buffer, app->eq.size()*sizeof(double));
   *u_ptr = u;
 
   return 0;
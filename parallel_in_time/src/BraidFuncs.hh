@@ -23,29 +23,51 @@
 /*-------- Project --------*/
 #include "HeatEquation.hh"
 
+#include <vector>
+
 // This struct contains all data that changes with time. For now
 // this is just the solution data. When doing AMR this should
 // probably include the triangulization, the sparsity patter,
 // constraints, etc.
 /**
- * \brief Struct that contains the deal.ii vector.
+ * \brief Struct that contains the locally owned part of the
+ * distributed deal.ii vector.
  */
 typedef struct _braid_Vector_struct
 {
-  dealii::Vector<double> data;
+  HeatEquation<2>::VectorType data;
 } my_Vector;
 
 // This struct contains all the data that is unchanging with time.
 /**
- * \brief Struct that contains the HeatEquation and final
- * time step number.
+ * \brief Struct that contains the HeatEquation, final
+ * time step number and the pool of unused vectors.
  */
 typedef struct _braid_App_struct
 {
   HeatEquation<2> eq;
   int final_step;
+
+  // All vectors have the same (fixed) parallel layout, so instead
+  // of deleting the vectors XBraid frees, my_Free keeps them here
+  // for the next my_Init, my_Clone or my_BufUnpack to reuse.
+  std::vector<my_Vector*> vector_pool;
+
+  ~_braid_App_struct()
+  {
+    for (my_Vector *v : vector_pool)
+      delete v;
+  }
 } my_App;
 
+/**
+ * \brief Returns a vector with the layout of the solution vector
+ * from the pool of the app, or a new one if the pool is empty.
+ * The values of the vector are not set.
+ */
+my_Vector *
+allocate_vector(braid_App app);
+
 
 /**
  * @brief my_Step - Takes a step in time, advancing the u vector
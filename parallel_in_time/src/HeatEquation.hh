@@ -5,13 +5,20 @@
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/base/function.h>
 #include <deal.II/base/logstream.h>
+#include <deal.II/base/index_set.h>
+#include <deal.II/base/mpi.h>
 #include <deal.II/lac/vector.h>
 #include <deal.II/lac/full_matrix.h>
 #include <deal.II/lac/dynamic_sparsity_pattern.h>
-#include <deal.II/lac/sparse_matrix.h>
+#include <deal.II/lac/sparsity_tools.h>
+#include <deal.II/lac/solver_gmres.h>
 #include <deal.II/lac/solver_cg.h>
-#include <deal.II/lac/precondition.h>
 #include <deal.II/lac/affine_constraints.h>
+#include <deal.II/lac/trilinos_precondition.h>
+#include <deal.II/lac/trilinos_solver.h>
+#include <deal.II/lac/trilinos_sparse_matrix.h>
+#include <deal.II/lac/trilinos_vector.h>
+#include <deal.II/distributed/tria.h>
 #include <deal.II/grid/tria.h>
 #include <deal.II/grid/grid_generator.h>
 #include <deal.II/grid/grid_refinement.h>
@@ -31,6 +38,9 @@
 #include <deal.II/base/convergence_table.h>
 
 #include <fstream>
+#include <map>
+#include <memory>
+#include <vector>
 
 using namespace dealii;
 
@@ -38,46 +48,90 @@ using namespace dealii;
 // solver for the heat equation. It contains all the functions
 // needed to define the problem domain and advance the solution
 // in time.
+//
+// The mesh is distributed over the spatial communicator given to
+// define(), so each time step is itself a parallel computation.
+// XBraid only ever sees the locally owned part of a solution
+// vector: the processes of one spatial group each hold their own
+// slice, and buffers are exchanged between processes with the
+// same spatial rank in different temporal groups.
 template <int dim>
 class HeatEquation
 {
 public:
+  typedef TrilinosWrappers::MPI::Vector VectorType;
+
   HeatEquation();
-  void define();
-  void step(Vector<double>& braid_data,
+  void define(const MPI_Comm a_spatial_comm = MPI_COMM_WORLD);
+  void step(VectorType& braid_data,
             double deltaT,
             double a_time,
-            int a_time_idx);
+            int a_time_idx,
+            int a_level = 0);
 
-  int size() const; /// Returns the size of the solution vector
+  int size() const; /// Returns the locally owned size of the solution vector
 
   void output_results(int a_time_idx,
                       double a_time,
-                      Vector<double>& a_solution) const;
+                      const VectorType& a_solution) const;
+
+  /// Gives a_vector the parallel layout of the solution vector
+  void reinit_vector(VectorType& a_vector) const;
 
+  /// Sets a_vector, which must have the layout from reinit_vector,
+  /// to the initial condition
   void initialize(double a_time,
-                  Vector<double>& a_vector) const;
+                  VectorType& a_vector) const;
 
   void process_solution(double a_time,
                         int a_index,
-                        const Vector<double>& a_vector);
+                        const VectorType& a_vector);
 
 private:
+  // The matrix M + theta*deltaT*A of a time step, with the Dirichlet
+  // rows already set, and what is needed to solve with it: an AMG
+  // preconditioner or, for small problems, a direct factorization.
+  // XBraid only uses a few time step sizes (one per level, through
+  // the coarsening factor), so these are set up once per level and
+  // time step size and then reused.
+  struct StepOperator
+  {
+    int                            level;
+    double                         deltaT;
+    TrilinosWrappers::SparseMatrix matrix;
+    std::unique_ptr<TrilinosWrappers::PreconditionAMG> preconditioner;
+    SolverControl                  direct_solver_control;
+    std::unique_ptr<TrilinosWrappers::SolverDirect>    direct_solver;
+  };
+
   void setup_system();
-  void solve_time_step(Vector<double>& a_solution);
+  void assemble_matrices();
+  StepOperator& get_step_operator(int a_level,
+                                  double deltaT,
+                                  const std::map<types::global_dof_index, double>& boundary_values);
+  void solve_time_step(StepOperator& step_operator,
+                       VectorType& a_solution);
 
-  Triangulation<dim>   triangulation;
+  MPI_Comm             spatial_comm;
+
+  std::unique_ptr<parallel::distributed::Triangulation<dim> > triangulation;
   FE_Q<dim>            fe;
   DoFHandler<dim>      dof_handler;
 
+  IndexSet             locally_owned_dofs;
+  IndexSet             locally_relevant_dofs;
+
   AffineConstraints<double> constraints;
 
-  SparsityPattern      sparsity_pattern;
-  SparseMatrix<double> mass_matrix;
-  SparseMatrix<double> laplace_matrix;
-  SparseMatrix<double> system_matrix;
+  TrilinosWrappers::SparseMatrix mass_matrix;
+  TrilinosWrappers::SparseMatrix laplace_matrix;
+
+  std::vector<std::unique_ptr<StepOperator> > step_operators;
+  // Problems with at most this many unknowns are solved with a
+  // direct solver instead of AMG preconditioned GMRES
+  const types::global_dof_index max_direct_solver_dofs;
 
-  Vector<double>       system_rhs;
+  VectorType           system_rhs;
 
   std::ofstream        myfile;
 
@@ -86,8 +140,8 @@ private:
   // These were originally in the run() function but because
   // I am splitting the run() function up into define and step
   // they need to become member data
-  Vector<double> tmp;
-  Vector<double> forcing_terms;
+  VectorType tmp;
+  VectorType forcing_terms;
 
   ConvergenceTable convergence_table;
 };
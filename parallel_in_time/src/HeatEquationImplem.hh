@@ -105,26 +105,52 @@ double InitialValuesMFG<dim>::value (const Point<dim> &p,
 template <int dim>
 HeatEquation<dim>::HeatEquation ()
   :
+  spatial_comm(MPI_COMM_WORLD),
   fe(1),
-  dof_handler(triangulation),
+  max_direct_solver_dofs(5000),
   theta(0.5)
 {
 }
 
+template <int dim>
+void HeatEquation<dim>::reinit_vector(VectorType& a_vector) const
+{
+  a_vector.reinit(locally_owned_dofs, spatial_comm);
+}
+
 template <int dim>
 void HeatEquation<dim>::initialize(double a_time,
-                                   Vector<double>& a_vector) const
+                                   VectorType& a_vector) const
 {
+  // a_vector already has the layout given by reinit_vector,
+  // but it may have been used before
+  Assert(a_vector.locally_owned_size() == locally_owned_dofs.n_elements(),
+         ExcDimensionMismatch(a_vector.locally_owned_size(),
+                              locally_owned_dofs.n_elements()));
+  a_vector = 0;
 #if DO_MFG
-  // We only initialize values in the manufactured solution case
+  // We only initialize values in the manufactured solution case.
+  // VectorTools::project only works on distributed meshes for
+  // matrix-free vectors, so we do the L2 projection ourselves
+  // with the mass matrix that is stored anyway.
   InitialValuesMFG<dim> iv_function;
   iv_function.set_time(a_time);
-  VectorTools::project (dof_handler, constraints,
-                        QGauss<dim>(fe.degree+1), iv_function,
-                        a_vector);
+
+  VectorType projection_rhs(locally_owned_dofs, spatial_comm);
+  VectorTools::create_right_hand_side(dof_handler,
+                                      QGauss<dim>(fe.degree+1),
+                                      iv_function,
+                                      projection_rhs,
+                                      constraints);
+
+  SolverControl solver_control(1000, 1e-12 * projection_rhs.l2_norm());
+  SolverCG<VectorType> cg(solver_control);
+  TrilinosWrappers::PreconditionJacobi preconditioner;
+  preconditioner.initialize(mass_matrix);
+  cg.solve(mass_matrix, a_vector, projection_rhs, preconditioner);
+  constraints.distribute(a_vector);
 #else
   UNUSED(a_time);
-  UNUSED(a_vector);
 #endif // DO_MFG
   // If not the MFG solution case, a_vector is already zero'd so do nothing
 }
@@ -134,44 +160,160 @@ void HeatEquation<dim>::setup_system()
 {
   dof_handler.distribute_dofs(fe);
 
+  locally_owned_dofs = dof_handler.locally_owned_dofs();
+  DoFTools::extract_locally_relevant_dofs(dof_handler,
+                                          locally_relevant_dofs);
+
   constraints.clear ();
+  constraints.reinit (locally_relevant_dofs);
   DoFTools::make_hanging_node_constraints (dof_handler,
                                            constraints);
   constraints.close();
 
-  DynamicSparsityPattern dsp(dof_handler.n_dofs());
+  DynamicSparsityPattern dsp(locally_relevant_dofs);
   DoFTools::make_sparsity_pattern(dof_handler,
                                   dsp,
                                   constraints,
                                   /*keep_constrained_dofs = */ true);
-  sparsity_pattern.copy_from(dsp);
+  SparsityTools::distribute_sparsity_pattern(dsp,
+                                             locally_owned_dofs,
+                                             spatial_comm,
+                                             locally_relevant_dofs);
 
-  mass_matrix.reinit(sparsity_pattern);
-  laplace_matrix.reinit(sparsity_pattern);
-  system_matrix.reinit(sparsity_pattern);
+  mass_matrix.reinit(locally_owned_dofs, locally_owned_dofs,
+                     dsp, spatial_comm);
+  laplace_matrix.reinit(locally_owned_dofs, locally_owned_dofs,
+                        dsp, spatial_comm);
+  step_operators.clear();
 
-  MatrixCreator::create_mass_matrix(dof_handler,
-                                    QGauss<dim>(fe.degree+1),
-                                    mass_matrix);
-  MatrixCreator::create_laplace_matrix(dof_handler,
-                                       QGauss<dim>(fe.degree+1),
-                                       laplace_matrix);
+  assemble_matrices();
 
-  system_rhs.reinit(dof_handler.n_dofs());
+  system_rhs.reinit(locally_owned_dofs, spatial_comm);
+}
+
+// The MatrixCreator functions only work on the whole mesh, so
+// the mass and Laplace matrices are assembled here on the
+// locally owned cells, as in step-40.
+template <int dim>
+void HeatEquation<dim>::assemble_matrices()
+{
+  const QGauss<dim> quadrature_formula(fe.degree+1);
+  FEValues<dim> fe_values(fe, quadrature_formula,
+                          update_values | update_gradients |
+                          update_JxW_values);
+
+  const unsigned int dofs_per_cell = fe.n_dofs_per_cell();
+  const unsigned int n_q_points    = quadrature_formula.size();
+
+  FullMatrix<double> cell_mass_matrix(dofs_per_cell, dofs_per_cell);
+  FullMatrix<double> cell_laplace_matrix(dofs_per_cell, dofs_per_cell);
+  std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
+
+  for (const auto &cell : dof_handler.active_cell_iterators())
+    if (cell->is_locally_owned())
+      {
+        cell_mass_matrix = 0;
+        cell_laplace_matrix = 0;
+        fe_values.reinit(cell);
+
+        for (unsigned int q=0; q<n_q_points; ++q)
+          for (unsigned int i=0; i<dofs_per_cell; ++i)
+            for (unsigned int j=0; j<dofs_per_cell; ++j)
+              {
+                cell_mass_matrix(i,j) += fe_values.shape_value(i,q) *
+                                         fe_values.shape_value(j,q) *
+                                         fe_values.JxW(q);
+                cell_laplace_matrix(i,j) += fe_values.shape_grad(i,q) *
+                                            fe_values.shape_grad(j,q) *
+                                            fe_values.JxW(q);
+              }
+
+        cell->get_dof_indices(local_dof_indices);
+        constraints.distribute_local_to_global(cell_mass_matrix,
+                                               local_dof_indices,
+                                               mass_matrix);
+        constraints.distribute_local_to_global(cell_laplace_matrix,
+                                               local_dof_indices,
+                                               laplace_matrix);
+      }
+
+  mass_matrix.compress(VectorOperation::add);
+  laplace_matrix.compress(VectorOperation::add);
 }
 
 
+// Returns the step operator for this level and time step size,
+// setting it up first if this is the first step with them. The
+// time step sizes of one level are computed by XBraid from the
+// time stamps, so they are compared with a relative tolerance.
+//
+// The Dirichlet rows are set by apply_boundary_values, which
+// cannot eliminate the matching columns of a distributed matrix.
+// The system matrix is therefore not symmetric and we use GMRES
+// instead of CG. Which rows are changed and how does not depend on
+// the boundary values, so the matrix can be reused for any time.
 template <int dim>
-void HeatEquation<dim>::solve_time_step(Vector<double>& a_solution)
+typename HeatEquation<dim>::StepOperator&
+HeatEquation<dim>::get_step_operator(int a_level,
+                                     double deltaT,
+                                     const std::map<types::global_dof_index, double>& boundary_values)
 {
-  SolverControl solver_control(1000, 1e-8 * system_rhs.l2_norm());
-  SolverCG<> cg(solver_control);
+  for (auto &step_operator : step_operators)
+    if (step_operator->level == a_level &&
+        std::abs(step_operator->deltaT - deltaT) <= 1e-10 * std::abs(deltaT))
+      return *step_operator;
+
+  step_operators.emplace_back(new StepOperator());
+  StepOperator &step_operator = *step_operators.back();
+  step_operator.level = a_level;
+  step_operator.deltaT = deltaT;
+
+  step_operator.matrix.copy_from(mass_matrix);
+  step_operator.matrix.add(theta * deltaT, laplace_matrix);
+
+  VectorType boundary_solution(locally_owned_dofs, spatial_comm);
+  VectorType boundary_rhs(locally_owned_dofs, spatial_comm);
+  MatrixTools::apply_boundary_values(boundary_values,
+                                     step_operator.matrix,
+                                     boundary_solution,
+                                     boundary_rhs,
+                                     /*eliminate_columns = */ false);
+
+  if (dof_handler.n_dofs() <= max_direct_solver_dofs)
+    {
+      step_operator.direct_solver.reset(
+        new TrilinosWrappers::SolverDirect(step_operator.direct_solver_control));
+      step_operator.direct_solver->initialize(step_operator.matrix);
+    }
+  else
+    {
+      step_operator.preconditioner.reset(new TrilinosWrappers::PreconditionAMG());
+      step_operator.preconditioner->initialize(step_operator.matrix);
+    }
 
-  PreconditionSSOR<> preconditioner;
-  preconditioner.initialize(system_matrix, 1.0);
+  pout() << "Set up the step operator for level " << a_level
+         << " and time step size " << deltaT << std::endl;
 
-  cg.solve(system_matrix, a_solution, system_rhs,
-           preconditioner);
+  return step_operator;
+}
+
+
+template <int dim>
+void HeatEquation<dim>::solve_time_step(StepOperator& step_operator,
+                                        VectorType& a_solution)
+{
+  if (step_operator.direct_solver)
+    {
+      step_operator.direct_solver->solve(a_solution, system_rhs);
+    }
+  else
+    {
+      SolverControl solver_control(1000, 1e-8 * system_rhs.l2_norm());
+      SolverGMRES<VectorType> gmres(solver_control);
+
+      gmres.solve(step_operator.matrix, a_solution, system_rhs,
+                  *step_operator.preconditioner);
+    }
 
   constraints.distribute(a_solution);
 }
@@ -181,52 +323,63 @@ void HeatEquation<dim>::solve_time_step(Vector<double>& a_solution)
 template <int dim>
 void HeatEquation<dim>::output_results(int a_time_idx,
                                        double a_time,
-                                       Vector<double>& a_solution) const
+                                       const VectorType& a_solution) const
 {
 
   DataOutBase::VtkFlags vtk_flags;
   vtk_flags.time = a_time;
   vtk_flags.cycle = a_time_idx;
 
+  // DataOut needs the values on the ghost cells as well
+  VectorType ghosted_solution(locally_owned_dofs,
+                              locally_relevant_dofs,
+                              spatial_comm);
+  ghosted_solution = a_solution;
+
   DataOut<dim> data_out;
   data_out.set_flags(vtk_flags);
 
   data_out.attach_dof_handler(dof_handler);
-  data_out.add_data_vector(a_solution, "U");
+  data_out.add_data_vector(ghosted_solution, "U");
 
   data_out.build_patches();
 
-  const std::string filename = "solution-"
-    + Utilities::int_to_string(a_time_idx, 3) +
-    ".vtk";
-  std::ofstream output(filename.c_str());
-  data_out.write_vtk(output);
+  // Every spatial group writes the time steps it owns, so the
+  // file names only have to differ by the time index.
+  data_out.write_vtu_with_pvtu_record("./", "solution", a_time_idx,
+                                      spatial_comm, 3);
 }
 
 // We define the geometry here, this is called on each processor
 // and doesn't change in time. Once doing AMR, this won't need
 // to exist anymore.
 template <int dim>
-void HeatEquation<dim>::define()
+void HeatEquation<dim>::define(const MPI_Comm a_spatial_comm)
 {
   const unsigned int initial_global_refinement = 6;
 
-  GridGenerator::hyper_L (triangulation);
-  triangulation.refine_global (initial_global_refinement);
+  spatial_comm = a_spatial_comm;
+  triangulation =
+    std::make_unique<parallel::distributed::Triangulation<dim> >(spatial_comm);
+  dof_handler.reinit(*triangulation);
+
+  GridGenerator::hyper_L (*triangulation);
+  triangulation->refine_global (initial_global_refinement);
 
   setup_system();
 
-  tmp.reinit (dof_handler.n_dofs());
-  forcing_terms.reinit (dof_handler.n_dofs());
+  tmp.reinit (locally_owned_dofs, spatial_comm);
+  forcing_terms.reinit (locally_owned_dofs, spatial_comm);
 }
 
 // Here we advance the solution forward in time. This is done
 // the same way as in the loop in step-26's run function.
 template<int dim>
-void HeatEquation<dim>::step(Vector<double>& braid_data,
+void HeatEquation<dim>::step(VectorType& braid_data,
                              double deltaT,
                              double a_time,
-                             int a_time_idx)
+                             int a_time_idx,
+                             int a_level)
 {
   a_time += deltaT;
   ++a_time_idx;
@@ -246,7 +399,8 @@ void HeatEquation<dim>::step(Vector<double>& braid_data,
   VectorTools::create_right_hand_side(dof_handler,
                                       QGauss<dim>(fe.degree+1),
                                       rhs_function,
-                                      tmp);
+                                      tmp,
+                                      constraints);
 
   forcing_terms = tmp;
   forcing_terms *= deltaT * theta;
@@ -255,16 +409,14 @@ void HeatEquation<dim>::step(Vector<double>& braid_data,
   VectorTools::create_right_hand_side(dof_handler,
                                       QGauss<dim>(fe.degree+1),
                                       rhs_function,
-                                      tmp);
+                                      tmp,
+                                      constraints);
 
   forcing_terms.add(deltaT * (1 - theta), tmp);
   system_rhs += forcing_terms;
 
-  system_matrix.copy_from(mass_matrix);
-  system_matrix.add(theta * deltaT, laplace_matrix);
-
-  constraints.condense (system_matrix, system_rhs);
-
+  // The matrices were assembled with the constraints already
+  // applied, so there is nothing to condense here.
   {
 #if DO_MFG
     // If we are doing the method of manufactured solutions
@@ -282,19 +434,30 @@ void HeatEquation<dim>::step(Vector<double>& braid_data,
                                              boundary_values_function,
                                              boundary_values);
 
-    MatrixTools::apply_boundary_values(boundary_values,
-                                       system_matrix,
-                                       braid_data,
-                                       system_rhs);
+    // The Dirichlet rows of the cached matrix are already set, so
+    // only the right hand side and the solution need the boundary
+    // values of this time (as apply_boundary_values would do).
+    StepOperator &step_operator = get_step_operator(a_level, deltaT,
+                                                    boundary_values);
+    for (const auto &boundary_value : boundary_values)
+      if (locally_owned_dofs.is_element(boundary_value.first))
+        {
+          system_rhs(boundary_value.first) =
+            step_operator.matrix.diag_element(boundary_value.first) *
+            boundary_value.second;
+          braid_data(boundary_value.first) = boundary_value.second;
+        }
+    system_rhs.compress(VectorOperation::insert);
+    braid_data.compress(VectorOperation::insert);
+
+    solve_time_step(step_operator, braid_data);
   }
-
-  solve_time_step(braid_data);
 }
 
 template<int dim>
 int HeatEquation<dim>::size() const
 {
-  return dof_handler.n_dofs();
+  return locally_owned_dofs.n_elements();
 }
 
 // This function computes the error for the time step when doing
@@ -305,48 +468,55 @@ int HeatEquation<dim>::size() const
 template<int dim> void
 HeatEquation<dim>::process_solution(double a_time,
                                     int a_index,
-                                    const Vector<double>& a_vector)
+                                    const VectorType& a_vector)
 {
   // Compute the exact value for the manufactured solution case
   ExactValuesMFG<dim> exact_function;
   exact_function.set_time(a_time);
 
-  Vector<double> difference_per_cell (triangulation.n_active_cells());
+  // The errors are integrated on the locally owned cells, which
+  // need the values on their ghost degrees of freedom
+  VectorType ghosted_solution(locally_owned_dofs,
+                              locally_relevant_dofs,
+                              spatial_comm);
+  ghosted_solution = a_vector;
+
+  Vector<double> difference_per_cell (triangulation->n_active_cells());
   VectorTools::integrate_difference(dof_handler,
-                                    a_vector,
+                                    ghosted_solution,
                                     exact_function,
                                     difference_per_cell,
                                     QGauss<dim>(fe.degree+1),
                                     VectorTools::L2_norm);
 
-  const double L2_error = VectorTools::compute_global_error(triangulation,
+  const double L2_error = VectorTools::compute_global_error(*triangulation,
                                                             difference_per_cell,
                                                             VectorTools::L2_norm);
 
   VectorTools::integrate_difference(dof_handler,
-                                    a_vector,
+                                    ghosted_solution,
                                     exact_function,
                                     difference_per_cell,
                                     QGauss<dim>(fe.degree+1),
                                     VectorTools::H1_seminorm);
 
-  const double H1_error = VectorTools::compute_global_error(triangulation,
+  const double H1_error = VectorTools::compute_global_error(*triangulation,
                                                             difference_per_cell,
                                                             VectorTools::H1_seminorm);
 
   const QTrapezoid<1> q_trapez;
   const QIterated<dim> q_iterated (q_trapez, 5);
   VectorTools::integrate_difference (dof_handler,
-                                     a_vector,
+                                     ghosted_solution,
                                      exact_function,
                                      difference_per_cell,
                                      q_iterated,
                                      VectorTools::Linfty_norm);
-  const double Linfty_error = VectorTools::compute_global_error(triangulation,
+  const double Linfty_error = VectorTools::compute_global_error(*triangulation,
                                                                 difference_per_cell,
                                                                 VectorTools::Linfty_norm);
 
-  const unsigned int n_active_cells = triangulation.n_active_cells();
+  const unsigned int n_active_cells = triangulation->n_global_active_cells();
   const unsigned int n_dofs = dof_handler.n_dofs();
 
   pout() << "Cycle " << a_index << ':'
@@ -382,9 +552,13 @@ HeatEquation<dim>::process_solution(double a_time,
   convergence_table.set_tex_format("cells", "r");
   convergence_table.set_tex_format("dofs", "r");
 
-  std::cout << std::endl;
-  convergence_table.write_text(std::cout);
+  // All processes of the spatial group have the same table
+  if (Utilities::MPI::this_mpi_process(spatial_comm) == 0)
+    {
+      std::cout << std::endl;
+      convergence_table.write_text(std::cout);
 
-  std::ofstream error_table_file("tex-conv-table.tex");
-  convergence_table.write_tex(error_table_file);
+      std::ofstream error_table_file("tex-conv-table.tex");
+      convergence_table.write_tex(error_table_file);
+    }
 }
@@ -21,8 +21,10 @@
 #include "HeatEquation.hh"
 #include "Utilities.hh"
 
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <string>
 
 int main(int argc, char *argv[])
 {
@@ -31,13 +33,30 @@ int main(int argc, char *argv[])
       using namespace dealii;
 
       /* Initialize MPI */
-      MPI_Comm      comm; //, comm_x, comm_t;
-      int rank;
+      MPI_Comm      comm, comm_x, comm_t;
+      int rank, n_procs;
       MPI_Init(&argc, &argv);
       comm   = MPI_COMM_WORLD;
       MPI_Comm_rank(comm, &rank);
+      MPI_Comm_size(comm, &n_procs);
       procID = rank;
 
+      // Split the processes into groups of n_procs_x processes, each of
+      // which shares the spatial work of the time steps it owns. The
+      // number of processes per spatial group is the (optional) first
+      // command line argument; the default of one process is parallel
+      // in time only.
+      int n_procs_x = 1;
+      if (argc > 1)
+        n_procs_x = std::atoi(argv[1]);
+      AssertThrow(n_procs_x > 0 && n_procs % n_procs_x == 0,
+                  ExcMessage("The number of processes (" +
+                             std::to_string(n_procs) +
+                             ") must be a multiple of the number of "
+                             "processes per spatial group (" +
+                             std::to_string(n_procs_x) + ")."));
+      braid_SplitCommworld(&comm, n_procs_x, &comm_x, &comm_t);
+
       // Set up X-Braid
       /* Initialize Braid */
       braid_Core core;
@@ -46,7 +65,7 @@ int main(int argc, char *argv[])
       int    ntime = 10;
       my_App *app = new(my_App);
 
-      braid_Init(MPI_COMM_WORLD, comm, tstart, tstop, ntime, app,
+      braid_Init(MPI_COMM_WORLD, comm_t, tstart, tstop, ntime, app,
                  my_Step, my_Init, my_Clone, my_Free, my_Sum, my_SpatialNorm,
                  my_Access, my_BufSize, my_BufPack, my_BufUnpack, &core);
 
@@ -78,7 +97,7 @@ int main(int argc, char *argv[])
       braid_SetMaxIter(core, max_iter);
       braid_SetSeqSoln(core, use_sequential);
 
-      app->eq.define();
+      app->eq.define(comm_x);
       app->final_step = ntime;
 
       braid_Drive(core);
@@ -89,7 +108,8 @@ int main(int argc, char *argv[])
       delete app;
 
       // Clean up MPI
-      // MPI_Comm_free(&comm);
+      MPI_Comm_free(&comm_x);
+      MPI_Comm_free(&comm_t);
       MPI_Finalize();
     }
   catch (std::exception &exc)
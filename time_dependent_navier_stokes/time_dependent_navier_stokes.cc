@@ -51,6 +51,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 namespace fluid
@@ -392,6 +393,23 @@ namespace fluid
   class BlockSchurPreconditioner : public Subscriptor
   {
   public:
+    // The options for the inner solves. By default the $\tilde{A}$ and
+    // $S_m$ blocks are preconditioned with BoomerAMG and every inner
+    // inverse is computed with a CG solver to a relative tolerance of 1e-6.
+    // If <code>n_inner_applications</code> is nonzero, each inner CG solve
+    // is replaced by that many preconditioned Richardson sweeps, i.e.
+    // a single V-cycle per block if it is 1. The outer FGMRES solver does
+    // not require the preconditioner to be a fixed linear operator, so both
+    // variants are admissible.
+    struct AdditionalData
+    {
+      AdditionalData(const bool use_amg = true,
+                     const unsigned int n_inner_applications = 0);
+
+      bool use_amg;
+      unsigned int n_inner_applications;
+    };
+
     BlockSchurPreconditioner(
       TimerOutput &timer,
       double gamma,
@@ -400,16 +418,27 @@ namespace fluid
       const std::vector<IndexSet> &owned_partitioning,
       const PETScWrappers::MPI::BlockSparseMatrix &system,
       const PETScWrappers::MPI::BlockSparseMatrix &mass,
-      PETScWrappers::MPI::BlockSparseMatrix &schur);
+      PETScWrappers::MPI::BlockSparseMatrix &schur,
+      const AdditionalData &data = AdditionalData());
 
     void vmult(PETScWrappers::MPI::BlockVector &dst,
                const PETScWrappers::MPI::BlockVector &src) const;
 
   private:
+    // Approximately compute <code>dst</code> = <code>matrix</code>$^{-1}$
+    // <code>src</code>, either with CG or with a fixed number of
+    // preconditioner applications, depending on
+    // <code>n_inner_applications</code>.
+    void inner_solve(const PETScWrappers::MPI::SparseMatrix &matrix,
+                     const PETScWrappers::PreconditionBase &preconditioner,
+                     PETScWrappers::MPI::Vector &dst,
+                     const PETScWrappers::MPI::Vector &src) const;
+
     TimerOutput &timer;
     const double gamma;
     const double viscosity;
     const double dt;
+    const AdditionalData data;
 
     const SmartPointer<const PETScWrappers::MPI::BlockSparseMatrix>
       system_matrix;
@@ -422,8 +451,21 @@ namespace fluid
     // but leads to slow convergence in CG solver because it is impossible
     // to apply a preconditioner. We go with the first route.
     const SmartPointer<PETScWrappers::MPI::BlockSparseMatrix> mass_schur;
+
+    // The preconditioners of the three inner solves. They are set up once
+    // in the constructor and reused in every vmult, which matters in
+    // particular for the AMG hierarchies.
+    PETScWrappers::PreconditionBlockJacobi Mp_preconditioner;
+    std::unique_ptr<PETScWrappers::PreconditionBase> Sm_preconditioner;
+    std::unique_ptr<PETScWrappers::PreconditionBase> A_preconditioner;
   };
 
+  BlockSchurPreconditioner::AdditionalData::AdditionalData(
+    const bool use_amg, const unsigned int n_inner_applications)
+    : use_amg(use_amg), n_inner_applications(n_inner_applications)
+  {
+  }
+
   // @sect4{BlockSchurPreconditioner::BlockSchurPreconditioner}
   //
   // Input parameters and system matrix, mass matrix as well as the mass schur
@@ -438,28 +480,137 @@ namespace fluid
     const std::vector<IndexSet> &owned_partitioning,
     const PETScWrappers::MPI::BlockSparseMatrix &system,
     const PETScWrappers::MPI::BlockSparseMatrix &mass,
-    PETScWrappers::MPI::BlockSparseMatrix &schur)
+    PETScWrappers::MPI::BlockSparseMatrix &schur,
+    const AdditionalData &data)
     : timer(timer),
       gamma(gamma),
       viscosity(viscosity),
       dt(dt),
+      data(data),
       system_matrix(&system),
       mass_matrix(&mass),
       mass_schur(&schur)
   {
-    TimerOutput::Scope timer_section(timer, "CG for Sm");
-    // The schur complemete of mass matrix is actually being computed here.
-    PETScWrappers::MPI::BlockVector tmp1, tmp2;
-    tmp1.reinit(owned_partitioning, mass_matrix->get_mpi_communicator());
-    tmp2.reinit(owned_partitioning, mass_matrix->get_mpi_communicator());
-    tmp1 = 1;
-    tmp2 = 0;
-    // Jacobi preconditioner of matrix A is by definition ${diag(A)}^{-1}$,
-    // this is exactly what we want to compute.
-    PETScWrappers::PreconditionJacobi jacobi(mass_matrix->block(0, 0));
-    jacobi.vmult(tmp2.block(0), tmp1.block(0));
-    system_matrix->block(1, 0).mmult(
-      mass_schur->block(1, 1), system_matrix->block(0, 1), tmp2.block(0));
+    {
+      TimerOutput::Scope timer_section(timer, "CG for Sm");
+      // The schur complemete of mass matrix is actually being computed here.
+      PETScWrappers::MPI::BlockVector tmp1, tmp2;
+      tmp1.reinit(owned_partitioning, mass_matrix->get_mpi_communicator());
+      tmp2.reinit(owned_partitioning, mass_matrix->get_mpi_communicator());
+      tmp1 = 1;
+      tmp2 = 0;
+      // Jacobi preconditioner of matrix A is by definition ${diag(A)}^{-1}$,
+      // this is exactly what we want to compute.
+      PETScWrappers::PreconditionJacobi jacobi(mass_matrix->block(0, 0));
+      jacobi.vmult(tmp2.block(0), tmp1.block(0));
+      system_matrix->block(1, 0).mmult(
+        mass_schur->block(1, 1), system_matrix->block(0, 1), tmp2.block(0));
+    }
+
+    // After the mesh is refined, the rows of $B$ that belong to hanging
+    // pressure nodes only contain zeros, and so do the corresponding rows
+    // and columns of $S_m$. The entries are part of the sparsity pattern,
+    // so we can put the average diagonal value there. This decouples those
+    // unknowns without changing the action of $S_m$ on the others, and
+    // makes $S_m$ amenable to Jacobi-type smoothers and AMG.
+    {
+      TimerOutput::Scope timer_section(timer, "Setup preconditioners");
+      PETScWrappers::MPI::SparseMatrix &Sm = mass_schur->block(1, 1);
+      const std::pair<types::global_dof_index, types::global_dof_index> range =
+        Sm.local_range();
+      double local_diagonal_sum = 0.0;
+      unsigned int local_n_nonzero = 0;
+      std::vector<types::global_dof_index> zero_rows;
+      for (types::global_dof_index i = range.first; i < range.second; ++i)
+        {
+          const double d = Sm.diag_element(i);
+          if (d == 0.0)
+            zero_rows.push_back(i);
+          else
+            {
+              local_diagonal_sum += d;
+              ++local_n_nonzero;
+            }
+        }
+      const double diagonal_sum =
+        Utilities::MPI::sum(local_diagonal_sum, Sm.get_mpi_communicator());
+      const unsigned int n_nonzero =
+        Utilities::MPI::sum(local_n_nonzero, Sm.get_mpi_communicator());
+      const double average_diagonal =
+        (n_nonzero > 0 ? diagonal_sum / n_nonzero : 1.0);
+      for (const auto i : zero_rows)
+        Sm.set(i, i, average_diagonal);
+      Sm.compress(VectorOperation::insert);
+
+      Mp_preconditioner.initialize(mass_matrix->block(1, 1));
+
+      if (data.use_amg)
+        {
+          // Both $\tilde{A}$ and $S_m$ are symmetric positive definite.
+          // $\tilde{A}$ is dominated by the velocity mass matrix for small
+          // time steps, and $S_m$ is a discrete pressure Laplacian, so a
+          // single V-cycle is already a good approximate inverse.
+          PETScWrappers::PreconditionBoomerAMG::AdditionalData amg_data;
+          amg_data.symmetric_operator = true;
+          amg_data.strong_threshold = 0.5;
+
+          auto Sm_amg =
+            std::make_unique<PETScWrappers::PreconditionBoomerAMG>();
+          Sm_amg->initialize(Sm, amg_data);
+          Sm_preconditioner = std::move(Sm_amg);
+
+          auto A_amg = std::make_unique<PETScWrappers::PreconditionBoomerAMG>();
+          A_amg->initialize(system_matrix->block(0, 0), amg_data);
+          A_preconditioner = std::move(A_amg);
+        }
+      else
+        {
+          auto Sm_jacobi =
+            std::make_unique<PETScWrappers::PreconditionJacobi>();
+          Sm_jacobi->initialize(Sm);
+          Sm_preconditioner = std::move(Sm_jacobi);
+
+          auto A_none = std::make_unique<PETScWrappers::PreconditionNone>();
+          A_none->initialize(system_matrix->block(0, 0));
+          A_preconditioner = std::move(A_none);
+        }
+    }
+  }
+
+  // @sect4{BlockSchurPreconditioner::inner_solve}
+  //
+  // With the default setting, this is a CG solve to a relative tolerance of
+  // 1e-6. Otherwise we perform a fixed number of Richardson iterations
+  // $x^{k+1} = x^k + P^{-1}(b - Ax^k)$ starting from $x^0 = 0$, so that the
+  // first iteration is just one application of the preconditioner.
+  void BlockSchurPreconditioner::inner_solve(
+    const PETScWrappers::MPI::SparseMatrix &matrix,
+    const PETScWrappers::PreconditionBase &preconditioner,
+    PETScWrappers::MPI::Vector &dst,
+    const PETScWrappers::MPI::Vector &src) const
+  {
+    dst = 0;
+    if (data.n_inner_applications == 0)
+      {
+        SolverControl control(src.size(), 1e-6 * src.l2_norm());
+        PETScWrappers::SolverCG cg(control, matrix.get_mpi_communicator());
+        cg.solve(matrix, dst, src, preconditioner);
+        return;
+      }
+
+    preconditioner.vmult(dst, src);
+    if (data.n_inner_applications > 1)
+      {
+        PETScWrappers::MPI::Vector residual(src);
+        PETScWrappers::MPI::Vector update(src);
+        for (unsigned int k = 1; k < data.n_inner_applications; ++k)
+          {
+            matrix.vmult(residual, dst);
+            residual.sadd(-1.0, 1.0, src);
+            preconditioner.vmult(update, residual);
+            dst += update;
+          }
+      }
   }
 
   // @sect4{BlockSchurPreconditioner::vmult}
@@ -479,32 +630,17 @@ namespace fluid
     // where CG solvers are used for $M_p^{-1}$ and $S_m^{-1}$.
     {
       TimerOutput::Scope timer_section(timer, "CG for Mp");
-      SolverControl mp_control(src.block(1).size(),
-                               1e-6 * src.block(1).l2_norm());
-      PETScWrappers::SolverCG cg_mp(mp_control,
-                                    mass_schur->get_mpi_communicator());
       // $-(\nu + \gamma)M_p^{-1}v_1$
-      PETScWrappers::PreconditionBlockJacobi Mp_preconditioner;
-      Mp_preconditioner.initialize(mass_matrix->block(1, 1));
-      cg_mp.solve(
-        mass_matrix->block(1, 1), tmp, src.block(1), Mp_preconditioner);
+      inner_solve(mass_matrix->block(1, 1), Mp_preconditioner, tmp, src.block(1));
       tmp *= -(viscosity + gamma);
     }
     // $-\frac{1}{dt}S_m^{-1}v_1$
     {
       TimerOutput::Scope timer_section(timer, "CG for Sm");
-      SolverControl sm_control(src.block(1).size(),
-                               1e-6 * src.block(1).l2_norm());
-      PETScWrappers::SolverCG cg_sm(sm_control,
-                                    mass_schur->get_mpi_communicator());
-      // PreconditionBlockJacobi works find on Sm if we do not refine the mesh.
-      // Because after refine_mesh is called, zero entries will be created on
-      // the diagonal (not sure why), which prevents PreconditionBlockJacobi
-      // from being used.
-      PETScWrappers::PreconditionNone Sm_preconditioner;
-      Sm_preconditioner.initialize(mass_schur->block(1, 1));
-      cg_sm.solve(
-        mass_schur->block(1, 1), dst.block(1), src.block(1), Sm_preconditioner);
+      inner_solve(mass_schur->block(1, 1),
+                  *Sm_preconditioner,
+                  dst.block(1),
+                  src.block(1));
       dst.block(1) *= -1 / dt;
     }
     // Adding up these two, we get $\tilde{S}^{-1}v_1$.
@@ -517,19 +653,8 @@ namespace fluid
     // using another CG solver.
     {
       TimerOutput::Scope timer_section(timer, "CG for A");
-      SolverControl a_control(src.block(0).size(),
-                              1e-6 * src.block(0).l2_norm());
-      PETScWrappers::SolverCG cg_a(a_control,
-                                   mass_schur->get_mpi_communicator());
-      // We do not use any preconditioner for this block, which is of course
-      // slow,
-      // only because the performance of the only two preconditioners available
-      // PreconditionBlockJacobi and PreconditionBoomerAMG are even worse than
-      // none.
-      PETScWrappers::PreconditionNone A_preconditioner;
-      A_preconditioner.initialize(system_matrix->block(0, 0));
-      cg_a.solve(
-        system_matrix->block(0, 0), dst.block(0), utmp, A_preconditioner);
+      inner_solve(
+        system_matrix->block(0, 0), *A_preconditioner, dst.block(0), utmp);
     }
   }
 
@@ -549,7 +674,7 @@ namespace fluid
   {
   public:
     InsIMEX(parallel::distributed::Triangulation<dim> &);
-    void run();
+    void run(const unsigned int n_global_refinements = 0);
     ~InsIMEX() { timer.print_summary(); }
 
   private:
@@ -561,6 +686,7 @@ namespace fluid
                                           bool assemble_system);
     void refine_mesh(const unsigned int, const unsigned int);
     void output_results(const unsigned int) const;
+    void write_benchmark_data() const;
     double viscosity;
     double gamma;
     const unsigned int degree;
@@ -608,9 +734,14 @@ namespace fluid
 
     // The BlockSchurPreconditioner for the entire system.
     std::shared_ptr<BlockSchurPreconditioner> preconditioner;
+    // Options of its inner solves: AMG for $\tilde{A}$ and $S_m$, and
+    // inner CG solves rather than a fixed number of V-cycles.
+    BlockSchurPreconditioner::AdditionalData preconditioner_data;
 
     Time time;
     mutable TimerOutput timer;
+    // Total number of GMRES iterations over all time steps.
+    unsigned int n_solver_iterations;
   };
 
   // @sect4{InsIMEX::InsIMEX}
@@ -626,9 +757,11 @@ namespace fluid
       face_quad_formula(degree + 2),
       mpi_communicator(MPI_COMM_WORLD),
       pcout(std::cout, Utilities::MPI::this_mpi_process(mpi_communicator) == 0),
+      preconditioner_data(true, 0),
       time(1e0, 1e-3, 1e-2, 1e-2),
       timer(
-        mpi_communicator, pcout, TimerOutput::never, TimerOutput::wall_times)
+        mpi_communicator, pcout, TimerOutput::never, TimerOutput::wall_times),
+      n_solver_iterations(0)
   {
   }
 
@@ -751,15 +884,23 @@ namespace fluid
   // It can be used to assemble the entire system or only the RHS.
   // An additional option is added to determine whether nonzero
   // constraints or zero constraints should be used.
-  // Note that we only need to assemble the LHS for twice: once with the nonzero
-  // constraint
-  // and once for zero constraint. But we must assemble the RHS at every time
-  // step.
+  // Because the convection term is treated explicitly, the LHS only depends
+  // on the mesh and the time step size, and we only need to assemble it
+  // at the first time step and after the mesh is refined. The nonzero and
+  // zero constraints constrain the same DoFs, so they only differ in their
+  // contributions to the RHS, which we must assemble at every time step.
+  // Inhomogeneous constraints are only taken into account by
+  // AffineConstraints::distribute_local_to_global() if the matrix is
+  // assembled as well, which is why we require this.
   template <int dim>
   void InsIMEX<dim>::assemble(bool use_nonzero_constraints,
                               bool assemble_system)
   {
-    TimerOutput::Scope timer_section(timer, "Assemble system");
+    Assert(assemble_system || !use_nonzero_constraints,
+           ExcMessage("The nonzero constraints can only be applied when "
+                      "the system matrix is assembled as well."));
+    TimerOutput::Scope timer_section(
+      timer, assemble_system ? "Assemble system" : "Assemble rhs");
 
     if (assemble_system)
       {
@@ -918,7 +1059,8 @@ namespace fluid
                                                           owned_partitioning,
                                                           system_matrix,
                                                           mass_matrix,
-                                                          mass_schur));
+                                                          mass_schur,
+                                                          preconditioner_data));
       }
 
     SolverControl solver_control(
@@ -942,13 +1084,13 @@ namespace fluid
 
   // @sect4{InsIMEX::run}
   template <int dim>
-  void InsIMEX<dim>::run()
+  void InsIMEX<dim>::run(const unsigned int n_global_refinements)
   {
     pcout << "Running with PETSc on "
           << Utilities::MPI::n_mpi_processes(mpi_communicator)
           << " MPI rank(s)..." << std::endl;
 
-    triangulation.refine_global(0);
+    triangulation.refine_global(n_global_refinements);
     setup_dofs();
     make_constraints();
     initialize_system();
@@ -971,10 +1113,11 @@ namespace fluid
         solution_increment = 0;
         // Only use nonzero constraints at the very first time step
         bool apply_nonzero_constraints = (time.get_timestep() == 1);
-        // We have to assemble the LHS for the initial two time steps:
-        // once using nonzero_constraints, once using zero_constraints,
-        // as well as the steps imediately after mesh refinement.
-        bool assemble_system = (time.get_timestep() < 3 || refined);
+        // We have to assemble the LHS and set up the preconditioner only at
+        // the very first time step and the steps immediately after mesh
+        // refinement. In all other time steps the matrix and the
+        // preconditioner are reused and only the RHS is assembled.
+        bool assemble_system = (time.get_timestep() == 1 || refined);
         refined = false;
         assemble(apply_nonzero_constraints, assemble_system);
         auto state = solve(apply_nonzero_constraints, assemble_system);
@@ -984,6 +1127,7 @@ namespace fluid
         tmp = present_solution;
         tmp += solution_increment;
         present_solution = tmp;
+        n_solver_iterations += state.first;
         pcout << std::scientific << std::left << " GMRES_ITR = " << std::setw(3)
               << state.first << " GMRES_RES = " << state.second << std::endl;
         // Output
@@ -997,6 +1141,69 @@ namespace fluid
             refined = true;
           }
       }
+
+    write_benchmark_data();
+  }
+
+  // @sect4{InsIMEX::write_benchmark_data}
+  //
+  // For regression testing and scaling studies, the accumulated wall time of
+  // each timer section (the maximum over all processors), the final number
+  // of degrees of freedom, the total number of GMRES iterations and the
+  // peak resident memory of the largest process are written to
+  // <code>benchmark.csv</code>, one <code>step,quantity,value</code> entry
+  // per line.
+  template <int dim>
+  void InsIMEX<dim>::write_benchmark_data() const
+  {
+    const std::map<std::string, double> wall_times =
+      timer.get_summary_data(TimerOutput::total_wall_time);
+    const std::map<std::string, double> n_calls =
+      timer.get_summary_data(TimerOutput::n_calls);
+
+    Utilities::System::MemoryStats stats;
+    Utilities::System::get_memory_stats(stats);
+    const double peak_memory =
+      Utilities::MPI::max(static_cast<double>(stats.VmHWM), mpi_communicator);
+
+    // The timer sections, including those of the inner solves of the
+    // preconditioner, are entered by all processors together, so each of
+    // them reduces over the same sections in the same order.
+    Assert(Utilities::MPI::min(static_cast<unsigned int>(wall_times.size()),
+                               mpi_communicator) ==
+           Utilities::MPI::max(static_cast<unsigned int>(wall_times.size()),
+                               mpi_communicator),
+           ExcMessage("All processors need to have entered the same timer "
+                      "sections."));
+    std::map<std::string, double> max_wall_times;
+    std::map<std::string, double> max_n_calls;
+    for (const auto &section : wall_times)
+      {
+        max_wall_times[section.first] =
+          Utilities::MPI::max(section.second, mpi_communicator);
+        max_n_calls[section.first] =
+          Utilities::MPI::max(n_calls.at(section.first), mpi_communicator);
+      }
+
+    if (Utilities::MPI::this_mpi_process(mpi_communicator) == 0)
+      {
+        const unsigned int step = time.get_timestep();
+        std::ofstream output("benchmark.csv");
+        output << "step,quantity,value" << std::endl
+               << step << ",n_mpi_processes,"
+               << Utilities::MPI::n_mpi_processes(mpi_communicator)
+               << std::endl
+               << step << ",n_dofs," << dof_handler.n_dofs() << std::endl
+               << step << ",n_solver_iterations," << n_solver_iterations
+               << std::endl
+               << step << ",peak_resident_memory_kB," << peak_memory
+               << std::endl;
+        for (const auto &section : max_wall_times)
+          output << step << ",wall_time:" << section.first << ','
+                 << section.second << std::endl
+                 << step << ",n_calls:" << section.first << ','
+                 << max_n_calls.at(section.first) << std::endl;
+      }
   }
 
   // @sect4{InsIMEX::output_result}
@@ -1133,7 +1340,9 @@ int main(int argc, char *argv[])
       parallel::distributed::Triangulation<2> tria(MPI_COMM_WORLD);
       create_triangulation(tria);
       InsIMEX<2> flow(tria);
-      flow.run();
+      // The number of initial global refinements can be given on the
+      // command line to run the same problem at several sizes.
+      flow.run(argc > 1 ? Utilities::string_to_int(argv[1]) : 0);
     }
   catch (std::exception &exc)
     {
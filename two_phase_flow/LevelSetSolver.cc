@@ -26,12 +26,15 @@
 #include <deal.II/lac/sparsity_tools.h>
 #include <deal.II/distributed/tria.h>
 #include <deal.II/distributed/grid_refinement.h>
+#include <deal.II/distributed/solution_transfer.h>
 #include <deal.II/lac/vector.h>
 #include <deal.II/base/convergence_table.h>
 #include <deal.II/base/timer.h>
 #include <deal.II/base/parameter_handler.h>
 #include <deal.II/grid/grid_tools.h>
 #include <deal.II/fe/mapping_q.h>
+#include <deal.II/base/work_stream.h>
+#include <deal.II/grid/filtered_iterator.h>
 
 #include <mpi.h>
 
@@ -39,6 +42,8 @@
 #include <iostream>
 #include <memory>
 
+#include "LocalVectorView.h"
+
 using namespace dealii;
 
 // FLAGS
@@ -68,13 +73,13 @@ public:
   ////////////////////////
   // INITIAL CONDITIONS //
   ////////////////////////
-  void initial_condition(PETScWrappers::MPI::Vector locally_relevant_solution_u,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_vx,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_vy);
-  void initial_condition(PETScWrappers::MPI::Vector locally_relevant_solution_u,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_vx,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_vy,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_vz);
+  void initial_condition(const PETScWrappers::MPI::Vector &locally_relevant_solution_u,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_vx,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_vy);
+  void initial_condition(const PETScWrappers::MPI::Vector &locally_relevant_solution_u,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_vx,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_vy,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_vz);
   /////////////////////////
   // BOUNDARY CONDITIONS //
   /////////////////////////
@@ -83,15 +88,24 @@ public:
   //////////////////
   // SET VELOCITY //
   //////////////////
-  void set_velocity(PETScWrappers::MPI::Vector locally_relevant_solution_vx,
-                    PETScWrappers::MPI::Vector locally_relevant_solution_vy);
-  void set_velocity(PETScWrappers::MPI::Vector locally_relevant_solution_vx,
-                    PETScWrappers::MPI::Vector locally_relevant_solution_vy,
-                    PETScWrappers::MPI::Vector locally_relevant_solution_vz);
+  void set_velocity(const PETScWrappers::MPI::Vector &locally_relevant_solution_vx,
+                    const PETScWrappers::MPI::Vector &locally_relevant_solution_vy);
+  void set_velocity(const PETScWrappers::MPI::Vector &locally_relevant_solution_vx,
+                    const PETScWrappers::MPI::Vector &locally_relevant_solution_vy,
+                    const PETScWrappers::MPI::Vector &locally_relevant_solution_vz);
+  // Read the velocity directly from the given (ghosted) vectors at the current and previous
+  // time step, e.g. the velocity of the NavierStokesSolver, instead of copying it with
+  // set_velocity() at each time step. The vectors are not copied: they have to live as long
+  // as this object and the owner is responsible for updating them and for keeping them on the
+  // current mesh (hence they are not transferred in transfer_solution_after_refinement()).
+  void share_velocity(const std::vector<const PETScWrappers::MPI::Vector *> &locally_relevant_solution_v,
+                      const std::vector<const PETScWrappers::MPI::Vector *> &locally_relevant_solution_v_old);
   ///////////////////////
   // SET AND GET ALPHA //
   ///////////////////////
   void get_unp1(PETScWrappers::MPI::Vector &locally_relevant_solution_u);
+  // read only access to the (ghosted) level set at the current time, i.e. unp1 after nth_time_step()
+  const PETScWrappers::MPI::Vector &get_un() const;
   ///////////////////
   // NTH TIME STEP //
   ///////////////////
@@ -100,6 +114,14 @@ public:
   // SETUP //
   ///////////
   void setup();
+  /////////////////////////
+  // ADAPTIVE REFINEMENT //
+  /////////////////////////
+  // To be called before and after triangulation.execute_coarsening_and_refinement().
+  // The level set (current and old) and the velocity are transferred to the new mesh,
+  // the DOFs, matrices and vectors are set up again. The boundary conditions must be set again.
+  void prepare_for_coarsening_and_refinement();
+  void transfer_solution_after_refinement();
 
   LevelSetSolver (const unsigned int degree_LS,
                   const unsigned int degree_U,
@@ -167,16 +189,62 @@ private:
              const PETScWrappers::MPI::Vector &rhs);
   void save_old_solution();
   void save_old_vel_solution();
-  ///////////////////////
-  // MY PETSC WRAPPERS //
-  ///////////////////////
-  void get_vector_values(PETScWrappers::VectorBase &vector,
-                         const std::vector<types::global_dof_index> &indices,
-                         std::vector<PetscScalar> &values);
-  void get_vector_values(PETScWrappers::VectorBase &vector,
-                         const std::vector<types::global_dof_index> &indices,
-                         std::map<types::global_dof_index, types::global_dof_index> &map_from_Q1_to_Q2,
-                         std::vector<PetscScalar> &values);
+  // the velocity components, either the own copies or the shared vectors
+  const PETScWrappers::MPI::Vector &velocity(const unsigned int component) const;
+  const PETScWrappers::MPI::Vector &old_velocity(const unsigned int component) const;
+  ////////////////////////////////
+  // THREAD PARALLEL ASSEMBLY   //
+  ////////////////////////////////
+  // The cell loops are run with WorkStream: each thread evaluates cells with its own scratch data
+  // and the copy data is distributed to the (PETSc) global objects by one thread at a time.
+  // The PETSc vectors are read only through LocalVectorView since PETSc is not thread safe.
+  typedef FilteredIterator<typename DoFHandler<dim>::active_cell_iterator> LocallyOwnedCellIterator;
+  struct AssemblyScratchData
+  {
+    AssemblyScratchData (const FE_Q<dim> &fe_LS,
+                         const FE_Q<dim> &fe_U,
+                         const Quadrature<dim> &quadrature_formula);
+    AssemblyScratchData (const AssemblyScratchData &scratch_data);
+    FEValues<dim> fe_values_LS;
+    FEValues<dim> fe_values_U;
+    std::vector<types::global_dof_index> local_dof_indices_U;
+    std::vector<double> uqn, uqnm1;
+    std::vector<Tensor<1,dim> > guqn, guqnm1;
+    std::vector<double> vxqn, vyqn, vzqn, vxqnm1, vyqnm1, vzqnm1;
+    std::vector<double> shape_values_LS;
+    std::vector<Tensor<1,dim> > shape_grads_LS;
+  };
+  struct AssemblyCopyData
+  {
+    AssemblyCopyData (const unsigned int dofs_per_cell_LS);
+    std::vector<types::global_dof_index> local_dof_indices_LS;
+    FullMatrix<double> cell_matrix_1, cell_matrix_2, cell_matrix_3, cell_matrix_4, cell_matrix_5, cell_matrix_6;
+    Vector<double> cell_vector;
+    double cell_entropy_mass, cell_volume, cell_min_entropy, cell_max_entropy;
+  };
+  typename DoFHandler<dim>::active_cell_iterator get_cell_U (const LocallyOwnedCellIterator &cell_LS) const;
+  void local_assemble_C_Matrix (const LocallyOwnedCellIterator &cell_LS,
+                                AssemblyScratchData &scratch,
+                                AssemblyCopyData &copy_data);
+  void copy_local_to_global_C_Matrix (const AssemblyCopyData &copy_data);
+  void local_assemble_K_times_vector (const LocallyOwnedCellIterator &cell_LS,
+                                      AssemblyScratchData &scratch,
+                                      AssemblyCopyData &copy_data,
+                                      const LocalVectorView &solution,
+                                      const LocalVectorView &vx,
+                                      const LocalVectorView &vy,
+                                      const LocalVectorView &vz);
+  void local_assemble_EntRes_Matrix (const LocallyOwnedCellIterator &cell_LS,
+                                     AssemblyScratchData &scratch,
+                                     AssemblyCopyData &copy_data,
+                                     const LocalVectorView &un,
+                                     const LocalVectorView &unm1,
+                                     const LocalVectorView &vx,
+                                     const LocalVectorView &vy,
+                                     const LocalVectorView &vz,
+                                     const LocalVectorView &vx_old,
+                                     const LocalVectorView &vy_old,
+                                     const LocalVectorView &vz_old);
 
   MPI_Comm mpi_communicator;
 
@@ -231,6 +299,7 @@ private:
   PETScWrappers::MPI::Vector locally_relevant_solution_vx_old;
   PETScWrappers::MPI::Vector locally_relevant_solution_vy_old;
   PETScWrappers::MPI::Vector locally_relevant_solution_vz_old;
+  std::vector<const PETScWrappers::MPI::Vector *> shared_velocity, shared_velocity_old;
 
   // NON-GHOSTED VECTORS
   PETScWrappers::MPI::Vector uStage1_nonGhosted, uStage2_nonGhosted;
@@ -247,6 +316,10 @@ private:
   // CONSTRAINTS
   AffineConstraints<double> constraints;
 
+  // ADAPTIVE REFINEMENT
+  std::unique_ptr<parallel::distributed::SolutionTransfer<dim,PETScWrappers::MPI::Vector> > solution_transfer_LS;
+  std::unique_ptr<parallel::distributed::SolutionTransfer<dim,PETScWrappers::MPI::Vector> > solution_transfer_U;
+
   // TIME STEPPING
   double time_step;
 
@@ -263,7 +336,16 @@ private:
   ConditionalOStream                pcout;
 
   std::map<types::global_dof_index, types::global_dof_index> map_from_Q1_to_Q2;
-  std::map<types::global_dof_index, std::vector<types::global_dof_index> > sparsity_pattern;
+
+  // LOCAL CSR VIEW OF THE SPARSITY PATTERN (built once in setup).
+  // For the k-th locally owned row, the entries row_start[k],...,row_start[k+1]-1
+  // store the columns in the same order returned by MatGetRow (all the matrices share the same pattern)
+  // as local indices of the LS vectors and, through the Q1 to Q2 map, of the velocity vectors.
+  std::vector<unsigned int> row_start;
+  std::vector<unsigned int> column_local_index_LS;
+  std::vector<unsigned int> column_local_index_U;
+  std::vector<unsigned int> row_local_index_U;
+  std::vector<double>       row_buffer_1, row_buffer_2;
 };
 
 template <int dim>
@@ -311,9 +393,9 @@ LevelSetSolver<dim>::~LevelSetSolver ()
 ////////// INITIAL CONDITIONS //////////
 ////////////////////////////////////////
 template<int dim>
-void LevelSetSolver<dim>::initial_condition (PETScWrappers::MPI::Vector un,
-                                             PETScWrappers::MPI::Vector locally_relevant_solution_vx,
-                                             PETScWrappers::MPI::Vector locally_relevant_solution_vy)
+void LevelSetSolver<dim>::initial_condition (const PETScWrappers::MPI::Vector &un,
+                                             const PETScWrappers::MPI::Vector &locally_relevant_solution_vx,
+                                             const PETScWrappers::MPI::Vector &locally_relevant_solution_vy)
 {
   this->un = un;
   this->locally_relevant_solution_vx = locally_relevant_solution_vx;
@@ -325,10 +407,10 @@ void LevelSetSolver<dim>::initial_condition (PETScWrappers::MPI::Vector un,
 }
 
 template<int dim>
-void LevelSetSolver<dim>::initial_condition (PETScWrappers::MPI::Vector un,
-                                             PETScWrappers::MPI::Vector locally_relevant_solution_vx,
-                                             PETScWrappers::MPI::Vector locally_relevant_solution_vy,
-                                             PETScWrappers::MPI::Vector locally_relevant_solution_vz)
+void LevelSetSolver<dim>::initial_condition (const PETScWrappers::MPI::Vector &un,
+                                             const PETScWrappers::MPI::Vector &locally_relevant_solution_vx,
+                                             const PETScWrappers::MPI::Vector &locally_relevant_solution_vy,
+                                             const PETScWrappers::MPI::Vector &locally_relevant_solution_vz)
 {
   this->un = un;
   this->locally_relevant_solution_vx = locally_relevant_solution_vx;
@@ -356,9 +438,10 @@ void LevelSetSolver<dim>::set_boundary_conditions(std::vector<types::global_dof_
 ////////// SET VELOCITY //////////
 //////////////////////////////////
 template <int dim>
-void LevelSetSolver<dim>::set_velocity(PETScWrappers::MPI::Vector locally_relevant_solution_vx,
-                                       PETScWrappers::MPI::Vector locally_relevant_solution_vy)
+void LevelSetSolver<dim>::set_velocity(const PETScWrappers::MPI::Vector &locally_relevant_solution_vx,
+                                       const PETScWrappers::MPI::Vector &locally_relevant_solution_vy)
 {
+  Assert(shared_velocity.empty(), ExcMessage("The velocity is shared with other vectors, see share_velocity()"));
   // SAVE OLD SOLUTION
   save_old_vel_solution();
   // update velocity
@@ -367,10 +450,11 @@ void LevelSetSolver<dim>::set_velocity(PETScWrappers::MPI::Vector locally_releva
 }
 
 template <int dim>
-void LevelSetSolver<dim>::set_velocity(PETScWrappers::MPI::Vector locally_relevant_solution_vx,
-                                       PETScWrappers::MPI::Vector locally_relevant_solution_vy,
-                                       PETScWrappers::MPI::Vector locally_relevant_solution_vz)
+void LevelSetSolver<dim>::set_velocity(const PETScWrappers::MPI::Vector &locally_relevant_solution_vx,
+                                       const PETScWrappers::MPI::Vector &locally_relevant_solution_vy,
+                                       const PETScWrappers::MPI::Vector &locally_relevant_solution_vz)
 {
+  Assert(shared_velocity.empty(), ExcMessage("The velocity is shared with other vectors, see share_velocity()"));
   // SAVE OLD SOLUTION
   save_old_vel_solution();
   // update velocity
@@ -379,12 +463,29 @@ void LevelSetSolver<dim>::set_velocity(PETScWrappers::MPI::Vector locally_releva
   this->locally_relevant_solution_vz=locally_relevant_solution_vz;
 }
 
+template <int dim>
+void LevelSetSolver<dim>::share_velocity(const std::vector<const PETScWrappers::MPI::Vector *> &locally_relevant_solution_v,
+                                         const std::vector<const PETScWrappers::MPI::Vector *> &locally_relevant_solution_v_old)
+{
+  AssertDimension(locally_relevant_solution_v.size(),dim);
+  AssertDimension(locally_relevant_solution_v_old.size(),dim);
+  for (unsigned int d=0; d<dim; ++d)
+    Assert(locally_relevant_solution_v[d]->has_ghost_elements()
+           && locally_relevant_solution_v_old[d]->has_ghost_elements(),
+           ExcMessage("The shared velocity has to be given by ghosted vectors"));
+  shared_velocity=locally_relevant_solution_v;
+  shared_velocity_old=locally_relevant_solution_v_old;
+}
+
 ///////////////////////////////////
 ////////// SET AND GET U //////////
 ///////////////////////////////////
 template<int dim>
 void LevelSetSolver<dim>::get_unp1(PETScWrappers::MPI::Vector &unp1) {unp1=this->unp1;}
 
+template<int dim>
+const PETScWrappers::MPI::Vector &LevelSetSolver<dim>::get_un() const {return un;}
+
 // ------------------------------------------------------------------------------- //
 // ------------------------------ COMPUTE SOLUTIONS ------------------------------ //
 // ------------------------------------------------------------------------------- //
@@ -411,6 +512,68 @@ void LevelSetSolver<dim>::nth_time_step()
   save_old_solution();
 }
 
+// ------------------------------------------------------------------------------------ //
+// ------------------------------ ADAPTIVE REFINEMENT ------------------------------ //
+// ------------------------------------------------------------------------------------ //
+template <int dim>
+void LevelSetSolver<dim>::prepare_for_coarsening_and_refinement()
+{
+  solution_transfer_LS.reset(new parallel::distributed::SolutionTransfer<dim,PETScWrappers::MPI::Vector>(dof_handler_LS));
+  std::vector<const PETScWrappers::MPI::Vector *> solutions_LS = {&un, &unm1};
+  solution_transfer_LS->prepare_for_coarsening_and_refinement(solutions_LS);
+  // a shared velocity is transferred by its owner
+  if (shared_velocity.empty())
+    {
+      solution_transfer_U.reset(new parallel::distributed::SolutionTransfer<dim,PETScWrappers::MPI::Vector>(dof_handler_U));
+      std::vector<const PETScWrappers::MPI::Vector *> solutions_U =
+      {&locally_relevant_solution_vx, &locally_relevant_solution_vy};
+      if (dim==3)
+        solutions_U.push_back(&locally_relevant_solution_vz);
+      solution_transfer_U->prepare_for_coarsening_and_refinement(solutions_U);
+    }
+}
+
+template <int dim>
+void LevelSetSolver<dim>::transfer_solution_after_refinement()
+{
+  Assert (solution_transfer_LS && (solution_transfer_U || !shared_velocity.empty()),
+          ExcMessage("prepare_for_coarsening_and_refinement() has to be called before refining the mesh"));
+  // new DOFs, constraints, matrices and vectors
+  setup();
+  // the interpolation is done on non-ghosted vectors
+  std::vector<PETScWrappers::MPI::Vector> solutions_LS(2,PETScWrappers::MPI::Vector(locally_owned_dofs_LS,mpi_communicator));
+  std::vector<PETScWrappers::MPI::Vector *> solutions_LS_ptr = {&solutions_LS[0], &solutions_LS[1]};
+  solution_transfer_LS->interpolate(solutions_LS_ptr);
+  solution_transfer_LS.reset();
+  // the hanging nodes get the values of the constraints
+  for (unsigned int i=0; i<solutions_LS.size(); ++i)
+    constraints.distribute(solutions_LS[i]);
+  un = solutions_LS[0];
+  unm1 = solutions_LS[1];
+  unp1 = solutions_LS[0];
+  if (!shared_velocity.empty())
+    return;
+
+  std::vector<PETScWrappers::MPI::Vector> solutions_U(dim,PETScWrappers::MPI::Vector(locally_owned_dofs_U,mpi_communicator));
+  std::vector<PETScWrappers::MPI::Vector *> solutions_U_ptr;
+  for (unsigned int d=0; d<dim; ++d)
+    solutions_U_ptr.push_back(&solutions_U[d]);
+  solution_transfer_U->interpolate(solutions_U_ptr);
+  solution_transfer_U.reset();
+  AffineConstraints<double> constraints_U;
+  constraints_U.reinit (locally_relevant_dofs_U);
+  DoFTools::make_hanging_node_constraints (dof_handler_U, constraints_U);
+  constraints_U.close ();
+  for (unsigned int d=0; d<dim; ++d)
+    constraints_U.distribute(solutions_U[d]);
+  locally_relevant_solution_vx = solutions_U[0];
+  locally_relevant_solution_vy = solutions_U[1];
+  if (dim==3)
+    locally_relevant_solution_vz = solutions_U[2];
+  // the old velocity is set from the current one in set_velocity()
+  save_old_vel_solution();
+}
+
 // --------------------------------------------------------------------//
 // ------------------------------ SETUP ------------------------------ //
 // --------------------------------------------------------------------//
@@ -602,7 +765,8 @@ void LevelSetSolver<dim>::invert_ML()
   for (; idofs_iter!=locally_owned_dofs_LS.end(); ++idofs_iter)
     {
       int gi = *idofs_iter;
-      inverse_ML_vector(gi) = 1./ML_vector(gi);
+      // the hanging nodes have no mass (their values are set by the constraints)
+      inverse_ML_vector(gi) = (constraints.is_constrained(gi) ? 0. : 1./ML_vector(gi));
     }
   inverse_ML_vector.compress(VectorOperation::insert);
 }
@@ -653,6 +817,84 @@ void LevelSetSolver<dim>::assemble_MC()
   MC_preconditioner.reset(new PETScWrappers::PreconditionBoomerAMG(MC_matrix,PETScWrappers::PreconditionBoomerAMG::AdditionalData(true)));
 }
 
+// ------------------------------------------------------------------------------------ //
+// ------------------------------ THREAD PARALLEL ASSEMBLY ---------------------------- //
+// ------------------------------------------------------------------------------------ //
+template <int dim>
+LevelSetSolver<dim>::AssemblyScratchData::AssemblyScratchData (const FE_Q<dim> &fe_LS,
+    const FE_Q<dim> &fe_U,
+    const Quadrature<dim> &quadrature_formula)
+  :
+  fe_values_LS (fe_LS, quadrature_formula,
+                update_values | update_gradients | update_JxW_values),
+  fe_values_U (fe_U, quadrature_formula, update_values),
+  local_dof_indices_U (fe_U.dofs_per_cell),
+  uqn (quadrature_formula.size()),
+  uqnm1 (quadrature_formula.size()),
+  guqn (quadrature_formula.size()),
+  guqnm1 (quadrature_formula.size()),
+  vxqn (quadrature_formula.size()),
+  vyqn (quadrature_formula.size()),
+  vzqn (quadrature_formula.size()),
+  vxqnm1 (quadrature_formula.size()),
+  vyqnm1 (quadrature_formula.size()),
+  vzqnm1 (quadrature_formula.size()),
+  shape_values_LS (fe_LS.dofs_per_cell),
+  shape_grads_LS (fe_LS.dofs_per_cell)
+{}
+
+template <int dim>
+LevelSetSolver<dim>::AssemblyScratchData::AssemblyScratchData (const AssemblyScratchData &scratch_data)
+  :
+  fe_values_LS (scratch_data.fe_values_LS.get_fe(),
+                scratch_data.fe_values_LS.get_quadrature(),
+                scratch_data.fe_values_LS.get_update_flags()),
+  fe_values_U (scratch_data.fe_values_U.get_fe(),
+               scratch_data.fe_values_U.get_quadrature(),
+               scratch_data.fe_values_U.get_update_flags()),
+  local_dof_indices_U (scratch_data.local_dof_indices_U),
+  uqn (scratch_data.uqn),
+  uqnm1 (scratch_data.uqnm1),
+  guqn (scratch_data.guqn),
+  guqnm1 (scratch_data.guqnm1),
+  vxqn (scratch_data.vxqn),
+  vyqn (scratch_data.vyqn),
+  vzqn (scratch_data.vzqn),
+  vxqnm1 (scratch_data.vxqnm1),
+  vyqnm1 (scratch_data.vyqnm1),
+  vzqnm1 (scratch_data.vzqnm1),
+  shape_values_LS (scratch_data.shape_values_LS),
+  shape_grads_LS (scratch_data.shape_grads_LS)
+{}
+
+template <int dim>
+LevelSetSolver<dim>::AssemblyCopyData::AssemblyCopyData (const unsigned int dofs_per_cell_LS)
+  :
+  local_dof_indices_LS (dofs_per_cell_LS),
+  cell_matrix_1 (dofs_per_cell_LS, dofs_per_cell_LS),
+  cell_matrix_2 (dofs_per_cell_LS, dofs_per_cell_LS),
+  cell_matrix_3 (dofs_per_cell_LS, dofs_per_cell_LS),
+  cell_matrix_4 (dofs_per_cell_LS, dofs_per_cell_LS),
+  cell_matrix_5 (dofs_per_cell_LS, dofs_per_cell_LS),
+  cell_matrix_6 (dofs_per_cell_LS, dofs_per_cell_LS),
+  cell_vector (dofs_per_cell_LS),
+  cell_entropy_mass (0),
+  cell_volume (0),
+  cell_min_entropy (1E10),
+  cell_max_entropy (-1E10)
+{}
+
+template <int dim>
+typename DoFHandler<dim>::active_cell_iterator
+LevelSetSolver<dim>::get_cell_U (const LocallyOwnedCellIterator &cell_LS) const
+{
+  // both DoFHandlers live on the same triangulation
+  return typename DoFHandler<dim>::active_cell_iterator(&dof_handler_U.get_triangulation(),
+                                                         cell_LS->level(),
+                                                         cell_LS->index(),
+                                                         &dof_handler_U);
+}
+
 // --------------------------------------------------------------------------------------- //
 // ------------------------------ LO METHOD (Dij Viscosity) ------------------------------ //
 // --------------------------------------------------------------------------------------- //
@@ -667,89 +909,97 @@ void LevelSetSolver<dim>::assemble_C_Matrix ()
   CTz_matrix=0;
 
   const QGauss<dim>  quadrature_formula(degree_MAX+1);
-  FEValues<dim> fe_values_LS (fe_LS, quadrature_formula,
-                              update_values    |  update_gradients |
-                              update_quadrature_points |
-                              update_JxW_values);
+  WorkStream::run(LocallyOwnedCellIterator(IteratorFilters::LocallyOwnedCell(), dof_handler_LS.begin_active()),
+                  LocallyOwnedCellIterator(IteratorFilters::LocallyOwnedCell(), dof_handler_LS.end()),
+                  [this](const LocallyOwnedCellIterator &cell_LS, AssemblyScratchData &scratch, AssemblyCopyData &copy_data)
+  {
+    this->local_assemble_C_Matrix(cell_LS,scratch,copy_data);
+  },
+  [this](const AssemblyCopyData &copy_data)
+  {
+    this->copy_local_to_global_C_Matrix(copy_data);
+  },
+  AssemblyScratchData(fe_LS,fe_U,quadrature_formula),
+  AssemblyCopyData(fe_LS.dofs_per_cell));
+  // COMPRESS
+  Cx_matrix.compress(VectorOperation::add);
+  CTx_matrix.compress(VectorOperation::add);
+  Cy_matrix.compress(VectorOperation::add);
+  CTy_matrix.compress(VectorOperation::add);
+  if (dim==3)
+    {
+      Cz_matrix.compress(VectorOperation::add);
+      CTz_matrix.compress(VectorOperation::add);
+    }
+}
 
+template <int dim>
+void LevelSetSolver<dim>::local_assemble_C_Matrix (const LocallyOwnedCellIterator &cell_LS,
+                                                   AssemblyScratchData &scratch,
+                                                   AssemblyCopyData &copy_data)
+{
   const unsigned int   dofs_per_cell_LS = fe_LS.dofs_per_cell;
-  const unsigned int   n_q_points    = quadrature_formula.size();
-
-  FullMatrix<double>   cell_Cij_x (dofs_per_cell_LS, dofs_per_cell_LS);
-  FullMatrix<double>   cell_Cij_y (dofs_per_cell_LS, dofs_per_cell_LS);
-  FullMatrix<double>   cell_Cij_z (dofs_per_cell_LS, dofs_per_cell_LS);
-  FullMatrix<double>   cell_Cji_x (dofs_per_cell_LS, dofs_per_cell_LS);
-  FullMatrix<double>   cell_Cji_y (dofs_per_cell_LS, dofs_per_cell_LS);
-  FullMatrix<double>   cell_Cji_z (dofs_per_cell_LS, dofs_per_cell_LS);
-
-  std::vector<Tensor<1, dim> > shape_grads_LS(dofs_per_cell_LS);
-  std::vector<double> shape_values_LS(dofs_per_cell_LS);
-
-  std::vector<types::global_dof_index> local_dof_indices_LS (dofs_per_cell_LS);
-
-  typename DoFHandler<dim>::active_cell_iterator cell_LS, endc_LS;
-  cell_LS = dof_handler_LS.begin_active();
-  endc_LS = dof_handler_LS.end();
+  const unsigned int   n_q_points    = scratch.fe_values_LS.n_quadrature_points;
+
+  FullMatrix<double> &cell_Cij_x = copy_data.cell_matrix_1;
+  FullMatrix<double> &cell_Cij_y = copy_data.cell_matrix_2;
+  FullMatrix<double> &cell_Cij_z = copy_data.cell_matrix_3;
+  FullMatrix<double> &cell_Cji_x = copy_data.cell_matrix_4;
+  FullMatrix<double> &cell_Cji_y = copy_data.cell_matrix_5;
+  FullMatrix<double> &cell_Cji_z = copy_data.cell_matrix_6;
+  std::vector<double> &shape_values_LS = scratch.shape_values_LS;
+  std::vector<Tensor<1, dim> > &shape_grads_LS = scratch.shape_grads_LS;
+
+  cell_Cij_x = 0;
+  cell_Cij_y = 0;
+  cell_Cji_x = 0;
+  cell_Cji_y = 0;
+  if (dim==3)
+    {
+      cell_Cij_z = 0;
+      cell_Cji_z = 0;
+    }
 
-  for (; cell_LS!=endc_LS; ++cell_LS)
-    if (cell_LS->is_locally_owned())
-      {
-        cell_Cij_x = 0;
-        cell_Cij_y = 0;
-        cell_Cji_x = 0;
-        cell_Cji_y = 0;
-        if (dim==3)
-          {
-            cell_Cij_z = 0;
-            cell_Cji_z = 0;
-          }
+  scratch.fe_values_LS.reinit (cell_LS);
+  cell_LS->get_dof_indices (copy_data.local_dof_indices_LS);
 
-        fe_values_LS.reinit (cell_LS);
-        cell_LS->get_dof_indices (local_dof_indices_LS);
+  for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
+    {
+      const double JxW = scratch.fe_values_LS.JxW(q_point);
+      for (unsigned int i=0; i<dofs_per_cell_LS; ++i)
+        {
+          shape_values_LS[i] = scratch.fe_values_LS.shape_value(i,q_point);
+          shape_grads_LS [i] = scratch.fe_values_LS.shape_grad (i,q_point);
+        }
 
-        for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
+      for (unsigned int i=0; i<dofs_per_cell_LS; ++i)
+        for (unsigned int j=0; j < dofs_per_cell_LS; ++j)
           {
-            const double JxW = fe_values_LS.JxW(q_point);
-            for (unsigned int i=0; i<dofs_per_cell_LS; ++i)
+            cell_Cij_x(i,j) += (shape_grads_LS[j][0])*shape_values_LS[i]*JxW;
+            cell_Cij_y(i,j) += (shape_grads_LS[j][1])*shape_values_LS[i]*JxW;
+            cell_Cji_x(i,j) += (shape_grads_LS[i][0])*shape_values_LS[j]*JxW;
+            cell_Cji_y(i,j) += (shape_grads_LS[i][1])*shape_values_LS[j]*JxW;
+            if (dim==3)
               {
-                shape_values_LS[i] = fe_values_LS.shape_value(i,q_point);
-                shape_grads_LS [i] = fe_values_LS.shape_grad (i,q_point);
+                cell_Cij_z(i,j) += (shape_grads_LS[j][2])*shape_values_LS[i]*JxW;
+                cell_Cji_z(i,j) += (shape_grads_LS[i][2])*shape_values_LS[j]*JxW;
               }
-
-            for (unsigned int i=0; i<dofs_per_cell_LS; ++i)
-              for (unsigned int j=0; j < dofs_per_cell_LS; ++j)
-                {
-                  cell_Cij_x(i,j) += (shape_grads_LS[j][0])*shape_values_LS[i]*JxW;
-                  cell_Cij_y(i,j) += (shape_grads_LS[j][1])*shape_values_LS[i]*JxW;
-                  cell_Cji_x(i,j) += (shape_grads_LS[i][0])*shape_values_LS[j]*JxW;
-                  cell_Cji_y(i,j) += (shape_grads_LS[i][1])*shape_values_LS[j]*JxW;
-                  if (dim==3)
-                    {
-                      cell_Cij_z(i,j) += (shape_grads_LS[j][2])*shape_values_LS[i]*JxW;
-                      cell_Cji_z(i,j) += (shape_grads_LS[i][2])*shape_values_LS[j]*JxW;
-                    }
-                }
-          }
-        // Distribute
-        constraints.distribute_local_to_global(cell_Cij_x,local_dof_indices_LS,Cx_matrix);
-        constraints.distribute_local_to_global(cell_Cji_x,local_dof_indices_LS,CTx_matrix);
-        constraints.distribute_local_to_global(cell_Cij_y,local_dof_indices_LS,Cy_matrix);
-        constraints.distribute_local_to_global(cell_Cji_y,local_dof_indices_LS,CTy_matrix);
-        if (dim==3)
-          {
-            constraints.distribute_local_to_global(cell_Cij_z,local_dof_indices_LS,Cz_matrix);
-            constraints.distribute_local_to_global(cell_Cji_z,local_dof_indices_LS,CTz_matrix);
           }
-      }
-  // COMPRESS
-  Cx_matrix.compress(VectorOperation::add);
-  CTx_matrix.compress(VectorOperation::add);
-  Cy_matrix.compress(VectorOperation::add);
-  CTy_matrix.compress(VectorOperation::add);
+    }
+}
+
+template <int dim>
+void LevelSetSolver<dim>::copy_local_to_global_C_Matrix (const AssemblyCopyData &copy_data)
+{
+  // Distribute
+  constraints.distribute_local_to_global(copy_data.cell_matrix_1,copy_data.local_dof_indices_LS,Cx_matrix);
+  constraints.distribute_local_to_global(copy_data.cell_matrix_4,copy_data.local_dof_indices_LS,CTx_matrix);
+  constraints.distribute_local_to_global(copy_data.cell_matrix_2,copy_data.local_dof_indices_LS,Cy_matrix);
+  constraints.distribute_local_to_global(copy_data.cell_matrix_5,copy_data.local_dof_indices_LS,CTy_matrix);
   if (dim==3)
     {
-      Cz_matrix.compress(VectorOperation::add);
-      CTz_matrix.compress(VectorOperation::add);
+      constraints.distribute_local_to_global(copy_data.cell_matrix_3,copy_data.local_dof_indices_LS,Cz_matrix);
+      constraints.distribute_local_to_global(copy_data.cell_matrix_6,copy_data.local_dof_indices_LS,CTz_matrix);
     }
 }
 
@@ -759,68 +1009,72 @@ void LevelSetSolver<dim>::assemble_K_times_vector(PETScWrappers::MPI::Vector &so
   K_times_solution = 0;
 
   const QGauss<dim>  quadrature_formula(degree_MAX+1);
-  FEValues<dim> fe_values_LS (fe_LS, quadrature_formula,
-                              update_values    |  update_gradients |
-                              update_quadrature_points |
-                              update_JxW_values);
-  FEValues<dim> fe_values_U (fe_U, quadrature_formula,
-                             update_values    |  update_gradients |
-                             update_quadrature_points |
-                             update_JxW_values);
-  const unsigned int   dofs_per_cell = fe_LS.dofs_per_cell;
-  const unsigned int   n_q_points    = quadrature_formula.size();
+  {
+    LocalVectorView soln(solution);
+    LocalVectorView vx(velocity(0));
+    LocalVectorView vy(velocity(1));
+    LocalVectorView vz(velocity(dim-1));
+    WorkStream::run(LocallyOwnedCellIterator(IteratorFilters::LocallyOwnedCell(), dof_handler_LS.begin_active()),
+                    LocallyOwnedCellIterator(IteratorFilters::LocallyOwnedCell(), dof_handler_LS.end()),
+                    [&](const LocallyOwnedCellIterator &cell_LS, AssemblyScratchData &scratch, AssemblyCopyData &copy_data)
+    {
+      this->local_assemble_K_times_vector(cell_LS,scratch,copy_data,soln,vx,vy,vz);
+    },
+    [this](const AssemblyCopyData &copy_data)
+    {
+      // distribute
+      constraints.distribute_local_to_global (copy_data.cell_vector, copy_data.local_dof_indices_LS, K_times_solution);
+    },
+    AssemblyScratchData(fe_LS,fe_U,quadrature_formula),
+    AssemblyCopyData(fe_LS.dofs_per_cell));
+  }
+  K_times_solution.compress(VectorOperation::add);
+}
 
-  Vector<double>       cell_K_times_solution (dofs_per_cell);
+template<int dim>
+void LevelSetSolver<dim>::local_assemble_K_times_vector (const LocallyOwnedCellIterator &cell_LS,
+                                                         AssemblyScratchData &scratch,
+                                                         AssemblyCopyData &copy_data,
+                                                         const LocalVectorView &solution,
+                                                         const LocalVectorView &vx,
+                                                         const LocalVectorView &vy,
+                                                         const LocalVectorView &vz)
+{
+  const unsigned int   dofs_per_cell = fe_LS.dofs_per_cell;
+  const unsigned int   n_q_points    = scratch.fe_values_LS.n_quadrature_points;
 
-  std::vector<Tensor<1,dim> > un_grads (n_q_points);
-  std::vector<double>  old_vx_values (n_q_points);
-  std::vector<double>  old_vy_values (n_q_points);
-  std::vector<double>  old_vz_values (n_q_points);
+  Vector<double> &cell_K_times_solution = copy_data.cell_vector;
+  std::vector<Tensor<1,dim> > &un_grads = scratch.guqn;
+  std::vector<double> &old_vx_values = scratch.vxqn;
+  std::vector<double> &old_vy_values = scratch.vyqn;
+  std::vector<double> &old_vz_values = scratch.vzqn;
 
-  std::vector<double> shape_values(dofs_per_cell);
-  std::vector<Tensor<1,dim> > shape_grads(dofs_per_cell);
+  const typename DoFHandler<dim>::active_cell_iterator cell_U = get_cell_U(cell_LS);
 
-  Vector<double> un_dofs(dofs_per_cell);
+  cell_K_times_solution=0;
 
-  std::vector<types::global_dof_index> indices_LS (dofs_per_cell);
+  scratch.fe_values_LS.reinit (cell_LS);
+  cell_LS->get_dof_indices (copy_data.local_dof_indices_LS);
+  solution.get_function_gradients(scratch.fe_values_LS,copy_data.local_dof_indices_LS,un_grads);
 
-  // loop on cells
-  typename DoFHandler<dim>::active_cell_iterator
-  cell_LS = dof_handler_LS.begin_active(),
-  endc_LS = dof_handler_LS.end();
-  typename DoFHandler<dim>::active_cell_iterator
-  cell_U = dof_handler_U.begin_active();
+  scratch.fe_values_U.reinit (cell_U);
+  cell_U->get_dof_indices (scratch.local_dof_indices_U);
+  vx.get_function_values(scratch.fe_values_U,scratch.local_dof_indices_U,old_vx_values);
+  vy.get_function_values(scratch.fe_values_U,scratch.local_dof_indices_U,old_vy_values);
+  if (dim==3) vz.get_function_values(scratch.fe_values_U,scratch.local_dof_indices_U,old_vz_values);
 
+  // compute cell_K_times_solution
   Tensor<1,dim> v;
-  for (; cell_LS!=endc_LS; ++cell_U, ++cell_LS)
-    if (cell_LS->is_locally_owned())
-      {
-        cell_K_times_solution=0;
-
-        fe_values_LS.reinit (cell_LS);
-        cell_LS->get_dof_indices (indices_LS);
-        fe_values_LS.get_function_gradients(solution,un_grads);
-
-        fe_values_U.reinit (cell_U);
-        fe_values_U.get_function_values(locally_relevant_solution_vx,old_vx_values);
-        fe_values_U.get_function_values(locally_relevant_solution_vy,old_vy_values);
-        if (dim==3) fe_values_U.get_function_values(locally_relevant_solution_vz,old_vz_values);
-
-        // compute cell_K_times_solution
-        for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
-          {
-            v[0] = old_vx_values[q_point];
-            v[1] = old_vy_values[q_point];
-            if (dim==3) v[2] = old_vz_values[q_point]; //dim=3
+  for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
+    {
+      v[0] = old_vx_values[q_point];
+      v[1] = old_vy_values[q_point];
+      if (dim==3) v[2] = old_vz_values[q_point]; //dim=3
 
-            for (unsigned int i=0; i<dofs_per_cell; ++i)
-              cell_K_times_solution(i) += (v*un_grads[q_point])
-                                          *fe_values_LS.shape_value(i,q_point)*fe_values_LS.JxW(q_point);
-          }
-        // distribute
-        constraints.distribute_local_to_global (cell_K_times_solution, indices_LS, K_times_solution);
-      }
-  K_times_solution.compress(VectorOperation::add);
+      for (unsigned int i=0; i<dofs_per_cell; ++i)
+        cell_K_times_solution(i) += (v*un_grads[q_point])
+                                    *scratch.fe_values_LS.shape_value(i,q_point)*scratch.fe_values_LS.JxW(q_point);
+    }
 }
 
 template <int dim>
@@ -841,102 +1095,106 @@ void LevelSetSolver<dim>::assemble_K_DL_DH_times_vector
 
   Tensor<1,dim> vi,vj;
   Tensor<1,dim> C, CT;
-  // loop on locally owned i-DOFs (rows)
-  IndexSet::ElementIterator idofs_iter = locally_owned_dofs_LS.begin();
-
-  for (; idofs_iter!=locally_owned_dofs_LS.end(); ++idofs_iter)
-    {
-      PetscInt gi = *idofs_iter;
-      //double ith_K_times_solution = 0;
-
-      // read velocity of i-th DOF
-      vi[0] = locally_relevant_solution_vx(map_from_Q1_to_Q2[gi]);
-      vi[1] = locally_relevant_solution_vy(map_from_Q1_to_Q2[gi]);
-      if (dim==3) vi[2] = locally_relevant_solution_vz(map_from_Q1_to_Q2[gi]);
-      solni = solution(gi);
-
-      // get i-th row of C matrices
-      MatGetRow(Cx_matrix,gi,&ncolumns,&gj,&Cxi);
-      MatGetRow(Cy_matrix,gi,&ncolumns,&gj,&Cyi);
-      MatGetRow(CTx_matrix,gi,&ncolumns,&gj,&CTxi);
-      MatGetRow(CTy_matrix,gi,&ncolumns,&gj,&CTyi);
-      if (dim==3)
-        {
-          MatGetRow(Cz_matrix,gi,&ncolumns,&gj,&Czi);
-          MatGetRow(CTz_matrix,gi,&ncolumns,&gj,&CTzi);
-        }
-      MatGetRow(EntRes_matrix,gi,&ncolumns,&gj,&EntResi);
-      MatGetRow(SuppSize_matrix,gi,&ncolumns,&gj,&SuppSizei);
-      MatGetRow(MC_matrix,gi,&ncolumns,&gj,&MCi);
-
-      // get vector values for column indices
-      const std::vector<types::global_dof_index> gj_indices (gj,gj+ncolumns);
-      std::vector<double> soln(ncolumns);
-      std::vector<double> vx(ncolumns);
-      std::vector<double> vy(ncolumns);
-      std::vector<double> vz(ncolumns);
-      get_vector_values(solution,gj_indices,soln);
-      get_vector_values(locally_relevant_solution_vx,gj_indices,map_from_Q1_to_Q2,vx);
-      get_vector_values(locally_relevant_solution_vy,gj_indices,map_from_Q1_to_Q2,vy);
-      if (dim==3)
-        get_vector_values(locally_relevant_solution_vz,gj_indices,map_from_Q1_to_Q2,vz);
-
-      // Array for i-th row of matrices
-      std::vector<double> dLi(ncolumns), dCi(ncolumns);
-      double dLii = 0, dCii = 0;
-      // loop on sparsity pattern of i-th DOF
-      for (int j =0; j < ncolumns; ++j)
-        {
-          C[0] = Cxi[j];
-          C[1] = Cyi[j];
-          CT[0]= CTxi[j];
-          CT[1]= CTyi[j];
-          vj[0] = vx[j];
-          vj[1] = vy[j];
-          if (dim==3)
-            {
-              C[2] = Czi[j];
-              CT[2] = CTzi[j];
-              vj[2] = vz[j];
-            }
+  {
+    // raw local arrays of the vectors (the velocity in 2D is not read)
+    LocalVectorView soln(solution);
+    LocalVectorView vx(velocity(0));
+    LocalVectorView vy(velocity(1));
+    LocalVectorView vz(velocity(dim-1));
+    double *dLi = row_buffer_1.data(), *dCi = row_buffer_2.data();
+
+    // loop on locally owned i-DOFs (rows)
+    AssertThrow (locally_owned_dofs_LS.is_contiguous(),
+                 ExcMessage("The rows are addressed as an offset from the first locally owned DoF, which requires a contiguous range of locally owned DoFs."));
+    const PetscInt first_row = (locally_owned_dofs_LS.n_elements()>0) ? *locally_owned_dofs_LS.begin() : 0;
+    for (unsigned int i=0; i<row_start.size()-1; ++i)
+      {
+        const PetscInt gi = first_row + i;
+        //double ith_K_times_solution = 0;
+
+        // read velocity of i-th DOF
+        vi[0] = vx[row_local_index_U[i]];
+        vi[1] = vy[row_local_index_U[i]];
+        if (dim==3) vi[2] = vz[row_local_index_U[i]];
+        solni = soln[i];
+
+        // get i-th row of C matrices
+        MatGetRow(Cx_matrix,gi,&ncolumns,&gj,&Cxi);
+        MatGetRow(Cy_matrix,gi,&ncolumns,&gj,&Cyi);
+        MatGetRow(CTx_matrix,gi,&ncolumns,&gj,&CTxi);
+        MatGetRow(CTy_matrix,gi,&ncolumns,&gj,&CTyi);
+        if (dim==3)
+          {
+            MatGetRow(Cz_matrix,gi,&ncolumns,&gj,&Czi);
+            MatGetRow(CTz_matrix,gi,&ncolumns,&gj,&CTzi);
+          }
+        MatGetRow(EntRes_matrix,gi,&ncolumns,&gj,&EntResi);
+        MatGetRow(SuppSize_matrix,gi,&ncolumns,&gj,&SuppSizei);
+        MatGetRow(MC_matrix,gi,&ncolumns,&gj,&MCi);
+        Assert (static_cast<unsigned int>(ncolumns) == row_start[i+1]-row_start[i], ExcInternalError());
+
+        double dLii = 0, dCii = 0;
+        // loop on sparsity pattern of i-th DOF
+        for (int j =0; j < ncolumns; ++j)
+          {
+            const unsigned int k = row_start[i]+j;
+            C[0] = Cxi[j];
+            C[1] = Cyi[j];
+            CT[0]= CTxi[j];
+            CT[1]= CTyi[j];
+            vj[0] = vx[column_local_index_U[k]];
+            vj[1] = vy[column_local_index_U[k]];
+            if (dim==3)
+              {
+                C[2] = Czi[j];
+                CT[2] = CTzi[j];
+                vj[2] = vz[column_local_index_U[k]];
+              }
+            const double solnj = soln[column_local_index_LS[k]];
 
-          //ith_K_times_solution += soln[j]*(vj*C);
-          if (gi!=gj[j])
-            {
-              // low order dissipative matrix
-              dLi[j] = -std::max(std::abs(vi*C),std::abs(vj*CT));
-              dLii -= dLi[j];
-              // high order dissipative matrix (entropy viscosity)
-              double dEij = -std::min(-dLi[j],
-                                      cE*std::abs(EntResi[j])/(entropy_normalization_factor*MCi[j]/SuppSizei[j]));
-              // high order compression matrix
-              double Compij = cK*std::max(1-std::pow(0.5*(solni+soln[j]),2),0.0)/(std::abs(solni-soln[j])+1E-14);
-              dCi[j] = dEij*std::max(1-Compij,0.0);
-              dCii -= dCi[j];
-            }
-        }
-      // save K times solution vector
-      //K_times_solution(gi)=ith_K_times_solution;
-      // save i-th row of matrices on global matrices
-      MatSetValuesRow(dLij_matrix,gi,&dLi[0]); // BTW: there is a dealii wrapper for this
-      dLij_matrix.set(gi,gi,dLii);
-      MatSetValuesRow(dCij_matrix,gi,&dCi[0]); // BTW: there is a dealii wrapper for this
-      dCij_matrix.set(gi,gi,dCii);
-
-      // Restore matrices after reading rows
-      MatRestoreRow(Cx_matrix,gi,&ncolumns,&gj,&Cxi);
-      MatRestoreRow(Cy_matrix,gi,&ncolumns,&gj,&Cyi);
-      MatRestoreRow(CTx_matrix,gi,&ncolumns,&gj,&CTxi);
-      MatRestoreRow(CTy_matrix,gi,&ncolumns,&gj,&CTyi);
-      if (dim==3)
-        {
-          MatRestoreRow(Cz_matrix,gi,&ncolumns,&gj,&Czi);
-          MatRestoreRow(CTz_matrix,gi,&ncolumns,&gj,&CTzi);
-        }
-      MatRestoreRow(EntRes_matrix,gi,&ncolumns,&gj,&EntResi);
-      MatRestoreRow(SuppSize_matrix,gi,&ncolumns,&gj,&SuppSizei);
-      MatRestoreRow(MC_matrix,gi,&ncolumns,&gj,&MCi);
-    }
+            //ith_K_times_solution += solnj*(vj*C);
+            if (gi!=gj[j])
+              {
+                // low order dissipative matrix
+                dLi[j] = -std::max(std::abs(vi*C),std::abs(vj*CT));
+                dLii -= dLi[j];
+                // high order dissipative matrix (entropy viscosity)
+                double dEij = -std::min(-dLi[j],
+                                        cE*std::abs(EntResi[j])/(entropy_normalization_factor*MCi[j]/SuppSizei[j]));
+                // high order compression matrix
+                double Compij = cK*std::max(1-std::pow(0.5*(solni+solnj),2),0.0)/(std::abs(solni-solnj)+1E-14);
+                dCi[j] = dEij*std::max(1-Compij,0.0);
+                dCii -= dCi[j];
+              }
+            else
+              {
+                dLi[j] = 0;
+                dCi[j] = 0;
+              }
+          }
+        // save K times solution vector
+        //K_times_solution(gi)=ith_K_times_solution;
+        // save i-th row of matrices on global matrices
+        MatSetValuesRow(dLij_matrix,gi,dLi); // BTW: there is a dealii wrapper for this
+        dLij_matrix.set(gi,gi,dLii);
+        MatSetValuesRow(dCij_matrix,gi,dCi); // BTW: there is a dealii wrapper for this
+        dCij_matrix.set(gi,gi,dCii);
+
+        // Restore matrices after reading rows
+        MatRestoreRow(Cx_matrix,gi,&ncolumns,&gj,&Cxi);
+        MatRestoreRow(Cy_matrix,gi,&ncolumns,&gj,&Cyi);
+        MatRestoreRow(CTx_matrix,gi,&ncolumns,&gj,&CTxi);
+        MatRestoreRow(CTy_matrix,gi,&ncolumns,&gj,&CTyi);
+        if (dim==3)
+          {
+            MatRestoreRow(Cz_matrix,gi,&ncolumns,&gj,&Czi);
+            MatRestoreRow(CTz_matrix,gi,&ncolumns,&gj,&CTzi);
+          }
+        MatRestoreRow(EntRes_matrix,gi,&ncolumns,&gj,&EntResi);
+        MatRestoreRow(SuppSize_matrix,gi,&ncolumns,&gj,&SuppSizei);
+        MatRestoreRow(MC_matrix,gi,&ncolumns,&gj,&MCi);
+      }
+  }
   //compress
   //K_times_solution.compress(VectorOperation::insert);
   dLij_matrix.compress(VectorOperation::insert);
@@ -957,112 +1215,34 @@ void LevelSetSolver<dim>::assemble_EntRes_Matrix ()
   SuppSize_matrix=0;
 
   const QGauss<dim>  quadrature_formula(degree_MAX+1);
-  FEValues<dim> fe_values_U (fe_U, quadrature_formula,
-                             update_values    |  update_gradients |
-                             update_quadrature_points |
-                             update_JxW_values);
-  FEValues<dim> fe_values_LS (fe_LS, quadrature_formula,
-                              update_values    |  update_gradients |
-                              update_quadrature_points |
-                              update_JxW_values);
-
-  const unsigned int   dofs_per_cell_LS = fe_LS.dofs_per_cell;
-  const unsigned int   n_q_points    = quadrature_formula.size();
-
-  std::vector<double>  uqn (n_q_points); // un at q point
-  std::vector<double>  uqnm1 (n_q_points);
-  std::vector<Tensor<1,dim> > guqn (n_q_points); //grad of uqn
-  std::vector<Tensor<1,dim> > guqnm1 (n_q_points);
-
-  std::vector<double>  vxqn (n_q_points);
-  std::vector<double>  vyqn (n_q_points);
-  std::vector<double>  vzqn (n_q_points);
-  std::vector<double>  vxqnm1 (n_q_points);
-  std::vector<double>  vyqnm1 (n_q_points);
-  std::vector<double>  vzqnm1 (n_q_points);
-
-  FullMatrix<double>   cell_EntRes (dofs_per_cell_LS, dofs_per_cell_LS);
-  FullMatrix<double>   cell_volume (dofs_per_cell_LS, dofs_per_cell_LS);
-
-  std::vector<Tensor<1, dim> > shape_grads_LS(dofs_per_cell_LS);
-  std::vector<double> shape_values_LS(dofs_per_cell_LS);
-
-  std::vector<types::global_dof_index> local_dof_indices_LS (dofs_per_cell_LS);
-
-  typename DoFHandler<dim>::active_cell_iterator cell_LS, endc_LS;
-  cell_LS = dof_handler_LS.begin_active();
-  endc_LS = dof_handler_LS.end();
-  typename DoFHandler<dim>::active_cell_iterator
-  cell_U = dof_handler_U.begin_active();
 
-  double Rk;
   double max_entropy=-1E10, min_entropy=1E10;
-  double cell_max_entropy, cell_min_entropy;
-  double cell_entropy_mass, entropy_mass=0;
-  double cell_volume_double, volume=0;
-
-  for (; cell_LS!=endc_LS; ++cell_LS, ++cell_U)
-    if (cell_LS->is_locally_owned())
-      {
-        cell_entropy_mass = 0;
-        cell_volume_double = 0;
-        cell_max_entropy = -1E10;
-        cell_min_entropy = 1E10;
-        cell_EntRes = 0;
-        cell_volume = 0;
-
-        // get solutions at quadrature points
-        fe_values_LS.reinit(cell_LS);
-        cell_LS->get_dof_indices (local_dof_indices_LS);
-        fe_values_LS.get_function_values(un,uqn);
-        fe_values_LS.get_function_values(unm1,uqnm1);
-        fe_values_LS.get_function_gradients(un,guqn);
-        fe_values_LS.get_function_gradients(unm1,guqnm1);
-
-        fe_values_U.reinit(cell_U);
-        fe_values_U.get_function_values(locally_relevant_solution_vx,vxqn);
-        fe_values_U.get_function_values(locally_relevant_solution_vy,vyqn);
-        if (dim==3) fe_values_U.get_function_values(locally_relevant_solution_vz,vzqn);
-        fe_values_U.get_function_values(locally_relevant_solution_vx_old,vxqnm1);
-        fe_values_U.get_function_values(locally_relevant_solution_vy_old,vyqnm1);
-        if (dim==3) fe_values_U.get_function_values(locally_relevant_solution_vz_old,vzqnm1);
-
-        for (unsigned int q=0; q<n_q_points; ++q)
-          {
-            Rk = 1./time_step*(ENTROPY(uqn[q])-ENTROPY(uqnm1[q]))
-                 +(vxqn[q]*ENTROPY_GRAD(uqn[q],guqn[q][0])+vyqn[q]*ENTROPY_GRAD(uqn[q],guqn[q][1]))/2.
-                 +(vxqnm1[q]*ENTROPY_GRAD(uqnm1[q],guqnm1[q][0])+vyqnm1[q]*ENTROPY_GRAD(uqnm1[q],guqnm1[q][1]))/2.;
-            if (dim==3)
-              Rk += 0.5*(vzqn[q]*ENTROPY_GRAD(uqn[q],guqn[q][2])+vzqnm1[q]*ENTROPY_GRAD(uqnm1[q],guqnm1[q][2]));
-
-            const double JxW = fe_values_LS.JxW(q);
-            for (unsigned int i=0; i<dofs_per_cell_LS; ++i)
-              {
-                shape_values_LS[i] = fe_values_LS.shape_value(i,q);
-                shape_grads_LS [i] = fe_values_LS.shape_grad (i,q);
-              }
-
-            for (unsigned int i=0; i<dofs_per_cell_LS; ++i)
-              for (unsigned int j=0; j < dofs_per_cell_LS; ++j)
-                {
-                  cell_EntRes (i,j) += Rk*shape_values_LS[i]*shape_values_LS[j]*JxW;
-                  cell_volume (i,j) += JxW;
-                }
-            cell_entropy_mass += ENTROPY(uqn[q])*JxW;
-            cell_volume_double += JxW;
-
-            cell_min_entropy = std::min(cell_min_entropy,ENTROPY(uqn[q]));
-            cell_max_entropy = std::max(cell_max_entropy,ENTROPY(uqn[q]));
-          }
-        entropy_mass += cell_entropy_mass;
-        volume += cell_volume_double;
-
-        min_entropy = std::min(min_entropy,cell_min_entropy);
-        max_entropy = std::max(max_entropy,cell_max_entropy);
-        // Distribute
-        constraints.distribute_local_to_global(cell_EntRes,local_dof_indices_LS,EntRes_matrix);
-        constraints.distribute_local_to_global(cell_volume,local_dof_indices_LS,SuppSize_matrix);
-      }
+  double entropy_mass=0;
+  double volume=0;
+  {
+    LocalVectorView un_view(un), unm1_view(unm1);
+    LocalVectorView vx(velocity(0)), vx_old(old_velocity(0));
+    LocalVectorView vy(velocity(1)), vy_old(old_velocity(1));
+    LocalVectorView vz(velocity(dim-1)), vz_old(old_velocity(dim-1));
+    WorkStream::run(LocallyOwnedCellIterator(IteratorFilters::LocallyOwnedCell(), dof_handler_LS.begin_active()),
+                    LocallyOwnedCellIterator(IteratorFilters::LocallyOwnedCell(), dof_handler_LS.end()),
+                    [&](const LocallyOwnedCellIterator &cell_LS, AssemblyScratchData &scratch, AssemblyCopyData &copy_data)
+    {
+      this->local_assemble_EntRes_Matrix(cell_LS,scratch,copy_data,un_view,unm1_view,vx,vy,vz,vx_old,vy_old,vz_old);
+    },
+    [&](const AssemblyCopyData &copy_data)
+    {
+      entropy_mass += copy_data.cell_entropy_mass;
+      volume += copy_data.cell_volume;
+      min_entropy = std::min(min_entropy,copy_data.cell_min_entropy);
+      max_entropy = std::max(max_entropy,copy_data.cell_max_entropy);
+      // Distribute
+      constraints.distribute_local_to_global(copy_data.cell_matrix_1,copy_data.local_dof_indices_LS,EntRes_matrix);
+      constraints.distribute_local_to_global(copy_data.cell_matrix_2,copy_data.local_dof_indices_LS,SuppSize_matrix);
+    },
+    AssemblyScratchData(fe_LS,fe_U,quadrature_formula),
+    AssemblyCopyData(fe_LS.dofs_per_cell));
+  }
   EntRes_matrix.compress(VectorOperation::add);
   SuppSize_matrix.compress(VectorOperation::add);
   //ENTROPY NORM FACTOR
@@ -1073,6 +1253,94 @@ void LevelSetSolver<dim>::assemble_EntRes_Matrix ()
   entropy_normalization_factor = std::max(std::abs(max_entropy-entropy_mass), std::abs(min_entropy-entropy_mass));
 }
 
+template <int dim>
+void LevelSetSolver<dim>::local_assemble_EntRes_Matrix (const LocallyOwnedCellIterator &cell_LS,
+                                                        AssemblyScratchData &scratch,
+                                                        AssemblyCopyData &copy_data,
+                                                        const LocalVectorView &un,
+                                                        const LocalVectorView &unm1,
+                                                        const LocalVectorView &vx,
+                                                        const LocalVectorView &vy,
+                                                        const LocalVectorView &vz,
+                                                        const LocalVectorView &vx_old,
+                                                        const LocalVectorView &vy_old,
+                                                        const LocalVectorView &vz_old)
+{
+  const unsigned int   dofs_per_cell_LS = fe_LS.dofs_per_cell;
+  const unsigned int   n_q_points    = scratch.fe_values_LS.n_quadrature_points;
+
+  std::vector<double> &uqn = scratch.uqn; // un at q point
+  std::vector<double> &uqnm1 = scratch.uqnm1;
+  std::vector<Tensor<1,dim> > &guqn = scratch.guqn; //grad of uqn
+  std::vector<Tensor<1,dim> > &guqnm1 = scratch.guqnm1;
+  std::vector<double> &vxqn = scratch.vxqn;
+  std::vector<double> &vyqn = scratch.vyqn;
+  std::vector<double> &vzqn = scratch.vzqn;
+  std::vector<double> &vxqnm1 = scratch.vxqnm1;
+  std::vector<double> &vyqnm1 = scratch.vyqnm1;
+  std::vector<double> &vzqnm1 = scratch.vzqnm1;
+  std::vector<double> &shape_values_LS = scratch.shape_values_LS;
+  std::vector<Tensor<1, dim> > &shape_grads_LS = scratch.shape_grads_LS;
+
+  FullMatrix<double> &cell_EntRes = copy_data.cell_matrix_1;
+  FullMatrix<double> &cell_volume = copy_data.cell_matrix_2;
+
+  const typename DoFHandler<dim>::active_cell_iterator cell_U = get_cell_U(cell_LS);
+
+  double Rk;
+  copy_data.cell_entropy_mass = 0;
+  copy_data.cell_volume = 0;
+  copy_data.cell_max_entropy = -1E10;
+  copy_data.cell_min_entropy = 1E10;
+  cell_EntRes = 0;
+  cell_volume = 0;
+
+  // get solutions at quadrature points
+  scratch.fe_values_LS.reinit(cell_LS);
+  cell_LS->get_dof_indices (copy_data.local_dof_indices_LS);
+  un.get_function_values(scratch.fe_values_LS,copy_data.local_dof_indices_LS,uqn);
+  unm1.get_function_values(scratch.fe_values_LS,copy_data.local_dof_indices_LS,uqnm1);
+  un.get_function_gradients(scratch.fe_values_LS,copy_data.local_dof_indices_LS,guqn);
+  unm1.get_function_gradients(scratch.fe_values_LS,copy_data.local_dof_indices_LS,guqnm1);
+
+  scratch.fe_values_U.reinit(cell_U);
+  cell_U->get_dof_indices (scratch.local_dof_indices_U);
+  vx.get_function_values(scratch.fe_values_U,scratch.local_dof_indices_U,vxqn);
+  vy.get_function_values(scratch.fe_values_U,scratch.local_dof_indices_U,vyqn);
+  if (dim==3) vz.get_function_values(scratch.fe_values_U,scratch.local_dof_indices_U,vzqn);
+  vx_old.get_function_values(scratch.fe_values_U,scratch.local_dof_indices_U,vxqnm1);
+  vy_old.get_function_values(scratch.fe_values_U,scratch.local_dof_indices_U,vyqnm1);
+  if (dim==3) vz_old.get_function_values(scratch.fe_values_U,scratch.local_dof_indices_U,vzqnm1);
+
+  for (unsigned int q=0; q<n_q_points; ++q)
+    {
+      Rk = 1./time_step*(ENTROPY(uqn[q])-ENTROPY(uqnm1[q]))
+           +(vxqn[q]*ENTROPY_GRAD(uqn[q],guqn[q][0])+vyqn[q]*ENTROPY_GRAD(uqn[q],guqn[q][1]))/2.
+           +(vxqnm1[q]*ENTROPY_GRAD(uqnm1[q],guqnm1[q][0])+vyqnm1[q]*ENTROPY_GRAD(uqnm1[q],guqnm1[q][1]))/2.;
+      if (dim==3)
+        Rk += 0.5*(vzqn[q]*ENTROPY_GRAD(uqn[q],guqn[q][2])+vzqnm1[q]*ENTROPY_GRAD(uqnm1[q],guqnm1[q][2]));
+
+      const double JxW = scratch.fe_values_LS.JxW(q);
+      for (unsigned int i=0; i<dofs_per_cell_LS; ++i)
+        {
+          shape_values_LS[i] = scratch.fe_values_LS.shape_value(i,q);
+          shape_grads_LS [i] = scratch.fe_values_LS.shape_grad (i,q);
+        }
+
+      for (unsigned int i=0; i<dofs_per_cell_LS; ++i)
+        for (unsigned int j=0; j < dofs_per_cell_LS; ++j)
+          {
+            cell_EntRes (i,j) += Rk*shape_values_LS[i]*shape_values_LS[j]*JxW;
+            cell_volume (i,j) += JxW;
+          }
+      copy_data.cell_entropy_mass += ENTROPY(uqn[q])*JxW;
+      copy_data.cell_volume += JxW;
+
+      copy_data.cell_min_entropy = std::min(copy_data.cell_min_entropy,ENTROPY(uqn[q]));
+      copy_data.cell_max_entropy = std::max(copy_data.cell_max_entropy,ENTROPY(uqn[q]));
+    }
+}
+
 // ------------------------------------------------------------------------------------ //
 // ------------------------------ TO CHECK MAX PRINCIPLE ------------------------------ //
 // ------------------------------------------------------------------------------------ //
@@ -1081,27 +1349,27 @@ void LevelSetSolver<dim>::compute_bounds(PETScWrappers::MPI::Vector &un_solution
 {
   umin_vector = 0;
   umax_vector = 0;
-  // loop on locally owned i-DOFs (rows)
-  IndexSet::ElementIterator idofs_iter = locally_owned_dofs_LS.begin();
-  for (; idofs_iter!=locally_owned_dofs_LS.end(); ++idofs_iter)
-    {
-      int gi = *idofs_iter;
-
-      // get solution at DOFs on the sparsity pattern of i-th DOF
-      std::vector<types::global_dof_index> gj_indices = sparsity_pattern[gi];
-      std::vector<double> soln(gj_indices.size());
-      get_vector_values(un_solution,gj_indices,soln);
-      // compute bounds, ith row of flux matrix, P vectors
-      double mini=1E10, maxi=-1E10;
-      for (unsigned int j =0; j < gj_indices.size(); ++j)
-        {
-          // bounds
-          mini = std::min(mini,soln[j]);
-          maxi = std::max(maxi,soln[j]);
-        }
-      umin_vector(gi) = mini;
-      umax_vector(gi) = maxi;
-    }
+  {
+    LocalVectorView soln(un_solution);
+    PetscScalar *umin, *umax;
+    VecGetArray(umin_vector, &umin);
+    VecGetArray(umax_vector, &umax);
+    // loop on locally owned i-DOFs (rows)
+    for (unsigned int i=0; i<row_start.size()-1; ++i)
+      {
+        // compute bounds on the sparsity pattern of i-th DOF
+        double mini=1E10, maxi=-1E10;
+        for (unsigned int k=row_start[i]; k<row_start[i+1]; ++k)
+          {
+            mini = std::min(mini,soln[column_local_index_LS[k]]);
+            maxi = std::max(maxi,soln[column_local_index_LS[k]]);
+          }
+        umin[i] = mini;
+        umax[i] = maxi;
+      }
+    VecRestoreArray(umin_vector, &umin);
+    VecRestoreArray(umax_vector, &umax);
+  }
   umin_vector.compress(VectorOperation::insert);
   umax_vector.compress(VectorOperation::insert);
 }
@@ -1174,70 +1442,80 @@ void LevelSetSolver<dim>::compute_MPP_uH
  PETScWrappers::MPI::Vector &solution)
 {
   MPP_uH_solution=0;
-  // loop on locally owned i-DOFs (rows)
-  IndexSet::ElementIterator idofs_iter = locally_owned_dofs_LS.begin();
+  AssertThrow (locally_owned_dofs_LS.is_contiguous(),
+               ExcMessage("The rows are addressed as an offset from the first locally owned DoF, which requires a contiguous range of locally owned DoFs."));
+  const PetscInt first_row = (locally_owned_dofs_LS.n_elements()>0) ? *locally_owned_dofs_LS.begin() : 0;
+  const unsigned int n_rows = row_start.size()-1;
 
   PetscInt ncolumns;
   const PetscInt *gj;
   const PetscScalar *MCi, *dLi, *dCi;
   double solni, mi, solLi, solHi;
+  {
+    LocalVectorView soln(solution);
+    LocalVectorView solH(NMPP_uH_solution_ghosted);
+    LocalVectorView solL(MPP_uL_solution_ghosted);
+    LocalVectorView ML(ML_vector);
+    PetscScalar *Rpos, *Rneg;
+    VecGetArray(R_pos_vector_nonGhosted, &Rpos);
+    VecGetArray(R_neg_vector_nonGhosted, &Rneg);
+    // Array for i-th row of matrices
+    double *Ai = row_buffer_1.data();
+
+    // loop on locally owned i-DOFs (rows)
+    for (unsigned int i=0; i<n_rows; ++i)
+      {
+        const PetscInt gi = first_row + i;
+        // read vectors at i-th DOF
+        solni=soln[i];
+        solHi=solH[i];
+        solLi=solL[i];
+        mi=ML[i];
+
+        // get i-th row of matrices
+        MatGetRow(MC_matrix,gi,&ncolumns,&gj,&MCi);
+        MatGetRow(dLij_matrix,gi,&ncolumns,&gj,&dLi);
+        MatGetRow(dCij_matrix,gi,&ncolumns,&gj,&dCi);
+
+        // compute bounds, ith row of flux matrix, P vectors
+        double mini=1E10, maxi=-1E10;
+        double Pposi=0 ,Pnegi=0;
+        for (int j =0; j < ncolumns; ++j)
+          {
+            const unsigned int k = row_start[i]+j;
+            const double solnj = soln[column_local_index_LS[k]];
+            const double solHj = solH[column_local_index_LS[k]];
+            // bounds
+            mini = std::min(mini,solnj);
+            maxi = std::max(maxi,solnj);
+
+            // i-th row of flux matrix A
+            Ai[j] = (((gi==gj[j]) ? 1 : 0)*mi - MCi[j])*(solHj-solnj - (solHi-solni))
+                    +time_step*(dLi[j]-dCi[j])*(solnj-solni);
+
+            // compute P vectors
+            Pposi += Ai[j]*((Ai[j] > 0) ? 1. : 0.);
+            Pnegi += Ai[j]*((Ai[j] < 0) ? 1. : 0.);
+          }
+        // save i-th row of flux matrix A
+        MatSetValuesRow(A_matrix,gi,Ai);
 
-  for (; idofs_iter!=locally_owned_dofs_LS.end(); ++idofs_iter)
-    {
-      int gi = *idofs_iter;
-      // read vectors at i-th DOF
-      solni=solution(gi);
-      solHi=NMPP_uH_solution_ghosted(gi);
-      solLi=MPP_uL_solution_ghosted(gi);
-      mi=ML_vector(gi);
-
-      // get i-th row of matrices
-      MatGetRow(MC_matrix,gi,&ncolumns,&gj,&MCi);
-      MatGetRow(dLij_matrix,gi,&ncolumns,&gj,&dLi);
-      MatGetRow(dCij_matrix,gi,&ncolumns,&gj,&dCi);
-
-      // get vector values for support of i-th DOF
-      const std::vector<types::global_dof_index> gj_indices (gj,gj+ncolumns);
-      std::vector<double> soln(ncolumns);
-      std::vector<double> solH(ncolumns);
-      get_vector_values(solution,gj_indices,soln);
-      get_vector_values(NMPP_uH_solution_ghosted,gj_indices,solH);
-
-      // Array for i-th row of matrices
-      std::vector<double> Ai(ncolumns);
-      // compute bounds, ith row of flux matrix, P vectors
-      double mini=1E10, maxi=-1E10;
-      double Pposi=0 ,Pnegi=0;
-      for (int j =0; j < ncolumns; ++j)
-        {
-          // bounds
-          mini = std::min(mini,soln[j]);
-          maxi = std::max(maxi,soln[j]);
-
-          // i-th row of flux matrix A
-          Ai[j] = (((gi==gj[j]) ? 1 : 0)*mi - MCi[j])*(solH[j]-soln[j] - (solHi-solni))
-                  +time_step*(dLi[j]-dCi[j])*(soln[j]-solni);
-
-          // compute P vectors
-          Pposi += Ai[j]*((Ai[j] > 0) ? 1. : 0.);
-          Pnegi += Ai[j]*((Ai[j] < 0) ? 1. : 0.);
-        }
-      // save i-th row of flux matrix A
-      MatSetValuesRow(A_matrix,gi,&Ai[0]);
-
-      // compute Q vectors
-      double Qposi = mi*(maxi-solLi);
-      double Qnegi = mi*(mini-solLi);
+        // compute Q vectors
+        double Qposi = mi*(maxi-solLi);
+        double Qnegi = mi*(mini-solLi);
 
-      // compute R vectors
-      R_pos_vector_nonGhosted(gi) = ((Pposi==0) ? 1. : std::min(1.0,Qposi/Pposi));
-      R_neg_vector_nonGhosted(gi) = ((Pnegi==0) ? 1. : std::min(1.0,Qnegi/Pnegi));
+        // compute R vectors
+        Rpos[i] = ((Pposi==0) ? 1. : std::min(1.0,Qposi/Pposi));
+        Rneg[i] = ((Pnegi==0) ? 1. : std::min(1.0,Qnegi/Pnegi));
 
-      // Restore matrices after reading rows
-      MatRestoreRow(MC_matrix,gi,&ncolumns,&gj,&MCi);
-      MatRestoreRow(dLij_matrix,gi,&ncolumns,&gj,&dLi);
-      MatRestoreRow(dCij_matrix,gi,&ncolumns,&gj,&dCi);
-    }
+        // Restore matrices after reading rows
+        MatRestoreRow(MC_matrix,gi,&ncolumns,&gj,&MCi);
+        MatRestoreRow(dLij_matrix,gi,&ncolumns,&gj,&dLi);
+        MatRestoreRow(dCij_matrix,gi,&ncolumns,&gj,&dCi);
+      }
+    VecRestoreArray(R_pos_vector_nonGhosted, &Rpos);
+    VecRestoreArray(R_neg_vector_nonGhosted, &Rneg);
+  }
   // compress A matrix
   A_matrix.compress(VectorOperation::insert);
   // compress R vectors
@@ -1250,34 +1528,34 @@ void LevelSetSolver<dim>::compute_MPP_uH
   // compute limiters. NOTE: this is a different loop due to need of i- and j-th entries of R vectors
   const double *Ai;
   double Rposi, Rnegi;
-  idofs_iter=locally_owned_dofs_LS.begin();
-  for (; idofs_iter!=locally_owned_dofs_LS.end(); ++idofs_iter)
-    {
-      int gi = *idofs_iter;
-      Rposi = R_pos_vector(gi);
-      Rnegi = R_neg_vector(gi);
-
-      // get i-th row of A matrix
-      MatGetRow(A_matrix,gi,&ncolumns,&gj,&Ai);
-
-      // get vector values for column indices
-      const std::vector<types::global_dof_index> gj_indices (gj,gj+ncolumns);
-      std::vector<double> Rpos(ncolumns);
-      std::vector<double> Rneg(ncolumns);
-      get_vector_values(R_pos_vector,gj_indices,Rpos);
-      get_vector_values(R_neg_vector,gj_indices,Rneg);
-
-      // Array for i-th row of A_times_L matrix
-      std::vector<double> LxAi(ncolumns);
-      // loop in sparsity pattern of i-th DOF
-      for (int j =0; j < ncolumns; ++j)
-        LxAi[j] = Ai[j] * ((Ai[j]>0) ? std::min(Rposi,Rneg[j]) : std::min(Rnegi,Rpos[j]));
-
-      // save i-th row of LxA
-      MatSetValuesRow(LxA_matrix,gi,&LxAi[0]); // BTW: there is a dealii wrapper for this
-      // restore A matrix after reading it
-      MatRestoreRow(A_matrix,gi,&ncolumns,&gj,&Ai);
-    }
+  {
+    LocalVectorView Rpos(R_pos_vector);
+    LocalVectorView Rneg(R_neg_vector);
+    // Array for i-th row of A_times_L matrix
+    double *LxAi = row_buffer_2.data();
+    for (unsigned int i=0; i<n_rows; ++i)
+      {
+        const PetscInt gi = first_row + i;
+        Rposi = Rpos[i];
+        Rnegi = Rneg[i];
+
+        // get i-th row of A matrix
+        MatGetRow(A_matrix,gi,&ncolumns,&gj,&Ai);
+
+        // loop in sparsity pattern of i-th DOF
+        for (int j =0; j < ncolumns; ++j)
+          {
+            const unsigned int k = row_start[i]+j;
+            LxAi[j] = Ai[j] * ((Ai[j]>0) ? std::min(Rposi,Rneg[column_local_index_LS[k]])
+                                         : std::min(Rnegi,Rpos[column_local_index_LS[k]]));
+          }
+
+        // save i-th row of LxA
+        MatSetValuesRow(LxA_matrix,gi,LxAi); // BTW: there is a dealii wrapper for this
+        // restore A matrix after reading it
+        MatRestoreRow(A_matrix,gi,&ncolumns,&gj,&Ai);
+      }
+  }
   LxA_matrix.compress(VectorOperation::insert);
   LxA_matrix.vmult(MPP_uH_solution,ones_vector);
   MPP_uH_solution.scale(inverse_ML_vector);
@@ -1299,6 +1577,11 @@ void LevelSetSolver<dim>::compute_MPP_uH_with_iterated_FCT
       Akp1_matrix.copy_from(A_matrix);
       LxAkp1_matrix.copy_from(LxA_matrix);
 
+      AssertThrow (locally_owned_dofs_LS.is_contiguous(),
+                   ExcMessage("The rows are addressed as an offset from the first locally owned DoF, which requires a contiguous range of locally owned DoFs."));
+      const PetscInt first_row = (locally_owned_dofs_LS.n_elements()>0) ? *locally_owned_dofs_LS.begin() : 0;
+      const unsigned int n_rows = row_start.size()-1;
+
       // loop in num of FCT iterations
       PetscInt ncolumns;
       const PetscInt *gj;
@@ -1309,47 +1592,54 @@ void LevelSetSolver<dim>::compute_MPP_uH_with_iterated_FCT
           MPP_uLkp1_solution_ghosted = MPP_uH_solution;
           Akp1_matrix.add(-1.0, LxAkp1_matrix); //new matrix to limit: A-LxA
 
-          // loop on locally owned i-DOFs (rows)
-          IndexSet::ElementIterator idofs_iter = locally_owned_dofs_LS.begin();
-          for (; idofs_iter!=locally_owned_dofs_LS.end(); ++idofs_iter)
-            {
-              int gi = *idofs_iter;
-
-              // read vectors at i-th DOF
-              mi=ML_vector(gi);
-              double solLi = MPP_uLkp1_solution_ghosted(gi);
-
-              // get i-th row of matrices
-              MatGetRow(Akp1_matrix,gi,&ncolumns,&gj,&Akp1i);
-              // get vector values for support of i-th DOF
-              const std::vector<types::global_dof_index> gj_indices (gj,gj+ncolumns);
-              std::vector<double> soln(ncolumns);
-              get_vector_values(un_solution,gj_indices,soln);
-
-              // compute bounds, ith row of flux matrix, P vectors
-              double mini=1E10, maxi=-1E10;
-              double Pposi=0 ,Pnegi=0;
-              for (int j =0; j < ncolumns; ++j)
-                {
-                  // bounds
-                  mini = std::min(mini,soln[j]);
-                  maxi = std::max(maxi,soln[j]);
-
-                  // compute P vectors
-                  Pposi += Akp1i[j]*((Akp1i[j] > 0) ? 1. : 0.);
-                  Pnegi += Akp1i[j]*((Akp1i[j] < 0) ? 1. : 0.);
-                }
-              // compute Q vectors
-              double Qposi = mi*(maxi-solLi);
-              double Qnegi = mi*(mini-solLi);
-
-              // compute R vectors
-              R_pos_vector_nonGhosted(gi) = ((Pposi==0) ? 1. : std::min(1.0,Qposi/Pposi));
-              R_neg_vector_nonGhosted(gi) = ((Pnegi==0) ? 1. : std::min(1.0,Qnegi/Pnegi));
-
-              // Restore matrices after reading rows
-              MatRestoreRow(Akp1_matrix,gi,&ncolumns,&gj,&Akp1i);
-            }
+          {
+            LocalVectorView soln(un_solution);
+            LocalVectorView solL(MPP_uLkp1_solution_ghosted);
+            LocalVectorView ML(ML_vector);
+            PetscScalar *Rpos, *Rneg;
+            VecGetArray(R_pos_vector_nonGhosted, &Rpos);
+            VecGetArray(R_neg_vector_nonGhosted, &Rneg);
+
+            // loop on locally owned i-DOFs (rows)
+            for (unsigned int i=0; i<n_rows; ++i)
+              {
+                const PetscInt gi = first_row + i;
+
+                // read vectors at i-th DOF
+                mi=ML[i];
+                double solLi = solL[i];
+
+                // get i-th row of matrices
+                MatGetRow(Akp1_matrix,gi,&ncolumns,&gj,&Akp1i);
+
+                // compute bounds, ith row of flux matrix, P vectors
+                double mini=1E10, maxi=-1E10;
+                double Pposi=0 ,Pnegi=0;
+                for (int j =0; j < ncolumns; ++j)
+                  {
+                    const double solnj = soln[column_local_index_LS[row_start[i]+j]];
+                    // bounds
+                    mini = std::min(mini,solnj);
+                    maxi = std::max(maxi,solnj);
+
+                    // compute P vectors
+                    Pposi += Akp1i[j]*((Akp1i[j] > 0) ? 1. : 0.);
+                    Pnegi += Akp1i[j]*((Akp1i[j] < 0) ? 1. : 0.);
+                  }
+                // compute Q vectors
+                double Qposi = mi*(maxi-solLi);
+                double Qnegi = mi*(mini-solLi);
+
+                // compute R vectors
+                Rpos[i] = ((Pposi==0) ? 1. : std::min(1.0,Qposi/Pposi));
+                Rneg[i] = ((Pnegi==0) ? 1. : std::min(1.0,Qnegi/Pnegi));
+
+                // Restore matrices after reading rows
+                MatRestoreRow(Akp1_matrix,gi,&ncolumns,&gj,&Akp1i);
+              }
+            VecRestoreArray(R_pos_vector_nonGhosted, &Rpos);
+            VecRestoreArray(R_neg_vector_nonGhosted, &Rneg);
+          }
           // compress R vectors
           R_pos_vector_nonGhosted.compress(VectorOperation::insert);
           R_neg_vector_nonGhosted.compress(VectorOperation::insert);
@@ -1359,33 +1649,33 @@ void LevelSetSolver<dim>::compute_MPP_uH_with_iterated_FCT
 
           // compute limiters. NOTE: this is a different loop due to need of i- and j-th entries of R vectors
           double Rposi, Rnegi;
-          idofs_iter=locally_owned_dofs_LS.begin();
-          for (; idofs_iter!=locally_owned_dofs_LS.end(); ++idofs_iter)
-            {
-              int gi = *idofs_iter;
-              Rposi = R_pos_vector(gi);
-              Rnegi = R_neg_vector(gi);
-
-              // get i-th row of Akp1 matrix
-              MatGetRow(Akp1_matrix,gi,&ncolumns,&gj,&Akp1i);
-
-              // get vector values for column indices
-              const std::vector<types::global_dof_index> gj_indices(gj,gj+ncolumns);
-              std::vector<double> Rpos(ncolumns);
-              std::vector<double> Rneg(ncolumns);
-              get_vector_values(R_pos_vector,gj_indices,Rpos);
-              get_vector_values(R_neg_vector,gj_indices,Rneg);
-
-              // Array for i-th row of LxAkp1 matrix
-              std::vector<double> LxAkp1i(ncolumns);
-              for (int j =0; j < ncolumns; ++j)
-                LxAkp1i[j] = Akp1i[j] * ((Akp1i[j]>0) ? std::min(Rposi,Rneg[j]) : std::min(Rnegi,Rpos[j]));
-
-              // save i-th row of LxA
-              MatSetValuesRow(LxAkp1_matrix,gi,&LxAkp1i[0]); // BTW: there is a dealii wrapper for this
-              // restore A matrix after reading it
-              MatRestoreRow(Akp1_matrix,gi,&ncolumns,&gj,&Akp1i);
-            }
+          {
+            LocalVectorView Rpos(R_pos_vector);
+            LocalVectorView Rneg(R_neg_vector);
+            // Array for i-th row of LxAkp1 matrix
+            double *LxAkp1i = row_buffer_2.data();
+            for (unsigned int i=0; i<n_rows; ++i)
+              {
+                const PetscInt gi = first_row + i;
+                Rposi = Rpos[i];
+                Rnegi = Rneg[i];
+
+                // get i-th row of Akp1 matrix
+                MatGetRow(Akp1_matrix,gi,&ncolumns,&gj,&Akp1i);
+
+                for (int j =0; j < ncolumns; ++j)
+                  {
+                    const unsigned int k = row_start[i]+j;
+                    LxAkp1i[j] = Akp1i[j] * ((Akp1i[j]>0) ? std::min(Rposi,Rneg[column_local_index_LS[k]])
+                                                           : std::min(Rnegi,Rpos[column_local_index_LS[k]]));
+                  }
+
+                // save i-th row of LxA
+                MatSetValuesRow(LxAkp1_matrix,gi,LxAkp1i); // BTW: there is a dealii wrapper for this
+                // restore A matrix after reading it
+                MatRestoreRow(Akp1_matrix,gi,&ncolumns,&gj,&Akp1i);
+              }
+          }
           LxAkp1_matrix.compress(VectorOperation::insert);
           LxAkp1_matrix.vmult(MPP_uH_solution,ones_vector);
           MPP_uH_solution.scale(inverse_ML_vector);
@@ -1419,6 +1709,8 @@ void LevelSetSolver<dim>::compute_solution(PETScWrappers::MPI::Vector &unp1,
       pcout << "Error in algorithm" << std::endl;
       abort();
     }
+  // hanging nodes (adaptive meshes)
+  constraints.distribute(unp1);
 }
 
 template<int dim>
@@ -1460,6 +1752,36 @@ void LevelSetSolver<dim>::compute_solution_SSP33(PETScWrappers::MPI::Vector &unp
 template<int dim>
 void LevelSetSolver<dim>::get_sparsity_pattern()
 {
+  // Build the local CSR view once: this resolves, for each column, the position in the local form of
+  // the (ghosted) LS and velocity vectors, so that the row kernels neither allocate nor search.
+  // The local form is [locally owned entries, ghost entries]; this requires contiguous ownership.
+  Assert (locally_owned_dofs_LS.is_contiguous() && locally_owned_dofs_U.is_contiguous(), ExcNotImplemented());
+  IndexSet ghost_indices_LS = locally_relevant_dofs_LS;
+  ghost_indices_LS.subtract_set(locally_owned_dofs_LS);
+  IndexSet ghost_indices_U = locally_relevant_dofs_U;
+  ghost_indices_U.subtract_set(locally_owned_dofs_U);
+  const types::global_dof_index n_owned_LS = locally_owned_dofs_LS.n_elements();
+  const types::global_dof_index n_owned_U = locally_owned_dofs_U.n_elements();
+  const types::global_dof_index first_LS = (n_owned_LS>0) ? *locally_owned_dofs_LS.begin() : 0;
+  const types::global_dof_index first_U = (n_owned_U>0) ? *locally_owned_dofs_U.begin() : 0;
+
+  auto local_index_LS = [&](const types::global_dof_index index) -> unsigned int
+  {
+    return (locally_owned_dofs_LS.is_element(index)) ? index-first_LS :
+           n_owned_LS + ghost_indices_LS.index_within_set(index);
+  };
+  auto local_index_U = [&](const types::global_dof_index index) -> unsigned int
+  {
+    return (locally_owned_dofs_U.is_element(index)) ? index-first_U :
+           n_owned_U + ghost_indices_U.index_within_set(index);
+  };
+
+  row_start.assign(1,0);
+  column_local_index_LS.clear();
+  column_local_index_U.clear();
+  row_local_index_U.clear();
+  unsigned int max_row_length = 0;
+
   // loop on DOFs
   IndexSet::ElementIterator idofs_iter = locally_owned_dofs_LS.begin();
   PetscInt ncolumns;
@@ -1469,11 +1791,20 @@ void LevelSetSolver<dim>::get_sparsity_pattern()
   for (; idofs_iter!=locally_owned_dofs_LS.end(); ++idofs_iter)
     {
       PetscInt gi = *idofs_iter;
+      row_local_index_U.push_back(local_index_U(map_from_Q1_to_Q2[gi]));
       // get i-th row of mass matrix (dummy, I just need the indices gj)
       MatGetRow(MC_matrix,gi,&ncolumns,&gj,&MCi);
-      sparsity_pattern[gi] = std::vector<types::global_dof_index>(gj,gj+ncolumns);
+      for (int j=0; j<ncolumns; ++j)
+        {
+          column_local_index_LS.push_back(local_index_LS(gj[j]));
+          column_local_index_U.push_back(local_index_U(map_from_Q1_to_Q2[gj[j]]));
+        }
+      row_start.push_back(column_local_index_LS.size());
+      max_row_length = std::max(max_row_length, static_cast<unsigned int>(ncolumns));
       MatRestoreRow(MC_matrix,gi,&ncolumns,&gj,&MCi);
     }
+  row_buffer_1.resize(max_row_length);
+  row_buffer_2.resize(max_row_length);
 }
 
 template<int dim>
@@ -1533,96 +1864,20 @@ void LevelSetSolver<dim>::save_old_vel_solution()
     locally_relevant_solution_vz_old = locally_relevant_solution_vz;
 }
 
-// ------------------------------------------------------------------------------- //
-// ------------------------------ MY PETSC WRAPPERS ------------------------------ //
-// ------------------------------------------------------------------------------- //
-template<int dim>
-void LevelSetSolver<dim>::get_vector_values (PETScWrappers::VectorBase &vector,
-                                             const std::vector<types::global_dof_index> &indices,
-                                             std::vector<PetscScalar> &values)
+template <int dim>
+const PETScWrappers::MPI::Vector &LevelSetSolver<dim>::velocity(const unsigned int component) const
 {
-  // PETSc wrapper to get sets of values from a petsc vector.
-  // we assume the vector is ghosted
-  // We need to figure out which elements we
-  // own locally. Then get a pointer to the
-  // elements that are stored here (both the
-  // ones we own as well as the ghost elements).
-  // In this array, the locally owned elements
-  // come first followed by the ghost elements whose
-  // position we can get from an index set
-
-  IndexSet ghost_indices = locally_relevant_dofs_LS;
-  ghost_indices.subtract_set(locally_owned_dofs_LS);
-
-  PetscInt n_idx, begin, end, i;
-  n_idx = indices.size();
-
-  VecGetOwnershipRange (vector, &begin, &end);
-
-  Vec solution_in_local_form = PETSC_NULL;
-  VecGhostGetLocalForm(vector, &solution_in_local_form);
-
-  PetscScalar *soln;
-  VecGetArray(solution_in_local_form, &soln);
-
-  for (i = 0; i < n_idx; ++i)
-    {
-      int index = indices[i];
-      if (index >= begin && index < end)
-        values[i] = *(soln+index-begin);
-      else //ghost
-        {
-          const unsigned int ghostidx = ghost_indices.index_within_set(index);
-          values[i] = *(soln+ghostidx+end-begin);
-        }
-    }
-  VecRestoreArray(solution_in_local_form, &soln);
-  VecGhostRestoreLocalForm(vector, &solution_in_local_form);
+  if (!shared_velocity.empty())
+    return *shared_velocity[component];
+  return (component==0 ? locally_relevant_solution_vx :
+          component==1 ? locally_relevant_solution_vy : locally_relevant_solution_vz);
 }
 
-template<int dim>
-void LevelSetSolver<dim>::get_vector_values (PETScWrappers::VectorBase &vector,
-                                             const std::vector<types::global_dof_index> &indices,
-                                             std::map<types::global_dof_index, types::global_dof_index> &map_from_Q1_to_Q2,
-                                             std::vector<PetscScalar> &values)
+template <int dim>
+const PETScWrappers::MPI::Vector &LevelSetSolver<dim>::old_velocity(const unsigned int component) const
 {
-  // THIS IS MEANT TO BE USED WITH VELOCITY VECTORS
-  // PETSc wrapper to get sets of values from a petsc vector.
-  // we assume the vector is ghosted
-  // We need to figure out which elements we
-  // own locally. Then get a pointer to the
-  // elements that are stored here (both the
-  // ones we own as well as the ghost elements).
-  // In this array, the locally owned elements
-  // come first followed by the ghost elements whose
-  // position we can get from an index set
-
-  IndexSet ghost_indices = locally_relevant_dofs_U;
-  ghost_indices.subtract_set(locally_owned_dofs_U);
-
-  PetscInt n_idx, begin, end, i;
-  n_idx = indices.size();
-
-  VecGetOwnershipRange (vector, &begin, &end);
-
-  Vec solution_in_local_form = PETSC_NULL;
-  VecGhostGetLocalForm(vector, &solution_in_local_form);
-
-  PetscScalar *soln;
-  VecGetArray(solution_in_local_form, &soln);
-
-  for (i = 0; i < n_idx; ++i)
-    {
-      int index = map_from_Q1_to_Q2[indices[i]];
-      if (index >= begin && index < end)
-        values[i] = *(soln+index-begin);
-      else //ghost
-        {
-          const unsigned int ghostidx = ghost_indices.index_within_set(index);
-          values[i] = *(soln+ghostidx+end-begin);
-        }
-    }
-  VecRestoreArray(solution_in_local_form, &soln);
-  VecGhostRestoreLocalForm(vector, &solution_in_local_form);
+  if (!shared_velocity_old.empty())
+    return *shared_velocity_old[component];
+  return (component==0 ? locally_relevant_solution_vx_old :
+          component==1 ? locally_relevant_solution_vy_old : locally_relevant_solution_vz_old);
 }
-
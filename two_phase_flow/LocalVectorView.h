@@ -0,0 +1,113 @@
+#ifndef LOCAL_VECTOR_VIEW_H
+#define LOCAL_VECTOR_VIEW_H
+
+#include <deal.II/base/index_set.h>
+#include <deal.II/base/tensor.h>
+#include <deal.II/fe/fe_values.h>
+#include <deal.II/lac/petsc_vector.h>
+
+#include <vector>
+
+using namespace dealii;
+
+///////////////////////
+// MY PETSC WRAPPERS //
+///////////////////////
+// Read only access to the local form of a PETSc vector: the locally owned entries
+// come first, followed (if the vector is ghosted) by the ghost entries in the order
+// of the ghost index set.
+// The PETSc calls are done once in the constructor and destructor; in between the view
+// only reads the raw array, therefore several threads can read through the same view
+// (which is not allowed for the element access functions of the PETSc vector).
+class LocalVectorView
+{
+public:
+  LocalVectorView (const PETScWrappers::MPI::Vector &vector);
+  ~LocalVectorView ();
+
+  // access through the position in the local form
+  const PetscScalar &operator[] (const unsigned int i) const
+  {
+    return values[i];
+  }
+  // access through the global index of a locally owned or ghost entry
+  PetscScalar operator() (const types::global_dof_index index) const
+  {
+    if (index>=first_owned && index<first_owned+n_owned)
+      return values[index-first_owned];
+    Assert (ghost_indices.is_element(index), ExcMessage("The index is not stored on this process"));
+    return values[n_owned+ghost_indices.index_within_set(index)];
+  }
+
+  // values and gradients at the quadrature points of the cell, given the dof indices of the cell
+  template <int dim>
+  void get_function_values (const FEValues<dim> &fe_values,
+                            const std::vector<types::global_dof_index> &dof_indices,
+                            std::vector<double> &q_values) const;
+  template <int dim>
+  void get_function_gradients (const FEValues<dim> &fe_values,
+                               const std::vector<types::global_dof_index> &dof_indices,
+                               std::vector<Tensor<1,dim> > &q_gradients) const;
+
+private:
+  Vec vector;
+  Vec local_form;
+  const PetscScalar *values;
+  types::global_dof_index first_owned;
+  types::global_dof_index n_owned;
+  const IndexSet &ghost_indices;
+};
+
+inline
+LocalVectorView::LocalVectorView (const PETScWrappers::MPI::Vector &vector)
+  :
+  vector(vector),
+  local_form(PETSC_NULL),
+  values(PETSC_NULL),
+  first_owned(vector.local_range().first),
+  n_owned(vector.locally_owned_size()),
+  ghost_indices(vector.ghost_elements())
+{
+  // PETSc gives access to the ghost entries only through the local form of the vector;
+  // vectors without ghost entries are accessed directly
+  VecGhostGetLocalForm(this->vector, &local_form);
+  VecGetArrayRead((local_form!=PETSC_NULL) ? local_form : this->vector, &values);
+}
+
+inline
+LocalVectorView::~LocalVectorView ()
+{
+  VecRestoreArrayRead((local_form!=PETSC_NULL) ? local_form : vector, &values);
+  if (local_form!=PETSC_NULL)
+    VecGhostRestoreLocalForm(vector, &local_form);
+}
+
+template <int dim>
+void LocalVectorView::get_function_values (const FEValues<dim> &fe_values,
+                                           const std::vector<types::global_dof_index> &dof_indices,
+                                           std::vector<double> &q_values) const
+{
+  std::fill(q_values.begin(), q_values.end(), 0.);
+  for (unsigned int i=0; i<dof_indices.size(); ++i)
+    {
+      const double value_i = (*this)(dof_indices[i]);
+      for (unsigned int q=0; q<q_values.size(); ++q)
+        q_values[q] += value_i*fe_values.shape_value(i,q);
+    }
+}
+
+template <int dim>
+void LocalVectorView::get_function_gradients (const FEValues<dim> &fe_values,
+                                              const std::vector<types::global_dof_index> &dof_indices,
+                                              std::vector<Tensor<1,dim> > &q_gradients) const
+{
+  std::fill(q_gradients.begin(), q_gradients.end(), Tensor<1,dim>());
+  for (unsigned int i=0; i<dof_indices.size(); ++i)
+    {
+      const double value_i = (*this)(dof_indices[i]);
+      for (unsigned int q=0; q<q_gradients.size(); ++q)
+        q_gradients[q] += value_i*fe_values.shape_grad(i,q);
+    }
+}
+
+#endif
@@ -49,7 +49,12 @@ using namespace dealii;
 
 #include "NavierStokesSolver.cc"
 #include "LevelSetSolver.cc"
+// The three drivers are linked into one executable (see main.cc) and their utility files
+// define different functions with the same names, hence these are kept local to this file.
+namespace
+{
 #include "utilities.cc"
+}
 
 ///////////////////////////////////////////////////////
 ///////////////////// MAIN CLASS //////////////////////
@@ -74,6 +79,11 @@ private:
   void setup();
   void initial_condition();
   void init_constraints();
+  // NARROW BAND ADAPTIVITY
+  bool mark_cells_in_narrow_band();
+  void refine_initial_mesh();
+  void refine_mesh(NavierStokesSolver<dim> &navier_stokes,
+                   LevelSetSolver<dim> &transport_solver);
 
   MPI_Comm mpi_communicator;
   parallel::distributed::Triangulation<dim>   triangulation;
@@ -129,6 +139,12 @@ private:
   int sharpness_integer;
 
   unsigned int n_refinement;
+  // NARROW BAND ADAPTIVITY: the cells close to the interface have n_refinement levels
+  // while the mesh is coarsened up to n_refinement-n_adaptive_levels away from it
+  bool adaptive_refinement;
+  unsigned int n_adaptive_levels;
+  unsigned int refinement_interval; // time steps between two adaptations of the mesh
+  double narrow_band_width;         // distance from the interface of the refined cells
   unsigned int output_number;
   double output_time;
   bool get_output;
@@ -264,6 +280,96 @@ void MultiPhase<dim>::init_constraints()
   constraints.close ();
 }
 
+//////////////////////////////////////////
+///////// NARROW BAND ADAPTIVITY /////////
+//////////////////////////////////////////
+// The initial level set is phi=-tanh(d/sharpness) (d the signed distance to the interface),
+// hence |d|<narrow_band_width means |phi|<tanh(narrow_band_width/sharpness).
+template <int dim>
+bool MultiPhase<dim>::mark_cells_in_narrow_band()
+{
+  const unsigned int max_level = n_refinement;
+  const unsigned int min_level = n_refinement-n_adaptive_levels;
+  const double phi_band = std::tanh(narrow_band_width/sharpness);
+  Vector<double> phi_values(fe_LS.dofs_per_cell);
+
+  typename DoFHandler<dim>::active_cell_iterator
+  cell_LS = dof_handler_LS.begin_active(),
+  endc_LS = dof_handler_LS.end();
+  for (; cell_LS!=endc_LS; ++cell_LS)
+    if (cell_LS->is_locally_owned())
+      {
+        cell_LS->get_dof_values(locally_relevant_solution_phi,phi_values);
+        const double phi_min = *std::min_element(phi_values.begin(),phi_values.end());
+        const double phi_max = *std::max_element(phi_values.begin(),phi_values.end());
+        // the interface crosses the cell or is closer than the band width
+        const bool in_band = (phi_min*phi_max <= 0)
+                             || (std::min(std::abs(phi_min),std::abs(phi_max)) < phi_band);
+        if (in_band && (unsigned int)cell_LS->level() < max_level)
+          cell_LS->set_refine_flag();
+        else if (!in_band && (unsigned int)cell_LS->level() > min_level)
+          cell_LS->set_coarsen_flag();
+      }
+  triangulation.prepare_coarsening_and_refinement();
+  // check if the mesh changes
+  unsigned int n_flagged_cells = 0;
+  for (cell_LS = dof_handler_LS.begin_active(); cell_LS!=endc_LS; ++cell_LS)
+    if (cell_LS->is_locally_owned() && (cell_LS->refine_flag_set() || cell_LS->coarsen_flag_set()))
+      n_flagged_cells++;
+  return (Utilities::MPI::sum(n_flagged_cells,mpi_communicator) > 0);
+}
+
+template <int dim>
+void MultiPhase<dim>::refine_initial_mesh()
+{
+  // refine where the initial interface is; the initial condition is interpolated again on each mesh
+  for (unsigned int level=0; level<n_adaptive_levels; ++level)
+    {
+      if (!mark_cells_in_narrow_band())
+        break;
+      triangulation.execute_coarsening_and_refinement();
+      setup();
+      initial_condition();
+    }
+}
+
+template <int dim>
+void MultiPhase<dim>::refine_mesh(NavierStokesSolver<dim> &navier_stokes,
+                                  LevelSetSolver<dim> &transport_solver)
+{
+  transport_solver.get_unp1(locally_relevant_solution_phi);
+  if (!mark_cells_in_narrow_band())
+    return;
+  navier_stokes.prepare_for_coarsening_and_refinement();
+  transport_solver.prepare_for_coarsening_and_refinement();
+  triangulation.execute_coarsening_and_refinement();
+
+  // All the DoFHandlers (in this class and within the solvers) distribute the same
+  // finite elements on the same triangulation, hence the vectors can be passed between them
+  setup();
+  navier_stokes.transfer_solution_after_refinement();
+  transport_solver.transfer_solution_after_refinement();
+  transport_solver.get_unp1(locally_relevant_solution_phi);
+  navier_stokes.get_velocity(locally_relevant_solution_u,locally_relevant_solution_v);
+  navier_stokes.get_pressure(locally_relevant_solution_p);
+  AssertThrow(locally_relevant_solution_phi.size()==dof_handler_LS.n_dofs()
+              && locally_relevant_solution_u.size()==dof_handler_U.n_dofs()
+              && locally_relevant_solution_p.size()==dof_handler_P.n_dofs(),
+              ExcMessage("The DoFHandlers of the solvers are not consistent after the refinement"));
+
+  // BOUNDARY CONDITIONS ON THE NEW MESH
+  get_boundary_values_U();
+  navier_stokes.set_boundary_conditions(boundary_values_id_u, boundary_values_id_v,
+                                        boundary_values_u, boundary_values_v);
+  get_boundary_values_phi(boundary_values_id_phi,boundary_values_phi);
+  transport_solver.set_boundary_conditions(boundary_values_id_phi,boundary_values_phi);
+
+  pcout << "   Mesh adapted to the interface: "
+        << triangulation.n_global_active_cells() << " active cells, "
+        << 2*dof_handler_U.n_dofs()+dof_handler_P.n_dofs()+dof_handler_LS.n_dofs()
+        << " DoFs (U, P, LS)" << std::endl;
+}
+
 template <int dim>
 void MultiPhase<dim>::get_boundary_values_U()
 {
@@ -479,6 +585,9 @@ void MultiPhase<dim>::run()
   get_output = true;
   output_number = 0;
   n_refinement=8;
+  adaptive_refinement=false;
+  n_adaptive_levels=3;
+  refinement_interval=10;
   output_time = 0.1;
   final_time = 10.0;
   //////////////////////////////////////////////
@@ -532,18 +641,26 @@ void MultiPhase<dim>::run()
       GridGenerator::subdivided_hyper_rectangle
       (triangulation, repetitions, Point<dim>(0.0,0.0), Point<dim>(0.3,0.9), true);
     }
-  triangulation.refine_global (n_refinement);
+  if (adaptive_refinement)
+    triangulation.refine_global (n_refinement-n_adaptive_levels);
+  else
+    triangulation.refine_global (n_refinement);
   // SETUP
   setup();
 
   // PARAMETERS FOR TIME STEPPING
-  min_h = GridTools::minimal_cell_diameter(triangulation)/std::sqrt(2);
+  // (with adaptive refinement the cells at the interface are refined n_refinement times)
+  min_h = GridTools::minimal_cell_diameter(triangulation)/std::sqrt(2)/std::pow(2.,adaptive_refinement ? n_adaptive_levels : 0);
   time_step = cfl*min_h/umax;
   eps=1.*min_h; //For reconstruction of density in Navier Stokes
   sharpness=sharpness_integer*min_h; //adjust value of sharpness (for init cond of phi)
+  // the band must contain the interface until the next adaptation (it moves less than cfl*min_h per step)
+  narrow_band_width=std::max(sharpness,(refinement_interval*cfl+4)*min_h);
 
   // INITIAL CONDITIONS
   initial_condition();
+  if (adaptive_refinement)
+    refine_initial_mesh();
   output_results();
 
   // NAVIER STOKES SOLVER
@@ -554,6 +671,9 @@ void MultiPhase<dim>::run()
                                          force_function,
                                          verbose,
                                          triangulation,mpi_communicator);
+  // Reuse the AMG hierarchies of the velocity: rebuild them only if the number of iterations grows
+  // to twice the number right after the setup (or above 10), or if the interface could have moved 4 cells
+  navier_stokes.set_AMG_reuse_policy(0,MAX_NUM_ITER_TO_RECOMPUTE_PRECONDITIONER,2.0,4*min_h);
   // BOUNDARY CONDITIONS FOR NAVIER STOKES
   get_boundary_values_U();
   navier_stokes.set_boundary_conditions(boundary_values_id_u, boundary_values_id_v,
@@ -580,6 +700,16 @@ void MultiPhase<dim>::run()
   transport_solver.initial_condition(locally_relevant_solution_phi,
                                      locally_relevant_solution_u,
                                      locally_relevant_solution_v);
+  // COUPLING: the solvers read the level set and the velocity (current and old) of each other
+  // directly from the ghosted vectors of the other solver, there are no copies at each time step
+  std::vector<const PETScWrappers::MPI::Vector *> velocity(dim), old_velocity(dim);
+  for (unsigned int d=0; d<dim; ++d)
+    {
+      velocity[d]=&navier_stokes.get_velocity_component(d);
+      old_velocity[d]=&navier_stokes.get_old_velocity_component(d);
+    }
+  transport_solver.share_velocity(velocity,old_velocity);
+  navier_stokes.share_phi(transport_solver.get_un());
   int dofs_U = 2*dof_handler_U.n_dofs();
   int dofs_P = 2*dof_handler_P.n_dofs();
   int dofs_LS = dof_handler_LS.n_dofs();
@@ -604,16 +734,20 @@ void MultiPhase<dim>::run()
       pcout << "Time step " << timestep_number
             << " at t=" << time
             << std::endl;
-      // GET NAVIER STOKES VELOCITY
-      navier_stokes.set_phi(locally_relevant_solution_phi);
+      // GET NAVIER STOKES VELOCITY (with the shared level set)
       navier_stokes.nth_time_step();
-      navier_stokes.get_velocity(locally_relevant_solution_u,locally_relevant_solution_v);
-      transport_solver.set_velocity(locally_relevant_solution_u,locally_relevant_solution_v);
-      // GET LEVEL SET SOLUTION
+      // GET LEVEL SET SOLUTION (with the shared velocity)
       transport_solver.nth_time_step();
-      transport_solver.get_unp1(locally_relevant_solution_phi);
+      // ADAPT THE MESH TO THE NEW POSITION OF THE INTERFACE
+      if (adaptive_refinement && timestep_number%refinement_interval==0)
+        refine_mesh(navier_stokes,transport_solver);
+      // the vectors of this class are only updated for the output
       if (get_output && time-(output_number)*output_time>0)
-        output_results();
+        {
+          navier_stokes.get_velocity(locally_relevant_solution_u,locally_relevant_solution_v);
+          transport_solver.get_unp1(locally_relevant_solution_phi);
+          output_results();
+        }
     }
   navier_stokes.get_velocity(locally_relevant_solution_u, locally_relevant_solution_v);
   transport_solver.get_unp1(locally_relevant_solution_phi);
@@ -621,12 +755,15 @@ void MultiPhase<dim>::run()
     output_results();
 }
 
-int main(int argc, char *argv[])
+// called by main() in main.cc
+int run_multi_phase(int argc, char *argv[])
 {
   try
     {
       using namespace dealii;
-      Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv, 1);
+      // the cell loops of the solvers are assembled with threads: use all the cores given to each process
+      // (the number can be limited through the environment variable DEAL_II_NUM_THREADS)
+      Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv, numbers::invalid_unsigned_int);
       PetscInitialize(&argc, &argv, PETSC_NULL, PETSC_NULL);
       deallog.depth_console (0);
       {
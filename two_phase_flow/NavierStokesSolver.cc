@@ -25,17 +25,22 @@
 #include <deal.II/lac/sparsity_tools.h>
 #include <deal.II/distributed/tria.h>
 #include <deal.II/distributed/grid_refinement.h>
+#include <deal.II/distributed/solution_transfer.h>
 #include <deal.II/lac/petsc_vector.h>
 #include <deal.II/base/convergence_table.h>
 #include <deal.II/base/timer.h>
 #include <deal.II/base/parameter_handler.h>
 #include <deal.II/grid/grid_tools.h>
 #include <deal.II/fe/mapping_q.h>
+#include <deal.II/base/work_stream.h>
+#include <deal.II/grid/filtered_iterator.h>
 
 #include <fstream>
 #include <iostream>
 #include <memory>
 
+#include "LocalVectorView.h"
+
 using namespace dealii;
 
 #define MAX_NUM_ITER_TO_RECOMPUTE_PRECONDITIONER 10
@@ -75,15 +80,15 @@ public:
   void set_rho_and_nu_functions(const Function<dim> &rho_function,
                                 const Function<dim> &nu_function);
   //initial conditions
-  void initial_condition(PETScWrappers::MPI::Vector locally_relevant_solution_rho,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_u,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_v,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_p);
-  void initial_condition(PETScWrappers::MPI::Vector locally_relevant_solution_rho,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_u,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_v,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_w,
-                         PETScWrappers::MPI::Vector locally_relevant_solution_p);
+  void initial_condition(const PETScWrappers::MPI::Vector &locally_relevant_solution_rho,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_u,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_v,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_p);
+  void initial_condition(const PETScWrappers::MPI::Vector &locally_relevant_solution_rho,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_u,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_v,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_w,
+                         const PETScWrappers::MPI::Vector &locally_relevant_solution_p);
   //boundary conditions
   void set_boundary_conditions(std::vector<types::global_dof_index> boundary_values_id_u,
                                std::vector<types::global_dof_index> boundary_values_id_v, std::vector<double> boundary_values_u,
@@ -92,22 +97,40 @@ public:
                                std::vector<types::global_dof_index> boundary_values_id_v,
                                std::vector<types::global_dof_index> boundary_values_id_w, std::vector<double> boundary_values_u,
                                std::vector<double> boundary_values_v, std::vector<double> boundary_values_w);
-  void set_velocity(PETScWrappers::MPI::Vector locally_relevant_solution_u,
-                    PETScWrappers::MPI::Vector locally_relevant_solution_v);
-  void set_velocity(PETScWrappers::MPI::Vector locally_relevant_solution_u,
-                    PETScWrappers::MPI::Vector locally_relevant_solution_v,
-                    PETScWrappers::MPI::Vector locally_relevant_solution_w);
-  void set_phi(PETScWrappers::MPI::Vector locally_relevant_solution_phi);
+  void set_velocity(const PETScWrappers::MPI::Vector &locally_relevant_solution_u,
+                    const PETScWrappers::MPI::Vector &locally_relevant_solution_v);
+  void set_velocity(const PETScWrappers::MPI::Vector &locally_relevant_solution_u,
+                    const PETScWrappers::MPI::Vector &locally_relevant_solution_v,
+                    const PETScWrappers::MPI::Vector &locally_relevant_solution_w);
+  void set_phi(const PETScWrappers::MPI::Vector &locally_relevant_solution_phi);
+  // Read phi directly from the given (ghosted) vector, e.g. the level set of the LevelSetSolver,
+  // instead of copying it with set_phi() at each time step. The vector is not copied and has to
+  // live (and be kept on the current mesh) as long as this object.
+  void share_phi(const PETScWrappers::MPI::Vector &locally_relevant_solution_phi);
+  // lifetime of the AMG preconditioners for the velocity
+  void set_AMG_reuse_policy(const unsigned int rebuild_interval,
+                            const unsigned int max_iterations,
+                            const double iteration_growth,
+                            const double interface_distance);
   void get_pressure(PETScWrappers::MPI::Vector &locally_relevant_solution_p);
   void get_velocity(PETScWrappers::MPI::Vector &locally_relevant_solution_u,
                     PETScWrappers::MPI::Vector &locally_relevant_solution_v);
   void get_velocity(PETScWrappers::MPI::Vector &locally_relevant_solution_u,
                     PETScWrappers::MPI::Vector &locally_relevant_solution_v,
                     PETScWrappers::MPI::Vector &locally_relevant_solution_w);
+  // read only access to the ghosted velocity (at the current and previous time step) without copies
+  const PETScWrappers::MPI::Vector &get_velocity_component(const unsigned int component) const;
+  const PETScWrappers::MPI::Vector &get_old_velocity_component(const unsigned int component) const;
   // DO STEPS //
   void nth_time_step();
   // SETUP //
   void setup();
+  // ADAPTIVE REFINEMENT //
+  // To be called before and after triangulation.execute_coarsening_and_refinement().
+  // The velocity (current and old), pressure and dpsi are transferred to the new mesh.
+  // The boundary conditions and phi must be set again.
+  void prepare_for_coarsening_and_refinement();
+  void transfer_solution_after_refinement();
 
   ~NavierStokesSolver();
 
@@ -118,6 +141,39 @@ private:
   void init_constraints();
   // ASSEMBLE SYSTEMS //
   void assemble_system_U();
+  // thread parallel assembly of the momentum equations (see assemble_system_U)
+  typedef FilteredIterator<typename DoFHandler<dim>::active_cell_iterator> LocallyOwnedCellIterator;
+  struct AssemblyScratchData_U
+  {
+    AssemblyScratchData_U (const FE_Q<dim> &fe_LS,
+                           const FE_Q<dim> &fe_U,
+                           const FE_Q<dim> &fe_P,
+                           const Quadrature<dim> &quadrature_formula);
+    AssemblyScratchData_U (const AssemblyScratchData_U &scratch_data);
+    FEValues<dim> fe_values_LS;
+    FEValues<dim> fe_values_U;
+    FEValues<dim> fe_values_P;
+    std::vector<types::global_dof_index> local_dof_indices_LS;
+    std::vector<types::global_dof_index> local_dof_indices_P;
+    std::vector<double> phiqnp1;
+    std::vector<double> uqn, uqnm1, vqn, vqnm1, wqn, wqnm1;
+    std::vector<Tensor<1, dim> > grad_pqn, grad_psiqn, grad_psiqnm1;
+    std::vector<Tensor<1, dim> > shape_grad;
+    std::vector<double> shape_value;
+    Vector<double> force_terms;
+  };
+  struct AssemblyCopyData_U
+  {
+    AssemblyCopyData_U (const unsigned int dofs_per_cell);
+    FullMatrix<double> cell_A_u;
+    Vector<double> cell_rhs_u, cell_rhs_v, cell_rhs_w;
+    std::vector<types::global_dof_index> local_dof_indices;
+  };
+  void local_assemble_system_U(const LocallyOwnedCellIterator &cell_U,
+                               AssemblyScratchData_U &scratch,
+                               AssemblyCopyData_U &copy_data,
+                               const std::vector<const LocalVectorView *> &solutions);
+  void copy_local_to_global_system_U(const AssemblyCopyData_U &copy_data);
   void assemble_system_dpsi_q();
   // SOLVERS //
   void solve_U(const AffineConstraints<double> &constraints, PETScWrappers::MPI::SparseMatrix &Matrix,
@@ -130,10 +186,14 @@ private:
                const PETScWrappers::MPI::Vector &rhs);
   // GET DIFFERENT FIELDS //
   void get_rho_and_nu(double phi);
+  void get_rho_and_nu(const double phi, double &rho, double &nu) const;
   void get_velocity();
   void get_pressure();
+  void check_AMG_U_lifetime();
   // OTHERS //
   void save_old_solution();
+  // the level set, either the own copy or the shared vector
+  const PETScWrappers::MPI::Vector &level_set_vector() const;
 
   MPI_Comm &mpi_communicator;
   parallel::distributed::Triangulation<dim> &triangulation;
@@ -206,12 +266,27 @@ private:
   bool rebuild_S_M;
   bool rebuild_Matrix_U_preconditioners;
   bool rebuild_S_M_preconditioners;
+  // LIFETIME OF THE AMG PRECONDITIONERS FOR THE VELOCITY.
+  // The hierarchies are rebuilt every AMG_U_rebuild_interval time steps, when a solve needs
+  // more than AMG_U_max_iterations or more than AMG_U_iteration_growth times the iterations
+  // needed right after the last setup, or when the interface could have moved AMG_U_interface_distance.
+  // A value of zero disables the corresponding criterion.
+  unsigned int AMG_U_rebuild_interval;
+  unsigned int AMG_U_max_iterations;
+  double AMG_U_iteration_growth;
+  double AMG_U_interface_distance;
+  // counters
+  unsigned int AMG_U_n_setups;
+  unsigned int AMG_U_steps_since_setup;
+  unsigned int AMG_U_reference_iterations;
+  double AMG_U_interface_displacement;
   PETScWrappers::MPI::Vector system_rhs_u;
   PETScWrappers::MPI::Vector system_rhs_v;
   PETScWrappers::MPI::Vector system_rhs_w;
   PETScWrappers::MPI::Vector system_rhs_psi;
   PETScWrappers::MPI::Vector system_rhs_q;
   PETScWrappers::MPI::Vector locally_relevant_solution_phi;
+  const PETScWrappers::MPI::Vector *shared_phi = nullptr;
   PETScWrappers::MPI::Vector locally_relevant_solution_u;
   PETScWrappers::MPI::Vector locally_relevant_solution_v;
   PETScWrappers::MPI::Vector locally_relevant_solution_w;
@@ -229,6 +304,9 @@ private:
   PETScWrappers::MPI::Vector completely_distributed_solution_psi;
   PETScWrappers::MPI::Vector completely_distributed_solution_q;
   PETScWrappers::MPI::Vector completely_distributed_solution_p;
+
+  std::unique_ptr<parallel::distributed::SolutionTransfer<dim,PETScWrappers::MPI::Vector> > solution_transfer_U;
+  std::unique_ptr<parallel::distributed::SolutionTransfer<dim,PETScWrappers::MPI::Vector> > solution_transfer_P;
 };
 
 // CONSTRUCTOR FOR LEVEL SET
@@ -273,7 +351,15 @@ NavierStokesSolver<dim>::NavierStokesSolver(const unsigned int degree_LS,
   rebuild_Matrix_U(true),
   rebuild_S_M(true),
   rebuild_Matrix_U_preconditioners(true),
-  rebuild_S_M_preconditioners(true)
+  rebuild_S_M_preconditioners(true),
+  AMG_U_rebuild_interval(0),
+  AMG_U_max_iterations(MAX_NUM_ITER_TO_RECOMPUTE_PRECONDITIONER),
+  AMG_U_iteration_growth(0),
+  AMG_U_interface_distance(0),
+  AMG_U_n_setups(0),
+  AMG_U_steps_since_setup(0),
+  AMG_U_reference_iterations(0),
+  AMG_U_interface_displacement(0)
 {setup();}
 
 // CONSTRUCTOR NOT FOR LEVEL SET
@@ -308,7 +394,15 @@ NavierStokesSolver<dim>::NavierStokesSolver(const unsigned int degree_LS,
   rebuild_Matrix_U(true),
   rebuild_S_M(true),
   rebuild_Matrix_U_preconditioners(true),
-  rebuild_S_M_preconditioners(true)
+  rebuild_S_M_preconditioners(true),
+  AMG_U_rebuild_interval(0),
+  AMG_U_max_iterations(MAX_NUM_ITER_TO_RECOMPUTE_PRECONDITIONER),
+  AMG_U_iteration_growth(0),
+  AMG_U_interface_distance(0),
+  AMG_U_n_setups(0),
+  AMG_U_steps_since_setup(0),
+  AMG_U_reference_iterations(0),
+  AMG_U_interface_displacement(0)
 {setup();}
 
 template<int dim>
@@ -331,10 +425,10 @@ void NavierStokesSolver<dim>::set_rho_and_nu_functions(const Function<dim> &rho_
 }
 
 template<int dim>
-void NavierStokesSolver<dim>::initial_condition(PETScWrappers::MPI::Vector locally_relevant_solution_phi,
-                                                PETScWrappers::MPI::Vector locally_relevant_solution_u,
-                                                PETScWrappers::MPI::Vector locally_relevant_solution_v,
-                                                PETScWrappers::MPI::Vector locally_relevant_solution_p)
+void NavierStokesSolver<dim>::initial_condition(const PETScWrappers::MPI::Vector &locally_relevant_solution_phi,
+                                                const PETScWrappers::MPI::Vector &locally_relevant_solution_u,
+                                                const PETScWrappers::MPI::Vector &locally_relevant_solution_v,
+                                                const PETScWrappers::MPI::Vector &locally_relevant_solution_p)
 {
   this->locally_relevant_solution_phi=locally_relevant_solution_phi;
   this->locally_relevant_solution_u=locally_relevant_solution_u;
@@ -345,11 +439,11 @@ void NavierStokesSolver<dim>::initial_condition(PETScWrappers::MPI::Vector local
 }
 
 template<int dim>
-void NavierStokesSolver<dim>::initial_condition(PETScWrappers::MPI::Vector locally_relevant_solution_phi,
-                                                PETScWrappers::MPI::Vector locally_relevant_solution_u,
-                                                PETScWrappers::MPI::Vector locally_relevant_solution_v,
-                                                PETScWrappers::MPI::Vector locally_relevant_solution_w,
-                                                PETScWrappers::MPI::Vector locally_relevant_solution_p)
+void NavierStokesSolver<dim>::initial_condition(const PETScWrappers::MPI::Vector &locally_relevant_solution_phi,
+                                                const PETScWrappers::MPI::Vector &locally_relevant_solution_u,
+                                                const PETScWrappers::MPI::Vector &locally_relevant_solution_v,
+                                                const PETScWrappers::MPI::Vector &locally_relevant_solution_w,
+                                                const PETScWrappers::MPI::Vector &locally_relevant_solution_p)
 {
   this->locally_relevant_solution_phi=locally_relevant_solution_phi;
   this->locally_relevant_solution_u=locally_relevant_solution_u;
@@ -389,17 +483,17 @@ void NavierStokesSolver<dim>::set_boundary_conditions(std::vector<types::global_
 }
 
 template<int dim>
-void NavierStokesSolver<dim>::set_velocity(PETScWrappers::MPI::Vector locally_relevant_solution_u,
-                                           PETScWrappers::MPI::Vector locally_relevant_solution_v)
+void NavierStokesSolver<dim>::set_velocity(const PETScWrappers::MPI::Vector &locally_relevant_solution_u,
+                                           const PETScWrappers::MPI::Vector &locally_relevant_solution_v)
 {
   this->locally_relevant_solution_u=locally_relevant_solution_u;
   this->locally_relevant_solution_v=locally_relevant_solution_v;
 }
 
 template<int dim>
-void NavierStokesSolver<dim>::set_velocity(PETScWrappers::MPI::Vector locally_relevant_solution_u,
-                                           PETScWrappers::MPI::Vector locally_relevant_solution_v,
-                                           PETScWrappers::MPI::Vector locally_relevant_solution_w)
+void NavierStokesSolver<dim>::set_velocity(const PETScWrappers::MPI::Vector &locally_relevant_solution_u,
+                                           const PETScWrappers::MPI::Vector &locally_relevant_solution_v,
+                                           const PETScWrappers::MPI::Vector &locally_relevant_solution_w)
 {
   this->locally_relevant_solution_u=locally_relevant_solution_u;
   this->locally_relevant_solution_v=locally_relevant_solution_v;
@@ -407,13 +501,41 @@ void NavierStokesSolver<dim>::set_velocity(PETScWrappers::MPI::Vector locally_re
 }
 
 template<int dim>
-void NavierStokesSolver<dim>::set_phi(PETScWrappers::MPI::Vector locally_relevant_solution_phi)
+void NavierStokesSolver<dim>::set_phi(const PETScWrappers::MPI::Vector &locally_relevant_solution_phi)
 {
+  Assert(shared_phi==nullptr, ExcMessage("phi is shared with another vector, see share_phi()"));
   this->locally_relevant_solution_phi=locally_relevant_solution_phi;
 }
 
+template<int dim>
+void NavierStokesSolver<dim>::share_phi(const PETScWrappers::MPI::Vector &locally_relevant_solution_phi)
+{
+  Assert(locally_relevant_solution_phi.has_ghost_elements(),
+         ExcMessage("The shared phi has to be a ghosted vector"));
+  shared_phi=&locally_relevant_solution_phi;
+}
+
+template<int dim>
+void NavierStokesSolver<dim>::set_AMG_reuse_policy(const unsigned int rebuild_interval,
+                                                   const unsigned int max_iterations,
+                                                   const double iteration_growth,
+                                                   const double interface_distance)
+{
+  AMG_U_rebuild_interval=rebuild_interval;
+  AMG_U_max_iterations=max_iterations;
+  AMG_U_iteration_growth=iteration_growth;
+  AMG_U_interface_distance=interface_distance;
+}
+
 template<int dim>
 void NavierStokesSolver<dim>::get_rho_and_nu(double phi)
+{
+  get_rho_and_nu(phi,rho_value,nu_value);
+}
+
+// This version does not modify the members and can be called by several threads
+template<int dim>
+void NavierStokesSolver<dim>::get_rho_and_nu(const double phi, double &rho, double &nu) const
 {
   double H=0;
   // get rho, nu
@@ -423,10 +545,10 @@ void NavierStokesSolver<dim>::get_rho_and_nu(double phi)
     H=-1;
   else
     H=phi/eps;
-  rho_value=rho_fluid*(1+H)/2.+rho_air*(1-H)/2.;
-  nu_value=nu_fluid*(1+H)/2.+nu_air*(1-H)/2.;
-  //rho_value=rho_fluid*(1+phi)/2.+rho_air*(1-phi)/2.;
-  //nu_value=nu_fluid*(1+phi)/2.+nu_air*(1-phi)/2.;
+  rho=rho_fluid*(1+H)/2.+rho_air*(1-H)/2.;
+  nu=nu_fluid*(1+H)/2.+nu_air*(1-H)/2.;
+  //rho=rho_fluid*(1+phi)/2.+rho_air*(1-phi)/2.;
+  //nu=nu_fluid*(1+phi)/2.+nu_air*(1-phi)/2.;
 }
 
 template<int dim>
@@ -453,6 +575,24 @@ void NavierStokesSolver<dim>::get_velocity(PETScWrappers::MPI::Vector &locally_r
   locally_relevant_solution_w=this->locally_relevant_solution_w;
 }
 
+template<int dim>
+const PETScWrappers::MPI::Vector &
+NavierStokesSolver<dim>::get_velocity_component(const unsigned int component) const
+{
+  AssertIndexRange(component,dim);
+  return (component==0 ? locally_relevant_solution_u :
+          component==1 ? locally_relevant_solution_v : locally_relevant_solution_w);
+}
+
+template<int dim>
+const PETScWrappers::MPI::Vector &
+NavierStokesSolver<dim>::get_old_velocity_component(const unsigned int component) const
+{
+  AssertIndexRange(component,dim);
+  return (component==0 ? locally_relevant_solution_u_old :
+          component==1 ? locally_relevant_solution_v_old : locally_relevant_solution_w_old);
+}
+
 ///////////////////////////////////////////////////////
 ///////////// SETUP AND INITIAL CONDITION /////////////
 ///////////////////////////////////////////////////////
@@ -465,6 +605,73 @@ void NavierStokesSolver<dim>::setup()
   setup_VECTORS();
 }
 
+template<int dim>
+void NavierStokesSolver<dim>::prepare_for_coarsening_and_refinement()
+{
+  solution_transfer_U.reset(new parallel::distributed::SolutionTransfer<dim,PETScWrappers::MPI::Vector>(dof_handler_U));
+  solution_transfer_P.reset(new parallel::distributed::SolutionTransfer<dim,PETScWrappers::MPI::Vector>(dof_handler_P));
+  std::vector<const PETScWrappers::MPI::Vector *> solutions_U=
+  {&locally_relevant_solution_u,&locally_relevant_solution_v,
+   &locally_relevant_solution_u_old,&locally_relevant_solution_v_old};
+  if (dim==3)
+    {
+      solutions_U.push_back(&locally_relevant_solution_w);
+      solutions_U.push_back(&locally_relevant_solution_w_old);
+    }
+  const std::vector<const PETScWrappers::MPI::Vector *> solutions_P=
+  {&locally_relevant_solution_p,&locally_relevant_solution_psi,&locally_relevant_solution_psi_old};
+  solution_transfer_U->prepare_for_coarsening_and_refinement(solutions_U);
+  solution_transfer_P->prepare_for_coarsening_and_refinement(solutions_P);
+}
+
+template<int dim>
+void NavierStokesSolver<dim>::transfer_solution_after_refinement()
+{
+  Assert(solution_transfer_U && solution_transfer_P,
+         ExcMessage("prepare_for_coarsening_and_refinement() has to be called before refining the mesh"));
+  // new DOFs, constraints, matrices and vectors
+  setup();
+  // the interpolation is done on non-ghosted vectors
+  const unsigned int n_solutions_U=(dim==3 ? 6 : 4);
+  std::vector<PETScWrappers::MPI::Vector> solutions_U(n_solutions_U,PETScWrappers::MPI::Vector(locally_owned_dofs_U,mpi_communicator));
+  std::vector<PETScWrappers::MPI::Vector> solutions_P(3,PETScWrappers::MPI::Vector(locally_owned_dofs_P,mpi_communicator));
+  std::vector<PETScWrappers::MPI::Vector *> solutions_U_ptr, solutions_P_ptr;
+  for (unsigned int i=0; i<solutions_U.size(); ++i)
+    solutions_U_ptr.push_back(&solutions_U[i]);
+  for (unsigned int i=0; i<solutions_P.size(); ++i)
+    solutions_P_ptr.push_back(&solutions_P[i]);
+  solution_transfer_U->interpolate(solutions_U_ptr);
+  solution_transfer_P->interpolate(solutions_P_ptr);
+  solution_transfer_U.reset();
+  solution_transfer_P.reset();
+  // the hanging nodes get the values of the constraints
+  for (unsigned int i=0; i<solutions_U.size(); ++i)
+    constraints.distribute(solutions_U[i]);
+  for (unsigned int i=0; i<solutions_P.size(); ++i)
+    constraints_psi.distribute(solutions_P[i]);
+  locally_relevant_solution_u=solutions_U[0];
+  locally_relevant_solution_v=solutions_U[1];
+  locally_relevant_solution_u_old=solutions_U[2];
+  locally_relevant_solution_v_old=solutions_U[3];
+  completely_distributed_solution_u=solutions_U[0];
+  completely_distributed_solution_v=solutions_U[1];
+  if (dim==3)
+    {
+      locally_relevant_solution_w=solutions_U[4];
+      locally_relevant_solution_w_old=solutions_U[5];
+      completely_distributed_solution_w=solutions_U[4];
+    }
+  // the pressure is updated incrementally in get_pressure()
+  locally_relevant_solution_p=solutions_P[0];
+  completely_distributed_solution_p=solutions_P[0];
+  locally_relevant_solution_psi=solutions_P[1];
+  completely_distributed_solution_psi=solutions_P[1];
+  locally_relevant_solution_psi_old=solutions_P[2];
+  // the matrices have new dimensions: new preconditioners
+  rebuild_Matrix_U_preconditioners=true;
+  rebuild_S_M_preconditioners=true;
+}
+
 template<int dim>
 void NavierStokesSolver<dim>::setup_DOF()
 {
@@ -612,6 +819,69 @@ void NavierStokesSolver<dim>::init_constraints()
 ///////////////////////////////////////////////////////
 ////////////////// ASSEMBLE SYSTEMS ///////////////////
 ///////////////////////////////////////////////////////
+template<int dim>
+NavierStokesSolver<dim>::AssemblyScratchData_U::AssemblyScratchData_U (const FE_Q<dim> &fe_LS,
+    const FE_Q<dim> &fe_U,
+    const FE_Q<dim> &fe_P,
+    const Quadrature<dim> &quadrature_formula)
+  :
+  fe_values_LS(fe_LS,quadrature_formula,update_values),
+  fe_values_U(fe_U,quadrature_formula,
+              update_values|update_gradients|update_quadrature_points|update_JxW_values),
+  fe_values_P(fe_P,quadrature_formula,update_gradients),
+  local_dof_indices_LS(fe_LS.dofs_per_cell),
+  local_dof_indices_P(fe_P.dofs_per_cell),
+  phiqnp1(quadrature_formula.size()),
+  uqn(quadrature_formula.size()),
+  uqnm1(quadrature_formula.size()),
+  vqn(quadrature_formula.size()),
+  vqnm1(quadrature_formula.size()),
+  wqn(quadrature_formula.size()),
+  wqnm1(quadrature_formula.size()),
+  grad_pqn(quadrature_formula.size()),
+  grad_psiqn(quadrature_formula.size()),
+  grad_psiqnm1(quadrature_formula.size()),
+  shape_grad(fe_U.dofs_per_cell),
+  shape_value(fe_U.dofs_per_cell),
+  force_terms(dim)
+{}
+
+template<int dim>
+NavierStokesSolver<dim>::AssemblyScratchData_U::AssemblyScratchData_U (const AssemblyScratchData_U &scratch_data)
+  :
+  fe_values_LS(scratch_data.fe_values_LS.get_fe(),scratch_data.fe_values_LS.get_quadrature(),
+               scratch_data.fe_values_LS.get_update_flags()),
+  fe_values_U(scratch_data.fe_values_U.get_fe(),scratch_data.fe_values_U.get_quadrature(),
+              scratch_data.fe_values_U.get_update_flags()),
+  fe_values_P(scratch_data.fe_values_P.get_fe(),scratch_data.fe_values_P.get_quadrature(),
+              scratch_data.fe_values_P.get_update_flags()),
+  local_dof_indices_LS(scratch_data.local_dof_indices_LS),
+  local_dof_indices_P(scratch_data.local_dof_indices_P),
+  phiqnp1(scratch_data.phiqnp1),
+  uqn(scratch_data.uqn),
+  uqnm1(scratch_data.uqnm1),
+  vqn(scratch_data.vqn),
+  vqnm1(scratch_data.vqnm1),
+  wqn(scratch_data.wqn),
+  wqnm1(scratch_data.wqnm1),
+  grad_pqn(scratch_data.grad_pqn),
+  grad_psiqn(scratch_data.grad_psiqn),
+  grad_psiqnm1(scratch_data.grad_psiqnm1),
+  shape_grad(scratch_data.shape_grad),
+  shape_value(scratch_data.shape_value),
+  force_terms(scratch_data.force_terms)
+{}
+
+template<int dim>
+NavierStokesSolver<dim>::AssemblyCopyData_U::AssemblyCopyData_U (const unsigned int dofs_per_cell)
+  :
+  cell_A_u(dofs_per_cell,dofs_per_cell),
+  cell_rhs_u(dofs_per_cell),
+  cell_rhs_v(dofs_per_cell),
+  cell_rhs_w(dofs_per_cell),
+  local_dof_indices(dofs_per_cell)
+{}
+
 template<int dim>
 void NavierStokesSolver<dim>::assemble_system_U()
 {
@@ -626,197 +896,32 @@ void NavierStokesSolver<dim>::assemble_system_U()
   system_rhs_w=0;
 
   const QGauss<dim> quadrature_formula(degree_MAX+1);
-  FEValues<dim> fe_values_LS(fe_LS,quadrature_formula,
-                             update_values|update_gradients|update_quadrature_points|update_JxW_values);
-  FEValues<dim> fe_values_U(fe_U,quadrature_formula,
-                            update_values|update_gradients|update_quadrature_points|update_JxW_values);
-  FEValues<dim> fe_values_P(fe_P,quadrature_formula,
-                            update_values|update_gradients|update_quadrature_points|update_JxW_values);
-
-  const unsigned int dofs_per_cell=fe_U.dofs_per_cell;
-  const unsigned int n_q_points=quadrature_formula.size();
-
-  FullMatrix<double> cell_A_u(dofs_per_cell,dofs_per_cell);
-  Vector<double> cell_rhs_u(dofs_per_cell);
-  Vector<double> cell_rhs_v(dofs_per_cell);
-  Vector<double> cell_rhs_w(dofs_per_cell);
-
-  std::vector<double> phiqnp1(n_q_points);
-
-  std::vector<double> uqn(n_q_points);
-  std::vector<double> uqnm1(n_q_points);
-  std::vector<double> vqn(n_q_points);
-  std::vector<double> vqnm1(n_q_points);
-  std::vector<double> wqn(n_q_points);
-  std::vector<double> wqnm1(n_q_points);
-
-  // FOR Explicit nonlinearity
-  //std::vector<Tensor<1, dim> > grad_un(n_q_points);
-  //std::vector<Tensor<1, dim> > grad_vn(n_q_points);
-  //std::vector<Tensor<1, dim> > grad_wn(n_q_points);
-  //Tensor<1, dim> Un;
-
-  std::vector<Tensor<1, dim> > grad_pqn(n_q_points);
-  std::vector<Tensor<1, dim> > grad_psiqn(n_q_points);
-  std::vector<Tensor<1, dim> > grad_psiqnm1(n_q_points);
-
-  std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
-  std::vector<Tensor<1, dim> > shape_grad(dofs_per_cell);
-  std::vector<double> shape_value(dofs_per_cell);
-
-  double force_u;
-  double force_v;
-  double force_w;
-  double pressure_grad_u;
-  double pressure_grad_v;
-  double pressure_grad_w;
-  double u_star=0;
-  double v_star=0;
-  double w_star=0;
-  double rho_star;
-  double rho;
-  Vector<double> force_terms(dim);
-
-  typename DoFHandler<dim>::active_cell_iterator
-  cell_U=dof_handler_U.begin_active(), endc_U=dof_handler_U.end();
-  typename DoFHandler<dim>::active_cell_iterator cell_P=dof_handler_P.begin_active();
-  typename DoFHandler<dim>::active_cell_iterator cell_LS=dof_handler_LS.begin_active();
-
-  for (; cell_U!=endc_U; ++cell_U,++cell_P,++cell_LS)
-    if (cell_U->is_locally_owned())
-      {
-        cell_A_u=0;
-        cell_rhs_u=0;
-        cell_rhs_v=0;
-        cell_rhs_w=0;
-
-        fe_values_LS.reinit(cell_LS);
-        fe_values_U.reinit(cell_U);
-        fe_values_P.reinit(cell_P);
-
-        // get function values for LS
-        fe_values_LS.get_function_values(locally_relevant_solution_phi,phiqnp1);
-        // get function values for U
-        fe_values_U.get_function_values(locally_relevant_solution_u,uqn);
-        fe_values_U.get_function_values(locally_relevant_solution_u_old,uqnm1);
-        fe_values_U.get_function_values(locally_relevant_solution_v,vqn);
-        fe_values_U.get_function_values(locally_relevant_solution_v_old,vqnm1);
-        if (dim==3)
-          {
-            fe_values_U.get_function_values(locally_relevant_solution_w,wqn);
-            fe_values_U.get_function_values(locally_relevant_solution_w_old,wqnm1);
-          }
-        // For explicit nonlinearity
-        // get gradient values for U
-        //fe_values_U.get_function_gradients(locally_relevant_solution_u,grad_un);
-        //fe_values_U.get_function_gradients(locally_relevant_solution_v,grad_vn);
-        //if (dim==3)
-        //fe_values_U.get_function_gradients(locally_relevant_solution_w,grad_wn);
-
-        // get values and gradients for p and dpsi
-        fe_values_P.get_function_gradients(locally_relevant_solution_p,grad_pqn);
-        fe_values_P.get_function_gradients(locally_relevant_solution_psi,grad_psiqn);
-        fe_values_P.get_function_gradients(locally_relevant_solution_psi_old,grad_psiqnm1);
-
-        for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
-          {
-            const double JxW=fe_values_U.JxW(q_point);
-            for (unsigned int i=0; i<dofs_per_cell; ++i)
-              {
-                shape_grad[i]=fe_values_U.shape_grad(i,q_point);
-                shape_value[i]=fe_values_U.shape_value(i,q_point);
-              }
-
-            pressure_grad_u=(grad_pqn[q_point][0]+4./3*grad_psiqn[q_point][0]-1./3*grad_psiqnm1[q_point][0]);
-            pressure_grad_v=(grad_pqn[q_point][1]+4./3*grad_psiqn[q_point][1]-1./3*grad_psiqnm1[q_point][1]);
-            if (dim==3)
-              pressure_grad_w=(grad_pqn[q_point][2]+4./3*grad_psiqn[q_point][2]-1./3*grad_psiqnm1[q_point][2]);
-
-            if (LEVEL_SET==1) // use level set to define rho and nu
-              get_rho_and_nu(phiqnp1[q_point]);
-            else // rho and nu are defined through functions
-              {
-                rho_value=rho_function.value(fe_values_U.quadrature_point(q_point));
-                nu_value=nu_function.value(fe_values_U.quadrature_point(q_point));
-              }
-
-            // Non-linearity: for semi-implicit
-            u_star=2*uqn[q_point]-uqnm1[q_point];
-            v_star=2*vqn[q_point]-vqnm1[q_point];
-            if (dim==3)
-              w_star=2*wqn[q_point]-wqnm1[q_point];
-
-            // for explicit nonlinearity
-            //Un[0] = uqn[q_point];
-            //Un[1] = vqn[q_point];
-            //if (dim==3)
-            //Un[2] = wqn[q_point];
-
-            //double nonlinearity_u = Un*grad_un[q_point];
-            //double nonlinearity_v = Un*grad_vn[q_point];
-            //double nonlinearity_w = 0;
-            //if (dim==3)
-            //nonlinearity_w = Un*grad_wn[q_point];
-
-            rho_star=rho_value; // This is because we consider rho*u_t instead of (rho*u)_t
-            rho=rho_value;
-
-            // FORCE TERMS
-            force_function.vector_value(fe_values_U.quadrature_point(q_point),force_terms);
-            force_u=force_terms[0];
-            force_v=force_terms[1];
-            if (dim==3)
-              force_w=force_terms[2];
-            if (RHO_TIMES_RHS==1)
-              {
-                force_u*=rho;
-                force_v*=rho;
-                if (dim==3)
-                  force_w*=rho;
-              }
-
-            for (unsigned int i=0; i<dofs_per_cell; ++i)
-              {
-                cell_rhs_u(i)+=((4./3*rho*uqn[q_point]-1./3*rho*uqnm1[q_point]
-                                 +2./3*time_step*(force_u-pressure_grad_u)
-                                 //-2./3*time_step*rho*nonlinearity_u
-                                )*shape_value[i])*JxW;
-                cell_rhs_v(i)+=((4./3*rho*vqn[q_point]-1./3*rho*vqnm1[q_point]
-                                 +2./3*time_step*(force_v-pressure_grad_v)
-                                 //-2./3*time_step*rho*nonlinearity_v
-                                )*shape_value[i])*JxW;
-                if (dim==3)
-                  cell_rhs_w(i)+=((4./3*rho*wqn[q_point]-1./3*rho*wqnm1[q_point]
-                                   +2./3*time_step*(force_w-pressure_grad_w)
-                                   //-2./3*time_step*rho*nonlinearity_w
-                                  )*shape_value[i])*JxW;
-                if (rebuild_Matrix_U==true)
-                  for (unsigned int j=0; j<dofs_per_cell; ++j)
-                    {
-                      if (dim==2)
-                        cell_A_u(i,j)+=(rho_star*shape_value[i]*shape_value[j]
-                                        +2./3*time_step*nu_value*(shape_grad[i]*shape_grad[j])
-                                        +2./3*time_step*rho*shape_value[i]
-                                        *(u_star*shape_grad[j][0]+v_star*shape_grad[j][1]) // semi-implicit NL
-                                       )*JxW;
-                      else //dim==3
-                        cell_A_u(i,j)+=(rho_star*shape_value[i]*shape_value[j]
-                                        +2./3*time_step*nu_value*(shape_grad[i]*shape_grad[j])
-                                        +2./3*time_step*rho*shape_value[i]
-                                        *(u_star*shape_grad[j][0]+v_star*shape_grad[j][1]+w_star*shape_grad[j][2]) // semi-implicit NL
-                                       )*JxW;
-                    }
-              }
-          }
-        cell_U->get_dof_indices(local_dof_indices);
-        // distribute
-        if (rebuild_Matrix_U==true)
-          constraints.distribute_local_to_global(cell_A_u,local_dof_indices,system_Matrix_u);
-        constraints.distribute_local_to_global(cell_rhs_u,local_dof_indices,system_rhs_u);
-        constraints.distribute_local_to_global(cell_rhs_v,local_dof_indices,system_rhs_v);
-        if (dim==3)
-          constraints.distribute_local_to_global(cell_rhs_w,local_dof_indices,system_rhs_w);
-      }
+  {
+    // The cells are assembled by several threads (WorkStream); since PETSc is not thread safe
+    // the ghosted vectors are read through their raw local arrays.
+    // In 2D the w vectors are not read and are replaced by the v vectors.
+    const LocalVectorView phi(level_set_vector());
+    const LocalVectorView u(locally_relevant_solution_u), u_old(locally_relevant_solution_u_old);
+    const LocalVectorView v(locally_relevant_solution_v), v_old(locally_relevant_solution_v_old);
+    const LocalVectorView w(dim==3 ? locally_relevant_solution_w : locally_relevant_solution_v);
+    const LocalVectorView w_old(dim==3 ? locally_relevant_solution_w_old : locally_relevant_solution_v_old);
+    const LocalVectorView p(locally_relevant_solution_p);
+    const LocalVectorView psi(locally_relevant_solution_psi), psi_old(locally_relevant_solution_psi_old);
+    const std::vector<const LocalVectorView *> solutions = {&phi,&u,&u_old,&v,&v_old,&w,&w_old,&p,&psi,&psi_old};
+
+    WorkStream::run(LocallyOwnedCellIterator(IteratorFilters::LocallyOwnedCell(),dof_handler_U.begin_active()),
+                    LocallyOwnedCellIterator(IteratorFilters::LocallyOwnedCell(),dof_handler_U.end()),
+                    [&](const LocallyOwnedCellIterator &cell_U, AssemblyScratchData_U &scratch, AssemblyCopyData_U &copy_data)
+    {
+      this->local_assemble_system_U(cell_U,scratch,copy_data,solutions);
+    },
+    [this](const AssemblyCopyData_U &copy_data)
+    {
+      this->copy_local_to_global_system_U(copy_data);
+    },
+    AssemblyScratchData_U(fe_LS,fe_U,fe_P,quadrature_formula),
+    AssemblyCopyData_U(fe_U.dofs_per_cell));
+  }
   system_rhs_u.compress(VectorOperation::add);
   system_rhs_v.compress(VectorOperation::add);
   if (dim==3) system_rhs_w.compress(VectorOperation::add);
@@ -854,11 +959,199 @@ void NavierStokesSolver<dim>::assemble_system_U()
           if (dim==3)
             preconditioner_Matrix_w.reset(new PETScWrappers::PreconditionBoomerAMG
                                           (system_Matrix_w,PETScWrappers::PreconditionBoomerAMG::AdditionalData(false)));
+          // Keep the hierarchies when the solvers see the (reassembled) matrices of the next time steps.
+          // Otherwise PETSc sets up the preconditioner again as soon as the values of the matrix change.
+          PCSetReusePreconditioner(preconditioner_Matrix_u->get_pc(),PETSC_TRUE);
+          PCSetReusePreconditioner(preconditioner_Matrix_v->get_pc(),PETSC_TRUE);
+          if (dim==3)
+            PCSetReusePreconditioner(preconditioner_Matrix_w->get_pc(),PETSC_TRUE);
+          AMG_U_n_setups++;
+          AMG_U_steps_since_setup=0;
+          AMG_U_reference_iterations=0;
+          AMG_U_interface_displacement=0;
         }
     }
   rebuild_Matrix_U=true;
 }
 
+template<int dim>
+void NavierStokesSolver<dim>::local_assemble_system_U(const LocallyOwnedCellIterator &cell_U,
+                                                      AssemblyScratchData_U &scratch,
+                                                      AssemblyCopyData_U &copy_data,
+                                                      const std::vector<const LocalVectorView *> &solutions)
+{
+  const LocalVectorView &phi=*solutions[0], &u=*solutions[1], &u_old=*solutions[2];
+  const LocalVectorView &v=*solutions[3], &v_old=*solutions[4], &w=*solutions[5], &w_old=*solutions[6];
+  const LocalVectorView &p=*solutions[7], &psi=*solutions[8], &psi_old=*solutions[9];
+
+  const unsigned int dofs_per_cell=fe_U.dofs_per_cell;
+  const unsigned int n_q_points=scratch.fe_values_U.n_quadrature_points;
+
+  FEValues<dim> &fe_values_LS=scratch.fe_values_LS;
+  FEValues<dim> &fe_values_U=scratch.fe_values_U;
+  FEValues<dim> &fe_values_P=scratch.fe_values_P;
+
+  FullMatrix<double> &cell_A_u=copy_data.cell_A_u;
+  Vector<double> &cell_rhs_u=copy_data.cell_rhs_u;
+  Vector<double> &cell_rhs_v=copy_data.cell_rhs_v;
+  Vector<double> &cell_rhs_w=copy_data.cell_rhs_w;
+
+  std::vector<double> &phiqnp1=scratch.phiqnp1;
+  std::vector<double> &uqn=scratch.uqn;
+  std::vector<double> &uqnm1=scratch.uqnm1;
+  std::vector<double> &vqn=scratch.vqn;
+  std::vector<double> &vqnm1=scratch.vqnm1;
+  std::vector<double> &wqn=scratch.wqn;
+  std::vector<double> &wqnm1=scratch.wqnm1;
+
+  std::vector<Tensor<1, dim> > &grad_pqn=scratch.grad_pqn;
+  std::vector<Tensor<1, dim> > &grad_psiqn=scratch.grad_psiqn;
+  std::vector<Tensor<1, dim> > &grad_psiqnm1=scratch.grad_psiqnm1;
+
+  std::vector<Tensor<1, dim> > &shape_grad=scratch.shape_grad;
+  std::vector<double> &shape_value=scratch.shape_value;
+
+  double force_u;
+  double force_v;
+  double force_w=0;
+  double pressure_grad_u;
+  double pressure_grad_v;
+  double pressure_grad_w=0;
+  double u_star=0;
+  double v_star=0;
+  double w_star=0;
+  double rho_star;
+  double rho;
+  // local copies: the members rho_value and nu_value are shared by all threads
+  double rho_value;
+  double nu_value;
+  Vector<double> &force_terms=scratch.force_terms;
+
+  // all DoFHandlers live on the same triangulation
+  const typename DoFHandler<dim>::active_cell_iterator
+  cell_P(&triangulation,cell_U->level(),cell_U->index(),&dof_handler_P),
+         cell_LS(&triangulation,cell_U->level(),cell_U->index(),&dof_handler_LS);
+
+  cell_A_u=0;
+  cell_rhs_u=0;
+  cell_rhs_v=0;
+  cell_rhs_w=0;
+
+  fe_values_LS.reinit(cell_LS);
+  fe_values_U.reinit(cell_U);
+  fe_values_P.reinit(cell_P);
+  cell_LS->get_dof_indices(scratch.local_dof_indices_LS);
+  cell_U->get_dof_indices(copy_data.local_dof_indices);
+  cell_P->get_dof_indices(scratch.local_dof_indices_P);
+  const std::vector<types::global_dof_index> &local_dof_indices=copy_data.local_dof_indices;
+
+  // get function values for LS
+  phi.get_function_values(fe_values_LS,scratch.local_dof_indices_LS,phiqnp1);
+  // get function values for U
+  u.get_function_values(fe_values_U,local_dof_indices,uqn);
+  u_old.get_function_values(fe_values_U,local_dof_indices,uqnm1);
+  v.get_function_values(fe_values_U,local_dof_indices,vqn);
+  v_old.get_function_values(fe_values_U,local_dof_indices,vqnm1);
+  if (dim==3)
+    {
+      w.get_function_values(fe_values_U,local_dof_indices,wqn);
+      w_old.get_function_values(fe_values_U,local_dof_indices,wqnm1);
+    }
+
+  // get values and gradients for p and dpsi
+  p.get_function_gradients(fe_values_P,scratch.local_dof_indices_P,grad_pqn);
+  psi.get_function_gradients(fe_values_P,scratch.local_dof_indices_P,grad_psiqn);
+  psi_old.get_function_gradients(fe_values_P,scratch.local_dof_indices_P,grad_psiqnm1);
+
+  for (unsigned int q_point=0; q_point<n_q_points; ++q_point)
+    {
+      const double JxW=fe_values_U.JxW(q_point);
+      for (unsigned int i=0; i<dofs_per_cell; ++i)
+        {
+          shape_grad[i]=fe_values_U.shape_grad(i,q_point);
+          shape_value[i]=fe_values_U.shape_value(i,q_point);
+        }
+
+      pressure_grad_u=(grad_pqn[q_point][0]+4./3*grad_psiqn[q_point][0]-1./3*grad_psiqnm1[q_point][0]);
+      pressure_grad_v=(grad_pqn[q_point][1]+4./3*grad_psiqn[q_point][1]-1./3*grad_psiqnm1[q_point][1]);
+      if (dim==3)
+        pressure_grad_w=(grad_pqn[q_point][2]+4./3*grad_psiqn[q_point][2]-1./3*grad_psiqnm1[q_point][2]);
+
+      if (LEVEL_SET==1) // use level set to define rho and nu
+        get_rho_and_nu(phiqnp1[q_point],rho_value,nu_value);
+      else // rho and nu are defined through functions
+        {
+          rho_value=rho_function.value(fe_values_U.quadrature_point(q_point));
+          nu_value=nu_function.value(fe_values_U.quadrature_point(q_point));
+        }
+
+      // Non-linearity: for semi-implicit
+      u_star=2*uqn[q_point]-uqnm1[q_point];
+      v_star=2*vqn[q_point]-vqnm1[q_point];
+      if (dim==3)
+        w_star=2*wqn[q_point]-wqnm1[q_point];
+
+      rho_star=rho_value; // This is because we consider rho*u_t instead of (rho*u)_t
+      rho=rho_value;
+
+      // FORCE TERMS
+      force_function.vector_value(fe_values_U.quadrature_point(q_point),force_terms);
+      force_u=force_terms[0];
+      force_v=force_terms[1];
+      if (dim==3)
+        force_w=force_terms[2];
+      if (RHO_TIMES_RHS==1)
+        {
+          force_u*=rho;
+          force_v*=rho;
+          if (dim==3)
+            force_w*=rho;
+        }
+
+      for (unsigned int i=0; i<dofs_per_cell; ++i)
+        {
+          cell_rhs_u(i)+=((4./3*rho*uqn[q_point]-1./3*rho*uqnm1[q_point]
+                           +2./3*time_step*(force_u-pressure_grad_u)
+                          )*shape_value[i])*JxW;
+          cell_rhs_v(i)+=((4./3*rho*vqn[q_point]-1./3*rho*vqnm1[q_point]
+                           +2./3*time_step*(force_v-pressure_grad_v)
+                          )*shape_value[i])*JxW;
+          if (dim==3)
+            cell_rhs_w(i)+=((4./3*rho*wqn[q_point]-1./3*rho*wqnm1[q_point]
+                             +2./3*time_step*(force_w-pressure_grad_w)
+                            )*shape_value[i])*JxW;
+          if (rebuild_Matrix_U==true)
+            for (unsigned int j=0; j<dofs_per_cell; ++j)
+              {
+                if (dim==2)
+                  cell_A_u(i,j)+=(rho_star*shape_value[i]*shape_value[j]
+                                  +2./3*time_step*nu_value*(shape_grad[i]*shape_grad[j])
+                                  +2./3*time_step*rho*shape_value[i]
+                                  *(u_star*shape_grad[j][0]+v_star*shape_grad[j][1]) // semi-implicit NL
+                                 )*JxW;
+                else //dim==3
+                  cell_A_u(i,j)+=(rho_star*shape_value[i]*shape_value[j]
+                                  +2./3*time_step*nu_value*(shape_grad[i]*shape_grad[j])
+                                  +2./3*time_step*rho*shape_value[i]
+                                  *(u_star*shape_grad[j][0]+v_star*shape_grad[j][1]+w_star*shape_grad[j][2]) // semi-implicit NL
+                                 )*JxW;
+              }
+        }
+    }
+}
+
+template<int dim>
+void NavierStokesSolver<dim>::copy_local_to_global_system_U(const AssemblyCopyData_U &copy_data)
+{
+  // distribute
+  if (rebuild_Matrix_U==true)
+    constraints.distribute_local_to_global(copy_data.cell_A_u,copy_data.local_dof_indices,system_Matrix_u);
+  constraints.distribute_local_to_global(copy_data.cell_rhs_u,copy_data.local_dof_indices,system_rhs_u);
+  constraints.distribute_local_to_global(copy_data.cell_rhs_v,copy_data.local_dof_indices,system_rhs_v);
+  if (dim==3)
+    constraints.distribute_local_to_global(copy_data.cell_rhs_w,copy_data.local_dof_indices,system_rhs_w);
+}
+
 template<int dim>
 void NavierStokesSolver<dim>::assemble_system_dpsi_q()
 {
@@ -914,7 +1207,7 @@ void NavierStokesSolver<dim>::assemble_system_dpsi_q()
         fe_values_LS.reinit(cell_LS);
 
         // get function values for LS
-        fe_values_LS.get_function_values(locally_relevant_solution_phi,phiqnp1);
+        fe_values_LS.get_function_values(level_set_vector(),phiqnp1);
 
         // get function grads for u and v
         fe_values_U.get_function_gradients(locally_relevant_solution_u,gunp1);
@@ -1003,10 +1296,20 @@ void NavierStokesSolver<dim>::solve_U(const AffineConstraints<double> &constrain
   constraints.distribute(completely_distributed_solution);
   solver.solve(Matrix,completely_distributed_solution,rhs,*preconditioner);
   constraints.distribute(completely_distributed_solution);
-  if (solver_control.last_step() > MAX_NUM_ITER_TO_RECOMPUTE_PRECONDITIONER)
+  // iterations with the hierarchy just built are the reference for the following steps
+  const unsigned int n_iterations=solver_control.last_step();
+  if (AMG_U_steps_since_setup==0)
+    AMG_U_reference_iterations=std::max(AMG_U_reference_iterations,n_iterations);
+  if (AMG_U_max_iterations>0 && n_iterations > AMG_U_max_iterations)
+    rebuild_Matrix_U_preconditioners=true;
+  if (AMG_U_iteration_growth>0 && AMG_U_steps_since_setup>0
+      && n_iterations > AMG_U_iteration_growth*std::max(AMG_U_reference_iterations,1U))
     rebuild_Matrix_U_preconditioners=true;
   if (verbose==true)
-    pcout<<"   Solved U in "<<solver_control.last_step()<<" iterations."<<std::endl;
+    pcout<<"   Solved U in "<<n_iterations<<" iterations"
+         <<" (AMG: "<<AMG_U_steps_since_setup<<" steps since setup, "
+         <<AMG_U_n_setups<<" setups in total"
+         <<(rebuild_Matrix_U_preconditioners ? ", rebuild requested" : "")<<")."<<std::endl;
 }
 
 template<int dim>
@@ -1031,9 +1334,22 @@ void NavierStokesSolver<dim>::solve_P(const AffineConstraints<double> &constrain
 ///////////////////////////////////////////////////////
 //////////////// get different fields /////////////////
 ///////////////////////////////////////////////////////
+template<int dim>
+void NavierStokesSolver<dim>::check_AMG_U_lifetime()
+{
+  if (AMG_U_n_setups==0)
+    return; // the first setup is done with the first assembly
+  AMG_U_steps_since_setup++;
+  if (AMG_U_rebuild_interval>0 && AMG_U_steps_since_setup>=AMG_U_rebuild_interval)
+    rebuild_Matrix_U_preconditioners=true;
+  if (AMG_U_interface_distance>0 && AMG_U_interface_displacement>=AMG_U_interface_distance)
+    rebuild_Matrix_U_preconditioners=true;
+}
+
 template<int dim>
 void NavierStokesSolver<dim>::get_velocity()
 {
+  check_AMG_U_lifetime();
   assemble_system_U();
   save_old_solution();
   solve_U(constraints,system_Matrix_u,preconditioner_Matrix_u,completely_distributed_solution_u,system_rhs_u);
@@ -1045,6 +1361,15 @@ void NavierStokesSolver<dim>::get_velocity()
       solve_U(constraints,system_Matrix_w,preconditioner_Matrix_w,completely_distributed_solution_w,system_rhs_w);
       locally_relevant_solution_w=completely_distributed_solution_w;
     }
+  // The interface is transported with this velocity: max|u|*time_step bounds its displacement in this step
+  if (AMG_U_interface_distance>0)
+    {
+      double max_velocity=std::pow(completely_distributed_solution_u.linfty_norm(),2)
+                          +std::pow(completely_distributed_solution_v.linfty_norm(),2);
+      if (dim==3)
+        max_velocity+=std::pow(completely_distributed_solution_w.linfty_norm(),2);
+      AMG_U_interface_displacement+=time_step*std::sqrt(max_velocity);
+    }
 }
 
 template<int dim>
@@ -1084,3 +1409,9 @@ void NavierStokesSolver<dim>::save_old_solution()
   locally_relevant_solution_psi_old=locally_relevant_solution_psi;
 }
 
+template<int dim>
+const PETScWrappers::MPI::Vector &NavierStokesSolver<dim>::level_set_vector() const
+{
+  return (shared_phi!=nullptr ? *shared_phi : locally_relevant_solution_phi);
+}
+
@@ -37,7 +37,11 @@
 
 using namespace dealii;
 
+// the utilities of the drivers have the same names, keep them local (see MultiPhase.cc)
+namespace
+{
 #include "utilities_test_NS.cc"
+}
 #include "NavierStokesSolver.cc"
 
 ///////////////////////////////////////////////////////
@@ -657,12 +661,15 @@ void TestNavierStokes<dim>::run()
     }
 }
 
-int main(int argc, char *argv[])
+// called by main() in main.cc
+int run_test_navier_stokes(int argc, char *argv[])
 {
   try
     {
       using namespace dealii;
-      Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv, 1);
+      // the cell loops of the solvers are assembled with threads: use all the cores given to each process
+      // (the number can be limited through the environment variable DEAL_II_NUM_THREADS)
+      Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv, numbers::invalid_unsigned_int);
       PetscInitialize(&argc, &argv, PETSC_NULL, PETSC_NULL);
       deallog.depth_console (0);
 
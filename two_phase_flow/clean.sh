@@ -1,5 +1,5 @@
 rm -rf CMakeFiles CMakeCache.txt Makefile cmake_install.cmake *~
-rm -f MultiPhase TestLevelSet TestNavierStokes
+rm -f two_phase_flow MultiPhase TestLevelSet TestNavierStokes
 rm -f sol* 
 rm -f *#*
 rm -f *.visit
@@ -0,0 +1,26 @@
+// All the simulations of this directory are built into one executable.
+// The first command line argument selects the driver, e.g.
+//   mpirun -np 4 ./two_phase_flow MultiPhase
+// where MultiPhase (the default), TestLevelSet and TestNavierStokes are available.
+#include <iostream>
+#include <string>
+
+// defined in MultiPhase.cc, TestLevelSet.cc and TestNavierStokes.cc respectively
+int run_multi_phase(int argc, char *argv[]);
+int run_test_level_set(int argc, char *argv[]);
+int run_test_navier_stokes(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+  const std::string mode = (argc>1 ? argv[1] : "MultiPhase");
+  if (mode=="MultiPhase")
+    return run_multi_phase(argc,argv);
+  else if (mode=="TestLevelSet")
+    return run_test_level_set(argc,argv);
+  else if (mode=="TestNavierStokes")
+    return run_test_navier_stokes(argc,argv);
+
+  std::cerr << "Unknown mode " << mode << ", use one of: "
+            << "MultiPhase, TestLevelSet, TestNavierStokes" << std::endl;
+  return 1;
+}